@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+
+#include "pipelinebenchmark.h"
+
+/// \brief Runs the pipeline benchmarks and writes the results as JSON.
+int main(int argc, char *argv[]) {
+    //////// Set application information ////////
+    QCoreApplication::setOrganizationName("OpenHantek");
+    QCoreApplication::setOrganizationDomain("www.openhantek.org");
+    QCoreApplication::setApplicationName("OpenHantek Benchmark");
+    QCoreApplication::setApplicationVersion(VERSION);
+
+    QCoreApplication benchmarkApplication(argc, argv);
+
+    //////// Parse command line ////////
+    PipelineBenchmark::Options options;
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QCoreApplication::translate("main", "Times the stages of the acquisition "
+                                                                         "pipeline on synthetic data."));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption outputOption("output",
+                                    QCoreApplication::translate("main", "Write the results to <file> instead of the "
+                                                                        "standard output."),
+                                    "file");
+    parser.addOption(outputOption);
+    QCommandLineOption filterOption(
+        "filter", QCoreApplication::translate("main", "Only run the benchmarks whose name matches <regexp>, e.g. "
+                                                      "\"^conversion/\"."),
+        "regexp");
+    parser.addOption(filterOption);
+    QCommandLineOption minTimeOption("min-time",
+                                     QCoreApplication::translate("main", "Repeat every benchmark for at least <s>."),
+                                     "s", QString::number(options.minTime));
+    parser.addOption(minTimeOption);
+    QCommandLineOption minIterationsOption(
+        "min-iterations", QCoreApplication::translate("main", "Repeat every benchmark at least <count> times."),
+        "count", QString::number(options.minIterations));
+    parser.addOption(minIterationsOption);
+    QCommandLineOption maxLengthOption("max-length",
+                                       QCoreApplication::translate("main", "Stop at a record length of <samples> "
+                                                                           "per channel."),
+                                       "samples", QString::number(options.maxLength));
+    parser.addOption(maxLengthOption);
+    parser.process(benchmarkApplication);
+
+    options.minTime = parser.value(minTimeOption).toDouble();
+    options.minIterations = parser.value(minIterationsOption).toUInt();
+    options.maxLength = parser.value(maxLengthOption).toULongLong();
+    if (parser.isSet(filterOption)) {
+        options.filter = QRegExp(parser.value(filterOption));
+        if (!options.filter.isValid()) {
+            qWarning().noquote() << QCoreApplication::translate("", "Invalid filter: %1")
+                                        .arg(options.filter.errorString());
+            return -1;
+        }
+    }
+
+    //////// Run the benchmarks ////////
+    PipelineBenchmark benchmark(options);
+    benchmark.run();
+
+    //////// Write the results ////////
+    QFile output;
+    if (parser.isSet(outputOption)) {
+        output.setFileName(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qWarning().noquote() << QCoreApplication::translate("", "Can't write the results to %1: %2")
+                                        .arg(output.fileName(), output.errorString());
+            return -1;
+        }
+    } else if (!output.open(stdout, QIODevice::WriteOnly)) {
+        return -1;
+    }
+    output.write(benchmark.report().toJson());
+    return 0;
+}
@@ -0,0 +1,394 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#define _USE_MATH_DEFINES
+#include <QDateTime>
+#include <QDebug>
+#include <QSysInfo>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
+
+#include "pipelinebenchmark.h"
+
+#include "capture/capturecodec.h"
+#include "channelfilter.h"
+#include "dataanalyzer.h"
+#include "exporter.h"
+#include "glgenerator.h"
+#include "hantekdsocontrol.h"
+#include "settings.h"
+#include "usb/simulateddevice.h"
+#include "utils/instrumentation.h"
+#include "viewconstants.h"
+
+namespace {
+const unsigned PHOSPHOR_DEPTHS[] = {1, 8, 32}; ///< The benchmarked digital phosphor depths
+const double SIGNAL_FREQUENCY[] = {1e3, 2.5e3}; ///< The frequencies of the synthetic channels in Hz
+
+/// \brief Generates the synthetic record of a channel, a sine of 1 V at its own frequency.
+std::vector<double> sineRecord(unsigned channel, size_t length) {
+    std::vector<double> record(length);
+    for (size_t index = 0; index < length; ++index)
+        record[index] = std::sin(2.0 * M_PI * SIGNAL_FREQUENCY[channel] * index / PipelineBenchmark::SAMPLERATE);
+    return record;
+}
+
+/// \brief Fills a frame with the synthetic records of both physical channels.
+void fillFrame(DSOsamples &samples, size_t length) {
+    samples.samplerate = PipelineBenchmark::SAMPLERATE;
+    samples.data.resize(HANTEK_CHANNELS);
+    samples.compactData.resize(HANTEK_CHANNELS);
+    for (unsigned channel = 0; channel < HANTEK_CHANNELS; ++channel) samples.data[channel] = sineRecord(channel, length);
+}
+
+/// \return The completely analyzed synthetic frame, the input of the graphs and of the export.
+std::shared_ptr<DataAnalyzerResult> analyzedFrame(DataAnalyzer &analyzer, const DsoSettings &settings,
+                                                  size_t length) {
+    DSOsamples samples;
+    fillFrame(samples, length);
+    std::shared_ptr<DataAnalyzerResult> result = analyzer.convertData(&samples, &settings.scope);
+    analyzer.spectrumAnalysis(result.get());
+    return result;
+}
+}
+
+const size_t PipelineBenchmark::MIN_LENGTH;
+const size_t PipelineBenchmark::EXPORT_MAX_LENGTH;
+const unsigned PipelineBenchmark::MAX_ITERATIONS;
+constexpr double PipelineBenchmark::SAMPLERATE;
+
+PipelineBenchmark::PipelineBenchmark(const Options &options) : options(options) {}
+
+void PipelineBenchmark::run() {
+    for (size_t length = MIN_LENGTH; length <= options.maxLength; length *= 10) benchmarkConversion(length);
+    for (size_t length = MIN_LENGTH; length <= options.maxLength; length *= 10) benchmarkAnalysis(length);
+    for (size_t length = MIN_LENGTH; length <= options.maxLength; length *= 10) benchmarkFilters(length);
+    for (size_t length = MIN_LENGTH; length <= options.maxLength; length *= 10) benchmarkGraphs(length);
+    for (size_t length = MIN_LENGTH; length <= std::min(options.maxLength, EXPORT_MAX_LENGTH); length *= 10)
+        benchmarkExport(length);
+    for (size_t length = MIN_LENGTH; length <= options.maxLength; length *= 10) benchmarkCapture(length);
+}
+
+QJsonDocument PipelineBenchmark::report() const {
+    QJsonObject system;
+    system["version"] = QString(VERSION);
+    system["os"] = QSysInfo::prettyProductName();
+    system["cpu"] = QSysInfo::currentCpuArchitecture();
+    system["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+
+    QJsonObject document;
+    document["system"] = system;
+    document["benchmarks"] = results;
+    return QJsonDocument(document);
+}
+
+void PipelineBenchmark::benchmarkConversion(size_t length) {
+    for (bool compact : {false, true}) {
+        benchmarkConversion("DSO-2090", false, compact, length);
+        benchmarkConversion("DSO-2250", true, compact, length);
+        benchmarkConversion("DSO-6022BE", false, compact, length);
+        benchmarkConversion("DSO-5200", false, compact, length);
+        benchmarkConversion("DSO-5200", true, compact, length);
+    }
+    for (Dso::AcquisitionMode mode : {Dso::ACQUISITION_AVERAGE, Dso::ACQUISITION_HIGHRES}) {
+        benchmarkConversion("DSO-2090", false, false, length, mode);
+        benchmarkConversion("DSO-5200", false, false, length, mode);
+    }
+}
+
+/// \brief Times the conversion of one data layout.
+/// \param model The model that provides the data layout.
+/// \param fastRate true, if only the first channel is used with the fast rate mode.
+/// \param compact true, if the samples are stored as raw codes.
+/// \param length The samples per channel, in fast rate mode the samples of the channel.
+/// \param mode The acquisition mode, the frames are averaged or decimated by 16.
+void PipelineBenchmark::benchmarkConversion(const QString &model, bool fastRate, bool compact, size_t length,
+                                            Dso::AcquisitionMode mode) {
+    static const char *const MODE_NAMES[] = {"", "/average", "/highres", "/equivalent"};
+    const QString name =
+        "conversion/" + model + (fastRate ? "/fastrate" : "") + (compact ? "/compact" : "") + MODE_NAMES[mode];
+    if (!enabled(name)) return;
+
+    QString errorMessage;
+    std::unique_ptr<SimulatedDevice> device = SimulatedDevice::create(model, errorMessage);
+    if (!device || !device->connectDevice(errorMessage)) {
+        qWarning().noquote() << name << errorMessage;
+        return;
+    }
+    HantekDsoControl dsoControl(device.get());
+    dsoControl.setCompactSamples(compact);
+    dsoControl.setAcquisitionMode(mode, 16);
+    dsoControl.setChannelUsed(0, true);
+    dsoControl.setChannelUsed(1, !fastRate);
+    if (fastRate) dsoControl.setSamplerate(dsoControl.getMaxSamplerate());
+    if (dsoControl.isFastRate() != fastRate) {
+        qWarning().noquote() << name << "isn't supported by the model";
+        return;
+    }
+
+    // The device has to know the channels to generate the right layout
+    dsoControl.applyPendingCommands();
+
+    const unsigned sampleSize = dsoControl.getSampleSize();
+    const size_t samples = fastRate ? length : length * HANTEK_CHANNELS;
+    // The frames of the DSO-6022BE start and end with stale samples, that are dropped by the conversion
+    size_t stale = 0;
+    if (device->getUniqueModelID() == MODEL_DSO6022BE)
+        stale = (SimulatedDevice::STALE_HEAD + SimulatedDevice::STALE_TAIL) * HANTEK_CHANNELS;
+    std::vector<unsigned char> raw((sampleSize > 8) ? samples * 2 : samples + stale);
+    device->bulkReadMulti(raw.data(), (unsigned)raw.size());
+
+    QJsonObject parameters;
+    parameters["model"] = model;
+    parameters["fastRate"] = fastRate;
+    parameters["compact"] = compact;
+    parameters["acquisitionMode"] = (int)mode;
+    parameters["sampleSize"] = (int)sampleSize;
+    parameters["length"] = (double)length;
+    measure(name, parameters, (double)samples, nullptr, [&dsoControl, &raw]() {
+        dsoControl.convertRawDataToSamples(raw);
+    });
+}
+
+void PipelineBenchmark::benchmarkAnalysis(size_t length) {
+    const bool convertEnabled = enabled("analysis/convertData");
+    const bool spectrumEnabled = enabled("analysis/spectrumAnalysis");
+    const bool singleEnabled = enabled("analysis/spectrumAnalysis/single");
+    const bool timeEnabled = enabled("analysis/spectrumAnalysis/timeDomain");
+    if (!convertEnabled && !spectrumEnabled && !singleEnabled && !timeEnabled) return;
+
+    DsoSettings settings;
+    prepareSettings(settings, length);
+    DataAnalyzer analyzer;
+    analyzer.applySettings(&settings.scope);
+
+    // The analyzer takes over the voltages of the frame, so every iteration gets a fresh copy
+    DSOsamples frame;
+    fillFrame(frame, length);
+    DSOsamples samples = frame;
+    auto refill = [&samples, &frame]() { samples.data = frame.data; };
+
+    QJsonObject parameters;
+    parameters["channels"] = HANTEK_CHANNELS;
+    parameters["length"] = (double)length;
+    const double items = (double)length * HANTEK_CHANNELS;
+    std::shared_ptr<DataAnalyzerResult> result;
+    if (convertEnabled) {
+        measure("analysis/convertData", parameters, items,
+                [&]() {
+                    result.reset();
+                    refill();
+                },
+                [&]() { result = analyzer.convertData(&samples, &settings.scope); });
+    }
+    // The spectrum benchmarks differ in the settings, every iteration analyzes a freshly converted frame
+    auto measureSpectrum = [&](const QString &name) {
+        measure(name, parameters, items,
+                [&]() {
+                    result.reset();
+                    refill();
+                    result = analyzer.convertData(&samples, &settings.scope);
+                },
+                [&]() { analyzer.spectrumAnalysis(result.get()); });
+    };
+    if (spectrumEnabled) measureSpectrum("analysis/spectrumAnalysis");
+    if (singleEnabled) {
+        settings.scope.spectrumSinglePrecision = true;
+        measureSpectrum("analysis/spectrumAnalysis/single");
+        settings.scope.spectrumSinglePrecision = false;
+    }
+    if (timeEnabled) {
+        // Only the voltage graphs are shown, nothing needs a transform
+        for (unsigned channel = 0; channel < HANTEK_CHANNELS; ++channel) settings.scope.spectrum[channel].used = false;
+        settings.scope.frequencyEstimator = Dso::FREQUENCY_ZEROCROSSING;
+        measureSpectrum("analysis/spectrumAnalysis/timeDomain");
+        for (unsigned channel = 0; channel < HANTEK_CHANNELS; ++channel) settings.scope.spectrum[channel].used = true;
+        settings.scope.frequencyEstimator = Dso::FREQUENCY_AUTOCORRELATION;
+    }
+}
+
+void PipelineBenchmark::benchmarkFilters(size_t length) {
+    const std::vector<double> voltages = sineRecord(0, length);
+    std::vector<double> samples;
+
+    for (Dso::FilterDesign design : {Dso::FILTERDESIGN_FIR, Dso::FILTERDESIGN_IIR}) {
+        const QString name = QString("analysis/filter/%1").arg(design == Dso::FILTERDESIGN_FIR ? "FIR" : "IIR");
+        ChannelFilter::Response response;
+        response.type = Dso::FILTER_BANDPASS;
+        response.design = design;
+        response.low = SIGNAL_FREQUENCY[0] / 2;
+        response.high = SIGNAL_FREQUENCY[0] * 2;
+        response.taps = 255;
+        response.order = 4;
+        ChannelFilter filter;
+        filter.configure(response, 1.0 / SAMPLERATE);
+
+        QJsonObject parameters;
+        parameters["taps"] = (int)response.taps;
+        parameters["order"] = (int)response.order;
+        parameters["length"] = (double)length;
+        measure(name, parameters, (double)length, [&samples, &voltages]() { samples = voltages; },
+                [&filter, &samples]() { filter.process(samples.data(), samples.size(), false); });
+    }
+}
+
+void PipelineBenchmark::benchmarkGraphs(size_t length) {
+    std::vector<std::pair<Dso::GraphFormat, unsigned>> cases;
+    for (Dso::GraphFormat format : {Dso::GRAPHFORMAT_TY, Dso::GRAPHFORMAT_XY}) {
+        for (unsigned depth : PHOSPHOR_DEPTHS) {
+            const QString name =
+                QString("graphs/%1/phosphor%2").arg(format == Dso::GRAPHFORMAT_TY ? "TY" : "XY").arg(depth);
+            if (enabled(name)) cases.push_back(std::make_pair(format, depth));
+        }
+    }
+    const bool density = enabled("graphs/XY/density");
+    if (cases.empty() && !density) return;
+
+    // The graphs are generated from an analyzed frame
+    DsoSettings settings;
+    prepareSettings(settings, length);
+    DataAnalyzer analyzer;
+    analyzer.applySettings(&settings.scope);
+    std::shared_ptr<DataAnalyzerResult> result = analyzedFrame(analyzer, settings, length);
+
+    for (const auto &graphCase : cases) {
+        const QString format = graphCase.first == Dso::GRAPHFORMAT_TY ? "TY" : "XY";
+        settings.scope.horizontal.format = graphCase.first;
+        settings.view.digitalPhosphorDepth = (int)graphCase.second;
+        GlGenerator generator(&settings.scope, &settings.view);
+
+        QJsonObject parameters;
+        parameters["format"] = format;
+        parameters["phosphorDepth"] = (int)graphCase.second;
+        parameters["length"] = (double)length;
+        // Fill all phosphor layers first, so the iterations recycle the layers like a running scope
+        for (unsigned layer = 0; layer < graphCase.second; ++layer) generator.generateGraphs(result.get());
+        measure(QString("graphs/%1/phosphor%2").arg(format).arg(graphCase.second), parameters,
+                (double)length * HANTEK_CHANNELS, nullptr, [&generator, &result]() {
+                    generator.generateGraphs(result.get());
+                });
+    }
+
+    if (density) {
+        // The pairs are binned into the map that fades over the phosphor depth
+        settings.scope.horizontal.format = Dso::GRAPHFORMAT_XY;
+        settings.view.xyDensity = true;
+        settings.view.digitalPhosphor = true;
+        settings.view.digitalPhosphorDepth = 8;
+        GlGenerator generator(&settings.scope, &settings.view);
+
+        QJsonObject parameters;
+        parameters["format"] = QString("XY");
+        parameters["length"] = (double)length;
+        generator.generateGraphs(result.get());
+        measure("graphs/XY/density", parameters, (double)length * HANTEK_CHANNELS, nullptr,
+                [&generator, &result]() { generator.generateGraphs(result.get()); });
+        settings.view.xyDensity = false;
+    }
+}
+
+void PipelineBenchmark::benchmarkExport(size_t length) {
+    if (!enabled("export/csv")) return;
+    if (!exportDirectory.isValid()) {
+        qWarning() << "Can't create a temporary directory for the export";
+        return;
+    }
+
+    DsoSettings settings;
+    prepareSettings(settings, length);
+    DataAnalyzer analyzer;
+    analyzer.applySettings(&settings.scope);
+    std::shared_ptr<DataAnalyzerResult> result = analyzedFrame(analyzer, settings, length);
+
+    std::unique_ptr<Exporter> exporter(
+        Exporter::createFileExporter(&settings, exportDirectory.filePath("benchmark.csv"), EXPORT_FORMAT_CSV));
+    QJsonObject parameters;
+    parameters["length"] = (double)length;
+    measure("export/csv", parameters, (double)length, nullptr, [&exporter, &result]() {
+        if (!exporter->exportSamples(result.get())) qWarning() << "Export failed";
+    });
+}
+
+void PipelineBenchmark::benchmarkCapture(size_t length) {
+    if (!enabled("capture/encodeChunk") && !enabled("capture/decodeChunk")) return;
+
+    // A sine over most of the range with a few codes of noise, like a real channel
+    const std::vector<double> sine = sineRecord(0, length);
+    std::vector<uint8_t> codes(length);
+    uint32_t noise = 1;
+    for (size_t index = 0; index < length; ++index) {
+        noise = noise * 1664525u + 1013904223u;
+        codes[index] = (uint8_t)std::lround(128.0 + 100.0 * sine[index] + (double)(noise >> 30) - 1.5);
+    }
+    std::vector<char> chunk;
+    Capture::encodeChunk(codes.data(), length, false, chunk);
+    std::vector<uint8_t> decoded(length);
+
+    QJsonObject parameters;
+    parameters["length"] = (double)length;
+    parameters["ratio"] = (double)chunk.size() / length;
+    measure("capture/encodeChunk", parameters, (double)length, nullptr, [&codes, &chunk, length]() {
+        Capture::encodeChunk(codes.data(), length, false, chunk);
+    });
+    measure("capture/decodeChunk", parameters, (double)length, nullptr, [&chunk, &decoded, length]() {
+        if (!Capture::decodeChunk(reinterpret_cast<const uchar *>(chunk.data()), length, false, decoded.data()))
+            qWarning() << "Decoding failed";
+    });
+}
+
+void PipelineBenchmark::measure(const QString &name, const QJsonObject &parameters, double items,
+                                std::function<void()> prepare, std::function<void()> iteration) {
+    if (!enabled(name)) return;
+
+    // The first iteration warms up the caches and allocates the reused buffers
+    if (prepare) prepare();
+    iteration();
+
+    std::vector<qint64> times;
+    const qint64 start = Instrumentation::now();
+    while (times.size() < options.minIterations ||
+           (Instrumentation::now() - start < (qint64)(options.minTime * 1e9) && times.size() < MAX_ITERATIONS)) {
+        if (prepare) prepare();
+        const qint64 begin = Instrumentation::now();
+        iteration();
+        times.push_back(Instrumentation::now() - begin);
+    }
+
+    std::sort(times.begin(), times.end());
+    const double median = (times.size() % 2) ? (double)times[times.size() / 2]
+                                             : (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2.0;
+    const double mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+
+    QJsonObject result;
+    result["name"] = name;
+    result["parameters"] = parameters;
+    result["iterations"] = (double)times.size();
+    result["minNs"] = (double)times.front();
+    result["medianNs"] = median;
+    result["meanNs"] = mean;
+    result["maxNs"] = (double)times.back();
+    result["items"] = items;
+    result["itemsPerSecond"] = median > 0.0 ? items / median * 1e9 : 0.0;
+    results.append(result);
+
+    qDebug().noquote() << QString("%1 %2: %3 ms, %4 Mitems/s")
+                              .arg(name)
+                              .arg(parameters.value("length").toDouble())
+                              .arg(median / 1e6, 0, 'f', 3)
+                              .arg(result["itemsPerSecond"].toDouble() / 1e6, 0, 'f', 1);
+}
+
+bool PipelineBenchmark::enabled(const QString &name) const {
+    return options.filter.isEmpty() || options.filter.indexIn(name) >= 0;
+}
+
+/// \brief Shows the whole record of both physical channels on the screen.
+void PipelineBenchmark::prepareSettings(DsoSettings &settings, size_t length) {
+    settings.setChannelCount(HANTEK_CHANNELS);
+    for (unsigned channel = 0; channel < HANTEK_CHANNELS; ++channel) {
+        settings.scope.voltage[channel].used = true;
+        settings.scope.spectrum[channel].used = true;
+    }
+    settings.scope.horizontal.timebase = length / SAMPLERATE / DIVS_TIME;
+}
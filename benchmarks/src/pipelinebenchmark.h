@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegExp>
+#include <QString>
+#include <QTemporaryDir>
+#include <functional>
+#include <vector>
+
+#include "definitions.h"
+
+class DsoSettings;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class PipelineBenchmark                                 pipelinebenchmark.h
+/// \brief Times the stages of the acquisition pipeline separately.
+/// Every benchmark repeats one stage on synthetic data until both the minimal
+/// number of iterations and the minimal time are reached. The preparation of
+/// the input of every iteration isn't timed. The stages are:
+/// - conversion: HantekDsoControl::convertRawDataToSamples for every data layout,
+///   the raw data is generated by SimulatedDevice, and the acquisition modes
+/// - analysis: DataAnalyzer::convertData and DataAnalyzer::spectrumAnalysis,
+///   and ChannelFilter::process with the FIR and the IIR band-pass
+/// - graphs: GlGenerator::generateGraphs for TY and XY at several phosphor depths
+/// - export: Exporter::exportSamples as CSV into a temporary file
+///
+/// The results are collected as JSON, so they can be compared between builds.
+class PipelineBenchmark {
+  public:
+    /// \brief The parameters of a benchmark run.
+    struct Options {
+        double minTime = 0.5;        ///< The minimal time of every benchmark in s
+        unsigned minIterations = 5;  ///< The minimal iterations of every benchmark
+        size_t maxLength = 10000000; ///< The longest record length in samples per channel
+        QRegExp filter;              ///< Only the benchmarks with a matching name are run, if not empty
+    };
+
+    explicit PipelineBenchmark(const Options &options);
+
+    /// \brief Runs all benchmarks, the progress is written to the log.
+    void run();
+
+    /// \return The results in a JSON document.
+    QJsonDocument report() const;
+
+    static const size_t MIN_LENGTH = 10000;          ///< The shortest record length in samples per channel
+    static const size_t EXPORT_MAX_LENGTH = 1000000; ///< Longer records aren't exported, the files get too big
+    static const unsigned MAX_ITERATIONS = 100000;   ///< Fast stages stop after this many iterations
+    static constexpr double SAMPLERATE = 1e6;        ///< The samplerate of the synthetic frames in S/s
+
+  private:
+    void benchmarkConversion(size_t length);
+    void benchmarkConversion(const QString &model, bool fastRate, bool compact, size_t length,
+                             Dso::AcquisitionMode mode = Dso::ACQUISITION_NORMAL);
+    void benchmarkAnalysis(size_t length);
+    void benchmarkFilters(size_t length);
+    void benchmarkGraphs(size_t length);
+    void benchmarkExport(size_t length);
+    void benchmarkCapture(size_t length);
+
+    /// \brief Times one benchmark.
+    /// \param name The name of the benchmark.
+    /// \param parameters The parameters of the benchmark, they are part of the result.
+    /// \param items The number of processed items per iteration, usually the samples.
+    /// \param prepare Prepares the input of an iteration, it isn't timed. May be empty.
+    /// \param iteration The timed work.
+    void measure(const QString &name, const QJsonObject &parameters, double items, std::function<void()> prepare,
+                 std::function<void()> iteration);
+    bool enabled(const QString &name) const;
+    static void prepareSettings(DsoSettings &settings, size_t length);
+
+    Options options;
+    QJsonArray results;
+    QTemporaryDir exportDirectory; ///< Holds the exported files
+};
@@ -5,7 +5,7 @@
 #
 # It sets the following variables:
 #   FFTW_FOUND					... true if fftw is found on the system
-#   FFTW_LIBRARIES				... full path to fftw library
+#   FFTW_LIBRARIES				... full path to the double and single precision fftw libraries
 #   FFTW_INCLUDES				... fftw include directory
 #
 # The following variables will be checked by the function
@@ -47,16 +47,28 @@ endif (FFTW_USE_STATIC_LIBS AND NOT MSVC)
       /sw/lib
   )
 
+  find_library(FFTWF_LIBRARY
+    NAMES
+      fftw3f
+      libfftw3f${LIBFFTW_LIB_SUFFIX}
+    PATHS
+      /usr/lib
+      /usr/local/lib
+      /opt/local/lib
+      /sw/lib
+  )
+
   set(FFTW_INCLUDE_DIRS
     ${FFTW_INCLUDE_DIR}
   )
   set(FFTW_LIBRARIES
     ${FFTW_LIBRARY}
+    ${FFTWF_LIBRARY}
 )
 
-  if (FFTW_INCLUDE_DIRS AND FFTW_LIBRARIES)
+  if (FFTW_INCLUDE_DIRS AND FFTW_LIBRARY AND FFTWF_LIBRARY)
      set(FFTW_FOUND TRUE)
-  endif (FFTW_INCLUDE_DIRS AND FFTW_LIBRARIES)
+  endif (FFTW_INCLUDE_DIRS AND FFTW_LIBRARY AND FFTWF_LIBRARY)
 
   if (FFTW_FOUND)
     if (NOT FFTW_FIND_QUIETLY)
@@ -40,7 +40,13 @@ execute_process(
     RESULT_VARIABLE ExitCode)
 CheckExitCodeAndExitIfError("lib")
 
-target_link_libraries(${PROJECT_NAME} "${CMAKE_BINARY_DIR}/fftw/libfftw3-3.lib")
+execute_process(
+    COMMAND "${_vs_bin_path}/lib.exe" /machine:x64 /def:${CMAKE_BINARY_DIR}/fftw/libfftw3f-3.def /out:${CMAKE_BINARY_DIR}/fftw/libfftw3f-3.lib
+    WORKING_DIRECTORY "${CMAKE_BINARY_DIR}/fftw"
+    RESULT_VARIABLE ExitCode)
+CheckExitCodeAndExitIfError("lib")
+
+target_link_libraries(${PROJECT_NAME} "${CMAKE_BINARY_DIR}/fftw/libfftw3-3.lib" "${CMAKE_BINARY_DIR}/fftw/libfftw3f-3.lib")
 target_include_directories(${PROJECT_NAME} PRIVATE "${CMAKE_BINARY_DIR}/fftw")
 
 file(COPY "${CMAKE_BINARY_DIR}/fftw/fftw3.h" DESTINATION "${CMAKE_SOURCE_DIR}/src")
@@ -48,6 +54,7 @@ file(COPY "${CMAKE_BINARY_DIR}/fftw/fftw3.h" DESTINATION "${CMAKE_SOURCE_DIR}/sr
 add_custom_command(TARGET ${PROJECT_NAME}
         POST_BUILD
         COMMAND ${CMAKE_COMMAND} -E copy_if_different "${CMAKE_BINARY_DIR}/fftw/libfftw3-3.dll" $<TARGET_FILE_DIR:${PROJECT_NAME}>
+        COMMAND ${CMAKE_COMMAND} -E copy_if_different "${CMAKE_BINARY_DIR}/fftw/libfftw3f-3.dll" $<TARGET_FILE_DIR:${PROJECT_NAME}>
         COMMENT "Copy fftw3 dlls for ${PROJECT_NAME}"
 )
 
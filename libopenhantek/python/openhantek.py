@@ -0,0 +1,173 @@
+# SPDX-License-Identifier: GPL-2.0+
+"""Acquires and analyzes the signals of a Hantek oscilloscope in-process.
+
+The module wraps the C interface of libopenhantek with ctypes. The samples of
+a frame are NumPy arrays on the memory of the analysis, they are created
+through the buffer protocol without copies and keep the frame alive:
+
+    import openhantek
+    with openhantek.Session("simulate:DSO-6022BE") as session:
+        frame = session.next_frame()
+        volts = frame.voltage(0)
+        print(frame.id, volts.mean(), frame.interval(0))
+
+Only the records of the roll mode are ring buffers, their two parts are
+joined into a new array.
+"""
+
+import ctypes
+import ctypes.util
+import os
+
+import numpy
+
+__all__ = ["Error", "Session", "Frame", "load"]
+
+_library = None
+
+
+class Error(RuntimeError):
+    """A session can't be opened."""
+
+
+def load(path=None):
+    """Loads libopenhantek, by default from OPENHANTEK_LIBRARY or the library path."""
+    global _library
+    if _library is not None and path is None:
+        return _library
+    path = path or os.environ.get("OPENHANTEK_LIBRARY") or ctypes.util.find_library("openhantek")
+    if not path:
+        raise Error("libopenhantek not found, set OPENHANTEK_LIBRARY")
+    library = ctypes.CDLL(path)
+
+    session, frame = ctypes.c_void_p, ctypes.c_void_p
+    size = ctypes.POINTER(ctypes.c_size_t)
+    samples = ctypes.POINTER(ctypes.c_double)
+    signatures = {
+        "openhantek_open": (session, [ctypes.c_char_p, ctypes.c_char_p]),
+        "openhantek_close": (None, [session]),
+        "openhantek_last_error": (ctypes.c_char_p, []),
+        "openhantek_channel_count": (ctypes.c_uint, [session]),
+        "openhantek_set_sampling": (None, [session, ctypes.c_int]),
+        "openhantek_next_frame": (frame, [session, ctypes.c_int]),
+        "openhantek_release_frame": (None, [frame]),
+        "openhantek_frame_id": (ctypes.c_uint64, [frame]),
+        "openhantek_frame_timestamp": (ctypes.c_int64, [frame]),
+        "openhantek_frame_channels": (ctypes.c_uint, [frame]),
+        "openhantek_frame_voltage": (samples, [frame, ctypes.c_uint, ctypes.c_uint, size]),
+        "openhantek_frame_interval": (ctypes.c_double, [frame, ctypes.c_uint]),
+        "openhantek_frame_spectrum": (samples, [frame, ctypes.c_uint, ctypes.c_uint, size]),
+        "openhantek_frame_bin_width": (ctypes.c_double, [frame, ctypes.c_uint]),
+        "openhantek_frame_measurement": (ctypes.c_double, [frame, ctypes.c_uint, ctypes.c_uint]),
+    }
+    for name, (restype, argtypes) in signatures.items():
+        function = getattr(library, name)
+        function.restype = restype
+        function.argtypes = argtypes
+    _library = library
+    return library
+
+
+class Frame(object):
+    """An analyzed frame, its memory is recycled when no array refers to it anymore."""
+
+    def __init__(self, library, handle):
+        self._library = library
+        self._handle = handle
+        self.id = library.openhantek_frame_id(handle)
+        self.timestamp = library.openhantek_frame_timestamp(handle)
+        self.channels = library.openhantek_frame_channels(handle)
+
+    def __del__(self):
+        if self._handle:
+            self._library.openhantek_release_frame(self._handle)
+            self._handle = None
+
+    def _span(self, function, channel, part):
+        count = ctypes.c_size_t(0)
+        pointer = function(self._handle, channel, part, ctypes.byref(count))
+        if not pointer or not count.value:
+            return None
+        buffer = (ctypes.c_double * count.value).from_address(ctypes.addressof(pointer.contents))
+        # The buffer keeps the frame alive, the array keeps the buffer alive
+        buffer._frame = self
+        array = numpy.frombuffer(buffer, dtype=numpy.float64)
+        array.flags.writeable = False
+        return array
+
+    def _samples(self, function, channel):
+        if channel >= self.channels:
+            raise IndexError("channel %d doesn't exist" % channel)
+        older = self._span(function, channel, 0)
+        newer = self._span(function, channel, 1)
+        if newer is None:
+            return older if older is not None else numpy.empty(0)
+        return numpy.concatenate((older, newer)) if older is not None else newer
+
+    def voltage(self, channel):
+        """The voltages of the channel in V, a read-only view of the frame."""
+        return self._samples(self._library.openhantek_frame_voltage, channel)
+
+    def interval(self, channel):
+        """The time between two voltages of the channel in s."""
+        return self._library.openhantek_frame_interval(self._handle, channel)
+
+    def spectrum(self, channel):
+        """The spectrum of the channel in dB, a read-only view of the frame."""
+        return self._samples(self._library.openhantek_frame_spectrum, channel)
+
+    def bin_width(self, channel):
+        """The frequency between two spectrum bins of the channel in Hz."""
+        return self._library.openhantek_frame_bin_width(self._handle, channel)
+
+    def measurement(self, channel, measurement):
+        """The automatic measurement of the channel by its index in Dso::Measurement, NaN if unavailable."""
+        return self._library.openhantek_frame_measurement(self._handle, channel, measurement)
+
+
+class Session(object):
+    """A connected device with its analysis, it samples from the start on."""
+
+    def __init__(self, device="0", config=None, library=None):
+        self._library = library or load()
+        self._handle = self._library.openhantek_open(device.encode("utf-8"),
+                                                     config.encode("utf-8") if config else None)
+        if not self._handle:
+            raise Error(self._library.openhantek_last_error().decode("utf-8"))
+        self._library.openhantek_set_sampling(self._handle, 1)
+
+    def close(self):
+        """Stops the acquisition, the frames that are still referenced stay valid."""
+        if self._handle:
+            self._library.openhantek_close(self._handle)
+            self._handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    @property
+    def channel_count(self):
+        """The number of physical channels, the math channel follows them."""
+        return self._library.openhantek_channel_count(self._handle)
+
+    def set_sampling(self, enabled):
+        """Starts or stops the sampling."""
+        self._library.openhantek_set_sampling(self._handle, 1 if enabled else 0)
+
+    def next_frame(self, timeout=-1):
+        """Waits for a newer analyzed frame, None after the timeout in ms."""
+        handle = self._library.openhantek_next_frame(self._handle, timeout)
+        return Frame(self._library, handle) if handle else None
+
+    def frames(self, count=None, timeout=-1):
+        """Yields the analyzed frames, frames that arrive while the caller is busy are skipped."""
+        while count is None or count > 0:
+            frame = self.next_frame(timeout)
+            if frame is None:
+                return
+            yield frame
+            if count is not None:
+                count -= 1
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QByteArray>
+#include <QString>
+#include <cmath>
+#include <memory>
+
+#include "openhantek.h"
+
+#include "dataanalyzerresult.h"
+#include "scopesession.h"
+
+struct openhantek_session {
+    ScopeSession session;
+};
+
+struct openhantek_frame {
+    std::shared_ptr<const DataAnalyzerResult> result; ///< Keeps the samples from being recycled
+};
+
+namespace {
+thread_local QByteArray lastError; ///< The reason of the last failure of the calling thread
+
+/// \return The samples of a channel, nullptr if the channel doesn't exist.
+const DataChannel *channelData(const openhantek_frame *frame, unsigned channel) {
+    if (!frame || channel >= frame->result->channelCount()) return nullptr;
+    return frame->result->data((int)channel);
+}
+
+/// \return The span of the samples, nullptr if it is empty or the channel doesn't exist.
+const double *spanOf(const DataChannel *data, const SampleValues DataChannel::*values, unsigned part, size_t *count) {
+    size_t spanCount = 0;
+    const double *span = data ? (data->*values).span(part ? 1 : 0, spanCount) : nullptr;
+    if (count) *count = spanCount;
+    return spanCount ? span : nullptr;
+}
+}
+
+openhantek_session *openhantek_open(const char *device, const char *config) {
+    std::unique_ptr<openhantek_session> session(new openhantek_session);
+    QString errorMessage;
+    if (!session->session.open(QString::fromUtf8(device ? device : ""), QString::fromUtf8(config ? config : ""),
+                               errorMessage)) {
+        lastError = errorMessage.toUtf8();
+        return nullptr;
+    }
+    return session.release();
+}
+
+void openhantek_close(openhantek_session *session) { delete session; }
+
+const char *openhantek_last_error(void) { return lastError.constData(); }
+
+unsigned openhantek_channel_count(const openhantek_session *session) { return session->session.getChannelCount(); }
+
+void openhantek_set_sampling(openhantek_session *session, int enabled) { session->session.setSampling(enabled != 0); }
+
+openhantek_frame *openhantek_next_frame(openhantek_session *session, int timeout) {
+    std::shared_ptr<const DataAnalyzerResult> result = session->session.nextFrame(timeout);
+    if (!result) return nullptr;
+    openhantek_frame *frame = new openhantek_frame;
+    frame->result = std::move(result);
+    return frame;
+}
+
+void openhantek_release_frame(openhantek_frame *frame) { delete frame; }
+
+uint64_t openhantek_frame_id(const openhantek_frame *frame) { return frame->result->frameId(); }
+
+int64_t openhantek_frame_timestamp(const openhantek_frame *frame) { return frame->result->timestamp(); }
+
+unsigned openhantek_frame_channels(const openhantek_frame *frame) { return frame->result->channelCount(); }
+
+const double *openhantek_frame_voltage(const openhantek_frame *frame, unsigned channel, unsigned part,
+                                       size_t *count) {
+    return spanOf(channelData(frame, channel), &DataChannel::voltage, part, count);
+}
+
+double openhantek_frame_interval(const openhantek_frame *frame, unsigned channel) {
+    const DataChannel *data = channelData(frame, channel);
+    return data ? data->voltage.interval : 0.0;
+}
+
+const double *openhantek_frame_spectrum(const openhantek_frame *frame, unsigned channel, unsigned part,
+                                        size_t *count) {
+    return spanOf(channelData(frame, channel), &DataChannel::spectrum, part, count);
+}
+
+double openhantek_frame_bin_width(const openhantek_frame *frame, unsigned channel) {
+    const DataChannel *data = channelData(frame, channel);
+    return data ? data->spectrum.interval : 0.0;
+}
+
+double openhantek_frame_measurement(const openhantek_frame *frame, unsigned channel, unsigned measurement) {
+    const DataChannel *data = channelData(frame, channel);
+    if (!data || measurement >= Dso::MEASUREMENT_COUNT || data->voltage.sample.empty()) return NAN;
+    return data->measurements[measurement];
+}
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+/// \file openhantek.h
+/// \brief The C interface of libopenhantek for other languages.
+/// A session runs the acquisition and the analysis of one device in-process.
+/// The frames are handed out without copies, the sample pointers stay valid
+/// until the frame is released. They are the voltages and spectra of the
+/// analysis, not the raw codes. All functions may be called from any thread,
+/// frames stay valid after openhantek_close() until they are released.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#ifdef OPENHANTEK_BUILD_EMBED
+#define OPENHANTEK_EXPORT __declspec(dllexport)
+#else
+#define OPENHANTEK_EXPORT __declspec(dllimport)
+#endif
+#else
+#define OPENHANTEK_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct openhantek_session openhantek_session; ///< A connected device with its analysis
+typedef struct openhantek_frame openhantek_frame;     ///< An analyzed frame, it is kept until it is released
+
+/// \brief Connects to a device and applies the settings.
+/// \param device The index of the ready usb device starting at 0, or "simulate:<description>" for a simulated device.
+/// \param config The settings file, the settings of the gui are used if it is NULL or empty.
+/// \return The session, NULL on failure. openhantek_last_error() has the reason.
+OPENHANTEK_EXPORT openhantek_session *openhantek_open(const char *device, const char *config);
+
+/// \brief Stops the acquisition and disconnects the device.
+/// The frames that are still held stay valid, they have to be released as well.
+OPENHANTEK_EXPORT void openhantek_close(openhantek_session *session);
+
+/// \return The reason the last openhantek_open() of the calling thread failed, as UTF-8.
+OPENHANTEK_EXPORT const char *openhantek_last_error(void);
+
+/// \return The number of physical channels, the math channel follows them.
+OPENHANTEK_EXPORT unsigned openhantek_channel_count(const openhantek_session *session);
+
+/// \brief Starts or stops the sampling.
+OPENHANTEK_EXPORT void openhantek_set_sampling(openhantek_session *session, int enabled);
+
+/// \brief Waits for an analyzed frame that is newer than the last one returned.
+/// Frames that are analyzed while the caller is busy are skipped.
+/// \param timeout The maximal wait in ms, negative to wait forever.
+/// \return The frame, NULL after the timeout. It has to be released.
+OPENHANTEK_EXPORT openhantek_frame *openhantek_next_frame(openhantek_session *session, int timeout);
+
+/// \brief Releases a frame, its memory is recycled for the next ones.
+OPENHANTEK_EXPORT void openhantek_release_frame(openhantek_frame *frame);
+
+/// \return The id of the frame, it counts the acquired frames of the session.
+OPENHANTEK_EXPORT uint64_t openhantek_frame_id(const openhantek_frame *frame);
+
+/// \return The steady clock time in ns the frame was received at.
+OPENHANTEK_EXPORT int64_t openhantek_frame_timestamp(const openhantek_frame *frame);
+
+/// \return The number of channels of the frame, including the math channel.
+OPENHANTEK_EXPORT unsigned openhantek_frame_channels(const openhantek_frame *frame);
+
+/// \brief Gets the voltages of a channel in place.
+/// In roll mode the record is a ring buffer, it is split in two spans from the oldest sample on.
+/// \param channel The channel.
+/// \param part 0 for the older span, 1 for the newer one, it is empty except in roll mode.
+/// \param count Is set to the number of samples in the span.
+/// \return The first voltage of the span in V, NULL if the span is empty or the channel doesn't exist.
+OPENHANTEK_EXPORT const double *openhantek_frame_voltage(const openhantek_frame *frame, unsigned channel,
+                                                         unsigned part, size_t *count);
+
+/// \return The time between two voltages of the channel in s.
+OPENHANTEK_EXPORT double openhantek_frame_interval(const openhantek_frame *frame, unsigned channel);
+
+/// \brief Gets the spectrum of a channel in place, see openhantek_frame_voltage().
+/// \return The first level of the span in dB, NULL if the span is empty or the channel doesn't exist.
+OPENHANTEK_EXPORT const double *openhantek_frame_spectrum(const openhantek_frame *frame, unsigned channel,
+                                                          unsigned part, size_t *count);
+
+/// \return The frequency between two spectrum bins of the channel in Hz.
+OPENHANTEK_EXPORT double openhantek_frame_bin_width(const openhantek_frame *frame, unsigned channel);
+
+/// \param measurement The index of the measurement, see Dso::Measurement.
+/// \return The automatic measurement of the channel in SI units, NaN if it is disabled or unavailable.
+OPENHANTEK_EXPORT double openhantek_frame_measurement(const openhantek_frame *frame, unsigned channel,
+                                                      unsigned measurement);
+
+#ifdef __cplusplus
+}
+#endif
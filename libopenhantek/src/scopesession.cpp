@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QStringList>
+#include <QTimer>
+#include <chrono>
+
+#include <libusb-1.0/libusb.h>
+
+#include "scopesession.h"
+
+#include "dataanalyzer.h"
+#include "hantekdsocontrol.h"
+#include "settings.h"
+#include "usb/finddevices.h"
+#include "usb/simulateddevice.h"
+#include "usb/usbdevice.h"
+#include "utils/printutils.h"
+
+namespace {
+static const int FIRMWARE_TIMEOUT = 10000; ///< The maximal wait for the restart of the devices after the upload in ms
+static const int THREAD_TIMEOUT = 10000;   ///< The maximal wait for the threads of a session to finish in ms
+const char SIMULATION_PREFIX[] = "simulate:";
+
+/// \brief Creates the application object if the embedding program has none.
+/// The threads of the session don't need an event loop in the main thread,
+/// but the settings and the translations need the application.
+void ensureApplication() {
+    if (QCoreApplication::instance()) return;
+    static int argc = 1;
+    static char name[] = "libopenhantek";
+    static char *argv[] = {name, nullptr};
+    new QCoreApplication(argc, argv);
+    QCoreApplication::setOrganizationName("OpenHantek");
+    QCoreApplication::setOrganizationDomain("www.openhantek.org");
+    QCoreApplication::setApplicationName("OpenHantek");
+}
+}
+
+ScopeSession::ScopeSession() : dsoControlThread(new QThread), dataAnalyzerThread(new QThread) {
+    dsoControlThread->setObjectName("dsoControlThread");
+    dataAnalyzerThread->setObjectName("dataAnalyzerThread");
+}
+
+ScopeSession::~ScopeSession() {
+    if (dsoControl) dsoControl->stopSampling();
+    dsoControlThread->quit();
+    dataAnalyzerThread->quit();
+    const bool finished = dsoControlThread->wait(THREAD_TIMEOUT) && dataAnalyzerThread->wait(THREAD_TIMEOUT);
+    if (!finished) {
+        // A hanging thread still uses the objects and the usb context, they are left alive instead of being
+        // destroyed under it. Destroying a running QThread would abort the program.
+        qWarning() << "The threads of the scope session didn't finish, the device is left open";
+        if (dataAnalyzer) QObject::disconnect(dataAnalyzer.get(), &DataAnalyzer::analyzed, nullptr, nullptr);
+        dataAnalyzer.release();
+        dsoControl.release();
+        device.release();
+        settings.release();
+        dsoControlThread.release();
+        dataAnalyzerThread.release();
+        return;
+    }
+
+    // The device has to be closed before its usb context
+    dataAnalyzer.reset();
+    dsoControl.reset();
+    device.reset();
+    if (context) libusb_exit(context);
+}
+
+bool ScopeSession::open(const QString &device, const QString &config, QString &errorMessage) {
+    ensureApplication();
+
+    settings = std::unique_ptr<DsoSettings>(new DsoSettings());
+    if (!config.isEmpty()) {
+        if (!settings->setFilename(config)) {
+            errorMessage = QCoreApplication::translate("", "Can't load the settings from %1").arg(config);
+            return false;
+        }
+        settings->load();
+    }
+
+    //////// Connect to the selected device, a simulated device doesn't need usb ////////
+    if (device.startsWith(SIMULATION_PREFIX)) {
+        this->device = SimulatedDevice::create(device.mid((int)sizeof(SIMULATION_PREFIX) - 1), errorMessage);
+        if (!this->device || !this->device->connectDevice(errorMessage)) return false;
+    } else {
+        bool isIndex = false;
+        const int deviceIndex = device.isEmpty() ? 0 : device.toInt(&isIndex);
+        if (!device.isEmpty() && !isIndex) {
+            errorMessage = QCoreApplication::translate("", "Unknown device %1").arg(device);
+            return false;
+        }
+        if (!context) {
+            int error = libusb_init(&context);
+            if (error) {
+                context = nullptr;
+                errorMessage =
+                    QCoreApplication::translate("", "Can't initalize USB: %1").arg(libUsbErrorString(error));
+                return false;
+            }
+        }
+        FindDevices findDevices(context);
+        QStringList warnings;
+        this->device = findDevices.connectReadyDevice(deviceIndex, FIRMWARE_TIMEOUT, warnings);
+        if (!this->device) {
+            errorMessage = findDevices.getErrorMessage();
+            return false;
+        }
+    }
+
+    //////// Create the device and the analysis in their own threads, like the gui ////////
+    dsoControl = std::unique_ptr<HantekDsoControl>(new HantekDsoControl(this->device.get()));
+    dsoControl->moveToThread(dsoControlThread.get());
+    QObject::connect(dsoControlThread.get(), &QThread::started, dsoControl.get(), &HantekDsoControl::run);
+
+    dataAnalyzer = std::unique_ptr<DataAnalyzer>(new DataAnalyzer());
+    dataAnalyzer->setSourceData(&dsoControl->getSampleBuffer());
+    dataAnalyzer->moveToThread(dataAnalyzerThread.get());
+    QObject::connect(dsoControl.get(), &HantekDsoControl::samplesAvailable, dataAnalyzer.get(),
+                     &DataAnalyzer::samplesAvailable);
+    // The frames are taken in the analyzer thread, the caller waits in nextFrame()
+    QObject::connect(dataAnalyzer.get(), &DataAnalyzer::analyzed, dataAnalyzer.get(), [this]() { analyzed(); },
+                     Qt::DirectConnection);
+
+    channelCount = dsoControl->getChannelCount();
+    settings->setChannelCount(channelCount);
+    dataAnalyzer->applySettings(&settings->scope);
+    applySettings();
+
+    dataAnalyzerThread->start();
+    dsoControlThread->start();
+    return true;
+}
+
+void ScopeSession::applySettings() {
+    if (!dsoControl) return;
+    dataAnalyzer->setMathExpression(settings->scope.mathExpression);
+    const DeviceConfiguration configuration = settings->deviceConfiguration(dsoControl->getAvailableRecordLengths());
+    HantekDsoControl *control = dsoControl.get();
+    QTimer::singleShot(0, control, [control, configuration]() { control->applyConfiguration(configuration); });
+}
+
+void ScopeSession::setSampling(bool enabled) {
+    if (!dsoControl) return;
+    if (enabled)
+        dsoControl->startSampling();
+    else
+        dsoControl->stopSampling();
+}
+
+std::shared_ptr<const DataAnalyzerResult> ScopeSession::nextFrame(int timeout) {
+    std::unique_lock<std::mutex> locker(frameMutex);
+    auto ready = [this]() { return latest != nullptr; };
+    if (timeout < 0)
+        frameAvailable.wait(locker, ready);
+    else if (!frameAvailable.wait_for(locker, std::chrono::milliseconds(timeout), ready))
+        return nullptr;
+    return std::move(latest);
+}
+
+/// \brief Keeps the newest analyzed frame, an older one that wasn't taken is recycled.
+void ScopeSession::analyzed() {
+    std::shared_ptr<const DataAnalyzerResult> result = dataAnalyzer->getNextResult();
+    if (!result) return;
+    {
+        std::lock_guard<std::mutex> locker(frameMutex);
+        latest = std::move(result);
+    }
+    frameAvailable.notify_all();
+}
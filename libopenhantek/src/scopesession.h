@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QString>
+#include <QThread>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "openhantek.h"
+
+class DataAnalyzer;
+class DataAnalyzerResult;
+class DsoSettings;
+class HantekDsoControl;
+class USBDevice;
+struct libusb_context;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ScopeSession                                           scopesession.h
+/// \brief Runs the acquisition and the analysis of a device in another program.
+/// The device and the analyzer run in their own threads like in the gui, no
+/// event loop of the calling program is needed. The analyzed frames are handed
+/// out as shared results, their samples are read in place with
+/// SampleValues::span() and the result isn't recycled while it is referenced.
+class OPENHANTEK_EXPORT ScopeSession {
+  public:
+    ScopeSession();
+    ~ScopeSession();
+
+    /// \brief Connects to a device and applies the settings to it.
+    /// \param device The index of the ready usb device starting at 0, or "simulate:<description>" for a simulated
+    /// device, see SimulatedDevice::create().
+    /// \param config The settings file, the settings of the gui are used if it is empty.
+    /// \param errorMessage Is set to the reason on failure.
+    /// \return false, if the device can't be used.
+    bool open(const QString &device, const QString &config, QString &errorMessage);
+
+    /// \return The settings of the session, they aren't saved.
+    DsoSettings *getSettings() { return settings.get(); }
+
+    /// \brief Applies changed settings to the device and the analysis.
+    void applySettings();
+
+    /// \return The number of physical channels, 0 before the device is opened.
+    unsigned getChannelCount() const { return channelCount; }
+
+    /// \brief Starts or stops the sampling.
+    void setSampling(bool enabled);
+
+    /// \brief Waits for an analyzed frame that is newer than the last one returned.
+    /// \param timeout The maximal wait in ms, negative to wait forever.
+    /// \return The frame, nullptr after the timeout.
+    std::shared_ptr<const DataAnalyzerResult> nextFrame(int timeout);
+
+  private:
+    void analyzed();
+
+    libusb_context *context = nullptr; ///< The usb context of the device, nullptr for a simulated device
+    std::unique_ptr<DsoSettings> settings;
+    std::unique_ptr<USBDevice> device;
+    std::unique_ptr<HantekDsoControl> dsoControl;
+    std::unique_ptr<DataAnalyzer> dataAnalyzer;
+    std::unique_ptr<QThread> dsoControlThread;
+    std::unique_ptr<QThread> dataAnalyzerThread;
+    unsigned channelCount = 0;
+
+    std::mutex frameMutex;                            ///< The analyzer thread hands over the frames
+    std::condition_variable frameAvailable;           ///< Signals a new frame to nextFrame()
+    std::shared_ptr<const DataAnalyzerResult> latest; ///< The newest analyzed frame, nullptr after it was taken
+};
@@ -0,0 +1,1030 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "analysiskernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANALYSIS_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(ANALYSIS_KERNELS_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ANALYSIS_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define ANALYSIS_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Analysis {
+
+namespace {
+
+// The logarithm splits the value into exponent and mantissa, the mantissa is
+// normalized to [sqrt(0.5), sqrt(2)) and ln(m) = 2 * atanh((m - 1) / (m + 1))
+// is evaluated with five terms of its series. |t| is at most 0.172, so the
+// first omitted term is below 1e-8.
+
+const double LOG10_2 = 0.30102999566398119521;
+const double LOG10_E = 0.43429448190325182765;
+const double SQRT_2 = 1.41421356237309504880;
+const uint64_t MANTISSA_MASK = 0x000fffffffffffffULL;
+const uint64_t EXPONENT_ONE = 0x3ff0000000000000ULL;
+
+/// \brief Evaluates ln(m) for m in [sqrt(0.5), sqrt(2)).
+inline double logMantissa(double t) {
+    const double t2 = t * t;
+    return 2.0 * t * (1.0 + t2 * (1.0 / 3 + t2 * (1.0 / 5 + t2 * (1.0 / 7 + t2 * (1.0 / 9)))));
+}
+
+inline double log10Scalar(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    double exponent = (double)((int)((bits >> 52) & 0x7ff) - 1023);
+    bits = (bits & MANTISSA_MASK) | EXPONENT_ONE;
+    double mantissa;
+    std::memcpy(&mantissa, &bits, sizeof(mantissa));
+    if (mantissa >= SQRT_2) {
+        mantissa *= 0.5;
+        exponent += 1.0;
+    }
+    return exponent * LOG10_2 + logMantissa((mantissa - 1.0) / (mantissa + 1.0)) * LOG10_E;
+}
+
+SampleStatistics finishStatistics(double minimum, double maximum, double sum, double squareSum, unsigned count) {
+    SampleStatistics statistics;
+    statistics.minimum = minimum;
+    statistics.maximum = maximum;
+    statistics.mean = sum / count;
+    statistics.rms = std::sqrt(squareSum / count);
+    return statistics;
+}
+
+#if !defined(ANALYSIS_KERNELS_SSE2) && !defined(ANALYSIS_KERNELS_NEON)
+// Only selected without vector kernels, those handle their tails inline
+SampleStatistics statisticsScalar(const double *samples, unsigned count) {
+    double minimum = samples[0], maximum = samples[0], sum = 0.0, squareSum = 0.0;
+    for (unsigned index = 0; index < count; ++index) {
+        const double value = samples[index];
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+        sum += value;
+        squareSum += value * value;
+    }
+    return finishStatistics(minimum, maximum, sum, squareSum, count);
+}
+#endif
+
+void powerScalar(const double *bins, unsigned count, double factor, double *power, double *decibel, double offset,
+                 double limit) {
+    for (unsigned index = 0; index < count; ++index) {
+        const double real = bins[2 * index];
+        const double imaginary = bins[2 * index + 1];
+        power[index] = (real * real + imaginary * imaginary) * factor;
+        if (decibel) decibel[index] = std::max(10.0 * log10Scalar(power[index]) + offset, limit);
+    }
+}
+
+void scaledSumScalar(const double *first, const double *second, double firstFactor, double secondFactor,
+                     double *result, unsigned count) {
+    for (unsigned index = 0; index < count; ++index)
+        result[index] = first[index] * firstFactor + second[index] * secondFactor;
+}
+
+void productScalar(const double *first, const double *second, double factor, double *result, unsigned count) {
+    for (unsigned index = 0; index < count; ++index) result[index] = first[index] * second[index] * factor;
+}
+
+void absoluteScalar(const double *samples, double factor, double *result, unsigned count) {
+    for (unsigned index = 0; index < count; ++index) result[index] = std::fabs(samples[index]) * factor;
+}
+
+void quantizeScalar(const float *values, float factor, float offset, int limit, int *result, unsigned count) {
+    for (unsigned index = 0; index < count; ++index) {
+        // The shift by one bin makes the truncation a floor, like in the vector kernels
+        const float bin = values[index] * factor + (offset + 1.0f);
+        result[index] = (bin >= 0.0f) ? (int)std::min(bin, (float)limit + 1.0f) - 1 : -1;
+    }
+}
+
+void multiplyAddScalar(const float *samples, float factor, float *result, unsigned count) {
+    for (unsigned index = 0; index < count; ++index) result[index] += samples[index] * factor;
+}
+
+void levelScalar(const double *power, unsigned count, double *decibel, double offset, double limit) {
+    for (unsigned index = 0; index < count; ++index)
+        decibel[index] = std::max(10.0 * log10Scalar(power[index]) + offset, limit);
+}
+
+void holdScalar(const double *samples, bool maximum, double *result, unsigned count) {
+    if (maximum) {
+        for (unsigned index = 0; index < count; ++index) result[index] = std::max(result[index], samples[index]);
+    } else {
+        for (unsigned index = 0; index < count; ++index) result[index] = std::min(result[index], samples[index]);
+    }
+}
+
+double dotScalar(const double *first, const double *second, unsigned count) {
+    double sum = 0.0;
+    for (unsigned index = 0; index < count; ++index) sum += first[index] * second[index];
+    return sum;
+}
+
+void complexProductScalar(const double *first, const double *second, double *result, unsigned count) {
+    for (unsigned index = 0; index < 2 * count; index += 2) {
+        const double real = first[index] * second[index] - first[index + 1] * second[index + 1];
+        const double imaginary = first[index] * second[index + 1] + first[index + 1] * second[index];
+        result[index] = real;
+        result[index + 1] = imaginary;
+    }
+}
+
+unsigned findOutsideScalar(const double *samples, double lower, double upper, bool inverted, unsigned count) {
+    for (unsigned index = 0; index < count; ++index) {
+        const bool outside = samples[index] < lower || samples[index] > upper;
+        if (outside != inverted) return index;
+    }
+    return count;
+}
+
+#ifdef ANALYSIS_KERNELS_SSE2
+/// \brief Approximates log10 of two positive values.
+inline __m128d log10Sse2(__m128d value) {
+    const __m128i bits = _mm_castpd_si128(value);
+    // The biased exponents are in the lower halves of the 64 bit lanes
+    const __m128i biased = _mm_srli_epi64(bits, 52);
+    __m128d exponent = _mm_sub_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(biased, 0x08)), _mm_set1_pd(1023.0));
+    __m128d mantissa = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi64x(MANTISSA_MASK)),
+                                                     _mm_set1_epi64x(EXPONENT_ONE)));
+
+    const __m128d large = _mm_cmpge_pd(mantissa, _mm_set1_pd(SQRT_2));
+    mantissa = _mm_or_pd(_mm_and_pd(large, _mm_mul_pd(mantissa, _mm_set1_pd(0.5))), _mm_andnot_pd(large, mantissa));
+    exponent = _mm_add_pd(exponent, _mm_and_pd(large, _mm_set1_pd(1.0)));
+
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d t = _mm_div_pd(_mm_sub_pd(mantissa, one), _mm_add_pd(mantissa, one));
+    const __m128d t2 = _mm_mul_pd(t, t);
+    __m128d series = _mm_add_pd(_mm_set1_pd(1.0 / 7), _mm_mul_pd(t2, _mm_set1_pd(1.0 / 9)));
+    series = _mm_add_pd(_mm_set1_pd(1.0 / 5), _mm_mul_pd(t2, series));
+    series = _mm_add_pd(_mm_set1_pd(1.0 / 3), _mm_mul_pd(t2, series));
+    series = _mm_add_pd(one, _mm_mul_pd(t2, series));
+    const __m128d logMantissa = _mm_mul_pd(_mm_mul_pd(_mm_set1_pd(2.0), t), series);
+
+    return _mm_add_pd(_mm_mul_pd(exponent, _mm_set1_pd(LOG10_2)), _mm_mul_pd(logMantissa, _mm_set1_pd(LOG10_E)));
+}
+
+SampleStatistics statisticsSse2(const double *samples, unsigned count) {
+    __m128d minimum = _mm_set1_pd(samples[0]), maximum = minimum;
+    __m128d sum = _mm_setzero_pd(), squareSum = _mm_setzero_pd();
+    unsigned index = 0;
+    for (; index + 2 <= count; index += 2) {
+        const __m128d value = _mm_loadu_pd(samples + index);
+        minimum = _mm_min_pd(minimum, value);
+        maximum = _mm_max_pd(maximum, value);
+        sum = _mm_add_pd(sum, value);
+        squareSum = _mm_add_pd(squareSum, _mm_mul_pd(value, value));
+    }
+
+    double lanes[2][4];
+    _mm_storeu_pd(lanes[0], minimum);
+    _mm_storeu_pd(lanes[0] + 2, maximum);
+    _mm_storeu_pd(lanes[1], sum);
+    _mm_storeu_pd(lanes[1] + 2, squareSum);
+    double minimumValue = std::min(lanes[0][0], lanes[0][1]), maximumValue = std::max(lanes[0][2], lanes[0][3]);
+    double sumValue = lanes[1][0] + lanes[1][1], squareSumValue = lanes[1][2] + lanes[1][3];
+
+    for (; index < count; ++index) {
+        const double value = samples[index];
+        minimumValue = std::min(minimumValue, value);
+        maximumValue = std::max(maximumValue, value);
+        sumValue += value;
+        squareSumValue += value * value;
+    }
+    return finishStatistics(minimumValue, maximumValue, sumValue, squareSumValue, count);
+}
+
+void powerSse2(const double *bins, unsigned count, double factor, double *power, double *decibel, double offset,
+               double limit) {
+    const __m128d factorVector = _mm_set1_pd(factor);
+    const __m128d offsetVector = _mm_set1_pd(offset);
+    const __m128d limitVector = _mm_set1_pd(limit);
+    const __m128d ten = _mm_set1_pd(10.0);
+    unsigned index = 0;
+
+    for (; index + 2 <= count; index += 2) {
+        const __m128d first = _mm_loadu_pd(bins + 2 * index);
+        const __m128d second = _mm_loadu_pd(bins + 2 * index + 2);
+        const __m128d squaredFirst = _mm_mul_pd(first, first);
+        const __m128d squaredSecond = _mm_mul_pd(second, second);
+        // Add real and imaginary squares of both bins
+        const __m128d sum = _mm_add_pd(_mm_unpacklo_pd(squaredFirst, squaredSecond),
+                                       _mm_unpackhi_pd(squaredFirst, squaredSecond));
+        const __m128d value = _mm_mul_pd(sum, factorVector);
+        _mm_storeu_pd(power + index, value);
+        if (decibel)
+            _mm_storeu_pd(decibel + index,
+                          _mm_max_pd(_mm_add_pd(_mm_mul_pd(log10Sse2(value), ten), offsetVector), limitVector));
+    }
+
+    powerScalar(bins + 2 * index, count - index, factor, power + index, decibel ? decibel + index : nullptr, offset,
+                limit);
+}
+
+void scaledSumSse2(const double *first, const double *second, double firstFactor, double secondFactor,
+                   double *result, unsigned count) {
+    const __m128d firstVector = _mm_set1_pd(firstFactor);
+    const __m128d secondVector = _mm_set1_pd(secondFactor);
+    unsigned index = 0;
+    for (; index + 2 <= count; index += 2)
+        _mm_storeu_pd(result + index, _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(first + index), firstVector),
+                                                 _mm_mul_pd(_mm_loadu_pd(second + index), secondVector)));
+    scaledSumScalar(first + index, second + index, firstFactor, secondFactor, result + index, count - index);
+}
+
+void productSse2(const double *first, const double *second, double factor, double *result, unsigned count) {
+    const __m128d factorVector = _mm_set1_pd(factor);
+    unsigned index = 0;
+    for (; index + 2 <= count; index += 2)
+        _mm_storeu_pd(result + index,
+                      _mm_mul_pd(_mm_mul_pd(_mm_loadu_pd(first + index), _mm_loadu_pd(second + index)), factorVector));
+    productScalar(first + index, second + index, factor, result + index, count - index);
+}
+
+void absoluteSse2(const double *samples, double factor, double *result, unsigned count) {
+    // Clearing the sign bit is the absolute value
+    const __m128d mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+    const __m128d factorVector = _mm_set1_pd(factor);
+    unsigned index = 0;
+    for (; index + 2 <= count; index += 2)
+        _mm_storeu_pd(result + index, _mm_mul_pd(_mm_and_pd(_mm_loadu_pd(samples + index), mask), factorVector));
+    absoluteScalar(samples + index, factor, result + index, count - index);
+}
+
+void quantizeSse2(const float *values, float factor, float offset, int limit, int *result, unsigned count) {
+    // Shifting by one bin makes the truncation a floor, max() replaces NaN with the second operand
+    const __m128 factorVector = _mm_set1_ps(factor);
+    const __m128 offsetVector = _mm_set1_ps(offset + 1.0f);
+    const __m128 lower = _mm_set1_ps(0.0f);
+    const __m128 upper = _mm_set1_ps((float)limit + 1.0f);
+    const __m128i one = _mm_set1_epi32(1);
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4) {
+        const __m128 bin = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(values + index), factorVector), offsetVector);
+        const __m128 limited = _mm_min_ps(_mm_max_ps(bin, lower), upper);
+        _mm_storeu_si128((__m128i *)(result + index), _mm_sub_epi32(_mm_cvttps_epi32(limited), one));
+    }
+    quantizeScalar(values + index, factor, offset, limit, result + index, count - index);
+}
+
+void multiplyAddSse2(const float *samples, float factor, float *result, unsigned count) {
+    const __m128 factorVector = _mm_set1_ps(factor);
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4)
+        _mm_storeu_ps(result + index, _mm_add_ps(_mm_loadu_ps(result + index),
+                                                 _mm_mul_ps(_mm_loadu_ps(samples + index), factorVector)));
+    multiplyAddScalar(samples + index, factor, result + index, count - index);
+}
+
+void levelSse2(const double *power, unsigned count, double *decibel, double offset, double limit) {
+    const __m128d offsetVector = _mm_set1_pd(offset);
+    const __m128d limitVector = _mm_set1_pd(limit);
+    const __m128d ten = _mm_set1_pd(10.0);
+    unsigned index = 0;
+    for (; index + 2 <= count; index += 2)
+        _mm_storeu_pd(decibel + index, _mm_max_pd(_mm_add_pd(_mm_mul_pd(log10Sse2(_mm_loadu_pd(power + index)), ten),
+                                                             offsetVector),
+                                                  limitVector));
+    levelScalar(power + index, count - index, decibel + index, offset, limit);
+}
+
+void holdSse2(const double *samples, bool maximum, double *result, unsigned count) {
+    unsigned index = 0;
+    if (maximum) {
+        for (; index + 2 <= count; index += 2)
+            _mm_storeu_pd(result + index, _mm_max_pd(_mm_loadu_pd(result + index), _mm_loadu_pd(samples + index)));
+    } else {
+        for (; index + 2 <= count; index += 2)
+            _mm_storeu_pd(result + index, _mm_min_pd(_mm_loadu_pd(result + index), _mm_loadu_pd(samples + index)));
+    }
+    holdScalar(samples + index, maximum, result + index, count - index);
+}
+
+double dotSse2(const double *first, const double *second, unsigned count) {
+    // Two accumulators hide the latency of the additions
+    __m128d sums[2] = {_mm_setzero_pd(), _mm_setzero_pd()};
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4) {
+        sums[0] = _mm_add_pd(sums[0], _mm_mul_pd(_mm_loadu_pd(first + index), _mm_loadu_pd(second + index)));
+        sums[1] = _mm_add_pd(sums[1], _mm_mul_pd(_mm_loadu_pd(first + index + 2), _mm_loadu_pd(second + index + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sums[0], sums[1]));
+    return lanes[0] + lanes[1] + dotScalar(first + index, second + index, count - index);
+}
+
+void complexProductSse2(const double *first, const double *second, double *result, unsigned count) {
+    // (a + bi)(c + di) = (ac - bd) + (bc + ad)i, the sign flip of bd makes it a sum of two products
+    const __m128d sign = _mm_set_pd(0.0, -0.0);
+    for (unsigned index = 0; index < 2 * count; index += 2) {
+        const __m128d value = _mm_loadu_pd(first + index);
+        const __m128d factor = _mm_loadu_pd(second + index);
+        const __m128d real = _mm_mul_pd(value, _mm_unpacklo_pd(factor, factor));
+        const __m128d imaginary = _mm_mul_pd(_mm_shuffle_pd(value, value, 1), _mm_unpackhi_pd(factor, factor));
+        _mm_storeu_pd(result + index, _mm_add_pd(real, _mm_xor_pd(imaginary, sign)));
+    }
+}
+
+unsigned findOutsideSse2(const double *samples, double lower, double upper, bool inverted, unsigned count) {
+    const __m128d lowerVector = _mm_set1_pd(lower);
+    const __m128d upperVector = _mm_set1_pd(upper);
+    const int flip = inverted ? 0xf : 0;
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4) {
+        const __m128d first = _mm_loadu_pd(samples + index);
+        const __m128d second = _mm_loadu_pd(samples + index + 2);
+        int mask = (_mm_movemask_pd(_mm_or_pd(_mm_cmplt_pd(first, lowerVector), _mm_cmpgt_pd(first, upperVector))) |
+                    _mm_movemask_pd(_mm_or_pd(_mm_cmplt_pd(second, lowerVector), _mm_cmpgt_pd(second, upperVector)))
+                        << 2) ^
+                   flip;
+        if (mask == 0) continue;
+        // The lowest set bit is the first sample
+        for (; (mask & 1) == 0; mask >>= 1) ++index;
+        return index;
+    }
+    return index + findOutsideScalar(samples + index, lower, upper, inverted, count - index);
+}
+#endif
+
+#ifdef ANALYSIS_KERNELS_AVX2
+/// \brief Approximates log10 of four positive values.
+__attribute__((target("avx2"))) inline __m256d log10Avx2(__m256d value) {
+    const __m256i bits = _mm256_castpd_si256(value);
+    // Gather the biased exponents from the lower halves of the 64 bit lanes
+    const __m256i biased =
+        _mm256_permutevar8x32_epi32(_mm256_srli_epi64(bits, 52), _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0));
+    __m256d exponent = _mm256_sub_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(biased)), _mm256_set1_pd(1023.0));
+    __m256d mantissa = _mm256_castsi256_pd(_mm256_or_si256(
+        _mm256_and_si256(bits, _mm256_set1_epi64x(MANTISSA_MASK)), _mm256_set1_epi64x(EXPONENT_ONE)));
+
+    const __m256d large = _mm256_cmp_pd(mantissa, _mm256_set1_pd(SQRT_2), _CMP_GE_OQ);
+    mantissa = _mm256_blendv_pd(mantissa, _mm256_mul_pd(mantissa, _mm256_set1_pd(0.5)), large);
+    exponent = _mm256_add_pd(exponent, _mm256_and_pd(large, _mm256_set1_pd(1.0)));
+
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d t = _mm256_div_pd(_mm256_sub_pd(mantissa, one), _mm256_add_pd(mantissa, one));
+    const __m256d t2 = _mm256_mul_pd(t, t);
+    __m256d series = _mm256_add_pd(_mm256_set1_pd(1.0 / 7), _mm256_mul_pd(t2, _mm256_set1_pd(1.0 / 9)));
+    series = _mm256_add_pd(_mm256_set1_pd(1.0 / 5), _mm256_mul_pd(t2, series));
+    series = _mm256_add_pd(_mm256_set1_pd(1.0 / 3), _mm256_mul_pd(t2, series));
+    series = _mm256_add_pd(one, _mm256_mul_pd(t2, series));
+    const __m256d logMantissa = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), t), series);
+
+    return _mm256_add_pd(_mm256_mul_pd(exponent, _mm256_set1_pd(LOG10_2)),
+                         _mm256_mul_pd(logMantissa, _mm256_set1_pd(LOG10_E)));
+}
+
+__attribute__((target("avx2"))) SampleStatistics statisticsAvx2(const double *samples, unsigned count) {
+    __m256d minimum = _mm256_set1_pd(samples[0]), maximum = minimum;
+    __m256d sum = _mm256_setzero_pd(), squareSum = _mm256_setzero_pd();
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4) {
+        const __m256d value = _mm256_loadu_pd(samples + index);
+        minimum = _mm256_min_pd(minimum, value);
+        maximum = _mm256_max_pd(maximum, value);
+        sum = _mm256_add_pd(sum, value);
+        squareSum = _mm256_add_pd(squareSum, _mm256_mul_pd(value, value));
+    }
+
+    double lanes[4][4];
+    _mm256_storeu_pd(lanes[0], minimum);
+    _mm256_storeu_pd(lanes[1], maximum);
+    _mm256_storeu_pd(lanes[2], sum);
+    _mm256_storeu_pd(lanes[3], squareSum);
+    double minimumValue = std::min(std::min(lanes[0][0], lanes[0][1]), std::min(lanes[0][2], lanes[0][3]));
+    double maximumValue = std::max(std::max(lanes[1][0], lanes[1][1]), std::max(lanes[1][2], lanes[1][3]));
+    double sumValue = (lanes[2][0] + lanes[2][1]) + (lanes[2][2] + lanes[2][3]);
+    double squareSumValue = (lanes[3][0] + lanes[3][1]) + (lanes[3][2] + lanes[3][3]);
+
+    for (; index < count; ++index) {
+        const double value = samples[index];
+        minimumValue = std::min(minimumValue, value);
+        maximumValue = std::max(maximumValue, value);
+        sumValue += value;
+        squareSumValue += value * value;
+    }
+    return finishStatistics(minimumValue, maximumValue, sumValue, squareSumValue, count);
+}
+
+__attribute__((target("avx2"))) void powerAvx2(const double *bins, unsigned count, double factor, double *power,
+                                               double *decibel, double offset, double limit) {
+    const __m256d factorVector = _mm256_set1_pd(factor);
+    const __m256d offsetVector = _mm256_set1_pd(offset);
+    const __m256d limitVector = _mm256_set1_pd(limit);
+    const __m256d ten = _mm256_set1_pd(10.0);
+    unsigned index = 0;
+
+    for (; index + 4 <= count; index += 4) {
+        const __m256d first = _mm256_loadu_pd(bins + 2 * index);
+        const __m256d second = _mm256_loadu_pd(bins + 2 * index + 4);
+        // The horizontal add yields the bins in the order 0, 2, 1, 3
+        const __m256d sum = _mm256_hadd_pd(_mm256_mul_pd(first, first), _mm256_mul_pd(second, second));
+        const __m256d value = _mm256_mul_pd(_mm256_permute4x64_pd(sum, 0xd8), factorVector);
+        _mm256_storeu_pd(power + index, value);
+        if (decibel)
+            _mm256_storeu_pd(decibel + index,
+                             _mm256_max_pd(_mm256_add_pd(_mm256_mul_pd(log10Avx2(value), ten), offsetVector),
+                                           limitVector));
+    }
+
+    powerScalar(bins + 2 * index, count - index, factor, power + index, decibel ? decibel + index : nullptr, offset,
+                limit);
+}
+
+__attribute__((target("avx2"))) void scaledSumAvx2(const double *first, const double *second, double firstFactor,
+                                                   double secondFactor, double *result, unsigned count) {
+    const __m256d firstVector = _mm256_set1_pd(firstFactor);
+    const __m256d secondVector = _mm256_set1_pd(secondFactor);
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4)
+        _mm256_storeu_pd(result + index, _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(first + index), firstVector),
+                                                       _mm256_mul_pd(_mm256_loadu_pd(second + index), secondVector)));
+    scaledSumScalar(first + index, second + index, firstFactor, secondFactor, result + index, count - index);
+}
+
+__attribute__((target("avx2"))) void productAvx2(const double *first, const double *second, double factor,
+                                                 double *result, unsigned count) {
+    const __m256d factorVector = _mm256_set1_pd(factor);
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4)
+        _mm256_storeu_pd(result + index, _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(first + index),
+                                                                     _mm256_loadu_pd(second + index)),
+                                                       factorVector));
+    productScalar(first + index, second + index, factor, result + index, count - index);
+}
+
+__attribute__((target("avx2"))) void absoluteAvx2(const double *samples, double factor, double *result,
+                                                  unsigned count) {
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    const __m256d factorVector = _mm256_set1_pd(factor);
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4)
+        _mm256_storeu_pd(result + index,
+                         _mm256_mul_pd(_mm256_and_pd(_mm256_loadu_pd(samples + index), mask), factorVector));
+    absoluteScalar(samples + index, factor, result + index, count - index);
+}
+
+__attribute__((target("avx2"))) void quantizeAvx2(const float *values, float factor, float offset, int limit,
+                                                  int *result, unsigned count) {
+    const __m256 factorVector = _mm256_set1_ps(factor);
+    const __m256 offsetVector = _mm256_set1_ps(offset + 1.0f);
+    const __m256 lower = _mm256_set1_ps(0.0f);
+    const __m256 upper = _mm256_set1_ps((float)limit + 1.0f);
+    const __m256i one = _mm256_set1_epi32(1);
+    unsigned index = 0;
+    for (; index + 8 <= count; index += 8) {
+        const __m256 bin = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(values + index), factorVector), offsetVector);
+        const __m256 limited = _mm256_min_ps(_mm256_max_ps(bin, lower), upper);
+        _mm256_storeu_si256((__m256i *)(result + index), _mm256_sub_epi32(_mm256_cvttps_epi32(limited), one));
+    }
+    quantizeScalar(values + index, factor, offset, limit, result + index, count - index);
+}
+
+__attribute__((target("avx2"))) void multiplyAddAvx2(const float *samples, float factor, float *result,
+                                                     unsigned count) {
+    // No fused multiply-add, so the results are the same as with the other kernels
+    const __m256 factorVector = _mm256_set1_ps(factor);
+    unsigned index = 0;
+    for (; index + 8 <= count; index += 8)
+        _mm256_storeu_ps(result + index, _mm256_add_ps(_mm256_loadu_ps(result + index),
+                                                       _mm256_mul_ps(_mm256_loadu_ps(samples + index), factorVector)));
+    multiplyAddScalar(samples + index, factor, result + index, count - index);
+}
+
+__attribute__((target("avx2"))) void levelAvx2(const double *power, unsigned count, double *decibel, double offset,
+                                               double limit) {
+    const __m256d offsetVector = _mm256_set1_pd(offset);
+    const __m256d limitVector = _mm256_set1_pd(limit);
+    const __m256d ten = _mm256_set1_pd(10.0);
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4)
+        _mm256_storeu_pd(decibel + index,
+                         _mm256_max_pd(_mm256_add_pd(_mm256_mul_pd(log10Avx2(_mm256_loadu_pd(power + index)), ten),
+                                                     offsetVector),
+                                       limitVector));
+    levelScalar(power + index, count - index, decibel + index, offset, limit);
+}
+
+__attribute__((target("avx2"))) void holdAvx2(const double *samples, bool maximum, double *result, unsigned count) {
+    unsigned index = 0;
+    if (maximum) {
+        for (; index + 4 <= count; index += 4)
+            _mm256_storeu_pd(result + index,
+                             _mm256_max_pd(_mm256_loadu_pd(result + index), _mm256_loadu_pd(samples + index)));
+    } else {
+        for (; index + 4 <= count; index += 4)
+            _mm256_storeu_pd(result + index,
+                             _mm256_min_pd(_mm256_loadu_pd(result + index), _mm256_loadu_pd(samples + index)));
+    }
+    holdScalar(samples + index, maximum, result + index, count - index);
+}
+
+__attribute__((target("avx2"))) double dotAvx2(const double *first, const double *second, unsigned count) {
+    __m256d sums[2] = {_mm256_setzero_pd(), _mm256_setzero_pd()};
+    unsigned index = 0;
+    for (; index + 8 <= count; index += 8) {
+        sums[0] =
+            _mm256_add_pd(sums[0], _mm256_mul_pd(_mm256_loadu_pd(first + index), _mm256_loadu_pd(second + index)));
+        sums[1] = _mm256_add_pd(sums[1],
+                                _mm256_mul_pd(_mm256_loadu_pd(first + index + 4), _mm256_loadu_pd(second + index + 4)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sums[0], sums[1]));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dotScalar(first + index, second + index, count - index);
+}
+
+__attribute__((target("avx2"))) void complexProductAvx2(const double *first, const double *second, double *result,
+                                                        unsigned count) {
+    const __m256d sign = _mm256_set_pd(0.0, -0.0, 0.0, -0.0);
+    unsigned index = 0;
+    for (; index + 2 <= count; index += 2) {
+        const __m256d value = _mm256_loadu_pd(first + 2 * index);
+        const __m256d factor = _mm256_loadu_pd(second + 2 * index);
+        const __m256d real = _mm256_mul_pd(value, _mm256_movedup_pd(factor));
+        const __m256d imaginary = _mm256_mul_pd(_mm256_permute_pd(value, 0x5), _mm256_permute_pd(factor, 0xf));
+        _mm256_storeu_pd(result + 2 * index, _mm256_add_pd(real, _mm256_xor_pd(imaginary, sign)));
+    }
+    complexProductScalar(first + 2 * index, second + 2 * index, result + 2 * index, count - index);
+}
+
+__attribute__((target("avx2"))) unsigned findOutsideAvx2(const double *samples, double lower, double upper,
+                                                         bool inverted, unsigned count) {
+    const __m256d lowerVector = _mm256_set1_pd(lower);
+    const __m256d upperVector = _mm256_set1_pd(upper);
+    const int flip = inverted ? 0xff : 0;
+    unsigned index = 0;
+    for (; index + 8 <= count; index += 8) {
+        const __m256d first = _mm256_loadu_pd(samples + index);
+        const __m256d second = _mm256_loadu_pd(samples + index + 4);
+        const __m256d firstOutside = _mm256_or_pd(_mm256_cmp_pd(first, lowerVector, _CMP_LT_OQ),
+                                                  _mm256_cmp_pd(first, upperVector, _CMP_GT_OQ));
+        const __m256d secondOutside = _mm256_or_pd(_mm256_cmp_pd(second, lowerVector, _CMP_LT_OQ),
+                                                   _mm256_cmp_pd(second, upperVector, _CMP_GT_OQ));
+        const int mask = (_mm256_movemask_pd(firstOutside) | _mm256_movemask_pd(secondOutside) << 4) ^ flip;
+        if (mask) return index + (unsigned)__builtin_ctz((unsigned)mask);
+    }
+    return index + findOutsideScalar(samples + index, lower, upper, inverted, count - index);
+}
+#endif
+
+#ifdef ANALYSIS_KERNELS_NEON
+/// \brief Approximates log10 of two positive values.
+inline float64x2_t log10Neon(float64x2_t value) {
+    const uint64x2_t bits = vreinterpretq_u64_f64(value);
+    float64x2_t exponent = vsubq_f64(vcvtq_f64_u64(vshrq_n_u64(bits, 52)), vdupq_n_f64(1023.0));
+    float64x2_t mantissa =
+        vreinterpretq_f64_u64(vorrq_u64(vandq_u64(bits, vdupq_n_u64(MANTISSA_MASK)), vdupq_n_u64(EXPONENT_ONE)));
+
+    const uint64x2_t large = vcgeq_f64(mantissa, vdupq_n_f64(SQRT_2));
+    mantissa = vbslq_f64(large, vmulq_n_f64(mantissa, 0.5), mantissa);
+    exponent = vaddq_f64(exponent, vreinterpretq_f64_u64(vandq_u64(large, vreinterpretq_u64_f64(vdupq_n_f64(1.0)))));
+
+    const float64x2_t one = vdupq_n_f64(1.0);
+    const float64x2_t t = vdivq_f64(vsubq_f64(mantissa, one), vaddq_f64(mantissa, one));
+    const float64x2_t t2 = vmulq_f64(t, t);
+    float64x2_t series = vfmaq_f64(vdupq_n_f64(1.0 / 7), t2, vdupq_n_f64(1.0 / 9));
+    series = vfmaq_f64(vdupq_n_f64(1.0 / 5), t2, series);
+    series = vfmaq_f64(vdupq_n_f64(1.0 / 3), t2, series);
+    series = vfmaq_f64(one, t2, series);
+    const float64x2_t logMantissa = vmulq_f64(vmulq_n_f64(t, 2.0), series);
+
+    return vaddq_f64(vmulq_n_f64(exponent, LOG10_2), vmulq_n_f64(logMantissa, LOG10_E));
+}
+
+SampleStatistics statisticsNeon(const double *samples, unsigned count) {
+    float64x2_t minimum = vdupq_n_f64(samples[0]), maximum = minimum;
+    float64x2_t sum = vdupq_n_f64(0.0), squareSum = sum;
+    unsigned index = 0;
+    for (; index + 2 <= count; index += 2) {
+        const float64x2_t value = vld1q_f64(samples + index);
+        minimum = vminq_f64(minimum, value);
+        maximum = vmaxq_f64(maximum, value);
+        sum = vaddq_f64(sum, value);
+        squareSum = vfmaq_f64(squareSum, value, value);
+    }
+
+    double minimumValue = vminvq_f64(minimum), maximumValue = vmaxvq_f64(maximum);
+    double sumValue = vaddvq_f64(sum), squareSumValue = vaddvq_f64(squareSum);
+    for (; index < count; ++index) {
+        const double value = samples[index];
+        minimumValue = std::min(minimumValue, value);
+        maximumValue = std::max(maximumValue, value);
+        sumValue += value;
+        squareSumValue += value * value;
+    }
+    return finishStatistics(minimumValue, maximumValue, sumValue, squareSumValue, count);
+}
+
+void powerNeon(const double *bins, unsigned count, double factor, double *power, double *decibel, double offset,
+               double limit) {
+    const float64x2_t offsetVector = vdupq_n_f64(offset);
+    const float64x2_t limitVector = vdupq_n_f64(limit);
+    unsigned index = 0;
+
+    for (; index + 2 <= count; index += 2) {
+        // De-interleave the real and imaginary parts of two bins
+        const float64x2x2_t values = vld2q_f64(bins + 2 * index);
+        const float64x2_t value =
+            vmulq_n_f64(vfmaq_f64(vmulq_f64(values.val[0], values.val[0]), values.val[1], values.val[1]), factor);
+        vst1q_f64(power + index, value);
+        if (decibel)
+            vst1q_f64(decibel + index, vmaxq_f64(vfmaq_n_f64(offsetVector, log10Neon(value), 10.0), limitVector));
+    }
+
+    powerScalar(bins + 2 * index, count - index, factor, power + index, decibel ? decibel + index : nullptr, offset,
+                limit);
+}
+
+void scaledSumNeon(const double *first, const double *second, double firstFactor, double secondFactor,
+                   double *result, unsigned count) {
+    unsigned index = 0;
+    for (; index + 2 <= count; index += 2)
+        vst1q_f64(result + index, vfmaq_n_f64(vmulq_n_f64(vld1q_f64(first + index), firstFactor),
+                                              vld1q_f64(second + index), secondFactor));
+    scaledSumScalar(first + index, second + index, firstFactor, secondFactor, result + index, count - index);
+}
+
+void productNeon(const double *first, const double *second, double factor, double *result, unsigned count) {
+    unsigned index = 0;
+    for (; index + 2 <= count; index += 2)
+        vst1q_f64(result + index, vmulq_n_f64(vmulq_f64(vld1q_f64(first + index), vld1q_f64(second + index)), factor));
+    productScalar(first + index, second + index, factor, result + index, count - index);
+}
+
+void absoluteNeon(const double *samples, double factor, double *result, unsigned count) {
+    unsigned index = 0;
+    for (; index + 2 <= count; index += 2)
+        vst1q_f64(result + index, vmulq_n_f64(vabsq_f64(vld1q_f64(samples + index)), factor));
+    absoluteScalar(samples + index, factor, result + index, count - index);
+}
+
+void quantizeNeon(const float *values, float factor, float offset, int limit, int *result, unsigned count) {
+    // vmaxnm replaces NaN with the other operand
+    const float32x4_t offsetVector = vdupq_n_f32(offset + 1.0f);
+    const float32x4_t lower = vdupq_n_f32(0.0f);
+    const float32x4_t upper = vdupq_n_f32((float)limit + 1.0f);
+    const int32x4_t one = vdupq_n_s32(1);
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4) {
+        const float32x4_t bin = vmlaq_n_f32(offsetVector, vld1q_f32(values + index), factor);
+        const float32x4_t limited = vminq_f32(vmaxnmq_f32(bin, lower), upper);
+        vst1q_s32(result + index, vsubq_s32(vcvtq_s32_f32(limited), one));
+    }
+    quantizeScalar(values + index, factor, offset, limit, result + index, count - index);
+}
+
+void multiplyAddNeon(const float *samples, float factor, float *result, unsigned count) {
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4)
+        vst1q_f32(result + index,
+                  vaddq_f32(vld1q_f32(result + index), vmulq_n_f32(vld1q_f32(samples + index), factor)));
+    multiplyAddScalar(samples + index, factor, result + index, count - index);
+}
+
+void levelNeon(const double *power, unsigned count, double *decibel, double offset, double limit) {
+    const float64x2_t offsetVector = vdupq_n_f64(offset);
+    const float64x2_t limitVector = vdupq_n_f64(limit);
+    unsigned index = 0;
+    for (; index + 2 <= count; index += 2)
+        vst1q_f64(decibel + index,
+                  vmaxq_f64(vfmaq_n_f64(offsetVector, log10Neon(vld1q_f64(power + index)), 10.0), limitVector));
+    levelScalar(power + index, count - index, decibel + index, offset, limit);
+}
+
+void holdNeon(const double *samples, bool maximum, double *result, unsigned count) {
+    unsigned index = 0;
+    if (maximum) {
+        for (; index + 2 <= count; index += 2)
+            vst1q_f64(result + index, vmaxq_f64(vld1q_f64(result + index), vld1q_f64(samples + index)));
+    } else {
+        for (; index + 2 <= count; index += 2)
+            vst1q_f64(result + index, vminq_f64(vld1q_f64(result + index), vld1q_f64(samples + index)));
+    }
+    holdScalar(samples + index, maximum, result + index, count - index);
+}
+
+double dotNeon(const double *first, const double *second, unsigned count) {
+    float64x2_t sums[2] = {vdupq_n_f64(0.0), vdupq_n_f64(0.0)};
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4) {
+        sums[0] = vfmaq_f64(sums[0], vld1q_f64(first + index), vld1q_f64(second + index));
+        sums[1] = vfmaq_f64(sums[1], vld1q_f64(first + index + 2), vld1q_f64(second + index + 2));
+    }
+    return vaddvq_f64(vaddq_f64(sums[0], sums[1])) + dotScalar(first + index, second + index, count - index);
+}
+
+void complexProductNeon(const double *first, const double *second, double *result, unsigned count) {
+    unsigned index = 0;
+    for (; index + 2 <= count; index += 2) {
+        // The loads split the real and imaginary parts of two values
+        const float64x2x2_t value = vld2q_f64(first + 2 * index);
+        const float64x2x2_t factor = vld2q_f64(second + 2 * index);
+        float64x2x2_t product;
+        product.val[0] = vfmsq_f64(vmulq_f64(value.val[0], factor.val[0]), value.val[1], factor.val[1]);
+        product.val[1] = vfmaq_f64(vmulq_f64(value.val[0], factor.val[1]), value.val[1], factor.val[0]);
+        vst2q_f64(result + 2 * index, product);
+    }
+    complexProductScalar(first + 2 * index, second + 2 * index, result + 2 * index, count - index);
+}
+
+unsigned findOutsideNeon(const double *samples, double lower, double upper, bool inverted, unsigned count) {
+    const float64x2_t lowerVector = vdupq_n_f64(lower);
+    const float64x2_t upperVector = vdupq_n_f64(upper);
+    const uint64x2_t flip = vdupq_n_u64(inverted ? ~0ull : 0ull);
+    unsigned index = 0;
+    for (; index + 4 <= count; index += 4) {
+        const float64x2_t first = vld1q_f64(samples + index);
+        const float64x2_t second = vld1q_f64(samples + index + 2);
+        const uint64x2_t firstMask =
+            veorq_u64(vorrq_u64(vcltq_f64(first, lowerVector), vcgtq_f64(first, upperVector)), flip);
+        const uint64x2_t secondMask =
+            veorq_u64(vorrq_u64(vcltq_f64(second, lowerVector), vcgtq_f64(second, upperVector)), flip);
+        // Only the block with the first sample is searched again
+        if (vmaxvq_u32(vreinterpretq_u32_u64(vorrq_u64(firstMask, secondMask))))
+            return index + findOutsideScalar(samples + index, lower, upper, inverted, 4);
+    }
+    return index + findOutsideScalar(samples + index, lower, upper, inverted, count - index);
+}
+#endif
+
+typedef SampleStatistics (*StatisticsKernel)(const double *, unsigned);
+typedef void (*PowerKernel)(const double *, unsigned, double, double *, double *, double, double);
+typedef void (*ScaledSumKernel)(const double *, const double *, double, double, double *, unsigned);
+typedef void (*ProductKernel)(const double *, const double *, double, double *, unsigned);
+typedef void (*AbsoluteKernel)(const double *, double, double *, unsigned);
+typedef void (*QuantizeKernel)(const float *, float, float, int, int *, unsigned);
+typedef void (*MultiplyAddKernel)(const float *, float, float *, unsigned);
+typedef void (*LevelKernel)(const double *, unsigned, double *, double, double);
+typedef void (*HoldKernel)(const double *, bool, double *, unsigned);
+typedef double (*DotKernel)(const double *, const double *, unsigned);
+typedef void (*ComplexProductKernel)(const double *, const double *, double *, unsigned);
+typedef unsigned (*FindOutsideKernel)(const double *, double, double, bool, unsigned);
+
+/// \brief Selects the fastest statistics kernel the cpu supports.
+StatisticsKernel selectStatistics() {
+#ifdef ANALYSIS_KERNELS_AVX2
+    if (__builtin_cpu_supports("avx2")) return statisticsAvx2;
+#endif
+#if defined(ANALYSIS_KERNELS_SSE2)
+    return statisticsSse2;
+#elif defined(ANALYSIS_KERNELS_NEON)
+    return statisticsNeon;
+#else
+    return statisticsScalar;
+#endif
+}
+
+/// \brief Selects the fastest power kernel the cpu supports.
+PowerKernel selectPower() {
+#ifdef ANALYSIS_KERNELS_AVX2
+    if (__builtin_cpu_supports("avx2")) return powerAvx2;
+#endif
+#if defined(ANALYSIS_KERNELS_SSE2)
+    return powerSse2;
+#elif defined(ANALYSIS_KERNELS_NEON)
+    return powerNeon;
+#else
+    return powerScalar;
+#endif
+}
+
+/// \brief Selects the fastest scaled sum kernel the cpu supports.
+ScaledSumKernel selectScaledSum() {
+#ifdef ANALYSIS_KERNELS_AVX2
+    if (__builtin_cpu_supports("avx2")) return scaledSumAvx2;
+#endif
+#if defined(ANALYSIS_KERNELS_SSE2)
+    return scaledSumSse2;
+#elif defined(ANALYSIS_KERNELS_NEON)
+    return scaledSumNeon;
+#else
+    return scaledSumScalar;
+#endif
+}
+
+/// \brief Selects the fastest product kernel the cpu supports.
+ProductKernel selectProduct() {
+#ifdef ANALYSIS_KERNELS_AVX2
+    if (__builtin_cpu_supports("avx2")) return productAvx2;
+#endif
+#if defined(ANALYSIS_KERNELS_SSE2)
+    return productSse2;
+#elif defined(ANALYSIS_KERNELS_NEON)
+    return productNeon;
+#else
+    return productScalar;
+#endif
+}
+
+/// \brief Selects the fastest absolute value kernel the cpu supports.
+AbsoluteKernel selectAbsolute() {
+#ifdef ANALYSIS_KERNELS_AVX2
+    if (__builtin_cpu_supports("avx2")) return absoluteAvx2;
+#endif
+#if defined(ANALYSIS_KERNELS_SSE2)
+    return absoluteSse2;
+#elif defined(ANALYSIS_KERNELS_NEON)
+    return absoluteNeon;
+#else
+    return absoluteScalar;
+#endif
+}
+
+/// \brief Selects the fastest quantization kernel the cpu supports.
+QuantizeKernel selectQuantize() {
+#ifdef ANALYSIS_KERNELS_AVX2
+    if (__builtin_cpu_supports("avx2")) return quantizeAvx2;
+#endif
+#if defined(ANALYSIS_KERNELS_SSE2)
+    return quantizeSse2;
+#elif defined(ANALYSIS_KERNELS_NEON)
+    return quantizeNeon;
+#else
+    return quantizeScalar;
+#endif
+}
+
+/// \brief Selects the fastest multiply-add kernel the cpu supports.
+MultiplyAddKernel selectMultiplyAdd() {
+#ifdef ANALYSIS_KERNELS_AVX2
+    if (__builtin_cpu_supports("avx2")) return multiplyAddAvx2;
+#endif
+#if defined(ANALYSIS_KERNELS_SSE2)
+    return multiplyAddSse2;
+#elif defined(ANALYSIS_KERNELS_NEON)
+    return multiplyAddNeon;
+#else
+    return multiplyAddScalar;
+#endif
+}
+
+/// \brief Selects the fastest level kernel the cpu supports.
+LevelKernel selectLevel() {
+#ifdef ANALYSIS_KERNELS_AVX2
+    if (__builtin_cpu_supports("avx2")) return levelAvx2;
+#endif
+#if defined(ANALYSIS_KERNELS_SSE2)
+    return levelSse2;
+#elif defined(ANALYSIS_KERNELS_NEON)
+    return levelNeon;
+#else
+    return levelScalar;
+#endif
+}
+
+/// \brief Selects the fastest hold kernel the cpu supports.
+HoldKernel selectHold() {
+#ifdef ANALYSIS_KERNELS_AVX2
+    if (__builtin_cpu_supports("avx2")) return holdAvx2;
+#endif
+#if defined(ANALYSIS_KERNELS_SSE2)
+    return holdSse2;
+#elif defined(ANALYSIS_KERNELS_NEON)
+    return holdNeon;
+#else
+    return holdScalar;
+#endif
+}
+
+/// \brief Selects the fastest dot product kernel the cpu supports.
+DotKernel selectDot() {
+#ifdef ANALYSIS_KERNELS_AVX2
+    if (__builtin_cpu_supports("avx2")) return dotAvx2;
+#endif
+#if defined(ANALYSIS_KERNELS_SSE2)
+    return dotSse2;
+#elif defined(ANALYSIS_KERNELS_NEON)
+    return dotNeon;
+#else
+    return dotScalar;
+#endif
+}
+
+/// \brief Selects the fastest complex product kernel the cpu supports.
+ComplexProductKernel selectComplexProduct() {
+#ifdef ANALYSIS_KERNELS_AVX2
+    if (__builtin_cpu_supports("avx2")) return complexProductAvx2;
+#endif
+#if defined(ANALYSIS_KERNELS_SSE2)
+    return complexProductSse2;
+#elif defined(ANALYSIS_KERNELS_NEON)
+    return complexProductNeon;
+#else
+    return complexProductScalar;
+#endif
+}
+
+/// \brief Selects the fastest window search kernel the cpu supports.
+FindOutsideKernel selectFindOutside() {
+#ifdef ANALYSIS_KERNELS_AVX2
+    if (__builtin_cpu_supports("avx2")) return findOutsideAvx2;
+#endif
+#if defined(ANALYSIS_KERNELS_SSE2)
+    return findOutsideSse2;
+#elif defined(ANALYSIS_KERNELS_NEON)
+    return findOutsideNeon;
+#else
+    return findOutsideScalar;
+#endif
+}
+}
+
+SampleStatistics sampleStatistics(const double *samples, unsigned count) {
+    static const StatisticsKernel kernel = selectStatistics();
+
+    if (count == 0) return SampleStatistics();
+    return kernel(samples, count);
+}
+
+void complexPower(const double *bins, unsigned count, double factor, double *power, double *decibel, double offset,
+                  double limit) {
+    static const PowerKernel kernel = selectPower();
+
+    kernel(bins, count, factor, power, decibel, offset, limit);
+}
+
+void scaledSum(const double *first, const double *second, double firstFactor, double secondFactor, double *result,
+               unsigned count) {
+    static const ScaledSumKernel kernel = selectScaledSum();
+
+    kernel(first, second, firstFactor, secondFactor, result, count);
+}
+
+void product(const double *first, const double *second, double factor, double *result, unsigned count) {
+    static const ProductKernel kernel = selectProduct();
+
+    kernel(first, second, factor, result, count);
+}
+
+void absolute(const double *samples, double factor, double *result, unsigned count) {
+    static const AbsoluteKernel kernel = selectAbsolute();
+
+    kernel(samples, factor, result, count);
+}
+
+void quantize(const float *values, float factor, float offset, int limit, int *result, unsigned count) {
+    static const QuantizeKernel kernel = selectQuantize();
+
+    kernel(values, factor, offset, limit, result, count);
+}
+
+void multiplyAdd(const float *samples, float factor, float *result, unsigned count) {
+    static const MultiplyAddKernel kernel = selectMultiplyAdd();
+
+    kernel(samples, factor, result, count);
+}
+
+void powerLevel(const double *power, unsigned count, double *decibel, double offset, double limit) {
+    static const LevelKernel kernel = selectLevel();
+
+    kernel(power, count, decibel, offset, limit);
+}
+
+void hold(const double *samples, bool maximum, double *result, unsigned count) {
+    static const HoldKernel kernel = selectHold();
+
+    kernel(samples, maximum, result, count);
+}
+
+double dotProduct(const double *first, const double *second, unsigned count) {
+    static const DotKernel kernel = selectDot();
+
+    return kernel(first, second, count);
+}
+
+void complexProduct(const double *first, const double *second, double *result, unsigned count) {
+    static const ComplexProductKernel kernel = selectComplexProduct();
+
+    kernel(first, second, result, count);
+}
+
+unsigned findOutside(const double *samples, double lower, double upper, bool inverted, unsigned count) {
+    static const FindOutsideKernel kernel = selectFindOutside();
+
+    return kernel(samples, lower, upper, inverted, count);
+}
+
+unsigned findThreshold(const double *samples, double threshold, bool below, bool inverted, unsigned count) {
+    const double infinity = std::numeric_limits<double>::infinity();
+    return below ? findOutside(samples, threshold, infinity, inverted, count)
+                 : findOutside(samples, -infinity, threshold, inverted, count);
+}
+
+double fastLog10(double value) { return log10Scalar(value); }
+}
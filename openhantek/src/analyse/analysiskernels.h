@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+namespace Analysis {
+
+/// \brief The results of a statistics pass over a sample buffer.
+struct SampleStatistics {
+    double minimum = 0.0; ///< The smallest sample
+    double maximum = 0.0; ///< The largest sample
+    double mean = 0.0;    ///< The arithmetic mean of the samples
+    double rms = 0.0;     ///< The root mean square of the samples
+};
+
+/// \brief Calculates minimum, maximum, mean and RMS of the samples in one pass.
+/// Uses the fastest kernel supported by the cpu (AVX2, SSE2, NEON or plain C++).
+/// \param samples The sample buffer.
+/// \param count The number of samples, all values are zero if it is 0.
+/// \return The statistics of the samples.
+SampleStatistics sampleStatistics(const double *samples, unsigned count);
+
+/// \brief Calculates the power and the level in dB of complex spectrum bins.
+/// power[n] = (re² + im²) * factor and decibel[n] = max(10 * log10(power[n]) + offset, limit).
+/// The logarithm is approximated, the error is below 1e-6 dB.
+/// \param bins The interleaved real and imaginary parts of the bins.
+/// \param count The number of bins.
+/// \param factor The factor applied to the power.
+/// \param power The buffer for the power of the bins.
+/// \param decibel The buffer for the levels, nullptr if they aren't needed.
+/// \param offset The value added to the level.
+/// \param limit The minimal level.
+void complexPower(const double *bins, unsigned count, double factor, double *power, double *decibel, double offset,
+                  double limit);
+
+/// \brief Calculates the level in dB of power values like complexPower().
+/// decibel[n] = max(10 * log10(power[n]) + offset, limit).
+/// \param power The power values.
+/// \param count The number of values.
+/// \param decibel The buffer for the levels, it may be the input.
+/// \param offset The value added to the level.
+/// \param limit The minimal level.
+void powerLevel(const double *power, unsigned count, double *decibel, double offset, double limit);
+
+/// \brief Calculates result[n] = first[n] * firstFactor + second[n] * secondFactor.
+/// The result may be one of the inputs.
+/// \param first The first sample buffer.
+/// \param second The second sample buffer.
+/// \param firstFactor The factor applied to the first samples.
+/// \param secondFactor The factor applied to the second samples.
+/// \param result The buffer for the sums.
+/// \param count The number of samples.
+void scaledSum(const double *first, const double *second, double firstFactor, double secondFactor, double *result,
+               unsigned count);
+
+/// \brief Calculates result[n] = first[n] * second[n] * factor.
+/// \param first The first sample buffer.
+/// \param second The second sample buffer.
+/// \param factor The factor applied to the products.
+/// \param result The buffer for the products, it may be one of the inputs.
+/// \param count The number of samples.
+void product(const double *first, const double *second, double factor, double *result, unsigned count);
+
+/// \brief Calculates result[n] = |samples[n]| * factor.
+/// \param samples The sample buffer.
+/// \param factor The factor applied to the absolute values.
+/// \param result The buffer for the values, it may be the input.
+/// \param count The number of samples.
+void absolute(const double *samples, double factor, double *result, unsigned count);
+
+/// \brief Keeps the extremes of the values, result[n] = max(result[n], samples[n]) or the minimum.
+/// \param samples The new values.
+/// \param maximum true to keep the maxima, false for the minima.
+/// \param result The buffer with the extremes, it is updated in place.
+/// \param count The number of values.
+void hold(const double *samples, bool maximum, double *result, unsigned count);
+
+/// \brief Calculates the sum of first[n] * second[n].
+/// \param first The first sample buffer.
+/// \param second The second sample buffer.
+/// \param count The number of samples.
+/// \return The sum of the products.
+double dotProduct(const double *first, const double *second, unsigned count);
+
+/// \brief Multiplies interleaved complex values, result[n] = first[n] * second[n].
+/// \param first The first values, real and imaginary parts alternate.
+/// \param second The second values, real and imaginary parts alternate.
+/// \param result The buffer for the products, it may be one of the inputs.
+/// \param count The number of complex values.
+void complexProduct(const double *first, const double *second, double *result, unsigned count);
+
+/// \brief Calculates the bins of values, result[n] = floor(values[n] * factor + offset).
+/// The bins are limited to -1 for values below the first bin and to limit for
+/// values above the last bin, NaN gives -1.
+/// \param values The values.
+/// \param factor The bins per unit of the values.
+/// \param offset The bin of the value 0.
+/// \param limit The number of bins.
+/// \param result The buffer for the bins.
+/// \param count The number of values.
+void quantize(const float *values, float factor, float offset, int limit, int *result, unsigned count);
+
+/// \brief Calculates result[n] += samples[n] * factor, the step of a FIR filter.
+/// \param samples The values.
+/// \param factor The factor applied to the values.
+/// \param result The buffer that gets the products added.
+/// \param count The number of values.
+void multiplyAdd(const float *samples, float factor, float *result, unsigned count);
+
+/// \brief Searches the first sample outside of a window.
+/// The samples are compared in blocks with vector compares, the comparison masks
+/// give the position of the first match.
+/// \param samples The sample buffer.
+/// \param lower The lower limit of the window, samples[n] < lower is outside.
+/// \param upper The upper limit of the window, samples[n] > upper is outside.
+/// \param inverted true to search the first sample inside the window instead, NaN always matches then.
+/// \param count The number of samples.
+/// \return The index of the first matching sample, count if there is none.
+unsigned findOutside(const double *samples, double lower, double upper, bool inverted, unsigned count);
+
+/// \brief Searches the first sample beyond a threshold, like findOutside() with an infinite limit.
+/// \param samples The sample buffer.
+/// \param threshold The threshold.
+/// \param below false for the first sample greater than the threshold, true for the first sample less than it.
+/// \param inverted true to search the first sample that is not beyond the threshold, NaN always matches then.
+/// \param count The number of samples.
+/// \return The index of the first matching sample, count if there is none.
+unsigned findThreshold(const double *samples, double threshold, bool below, bool inverted, unsigned count);
+
+/// \brief Approximates log10 like complexPower() does.
+/// \param value A positive value.
+/// \return The logarithm, a large negative value for 0.
+double fastLog10(double value);
+}
@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <cmath>
+
+#include <fftw3.h>
+
+#include "channelfilter.h"
+
+#include "analysiskernels.h"
+#include "fftplancache.h"
+#include "windowcache.h"
+
+const unsigned int ChannelFilter::MAX_TAPS;
+const unsigned int ChannelFilter::MAX_ORDER;
+const unsigned int ChannelFilter::MIN_FFT_LENGTH;
+const unsigned int ChannelFilter::IIR_BLOCK;
+
+bool ChannelFilter::Response::operator==(const Response &other) const {
+    return type == other.type && design == other.design && low == other.low && high == other.high &&
+           taps == other.taps && order == other.order;
+}
+
+void ChannelFilter::configure(const Response &response, double interval) {
+    if (response == this->response && interval == this->interval) return;
+    this->response = response;
+    this->interval = interval;
+    primed = false;
+
+    // The cutoffs have to be inside the band of the samplerate
+    const double nyquist = 0.5 / interval;
+    const bool lowValid = response.low > 0.0 && response.low < nyquist;
+    const bool highValid = response.high > 0.0 && response.high < nyquist;
+    switch (response.type) {
+    case Dso::FILTER_LOWPASS:
+        passes = highValid;
+        break;
+    case Dso::FILTER_HIGHPASS:
+        passes = lowValid;
+        break;
+    case Dso::FILTER_BANDPASS:
+        passes = lowValid && highValid && response.low < response.high;
+        break;
+    default:
+        passes = false;
+    }
+    if (!(interval > 0.0)) passes = false;
+    if (!passes) return;
+
+    if (response.design == Dso::FILTERDESIGN_IIR)
+        designIir();
+    else
+        designFir();
+}
+
+void ChannelFilter::process(double *samples, size_t count, bool continuous) {
+    if (!passes || count == 0) return;
+    // A single record starts from the steady state of its first sample, its state doesn't continue a later stream
+    if (!continuous || !primed) prime(samples[0]);
+    primed = continuous;
+
+    if (response.design == Dso::FILTERDESIGN_IIR)
+        processIir(samples, count);
+    else
+        processFir(samples, count, continuous);
+}
+
+/// \brief Designs the windowed sinc and calculates its spectrum for the convolution.
+void ChannelFilter::designFir() {
+    sections.clear();
+    tapCount = std::min(std::max(response.taps, 3u), MAX_TAPS) | 1u;
+    std::vector<double> taps;
+    switch (response.type) {
+    case Dso::FILTER_LOWPASS:
+        lowPassTaps(response.high, taps);
+        break;
+    case Dso::FILTER_HIGHPASS:
+        // The spectral inversion of the low-pass
+        lowPassTaps(response.low, taps);
+        for (double &tap : taps) tap = -tap;
+        taps[tapCount / 2] += 1.0;
+        break;
+    default: {
+        // The difference of the low-passes at both cutoffs
+        std::vector<double> lower;
+        lowPassTaps(response.high, taps);
+        lowPassTaps(response.low, lower);
+        for (unsigned int tap = 0; tap < tapCount; ++tap) taps[tap] -= lower[tap];
+    }
+    }
+
+    // Every block of the overlap-save convolution gives fftLength - tapCount + 1 samples
+    fftLength = MIN_FFT_LENGTH;
+    while (fftLength < 4 * tapCount) fftLength *= 2;
+    const unsigned int binCount = fftLength / 2 + 1;
+    double *padded = block.reserve(fftLength);
+    double *response = bins.reserve(2 * binCount);
+    blockBins.reserve(2 * binCount);
+    std::copy(taps.begin(), taps.end(), padded);
+    std::fill(padded + tapCount, padded + fftLength, 0.0);
+    FftPlanCache::Plan fftPlan = FftPlanCache::instance().plan(FftPlanCache::KIND_R2C, fftLength, padded, response);
+    fftw_execute_dft_r2c(fftPlan.get(), padded, reinterpret_cast<fftw_complex *>(response));
+    // The inverse FFT isn't normalized
+    for (unsigned int index = 0; index < 2 * binCount; ++index) response[index] /= fftLength;
+
+    history.resize(tapCount - 1);
+}
+
+/// \brief Calculates the taps of a windowed sinc low-pass with unity gain at 0 Hz.
+/// \param cutoff The cutoff in Hz.
+/// \param taps Is set to the tapCount taps.
+void ChannelFilter::lowPassTaps(double cutoff, std::vector<double> &taps) const {
+    taps.resize(tapCount);
+    WindowCache::calculate(Dso::WINDOW_BLACKMAN, tapCount, taps.data());
+
+    const double frequency = cutoff * interval; // In cycles per sample
+    const double middle = (tapCount - 1) / 2.0;
+    double sum = 0.0;
+    for (unsigned int tap = 0; tap < tapCount; ++tap) {
+        const double x = tap - middle;
+        taps[tap] *= (x == 0.0) ? 2.0 * frequency : std::sin(2.0 * M_PI * frequency * x) / (M_PI * x);
+        sum += taps[tap];
+    }
+    for (double &tap : taps) tap /= sum;
+}
+
+/// \brief Designs the biquad sections of the Butterworth response.
+void ChannelFilter::designIir() {
+    history.clear();
+    sections.clear();
+    if (response.type != Dso::FILTER_LOWPASS) addSections(true, response.low);
+    if (response.type != Dso::FILTER_HIGHPASS) addSections(false, response.high);
+    sectionInput.reserve(IIR_BLOCK + 2);
+    feedForward.reserve(IIR_BLOCK);
+}
+
+/// \brief Adds the sections of a Butterworth low- or high-pass.
+/// The pole pairs of the prototype become sections with the same cutoff and
+/// their own quality factor, the bilinear transform is prewarped at the cutoff.
+/// \param highPass true for a high-pass, false for a low-pass.
+/// \param cutoff The cutoff in Hz.
+void ChannelFilter::addSections(bool highPass, double cutoff) {
+    const unsigned int order = std::min(std::max(response.order, 2u), MAX_ORDER) & ~1u;
+    const double omega = 2.0 * M_PI * cutoff * interval;
+    const double cosine = std::cos(omega);
+    for (unsigned int pair = 0; pair < order / 2; ++pair) {
+        const double quality = 1.0 / (2.0 * std::sin(M_PI * (2 * pair + 1) / (2.0 * order)));
+        const double alpha = std::sin(omega) / (2.0 * quality);
+        const double a0 = 1.0 + alpha;
+        Section section;
+        section.b1 = (highPass ? -(1.0 + cosine) : 1.0 - cosine) / a0;
+        section.b0 = section.b2 = (highPass ? -section.b1 : section.b1) / 2.0;
+        section.a1 = -2.0 * cosine / a0;
+        section.a2 = (1.0 - alpha) / a0;
+        section.x1 = section.x2 = section.y1 = section.y2 = 0.0;
+        sections.push_back(section);
+    }
+}
+
+/// \brief Sets the state of the filter to the response of a constant signal.
+/// \param value The value of the signal.
+void ChannelFilter::prime(double value) {
+    std::fill(history.begin(), history.end(), value);
+    for (Section &section : sections) {
+        section.x1 = section.x2 = value;
+        // The gain at 0 Hz, 0 for the high-pass
+        value *= (section.b0 + section.b1 + section.b2) / (1.0 + section.a1 + section.a2);
+        section.y1 = section.y2 = value;
+    }
+}
+
+/// \brief Convolves the samples with the FIR filter block by block.
+/// A single record is extended by half the filter with its last sample, and the
+/// output is shifted back by the delay of the filter.
+void ChannelFilter::processFir(double *samples, size_t count, bool continuous) {
+    const unsigned int overlap = tapCount - 1;
+    const unsigned int blockLength = fftLength - overlap;
+    const unsigned int binCount = fftLength / 2 + 1;
+    const size_t delay = continuous ? 0 : overlap / 2;
+    const size_t total = count + delay;
+
+    double *input = block.data();
+    double *spectrum = blockBins.data();
+    FftPlanCache &cache = FftPlanCache::instance();
+    FftPlanCache::Plan forward = cache.plan(FftPlanCache::KIND_R2C, fftLength, input, spectrum);
+    // The inverse transform destroys the spectrum of the block, it is calculated again for the next one
+    FftPlanCache::Plan inverse = cache.plan(FftPlanCache::KIND_C2R, fftLength, spectrum, input);
+
+    for (size_t position = 0; position < total; position += blockLength) {
+        const unsigned int length = (unsigned int)std::min<size_t>(blockLength, total - position);
+        std::copy(history.begin(), history.end(), input);
+        // A single record continues with its last sample
+        const size_t first = std::min(position, count);
+        const unsigned int available = (unsigned int)std::min<size_t>(length, count - first);
+        std::copy(samples + first, samples + first + available, input + overlap);
+        std::fill(input + overlap + available, input + overlap + length, samples[count - 1]);
+        std::fill(input + overlap + length, input + fftLength, 0.0);
+        // The inputs before the next block are its overlap
+        std::copy(input + length, input + length + overlap, history.begin());
+
+        fftw_execute_dft_r2c(forward.get(), input, reinterpret_cast<fftw_complex *>(spectrum));
+        Analysis::complexProduct(spectrum, bins.data(), spectrum, binCount);
+        fftw_execute_dft_c2r(inverse.get(), reinterpret_cast<fftw_complex *>(spectrum), input);
+
+        // The first outputs are wrapped around by the circular convolution, they belong to the overlap
+        const size_t skip = (position < delay) ? std::min<size_t>(delay - position, length) : 0;
+        std::copy(input + overlap + skip, input + overlap + length, samples + position + skip - delay);
+    }
+}
+
+/// \brief Runs the samples through the sections of the IIR filter block by block.
+void ChannelFilter::processIir(double *samples, size_t count) {
+    double *input = sectionInput.data();
+    double *forward = feedForward.data();
+    for (size_t position = 0; position < count; position += IIR_BLOCK) {
+        const unsigned int length = (unsigned int)std::min<size_t>(IIR_BLOCK, count - position);
+        double *values = samples + position;
+        for (Section &section : sections) {
+            // The feed forward part is a short FIR filter, it is vectorized over the block
+            input[0] = section.x2;
+            input[1] = section.x1;
+            std::copy(values, values + length, input + 2);
+            Analysis::scaledSum(input + 2, input + 1, section.b0, section.b1, forward, length);
+            Analysis::scaledSum(forward, input, 1.0, section.b2, forward, length);
+            section.x2 = input[length];
+            section.x1 = input[length + 1];
+
+            // The recursion depends on the previous outputs
+            double y1 = section.y1;
+            double y2 = section.y2;
+            for (unsigned int index = 0; index < length; ++index) {
+                const double y = forward[index] - section.a1 * y1 - section.a2 * y2;
+                y2 = y1;
+                y1 = y;
+                values[index] = y;
+            }
+            section.y1 = y1;
+            section.y2 = y2;
+        }
+    }
+}
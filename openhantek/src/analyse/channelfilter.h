@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "definitions.h"
+#include "scratchbuffer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ChannelFilter                                         channelfilter.h
+/// \brief Digital low-, high- or band-pass filter for the samples of a channel.
+/// The FIR filter is a Blackman windowed sinc that is convolved with
+/// overlap-save FFTs, so its cost hardly depends on the number of taps. The IIR
+/// filter is a Butterworth response designed with the bilinear transform and
+/// run as cascade of biquad sections, the band-pass is a high-pass at the lower
+/// and a low-pass at the upper cutoff. The feed forward part of the sections is
+/// computed with the vectorized kernels for a block of samples, only the
+/// recursion is serial.
+///
+/// A single record is filtered as if the signal was constant before and after
+/// it, the delay of the FIR filter is compensated, so the filtered record stays
+/// aligned with the trigger. A continuous stream keeps the state of the filter
+/// between the calls instead, the output is delayed like in a real filter.
+class ChannelFilter {
+  public:
+    /// \brief The filter that is applied.
+    struct Response {
+        Dso::FilterType type = Dso::FILTER_OFF;
+        Dso::FilterDesign design = Dso::FILTERDESIGN_FIR;
+        double low = 0.0;       ///< The lower cutoff in Hz
+        double high = 0.0;      ///< The upper cutoff in Hz
+        unsigned int taps = 0;  ///< The length of the FIR filter, it is made odd
+        unsigned int order = 0; ///< The order of the IIR filter, it is made even
+
+        bool operator==(const Response &other) const;
+    };
+
+    /// \brief Sets the filter, it is only designed again if it changed.
+    /// The filter is off if the cutoffs are outside of the band of the samplerate.
+    /// \param response The filter.
+    /// \param interval The time between two samples in s.
+    void configure(const Response &response, double interval);
+
+    /// \return true, if the filter changes the samples.
+    bool active() const { return passes; }
+
+    /// \brief Restarts the continuous stream, the state of the filter is discarded.
+    void reset() { primed = false; }
+
+    /// \brief Filters the samples in place.
+    /// \param samples The samples.
+    /// \param count The number of samples.
+    /// \param continuous true, if the samples continue the samples of the last call. The first continuous call
+    /// after single records starts a new stream.
+    void process(double *samples, size_t count, bool continuous);
+
+    static const unsigned int MAX_TAPS = 4095;      ///< The longest FIR filter
+    static const unsigned int MAX_ORDER = 16;       ///< The highest order of the IIR filter
+    static const unsigned int MIN_FFT_LENGTH = 256; ///< The shortest FFT of the convolution
+    static const unsigned int IIR_BLOCK = 1024;     ///< The samples the sections process at once
+
+  private:
+    /// \brief A second order section of the IIR filter and its state.
+    struct Section {
+        double b0, b1, b2; ///< The feed forward coefficients
+        double a1, a2;     ///< The feedback coefficients, a0 is 1
+        double x1, x2;     ///< The last two inputs
+        double y1, y2;     ///< The last two outputs
+    };
+
+    void designFir();
+    void designIir();
+    void lowPassTaps(double cutoff, std::vector<double> &taps) const;
+    void addSections(bool highPass, double cutoff);
+    void prime(double value);
+    void processFir(double *samples, size_t count, bool continuous);
+    void processIir(double *samples, size_t count);
+
+    Response response;
+    double interval = 0.0;
+    bool passes = false; ///< true, if the filter is on and valid
+    bool primed = false; ///< true, if the state belongs to the stream
+
+    // The FIR filter
+    unsigned int tapCount = 0;   ///< The length of the filter
+    unsigned int fftLength = 0;  ///< The length of the convolution FFTs
+    ScratchBuffer bins;          ///< The spectrum of the filter, scaled for the inverse FFT
+    ScratchBuffer block;         ///< The input of a block with the overlap, then its output
+    ScratchBuffer blockBins;     ///< The spectrum of a block
+    std::vector<double> history; ///< The last tapCount - 1 inputs
+
+    // The IIR filter
+    std::vector<Section> sections;
+    ScratchBuffer sectionInput; ///< The block of inputs of a section after its last two inputs
+    ScratchBuffer feedForward;  ///< The feed forward part of the block
+};
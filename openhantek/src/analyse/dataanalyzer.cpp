@@ -1,33 +1,125 @@
 // SPDX-License-Identifier: GPL-2.0+
 
 #define _USE_MATH_DEFINES
+#include <algorithm>
 #include <cmath>
+#include <functional>
+#include <limits>
 
 #include <QColor>
 #include <QMutex>
+#include <QRunnable>
 #include <QTimer>
 
 #include <fftw3.h>
 
 #include "dataanalyzer.h"
+#include "fftplancache.h"
+#include "windowcache.h"
 
-#include "glscope.h"
 #include "settings.h"
+#include "utils/instrumentation.h"
 #include "utils/printutils.h"
+#include "viewconstants.h"
+
+namespace {
+/// \brief Runs the analysis of one channel on a worker thread.
+class AnalysisJob : public QRunnable {
+  public:
+    explicit AnalysisJob(std::function<void()> job) : job(job) {}
+
+    void run() override { job(); }
+
+  private:
+    std::function<void()> job;
+};
+
+/// \return The filter response of the settings of a channel.
+ChannelFilter::Response filterResponse(const DsoSettingsScopeFilter &settings) {
+    ChannelFilter::Response response;
+    response.type = settings.type;
+    response.design = settings.design;
+    response.low = settings.low;
+    response.high = settings.high;
+    response.taps = settings.taps;
+    response.order = settings.order;
+    return response;
+}
+
+/// \brief Rounds a transform length down to a product of 2, 3 and 5.
+/// FFTW is fastest for these lengths, and there are few enough of them that
+/// moving markers mostly reuse the cached plans.
+/// \param length The maximal length, at least 1.
+/// \return The largest such length that isn't longer.
+size_t smoothLength(size_t length) {
+    size_t best = 1;
+    for (size_t fives = 1; fives <= length; fives *= 5) {
+        for (size_t threes = fives; threes <= length; threes *= 3) {
+            size_t product = threes;
+            while (product * 2 <= length) product *= 2;
+            best = std::max(best, product);
+        }
+    }
+    return best;
+}
 
-std::unique_ptr<DataAnalyzerResult> DataAnalyzer::convertData(const DSOsamples *data, const DsoSettingsScope *scope) {
-    QReadLocker locker(&data->lock);
+/// \return The decoder configuration of the settings.
+ProtocolDecoder::Configuration decoderConfiguration(const DsoSettingsScopeDecoder &settings) {
+    ProtocolDecoder::Configuration configuration;
+    configuration.protocol = settings.protocol;
+    configuration.threshold = settings.threshold;
+    configuration.hysteresis = settings.hysteresis;
+    configuration.baudrate = settings.baudrate;
+    configuration.dataBits = settings.dataBits;
+    configuration.parity = settings.parity;
+    configuration.stopBits = settings.stopBits;
+    configuration.inverted = settings.inverted;
+    configuration.clockSlope = settings.clockSlope;
+    configuration.wordBits = settings.wordBits;
+    configuration.lsbFirst = settings.lsbFirst;
+    return configuration;
+}
+}
 
+const unsigned int DataAnalyzer::ROLL_SEGMENT_LENGTH;
+const unsigned int DataAnalyzer::ROLL_HISTORY_MAX;
+const unsigned int DataAnalyzer::SPECTROGRAM_MIN_SEGMENT;
+const unsigned int DataAnalyzer::SPECTROGRAM_MAX_ROWS;
+const unsigned int DataAnalyzer::REGION_SPECTRUM_MIN;
+
+/// \brief Checks if anything reads the voltages of a physical channel.
+/// Besides the shown graphs these are the sources of the math channel, the y
+/// channel of the XY format, the trigger, the decoder, the mask and the phase
+/// reference. The codes of the other channels aren't converted.
+/// \param channel The physical channel.
+/// \param scope The settings of the frame.
+/// \return true, if the voltages of the channel are needed.
+bool DataAnalyzer::isVoltageNeeded(unsigned int channel, const DsoSettingsScope *scope) const {
+    const unsigned int math = scope->physicalChannels;
+    if (measureAllChannels.loadAcquire() || scope->voltage[channel].used || scope->spectrum[channel].used) return true;
+    if (channel < 2 && (scope->voltage[math].used || scope->spectrum[math].used)) return true;
+    if (scope->horizontal.format == Dso::GRAPHFORMAT_XY && channel % 2 && scope->voltage[channel - 1].used)
+        return true;
+    if (!scope->trigger.special && scope->trigger.source == channel) return true;
+    if (scope->decoder.protocol != Dso::PROTOCOL_OFF &&
+        (scope->decoder.sources[0] == channel || scope->decoder.sources[1] == channel))
+        return true;
+    if (scope->mask.enabled && scope->mask.channel == channel) return true;
+    return channel == 0 && ((scope->measurements >> Dso::MEASUREMENT_PHASE) & 1u);
+}
+
+std::shared_ptr<DataAnalyzerResult> DataAnalyzer::convertData(DSOsamples *data, const DsoSettingsScope *scope) {
     unsigned int channelCount = (unsigned int)scope->voltage.size();
 
-    std::unique_ptr<DataAnalyzerResult> result =
-        std::unique_ptr<DataAnalyzerResult>(new DataAnalyzerResult(channelCount));
+    std::shared_ptr<DataAnalyzerResult> result = resultPool->acquire(channelCount);
+    result->setRolling(data->append);
+    result->setFrame(data->frameId, data->timestamp);
+    rollRestarted = false;
 
     for (unsigned int channel = 0; channel < channelCount; ++channel) {
         DataChannel *const channelData = result->modifyData(channel);
 
-        bool gotDataForChannel = channel < scope->physicalChannels && channel < (unsigned int)data->data.size() &&
-                                 !data->data.at(channel).empty();
+        bool gotDataForChannel = channel < scope->physicalChannels && data->sampleCount(channel) > 0;
         bool isMathChannel = channel >= scope->physicalChannels &&
                              (scope->voltage[channel].used || scope->spectrum[channel].used) &&
                              result->channelCount() >= 2 && !result->data(0)->voltage.sample.empty() &&
@@ -42,297 +134,858 @@ std::unique_ptr<DataAnalyzerResult> DataAnalyzer::convertData(const DSOsamples *
 
         // Set sampling interval
         const double interval = 1.0 / data->samplerate;
-        if (interval != channelData->voltage.interval) {
-            channelData->voltage.interval = interval;
-            if (data->append) // Clear roll buffer if the samplerate changed
-                channelData->voltage.sample.clear();
-        }
-
-        unsigned int size;
-        if (channel < scope->physicalChannels) {
-            size = data->data.at(channel).size();
-            if (data->append) size += channelData->voltage.sample.size();
-            result->challengeMaxSamples(size);
-        } else
-            size = result->getMaxSamples();
+        channelData->voltage.interval = interval;
 
         // Physical channels
         if (channel < scope->physicalChannels) {
-            // Copy the buffer of the oscilloscope into the sample buffer
-            if (data->append)
-                channelData->voltage.sample.insert(channelData->voltage.sample.end(), data->data.at(channel).begin(),
-                                                   data->data.at(channel).end());
-            else
-                channelData->voltage.sample = data->data.at(channel);
-        } else { // Math channel
-            // Resize the sample vector
-            channelData->voltage.sample.resize(size);
-            // Set sampling interval
-            result->modifyData(scope->physicalChannels)->voltage.interval = result->data(0)->voltage.interval;
-
-            // Resize the sample vector
-            result->modifyData(scope->physicalChannels)
-                ->voltage.sample.resize(
-                    qMin(result->data(0)->voltage.sample.size(), result->data(1)->voltage.sample.size()));
-
-            // Calculate values and write them into the sample buffer
-            std::vector<double>::const_iterator ch1Iterator = result->data(0)->voltage.sample.begin();
-            std::vector<double>::const_iterator ch2Iterator = result->data(1)->voltage.sample.begin();
-            std::vector<double> &resultData = result->modifyData(scope->physicalChannels)->voltage.sample;
-            for (std::vector<double>::iterator resultIterator = resultData.begin(); resultIterator != resultData.end();
-                 ++resultIterator) {
-                switch (scope->voltage[scope->physicalChannels].misc) {
-                case Dso::MATHMODE_1ADD2:
-                    *resultIterator = *ch1Iterator + *ch2Iterator;
-                    break;
-                case Dso::MATHMODE_1SUB2:
-                    *resultIterator = *ch1Iterator - *ch2Iterator;
-                    break;
-                case Dso::MATHMODE_2SUB1:
-                    *resultIterator = *ch2Iterator - *ch1Iterator;
-                    break;
+            if (rollHistory.size() <= channel) rollHistory.resize(channel + 1);
+            SampleRing &history = rollHistory[channel];
+            if (filters.size() <= channel) filters.resize(channel + 1);
+            ChannelFilter &filter = filters[channel];
+            filter.configure(filterResponse(scope->voltage[channel].filter), interval);
+
+            if (data->append) {
+                // Keep as many samples as fit on the screen, clear the history if the timebase or samplerate changed
+                size_t capacity = (size_t)std::ceil(scope->horizontal.timebase * DIVS_TIME / interval);
+                capacity = qBound((size_t)ROLL_SEGMENT_LENGTH, capacity, (size_t)ROLL_HISTORY_MAX);
+                if (capacity != history.capacity() || interval != history.interval()) {
+                    history.reset(capacity, interval);
+                    filter.reset();
+                    rollRestarted = true;
                 }
-                ++ch1Iterator;
-                ++ch2Iterator;
+
+                // Only the new samples are converted, compact data is converted on the way
+                data->copyVoltage(channel, arrivedSamples, false);
+                arrivedCount = arrivedSamples.size();
+                // The filter continues with the state of the last frame
+                filter.process(arrivedSamples.data(), arrivedSamples.size(), true);
+                history.append(arrivedSamples.data(), arrivedSamples.size());
+                history.copyTo(channelData->voltage);
+            } else {
+                // Free the roll history
+                if (history.capacity()) history.reset(0, 0.0);
+
+                // The frame belongs to the analyzer, so voltages are taken over instead of copied. Compact frames stay
+                // codes until a consumer needs the voltages of a channel
+                if (data->compact && !isVoltageNeeded(channel, scope))
+                    channelData->voltage.sample.clear();
+                else if (data->compact)
+                    data->copyVoltage(channel, channelData->voltage.sample, false);
+                else
+                    channelData->voltage.sample.swap(data->data[channel]);
+                filter.process(channelData->voltage.sample.data(), channelData->voltage.sample.size(), false);
+            }
+            result->challengeMaxSamples(channelData->voltage.sample.size());
+        } else { // Math channel
+            DataChannel *mathData = result->modifyData(scope->physicalChannels);
+            mathData->voltage.interval = result->data(0)->voltage.interval;
+            // The rings of the physical channels are filled equally in roll mode
+            mathData->voltage.rotation = result->data(0)->voltage.rotation;
+
+            // The settings may change the formula meanwhile, the analysis uses its own copy
+            QString formula;
+            {
+                QMutexLocker locker(&mathMutex);
+                formula = mathExpression;
             }
+            math.configure((Dso::MathMode)scope->voltage[scope->physicalChannels].misc, scope->mathFactors[0],
+                           scope->mathFactors[1], formula);
+            math.evaluate(result->data(0)->voltage.sample, result->data(1)->voltage.sample, mathData->voltage.sample);
         }
     }
     return result;
 }
 
-/// \brief Analyzes the data from the dso.
-DataAnalyzer::~DataAnalyzer() {
-    if (window) fftw_free(window);
+void DataAnalyzer::applySettings(DsoSettingsScope *scope) {
+    this->scope = scope;
+    setMask(scope->mask.polygons);
+    setMathExpression(scope->mathExpression);
 }
 
-void DataAnalyzer::applySettings(DsoSettingsScope *scope) { this->scope = scope; }
-
-void DataAnalyzer::setSourceData(const DSOsamples *data) { sourceData = data; }
+void DataAnalyzer::setSourceData(DSOsampleBuffer *data) { sourceData = data; }
 
-std::unique_ptr<DataAnalyzerResult> DataAnalyzer::getNextResult() { return std::move(lastResult); }
+std::shared_ptr<const DataAnalyzerResult> DataAnalyzer::getNextResult() {
+    QMutexLocker locker(&resultMutex);
+    return std::move(lastResult);
+}
 
 void DataAnalyzer::samplesAvailable() {
     if (sourceData == nullptr) return;
-    std::unique_ptr<DataAnalyzerResult> result = convertData(sourceData, scope);
-    spectrumAnalysis(result.get(), lastWindow, lastRecordLength, window, scope);
-    lastResult.swap(result);
-    emit analyzed();
+    // A frame is only missing if it was already analyzed with an earlier notification
+    DSOsamples *data = sourceData->takeFrame();
+    if (data == nullptr) return;
+
+    std::shared_ptr<DataAnalyzerResult> result;
+    {
+        Instrumentation::ScopedStage stage(Instrumentation::STAGE_ANALYZE, data->frameId);
+        result = convertData(data, scope);
+        decodeProtocol(result.get());
+        findTrigger(result.get());
+        sampleEquivalentTime(result.get());
+        testMask(result.get());
+        spectrumAnalysis(result.get());
+        measurePhases(result.get());
+        accumulateStatistics(result.get());
+    }
+    {
+        QMutexLocker locker(&resultMutex);
+        // A failed mask test or a created mask has to reach the gui, the newer result is dropped instead
+        if (!lastResult || !lastResult->mask().keep || result->mask().keep) lastResult.swap(result);
+    }
+
+    // The gui didn't fetch the previous result in time, one of them is dropped and the notification is still queued
+    if (result)
+        Instrumentation::count(Instrumentation::COUNTER_DROPPED);
+    else
+        emit analyzed();
 }
 
-void DataAnalyzer::spectrumAnalysis(DataAnalyzerResult *result, Dso::WindowFunction &lastWindow,
-                                    unsigned int lastRecordLength, double *&lastWindowBuffer,
-                                    const DsoSettingsScope *scope) {
-    // Calculate frequencies, peak-to-peak voltages and spectrums
+/// \brief Decodes the serial protocol from the samples of its sources.
+/// In roll mode only the new samples are decoded and the decoder continues
+/// with its state of the last frame, the annotations stay as long as their
+/// samples are in the roll history. Other frames are decoded on their own.
+void DataAnalyzer::decodeProtocol(DataAnalyzerResult *result) {
+    const DsoSettingsScopeDecoder &settings = scope->decoder;
+    decoder.configure(decoderConfiguration(settings), result->data(0) ? result->data(0)->voltage.interval : 0.0);
+    if (!decoder.active()) return;
+
+    const SampleValues *inputs[ProtocolDecoder::MAX_INPUTS];
+    size_t recordLength = 0;
+    for (unsigned int input = 0; input < decoder.inputCount(); ++input) {
+        const unsigned int source = settings.sources[input];
+        if (source >= scope->physicalChannels || result->data(source)->voltage.sample.empty()) {
+            decoder.reset();
+            return;
+        }
+        inputs[input] = &result->data(source)->voltage;
+        const size_t length = inputs[input]->sample.size();
+        recordLength = (input == 0) ? length : std::min(recordLength, length);
+    }
+
+    if (result->isRolling()) {
+        // A stream with a gap starts again, more samples than fit into the history may have arrived
+        const size_t count = std::min(arrivedCount, recordLength);
+        decoder.process(inputs, recordLength - count, count, !rollRestarted && count == arrivedCount);
+    } else {
+        decoder.process(inputs, 0, recordLength, false);
+    }
+    decoder.annotations(recordLength, result->modifyAnnotations());
+}
+
+/// \brief Searches the trigger point in the samples of the trigger source in software trigger mode.
+/// The frames of the roll mode aren't triggered.
+void DataAnalyzer::findTrigger(DataAnalyzerResult *result) {
+    result->setTriggerPoint(-1.0);
+    const DsoSettingsScopeTrigger &settings = scope->trigger;
+    if (settings.mode != Dso::TRIGGERMODE_SOFTWARE || settings.special || settings.source >= scope->physicalChannels ||
+        result->isRolling())
+        return;
+
+    const SampleValues &voltage = result->data(settings.source)->voltage;
+    const unsigned int sampleCount = voltage.sample.size();
+    if (sampleCount == 0 || voltage.interval <= 0.0) return;
+
+    const double samplesDisplay = scope->horizontal.timebase * DIVS_TIME / voltage.interval;
+    if (samplesDisplay >= sampleCount) {
+        // For sure not enough samples to adjust for jitter, the frame is ignored
+        timestampDebug(QString("Too few samples to make a steady picture. Decrease sample rate"));
+        return;
+    }
+
+    // The pretrigger samples have to be before the trigger point and a whole screen after it
+    const unsigned int preTrigSamples = (unsigned int)(settings.position * samplesDisplay);
+    const unsigned int postTrigSamples = (unsigned int)(sampleCount - (samplesDisplay - preTrigSamples));
+    const DsoSettingsScopeVoltage &source = scope->voltage[settings.source];
+    SoftwareTrigger::Condition condition;
+    condition.type = settings.type;
+    condition.slope = settings.slope;
+    condition.level = source.trigger;
+    condition.upperLevel = source.trigger + settings.height * source.gain;
+    condition.hysteresis = settings.hysteresis * source.gain;
+    condition.duration = settings.duration / voltage.interval;
+    condition.shorter = settings.shorter;
+    condition.sinc = settings.sinc;
+    trigger.configure(condition);
+    result->setTriggerPoint(trigger.find(voltage.sample.data(), sampleCount, preTrigSamples, postTrigSamples));
+}
+
+/// \brief Replaces the records of the physical channels by their equivalent time records.
+/// The software trigger point places the samples of every frame on a time grid
+/// that is finer than the sample interval and covers the screen. The records then
+/// have the samplerate of the grid, the protocol annotations are moved onto the
+/// grid and the math channel is calculated again from the new records. Frames
+/// without a trigger point are shown unchanged, they aren't added to the grids.
+/// A change of the trigger or of the channels restarts the grids, their samples
+/// would be placed at other positions or voltages now.
+void DataAnalyzer::sampleEquivalentTime(DataAnalyzerResult *result) {
+    const DsoSettingsScopeHorizontal &horizontal = scope->horizontal;
+    if (horizontal.acquisitionMode != Dso::ACQUISITION_EQUIVALENT || result->isRolling()) {
+        // The grids are only kept while they are used
+        std::vector<EquivalentTimeSampler>().swap(equivalentTime);
+        equivalentTimeSettings.clear();
+        return;
+    }
+    const double triggerPoint = result->triggerPoint();
+    if (triggerPoint < 0.0) return;
+
+    // A coarser grid is used if the finest one doesn't fit into the memory
+    const double interval = result->data(scope->trigger.source)->voltage.interval;
+    const double samplesDisplay = horizontal.timebase * DIVS_TIME / interval;
+    unsigned factor = qBound(1u, horizontal.equivalentTime, EquivalentTimeSampler::MAXIMUM_FACTOR);
+    while (factor > 1 && samplesDisplay * factor + 2.0 > EquivalentTimeSampler::MAXIMUM_STEPS) factor /= 2;
+    const double gridInterval = interval / factor;
+
+    // The grid starts one step before the screen, its trigger point is placed by screenStart() like a crossing
+    // half a step before the first step on the screen
+    const double stepsDisplay = horizontal.timebase * DIVS_TIME / gridInterval;
+    const size_t steps = (size_t)std::ceil(stepsDisplay) + 2;
+    const double gridTrigger = (unsigned int)(scope->trigger.position * stepsDisplay) + 0.5;
+    const double position = gridTrigger - triggerPoint * factor;
+
+    const unsigned int physicalChannels = std::min(scope->physicalChannels, result->channelCount());
+    if (equivalentTime.size() < physicalChannels) equivalentTime.resize(physicalChannels);
+    const size_t settingsCount = 2 + 3 * physicalChannels;
+    bool changed = equivalentTimeSettings.size() != settingsCount;
+    equivalentTimeSettings.resize(settingsCount);
+    auto compare = [&](size_t index, double value) {
+        if (equivalentTimeSettings[index] == value) return;
+        equivalentTimeSettings[index] = value;
+        changed = true;
+    };
+    compare(0, scope->trigger.position);
+    compare(1, scope->trigger.source);
+    for (unsigned int channel = 0; channel < physicalChannels; ++channel) {
+        compare(2 + 3 * channel, scope->voltage[channel].gain);
+        compare(3 + 3 * channel, scope->voltage[channel].offset);
+        compare(4 + 3 * channel, scope->voltage[channel].used);
+    }
+    if (changed)
+        for (EquivalentTimeSampler &sampler : equivalentTime) sampler.reset();
+    for (unsigned int channel = 0; channel < physicalChannels; ++channel) {
+        SampleValues &voltage = result->modifyData(channel)->voltage;
+        if (voltage.sample.empty()) continue;
+        EquivalentTimeSampler &sampler = equivalentTime[channel];
+        sampler.configure(factor, steps);
+        sampler.add(voltage.sample.data(), voltage.sample.size(), position);
+        sampler.record(voltage.sample);
+        voltage.interval = gridInterval;
+    }
+    result->challengeMaxSamples((unsigned int)steps);
+    result->setTriggerPoint(gridTrigger);
+
+    for (ProtocolAnnotation &annotation : result->modifyAnnotations()) {
+        annotation.start = position + annotation.start * factor;
+        annotation.end = position + annotation.end * factor;
+    }
+
+    if (physicalChannels >= result->channelCount() || physicalChannels < 2) return;
+    DataChannel *mathData = result->modifyData(physicalChannels);
+    if (!mathData->voltage.sample.empty()) {
+        mathData->voltage.interval = gridInterval;
+        math.evaluate(result->data(0)->voltage.sample, result->data(1)->voltage.sample, mathData->voltage.sample);
+    }
+}
+
+bool DataAnalyzer::screenStart(const DataAnalyzerResult *result, const DsoSettingsScope *scope,
+                               unsigned int &firstSample, double &triggerShift) {
+    firstSample = 0;
+    triggerShift = 0.0;
+    const unsigned int source = scope->trigger.source;
+    if (scope->trigger.mode != Dso::TRIGGERMODE_SOFTWARE || scope->trigger.special ||
+        source >= scope->physicalChannels || result->isRolling())
+        return true;
+
+    const double triggerPoint = result->triggerPoint();
+    const double interval = result->data(source)->voltage.interval;
+    const double samplesDisplay = interval > 0.0 ? scope->horizontal.timebase * DIVS_TIME / interval : 0.0;
+    const unsigned int preTrigSamples = (unsigned int)(scope->trigger.position * samplesDisplay);
+    // The first sample after the crossing, 0 if the trigger wasn't asserted
+    const unsigned int crossing = (triggerPoint < 0.0) ? 0 : (unsigned int)triggerPoint + 1;
+    if (crossing == 0 || crossing < preTrigSamples) return false;
+    firstSample = crossing - preTrigSamples;
+    // Not the sample after the crossing but the interpolated crossing stays at the same position
+    triggerShift = (crossing - triggerPoint) * interval;
+    return true;
+}
+
+void DataAnalyzer::setMask(const std::vector<QPolygonF> &polygons) {
+    QMutexLocker locker(&maskMutex);
+    pendingMask = polygons;
+    maskChanged = true;
+}
+
+void DataAnalyzer::setMathExpression(const QString &formula) {
+    QMutexLocker locker(&mathMutex);
+    mathExpression = formula;
+}
+
+void DataAnalyzer::createMask(double xTolerance, double yTolerance) {
+    QMutexLocker locker(&maskMutex);
+    maskRequested = true;
+    maskTolerances[0] = xTolerance;
+    maskTolerances[1] = yTolerance;
+}
+
+void DataAnalyzer::resetMaskCounters() { maskCountersReset.storeRelease(1); }
+
+/// \brief Tests the graph of the mask channel against the mask.
+/// The graph is placed like on the screen. Frames in roll mode and frames
+/// whose software trigger wasn't asserted aren't shown, so they aren't tested.
+void DataAnalyzer::testMask(DataAnalyzerResult *result) {
+    bool requested;
+    double tolerances[2];
+    {
+        QMutexLocker locker(&maskMutex);
+        if (maskChanged) {
+            mask.setMask(pendingMask);
+            maskChanged = false;
+        }
+        requested = maskRequested;
+        tolerances[0] = maskTolerances[0];
+        tolerances[1] = maskTolerances[1];
+    }
+    if (maskCountersReset.fetchAndStoreAcquire(0)) {
+        maskTotal = 0;
+        maskFailures = 0;
+    }
+
+    MaskResult &maskResult = result->modifyMask();
+    maskResult.total = maskTotal;
+    maskResult.failures = maskFailures;
+    const DsoSettingsScopeMask &settings = scope->mask;
+    if ((!settings.enabled && !requested) || result->isRolling() || settings.channel >= result->channelCount())
+        return;
+    const SampleValues &voltage = result->data((int)settings.channel)->voltage;
+    unsigned int firstSample;
+    double triggerShift;
+    if (voltage.sample.size() <= 1 || !screenStart(result, scope, firstSample, triggerShift) ||
+        firstSample >= voltage.sample.size())
+        return;
+
+    const DsoSettingsScopeVoltage &channel = scope->voltage[(int)settings.channel];
+    const unsigned int violations =
+        mask.test(voltage.sample.data() + firstSample, voltage.sample.size() - firstSample, triggerShift,
+                  voltage.interval, 1.0 / scope->horizontal.timebase, (channel.inverted ? -1.0 : 1.0) / channel.gain,
+                  channel.offset);
+    if (settings.enabled && !mask.empty()) {
+        maskResult.tested = true;
+        maskResult.violations = violations;
+        maskResult.failed = violations > 0;
+        maskResult.keep = maskResult.failed && (settings.stopOnFail || settings.saveOnFail);
+        maskResult.total = ++maskTotal;
+        if (maskResult.failed) maskResult.failures = ++maskFailures;
+    }
+
+    // The created mask is used from the next frame on
+    if (requested) {
+        std::shared_ptr<std::vector<QPolygonF>> created =
+            std::make_shared<std::vector<QPolygonF>>(mask.envelope(tolerances[0], tolerances[1]));
+        mask.setMask(*created);
+        maskResult.created = std::move(created);
+        maskResult.keep = true;
+        QMutexLocker locker(&maskMutex);
+        maskRequested = false;
+    }
+}
+
+void DataAnalyzer::spectrumAnalysis(DataAnalyzerResult *result) {
+    rolling = result->isRolling();
+    // The markers select samples like on the screen, the roll mode has no fixed position on the screen
+    screenShown = !rolling && screenStart(result, scope, screenFirst, screenShift);
+    FftPlanCache::instance().setPlannerEffort(scope->spectrumPatientPlanning ? FFTW_PATIENT : FFTW_MEASURE);
+    if (scratch.size() < result->channelCount()) scratch.resize(result->channelCount());
+
+    // The averagers are configured here, the channels only touch their own one
+    const bool restartAverages = averagesReset.fetchAndStoreAcquire(0);
+    for (AnalysisScratch &channelScratch : scratch) {
+        channelScratch.averager.configure(scope->spectrumAveraging, scope->spectrumAverages);
+        if (restartAverages) channelScratch.averager.reset();
+    }
+
+    // The plain spectrum of the whole record can be calculated by the scopes on the gpu
+    const bool offload = scope->spectrumGpu && spectrumOffload.loadAcquire() && !rolling && !scope->spectrumZoom &&
+                         scope->spectrumAveraging == Dso::AVERAGING_OFF && !scope->spectrogram &&
+                         !(scope->analysisRegion && scope->spectrumRegion);
+    const bool spectralFrequency = scope->frequencyEstimator != Dso::FREQUENCY_ZEROCROSSING;
+
+    const bool measureAll = measureAllChannels.loadAcquire();
+
+    // Collect the channels with data, clear the spectrum of the unused channels
+    demands.assign(result->channelCount(), 0);
+    std::vector<unsigned int> channels;
     for (unsigned int channel = 0; channel < result->channelCount(); ++channel) {
         DataChannel *const channelData = result->modifyData(channel);
+        channelData->spectrumOffloaded = false;
 
         if (channelData->voltage.sample.empty()) {
             // Clear unused channels
             channelData->spectrum.interval = 0;
             channelData->spectrum.sample.clear();
+            channelData->spectrogram.sample.clear();
+            channelData->spectrogramBins = 0;
             continue;
         }
-
-        // Calculate new window
-        unsigned int sampleCount = channelData->voltage.sample.size();
-        if (!lastWindowBuffer || lastWindow != scope->spectrumWindow || lastRecordLength != sampleCount) {
-            if (lastWindowBuffer) fftw_free(lastWindowBuffer);
-            lastWindowBuffer = fftw_alloc_real(sampleCount);
-            lastRecordLength = sampleCount;
-
-            unsigned int windowEnd = lastRecordLength - 1;
-            lastWindow = scope->spectrumWindow;
-
-            switch (scope->spectrumWindow) {
-            case Dso::WINDOW_HAMMING:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 0.54 - 0.46 * cos(2.0 * M_PI * windowPosition / windowEnd);
-                break;
-            case Dso::WINDOW_HANN:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 0.5 * (1.0 - cos(2.0 * M_PI * windowPosition / windowEnd));
-                break;
-            case Dso::WINDOW_COSINE:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = sin(M_PI * windowPosition / windowEnd);
-                break;
-            case Dso::WINDOW_LANCZOS:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition) {
-                    double sincParameter = (2.0 * windowPosition / windowEnd - 1.0) * M_PI;
-                    if (sincParameter == 0)
-                        *(lastWindowBuffer + windowPosition) = 1;
-                    else
-                        *(lastWindowBuffer + windowPosition) = sin(sincParameter) / sincParameter;
-                }
-                break;
-            case Dso::WINDOW_BARTLETT:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) =
-                        2.0 / windowEnd * (windowEnd / 2 - std::abs((double)(windowPosition - windowEnd / 2.0)));
-                break;
-            case Dso::WINDOW_TRIANGULAR:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) =
-                        2.0 / lastRecordLength *
-                        (lastRecordLength / 2 - std::abs((double)(windowPosition - windowEnd / 2.0)));
-                break;
-            case Dso::WINDOW_GAUSS: {
-                double sigma = 0.4;
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) =
-                        exp(-0.5 * pow(((windowPosition - windowEnd / 2) / (sigma * windowEnd / 2)), 2));
-            } break;
-            case Dso::WINDOW_BARTLETTHANN:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 0.62 -
-                                                           0.48 * std::abs((double)(windowPosition / windowEnd - 0.5)) -
-                                                           0.38 * cos(2.0 * M_PI * windowPosition / windowEnd);
-                break;
-            case Dso::WINDOW_BLACKMAN: {
-                double alpha = 0.16;
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = (1 - alpha) / 2 -
-                                                           0.5 * cos(2.0 * M_PI * windowPosition / windowEnd) +
-                                                           alpha / 2 * cos(4.0 * M_PI * windowPosition / windowEnd);
-            } break;
-            // case WINDOW_KAISER:
-            // TODO WINDOW_KAISER
-            // double alpha = 3.0;
-            // for(unsigned int windowPosition = 0; windowPosition <
-            // lastRecordLength; ++windowPosition)
-            //*(window + windowPosition) = ;
-            // break;
-            case Dso::WINDOW_NUTTALL:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 0.355768 -
-                                                           0.487396 * cos(2 * M_PI * windowPosition / windowEnd) +
-                                                           0.144232 * cos(4 * M_PI * windowPosition / windowEnd) -
-                                                           0.012604 * cos(6 * M_PI * windowPosition / windowEnd);
-                break;
-            case Dso::WINDOW_BLACKMANHARRIS:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 0.35875 -
-                                                           0.48829 * cos(2 * M_PI * windowPosition / windowEnd) +
-                                                           0.14128 * cos(4 * M_PI * windowPosition / windowEnd) -
-                                                           0.01168 * cos(6 * M_PI * windowPosition / windowEnd);
-                break;
-            case Dso::WINDOW_BLACKMANNUTTALL:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 0.3635819 -
-                                                           0.4891775 * cos(2 * M_PI * windowPosition / windowEnd) +
-                                                           0.1365995 * cos(4 * M_PI * windowPosition / windowEnd) -
-                                                           0.0106411 * cos(6 * M_PI * windowPosition / windowEnd);
-                break;
-            case Dso::WINDOW_FLATTOP:
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 1.0 - 1.93 * cos(2 * M_PI * windowPosition / windowEnd) +
-                                                           1.29 * cos(4 * M_PI * windowPosition / windowEnd) -
-                                                           0.388 * cos(6 * M_PI * windowPosition / windowEnd) +
-                                                           0.032 * cos(8 * M_PI * windowPosition / windowEnd);
-                break;
-            default: // Dso::WINDOW_RECTANGULAR
-                for (unsigned int windowPosition = 0; windowPosition < lastRecordLength; ++windowPosition)
-                    *(lastWindowBuffer + windowPosition) = 1.0;
-            }
+        channels.push_back(channel);
+
+        // The docks and the exporter show the amplitude and the frequency of every channel with a graph, the
+        // remote clients may query any channel. The sources of the math channel aren't measured otherwise.
+        if (channel < (unsigned)scope->voltage.count()) {
+            if (scope->spectrum[channel].used) demands[channel] |= DEMAND_SPECTRUM;
+            if (measureAll || scope->voltage[channel].used || scope->spectrum[channel].used)
+                demands[channel] |= DEMAND_LEVELS | DEMAND_FREQUENCY;
+        }
+        // The frequency estimators from the spectrum need the transform on the cpu anyway
+        if (offload && (demands[channel] & DEMAND_SPECTRUM) &&
+            !((demands[channel] & DEMAND_FREQUENCY) && spectralFrequency)) {
+            demands[channel] &= ~DEMAND_SPECTRUM;
+            channelData->spectrumOffloaded = true;
         }
+    }
+    // The phases are measured against the edges of the first channel
+    if (((scope->measurements >> Dso::MEASUREMENT_PHASE) & 1u) &&
+        std::any_of(demands.begin(), demands.end(), [](unsigned int demand) { return demand & DEMAND_LEVELS; }))
+        demands[0] |= DEMAND_LEVELS;
+
+    // The channels are independent, the math channel was already calculated from its sources
+    if (channels.size() == 1 || workers.maxThreadCount() < 2) {
+        for (unsigned int channel : channels) analyzeChannel(result->modifyData(channel), channel);
+        return;
+    }
+    for (unsigned int channel : channels) {
+        DataChannel *const channelData = result->modifyData(channel);
+        workers.start(new AnalysisJob([this, channelData, channel]() {
+            workerScheduling.applyOnce();
+            analyzeChannel(channelData, channel);
+        }));
+    }
+    workers.waitForDone();
+}
 
-        // Set sampling interval
-        channelData->spectrum.interval = 1.0 / channelData->voltage.interval / sampleCount;
+/// \brief Calculates the spectrum, amplitude, frequency and measurements of one channel.
+/// Only uses the scratch buffers of the channel, so the channels can be analyzed in parallel. Only the outputs
+/// in the Demand of the channel are calculated, the transforms are skipped if no output needs them.
+/// \param channelData The data of the channel, the voltage samples have to be set.
+/// \param channel The index of the channel.
+void DataAnalyzer::analyzeChannel(DataChannel *channelData, unsigned int channel) {
+    AnalysisScratch &scratch = this->scratch[channel];
+    unsigned int sampleCount = channelData->voltage.sample.size();
+
+    // The voltages at the markers are always read, the samples between them are only analyzed on request
+    size_t regionFirst, regionLength;
+    const bool region = markerRegion(channelData, regionFirst, regionLength) && scope->analysisRegion;
+    size_t measuredLengths[2];
+    const double *measured[2] = {channelData->voltage.span(0, measuredLengths[0]),
+                                 channelData->voltage.span(1, measuredLengths[1])};
+    if (region) {
+        // Without roll mode the record is a single span
+        measured[0] += regionFirst;
+        measuredLengths[0] = regionLength;
+        measuredLengths[1] = 0;
+    }
 
-        // Number of real/complex samples
-        unsigned int dftLength = sampleCount / 2;
+    // Calculate peak-to-peak voltage, mean and RMS, the order of the samples doesn't matter for them
+    const unsigned int demand = demands[channel];
+    Analysis::SampleStatistics statistics;
+    if (demand & (DEMAND_LEVELS | DEMAND_FREQUENCY)) {
+        statistics = region ? Analysis::sampleStatistics(measured[0], (unsigned)measuredLengths[0])
+                            : Analysis::sampleStatistics(channelData->voltage.sample.data(), sampleCount);
+        channelData->amplitude = statistics.maximum - statistics.minimum;
+        channelData->mean = statistics.mean;
+        channelData->rms = statistics.rms;
+    }
+    if (demand & DEMAND_LEVELS) {
+        scratch.measurement.measure(measured, measuredLengths, channelData->voltage.interval, statistics,
+                                    scope->measurements);
+        scratch.measurement.finish(channelData->measurements);
+    }
 
-        // Reallocate memory for samples if the sample count has changed
-        channelData->spectrum.sample.resize(sampleCount);
+    // The zero crossings don't need the spectrum, without a consumer of the spectrum it isn't calculated at all
+    const bool timeFrequency = scope->frequencyEstimator == Dso::FREQUENCY_ZEROCROSSING;
+    if ((demand & DEMAND_FREQUENCY) && timeFrequency)
+        channelData->frequency =
+            zeroCrossingFrequency(measured, measuredLengths, channelData->voltage.interval, statistics);
+    if (!(demand & DEMAND_SPECTRUM) && (!(demand & DEMAND_FREQUENCY) || timeFrequency)) {
+        channelData->spectrum.interval = 0;
+        channelData->spectrum.sample.clear();
+        channelData->spectrogram.sample.clear();
+        channelData->spectrogramBins = 0;
+        scratch.averager.reset();
+        return;
+    }
 
-        // Create sample buffer and apply window
-        std::unique_ptr<double[]> windowedValues = std::unique_ptr<double[]>(new double[sampleCount]);
+    // The spectrum is calculated from the whole record, or from the latest segment of the roll history
+    size_t spanLengths[2];
+    const double *spans[2] = {channelData->voltage.span(0, spanLengths[0]),
+                              channelData->voltage.span(1, spanLengths[1])};
+    if (region && scope->spectrumRegion && regionLength >= REGION_SPECTRUM_MIN) {
+        // Or from the samples between the markers, the lengths are rounded to fast ones that moving markers share.
+        // They stay even like the records, the spectrum has length / 2 + 1 bins
+        spans[0] = measured[0];
+        spanLengths[0] = 2 * smoothLength(regionLength / 2);
+    } else if (rolling && sampleCount > ROLL_SEGMENT_LENGTH) {
+        size_t skip = sampleCount - ROLL_SEGMENT_LENGTH;
+        if (skip >= spanLengths[0]) {
+            skip -= spanLengths[0];
+            spans[0] = spans[1] + skip;
+            spanLengths[0] = spanLengths[1] - skip;
+            spanLengths[1] = 0;
+        } else {
+            spans[0] += skip;
+            spanLengths[0] -= skip;
+        }
+    }
+    unsigned int spectrumLength = spanLengths[0] + spanLengths[1];
+
+    // Set sampling interval, the zoomed spectrum has narrower bins
+    const double binWidth = 1.0 / channelData->voltage.interval / spectrumLength;
+    channelData->spectrum.interval = binWidth;
+
+    // Number of real/complex samples
+    unsigned int dftLength = spectrumLength / 2;
+
+    // The zoomed spectrum replaces the real spectrum, the record is then only transformed for the frequency
+    const bool spectrumUsed = (demand & DEMAND_SPECTRUM) != 0;
+    const bool zoomed = spectrumUsed && scope->spectrumZoom;
+    const bool frequencyUsed = (demand & DEMAND_FREQUENCY) && !timeFrequency;
+    if (spectrumUsed && !zoomed)
+        channelData->spectrum.sample.resize(dftLength + 1);
+    else
+        channelData->spectrum.sample.clear();
+    channelData->spectrumStart = 0.0;
+    double *spectrum = channelData->spectrum.sample.data();
+
+    // Apply window, the aligned buffers of this channel are reused between frames
+    double *windowedValues = scratch.windowed.reserve(spectrumLength);
+    // The power spectrum replaces the windowed values, it is used by the frequency estimators
+    double *powerSpectrum = windowedValues;
+    double correctionFactor = 1.0 / dftLength / dftLength;
+
+    // Convert values into dB (Relative to the reference level), the power is already scaled by the correction factor
+    double offset = 60 - scope->spectrumReference - 20 * log10(dftLength) - 10 * log10(correctionFactor);
+    double offsetLimit = scope->spectrumLimit - scope->spectrumReference;
+
+    if (!zoomed || frequencyUsed) {
+        WindowCache::Window window = WindowCache::instance().window(scope->spectrumWindow, spectrumLength);
+        double *complexSpectrum = scratch.complexSpectrum.reserve(2 * (dftLength + 1));
+        if (scope->spectrumSinglePrecision) {
+            // Twice the floats fit into the SIMD registers, the floats of a buffer take the space of half the doubles.
+            // Only the unique bins are widened again, the levels are calculated like for the double precision transform
+            float *windowedSingle = reinterpret_cast<float *>(scratch.singleWindowed.reserve(spectrumLength / 2 + 1));
+            float *complexSingle = reinterpret_cast<float *>(scratch.singleSpectrum.reserve(dftLength + 1));
+            for (unsigned int position = 0; position < spanLengths[0]; ++position)
+                windowedSingle[position] = (float)((*window)[position] * spans[0][position]);
+            for (unsigned int position = 0; position < spanLengths[1]; ++position)
+                windowedSingle[spanLengths[0] + position] =
+                    (float)((*window)[spanLengths[0] + position] * spans[1][position]);
+
+            FftPlanCache::SinglePlan fftPlan =
+                FftPlanCache::instance().plan(FftPlanCache::KIND_R2C, spectrumLength, windowedSingle, complexSingle);
+            fftwf_execute_dft_r2c(fftPlan.get(), windowedSingle, reinterpret_cast<fftwf_complex *>(complexSingle));
+            std::copy(complexSingle, complexSingle + 2 * (dftLength + 1), complexSpectrum);
+        } else {
+            for (unsigned int position = 0; position < spanLengths[0]; ++position)
+                windowedValues[position] = (*window)[position] * spans[0][position];
+            for (unsigned int position = 0; position < spanLengths[1]; ++position)
+                windowedValues[spanLengths[0] + position] = (*window)[spanLengths[0] + position] * spans[1][position];
+
+            // Do discrete real to complex transformation, only the dftLength + 1 unique bins are calculated
+            FftPlanCache::Plan fftPlan =
+                FftPlanCache::instance().plan(FftPlanCache::KIND_R2C, spectrumLength, windowedValues, complexSpectrum);
+            fftw_execute_dft_r2c(fftPlan.get(), windowedValues, reinterpret_cast<fftw_complex *>(complexSpectrum));
+        }
 
-        for (unsigned int position = 0; position < sampleCount; ++position)
-            windowedValues[position] = lastWindowBuffer[position] * channelData->voltage.sample[position];
+        // Real values are the power of the unique bins, the levels are limited to the minimum magnitude
+        Analysis::complexPower(complexSpectrum, dftLength + 1, correctionFactor, powerSpectrum,
+                               (spectrumUsed && !zoomed) ? spectrum : nullptr, offset, offsetLimit);
+    }
 
-        {
-            // Do discrete real to half-complex transformation
-            /// \todo Check if record length is multiple of 2
-            /// \todo Reuse plan and use FFTW_MEASURE to get fastest algorithm
-            fftw_plan fftPlan = fftw_plan_r2r_1d(sampleCount, windowedValues.get(),
-                                                 &channelData->spectrum.sample.front(), FFTW_R2HC, FFTW_ESTIMATE);
-            fftw_execute(fftPlan);
-            fftw_destroy_plan(fftPlan);
+    // The frequency estimators still use the power spectrum of the unzoomed transform
+    if (zoomed) {
+        ZoomFft &zoom = scratch.zoom;
+        const unsigned int binCount = zoom.transform(spans, spanLengths, channelData->voltage.interval,
+                                                     scope->spectrumZoomCenter, scope->spectrumZoomFactor,
+                                                     scope->spectrumWindow);
+        if (binCount) {
+            // The levels are scaled like the spectrum of the whole record
+            const unsigned int zoomLength = binCount / 2;
+            const double zoomCorrection = 1.0 / zoomLength / zoomLength;
+            offset = 60 - scope->spectrumReference - 20 * log10(zoomLength) - 10 * log10(zoomCorrection);
+            channelData->spectrum.sample.resize(binCount);
+            channelData->spectrum.interval = zoom.binWidth();
+            channelData->spectrumStart = zoom.start();
+            spectrum = channelData->spectrum.sample.data();
+            Analysis::complexPower(zoom.bins(), binCount, zoomCorrection, zoom.power(), spectrum, offset,
+                                   offsetLimit);
+            scratch.averager.add(spectrum, zoom.power(), binCount, zoom.start(), zoom.binWidth(), offset,
+                                 offsetLimit);
+        } else {
+            scratch.averager.reset();
         }
+    } else if (spectrumUsed) {
+        // Average the levels over the frames, a hidden spectrum starts a new average when it is shown again
+        scratch.averager.add(spectrum, powerSpectrum, dftLength + 1, 0.0, binWidth, offset, offsetLimit);
+    } else {
+        scratch.averager.reset();
+    }
+
+    // The spectrogram shows the spectra of short segments of the record
+    if (spectrumUsed && scope->spectrogram) {
+        shortTimeSpectra(channelData, scratch.segment, scratch.segmentSpectrum, spans, spanLengths);
+    } else {
+        channelData->spectrogram.sample.clear();
+        channelData->spectrogramBins = 0;
+    }
+
+    // Calculate the frequency in Hz from the spectrum
+    if (!frequencyUsed) return;
+    switch (scope->frequencyEstimator) {
+    case Dso::FREQUENCY_SPECTRALPEAK:
+        channelData->frequency =
+            spectralPeakFrequency(powerSpectrum, dftLength + 1, binWidth);
+        break;
+    default: // Dso::FREQUENCY_AUTOCORRELATION
+        channelData->frequency = autocorrelationFrequency(powerSpectrum, spectrumLength, scratch.correlation,
+                                                          channelData->voltage.interval);
+    }
+}
+
+/// \brief Gets the voltages at the markers and the samples between them.
+/// The markers are placed on the record like on the screen, see screenStart().
+/// \param channelData The data of the channel, the voltages at the markers are set.
+/// \param first Set to the first sample between the markers.
+/// \param length Set to the number of samples between the markers.
+/// \return true, if there are at least two samples between the markers.
+bool DataAnalyzer::markerRegion(DataChannel *channelData, size_t &first, size_t &length) const {
+    const SampleValues &voltage = channelData->voltage;
+    const size_t sampleCount = voltage.sample.size();
+    first = 0;
+    length = sampleCount;
+    channelData->markerVoltages.fill(std::numeric_limits<double>::quiet_NaN());
+    if (!screenShown || voltage.interval <= 0.0 || sampleCount < 2) return false;
+
+    double positions[MARKER_COUNT];
+    for (int marker = 0; marker < MARKER_COUNT; ++marker) {
+        // The markers are in divs from the center, the first sample on the screen is triggerShift after the edge
+        const double time = (scope->horizontal.marker[marker] + DIVS_TIME / 2) * scope->horizontal.timebase;
+        const double position = screenFirst + (time - screenShift) / voltage.interval;
+        positions[marker] = position;
+        if (position < 0.0 || position > sampleCount - 1.0) continue;
+        const size_t index = std::min((size_t)position, sampleCount - 2);
+        channelData->markerVoltages[marker] =
+            voltage.sample[index] + (position - index) * (voltage.sample[index + 1] - voltage.sample[index]);
+    }
+
+    const double start = std::max(std::ceil(std::min(positions[0], positions[1])), 0.0);
+    const double end = std::min(std::floor(std::max(positions[0], positions[1])), sampleCount - 1.0);
+    if (end - start < 1.0) return false;
+    first = (size_t)start;
+    length = (size_t)(end - start) + 1;
+    return true;
+}
+
+/// \brief Calculates the short time spectra of a record for the spectrogram.
+/// The segments overlap by half, if a long record has more than
+/// SPECTROGRAM_MAX_ROWS segments they are spread evenly over the record. In
+/// roll mode only the newest segment is used, the older ones were in the
+/// previous frames. The plans and windows are shared with the spectrum.
+/// \param channelData The data of the channel, the spectrogram is set.
+/// \param segmentBuffer The scratch buffer for the windowed segment.
+/// \param spectrumBuffer The scratch buffer for the complex spectrum of the segment.
+/// \param spans The samples of the spectrum as two contiguous spans.
+/// \param spanLengths The number of samples in the spans.
+void DataAnalyzer::shortTimeSpectra(DataChannel *channelData, ScratchBuffer &segmentBuffer,
+                                    ScratchBuffer &spectrumBuffer, const double *const spans[2],
+                                    const size_t spanLengths[2]) {
+    const size_t recordLength = spanLengths[0] + spanLengths[1];
+    unsigned int segmentLength = std::max(scope->spectrogramSegment, SPECTROGRAM_MIN_SEGMENT);
+    while (segmentLength > recordLength && segmentLength > SPECTROGRAM_MIN_SEGMENT) segmentLength /= 2;
+    if (segmentLength > recordLength) {
+        channelData->spectrogram.sample.clear();
+        channelData->spectrogramBins = 0;
+        return;
+    }
 
-        // Do an autocorrelation to get the frequency of the signal
-        std::unique_ptr<double[]> conjugateComplex = std::move(windowedValues);
-
-        // Real values
-        unsigned int position;
-        double correctionFactor = 1.0 / dftLength / dftLength;
-        conjugateComplex[0] = (channelData->spectrum.sample[0] * channelData->spectrum.sample[0]) * correctionFactor;
-        for (position = 1; position < dftLength; ++position)
-            conjugateComplex[position] =
-                (channelData->spectrum.sample[position] * channelData->spectrum.sample[position] +
-                 channelData->spectrum.sample[sampleCount - position] *
-                     channelData->spectrum.sample[sampleCount - position]) *
-                correctionFactor;
-        // Complex values, all zero for autocorrelation
-        conjugateComplex[dftLength] =
-            (channelData->spectrum.sample[dftLength] * channelData->spectrum.sample[dftLength]) * correctionFactor;
-        for (++position; position < sampleCount; ++position) conjugateComplex[position] = 0;
-
-        // Do half-complex to real inverse transformation
-        std::unique_ptr<double[]> correlation = std::unique_ptr<double[]>(new double[sampleCount]);
-        fftw_plan fftPlan =
-            fftw_plan_r2r_1d(sampleCount, conjugateComplex.get(), correlation.get(), FFTW_HC2R, FFTW_ESTIMATE);
-        fftw_execute(fftPlan);
-        fftw_destroy_plan(fftPlan);
-
-        // Calculate peak-to-peak voltage
-        double minimalVoltage, maximalVoltage;
-        minimalVoltage = maximalVoltage = channelData->voltage.sample[0];
-
-        for (unsigned int position = 1; position < sampleCount; ++position) {
-            if (channelData->voltage.sample[position] < minimalVoltage)
-                minimalVoltage = channelData->voltage.sample[position];
-            else if (channelData->voltage.sample[position] > maximalVoltage)
-                maximalVoltage = channelData->voltage.sample[position];
+    const unsigned int binCount = segmentLength / 2 + 1;
+    const unsigned int rows =
+        rolling ? 1u
+                : (unsigned)std::min<size_t>((recordLength - segmentLength) / (segmentLength / 2) + 1,
+                                             SPECTROGRAM_MAX_ROWS);
+    const double hop = (rows > 1) ? (double)(recordLength - segmentLength) / (rows - 1) : 0.0;
+    const size_t firstStart = rolling ? recordLength - segmentLength : 0;
+
+    channelData->spectrogram.sample.resize((size_t)rows * binCount);
+    channelData->spectrogram.interval = 1.0 / channelData->voltage.interval / segmentLength;
+    channelData->spectrogramBins = binCount;
+
+    WindowCache::Window window = WindowCache::instance().window(scope->spectrumWindow, segmentLength);
+    double *segment = segmentBuffer.reserve(segmentLength);
+    double *complexSpectrum = spectrumBuffer.reserve(2 * binCount);
+    FftPlanCache::Plan fftPlan =
+        FftPlanCache::instance().plan(FftPlanCache::KIND_R2C, segmentLength, segment, complexSpectrum);
+
+    // The levels are scaled like the spectrum of the whole record
+    const unsigned int dftLength = segmentLength / 2;
+    const double correctionFactor = 1.0 / dftLength / dftLength;
+    const double offset = 60 - scope->spectrumReference - 20 * log10(dftLength) - 10 * log10(correctionFactor);
+    const double offsetLimit = scope->spectrumLimit - scope->spectrumReference;
+
+    for (unsigned int row = 0; row < rows; ++row) {
+        const size_t start = firstStart + (size_t)(row * hop + 0.5);
+        // The segment may reach from the older into the newer span in roll mode
+        const size_t inFirst = (start < spanLengths[0]) ? std::min<size_t>(spanLengths[0] - start, segmentLength) : 0;
+        for (size_t position = 0; position < inFirst; ++position)
+            segment[position] = (*window)[position] * spans[0][start + position];
+        if (inFirst < segmentLength) {
+            const double *newer = spans[1] + (start + inFirst - spanLengths[0]);
+            for (size_t position = inFirst; position < segmentLength; ++position)
+                segment[position] = (*window)[position] * newer[position - inFirst];
         }
 
-        channelData->amplitude = maximalVoltage - minimalVoltage;
+        fftw_execute_dft_r2c(fftPlan.get(), segment, reinterpret_cast<fftw_complex *>(complexSpectrum));
+        // The power replaces the segment, only the levels are kept
+        Analysis::complexPower(complexSpectrum, binCount, correctionFactor, segment,
+                               channelData->spectrogram.sample.data() + (size_t)row * binCount, offset, offsetLimit);
+    }
+}
+
+/// \brief Measures the phase of all channels against the first channel.
+/// The edges were found by the analysis of the channels.
+void DataAnalyzer::measurePhases(DataAnalyzerResult *result) {
+    if (!((scope->measurements >> Dso::MEASUREMENT_PHASE) & 1u) || result->channelCount() == 0 ||
+        result->data(0)->voltage.sample.empty())
+        return;
+
+    const MeasurementEngine &reference = scratch[0].measurement;
+    for (unsigned int channel = 0; channel < result->channelCount(); ++channel) {
+        DataChannel *const channelData = result->modifyData(channel);
+        if (channelData->voltage.sample.empty() || !(demands[channel] & DEMAND_LEVELS)) continue;
+        channelData->measurements[Dso::MEASUREMENT_PHASE] = scratch[channel].measurement.phase(reference);
+    }
+}
+
+void DataAnalyzer::resetStatistics() { historyReset.storeRelease(1); }
+
+void DataAnalyzer::resetSpectrumAverages() { averagesReset.storeRelease(1); }
+
+void DataAnalyzer::setSpectrumOffload(bool enabled) { spectrumOffload.storeRelease(enabled ? 1 : 0); }
+
+void DataAnalyzer::setMeasureAllChannels(bool enabled) { measureAllChannels.storeRelease(enabled ? 1 : 0); }
 
-        // Get the frequency from the correlation results
-        double minimumCorrelation = correlation[0];
-        double peakCorrelation = 0;
-        unsigned int peakPosition = 0;
+/// \brief Adds the measurements of the frame to the statistics and copies the statistics to the result.
+void DataAnalyzer::accumulateStatistics(DataAnalyzerResult *result) {
+    if (historyReset.fetchAndStoreAcquire(0))
+        for (auto &channel : measurementHistory)
+            for (RunningStatistics &statistics : channel) statistics.reset();
+    if (measurementHistory.size() < result->channelCount()) measurementHistory.resize(result->channelCount());
 
-        for (unsigned int position = 1; position < sampleCount / 2; ++position) {
-            if (correlation[position] > peakCorrelation && correlation[position] > minimumCorrelation * 2) {
-                peakCorrelation = correlation[position];
-                peakPosition = position;
-            } else if (correlation[position] < minimumCorrelation)
-                minimumCorrelation = correlation[position];
+    for (unsigned int channel = 0; channel < result->channelCount(); ++channel) {
+        DataChannel *const channelData = result->modifyData(channel);
+        if (channelData->voltage.sample.empty() || !(demands[channel] & DEMAND_LEVELS)) continue;
+        for (int measurement = 0; measurement < Dso::MEASUREMENT_COUNT; ++measurement) {
+            RunningStatistics &statistics = measurementHistory[channel][measurement];
+            statistics.add(channelData->measurements[measurement]);
+            channelData->measurementStatistics[measurement] = statistics.summary();
         }
-        correlation.reset(nullptr);
-
-        // Calculate the frequency in Hz
-        if (peakPosition)
-            channelData->frequency = 1.0 / (channelData->voltage.interval * peakPosition);
-        else
-            channelData->frequency = 0;
-
-        // Finally calculate the real spectrum if we want it
-        if (scope->spectrum[channel].used) {
-            // Convert values into dB (Relative to the reference level)
-            double offset = 60 - scope->spectrumReference - 20 * log10(dftLength);
-            double offsetLimit = scope->spectrumLimit - scope->spectrumReference;
-            for (std::vector<double>::iterator spectrumIterator = channelData->spectrum.sample.begin();
-                 spectrumIterator != channelData->spectrum.sample.end(); ++spectrumIterator) {
-                double value = 20 * log10(fabs(*spectrumIterator)) + offset;
-
-                // Check if this value has to be limited
-                if (offsetLimit > value) value = offsetLimit;
-
-                *spectrumIterator = value;
+    }
+}
+
+/// \brief Gets the frequency from the autocorrelation of the signal.
+/// \param powerSpectrum The power of the dft bins, the buffer is overwritten.
+/// \param sampleCount The record length.
+/// \param buffer The scratch buffer for the correlation.
+/// \param interval The interval between two samples in s.
+/// \return The frequency in Hz, 0 if no period was found.
+double DataAnalyzer::autocorrelationFrequency(double *powerSpectrum, unsigned int sampleCount, ScratchBuffer &buffer,
+                                              double interval) {
+    // The power spectrum forms the real values, the complex values are all zero for autocorrelation
+    double *conjugateComplex = powerSpectrum;
+    for (unsigned int position = sampleCount / 2 + 1; position < sampleCount; ++position)
+        conjugateComplex[position] = 0;
+
+    // Do half-complex to real inverse transformation
+    double *correlation = buffer.reserve(sampleCount);
+    FftPlanCache::Plan fftPlan =
+        FftPlanCache::instance().plan(FftPlanCache::KIND_HC2R, sampleCount, conjugateComplex, correlation);
+    fftw_execute_r2r(fftPlan.get(), conjugateComplex, correlation);
+
+    // Get the frequency from the correlation results
+    double minimumCorrelation = correlation[0];
+    double peakCorrelation = 0;
+    unsigned int peakPosition = 0;
+
+    for (unsigned int position = 1; position < sampleCount / 2; ++position) {
+        if (correlation[position] > peakCorrelation && correlation[position] > minimumCorrelation * 2) {
+            peakCorrelation = correlation[position];
+            peakPosition = position;
+        } else if (correlation[position] < minimumCorrelation)
+            minimumCorrelation = correlation[position];
+    }
+
+    if (peakPosition) return 1.0 / (interval * peakPosition);
+    return 0;
+}
+
+/// \brief Gets the frequency from the crossings of the mean voltage.
+/// The signal has to leave a band of 10% of the amplitude around the mean before
+/// the next rising crossing is counted, so noise doesn't add crossings. The
+/// crossing times are interpolated linearly between the samples.
+/// \param spans The voltage samples as two contiguous spans, from the oldest to the newest sample.
+/// \param spanLengths The number of samples in the spans.
+/// \param interval The time between two samples in s.
+/// \param statistics The statistics of the samples.
+/// \return The frequency in Hz, 0 if there were less than two crossings.
+double DataAnalyzer::zeroCrossingFrequency(const double *const spans[2], const size_t spanLengths[2], double interval,
+                                           const Analysis::SampleStatistics &statistics) {
+    const double level = statistics.mean;
+    const double hysteresis = (statistics.maximum - statistics.minimum) * 0.05;
+    if (hysteresis <= 0 || spanLengths[0] + spanLengths[1] == 0) return 0;
+
+    bool armed = false;
+    unsigned int crossings = 0;
+    double firstCrossing = 0, lastCrossing = 0;
+    double previous = spanLengths[0] ? spans[0][0] : spans[1][0];
+    size_t position = 0;
+    for (unsigned int part = 0; part < 2; ++part) {
+        for (size_t index = 0; index < spanLengths[part]; ++index, ++position) {
+            const double value = spans[part][index];
+            if (value < level - hysteresis)
+                armed = true;
+            else if (armed && previous < level && value >= level) {
+                double crossing = position - (value - level) / (value - previous);
+                if (crossings == 0) firstCrossing = crossing;
+                lastCrossing = crossing;
+                ++crossings;
+                armed = false;
             }
+            previous = value;
         }
     }
+
+    if (crossings < 2) return 0;
+    return (crossings - 1) / ((lastCrossing - firstCrossing) * interval);
+}
+
+/// \brief Gets the frequency of the strongest bin of the spectrum.
+/// The position of the peak is interpolated with a parabola through the
+/// logarithmic power of the bin and its neighbours.
+/// \param powerSpectrum The power of the dft bins.
+/// \param binCount The number of bins.
+/// \param binWidth The frequency step between two bins in Hz.
+/// \return The frequency in Hz, 0 if there is no peak besides the dc bin.
+double DataAnalyzer::spectralPeakFrequency(const double *powerSpectrum, unsigned int binCount, double binWidth) {
+    unsigned int peakBin = 0;
+    for (unsigned int bin = 1; bin + 1 < binCount; ++bin)
+        if (peakBin == 0 || powerSpectrum[bin] > powerSpectrum[peakBin]) peakBin = bin;
+    if (peakBin == 0 || powerSpectrum[peakBin] <= 0) return 0;
+
+    double offset = 0;
+    if (powerSpectrum[peakBin - 1] > 0 && powerSpectrum[peakBin + 1] > 0) {
+        const double left = std::log(powerSpectrum[peakBin - 1]);
+        const double center = std::log(powerSpectrum[peakBin]);
+        const double right = std::log(powerSpectrum[peakBin + 1]);
+        const double curvature = left - 2 * center + right;
+        if (curvature < 0) offset = 0.5 * (left - right) / curvature;
+    }
+
+    return (peakBin + offset) * binWidth;
 }
@@ -4,14 +4,30 @@
 
 #include <vector>
 
+#include <QAtomicInt>
 #include <QMutex>
 #include <QThread>
+#include <QThreadPool>
 #include <memory>
 
+#include "analysiskernels.h"
+#include "channelfilter.h"
 #include "dataanalyzerresult.h"
 #include "definitions.h"
 #include "dsosamples.h"
+#include "equivalenttime.h"
+#include "masktest.h"
+#include "mathengine.h"
+#include "measurementengine.h"
+#include "protocoldecoder.h"
+#include "resultpool.h"
+#include "samplering.h"
+#include "scratchbuffer.h"
+#include "softwaretrigger.h"
+#include "spectrumaverager.h"
+#include "zoomfft.h"
 #include "utils/printutils.h"
+#include "utils/threadscheduling.h"
 
 struct DsoSettingsScope;
 
@@ -24,28 +40,156 @@ class DataAnalyzer : public QObject {
     Q_OBJECT
 
   public:
-    ~DataAnalyzer();
     void applySettings(DsoSettingsScope *scope);
-    void setSourceData(const DSOsamples *data);
-    std::unique_ptr<DataAnalyzerResult> getNextResult();
+    void setSourceData(DSOsampleBuffer *data);
+    /// \brief Sets the scheduling of the threads that analyze the channels in parallel.
+    /// Has to be called before the analysis starts.
+    void setWorkerScheduling(const ThreadScheduling &scheduling) { workerScheduling = scheduling; }
+    std::shared_ptr<const DataAnalyzerResult> getNextResult();
     /**
      * Call this if the source data changed.
      */
     void samplesAvailable();
+    /// \brief Restarts the statistics of the measurements with the next frame.
+    /// Can be called from any thread.
+    void resetStatistics();
+    /// \brief Restarts the spectrum averages and holds with the next frame.
+    /// Can be called from any thread.
+    void resetSpectrumAverages();
+    /// \brief Leaves the spectra of the whole records to the scopes, if DsoSettingsScope::spectrumGpu is set.
+    /// Only plain spectra are left, the analyzer still transforms the records that are averaged, zoomed or
+    /// needed for the frequency. Can be called from any thread.
+    /// \param enabled true, if the scopes can transform the records on the gpu.
+    void setSpectrumOffload(bool enabled);
+    /// \brief Measures the levels and the frequency of every channel with data, not only of the shown ones.
+    /// Used by remote clients that query any channel. Can be called from any thread.
+    /// \param enabled true, if every channel is measured.
+    void setMeasureAllChannels(bool enabled);
+    /// \brief Sets the mask of the mask test, it is taken with the next frame.
+    /// Can be called from any thread.
+    void setMask(const std::vector<QPolygonF> &polygons);
+    /// \brief Sets the formula of Dso::MATHMODE_EXPRESSION, it is taken with the next frame.
+    /// Can be called from any thread.
+    void setMathExpression(const QString &formula);
+    /// \brief Creates a mask around the graph of the next frame, it is set as the mask and passed in
+    /// MaskResult::created. Can be called from any thread.
+    /// \param xTolerance The horizontal distance from the graph in divs.
+    /// \param yTolerance The vertical distance from the graph in divs.
+    void createMask(double xTolerance, double yTolerance);
+    /// \brief Restarts the counters of the mask test with the next frame.
+    /// Can be called from any thread.
+    void resetMaskCounters();
+
+    /// \brief Calculates the position of the samples on the screen.
+    /// In software trigger mode the screen begins the pretrigger samples before the trigger point.
+    /// \param result The analyzed frame.
+    /// \param scope The settings the frame is shown with.
+    /// \param firstSample Set to the first sample on the screen.
+    /// \param triggerShift Set to the time of the first sample from the left edge of the screen in s.
+    /// \return false, if the software trigger wasn't asserted, the frame isn't shown then.
+    static bool screenStart(const DataAnalyzerResult *result, const DsoSettingsScope *scope,
+                            unsigned int &firstSample, double &triggerShift);
+
+    /// \brief Converts a frame into a new result, the first stage of the analysis.
+    /// Like spectrumAnalysis() it can be called in any thread that doesn't run the analysis at the same time,
+    /// so the stages can be run without samplesAvailable().
+    /// \param data The frame, its voltages are taken over by the result.
+    /// \param scope The settings the frame is analyzed with.
+    /// \return The result, it is taken from the pool of results.
+    std::shared_ptr<DataAnalyzerResult> convertData(DSOsamples *data, const DsoSettingsScope *scope);
+    /// \brief Analyzes all channels with data, on the worker pool if there are several.
+    void spectrumAnalysis(DataAnalyzerResult *result);
 
   private:
-    static std::unique_ptr<DataAnalyzerResult> convertData(const DSOsamples *data, const DsoSettingsScope *scope);
-    static void spectrumAnalysis(DataAnalyzerResult *result, Dso::WindowFunction &lastWindow,
-                                 unsigned int lastRecordLength, double *&lastWindowBuffer,
-                                 const DsoSettingsScope *scope);
+    bool isVoltageNeeded(unsigned int channel, const DsoSettingsScope *scope) const;
+    void decodeProtocol(DataAnalyzerResult *result);
+    void findTrigger(DataAnalyzerResult *result);
+    void sampleEquivalentTime(DataAnalyzerResult *result);
+    void testMask(DataAnalyzerResult *result);
+    void analyzeChannel(DataChannel *channelData, unsigned int channel);
+    bool markerRegion(DataChannel *channelData, size_t &first, size_t &length) const;
+    void shortTimeSpectra(DataChannel *channelData, ScratchBuffer &segmentBuffer, ScratchBuffer &spectrumBuffer,
+                          const double *const spans[2], const size_t spanLengths[2]);
+    void measurePhases(DataAnalyzerResult *result);
+    void accumulateStatistics(DataAnalyzerResult *result);
+    static double autocorrelationFrequency(double *powerSpectrum, unsigned int sampleCount, ScratchBuffer &buffer,
+                                           double interval);
+    static double zeroCrossingFrequency(const double *const spans[2], const size_t spanLengths[2], double interval,
+                                        const Analysis::SampleStatistics &statistics);
+    static double spectralPeakFrequency(const double *powerSpectrum, unsigned int binCount, double binWidth);
+
+    static const unsigned int ROLL_SEGMENT_LENGTH = 4096;  ///< Samples in the roll mode spectrum
+    static const unsigned int ROLL_HISTORY_MAX = 1u << 22; ///< Maximal samples in the roll history of a channel
+    static const unsigned int SPECTROGRAM_MIN_SEGMENT = 64; ///< Minimal samples in a segment of the spectrogram
+    static const unsigned int SPECTROGRAM_MAX_ROWS = 32;    ///< Maximal spectrogram rows of a frame
+    static const unsigned int REGION_SPECTRUM_MIN = 64;     ///< Minimal samples in the spectrum between the markers
+
+    /// \enum Demand
+    /// \brief The outputs of a channel analysis, a stage only runs if one of its outputs has a consumer.
+    enum Demand : unsigned int {
+        DEMAND_SPECTRUM = 1u << 0,  ///< The spectrum and the spectrogram
+        DEMAND_LEVELS = 1u << 1,    ///< The amplitude, mean, RMS and the measurements
+        DEMAND_FREQUENCY = 1u << 2, ///< The frequency
+    };
+
+    /// \brief Buffers of a channel analysis that are reused between frames.
+    struct AnalysisScratch {
+        ScratchBuffer windowed;        ///< The windowed samples, reused for the autocorrelation spectrum
+        ScratchBuffer complexSpectrum; ///< The complex spectrum of the samples, only the unique bins
+        ScratchBuffer singleWindowed;  ///< The windowed samples as floats for the single precision transform
+        ScratchBuffer singleSpectrum;  ///< The complex spectrum as floats of the single precision transform
+        ScratchBuffer correlation;     ///< The autocorrelation of the samples
+        ScratchBuffer segment;         ///< A windowed segment of the spectrogram, then its power
+        ScratchBuffer segmentSpectrum; ///< The complex spectrum of a segment of the spectrogram
+        MeasurementEngine measurement; ///< Measures the samples, keeps the edges for the phase
+        SpectrumAverager averager;     ///< Averages the spectrum over the frames
+        ZoomFft zoom;                  ///< Calculates the zoomed spectrum
+    };
 
   private:
     DsoSettingsScope *scope;
-    unsigned int lastRecordLength = 0;                        ///< The record length of the previously analyzed data
-    Dso::WindowFunction lastWindow = (Dso::WindowFunction)-1; ///< The previously used dft window function
-    double *window = nullptr;
-    const DSOsamples *sourceData = nullptr;
-    std::unique_ptr<DataAnalyzerResult> lastResult;
+    DSOsampleBuffer *sourceData = nullptr;
+    /// Protects lastResult, the newest result that wasn't fetched by the gui thread yet
+    QMutex resultMutex;
+    std::shared_ptr<DataAnalyzerResult> lastResult;
+    std::shared_ptr<ResultPool> resultPool = std::make_shared<ResultPool>(); ///< Recycles the results
+    std::vector<AnalysisScratch> scratch; ///< Scratch buffers for every channel
+    std::vector<unsigned int> demands;    ///< The Demand of every channel of the current result
+    bool rolling = false;                 ///< true, if the current result is from roll mode
+    bool screenShown = false;             ///< true, if the current result is placed like on the screen
+    unsigned int screenFirst = 0;         ///< The first sample of the current result on the screen
+    double screenShift = 0.0;             ///< The time of the first sample from the left edge of the screen in s
+    std::vector<SampleRing> rollHistory;  ///< The samples of the physical channels in roll mode
+    std::vector<double> arrivedSamples;   ///< The new samples of a channel in roll mode
+    std::vector<ChannelFilter> filters;   ///< The filters of the physical channels
+    size_t arrivedCount = 0;              ///< The number of new samples of every channel in roll mode
+    bool rollRestarted = false;           ///< true, if the roll history was restarted with this frame
+    ProtocolDecoder decoder;              ///< Decodes the serial protocol
+    MathEngine math;                      ///< Calculates the math channel
+    QMutex mathMutex;                     ///< Protects the formula of the math channel
+    QString mathExpression;               ///< The formula of the math channel, a copy of the settings
+    SoftwareTrigger trigger;              ///< Searches the trigger point in software trigger mode
+    MaskTest mask;                        ///< Tests the graphs against the mask
+    QMutex maskMutex;                     ///< Protects the requests of the mask test
+    std::vector<QPolygonF> pendingMask;   ///< The mask that is taken with the next frame
+    bool maskChanged = false;             ///< true, if there is a pending mask
+    bool maskRequested = false;           ///< true, if a mask has to be created around the next graph
+    double maskTolerances[2] = {};        ///< The horizontal and vertical distance of the created mask in divs
+    quint64 maskTotal = 0;                ///< The tested frames since the last reset
+    quint64 maskFailures = 0;             ///< The failed frames since the last reset
+    QAtomicInt maskCountersReset;         ///< Not 0, if the mask counters have to be restarted
+    QThreadPool workers;                  ///< Analyzes the channels in parallel
+    ThreadScheduling workerScheduling;    ///< Applied by the workers to their threads
+    QAtomicInt historyReset;              ///< Not 0, if the statistics have to be restarted
+    QAtomicInt averagesReset;             ///< Not 0, if the spectrum averages have to be restarted
+    QAtomicInt spectrumOffload;           ///< Not 0, if the scopes can calculate the spectra
+    QAtomicInt measureAllChannels;        ///< Not 0, if the hidden channels are measured too
+    /// The statistics of the measurements of every channel over the frames
+    std::vector<std::array<RunningStatistics, Dso::MEASUREMENT_COUNT>> measurementHistory;
+    /// The time grids of the physical channels in equivalent time mode
+    std::vector<EquivalentTimeSampler> equivalentTime;
+    /// The trigger position and source and the gain, offset and state of every channel the grids were sampled with
+    std::vector<double> equivalentTimeSettings;
   signals:
     void analyzed();
 };
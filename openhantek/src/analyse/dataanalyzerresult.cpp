@@ -2,9 +2,39 @@
 
 #include "dataanalyzerresult.h"
 #include <QDebug>
+#include <limits>
 #include <stdexcept>
 
-DataAnalyzerResult::DataAnalyzerResult(unsigned int channelCount) { analyzedData.resize(channelCount); }
+DataAnalyzerResult::DataAnalyzerResult(unsigned int channelCount) { reset(channelCount); }
+
+void DataAnalyzerResult::reset(unsigned int channelCount) {
+    analyzedData.resize(channelCount);
+    for (DataChannel &channel : analyzedData) {
+        for (SampleValues *values : {&channel.voltage, &channel.spectrum, &channel.spectrogram}) {
+            values->sample.clear();
+            values->interval = 0.0;
+            values->rotation = 0;
+        }
+        channel.spectrumStart = 0.0;
+        channel.spectrogramBins = 0;
+        channel.amplitude = 0.0;
+        channel.frequency = 0.0;
+        channel.mean = 0.0;
+        channel.rms = 0.0;
+        channel.measurements.fill(std::numeric_limits<double>::quiet_NaN());
+        channel.markerVoltages.fill(std::numeric_limits<double>::quiet_NaN());
+        channel.measurementStatistics.fill(RunningStatistics::Summary());
+    }
+    maxSamples = 0;
+    rolling = false;
+    trigger = -1.0;
+    frame = 0;
+    frameTimestamp = 0;
+    decoded.clear();
+    maskTest = MaskResult();
+    packedBlock.clear();
+    blockPacked = false;
+}
 
 /// \brief Returns the analyzed data.
 /// \param channel Channel, whose data should be returned.
@@ -34,3 +64,37 @@ void DataAnalyzerResult::challengeMaxSamples(unsigned int newMaxSamples) {
 }
 
 unsigned int DataAnalyzerResult::getMaxSamples() const { return maxSamples; }
+
+void DataAnalyzerResult::setRolling(bool rolling) { this->rolling = rolling; }
+
+bool DataAnalyzerResult::isRolling() const { return rolling; }
+
+void DataAnalyzerResult::setTriggerPoint(double position) { trigger = position; }
+
+double DataAnalyzerResult::triggerPoint() const { return trigger; }
+
+void DataAnalyzerResult::setFrame(quint64 id, qint64 timestamp) {
+    frame = id;
+    frameTimestamp = timestamp;
+}
+
+quint64 DataAnalyzerResult::frameId() const { return frame; }
+
+qint64 DataAnalyzerResult::timestamp() const { return frameTimestamp; }
+
+const std::vector<ProtocolAnnotation> &DataAnalyzerResult::annotations() const { return decoded; }
+
+std::vector<ProtocolAnnotation> &DataAnalyzerResult::modifyAnnotations() { return decoded; }
+
+const MaskResult &DataAnalyzerResult::mask() const { return maskTest; }
+
+MaskResult &DataAnalyzerResult::modifyMask() { return maskTest; }
+
+const FrameBlock &DataAnalyzerResult::block() const {
+    QMutexLocker locker(&blockMutex);
+    if (!blockPacked) {
+        packedBlock.pack(*this);
+        blockPacked = true;
+    }
+    return packedBlock;
+}
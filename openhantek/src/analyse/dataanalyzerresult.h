@@ -2,29 +2,108 @@
 
 #pragma once
 
+#include <QMutex>
+#include <QPolygonF>
+#include <QString>
+#include <QtGlobal>
+#include <array>
+#include <cstddef>
+#include <memory>
 #include <vector>
 
+#include "definitions.h"
+#include "frameblock.h"
+#include "runningstatistics.h"
+
 ////////////////////////////////////////////////////////////////////////////////
 /// \struct SampleValues                                          dataanalyzer.h
 /// \brief Struct for a array of sample values.
+/// In roll mode the vector is a full ring buffer, the samples start at the
+/// rotation and wrap around at the end of the vector.
 struct SampleValues {
-    std::vector<double> sample; ///< Vector holding the sampling data
-    double interval = 0.0;      ///< The interval between two sample values
+    std::vector<double> sample;      ///< Vector holding the sampling data
+    double interval = 0.0;           ///< The interval between two sample values
+    size_t rotation = 0;             ///< The index of the oldest sample in the vector
+    unsigned long long revision = 0; ///< The revision of the SampleRing the samples were copied at
+
+    /// \brief Gets the samples from the oldest to the newest as two contiguous spans.
+    /// \param part 0 for the older span, 1 for the newer span.
+    /// \param count Is set to the number of samples in the span.
+    /// \return The first sample of the span.
+    const double *span(unsigned int part, size_t &count) const {
+        if (part == 0) {
+            count = sample.size() - rotation;
+            return sample.data() + rotation;
+        }
+        count = rotation;
+        return sample.data();
+    }
+
+    /// \param index The position from the oldest sample.
+    /// \return The sample at the position.
+    double at(size_t index) const {
+        index += rotation;
+        if (index >= sample.size()) index -= sample.size();
+        return sample[index];
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 /// \struct AnalyzedData                                          dataanalyzer.h
 /// \brief Struct for the analyzed data.
 struct DataChannel {
-    SampleValues voltage;   ///< The time-domain voltage levels (V)
-    SampleValues spectrum;  ///< The frequency-domain power levels (dB)
-    double amplitude = 0.0; ///< The amplitude of the signal
-    double frequency = 0.0; ///< The frequency of the signal
+    SampleValues voltage;             ///< The time-domain voltage levels (V)
+    SampleValues spectrum;            ///< The frequency-domain power levels (dB)
+    double spectrumStart = 0.0;       ///< The frequency of the first spectrum bin, not 0 for a zoomed band (Hz)
+    /// The levels of the short time spectra of the record (dB), row by row from the oldest segment
+    SampleValues spectrogram;
+    unsigned int spectrogramBins = 0; ///< The number of bins in a row of the spectrogram
+    bool spectrumOffloaded = false;   ///< The spectrum is left to the gpu of the scopes, it is empty then
+    double amplitude = 0.0;           ///< The amplitude of the signal
+    double frequency = 0.0;           ///< The frequency of the signal
+    double mean = 0.0;                ///< The mean voltage of the signal (V)
+    double rms = 0.0;                 ///< The root mean square voltage of the signal (V)
+    /// The automatic measurements indexed by Dso::Measurement, NaN if disabled or not found in the signal
+    std::array<double, Dso::MEASUREMENT_COUNT> measurements;
+    /// The statistics of the measurements over the frames since the last reset
+    std::array<RunningStatistics::Summary, Dso::MEASUREMENT_COUNT> measurementStatistics;
+    /// The voltages at the markers (V), NaN if a marker is beyond the record or the frame isn't shown
+    std::array<double, MARKER_COUNT> markerVoltages;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \struct ProtocolAnnotation                                    dataanalyzer.h
+/// \brief A decoded part of a serial protocol, like a character or an address.
+struct ProtocolAnnotation {
+    double start = 0.0; ///< The first sample of the part, fractional between two samples
+    double end = 0.0;   ///< The last sample of the part, the same as start for conditions like a bus start
+    QString text;       ///< The decoded value
+    bool error = false; ///< true, if the part violates the protocol, like a parity or framing error
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \struct MaskResult                                            dataanalyzer.h
+/// \brief The mask test of a frame and the counters since the last reset.
+struct MaskResult {
+    bool tested = false;         ///< true, if the frame was tested against the mask
+    bool failed = false;         ///< true, if the graph touched the mask
+    bool keep = false;           ///< true, if the frame isn't replaced by a newer one before the gui fetched it
+    unsigned int violations = 0; ///< The pixel columns where the graph touched the mask
+    quint64 total = 0;           ///< The tested frames since the last reset
+    quint64 failures = 0;        ///< The failed frames since the last reset
+    /// The mask that was created around the graph of this frame on request, nullptr otherwise
+    std::shared_ptr<const std::vector<QPolygonF>> created;
 };
 
 class DataAnalyzerResult {
   public:
     DataAnalyzerResult(unsigned int channelCount);
+
+    /// \brief Prepares a recycled result for the next frame.
+    /// The samples are cleared, but the vectors keep their memory.
+    /// \param channelCount The number of channels.
+    void reset(unsigned int channelCount);
+
     const DataChannel *data(int channel) const;
     DataChannel *modifyData(int channel);
     unsigned int sampleCount() const;
@@ -38,7 +117,51 @@ class DataAnalyzerResult {
     void challengeMaxSamples(unsigned int newMaxSamples);
     unsigned int getMaxSamples() const;
 
+    /// \brief Marks the result as part of a roll mode acquisition.
+    void setRolling(bool rolling);
+    /// \return true, if the samples are the newest part of a roll mode acquisition.
+    bool isRolling() const;
+
+    /// \brief Sets the position of the software trigger.
+    /// \param position The crossing of the trigger level in samples from the first sample, negative if the trigger
+    /// wasn't asserted.
+    void setTriggerPoint(double position);
+    /// \return The position of the software trigger in samples, negative if there is none.
+    double triggerPoint() const;
+
+    /// \brief Sets the origin of the result.
+    /// \param id The id of the analyzed frame, see DSOsamples::frameId.
+    /// \param timestamp The steady clock time in ns the frame was received at.
+    void setFrame(quint64 id, qint64 timestamp);
+    /// \return The id of the analyzed frame, 0 if it is unknown.
+    quint64 frameId() const;
+    /// \return The steady clock time in ns the analyzed frame was received at.
+    qint64 timestamp() const;
+
+    /// \return The decoded protocol, the positions are samples from the first sample of the record.
+    const std::vector<ProtocolAnnotation> &annotations() const;
+    std::vector<ProtocolAnnotation> &modifyAnnotations();
+
+    /// \return The mask test of the frame.
+    const MaskResult &mask() const;
+    MaskResult &modifyMask();
+
+    /// \brief Gets the samples of the frame as a single contiguous block.
+    /// The block is packed by the first consumer that needs it and shared by the
+    /// others, it may only be requested after the analysis of the frame is complete.
+    /// \return The packed voltages and spectra of all channels.
+    const FrameBlock &block() const;
+
   private:
-    std::vector<DataChannel> analyzedData; ///< The analyzed data for each channel
-    unsigned int maxSamples = 0;           ///< The maximum record length of the analyzed data
+    std::vector<DataChannel> analyzedData;   ///< The analyzed data for each channel
+    unsigned int maxSamples = 0;             ///< The maximum record length of the analyzed data
+    bool rolling = false;                    ///< true, if the data is from roll mode
+    double trigger = -1.0;                   ///< The software trigger point in samples
+    quint64 frame = 0;                       ///< The id of the analyzed frame
+    qint64 frameTimestamp = 0;               ///< The time the analyzed frame was received at
+    std::vector<ProtocolAnnotation> decoded; ///< The annotations of the protocol decoder
+    MaskResult maskTest;                     ///< The mask test of the frame
+    mutable QMutex blockMutex;               ///< The block is packed by the thread that needs it first
+    mutable FrameBlock packedBlock;          ///< The contiguous copy of the samples
+    mutable bool blockPacked = false;        ///< true, if the block holds this frame
 };
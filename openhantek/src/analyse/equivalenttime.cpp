@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cmath>
+
+#include "equivalenttime.h"
+
+const unsigned EquivalentTimeSampler::MAXIMUM_FACTOR;
+const size_t EquivalentTimeSampler::MAXIMUM_STEPS;
+const unsigned EquivalentTimeSampler::AVERAGED_SAMPLES;
+
+void EquivalentTimeSampler::configure(unsigned factor, size_t steps) {
+    if (factor == this->factor && steps == mean.size()) return;
+    this->factor = factor;
+    mean.resize(steps);
+    counts.resize(steps);
+    reset();
+}
+
+void EquivalentTimeSampler::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    filled = 0;
+}
+
+void EquivalentTimeSampler::add(const double *samples, size_t count, double position) {
+    if (mean.empty() || !count) return;
+
+    // The samples before the grid are skipped, all samples of a frame fall into different steps
+    const double steps = (double)mean.size();
+    size_t first = 0;
+    if (position < -0.5) first = (size_t)std::ceil((-0.5 - position) / factor);
+    for (size_t index = first; index < count; ++index) {
+        const double step = std::floor(position + (double)index * factor + 0.5);
+        if (step >= steps) break;
+        if (step < 0.0) continue;
+        const size_t bin = (size_t)step;
+        if (!counts[bin]) {
+            counts[bin] = 1;
+            mean[bin] = samples[index];
+            ++filled;
+            continue;
+        }
+        if (counts[bin] < AVERAGED_SAMPLES) ++counts[bin];
+        mean[bin] += (samples[index] - mean[bin]) / counts[bin];
+    }
+}
+
+bool EquivalentTimeSampler::record(std::vector<double> &target) const {
+    target.resize(mean.size());
+    if (!filled) {
+        std::fill(target.begin(), target.end(), 0.0);
+        return false;
+    }
+
+    // The steps without a sample are interpolated linearly between their neighbours with samples
+    size_t previous = mean.size();
+    for (size_t step = 0; step < mean.size(); ++step) {
+        if (!counts[step]) continue;
+        target[step] = mean[step];
+        if (previous == mean.size()) {
+            std::fill(target.begin(), target.begin() + step, mean[step]);
+        } else if (step > previous + 1) {
+            const double slope = (mean[step] - mean[previous]) / (double)(step - previous);
+            for (size_t gap = previous + 1; gap < step; ++gap)
+                target[gap] = mean[previous] + slope * (double)(gap - previous);
+        }
+        previous = step;
+    }
+    std::fill(target.begin() + previous + 1, target.end(), mean[previous]);
+    return true;
+}
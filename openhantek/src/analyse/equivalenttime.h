@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class EquivalentTimeSampler                                equivalenttime.h
+/// \brief Combines the frames of a repetitive signal on a finer time grid.
+/// The trigger of the device isn't synchronized with its sample clock, so the
+/// interpolated trigger point falls at a random fraction between two samples in
+/// every frame. The samples of a frame are placed on a grid that is finer than
+/// the sample interval by the factor, relative to the trigger point. Over many
+/// frames all steps of the grid get samples, the record then has the samplerate
+/// of the grid. A step keeps the mean of its last samples, so the record follows
+/// a changing signal. Steps that didn't get a sample yet are interpolated.
+class EquivalentTimeSampler {
+  public:
+    static const unsigned MAXIMUM_FACTOR = 64;    ///< The finest grid in steps per sample
+    static const size_t MAXIMUM_STEPS = 1u << 22; ///< The most steps of a grid
+    static const unsigned AVERAGED_SAMPLES = 4;   ///< The samples a step is averaged over
+
+    /// \brief Selects the grid, it restarts if it changes.
+    /// \param factor The steps per sample interval.
+    /// \param steps The number of steps of the grid.
+    void configure(unsigned factor, size_t steps);
+    /// \brief Restarts the grid with the next frame.
+    void reset();
+
+    /// \brief Places the samples of a frame on the grid.
+    /// Sample n lies at step position + n * factor, samples beyond the grid are dropped.
+    /// \param samples The samples of the frame.
+    /// \param count The number of samples.
+    /// \param position The fractional step of the first sample.
+    void add(const double *samples, size_t count, double position);
+
+    /// \brief Writes the steps of the grid.
+    /// \param target The buffer for the steps, it is resized to the steps of the grid.
+    /// \return false, if no step got a sample yet.
+    bool record(std::vector<double> &target) const;
+
+  private:
+    unsigned factor = 0;
+    std::vector<double> mean;    ///< The mean of the last samples of every step
+    std::vector<uint8_t> counts; ///< The samples in the mean of every step, at most AVERAGED_SAMPLES
+    size_t filled = 0;           ///< The number of steps that got a sample
+};
@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QStandardPaths>
+#include <algorithm>
+#include <tuple>
+
+#include "fftplancache.h"
+
+const size_t FftPlanCache::MAX_PLANS;
+
+namespace {
+/// \brief Destroys a plan that isn't used anymore, the planner isn't thread safe.
+void destroyPlan(fftw_plan plan) {
+    QMutexLocker plannerLocker(&FftPlanCache::plannerMutex());
+    fftw_destroy_plan(plan);
+}
+
+/// \brief Destroys a single precision plan like destroyPlan().
+void destroySinglePlan(fftwf_plan plan) {
+    QMutexLocker plannerLocker(&FftPlanCache::plannerMutex());
+    fftwf_destroy_plan(plan);
+}
+}
+
+/// \brief Measures the plan for one key on the planner thread.
+class FftPlanCache::PlanJob : public QRunnable {
+  public:
+    PlanJob(FftPlanCache *cache, const Key &key) : cache(cache), key(key) {}
+
+    void run() override {
+        if (key.single)
+            cache->optimizeSingle(key);
+        else
+            cache->optimize(key);
+    }
+
+  private:
+    FftPlanCache *cache;
+    Key key;
+};
+
+bool FftPlanCache::Key::operator<(const Key &other) const {
+    return std::tie(single, kind, length, inAlignment, outAlignment, inPlace) <
+           std::tie(other.single, other.kind, other.length, other.inAlignment, other.outAlignment, other.inPlace);
+}
+
+FftPlanCache &FftPlanCache::instance() {
+    static FftPlanCache cache;
+    return cache;
+}
+
+FftPlanCache::FftPlanCache() : effort(FFTW_MEASURE) {
+    // Planning is expensive but rare, one thread is enough
+    planner.setMaxThreadCount(1);
+    loadWisdom();
+}
+
+FftPlanCache::~FftPlanCache() {
+    planner.clear();
+    planner.waitForDone();
+    // The plans destroy themselves with the planner mutex
+    plans.clear();
+}
+
+FftPlanCache::Plan FftPlanCache::plan(Kind kind, unsigned length, double *in, double *out) {
+    const Key key = {kind, length, fftw_alignment_of(in), fftw_alignment_of(out), in == out, false};
+
+    {
+        QMutexLocker locker(&mutex);
+        auto entry = plans.find(key);
+        if (entry != plans.end()) {
+            entry->second.lastUse = ++lookups;
+            return entry->second.plan;
+        }
+    }
+
+    // Use a measured plan from the wisdom if there is one, these flags never touch the arrays
+    Plan plan = createPlan(key, in, out, FFTW_WISDOM_ONLY | effort);
+    const bool optimized = plan != nullptr;
+    if (!optimized) plan = createPlan(key, in, out, FFTW_ESTIMATE);
+
+    // The dropped plans are destroyed after the lock is released
+    std::vector<Entry> dropped;
+    QMutexLocker locker(&mutex);
+    auto inserted = plans.insert(std::make_pair(key, Entry()));
+    inserted.first->second.lastUse = ++lookups;
+    // Another thread may have been faster
+    if (!inserted.second) return inserted.first->second.plan;
+    inserted.first->second.plan = plan;
+    inserted.first->second.optimized = optimized;
+    if (!optimized) planner.start(new PlanJob(this, key));
+    dropUnused(dropped);
+
+    return plan;
+}
+
+FftPlanCache::SinglePlan FftPlanCache::plan(Kind kind, unsigned length, float *in, float *out) {
+    const Key key = {kind, length, fftwf_alignment_of(in), fftwf_alignment_of(out), in == out, true};
+
+    {
+        QMutexLocker locker(&mutex);
+        auto entry = plans.find(key);
+        if (entry != plans.end()) {
+            entry->second.lastUse = ++lookups;
+            return entry->second.singlePlan;
+        }
+    }
+
+    SinglePlan plan = createPlan(key, in, out, FFTW_WISDOM_ONLY | effort);
+    const bool optimized = plan != nullptr;
+    if (!optimized) plan = createPlan(key, in, out, FFTW_ESTIMATE);
+
+    std::vector<Entry> dropped;
+    QMutexLocker locker(&mutex);
+    auto inserted = plans.insert(std::make_pair(key, Entry()));
+    inserted.first->second.lastUse = ++lookups;
+    if (!inserted.second) return inserted.first->second.singlePlan;
+    inserted.first->second.singlePlan = plan;
+    inserted.first->second.optimized = optimized;
+    if (!optimized) planner.start(new PlanJob(this, key));
+    dropUnused(dropped);
+
+    return plan;
+}
+
+/// \brief Removes the least recently used plans beyond MAX_PLANS.
+/// Has to be called with the mutex locked.
+/// \param dropped The removed entries are moved here, so they can be destroyed without the lock.
+void FftPlanCache::dropUnused(std::vector<Entry> &dropped) {
+    while (plans.size() > MAX_PLANS) {
+        auto oldest = std::min_element(
+            plans.begin(), plans.end(), [](const std::pair<const Key, Entry> &first,
+                                           const std::pair<const Key, Entry> &second) {
+                return first.second.lastUse < second.second.lastUse;
+            });
+        dropped.push_back(std::move(oldest->second));
+        plans.erase(oldest);
+    }
+}
+
+void FftPlanCache::setPlannerEffort(unsigned flags) { effort = flags; }
+
+QMutex &FftPlanCache::plannerMutex() {
+    static QMutex mutex;
+    return mutex;
+}
+
+FftPlanCache::Plan FftPlanCache::createPlan(const Key &key, double *in, double *out, unsigned flags) {
+    fftw_plan plan;
+    {
+        QMutexLocker plannerLocker(&plannerMutex());
+        if (key.kind == KIND_R2C)
+            plan = fftw_plan_dft_r2c_1d((int)key.length, in, reinterpret_cast<fftw_complex *>(out), flags);
+        else if (key.kind == KIND_C2C)
+            plan = fftw_plan_dft_1d((int)key.length, reinterpret_cast<fftw_complex *>(in),
+                                    reinterpret_cast<fftw_complex *>(out), FFTW_FORWARD, flags);
+        else if (key.kind == KIND_C2R)
+            plan = fftw_plan_dft_c2r_1d((int)key.length, reinterpret_cast<fftw_complex *>(in), out, flags);
+        else
+            plan = fftw_plan_r2r_1d((int)key.length, in, out, (key.kind == KIND_R2HC) ? FFTW_R2HC : FFTW_HC2R, flags);
+    }
+    return plan ? Plan(plan, destroyPlan) : Plan();
+}
+
+FftPlanCache::SinglePlan FftPlanCache::createPlan(const Key &key, float *in, float *out, unsigned flags) {
+    fftwf_plan plan;
+    {
+        QMutexLocker plannerLocker(&plannerMutex());
+        plan = fftwf_plan_dft_r2c_1d((int)key.length, in, reinterpret_cast<fftwf_complex *>(out), flags);
+    }
+    return plan ? SinglePlan(plan, destroySinglePlan) : SinglePlan();
+}
+
+/// \brief Measures a plan and replaces the estimated plan with it.
+void FftPlanCache::optimize(const Key &key) {
+    // Measuring overwrites the arrays, so use own arrays with the same alignment
+    const unsigned padding = 2 * sizeof(double);
+    const unsigned inLength =
+        (key.kind == KIND_C2C) ? 2 * key.length : (key.kind == KIND_C2R) ? 2 * (key.length / 2 + 1) : key.length;
+    const unsigned outLength =
+        (key.kind == KIND_R2C) ? 2 * (key.length / 2 + 1) : (key.kind == KIND_C2C) ? 2 * key.length : key.length;
+    double *inBuffer = fftw_alloc_real(std::max(inLength, outLength) + padding);
+    double *outBuffer = key.inPlace ? inBuffer : fftw_alloc_real(outLength + padding);
+    // Without the memory the estimated plan stays
+    if (!inBuffer || !outBuffer) {
+        if (inBuffer) fftw_free(inBuffer);
+        if (!key.inPlace && outBuffer) fftw_free(outBuffer);
+        return;
+    }
+    double *in = inBuffer + key.inAlignment / sizeof(double);
+    double *out = key.inPlace ? in : outBuffer + key.outAlignment / sizeof(double);
+
+    Plan plan = createPlan(key, in, out, effort);
+
+    fftw_free(inBuffer);
+    if (!key.inPlace) fftw_free(outBuffer);
+    if (!plan) return;
+
+    // The estimated plan may still be executed by other threads, it is destroyed by the last one
+    Plan estimated;
+    {
+        QMutexLocker locker(&mutex);
+        auto entry = plans.find(key);
+        // A dropped plan stays in the wisdom
+        if (entry != plans.end()) {
+            estimated = std::move(entry->second.plan);
+            entry->second.plan = plan;
+            entry->second.optimized = true;
+        }
+    }
+
+    saveWisdom();
+}
+
+/// \brief Measures a single precision plan like optimize().
+void FftPlanCache::optimizeSingle(const Key &key) {
+    const unsigned padding = 4 * sizeof(float);
+    const unsigned outLength = 2 * (key.length / 2 + 1);
+    float *inBuffer = fftwf_alloc_real(std::max(key.length, outLength) + padding);
+    float *outBuffer = key.inPlace ? inBuffer : fftwf_alloc_real(outLength + padding);
+    if (!inBuffer || !outBuffer) {
+        if (inBuffer) fftwf_free(inBuffer);
+        if (!key.inPlace && outBuffer) fftwf_free(outBuffer);
+        return;
+    }
+    float *in = inBuffer + key.inAlignment / sizeof(float);
+    float *out = key.inPlace ? in : outBuffer + key.outAlignment / sizeof(float);
+
+    SinglePlan plan = createPlan(key, in, out, effort);
+
+    fftwf_free(inBuffer);
+    if (!key.inPlace) fftwf_free(outBuffer);
+    if (!plan) return;
+
+    SinglePlan estimated;
+    {
+        QMutexLocker locker(&mutex);
+        auto entry = plans.find(key);
+        if (entry != plans.end()) {
+            estimated = std::move(entry->second.singlePlan);
+            entry->second.singlePlan = plan;
+            entry->second.optimized = true;
+        }
+    }
+
+    saveWisdom();
+}
+
+/// \param single true, for the wisdom of the float library.
+/// \return The path of the file the wisdom is stored in.
+static QString wisdomFilename(bool single) {
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+           (single ? "/fftwf-wisdom" : "/fftw-wisdom");
+}
+
+void FftPlanCache::loadWisdom() {
+    QMutexLocker plannerLocker(&plannerMutex());
+    const QString filename = wisdomFilename(false);
+    if (QFile::exists(filename)) fftw_import_wisdom_from_filename(QFile::encodeName(filename).constData());
+    const QString singleFilename = wisdomFilename(true);
+    if (QFile::exists(singleFilename))
+        fftwf_import_wisdom_from_filename(QFile::encodeName(singleFilename).constData());
+}
+
+void FftPlanCache::saveWisdom() {
+    const QString filename = wisdomFilename(false);
+    QDir().mkpath(QFileInfo(filename).absolutePath());
+
+    QMutexLocker plannerLocker(&plannerMutex());
+    fftw_export_wisdom_to_filename(QFile::encodeName(filename).constData());
+    fftwf_export_wisdom_to_filename(QFile::encodeName(wisdomFilename(true)).constData());
+}
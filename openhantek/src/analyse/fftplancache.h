@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+#include <QThreadPool>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <fftw3.h>
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class FftPlanCache                                           fftplancache.h
+/// \brief Process wide cache of FFTW plans.
+/// Plans are cached by transform kind, length and the alignment of the arrays,
+/// they are executed with the new-array execute functions of FFTW. A missing
+/// plan is taken from the wisdom if possible, otherwise an estimated plan is
+/// returned immediately and a measured plan is created in the background, that
+/// replaces the estimated one when it is ready. The wisdom is stored on disk,
+/// so measured plans are available right away after a restart. Single precision
+/// plans of FFTW's float library are cached the same way. Only the most recently
+/// used plans are kept, a dropped plan is destroyed when its last user let it go.
+class FftPlanCache {
+  public:
+    typedef std::shared_ptr<std::remove_pointer<fftw_plan>::type> Plan;        ///< A double precision plan
+    typedef std::shared_ptr<std::remove_pointer<fftwf_plan>::type> SinglePlan; ///< A single precision plan
+
+    /// \enum Kind
+    /// \brief The supported transforms.
+    enum Kind {
+        KIND_R2HC, ///< Real to half-complex, executed with fftw_execute_r2r()
+        KIND_HC2R, ///< Half-complex to real, executed with fftw_execute_r2r()
+        KIND_R2C,  ///< Real to complex, executed with fftw_execute_dft_r2c()
+        KIND_C2C,  ///< Forward complex to complex, executed with fftw_execute_dft()
+        KIND_C2R   ///< Complex to real, executed with fftw_execute_dft_c2r(), the input is destroyed
+    };
+
+    /// \return The cache used by all analyzers.
+    static FftPlanCache &instance();
+
+    ~FftPlanCache();
+
+    /// \brief Gets a plan for arrays with the alignment of the given arrays.
+    /// The arrays aren't modified.
+    /// \param kind The transform.
+    /// \param length The length of the transform.
+    /// \param in The input array the plan will be executed with, it holds length complex values for KIND_C2C and
+    /// length / 2 + 1 complex values for KIND_C2R.
+    /// \param out The output array the plan will be executed with, it holds length / 2 + 1 complex values for
+    /// KIND_R2C and length complex values for KIND_C2C.
+    /// \return The plan, it stays valid while it is held, even if the cache drops it meanwhile.
+    Plan plan(Kind kind, unsigned length, double *in, double *out);
+
+    /// \brief Gets a single precision plan, executed with the fftwf_execute functions.
+    /// The arrays are like those of the double precision plans, only KIND_R2C is supported.
+    /// \param kind The transform.
+    /// \param length The length of the transform.
+    /// \param in The input array the plan will be executed with.
+    /// \param out The output array the plan will be executed with.
+    /// \return The plan, it stays valid while it is held, even if the cache drops it meanwhile.
+    SinglePlan plan(Kind kind, unsigned length, float *in, float *out);
+
+    /// \brief Sets the effort used for the plans created in the background.
+    /// \param flags FFTW_MEASURE, FFTW_PATIENT or FFTW_EXHAUSTIVE.
+    void setPlannerEffort(unsigned flags);
+
+    /// \return The mutex that serializes all calls of the FFTW planner.
+    static QMutex &plannerMutex();
+
+  private:
+    static const size_t MAX_PLANS = 64; ///< The number of plans that are kept
+
+    /// \brief The properties of the arrays that a plan depends on.
+    struct Key {
+        Kind kind;
+        unsigned length;
+        int inAlignment;  ///< fftw_alignment_of() of the input array
+        int outAlignment; ///< fftw_alignment_of() of the output array
+        bool inPlace;     ///< true, if the input is the output array
+        bool single;      ///< true, for a plan of the float library
+
+        bool operator<(const Key &other) const;
+    };
+    struct Entry {
+        Plan plan;                      ///< The double precision plan
+        SinglePlan singlePlan;          ///< The single precision plan
+        bool optimized = false;         ///< true, if the plan was measured
+        unsigned long long lastUse = 0; ///< The lookup the plan was used last by
+    };
+    class PlanJob;
+
+    FftPlanCache();
+
+    Plan createPlan(const Key &key, double *in, double *out, unsigned flags);
+    SinglePlan createPlan(const Key &key, float *in, float *out, unsigned flags);
+    void dropUnused(std::vector<Entry> &dropped);
+    void optimizeSingle(const Key &key);
+    void optimize(const Key &key);
+    void loadWisdom();
+    void saveWisdom();
+
+    QMutex mutex;                   ///< Protects the plans
+    std::map<Key, Entry> plans;     ///< The current plan for every key
+    unsigned long long lookups = 0; ///< The number of lookups, orders the uses of the plans
+    std::atomic<unsigned> effort;   ///< The planner flags for background plans
+    QThreadPool planner;            ///< Runs the background planning
+};
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include "framealigner.h"
+
+FrameAligner::FrameAligner(double tolerance) : tolerance((qint64)(tolerance * 1e6)) {}
+
+unsigned FrameAligner::addSource(const DSOsampleBuffer *samples) {
+    Source source;
+    source.samples = samples;
+    sources.push_back(source);
+    return (unsigned)sources.size() - 1;
+}
+
+void FrameAligner::samplesAvailable(unsigned source) {
+    if (source >= sources.size()) return;
+
+    sources[source].timestamp = sources[source].samples->latestTimestamp();
+    sources[source].waiting = true;
+
+    qint64 newest = sources[source].timestamp;
+    for (const Source &other : sources) {
+        if (!other.waiting) return;
+        newest = std::max(newest, other.timestamp);
+    }
+
+    // Drop the frames that are too old for the newest one, their successors are matched instead
+    bool aligned = true;
+    for (Source &other : sources) {
+        if (newest - other.timestamp <= tolerance) continue;
+        other.waiting = false;
+        aligned = false;
+    }
+    if (!aligned) return;
+
+    for (unsigned index = 0; index < sources.size(); ++index) {
+        sources[index].waiting = false;
+        emit frameReleased(index);
+    }
+}
@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QObject>
+#include <vector>
+
+#include "dsosamples.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class FrameAligner                                           framealigner.h
+/// \brief Releases the frames of several devices together.
+/// The frames are matched by their timestamps. A frame is held back until all
+/// other sources delivered a frame that was received within the tolerance, a
+/// frame that is too old to be matched is discarded. The sources keep only
+/// their latest frame, so the alignment is best effort if the analysis is slower
+/// than the acquisition.
+class FrameAligner : public QObject {
+    Q_OBJECT
+
+  public:
+    /// \param tolerance The maximum time between the frames of a set in ms.
+    FrameAligner(double tolerance);
+
+    /// \brief Adds a device whose frames should be aligned.
+    /// \param samples The sample buffer of the device.
+    /// \return The index of the source.
+    unsigned addSource(const DSOsampleBuffer *samples);
+
+    /// \brief Call this if the source data of a device changed.
+    /// \param source The index of the source.
+    void samplesAvailable(unsigned source);
+
+  signals:
+    void frameReleased(unsigned source); ///< The frame of a source belongs to an aligned set
+
+  private:
+    struct Source {
+        const DSOsampleBuffer *samples;
+        qint64 timestamp = 0; ///< Timestamp of the waiting frame
+        bool waiting = false; ///< true, if a frame is held back
+    };
+
+    qint64 tolerance; ///< The tolerance in ns
+    std::vector<Source> sources;
+};
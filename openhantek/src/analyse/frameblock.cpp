@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <cstring>
+
+#include "frameblock.h"
+
+#include "dataanalyzerresult.h"
+
+const uint32_t FrameBlock::MAGIC;
+const size_t FrameBlock::ALIGNMENT;
+
+namespace {
+/// \brief Rounds a size up to the alignment of the spans.
+size_t aligned(size_t size) {
+    return (size + FrameBlock::ALIGNMENT - 1) / FrameBlock::ALIGNMENT * FrameBlock::ALIGNMENT;
+}
+}
+
+void FrameBlock::pack(const DataAnalyzerResult &result) {
+    const unsigned int channels = result.channelCount();
+
+    // The offsets of all spans are known before anything is copied, so the block is only allocated once
+    size_t size = aligned(sizeof(Header) + sizeof(ChannelHeader) * channels);
+    for (unsigned int channel = 0; channel < channels; ++channel) {
+        const DataChannel *channelData = result.data((int)channel);
+        size += aligned(sizeof(double) * channelData->voltage.sample.size());
+        size += aligned(sizeof(double) * channelData->spectrum.sample.size());
+    }
+    reserve(size);
+
+    // Every byte is written once, the padding is cleared so the block can be compared or compressed as a whole
+    size_t offset = aligned(sizeof(Header) + sizeof(ChannelHeader) * channels);
+    std::memset(storage, 0, offset);
+    Header *header = reinterpret_cast<Header *>(storage);
+    header->magic = MAGIC;
+    header->channels = channels;
+    header->frame = result.frameId();
+    header->timestamp = result.timestamp();
+    header->triggerPoint = result.triggerPoint();
+    header->rolling = result.isRolling() ? 1 : 0;
+    header->size = size;
+
+    ChannelHeader *channelHeaders = reinterpret_cast<ChannelHeader *>(storage + sizeof(Header));
+    for (unsigned int channel = 0; channel < channels; ++channel) {
+        const DataChannel *channelData = result.data((int)channel);
+        ChannelHeader &channelHeader = channelHeaders[channel];
+
+        // The ring of the roll mode is unrolled into the two spans from the oldest sample on
+        channelHeader.voltageOffset = offset;
+        channelHeader.voltageCount = channelData->voltage.sample.size();
+        channelHeader.voltageInterval = channelData->voltage.interval;
+        char *values = storage + offset;
+        for (unsigned int part = 0; part < 2; ++part) {
+            size_t count;
+            const double *span = channelData->voltage.span(part, count);
+            if (count == 0) continue;
+            std::memcpy(values, span, sizeof(double) * count);
+            values += sizeof(double) * count;
+        }
+        offset = clearPadding(offset, sizeof(double) * channelHeader.voltageCount);
+
+        channelHeader.spectrumOffset = offset;
+        channelHeader.spectrumCount = channelData->spectrum.sample.size();
+        channelHeader.spectrumInterval = channelData->spectrum.interval;
+        channelHeader.spectrumStart = channelData->spectrumStart;
+        if (channelHeader.spectrumCount)
+            std::memcpy(storage + offset, channelData->spectrum.sample.data(),
+                        sizeof(double) * channelHeader.spectrumCount);
+        offset = clearPadding(offset, sizeof(double) * channelHeader.spectrumCount);
+    }
+    used = size;
+}
+
+const FrameBlock::ChannelHeader &FrameBlock::channel(unsigned int channel) const {
+    return reinterpret_cast<const ChannelHeader *>(storage + sizeof(Header))[channel];
+}
+
+const double *FrameBlock::voltage(unsigned int channel, size_t &count) const {
+    const ChannelHeader &channelHeader = this->channel(channel);
+    count = channelHeader.voltageCount;
+    return reinterpret_cast<const double *>(storage + channelHeader.voltageOffset);
+}
+
+const double *FrameBlock::spectrum(unsigned int channel, size_t &count) const {
+    const ChannelHeader &channelHeader = this->channel(channel);
+    count = channelHeader.spectrumCount;
+    return reinterpret_cast<const double *>(storage + channelHeader.spectrumOffset);
+}
+
+size_t FrameBlock::clearPadding(size_t offset, size_t length) {
+    const size_t end = offset + aligned(length);
+    std::memset(storage + offset + length, 0, end - offset - length);
+    return end;
+}
+
+void FrameBlock::reserve(size_t size) {
+    if (size <= capacity) return;
+
+    allocation.reset(new char[size + ALIGNMENT]);
+    const uintptr_t address = reinterpret_cast<uintptr_t>(allocation.get());
+    storage = allocation.get() + (ALIGNMENT - address % ALIGNMENT) % ALIGNMENT;
+    capacity = size;
+}
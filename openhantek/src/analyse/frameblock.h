@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class DataAnalyzerResult;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class FrameBlock                                               frameblock.h
+/// \brief All samples of an analyzed frame in a single aligned allocation.
+/// The block starts with a Header, then a ChannelHeader for every channel,
+/// followed by the voltages and the spectrum of every channel as doubles. The
+/// voltages are stored from the oldest to the newest sample, also in roll mode.
+/// Every span starts at a multiple of ALIGNMENT bytes from the start of the
+/// block, so consumers can map, copy or send the frame as one piece of memory.
+/// The allocation only grows, a reused block doesn't allocate for every frame.
+class FrameBlock {
+  public:
+    static const uint32_t MAGIC = 0x4b4c424f; ///< "OBLK", the start of every block
+    static const size_t ALIGNMENT = 64;       ///< The alignment of the block and of every span in bytes
+
+    /// \brief The start of the block.
+    struct Header {
+        uint32_t magic;      ///< MAGIC
+        uint32_t channels;   ///< The number of ChannelHeader, the last one is the math channel
+        uint64_t frame;      ///< The id of the analyzed frame, 0 if it is unknown
+        int64_t timestamp;   ///< The steady clock time in ns the frame was received at
+        double triggerPoint; ///< The position of the software trigger in samples, negative if there is none
+        uint32_t rolling;    ///< 1, if the samples are the newest part of a roll mode acquisition
+        uint32_t reserved;
+        uint64_t size;       ///< The size of the whole block in bytes
+    };
+
+    /// \brief The description of a channel in the block.
+    struct ChannelHeader {
+        uint64_t voltageOffset;  ///< The position of the voltages from the start of the block in bytes
+        uint64_t voltageCount;   ///< The number of voltage samples, 0 if the channel is unused
+        uint64_t spectrumOffset; ///< The position of the spectrum from the start of the block in bytes
+        uint64_t spectrumCount;  ///< The number of spectrum bins
+        double voltageInterval;  ///< The time between two voltage samples in s
+        double spectrumInterval; ///< The frequency between two spectrum bins in Hz
+        double spectrumStart;    ///< The frequency of the first spectrum bin in Hz
+        uint64_t reserved;
+    };
+
+    /// \brief Copies the samples of a result into the block.
+    /// \param result The analyzed frame.
+    void pack(const DataAnalyzerResult &result);
+
+    /// \brief Forgets the packed frame but keeps the allocation.
+    void clear() { used = 0; }
+
+    /// \return The start of the block, nullptr if nothing was packed.
+    const char *data() const { return used ? storage : nullptr; }
+
+    /// \return The size of the block in bytes, 0 if nothing was packed.
+    size_t size() const { return used; }
+
+    /// \return The header of the block, only valid if something was packed.
+    const Header &header() const { return *reinterpret_cast<const Header *>(storage); }
+
+    /// \param channel The channel, has to be below Header::channels.
+    /// \return The description of the channel.
+    const ChannelHeader &channel(unsigned int channel) const;
+
+    /// \param channel The channel, has to be below Header::channels.
+    /// \param count Is set to the number of voltage samples.
+    /// \return The voltages of the channel from the oldest to the newest sample.
+    const double *voltage(unsigned int channel, size_t &count) const;
+
+    /// \param channel The channel, has to be below Header::channels.
+    /// \param count Is set to the number of spectrum bins.
+    /// \return The spectrum of the channel.
+    const double *spectrum(unsigned int channel, size_t &count) const;
+
+  private:
+    void reserve(size_t size);
+    /// \brief Clears the padding after a span.
+    /// \param offset The start of the span.
+    /// \param length The size of the span in bytes.
+    /// \return The start of the next span.
+    size_t clearPadding(size_t offset, size_t length);
+
+    std::unique_ptr<char[]> allocation; ///< The memory, ALIGNMENT bytes larger than the capacity
+    char *storage = nullptr;            ///< The aligned start of the block in the allocation
+    size_t capacity = 0;                ///< The usable size after the aligned start in bytes
+    size_t used = 0;                    ///< The size of the packed frame in bytes
+};
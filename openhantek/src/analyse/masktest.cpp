@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+
+#include "masktest.h"
+
+#include "viewconstants.h"
+
+const unsigned int MaskTest::WIDTH;
+const unsigned int MaskTest::HEIGHT;
+
+MaskTest::MaskTest() : pixelsBelow(WIDTH * (HEIGHT + 1), 0), lowest(WIDTH, (int)HEIGHT), highest(WIDTH, -1) {}
+
+void MaskTest::setMask(const std::vector<QPolygonF> &polygons) {
+    if (polygons == this->polygons) return;
+    this->polygons = polygons;
+
+    std::vector<quint8> pixels;
+    rasterize(polygons, pixels);
+    maskPixels = 0;
+    for (unsigned int column = 0; column < WIDTH; ++column) {
+        quint32 *below = &pixelsBelow[column * (HEIGHT + 1)];
+        below[0] = 0;
+        for (unsigned int row = 0; row < HEIGHT; ++row)
+            below[row + 1] = below[row] + (pixels[row * WIDTH + column] ? 1 : 0);
+        maskPixels += below[HEIGHT];
+    }
+}
+
+unsigned int MaskTest::test(const double *samples, size_t count, double start, double interval, double xScale,
+                            double yScale, double yOffset) {
+    std::fill(lowest.begin(), lowest.end(), (int)HEIGHT);
+    std::fill(highest.begin(), highest.end(), -1);
+    const double columnStep = interval * xScale * WIDTH / DIVS_TIME;
+    if (count == 0 || !(columnStep > 0.0)) return 0;
+    const double columnOffset = start * xScale * WIDTH / DIVS_TIME;
+    const double rowFactor = yScale * HEIGHT / DIVS_VOLTAGE;
+    const double rowOffset = (yOffset + DIVS_VOLTAGE / 2) * HEIGHT / DIVS_VOLTAGE;
+
+    // Only the samples on the screen and the ones next to them are read
+    const double firstVisible = std::floor(-columnOffset / columnStep);
+    size_t index = (size_t)std::min(std::max(firstVisible, 0.0), count - 1.0);
+    double x = index * columnStep + columnOffset;
+    double y = samples[index] * rowFactor + rowOffset;
+    if (count == 1) cover(x, y, x, y);
+    for (++index; index < count && x < WIDTH; ++index) {
+        const double nextX = index * columnStep + columnOffset;
+        const double nextY = samples[index] * rowFactor + rowOffset;
+        cover(x, y, nextX, nextY);
+        x = nextX;
+        y = nextY;
+    }
+
+    unsigned int violations = 0;
+    for (unsigned int column = 0; column < WIDTH; ++column) {
+        if (lowest[column] > highest[column]) continue;
+        const quint32 *below = &pixelsBelow[column * (HEIGHT + 1)];
+        if (below[highest[column] + 1] != below[lowest[column]]) ++violations;
+    }
+    return violations;
+}
+
+/// \brief Adds the rows of a line between two samples to the columns it crosses.
+/// The positions are in pixels, the line has to go from left to right.
+void MaskTest::cover(double startColumn, double startRow, double endColumn, double endRow) {
+    if (endColumn < 0.0 || startColumn >= WIDTH) return;
+    const int first = (int)std::floor(std::max(startColumn, 0.0));
+    const int last = (int)std::floor(std::min(endColumn, WIDTH - 1.0));
+    if (first == last && startColumn >= 0.0 && endColumn < WIDTH) {
+        // Dense samples, the whole line is in one column
+        mark(first, std::min(startRow, endRow), std::max(startRow, endRow));
+        return;
+    }
+
+    // The rows at the borders of the columns are interpolated
+    const double slope = (endRow - startRow) / (endColumn - startColumn);
+    for (int column = first; column <= last; ++column) {
+        const double left = startRow + (std::max(startColumn, (double)column) - startColumn) * slope;
+        const double right = startRow + (std::min(endColumn, column + 1.0) - startColumn) * slope;
+        mark(column, std::min(left, right), std::max(left, right));
+    }
+}
+
+/// \brief Adds rows to a column, the rows beyond the screen are limited to the border.
+void MaskTest::mark(int column, double lowest, double highest) {
+    if (!(lowest <= highest)) return; // NaN
+    const int bottom = (int)std::floor(std::min(std::max(lowest, 0.0), HEIGHT - 1.0));
+    const int top = (int)std::floor(std::min(std::max(highest, 0.0), HEIGHT - 1.0));
+    this->lowest[(size_t)column] = std::min(this->lowest[(size_t)column], bottom);
+    this->highest[(size_t)column] = std::max(this->highest[(size_t)column], top);
+}
+
+std::vector<QPolygonF> MaskTest::envelope(double xTolerance, double yTolerance) const {
+    const int reach = (int)std::lround(std::max(xTolerance, 0.0) * WIDTH / DIVS_TIME);
+    const double rowTolerance = std::max(yTolerance, 0.0) * HEIGHT / DIVS_VOLTAGE;
+
+    // The borders of the areas in rows, the highest and lowest row of the graph within the reach
+    std::vector<double> upper(WIDTH, HEIGHT);
+    std::vector<double> lower(WIDTH, 0.0);
+    bool reached = false;
+    for (int column = 0; column < (int)WIDTH; ++column) {
+        int top = -1;
+        int bottom = (int)HEIGHT;
+        for (int other = std::max(column - reach, 0); other <= std::min(column + reach, (int)WIDTH - 1); ++other) {
+            top = std::max(top, highest[(size_t)other]);
+            bottom = std::min(bottom, lowest[(size_t)other]);
+        }
+        if (top < bottom) continue;
+        reached = true;
+        upper[(size_t)column] = std::min(top + 1 + rowTolerance, (double)HEIGHT);
+        lower[(size_t)column] = std::max(bottom - rowTolerance, 0.0);
+    }
+    if (!reached) return std::vector<QPolygonF>();
+
+    // The borders are steps at the columns, the points are only added where the border changes
+    std::vector<QPolygonF> areas(2);
+    const double columnWidth = DIVS_TIME / WIDTH;
+    const double rowHeight = DIVS_VOLTAGE / HEIGHT;
+    for (int area = 0; area < 2; ++area) {
+        const std::vector<double> &border = (area == 0) ? upper : lower;
+        const double edge = (area == 0) ? DIVS_VOLTAGE / 2 : -DIVS_VOLTAGE / 2;
+        QPolygonF &polygon = areas[(size_t)area];
+        polygon << QPointF(-DIVS_TIME / 2, edge);
+        for (unsigned int column = 0; column < WIDTH; ++column) {
+            const double y = border[column] * rowHeight - DIVS_VOLTAGE / 2;
+            if (column == 0 || border[column] != border[column - 1])
+                polygon << QPointF(column * columnWidth - DIVS_TIME / 2, y);
+            if (column + 1 == WIDTH || border[column] != border[column + 1])
+                polygon << QPointF((column + 1) * columnWidth - DIVS_TIME / 2, y);
+        }
+        polygon << QPointF(DIVS_TIME / 2, edge);
+    }
+    return areas;
+}
+
+void MaskTest::rasterize(const std::vector<QPolygonF> &polygons, std::vector<quint8> &pixels) {
+    pixels.assign(WIDTH * HEIGHT, 0);
+    std::vector<double> crossings;
+    for (unsigned int column = 0; column < WIDTH; ++column) {
+        // The pixels are inside if their center is, every column is filled between pairs of polygon edges
+        const double x = (column + 0.5) * DIVS_TIME / WIDTH - DIVS_TIME / 2;
+        for (const QPolygonF &polygon : polygons) {
+            crossings.clear();
+            for (int point = 0; point < polygon.size(); ++point) {
+                const QPointF &from = polygon[point];
+                const QPointF &to = polygon[(point + 1) % polygon.size()];
+                if ((from.x() <= x) == (to.x() <= x)) continue;
+                crossings.push_back(from.y() + (x - from.x()) * (to.y() - from.y()) / (to.x() - from.x()));
+            }
+            std::sort(crossings.begin(), crossings.end());
+            for (size_t crossing = 0; crossing + 1 < crossings.size(); crossing += 2) {
+                const double bottom = (crossings[crossing] + DIVS_VOLTAGE / 2) * HEIGHT / DIVS_VOLTAGE - 0.5;
+                const double top = (crossings[crossing + 1] + DIVS_VOLTAGE / 2) * HEIGHT / DIVS_VOLTAGE - 0.5;
+                const int first = (int)std::ceil(std::min(std::max(bottom, 0.0), (double)HEIGHT));
+                const int last = (int)std::ceil(std::min(std::max(top, 0.0), (double)HEIGHT));
+                for (int row = first; row < last; ++row) pixels[(size_t)row * WIDTH + column] = 0xff;
+            }
+        }
+    }
+}
+
+bool MaskTest::parse(const QString &text, std::vector<QPolygonF> &polygons) {
+    polygons.clear();
+    for (const QString &line : text.split('\n')) {
+        const QString polygonText = line.trimmed();
+        if (polygonText.isEmpty() || polygonText.startsWith('#')) continue;
+
+        QPolygonF polygon;
+        for (const QString &pointText : polygonText.split(' ', QString::SkipEmptyParts)) {
+            const QStringList coordinates = pointText.split(',');
+            bool validX = false, validY = false;
+            if (coordinates.size() == 2)
+                polygon << QPointF(coordinates[0].toDouble(&validX), coordinates[1].toDouble(&validY));
+            if (!validX || !validY) return false;
+        }
+        if (polygon.size() < 3) return false;
+        polygons.push_back(polygon);
+    }
+    return true;
+}
+
+QString MaskTest::format(const std::vector<QPolygonF> &polygons) {
+    QString text;
+    for (const QPolygonF &polygon : polygons) {
+        QStringList points;
+        for (const QPointF &point : polygon)
+            points << QString("%1,%2").arg(point.x(), 0, 'g', 6).arg(point.y(), 0, 'g', 6);
+        text += points.join(' ') + '\n';
+    }
+    return text;
+}
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QPolygonF>
+#include <QString>
+#include <QtGlobal>
+#include <cstddef>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class MaskTest                                                 masktest.h
+/// \brief Tests the graphs of the frames against a mask of forbidden areas.
+/// The polygons of the mask are rasterized once into a fixed grid over the
+/// screen and every column keeps the number of mask pixels below every row.
+/// A graph is reduced to the rows it covers in every column in a single pass
+/// over its samples, the lines between the samples included, so checking a
+/// column is one subtraction whatever the record length is.
+class MaskTest {
+  public:
+    MaskTest();
+
+    /// \brief Sets the mask, it is only rasterized again if it changed.
+    /// \param polygons The forbidden areas in divs, the areas of overlapping polygons are combined.
+    void setMask(const std::vector<QPolygonF> &polygons);
+    /// \return true, if the mask has no pixels.
+    bool empty() const { return maskPixels == 0; }
+
+    /// \brief Tests a graph over time against the mask.
+    /// The rows the graph covers are kept for envelope().
+    /// \param samples The voltages, beginning with the first sample that is drawn.
+    /// \param count The number of samples.
+    /// \param start The time of the first sample from the left edge of the screen in s.
+    /// \param interval The time between two samples in s.
+    /// \param xScale The divs per second.
+    /// \param yScale The divs per volt.
+    /// \param yOffset The vertical position of the zero line in divs.
+    /// \return The number of pixel columns where the graph touches the mask.
+    unsigned int test(const double *samples, size_t count, double start, double interval, double xScale,
+                      double yScale, double yOffset);
+
+    /// \brief Creates a mask around the last tested graph.
+    /// The mask has an area above and an area below the graph, the columns
+    /// the graph didn't reach are left open.
+    /// \param xTolerance The horizontal distance from the graph in divs.
+    /// \param yTolerance The vertical distance from the graph in divs.
+    /// \return The polygons in divs, empty if the graph wasn't on the screen.
+    std::vector<QPolygonF> envelope(double xTolerance, double yTolerance) const;
+
+    /// \brief Fills the pixels inside of the polygons.
+    /// \param polygons The areas in divs.
+    /// \param pixels Set to 0xff inside and 0 outside of the areas, row by row beginning with the bottom row.
+    static void rasterize(const std::vector<QPolygonF> &polygons, std::vector<quint8> &pixels);
+
+    /// \brief Reads polygons from a text, one polygon per line as x,y pairs in divs.
+    /// Empty lines and lines beginning with # are skipped.
+    /// \param text The text.
+    /// \param polygons Set to the polygons.
+    /// \return false, if a line isn't a polygon with at least three points.
+    static bool parse(const QString &text, std::vector<QPolygonF> &polygons);
+    /// \return The polygons as text for parse().
+    static QString format(const std::vector<QPolygonF> &polygons);
+
+    static const unsigned int WIDTH = 500;  ///< The columns over the screen, 50 per div
+    static const unsigned int HEIGHT = 400; ///< The rows over the screen, 50 per div
+
+  private:
+    void cover(double startColumn, double startRow, double endColumn, double endRow);
+    void mark(int column, double lowest, double highest);
+
+    std::vector<QPolygonF> polygons; ///< The rasterized mask
+    /// The mask pixels below every row and the top of every column, column by column
+    std::vector<quint32> pixelsBelow;
+    quint32 maskPixels = 0;
+    // The rows the last tested graph covers in every column, lowest > highest if it didn't reach the column
+    std::vector<int> lowest;
+    std::vector<int> highest;
+};
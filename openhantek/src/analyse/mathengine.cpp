@@ -0,0 +1,329 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCoreApplication>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "analysiskernels.h"
+#include "mathengine.h"
+
+#define tr(msg) QCoreApplication::translate("MathExpression", msg)
+
+const unsigned MathExpression::BLOCK_LENGTH;
+const unsigned MathExpression::MAX_NESTING;
+
+/// \brief Recursive descent parser that emits the bytecode in postfix order.
+class MathExpression::Parser {
+  public:
+    Parser(const QString &source, MathExpression *expression) : source(source), expression(expression) {}
+
+    /// \return The maximal depth of the stack, 0 on error.
+    unsigned parse() {
+        sum();
+        skipSpaces();
+        if (error.isEmpty() && position < source.size()) error = tr("Unexpected character '%1'").arg(source[position]);
+        return error.isEmpty() ? maximalDepth : 0;
+    }
+
+    QString error;
+
+  private:
+    void sum() {
+        product();
+        for (skipSpaces(); error.isEmpty() && position < source.size(); skipSpaces()) {
+            const QChar operation = source[position];
+            if (operation != '+' && operation != '-') break;
+            ++position;
+            product();
+            append(operation == '+' ? OP_ADD : OP_SUBTRACT, 2);
+        }
+    }
+
+    void product() {
+        unary();
+        for (skipSpaces(); error.isEmpty() && position < source.size(); skipSpaces()) {
+            const QChar operation = source[position];
+            if (operation != '*' && operation != '/') break;
+            ++position;
+            unary();
+            append(operation == '*' ? OP_MULTIPLY : OP_DIVIDE, 2);
+        }
+    }
+
+    /// \brief Parses a signed operand, every nested parenthesis, function and sign passes here.
+    void unary() {
+        skipSpaces();
+        if (!error.isEmpty()) return;
+        if (nesting >= MAX_NESTING) {
+            error = tr("The formula is nested too deeply");
+            return;
+        }
+        ++nesting;
+        if (position < source.size() && (source[position] == '-' || source[position] == '+')) {
+            const bool negate = source[position++] == '-';
+            unary();
+            if (negate) append(OP_NEGATE, 1);
+        } else {
+            primary();
+        }
+        --nesting;
+    }
+
+    void primary() {
+        skipSpaces();
+        if (!error.isEmpty()) return;
+        if (position >= source.size()) {
+            error = tr("Unexpected end of the formula");
+            return;
+        }
+
+        const QChar character = source[position];
+        if (character == '(') {
+            ++position;
+            sum();
+            expect(')');
+        } else if (character.isDigit() || character == '.') {
+            number();
+        } else if (character.isLetter()) {
+            identifier();
+        } else {
+            error = tr("Unexpected character '%1'").arg(source[position]);
+        }
+    }
+
+    void number() {
+        const int start = position;
+        while (position < source.size() && (source[position].isDigit() || source[position] == '.')) ++position;
+        // Exponent like in 1e-3
+        if (position < source.size() && source[position].toLower() == 'e') {
+            int end = position + 1;
+            if (end < source.size() && (source[end] == '-' || source[end] == '+')) ++end;
+            if (end < source.size() && source[end].isDigit()) {
+                position = end;
+                while (position < source.size() && source[position].isDigit()) ++position;
+            }
+        }
+
+        bool ok;
+        const double value = source.mid(start, position - start).toDouble(&ok);
+        if (!ok) {
+            error = tr("Invalid number '%1'").arg(source.mid(start, position - start));
+            return;
+        }
+
+        // Reuse the block if the constant is there already
+        std::vector<double> &constants = expression->constants;
+        unsigned index = 0;
+        while (index * BLOCK_LENGTH < constants.size() && constants[index * BLOCK_LENGTH] != value) ++index;
+        if (index * BLOCK_LENGTH == constants.size()) constants.resize(constants.size() + BLOCK_LENGTH, value);
+        append(OP_CONSTANT, 0, index);
+    }
+
+    void identifier() {
+        const int start = position;
+        while (position < source.size() && source[position].isLetterOrNumber()) ++position;
+        const QString name = source.mid(start, position - start).toLower();
+
+        if (name == "ch1") {
+            append(OP_CH1, 0);
+            return;
+        }
+        if (name == "ch2") {
+            append(OP_CH2, 0);
+            return;
+        }
+
+        Opcode opcode;
+        unsigned arguments = 1;
+        if (name == "abs")
+            opcode = OP_ABS;
+        else if (name == "sqrt")
+            opcode = OP_SQRT;
+        else if (name == "min" || name == "max") {
+            opcode = (name == "min") ? OP_MIN : OP_MAX;
+            arguments = 2;
+        } else {
+            error = tr("Unknown name '%1'").arg(name);
+            return;
+        }
+
+        expect('(');
+        sum();
+        for (unsigned argument = 1; argument < arguments; ++argument) {
+            expect(',');
+            sum();
+        }
+        expect(')');
+        append(opcode, arguments);
+    }
+
+    void expect(char character) {
+        skipSpaces();
+        if (!error.isEmpty()) return;
+        if (position < source.size() && source[position] == character)
+            ++position;
+        else
+            error = tr("Expected '%1'").arg(character);
+    }
+
+    void skipSpaces() {
+        while (position < source.size() && source[position].isSpace()) ++position;
+    }
+
+    /// \brief Appends an instruction.
+    /// \param opcode The operation.
+    /// \param operands The number of operands that are taken from the stack.
+    /// \param argument The index of the constant.
+    void append(Opcode opcode, unsigned operands, unsigned argument = 0) {
+        if (!error.isEmpty()) return;
+        expression->code.push_back({opcode, argument});
+        depth = depth - operands + 1;
+        maximalDepth = std::max(maximalDepth, depth);
+    }
+
+    const QString &source;
+    MathExpression *expression;
+    int position = 0;
+    unsigned nesting = 0; ///< The depth of the recursion
+    unsigned depth = 0;
+    unsigned maximalDepth = 0;
+};
+
+bool MathExpression::compile(const QString &source) {
+    text = source;
+    code.clear();
+    constants.clear();
+
+    Parser parser(source, this);
+    const unsigned depth = parser.parse();
+    error = parser.error;
+    if (depth == 0) {
+        code.clear();
+        if (error.isEmpty()) error = tr("The formula is empty");
+        return false;
+    }
+
+    registers.assign(depth * BLOCK_LENGTH, 0.0);
+    stack.resize(depth);
+    return true;
+}
+
+void MathExpression::evaluate(const double *ch1, const double *ch2, double *result, unsigned count) {
+    for (unsigned offset = 0; offset < count; offset += BLOCK_LENGTH) {
+        const unsigned length = std::min(BLOCK_LENGTH, count - offset);
+        unsigned depth = 0;
+
+        for (size_t index = 0; index < code.size(); ++index) {
+            const Instruction &instruction = code[index];
+            switch (instruction.opcode) {
+            case OP_CH1:
+                stack[depth++] = ch1 + offset;
+                continue;
+            case OP_CH2:
+                stack[depth++] = ch2 + offset;
+                continue;
+            case OP_CONSTANT:
+                stack[depth++] = constants.data() + instruction.argument * BLOCK_LENGTH;
+                continue;
+            default:
+                break;
+            }
+
+            // The last instruction writes the result directly, otherwise the register of the stack level is used
+            const bool binary = instruction.opcode <= OP_DIVIDE || instruction.opcode >= OP_MIN;
+            if (binary) --depth;
+            const double *first = stack[depth - 1];
+            const double *second = binary ? stack[depth] : nullptr;
+            double *target =
+                (index + 1 == code.size()) ? result + offset : registers.data() + (depth - 1) * BLOCK_LENGTH;
+
+            switch (instruction.opcode) {
+            case OP_ADD:
+                Analysis::scaledSum(first, second, 1.0, 1.0, target, length);
+                break;
+            case OP_SUBTRACT:
+                Analysis::scaledSum(first, second, 1.0, -1.0, target, length);
+                break;
+            case OP_MULTIPLY:
+                Analysis::product(first, second, 1.0, target, length);
+                break;
+            case OP_DIVIDE:
+                for (unsigned sample = 0; sample < length; ++sample) target[sample] = first[sample] / second[sample];
+                break;
+            case OP_NEGATE:
+                for (unsigned sample = 0; sample < length; ++sample) target[sample] = -first[sample];
+                break;
+            case OP_ABS:
+                Analysis::absolute(first, 1.0, target, length);
+                break;
+            case OP_SQRT:
+                for (unsigned sample = 0; sample < length; ++sample) target[sample] = std::sqrt(first[sample]);
+                break;
+            case OP_MIN:
+                for (unsigned sample = 0; sample < length; ++sample)
+                    target[sample] = std::min(first[sample], second[sample]);
+                break;
+            case OP_MAX:
+                for (unsigned sample = 0; sample < length; ++sample)
+                    target[sample] = std::max(first[sample], second[sample]);
+                break;
+            default:
+                break;
+            }
+            stack[depth - 1] = target;
+        }
+
+        // A formula without operations like "ch1" only references its operand
+        if (stack[0] != result + offset) std::memcpy(result + offset, stack[0], length * sizeof(double));
+    }
+}
+
+void MathEngine::configure(Dso::MathMode mode, double firstFactor, double secondFactor, const QString &formula) {
+    this->mode = mode;
+    this->firstFactor = firstFactor;
+    this->secondFactor = secondFactor;
+    if (mode == Dso::MATHMODE_EXPRESSION && formula != expression.source())
+        expression.compile(formula);
+}
+
+bool MathEngine::evaluate(const std::vector<double> &ch1, const std::vector<double> &ch2,
+                          std::vector<double> &result) {
+    const unsigned count = (unsigned)std::min(ch1.size(), ch2.size());
+    if (mode == Dso::MATHMODE_EXPRESSION && !expression.isValid()) {
+        result.clear();
+        return false;
+    }
+    result.resize(count);
+
+    switch (mode) {
+    case Dso::MATHMODE_1ADD2:
+        Analysis::scaledSum(ch1.data(), ch2.data(), 1.0, 1.0, result.data(), count);
+        break;
+    case Dso::MATHMODE_1SUB2:
+        Analysis::scaledSum(ch1.data(), ch2.data(), 1.0, -1.0, result.data(), count);
+        break;
+    case Dso::MATHMODE_2SUB1:
+        Analysis::scaledSum(ch2.data(), ch1.data(), 1.0, -1.0, result.data(), count);
+        break;
+    case Dso::MATHMODE_1MUL2:
+        Analysis::product(ch1.data(), ch2.data(), 1.0, result.data(), count);
+        break;
+    case Dso::MATHMODE_ABS1:
+        Analysis::absolute(ch1.data(), 1.0, result.data(), count);
+        break;
+    case Dso::MATHMODE_ABS2:
+        Analysis::absolute(ch2.data(), 1.0, result.data(), count);
+        break;
+    case Dso::MATHMODE_SCALEDSUM:
+        Analysis::scaledSum(ch1.data(), ch2.data(), firstFactor, secondFactor, result.data(), count);
+        break;
+    case Dso::MATHMODE_EXPRESSION:
+        expression.evaluate(ch1.data(), ch2.data(), result.data(), count);
+        break;
+    default:
+        std::fill(result.begin(), result.end(), 0.0);
+        break;
+    }
+    return true;
+}
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QString>
+#include <vector>
+
+#include "definitions.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class MathExpression                                           mathengine.h
+/// \brief A user defined formula for the math channel.
+/// The formula is compiled to a small stack bytecode. Operands are references to
+/// sample blocks, so the channels and constants are never copied, every
+/// instruction processes a whole block with the vectorized kernels.
+/// Supported are numbers, the variables ch1 and ch2, + - * /, parentheses and
+/// the functions abs(x), sqrt(x), min(x, y) and max(x, y).
+class MathExpression {
+  public:
+    /// \brief Compiles a formula.
+    /// \param source The formula, for example "abs(ch1) * 0.5 - ch2".
+    /// \return true on success, otherwise errorString() describes the problem.
+    bool compile(const QString &source);
+
+    /// \return true, if the last compile() was successful.
+    bool isValid() const { return !code.empty(); }
+    /// \return The description of the error of the last compile().
+    const QString &errorString() const { return error; }
+    /// \return The formula of the last compile().
+    const QString &source() const { return text; }
+
+    /// \brief Evaluates the formula for every sample.
+    /// \param ch1 The samples of the first channel.
+    /// \param ch2 The samples of the second channel.
+    /// \param result The buffer for the results, it may not be an input.
+    /// \param count The number of samples.
+    void evaluate(const double *ch1, const double *ch2, double *result, unsigned count);
+
+    static const unsigned BLOCK_LENGTH = 256; ///< The number of samples processed by one instruction
+    static const unsigned MAX_NESTING = 64;   ///< The deepest nesting of parentheses, functions and signs
+
+  private:
+    enum Opcode {
+        OP_CH1,      ///< Push the current block of the first channel
+        OP_CH2,      ///< Push the current block of the second channel
+        OP_CONSTANT, ///< Push a constant, the value is the index of the constant block
+        OP_ADD,      ///< Replace the two topmost operands with their sum
+        OP_SUBTRACT, ///< Replace the two topmost operands with their difference
+        OP_MULTIPLY, ///< Replace the two topmost operands with their product
+        OP_DIVIDE,   ///< Replace the two topmost operands with their quotient
+        OP_NEGATE,   ///< Negate the topmost operand
+        OP_ABS,      ///< Replace the topmost operand with its absolute value
+        OP_SQRT,     ///< Replace the topmost operand with its square root
+        OP_MIN,      ///< Replace the two topmost operands with the smaller one
+        OP_MAX       ///< Replace the two topmost operands with the larger one
+    };
+    struct Instruction {
+        Opcode opcode;
+        unsigned argument; ///< The index of the constant for OP_CONSTANT
+    };
+    class Parser;
+
+    std::vector<Instruction> code;
+    std::vector<double> constants; ///< Every constant filled into a whole block
+    std::vector<double> registers; ///< One block for every level of the stack
+    std::vector<const double *> stack;
+    QString error;
+    QString text;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class MathEngine                                               mathengine.h
+/// \brief Calculates the math channel from the physical channels.
+/// The operation is selected once per frame, the samples are processed with the
+/// vectorized kernels of the analysis.
+class MathEngine {
+  public:
+    /// \brief Selects the operation.
+    /// \param mode The math mode.
+    /// \param firstFactor The factor for the first channel of Dso::MATHMODE_SCALEDSUM.
+    /// \param secondFactor The factor for the second channel of Dso::MATHMODE_SCALEDSUM.
+    /// \param expression The formula for Dso::MATHMODE_EXPRESSION, it is only compiled when it changes.
+    void configure(Dso::MathMode mode, double firstFactor, double secondFactor, const QString &expression);
+
+    /// \brief Calculates the math samples.
+    /// \param ch1 The samples of the first channel.
+    /// \param ch2 The samples of the second channel.
+    /// \param result The math samples, they are resized to the smaller input.
+    /// \return false, if the formula is invalid, the result is empty then.
+    bool evaluate(const std::vector<double> &ch1, const std::vector<double> &ch2, std::vector<double> &result);
+
+  private:
+    Dso::MathMode mode = Dso::MATHMODE_1ADD2;
+    double firstFactor = 1.0;
+    double secondFactor = 1.0;
+    MathExpression expression;
+};
@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "measurementengine.h"
+
+namespace {
+/// The measurements that need the pass over the samples
+const unsigned EDGE_MEASUREMENTS = 1u << Dso::MEASUREMENT_RISETIME | 1u << Dso::MEASUREMENT_FALLTIME |
+                                   1u << Dso::MEASUREMENT_DUTYCYCLE | 1u << Dso::MEASUREMENT_PERIOD |
+                                   1u << Dso::MEASUREMENT_OVERSHOOT | 1u << Dso::MEASUREMENT_PHASE;
+}
+
+const unsigned MeasurementEngine::HISTOGRAM_BINS;
+
+void MeasurementEngine::measure(const SampleValues &voltage, const Analysis::SampleStatistics &statistics,
+                                unsigned enabled) {
+    size_t spanLengths[2];
+    const double *spans[2] = {voltage.span(0, spanLengths[0]), voltage.span(1, spanLengths[1])};
+    measure(spans, spanLengths, voltage.interval, statistics, enabled);
+}
+
+void MeasurementEngine::measure(const double *const spans[2], const size_t spanLengths[2], double interval,
+                                const Analysis::SampleStatistics &statistics, unsigned enabled) {
+    // Start over, but keep the memory of the histogram
+    std::vector<size_t> bins;
+    bins.swap(histogram);
+    *this = MeasurementEngine();
+    histogram.swap(bins);
+    this->statistics = statistics;
+    this->interval = interval;
+    this->enabled = enabled;
+    if ((enabled & EDGE_MEASUREMENTS) == 0 || spanLengths[0] + spanLengths[1] == 0) return;
+
+    findLevels(spans, spanLengths);
+    const double step = top - base;
+    lowLevel = base + 0.1 * step;
+    midLevel = base + 0.5 * step;
+    highLevel = base + 0.9 * step;
+
+    for (unsigned int part = 0; part < 2; ++part) scan(spans[part], spanLengths[part]);
+}
+
+/// \brief Finds the high and low levels of the signal.
+/// Without a distinct peak in a half of the histogram, for example for a
+/// triangle, the level is the maximum or minimum instead.
+void MeasurementEngine::findLevels(const double *const spans[2], const size_t spanLengths[2]) {
+    top = statistics.maximum;
+    base = statistics.minimum;
+    const double amplitude = statistics.maximum - statistics.minimum;
+    if (amplitude <= 0.0) return;
+
+    histogram.assign(HISTOGRAM_BINS, 0);
+    const double scale = HISTOGRAM_BINS / amplitude;
+    for (unsigned int part = 0; part < 2; ++part) {
+        const double *samples = spans[part];
+        for (size_t index = 0; index < spanLengths[part]; ++index) {
+            const unsigned bin = (unsigned)((samples[index] - statistics.minimum) * scale);
+            ++histogram[std::min(bin, HISTOGRAM_BINS - 1)];
+        }
+    }
+
+    // The peak has to be twice as high as the average bin of its half
+    const unsigned half = HISTOGRAM_BINS / 2;
+    auto peak = [&](unsigned first, double &level) {
+        unsigned peakBin = first;
+        size_t samples = 0;
+        for (unsigned bin = first; bin < first + half; ++bin) {
+            samples += histogram[bin];
+            if (histogram[bin] > histogram[peakBin]) peakBin = bin;
+        }
+        if (histogram[peakBin] * half >= 2 * samples)
+            level = statistics.minimum + (peakBin + 0.5) / scale;
+    };
+    peak(0, base);
+    peak(half, top);
+}
+
+/// \brief Finds the edges and periods in the next samples of the record.
+/// \param samples The sample buffer.
+/// \param count The number of samples.
+void MeasurementEngine::scan(const double *samples, size_t count) {
+    if (count == 0) return;
+
+    size_t index = 0;
+    if (position == 0) {
+        // The first sample has no crossing, it only sets the zone
+        previous = samples[0];
+        zone = (previous < lowLevel) ? 0 : (previous > highLevel) ? 2 : 1;
+        armedRise = zone == 0;
+        armedFall = zone == 2;
+        index = 1;
+    }
+
+    for (; index < count; ++index) {
+        const double value = samples[index];
+        const double at = (double)(position + index) - 1.0;
+        // The position of the crossing of a level between the previous and this sample
+        auto crossing = [&](double level) { return at + (level - previous) / (value - previous); };
+
+        const int next = (value < lowLevel) ? 0 : (value > highLevel) ? 2 : 1;
+        if (next != zone) {
+            // An edge starts when the signal leaves the outer zone, a jump over both levels is a complete edge
+            if (zone == 0) riseStart = crossing(lowLevel);
+            if (zone == 2) fallStart = crossing(highLevel);
+            if (next == 0) {
+                if (fallStart >= 0.0) {
+                    fallSum += crossing(lowLevel) - fallStart;
+                    ++falls;
+                }
+                riseStart = -1.0;
+                fallStart = -1.0;
+                armedRise = true;
+            } else if (next == 2) {
+                if (riseStart >= 0.0) {
+                    riseSum += crossing(highLevel) - riseStart;
+                    ++rises;
+                }
+                riseStart = -1.0;
+                fallStart = -1.0;
+                armedFall = true;
+            }
+            zone = next;
+        }
+
+        if (armedRise && previous < midLevel && value >= midLevel) {
+            // A new period starts, the previous one is complete
+            const double time = crossing(midLevel);
+            if (crossings > 0 && lastFall > lastCrossing) highTime += lastFall - lastCrossing;
+            if (crossings == 0) firstCrossing = time;
+            lastCrossing = time;
+            ++crossings;
+            armedRise = false;
+        } else if (armedFall && previous >= midLevel && value < midLevel) {
+            lastFall = crossing(midLevel);
+            armedFall = false;
+        }
+        previous = value;
+    }
+    position += count;
+}
+
+void MeasurementEngine::finish(std::array<double, Dso::MEASUREMENT_COUNT> &values) const {
+    values.fill(std::numeric_limits<double>::quiet_NaN());
+
+    if (isEnabled(Dso::MEASUREMENT_RMS)) values[Dso::MEASUREMENT_RMS] = statistics.rms;
+    if (isEnabled(Dso::MEASUREMENT_MEAN)) values[Dso::MEASUREMENT_MEAN] = statistics.mean;
+    if (isEnabled(Dso::MEASUREMENT_MINIMUM)) values[Dso::MEASUREMENT_MINIMUM] = statistics.minimum;
+    if (isEnabled(Dso::MEASUREMENT_MAXIMUM)) values[Dso::MEASUREMENT_MAXIMUM] = statistics.maximum;
+    if (isEnabled(Dso::MEASUREMENT_RISETIME) && rises > 0)
+        values[Dso::MEASUREMENT_RISETIME] = riseSum / rises * interval;
+    if (isEnabled(Dso::MEASUREMENT_FALLTIME) && falls > 0)
+        values[Dso::MEASUREMENT_FALLTIME] = fallSum / falls * interval;
+    if (crossings >= 2) {
+        const double periods = lastCrossing - firstCrossing;
+        if (isEnabled(Dso::MEASUREMENT_PERIOD))
+            values[Dso::MEASUREMENT_PERIOD] = periods / (crossings - 1) * interval;
+        if (isEnabled(Dso::MEASUREMENT_DUTYCYCLE)) values[Dso::MEASUREMENT_DUTYCYCLE] = 100.0 * highTime / periods;
+    }
+    if (isEnabled(Dso::MEASUREMENT_OVERSHOOT) && top > base)
+        values[Dso::MEASUREMENT_OVERSHOOT] = 100.0 * (statistics.maximum - top) / (top - base);
+}
+
+double MeasurementEngine::phase(const MeasurementEngine &reference) const {
+    if (crossings == 0 || reference.crossings < 2 || interval <= 0.0) return std::numeric_limits<double>::quiet_NaN();
+
+    const double period =
+        (reference.lastCrossing - reference.firstCrossing) / (reference.crossings - 1) * reference.interval;
+    const double delay = firstCrossing * interval - reference.firstCrossing * reference.interval;
+    return 360.0 * std::remainder(delay / period, 1.0);
+}
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "analysiskernels.h"
+#include "dataanalyzerresult.h"
+#include "definitions.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class MeasurementEngine                                 measurementengine.h
+/// \brief Calculates the automatic measurements of a channel.
+/// The high and low levels are the most frequent values in the upper and lower
+/// half of a histogram, so overshoots and ringing don't move them. The levels
+/// at 10%, 50% and 90% of the step between them are then used to find all
+/// edges and periods in one fused pass over the samples. The samples are read
+/// in their spans, so the ring of the roll mode doesn't have to be copied. A
+/// crossing only counts after the signal was beyond the outer level on the
+/// other side, so noise doesn't add edges.
+class MeasurementEngine {
+  public:
+    /// \brief Measures a record.
+    /// \param voltage The samples of the record.
+    /// \param statistics The statistics of all samples of the record.
+    /// \param enabled The enabled measurements, a bit for every Dso::Measurement.
+    void measure(const SampleValues &voltage, const Analysis::SampleStatistics &statistics, unsigned enabled);
+
+    /// \brief Measures a part of a record.
+    /// \param spans The samples as two contiguous spans, from the oldest to the newest sample.
+    /// \param spanLengths The number of samples in the spans.
+    /// \param interval The time between two samples in s.
+    /// \param statistics The statistics of the samples in the spans.
+    /// \param enabled The enabled measurements, a bit for every Dso::Measurement.
+    void measure(const double *const spans[2], const size_t spanLengths[2], double interval,
+                 const Analysis::SampleStatistics &statistics, unsigned enabled);
+
+    /// \brief Gets the results of the last record.
+    /// The phase needs the other channels, it is left NaN, see phase().
+    /// \param values Is set to the measurements, NaN if disabled or not found in the signal.
+    void finish(std::array<double, Dso::MEASUREMENT_COUNT> &values) const;
+
+    /// \brief Calculates the phase of this channel against a reference channel of the same record.
+    /// \param reference The engine that measured the reference channel.
+    /// \return The phase in degrees from -180 to 180, NaN if a channel has no periods.
+    double phase(const MeasurementEngine &reference) const;
+
+    static const unsigned HISTOGRAM_BINS = 256; ///< The resolution of the high and low levels
+
+  private:
+    bool isEnabled(Dso::Measurement measurement) const { return (enabled >> measurement) & 1u; }
+    void findLevels(const double *const spans[2], const size_t spanLengths[2]);
+    void scan(const double *samples, size_t count);
+
+    Analysis::SampleStatistics statistics;
+    double interval = 0.0;
+    unsigned enabled = 0;
+
+    std::vector<size_t> histogram; ///< The number of samples in every bin between minimum and maximum
+    double top = 0.0;              ///< The high level of the signal
+    double base = 0.0;             ///< The low level of the signal
+    double lowLevel = 0.0;         ///< 10% of the step between the levels
+    double midLevel = 0.0;         ///< 50% of the step between the levels
+    double highLevel = 0.0;        ///< 90% of the step between the levels
+
+    size_t position = 0;   ///< The index of the next sample in the record
+    double previous = 0.0; ///< The sample before the next one
+    int zone = 1;          ///< 0 below the low level, 1 between the levels, 2 above the high level
+    bool armedRise = false;
+    bool armedFall = false;
+
+    double riseStart = -1.0; ///< The crossing of the low level of the current rising edge, -1 if there is none
+    double fallStart = -1.0; ///< The crossing of the high level of the current falling edge, -1 if there is none
+    double riseSum = 0.0;    ///< The sum of the complete rise times in samples
+    double fallSum = 0.0;    ///< The sum of the complete fall times in samples
+    unsigned rises = 0;
+    unsigned falls = 0;
+
+    unsigned crossings = 0;     ///< The rising crossings of the middle level
+    double firstCrossing = 0.0; ///< The first rising crossing of the middle level
+    double lastCrossing = 0.0;  ///< The last rising crossing of the middle level
+    double lastFall = -1.0;     ///< The last falling crossing of the middle level, -1 if there is none
+    double highTime = 0.0;      ///< The time above the middle level in the complete periods
+};
@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include "protocoldecoder.h"
+
+#include "serialdecoders.h"
+
+const size_t ProtocolStateMachine::MAX_ANNOTATIONS;
+const unsigned int ProtocolDecoder::MAX_INPUTS;
+
+void ProtocolStateMachine::annotate(double start, double end, const QString &text, bool error) {
+    if (decoded.size() >= MAX_ANNOTATIONS) decoded.pop_front();
+    decoded.emplace_back();
+    ProtocolAnnotation &annotation = decoded.back();
+    annotation.start = start;
+    annotation.end = end;
+    annotation.text = text;
+    annotation.error = error;
+}
+
+bool ProtocolDecoder::Configuration::operator==(const Configuration &other) const {
+    return protocol == other.protocol && threshold == other.threshold && hysteresis == other.hysteresis &&
+           baudrate == other.baudrate && dataBits == other.dataBits && parity == other.parity &&
+           stopBits == other.stopBits && inverted == other.inverted && clockSlope == other.clockSlope &&
+           wordBits == other.wordBits && lsbFirst == other.lsbFirst;
+}
+
+void ProtocolDecoder::configure(const Configuration &configuration, double interval) {
+    if (machine && configuration == this->configuration && interval == this->interval) return;
+    this->configuration = configuration;
+    this->interval = interval;
+    machine.reset();
+    reset();
+    if (!(interval > 0.0)) return;
+
+    switch (configuration.protocol) {
+    case Dso::PROTOCOL_UART:
+        // A bit has to last a few samples to be sampled in its middle
+        if (configuration.baudrate > 0.0 && 1.0 / (configuration.baudrate * interval) >= 2.0)
+            machine.reset(new UartDecoder(1.0 / (configuration.baudrate * interval), configuration.dataBits,
+                                          configuration.parity, configuration.stopBits, configuration.inverted));
+        break;
+    case Dso::PROTOCOL_SPI:
+        machine.reset(new SpiDecoder(configuration.clockSlope, configuration.wordBits, configuration.lsbFirst));
+        break;
+    case Dso::PROTOCOL_I2C:
+        machine.reset(new I2cDecoder());
+        break;
+    default:
+        break;
+    }
+}
+
+unsigned int ProtocolDecoder::inputCount() const {
+    switch (configuration.protocol) {
+    case Dso::PROTOCOL_UART:
+        return 1;
+    case Dso::PROTOCOL_SPI:
+    case Dso::PROTOCOL_I2C:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+void ProtocolDecoder::reset() {
+    streamPosition = 0.0;
+    started = false;
+    if (machine) machine->annotations().clear();
+}
+
+void ProtocolDecoder::process(const SampleValues *const *inputs, size_t first, size_t count, bool continuous) {
+    if (!machine || count == 0) return;
+    if (!continuous) reset();
+    const unsigned int inputCount = this->inputCount();
+
+    // The levels at the first sample start the state machine
+    if (!started) {
+        bool levels[MAX_INPUTS] = {};
+        for (unsigned int input = 0; input < inputCount; ++input) {
+            const double value = inputs[input]->at(first);
+            this->inputs[input].level = levels[input] = value > configuration.threshold;
+            this->inputs[input].previous = value;
+        }
+        machine->start(levels);
+        started = true;
+    }
+
+    // The new samples may wrap around the end of a ring buffer
+    for (unsigned int input = 0; input < inputCount; ++input) {
+        Input &state = this->inputs[input];
+        state.edges.clear();
+        size_t offset = first;
+        size_t remaining = count;
+        double position = streamPosition;
+        for (unsigned int part = 0; part < 2 && remaining > 0; ++part) {
+            size_t spanLength;
+            const double *span = inputs[input]->span(part, spanLength);
+            if (offset >= spanLength) {
+                offset -= spanLength;
+                continue;
+            }
+            const size_t length = std::min(spanLength - offset, remaining);
+            findEdges(state, span + offset, length, position);
+            position += length;
+            remaining -= length;
+            offset = 0;
+        }
+    }
+
+    // The edges of all inputs are passed in the order of time
+    size_t next[MAX_INPUTS] = {};
+    for (;;) {
+        unsigned int earliest = inputCount;
+        for (unsigned int input = 0; input < inputCount; ++input) {
+            if (next[input] >= this->inputs[input].edges.size()) continue;
+            if (earliest == inputCount || this->inputs[input].edges[next[input]].position <
+                                              this->inputs[earliest].edges[next[earliest]].position)
+                earliest = input;
+        }
+        if (earliest == inputCount) break;
+        const Edge &edge = this->inputs[earliest].edges[next[earliest]++];
+        machine->edge(earliest, edge.level, edge.position);
+    }
+
+    streamPosition += count;
+    machine->advance(streamPosition);
+}
+
+void ProtocolDecoder::annotations(size_t length, std::vector<ProtocolAnnotation> &annotations) {
+    annotations.clear();
+    if (!machine) return;
+    std::deque<ProtocolAnnotation> &decoded = machine->annotations();
+    const double origin = streamPosition - length;
+    while (!decoded.empty() && decoded.front().end < origin) decoded.pop_front();
+    annotations.reserve(decoded.size());
+    for (const ProtocolAnnotation &annotation : decoded) {
+        annotations.push_back(annotation);
+        annotations.back().start -= origin;
+        annotations.back().end -= origin;
+    }
+}
+
+/// \brief Finds the level changes of an input.
+/// The position of an edge is interpolated where the samples cross the threshold, but it is
+/// always between the samples that left the band of the hysteresis.
+/// \param input The input, the level and the value of the last sample are updated.
+/// \param samples The samples.
+/// \param count The number of samples.
+/// \param position The position of the first sample in the stream.
+void ProtocolDecoder::findEdges(Input &input, const double *samples, size_t count, double position) const {
+    const double upper = configuration.threshold + configuration.hysteresis / 2;
+    const double lower = configuration.threshold - configuration.hysteresis / 2;
+    bool level = input.level;
+    double previous = input.previous;
+    for (size_t index = 0; index < count; ++index) {
+        const double value = samples[index];
+        if (level ? value < lower : value > upper) {
+            // Rising and falling edges are both placed at the threshold
+            const double fraction = (configuration.threshold - previous) / (value - previous);
+            level = !level;
+            Edge edge;
+            edge.position = position + index - 1 + std::min(std::max(fraction, 0.0), 1.0);
+            edge.level = level;
+            input.edges.push_back(edge);
+        }
+        previous = value;
+    }
+    input.level = level;
+    input.previous = previous;
+}
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "dataanalyzerresult.h"
+#include "definitions.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ProtocolStateMachine                                 protocoldecoder.h
+/// \brief The state of the decoder of one protocol.
+/// The state machine only sees the logic levels of its inputs, it gets their
+/// edges in the order of time and the position up to which the inputs are
+/// known. The positions are samples since the start of the stream.
+class ProtocolStateMachine {
+  public:
+    virtual ~ProtocolStateMachine() {}
+
+    /// \brief Starts the stream.
+    /// \param levels The level of every input at the first sample.
+    virtual void start(const bool *levels) = 0;
+    /// \brief An input changed its level.
+    /// \param input The input.
+    /// \param level The new level of the input.
+    /// \param position The interpolated position of the edge.
+    virtual void edge(unsigned int input, bool level, double position) = 0;
+    /// \brief The inputs are known up to a position, there is no edge before it that wasn't passed yet.
+    /// \param position The position.
+    virtual void advance(double position) = 0;
+
+    /// \return The decoded parts of the stream, the oldest one first.
+    std::deque<ProtocolAnnotation> &annotations() { return decoded; }
+
+    static const size_t MAX_ANNOTATIONS = 1u << 16; ///< The oldest annotations are dropped above this
+
+  protected:
+    /// \brief Adds an annotation, the oldest one is dropped if there are too many.
+    void annotate(double start, double end, const QString &text, bool error = false);
+
+  private:
+    std::deque<ProtocolAnnotation> decoded;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ProtocolDecoder                                      protocoldecoder.h
+/// \brief Decodes a serial protocol from the samples of one or two channels.
+/// The samples of every input are turned into the edges of its logic level,
+/// the level changes when the samples leave the band of the hysteresis around
+/// the threshold. The edges of all inputs are merged in the order of time and
+/// passed to the state machine of the protocol, so every sample is only read
+/// once. A continuous stream keeps the state between the calls, a
+/// character that is split between two frames is decoded when its end arrives.
+class ProtocolDecoder {
+  public:
+    /// \brief The decoded protocol and its format.
+    struct Configuration {
+        Dso::Protocol protocol = Dso::PROTOCOL_OFF;
+        double threshold = 0.0;                      ///< The logic threshold in V
+        double hysteresis = 0.0;                     ///< The width of the band around the threshold in V
+        double baudrate = 0.0;                       ///< The bits per second of UART
+        unsigned int dataBits = 8;                   ///< The data bits of an UART character
+        Dso::Parity parity = Dso::PARITY_NONE;       ///< The parity bit of an UART character
+        unsigned int stopBits = 1;                   ///< The stop bits of an UART character
+        bool inverted = false;                       ///< The UART line idles low
+        Dso::Slope clockSlope = Dso::SLOPE_POSITIVE; ///< The SPI clock edge the data is sampled at
+        unsigned int wordBits = 8;                   ///< The bits of a SPI word
+        bool lsbFirst = false;                       ///< The SPI words begin with the least significant bit
+
+        bool operator==(const Configuration &other) const;
+    };
+
+    /// \brief Sets the protocol, the stream is restarted if it changed.
+    /// \param configuration The protocol.
+    /// \param interval The time between two samples in s.
+    void configure(const Configuration &configuration, double interval);
+
+    /// \return true, if a protocol is decoded.
+    bool active() const { return (bool)machine; }
+
+    /// \return The number of channels the protocol needs.
+    unsigned int inputCount() const;
+
+    /// \brief Restarts the stream, the state and the annotations are discarded.
+    void reset();
+
+    /// \brief Decodes the next samples of the inputs.
+    /// \param inputs The samples of every input, they may be ring buffers.
+    /// \param first The first new sample from the oldest sample of the inputs.
+    /// \param count The number of new samples.
+    /// \param continuous true, if the samples continue the samples of the last call.
+    void process(const SampleValues *const *inputs, size_t first, size_t count, bool continuous);
+
+    /// \brief Gets the annotations that are part of the newest samples.
+    /// The older annotations are discarded.
+    /// \param length The number of newest samples.
+    /// \param annotations The annotations, the positions are samples from the first of the newest samples.
+    void annotations(size_t length, std::vector<ProtocolAnnotation> &annotations);
+
+    static const unsigned int MAX_INPUTS = 2; ///< The most channels a protocol needs
+
+  private:
+    /// \brief A level change of an input.
+    struct Edge {
+        double position; ///< The interpolated position in samples since the start of the stream
+        bool level;      ///< The new level
+    };
+
+    /// \brief The logic level of an input.
+    struct Input {
+        bool level = false;      ///< The level at the newest sample
+        double previous = 0.0;   ///< The value of the newest sample
+        std::vector<Edge> edges; ///< The edges in the samples of the current call
+    };
+
+    void findEdges(Input &input, const double *samples, size_t count, double position) const;
+
+    Configuration configuration;
+    double interval = 0.0;
+    std::unique_ptr<ProtocolStateMachine> machine; ///< The decoder of the protocol, nullptr if it is off
+    Input inputs[MAX_INPUTS];
+    double streamPosition = 0.0; ///< The samples since the start of the stream
+    bool started = false;        ///< true, if the state machine was started
+};
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "resultpool.h"
+
+const size_t ResultPool::MAX_IDLE;
+
+std::shared_ptr<DataAnalyzerResult> ResultPool::acquire(unsigned int channelCount) {
+    std::unique_ptr<DataAnalyzerResult> result;
+    {
+        QMutexLocker locker(&mutex);
+        if (!idle.empty()) {
+            result = std::move(idle.back());
+            idle.pop_back();
+        }
+    }
+    if (result)
+        result->reset(channelCount);
+    else
+        result.reset(new DataAnalyzerResult(channelCount));
+
+    // The pool may be gone when the last reference is released
+    std::weak_ptr<ResultPool> pool = shared_from_this();
+    return std::shared_ptr<DataAnalyzerResult>(result.release(), [pool](DataAnalyzerResult *released) {
+        std::shared_ptr<ResultPool> owner = pool.lock();
+        if (owner)
+            owner->recycle(released);
+        else
+            delete released;
+    });
+}
+
+void ResultPool::recycle(DataAnalyzerResult *result) {
+    std::unique_ptr<DataAnalyzerResult> owned(result);
+
+    QMutexLocker locker(&mutex);
+    if (idle.size() < MAX_IDLE) idle.push_back(std::move(owned));
+}
@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+#include <memory>
+#include <vector>
+
+#include "dataanalyzerresult.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ResultPool                                               resultpool.h
+/// \brief Recycles the result objects of the analysis.
+/// The results are shared between the gui, the graph generator and the
+/// exporters. When the last reference is gone the result is returned to the
+/// pool, its sample vectors keep their capacity, so deep records don't have to be
+/// allocated again for every frame. Results may outlive the pool.
+class ResultPool : public std::enable_shared_from_this<ResultPool> {
+  public:
+    /// \brief Gets a result, a recycled one if possible.
+    /// \param channelCount The number of channels of the result.
+    /// \return The reset result, it is returned to the pool when it isn't referenced anymore.
+    std::shared_ptr<DataAnalyzerResult> acquire(unsigned int channelCount);
+
+  private:
+    void recycle(DataAnalyzerResult *result);
+
+    static const size_t MAX_IDLE = 4; ///< Results beyond this number are freed
+
+    QMutex mutex; ///< Results are released by the gui thread
+    std::vector<std::unique_ptr<DataAnalyzerResult>> idle;
+};
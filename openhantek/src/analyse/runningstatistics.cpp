@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cmath>
+
+#include "runningstatistics.h"
+
+const unsigned RunningStatistics::PERCENTILE_COUNT;
+const double RunningStatistics::PERCENTILES[PERCENTILE_COUNT] = {0.05, 0.5, 0.95};
+
+RunningStatistics::RunningStatistics() { reset(); }
+
+void RunningStatistics::add(double value) {
+    if (std::isnan(value)) return;
+
+    ++count;
+    if (count == 1) {
+        minimum = value;
+        maximum = value;
+    } else {
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+    }
+    const double delta = value - mean;
+    mean += delta / count;
+    squares += delta * (value - mean);
+    for (Quantile &quantile : quantiles) quantile.add(value, count);
+}
+
+void RunningStatistics::reset() {
+    count = 0;
+    mean = 0.0;
+    squares = 0.0;
+    minimum = 0.0;
+    maximum = 0.0;
+    for (unsigned percentile = 0; percentile < PERCENTILE_COUNT; ++percentile)
+        quantiles[percentile] = Quantile(PERCENTILES[percentile]);
+}
+
+RunningStatistics::Summary RunningStatistics::summary() const {
+    Summary summary;
+    summary.count = count;
+    if (count == 0) return summary;
+
+    summary.mean = mean;
+    summary.deviation = (count > 1) ? std::sqrt(squares / (count - 1)) : 0.0;
+    summary.minimum = minimum;
+    summary.maximum = maximum;
+    for (unsigned percentile = 0; percentile < PERCENTILE_COUNT; ++percentile)
+        summary.percentiles[percentile] = quantiles[percentile].estimate(count);
+    return summary;
+}
+
+RunningStatistics::Quantile::Quantile(double probability) : probability(probability) {
+    heights.fill(0.0);
+    positions = {{1.0, 2.0, 3.0, 4.0, 5.0}};
+    desired = {{1.0, 1.0 + 2.0 * probability, 1.0 + 4.0 * probability, 3.0 + 2.0 * probability, 5.0}};
+    increments = {{0.0, probability / 2.0, probability, (1.0 + probability) / 2.0, 1.0}};
+}
+
+/// \brief Adds a value to the estimate.
+/// \param value The value.
+/// \param count The number of values including this one.
+void RunningStatistics::Quantile::add(double value, size_t count) {
+    // The first values are kept sorted, they are the initial markers
+    if (count <= heights.size()) {
+        heights[count - 1] = value;
+        std::sort(heights.begin(), heights.begin() + count);
+        return;
+    }
+
+    // The cell of the value, the outer markers follow the extremes
+    int cell;
+    if (value < heights[0]) {
+        heights[0] = value;
+        cell = 0;
+    } else if (value >= heights[4]) {
+        heights[4] = value;
+        cell = 3;
+    } else {
+        cell = 0;
+        while (value >= heights[cell + 1]) ++cell;
+    }
+    for (int marker = cell + 1; marker < 5; ++marker) positions[marker] += 1.0;
+    for (int marker = 0; marker < 5; ++marker) desired[marker] += increments[marker];
+
+    // Move the inner markers towards their desired positions by at most one
+    for (int marker = 1; marker < 4; ++marker) {
+        const double offset = desired[marker] - positions[marker];
+        if ((offset >= 1.0 && positions[marker + 1] - positions[marker] > 1.0) ||
+            (offset <= -1.0 && positions[marker - 1] - positions[marker] < -1.0)) {
+            const int direction = (offset > 0.0) ? 1 : -1;
+            const double height = parabolic(marker, direction);
+            if (heights[marker - 1] < height && height < heights[marker + 1])
+                heights[marker] = height;
+            else
+                heights[marker] = linear(marker, direction);
+            positions[marker] += direction;
+        }
+    }
+}
+
+/// \param count The number of values added.
+/// \return The estimated value at the probability.
+double RunningStatistics::Quantile::estimate(size_t count) const {
+    if (count == 0) return 0.0;
+    // The nearest rank of the few first values
+    if (count <= heights.size()) return heights[(size_t)std::round(probability * (count - 1))];
+    return heights[2];
+}
+
+/// \brief The piecewise parabolic prediction of a marker height.
+double RunningStatistics::Quantile::parabolic(int marker, int direction) const {
+    const double before = positions[marker] - positions[marker - 1];
+    const double after = positions[marker + 1] - positions[marker];
+    return heights[marker] +
+           direction / (positions[marker + 1] - positions[marker - 1]) *
+               ((before + direction) * (heights[marker + 1] - heights[marker]) / after +
+                (after - direction) * (heights[marker] - heights[marker - 1]) / before);
+}
+
+/// \brief The linear prediction of a marker height, used if the parabola isn't monotonic.
+double RunningStatistics::Quantile::linear(int marker, int direction) const {
+    return heights[marker] +
+           direction * (heights[marker + direction] - heights[marker]) / (positions[marker + direction] -
+                                                                          positions[marker]);
+}
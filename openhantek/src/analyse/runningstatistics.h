@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class RunningStatistics                                 runningstatistics.h
+/// \brief Accumulates the statistics of a value over any number of frames.
+/// Mean and standard deviation are updated with Welford's algorithm, so they
+/// stay exact for long runs. The percentiles are estimated with the P² algorithm
+/// of Jain and Chlamtac, it keeps five markers per percentile, so the memory is
+/// constant however many values were added.
+class RunningStatistics {
+  public:
+    static const unsigned PERCENTILE_COUNT = 3;        ///< The number of estimated percentiles
+    static const double PERCENTILES[PERCENTILE_COUNT]; ///< The estimated percentiles from 0 to 1
+
+    /// \brief The statistics of the values so far.
+    struct Summary {
+        size_t count = 0;       ///< The number of values
+        double mean = 0.0;      ///< The arithmetic mean
+        double deviation = 0.0; ///< The sample standard deviation
+        double minimum = 0.0;   ///< The smallest value
+        double maximum = 0.0;   ///< The largest value
+        /// The estimated values at PERCENTILES
+        std::array<double, PERCENTILE_COUNT> percentiles = {{0.0, 0.0, 0.0}};
+    };
+
+    RunningStatistics();
+
+    /// \brief Adds a value.
+    /// \param value The value, NaN is ignored.
+    void add(double value);
+    /// \brief Forgets all values.
+    void reset();
+    /// \return The statistics of the values since the last reset.
+    Summary summary() const;
+
+  private:
+    /// \brief Estimates one percentile with five markers.
+    class Quantile {
+      public:
+        explicit Quantile(double probability = 0.5);
+        void add(double value, size_t count);
+        double estimate(size_t count) const;
+
+      private:
+        double parabolic(int marker, int direction) const;
+        double linear(int marker, int direction) const;
+
+        double probability;
+        std::array<double, 5> heights;    ///< The marker heights, the first values until there are five
+        std::array<double, 5> positions;  ///< The actual marker positions
+        std::array<double, 5> desired;    ///< The desired marker positions
+        std::array<double, 5> increments; ///< The increments of the desired positions
+    };
+
+    size_t count = 0;
+    double mean = 0.0;
+    double squares = 0.0; ///< The sum of the squared differences from the mean
+    double minimum = 0.0;
+    double maximum = 0.0;
+    std::array<Quantile, PERCENTILE_COUNT> quantiles;
+};
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include "dataanalyzerresult.h"
+#include "samplering.h"
+
+void SampleRing::reset(size_t capacity, double interval) {
+    storage.assign(capacity, 0.0);
+    if (!capacity) storage.shrink_to_fit();
+    position = 0;
+    fill = 0;
+    sampleInterval = interval;
+    // The values copied before can't be continued
+    resetRevision = ++revision;
+}
+
+void SampleRing::append(const double *samples, size_t count) {
+    const size_t capacity = storage.size();
+    if (!capacity) return;
+
+    // Only the latest samples fit into the ring
+    if (count > capacity) {
+        samples += count - capacity;
+        count = capacity;
+    }
+    revision += count;
+
+    while (count) {
+        const size_t chunk = std::min(count, capacity - position);
+        std::copy(samples, samples + chunk, storage.begin() + position);
+        position = (position + chunk) % capacity;
+        fill = std::min(fill + chunk, capacity);
+        samples += chunk;
+        count -= chunk;
+    }
+}
+
+void SampleRing::copyTo(SampleValues &target) const {
+    const size_t capacity = storage.size();
+    // The values of a revision of this ring hold as many samples as the ring had then
+    const bool current =
+        target.revision >= resetRevision && target.revision <= revision &&
+        target.sample.size() == std::min<unsigned long long>(target.revision - resetRevision, capacity);
+    const unsigned long long arrived = current ? revision - target.revision : capacity;
+    target.revision = revision;
+    target.rotation = (fill == capacity) ? position : 0;
+    if (arrived >= fill) {
+        target.sample.assign(storage.begin(), storage.begin() + fill);
+        return;
+    }
+
+    // The new samples end at the write position, they may wrap around once
+    target.sample.resize(fill);
+    const size_t start = (position + capacity - (size_t)arrived) % capacity;
+    const size_t firstPart = std::min((size_t)arrived, capacity - start);
+    std::copy(storage.begin() + start, storage.begin() + start + firstPart, target.sample.begin() + start);
+    std::copy(storage.begin(), storage.begin() + ((size_t)arrived - firstPart), target.sample.begin());
+}
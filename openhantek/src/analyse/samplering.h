@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct SampleValues;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class SampleRing                                               samplering.h
+/// \brief Fixed-capacity history of the samples of a channel in roll mode.
+/// New samples overwrite the oldest ones once the capacity is reached, so the
+/// memory stays bounded however long the roll mode runs. The results are reused,
+/// so a result usually still holds an older state of the ring and only the
+/// samples that arrived since then are copied into it.
+class SampleRing {
+  public:
+    /// \brief Drops all samples and sets a new capacity.
+    /// \param capacity The maximal number of samples, 0 frees the memory.
+    /// \param interval The sample interval of the new samples in s.
+    void reset(size_t capacity, double interval);
+
+    /// \brief Adds new samples, the oldest samples are overwritten if the ring is full.
+    /// \param samples The new samples.
+    /// \param count The number of new samples.
+    void append(const double *samples, size_t count);
+
+    /// \brief Brings the sample values up to date with the ring without reordering it.
+    /// Only the samples appended since the revision of the values are copied, unless the ring was reset since
+    /// then or the values were changed by someone else. The rotation of the values is set to the position of
+    /// the oldest sample.
+    /// \param target The values that get the samples.
+    void copyTo(SampleValues &target) const;
+
+    /// \return The maximal number of samples.
+    size_t capacity() const { return storage.size(); }
+
+    /// \return The number of samples in the ring.
+    size_t size() const { return fill; }
+
+    /// \return The sample interval in s.
+    double interval() const { return sampleInterval; }
+
+  private:
+    std::vector<double> storage;          ///< The ring buffer
+    size_t position = 0;                  ///< The index the next sample is written to
+    size_t fill = 0;                      ///< The number of valid samples
+    double sampleInterval = 0.0;          ///< The interval between two samples in s
+    unsigned long long revision = 1;      ///< Counts the appended samples, a reset skips one revision
+    unsigned long long resetRevision = 1; ///< The revision right after the last reset
+};
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <new>
+#include <utility>
+
+#include <fftw3.h>
+
+#include "scratchbuffer.h"
+
+ScratchBuffer::ScratchBuffer(ScratchBuffer &&other) noexcept : buffer(other.buffer), size(other.size) {
+    other.buffer = nullptr;
+    other.size = 0;
+}
+
+ScratchBuffer &ScratchBuffer::operator=(ScratchBuffer &&other) noexcept {
+    std::swap(buffer, other.buffer);
+    std::swap(size, other.size);
+    return *this;
+}
+
+ScratchBuffer::~ScratchBuffer() {
+    if (buffer) fftw_free(buffer);
+}
+
+double *ScratchBuffer::reserve(size_t length) {
+    if (length <= size) return buffer;
+
+    if (buffer) fftw_free(buffer);
+    buffer = fftw_alloc_real(length);
+    size = buffer ? length : 0;
+    // Like a std::vector, the callers don't check for a missing buffer
+    if (!buffer) throw std::bad_alloc();
+    return buffer;
+}
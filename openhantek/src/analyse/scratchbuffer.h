@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ScratchBuffer                                         scratchbuffer.h
+/// \brief A SIMD aligned buffer for intermediate results of the analysis.
+/// The memory is allocated with fftw_alloc_real(), so FFTW can use its SIMD
+/// codelets on it. The buffer only grows, it is reused for every frame once it
+/// reached the maximal record length.
+class ScratchBuffer {
+  public:
+    ScratchBuffer() = default;
+    ScratchBuffer(ScratchBuffer &&other) noexcept;
+    ScratchBuffer &operator=(ScratchBuffer &&other) noexcept;
+    ScratchBuffer(const ScratchBuffer &) = delete;
+    ScratchBuffer &operator=(const ScratchBuffer &) = delete;
+    ~ScratchBuffer();
+
+    /// \brief Makes sure the buffer holds at least the given number of values.
+    /// The content is lost if the buffer has to grow.
+    /// \param length The number of values needed.
+    /// \return The buffer.
+    /// \throws std::bad_alloc if the memory can't be allocated.
+    double *reserve(size_t length);
+
+    /// \return The buffer, nullptr if nothing was reserved yet.
+    double *data() const { return buffer; }
+
+    /// \return The number of values the buffer holds.
+    size_t capacity() const { return size; }
+
+  private:
+    double *buffer = nullptr; ///< The aligned memory
+    size_t size = 0;          ///< The number of values in the buffer
+};
@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include "serialdecoders.h"
+
+namespace {
+/// \return The value as hexadecimal number with the digits of the given number of bits.
+QString hexValue(quint32 value, unsigned int bits) {
+    return QString("0x%1").arg(value, (int)((bits + 3) / 4), 16, QChar('0'));
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class UartDecoder
+UartDecoder::UartDecoder(double bitLength, unsigned int dataBits, Dso::Parity parity, unsigned int stopBits,
+                         bool inverted)
+    : bitLength(bitLength), dataBits(std::min(std::max(dataBits, 5u), 9u)), parity(parity),
+      stopBits(std::min(std::max(stopBits, 1u), 2u)), inverted(inverted) {}
+
+void UartDecoder::start(const bool *levels) {
+    // A line that is active at the start is in the middle of a character, the next start bit is waited for
+    line = levels[0] != inverted;
+    receiving = false;
+}
+
+void UartDecoder::edge(unsigned int, bool level, double position) {
+    // The bits before the edge still have the old level
+    sampleUntil(position);
+    line = level != inverted;
+    if (receiving || line) return;
+
+    // The edge of the start bit
+    receiving = true;
+    characterStart = position;
+    nextSample = position + bitLength / 2;
+    bit = 0;
+    value = 0;
+    parityError = false;
+    framingError = false;
+}
+
+void UartDecoder::advance(double position) { sampleUntil(position); }
+
+/// \brief Samples the bits whose middle is before a position.
+void UartDecoder::sampleUntil(double position) {
+    while (receiving && nextSample < position) sampleBit();
+}
+
+/// \brief Samples the next bit of the character with the level of the line.
+void UartDecoder::sampleBit() {
+    const unsigned int parityBits = (parity == Dso::PARITY_NONE) ? 0 : 1;
+    if (bit == 0) {
+        // A start bit that is gone in its middle was a glitch
+        if (line) {
+            receiving = false;
+            return;
+        }
+    } else if (bit <= dataBits) {
+        if (line) value |= 1u << (bit - 1);
+    } else if (bit <= dataBits + parityBits) {
+        unsigned int ones = line ? 1 : 0;
+        for (unsigned int data = value; data; data >>= 1) ones += data & 1u;
+        parityError = (ones % 2 == 1) != (parity == Dso::PARITY_ODD);
+    } else {
+        if (!line) framingError = true;
+        if (bit == dataBits + parityBits + stopBits) {
+            // The character ends with its last stop bit
+            QString text = hexValue(value, dataBits);
+            if (value >= 0x20 && value < 0x7f) text += QString(" '%1'").arg(QChar(value));
+            if (parityError) text += " (parity)";
+            if (framingError) text += " (framing)";
+            annotate(characterStart, nextSample + bitLength / 2, text, parityError || framingError);
+            receiving = false;
+            return;
+        }
+    }
+    nextSample += bitLength;
+    ++bit;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class SpiDecoder
+const unsigned int SpiDecoder::INPUT_CLOCK;
+const unsigned int SpiDecoder::INPUT_DATA;
+const unsigned int SpiDecoder::GAP_PERIODS;
+
+SpiDecoder::SpiDecoder(Dso::Slope clockSlope, unsigned int wordBits, bool lsbFirst)
+    : clockSlope(clockSlope), wordBits(std::min(std::max(wordBits, 1u), 32u)), lsbFirst(lsbFirst) {}
+
+void SpiDecoder::start(const bool *levels) {
+    data = levels[INPUT_DATA];
+    bits = 0;
+    period = 0.0;
+}
+
+void SpiDecoder::edge(unsigned int input, bool level, double position) {
+    if (input == INPUT_DATA) {
+        data = level;
+        return;
+    }
+    if (level != (clockSlope == Dso::SLOPE_POSITIVE)) return;
+
+    // A pause of the clock separates the words
+    if (bits > 0 && period > 0.0 && position - lastSample > GAP_PERIODS * period) dropWord();
+    if (bits == 0) {
+        wordStart = position;
+        value = 0;
+    } else {
+        period = position - lastSample;
+    }
+    if (lsbFirst)
+        value |= (quint32)data << bits;
+    else
+        value = (value << 1) | (data ? 1u : 0u);
+    lastSample = position;
+    if (++bits < wordBits) return;
+
+    annotate(wordStart, position, hexValue(value, wordBits));
+    bits = 0;
+}
+
+void SpiDecoder::advance(double position) {
+    if (bits > 0 && period > 0.0 && position - lastSample > GAP_PERIODS * period) dropWord();
+}
+
+/// \brief Marks the incomplete word as error and waits for the next one.
+void SpiDecoder::dropWord() {
+    annotate(wordStart, lastSample, QString("%1 bits").arg(bits), true);
+    bits = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class I2cDecoder
+const unsigned int I2cDecoder::INPUT_SCL;
+const unsigned int I2cDecoder::INPUT_SDA;
+
+void I2cDecoder::start(const bool *levels) {
+    scl = levels[INPUT_SCL];
+    sda = levels[INPUT_SDA];
+    transfer = false;
+    bits = 0;
+}
+
+void I2cDecoder::edge(unsigned int input, bool level, double position) {
+    if (input == INPUT_SDA) {
+        sda = level;
+        // SDA only changes while SCL is low, except for the conditions
+        if (scl) busCondition(level, position);
+        return;
+    }
+
+    scl = level;
+    if (!scl || !transfer) return;
+    if (bits == 0) byteStart = position;
+    if (bits < 8) {
+        value = (value << 1) | (sda ? 1u : 0u);
+        ++bits;
+        return;
+    }
+
+    // The ninth bit is the acknowledge of the receiver
+    QString text = address ? QString("%1 %2").arg(hexValue(value >> 1, 7)).arg((value & 1u) ? "R" : "W")
+                           : hexValue(value, 8);
+    text += sda ? " NAK" : " ACK";
+    annotate(byteStart, position, text);
+    address = false;
+    bits = 0;
+    value = 0;
+}
+
+void I2cDecoder::advance(double) {}
+
+/// \brief Handles a start or stop condition.
+/// \param stop true for a stop condition, false for a start condition.
+/// \param position The position of the condition.
+void I2cDecoder::busCondition(bool stop, double position) {
+    // The condition is in the high phase of SCL whose rising edge sampled the last bit, that bit isn't data
+    if (transfer && bits > 1) annotate(byteStart, position, QString("%1 bits").arg(bits - 1), true);
+    bits = 0;
+    value = 0;
+    if (stop) {
+        if (transfer) annotate(position, position, "P");
+        transfer = false;
+    } else {
+        // A start during a transfer is a repeated start
+        annotate(position, position, transfer ? "Sr" : "S");
+        transfer = true;
+        address = true;
+    }
+}
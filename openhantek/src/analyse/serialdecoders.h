@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include "protocoldecoder.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class UartDecoder                                           serialdecoders.h
+/// \brief Decodes the characters of an asynchronous serial line.
+/// A character begins with the edge of the start bit, its bits are sampled in
+/// their middle with the bit length of the baudrate.
+class UartDecoder : public ProtocolStateMachine {
+  public:
+    /// \param bitLength The length of a bit in samples.
+    /// \param dataBits The number of data bits, the least significant bit comes first.
+    /// \param parity The parity bit.
+    /// \param stopBits The number of stop bits.
+    /// \param inverted true, if the line idles low.
+    UartDecoder(double bitLength, unsigned int dataBits, Dso::Parity parity, unsigned int stopBits, bool inverted);
+
+    void start(const bool *levels) override;
+    void edge(unsigned int input, bool level, double position) override;
+    void advance(double position) override;
+
+  private:
+    void sampleUntil(double position);
+    void sampleBit();
+
+    double bitLength;
+    unsigned int dataBits;
+    Dso::Parity parity;
+    unsigned int stopBits;
+    bool inverted;
+
+    bool line = true;            ///< The logic level of the line, true while it idles
+    bool receiving = false;      ///< true, if a character is received
+    double characterStart = 0.0; ///< The edge of the start bit
+    double nextSample = 0.0;     ///< The middle of the next bit
+    unsigned int bit = 0;        ///< The next bit, 0 is the start bit
+    unsigned int value = 0;      ///< The received data bits
+    bool parityError = false;    ///< The parity bit doesn't match
+    bool framingError = false;   ///< A stop bit isn't idle
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class SpiDecoder                                            serialdecoders.h
+/// \brief Decodes the words of a SPI bus without chip select.
+/// The data is sampled at the selected edge of the clock. Without the chip
+/// select the words are aligned to the pauses of the clock, a word is restarted
+/// if the clock pauses for more than GAP_PERIODS clock periods.
+class SpiDecoder : public ProtocolStateMachine {
+  public:
+    /// \param clockSlope The clock edge the data is sampled at.
+    /// \param wordBits The number of bits of a word.
+    /// \param lsbFirst true, if the words begin with the least significant bit.
+    SpiDecoder(Dso::Slope clockSlope, unsigned int wordBits, bool lsbFirst);
+
+    void start(const bool *levels) override;
+    void edge(unsigned int input, bool level, double position) override;
+    void advance(double position) override;
+
+    static const unsigned int INPUT_CLOCK = 0;
+    static const unsigned int INPUT_DATA = 1;
+    static const unsigned int GAP_PERIODS = 4; ///< A longer pause of the clock ends a word
+
+  private:
+    void dropWord();
+
+    Dso::Slope clockSlope;
+    unsigned int wordBits;
+    bool lsbFirst;
+
+    bool data = false;       ///< The level of the data line
+    unsigned int bits = 0;   ///< The received bits of the word
+    quint32 value = 0;       ///< The value of the received bits
+    double wordStart = 0.0;  ///< The first sampling edge of the word
+    double lastSample = 0.0; ///< The last sampling edge of the word
+    double period = 0.0;     ///< The time between the last two sampling edges, 0 if unknown
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class I2cDecoder                                            serialdecoders.h
+/// \brief Decodes the conditions, addresses and data bytes of an I2C bus.
+/// The bytes are sampled at the rising edges of SCL, an edge of SDA while SCL
+/// is high is a start or stop condition. The first byte after a start is the
+/// address with the direction bit, every byte is followed by the acknowledge.
+class I2cDecoder : public ProtocolStateMachine {
+  public:
+    void start(const bool *levels) override;
+    void edge(unsigned int input, bool level, double position) override;
+    void advance(double position) override;
+
+    static const unsigned int INPUT_SCL = 0;
+    static const unsigned int INPUT_SDA = 1;
+
+  private:
+    void busCondition(bool stop, double position);
+
+    bool scl = true;        ///< The level of SCL
+    bool sda = true;        ///< The level of SDA
+    bool transfer = false;  ///< true, between a start and a stop condition
+    bool address = false;   ///< true, if the next byte is the address
+    unsigned int bits = 0;  ///< The received bits of the byte, the ninth one is the acknowledge
+    unsigned int value = 0; ///< The received bits of the byte
+    double byteStart = 0.0; ///< The first rising edge of SCL of the byte
+};
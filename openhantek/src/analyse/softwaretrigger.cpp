@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <cmath>
+
+#include "analysiskernels.h"
+#include "softwaretrigger.h"
+
+const int SoftwareTrigger::SINC_TAPS;
+const int SoftwareTrigger::SINC_ITERATIONS;
+
+void SoftwareTrigger::configure(const Condition &condition) {
+    this->condition = condition;
+    this->condition.upperLevel = std::max(condition.upperLevel, condition.level);
+    this->condition.hysteresis = std::max(condition.hysteresis, 0.0);
+}
+
+double SoftwareTrigger::find(const double *samples, unsigned count, unsigned first, unsigned last) const {
+    // A crossing needs the sample before it
+    last = std::min(last, count);
+    first = std::max(first, 1u);
+    if (first >= last) return -1.0;
+
+    switch (condition.type) {
+    case Dso::TRIGGERTYPE_PULSEWIDTH:
+        return findPulse(samples, first, last);
+    case Dso::TRIGGERTYPE_RUNT:
+        return findRunt(samples, first, last);
+    case Dso::TRIGGERTYPE_WINDOW:
+        return findWindow(samples, first, last);
+    case Dso::TRIGGERTYPE_TIMEOUT:
+        return findTimeout(samples, first, last);
+    default:
+        return findEdge(samples, first, last);
+    }
+}
+
+/// \brief Searches the next armed edge.
+/// \param samples The sample buffer.
+/// \param position The first sample that is searched.
+/// \param last The sample after the last one that is searched.
+/// \param falling true for a falling edge, false for a rising edge.
+/// \param level The level that is crossed.
+/// \return The first sample after the crossing, last if there is none.
+unsigned SoftwareTrigger::edge(const double *samples, unsigned position, unsigned last, bool falling,
+                               double level) const {
+    if (position + 1 >= last) return last;
+
+    // Arm at the first sample that isn't above the arming level (below for the falling edge)
+    const double armLevel = falling ? level + condition.hysteresis : level - condition.hysteresis;
+    const unsigned armed =
+        position + Analysis::findThreshold(samples + position, armLevel, falling, true, last - 1 - position);
+    if (armed + 1 >= last) return last;
+
+    // Fire at the first sample beyond the level after that
+    return armed + 1 + Analysis::findThreshold(samples + armed + 1, level, falling, false, last - 1 - armed);
+}
+
+/// \brief Triggers on the first edge.
+double SoftwareTrigger::findEdge(const double *samples, unsigned first, unsigned last) const {
+    const bool falling = condition.slope == Dso::SLOPE_NEGATIVE;
+    unsigned position = 0;
+    for (;;) {
+        const unsigned fired = edge(samples, position, last, falling, condition.level);
+        if (fired >= last) return -1.0;
+        if (fired >= first) return interpolate(samples, last, fired, condition.level);
+        // The edge was before the allowed range, the trigger has to be armed again
+        position = fired + 1;
+    }
+}
+
+/// \brief Triggers at the end of the first pulse that is longer or shorter than the duration.
+double SoftwareTrigger::findPulse(const double *samples, unsigned first, unsigned last) const {
+    const bool falling = condition.slope == Dso::SLOPE_NEGATIVE;
+    unsigned position = 0;
+    for (;;) {
+        const unsigned start = edge(samples, position, last, falling, condition.level);
+        if (start >= last) return -1.0;
+        const unsigned end = edge(samples, start, last, !falling, condition.level);
+        if (end >= last) return -1.0;
+
+        const double trigger = interpolate(samples, last, end, condition.level);
+        const double width = trigger - interpolate(samples, last, start, condition.level);
+        if (end >= first && (condition.shorter ? width < condition.duration : width > condition.duration))
+            return trigger;
+        position = end;
+    }
+}
+
+/// \brief Triggers at the end of the first pulse that crosses the level but not the upper level.
+/// A negative runt falls below the upper level and rises again without reaching the level.
+double SoftwareTrigger::findRunt(const double *samples, unsigned first, unsigned last) const {
+    const bool falling = condition.slope == Dso::SLOPE_NEGATIVE;
+    const double lower = condition.level;
+    const double upper = condition.upperLevel;
+    unsigned position = 0;
+    for (;;) {
+        const unsigned start = edge(samples, position, last, falling, falling ? upper : lower);
+        if (start >= last) return -1.0;
+
+        // The first sample outside of the levels tells if the pulse was complete
+        const unsigned end = start + Analysis::findOutside(samples + start, lower, upper, false, last - start);
+        if (end >= last) return -1.0;
+        const bool runt = falling ? samples[end] > upper : samples[end] < lower;
+        if (runt && end >= first) return interpolate(samples, last, end, falling ? upper : lower);
+        position = end;
+    }
+}
+
+/// \brief Triggers when the signal leaves the window between the levels, or enters it for the negative slope.
+/// The trigger is armed inside the window narrowed by the hysteresis, or outside of the widened window.
+double SoftwareTrigger::findWindow(const double *samples, unsigned first, unsigned last) const {
+    const bool leaving = condition.slope != Dso::SLOPE_NEGATIVE;
+    const double lower = condition.level;
+    const double upper = condition.upperLevel;
+    const double margin = leaving ? std::min(condition.hysteresis, (upper - lower) / 2) : -condition.hysteresis;
+    unsigned position = 0;
+    for (;;) {
+        if (position + 1 >= last) return -1.0;
+        const unsigned armed = position + Analysis::findOutside(samples + position, lower + margin, upper - margin,
+                                                                leaving, last - 1 - position);
+        if (armed + 1 >= last) return -1.0;
+        const unsigned fired =
+            armed + 1 + Analysis::findOutside(samples + armed + 1, lower, upper, !leaving, last - 1 - armed);
+        if (fired >= last) return -1.0;
+
+        if (fired >= first) {
+            // The sample outside of the window tells which level was crossed
+            const double outside = leaving ? samples[fired] : samples[fired - 1];
+            return interpolate(samples, last, fired, (outside > upper) ? upper : lower);
+        }
+        position = fired + 1;
+    }
+}
+
+/// \brief Triggers when the signal stays beyond the level for longer than the duration after an edge.
+/// The trigger point is the end of the duration.
+double SoftwareTrigger::findTimeout(const double *samples, unsigned first, unsigned last) const {
+    const bool falling = condition.slope == Dso::SLOPE_NEGATIVE;
+    unsigned position = 0;
+    for (;;) {
+        const unsigned start = edge(samples, position, last, falling, condition.level);
+        if (start >= last) return -1.0;
+        const double deadline = interpolate(samples, last, start, condition.level) + condition.duration;
+
+        const unsigned end = edge(samples, start, last, !falling, condition.level);
+        if (end >= last || interpolate(samples, last, end, condition.level) > deadline) {
+            // The sample after the deadline has to be in the range
+            if (deadline >= last - 1) return -1.0;
+            if ((unsigned)deadline + 1 >= first) return deadline;
+        }
+        if (end >= last) return -1.0;
+        position = end;
+    }
+}
+
+/// \brief Interpolates the crossing of a level.
+/// The sin(x)/x reconstruction passes through the samples, so its crossing is between them as well. It is found
+/// with the Illinois variant of the regula falsi, starting at the linear crossing.
+/// \param samples The sample buffer.
+/// \param last The number of samples that may be used.
+/// \param index The sample after the crossing, the sample before it is on the other side of the level.
+/// \param level The level that is crossed.
+/// \return The position of the crossing in samples.
+double SoftwareTrigger::interpolate(const double *samples, unsigned last, unsigned index, double level) const {
+    double lower = index - 1;
+    double upper = index;
+    double lowerValue = samples[index - 1] - level;
+    double upperValue = samples[index] - level;
+    double position = lower + (level - samples[index - 1]) / (samples[index] - samples[index - 1]);
+    if (!condition.sinc) return position;
+
+    int side = 0;
+    for (int iteration = 0; iteration < SINC_ITERATIONS; ++iteration) {
+        const double value = reconstruct(samples, last, position) - level;
+        if (value == 0.0) break;
+        if ((value < 0.0) == (lowerValue < 0.0)) {
+            lower = position;
+            lowerValue = value;
+            if (side < 0) upperValue /= 2;
+            side = -1;
+        } else {
+            upper = position;
+            upperValue = value;
+            if (side > 0) lowerValue /= 2;
+            side = 1;
+        }
+        position = lower + (upper - lower) * lowerValue / (lowerValue - upperValue);
+    }
+    return position;
+}
+
+/// \brief Reconstructs the signal between the samples with a Lanczos windowed sin(x)/x.
+/// \param samples The sample buffer.
+/// \param last The number of samples that may be used.
+/// \param position The position in samples.
+/// \return The reconstructed value.
+double SoftwareTrigger::reconstruct(const double *samples, unsigned last, double position) {
+    const int center = (int)std::floor(position);
+    const int first = std::max(center - SINC_TAPS + 1, 0);
+    const int end = std::min(center + SINC_TAPS + 1, (int)last);
+    double value = 0.0;
+    for (int index = first; index < end; ++index) {
+        const double x = (position - index) * M_PI;
+        const double weight = (x == 0.0) ? 1.0 : SINC_TAPS * std::sin(x) * std::sin(x / SINC_TAPS) / (x * x);
+        value += samples[index] * weight;
+    }
+    return value;
+}
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include "definitions.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class SoftwareTrigger                                     softwaretrigger.h
+/// \brief Searches the trigger point in the samples of a frame.
+/// An edge is only accepted if the signal was beyond the hysteresis on the other
+/// side of the level before, so noise around the level doesn't trigger. The
+/// samples are scanned with the vectorized window search of the analysis, every
+/// search continues where the last one stopped, so the frame is read only once
+/// whatever the trigger type is.
+class SoftwareTrigger {
+  public:
+    /// \brief The condition that causes the trigger.
+    struct Condition {
+        Dso::TriggerType type = Dso::TRIGGERTYPE_EDGE;
+        /// The edge, the polarity of the pulse, or leaving (positive) or entering (negative) the window
+        Dso::Slope slope = Dso::SLOPE_POSITIVE;
+        double level = 0.0;      ///< The trigger level in V
+        double upperLevel = 0.0; ///< The upper level of the runt and window triggers in V
+        double hysteresis = 0.0; ///< The distance from a level in V that arms the trigger again
+        double duration = 0.0;   ///< The pulse width or timeout in samples
+        bool shorter = false;    ///< Pulses shorter than the duration trigger instead of longer ones
+        bool sinc = false;       ///< The crossings are interpolated with sin(x)/x instead of linearly
+    };
+
+    /// \brief Sets the trigger condition.
+    /// \param condition The condition, the upper level is raised to the level if it is below.
+    void configure(const Condition &condition);
+
+    /// \brief Searches the first trigger point.
+    /// Events that start before the first sample are still evaluated, only
+    /// the trigger point has to be in the range.
+    /// \param samples The sample buffer.
+    /// \param count The number of samples.
+    /// \param first The first sample that may be the one after the trigger point.
+    /// \param last The sample after the last one that may be the one after the trigger point.
+    /// \return The position of the trigger point in samples, interpolated between the two
+    /// samples around the level, or -1.0 if the trigger wasn't asserted.
+    double find(const double *samples, unsigned count, unsigned first, unsigned last) const;
+
+  private:
+    unsigned edge(const double *samples, unsigned position, unsigned last, bool falling, double level) const;
+    double findEdge(const double *samples, unsigned first, unsigned last) const;
+    double findPulse(const double *samples, unsigned first, unsigned last) const;
+    double findRunt(const double *samples, unsigned first, unsigned last) const;
+    double findWindow(const double *samples, unsigned first, unsigned last) const;
+    double findTimeout(const double *samples, unsigned first, unsigned last) const;
+    double interpolate(const double *samples, unsigned last, unsigned index, double level) const;
+    static double reconstruct(const double *samples, unsigned last, double position);
+
+    static const int SINC_TAPS = 8;       ///< The samples on each side of the sin(x)/x reconstruction
+    static const int SINC_ITERATIONS = 6; ///< The refinements of a crossing with sin(x)/x
+
+    Condition condition;
+};
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include "spectrumaverager.h"
+
+#include "analysiskernels.h"
+
+void SpectrumAverager::configure(Dso::SpectrumAveraging mode, unsigned frames) {
+    frames = std::max(frames, 1u);
+    if (mode == this->mode && frames == length) return;
+    this->mode = mode;
+    length = frames;
+    reset();
+}
+
+void SpectrumAverager::reset() {
+    frames = 0;
+    if (mode == Dso::AVERAGING_OFF) std::vector<double>().swap(accumulator);
+}
+
+void SpectrumAverager::add(double *levels, const double *power, unsigned count, double start, double binWidth,
+                           double offset, double limit) {
+    if (mode == Dso::AVERAGING_OFF || !count) return;
+
+    // Spectra of other bins or levels can't be combined
+    if (count != accumulator.size() || start != this->start || binWidth != this->binWidth ||
+        offset != this->offset || limit != this->limit) {
+        accumulator.resize(count);
+        this->start = start;
+        this->binWidth = binWidth;
+        this->offset = offset;
+        this->limit = limit;
+        frames = 0;
+    }
+
+    const double *values = (mode == Dso::AVERAGING_RMS) ? power : levels;
+    double *average = accumulator.data();
+    if (!frames) {
+        std::copy(values, values + count, average);
+    } else {
+        switch (mode) {
+        case Dso::AVERAGING_MAXHOLD:
+        case Dso::AVERAGING_MINHOLD:
+            Analysis::hold(values, mode == Dso::AVERAGING_MAXHOLD, average, count);
+            break;
+        default: {
+            // The exponential average weights every frame with the full share from the start
+            const double weight = 1.0 / ((mode == Dso::AVERAGING_EXPONENTIAL) ? length : std::min(frames + 1, length));
+            Analysis::scaledSum(average, values, 1.0 - weight, weight, average, count);
+        }
+        }
+    }
+    if (frames < length) ++frames;
+
+    if (mode == Dso::AVERAGING_RMS)
+        Analysis::powerLevel(average, count, levels, offset, limit);
+    else
+        std::copy(average, average + count, levels);
+}
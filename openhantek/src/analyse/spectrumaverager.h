@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <vector>
+
+#include "definitions.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class SpectrumAverager                                   spectrumaverager.h
+/// \brief Combines the spectra of consecutive frames of a channel.
+/// The average is updated in place with one accumulator per bin, so the memory
+/// is constant however many frames are averaged. The linear and RMS averages
+/// weight the frames since the restart equally until the set number of frames
+/// is reached, then every new frame gets that share like in the exponential
+/// average. The hold modes keep the extremes since the restart. The averages
+/// restart when the method or the bins change.
+class SpectrumAverager {
+  public:
+    /// \brief Selects the method, the average restarts if it changes.
+    /// \param mode The averaging method.
+    /// \param frames The number of frames of the linear, exponential and RMS average.
+    void configure(Dso::SpectrumAveraging mode, unsigned frames);
+    /// \brief Restarts the average with the next frame.
+    void reset();
+
+    /// \brief Adds the spectrum of a frame and replaces it with the averaged levels.
+    /// \param levels The levels of the bins in dB, they are replaced by the averaged levels.
+    /// \param power The power of the bins, the RMS average uses them instead of the levels.
+    /// \param count The number of bins.
+    /// \param start The frequency of the first bin.
+    /// \param binWidth The frequency step between the bins.
+    /// \param offset The offset of the levels like in Analysis::complexPower().
+    /// \param limit The minimal level like in Analysis::complexPower().
+    void add(double *levels, const double *power, unsigned count, double start, double binWidth, double offset,
+             double limit);
+
+  private:
+    Dso::SpectrumAveraging mode = Dso::AVERAGING_OFF;
+    unsigned length = 1;             ///< The number of frames in the full average
+    unsigned frames = 0;             ///< The number of frames in the average so far
+    std::vector<double> accumulator; ///< The averaged levels, or the averaged power for the RMS average
+    double start = 0.0;              ///< The frequency of the first bin of the averaged spectra
+    double binWidth = 0.0;           ///< The bin width of the averaged spectra
+    double offset = 0.0;             ///< The level offset of the averaged spectra
+    double limit = 0.0;              ///< The level limit of the averaged spectra
+};
@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include <QRunnable>
+
+#include "windowcache.h"
+
+/// \brief Calculates a prepared window on the calculator thread.
+class WindowCache::WindowJob : public QRunnable {
+  public:
+    WindowJob(const Key &key, const Promise &promise) : key(key), promise(promise) {}
+
+    void run() override { fulfill(key, promise); }
+
+  private:
+    Key key;
+    Promise promise;
+};
+
+WindowCache &WindowCache::instance() {
+    static WindowCache cache;
+    return cache;
+}
+
+WindowCache::WindowCache() { calculator.setMaxThreadCount(1); }
+
+WindowCache::~WindowCache() { calculator.waitForDone(); }
+
+WindowCache::Window WindowCache::window(Dso::WindowFunction function, unsigned int length) {
+    const Key key(function, length);
+    std::shared_future<Window> window;
+    Promise promise;
+
+    {
+        QMutexLocker locker(&mutex);
+        auto entry = entries.find(key);
+        if (entry != entries.end()) {
+            entry->second.lastUse = ++useCounter;
+            window = entry->second.window;
+        } else {
+            promise = insert(key);
+            window = entries[key].window;
+        }
+    }
+
+    // Calculate new windows outside of the lock, other threads wait for the future
+    if (promise) fulfill(key, promise);
+    return window.get();
+}
+
+void WindowCache::prepare(Dso::WindowFunction function) {
+    QMutexLocker locker(&mutex);
+
+    std::vector<unsigned int> lengths;
+    for (auto &entry : entries)
+        if (entry.first.first != function) lengths.push_back(entry.first.second);
+
+    for (unsigned int length : lengths) {
+        const Key key(function, length);
+        if (entries.count(key)) continue;
+        calculator.start(new WindowJob(key, insert(key)));
+    }
+}
+
+/// \brief Adds an entry that isn't calculated yet, the mutex has to be locked.
+/// Drops the least recently used entries if the cache is full.
+/// \return The promise that has to be fulfilled with the window.
+WindowCache::Promise WindowCache::insert(const Key &key) {
+    while (entries.size() >= MAX_ENTRIES) {
+        auto oldest = entries.begin();
+        for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+            if (entry->second.lastUse < oldest->second.lastUse) oldest = entry;
+        entries.erase(oldest);
+    }
+
+    Promise promise = std::make_shared<std::promise<Window>>();
+    Entry &entry = entries[key];
+    entry.window = promise->get_future().share();
+    entry.lastUse = ++useCounter;
+    return promise;
+}
+
+void WindowCache::fulfill(const Key &key, const Promise &promise) {
+    std::shared_ptr<std::vector<double>> window = std::make_shared<std::vector<double>>(key.second);
+    calculate(key.first, key.second, window->data());
+    promise->set_value(window);
+}
+
+void WindowCache::calculate(Dso::WindowFunction function, unsigned int length, double *buffer) {
+    unsigned int windowEnd = length - 1;
+
+    switch (function) {
+    case Dso::WINDOW_HAMMING:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] = 0.54 - 0.46 * cos(2.0 * M_PI * windowPosition / windowEnd);
+        break;
+    case Dso::WINDOW_HANN:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] = 0.5 * (1.0 - cos(2.0 * M_PI * windowPosition / windowEnd));
+        break;
+    case Dso::WINDOW_COSINE:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] = sin(M_PI * windowPosition / windowEnd);
+        break;
+    case Dso::WINDOW_LANCZOS:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition) {
+            double sincParameter = (2.0 * windowPosition / windowEnd - 1.0) * M_PI;
+            if (sincParameter == 0)
+                buffer[windowPosition] = 1;
+            else
+                buffer[windowPosition] = sin(sincParameter) / sincParameter;
+        }
+        break;
+    case Dso::WINDOW_BARTLETT:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] =
+                2.0 / windowEnd * (windowEnd / 2 - std::abs((double)(windowPosition - windowEnd / 2.0)));
+        break;
+    case Dso::WINDOW_TRIANGULAR:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] =
+                2.0 / length *
+                (length / 2 - std::abs((double)(windowPosition - windowEnd / 2.0)));
+        break;
+    case Dso::WINDOW_GAUSS: {
+        double sigma = 0.4;
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] =
+                exp(-0.5 * pow(((windowPosition - windowEnd / 2) / (sigma * windowEnd / 2)), 2));
+    } break;
+    case Dso::WINDOW_BARTLETTHANN:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] = 0.62 -
+                                                   0.48 * std::abs((double)(windowPosition / windowEnd - 0.5)) -
+                                                   0.38 * cos(2.0 * M_PI * windowPosition / windowEnd);
+        break;
+    case Dso::WINDOW_BLACKMAN: {
+        double alpha = 0.16;
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] = (1 - alpha) / 2 -
+                                                   0.5 * cos(2.0 * M_PI * windowPosition / windowEnd) +
+                                                   alpha / 2 * cos(4.0 * M_PI * windowPosition / windowEnd);
+    } break;
+    // case WINDOW_KAISER:
+    // TODO WINDOW_KAISER
+    // double alpha = 3.0;
+    // for(unsigned int windowPosition = 0; windowPosition <
+    // length; ++windowPosition)
+    //*(window + windowPosition) = ;
+    // break;
+    case Dso::WINDOW_NUTTALL:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] = 0.355768 -
+                                                   0.487396 * cos(2 * M_PI * windowPosition / windowEnd) +
+                                                   0.144232 * cos(4 * M_PI * windowPosition / windowEnd) -
+                                                   0.012604 * cos(6 * M_PI * windowPosition / windowEnd);
+        break;
+    case Dso::WINDOW_BLACKMANHARRIS:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] = 0.35875 -
+                                                   0.48829 * cos(2 * M_PI * windowPosition / windowEnd) +
+                                                   0.14128 * cos(4 * M_PI * windowPosition / windowEnd) -
+                                                   0.01168 * cos(6 * M_PI * windowPosition / windowEnd);
+        break;
+    case Dso::WINDOW_BLACKMANNUTTALL:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] = 0.3635819 -
+                                                   0.4891775 * cos(2 * M_PI * windowPosition / windowEnd) +
+                                                   0.1365995 * cos(4 * M_PI * windowPosition / windowEnd) -
+                                                   0.0106411 * cos(6 * M_PI * windowPosition / windowEnd);
+        break;
+    case Dso::WINDOW_FLATTOP:
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] = 1.0 - 1.93 * cos(2 * M_PI * windowPosition / windowEnd) +
+                                                   1.29 * cos(4 * M_PI * windowPosition / windowEnd) -
+                                                   0.388 * cos(6 * M_PI * windowPosition / windowEnd) +
+                                                   0.032 * cos(8 * M_PI * windowPosition / windowEnd);
+        break;
+    default: // Dso::WINDOW_RECTANGULAR
+        for (unsigned int windowPosition = 0; windowPosition < length; ++windowPosition)
+            buffer[windowPosition] = 1.0;
+    }
+}
@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+#include <QThreadPool>
+#include <future>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "definitions.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class WindowCache                                             windowcache.h
+/// \brief Process wide cache of dft window coefficients.
+/// Holds the windows for several combinations of window function and length,
+/// so channels with different record lengths and several analyzers share
+/// them. The least recently used windows are dropped if the cache is full.
+class WindowCache {
+  public:
+    typedef std::shared_ptr<const std::vector<double>> Window;
+
+    /// \return The cache used by all analyzers.
+    static WindowCache &instance();
+
+    ~WindowCache();
+
+    /// \brief Gets the window, it is calculated if it isn't cached.
+    /// Waits if the window is being calculated by another thread.
+    /// \param function The window function.
+    /// \param length The number of coefficients.
+    /// \return The coefficients, they stay valid as long as the pointer is held.
+    Window window(Dso::WindowFunction function, unsigned int length);
+
+    /// \brief Calculates a window function in the background for all cached lengths.
+    /// Call this when the window function is changed, so the next frames don't need to calculate it.
+    /// \param function The window function.
+    void prepare(Dso::WindowFunction function);
+
+    /// \brief Calculates the coefficients of a dft window function.
+    /// \param function The window function.
+    /// \param length The number of coefficients.
+    /// \param buffer The buffer for the coefficients, it has to hold length values.
+    static void calculate(Dso::WindowFunction function, unsigned int length, double *buffer);
+
+  private:
+    typedef std::pair<Dso::WindowFunction, unsigned int> Key;
+    typedef std::shared_ptr<std::promise<Window>> Promise;
+    struct Entry {
+        std::shared_future<Window> window; ///< Becomes ready when the window was calculated
+        unsigned long lastUse;             ///< The value of the use counter when the window was requested last
+    };
+    class WindowJob;
+
+    WindowCache();
+
+    Promise insert(const Key &key);
+    static void fulfill(const Key &key, const Promise &promise);
+
+    static const unsigned int MAX_ENTRIES = 16; ///< The number of windows that are kept
+
+    QMutex mutex;                 ///< Protects the entries
+    std::map<Key, Entry> entries; ///< The cached windows
+    unsigned long useCounter = 0; ///< Counts the requests to find the least recently used window
+    QThreadPool calculator;       ///< Calculates the prepared windows
+};
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <cmath>
+
+#include <fftw3.h>
+
+#include "zoomfft.h"
+
+#include "analysiskernels.h"
+#include "fftplancache.h"
+#include "windowcache.h"
+
+const unsigned int ZoomFft::PHASE_TAPS;
+const unsigned int ZoomFft::MIN_BINS;
+
+namespace {
+/// The cutoff of the filter relative to the decimated samplerate, the outer bins of the band are attenuated
+const double CUTOFF = 0.45;
+}
+
+unsigned int ZoomFft::transform(const double *const spans[2], const size_t spanLengths[2], double interval,
+                                double center, unsigned int factor, Dso::WindowFunction window) {
+    factor = std::max(factor, 1u);
+    const size_t count = spanLengths[0] + spanLengths[1];
+    const unsigned int tapCount = PHASE_TAPS * factor + 1;
+    if (count < tapCount) return 0;
+    // Moving the center to the middle bin needs an even number of bins
+    unsigned int binCount = (unsigned int)((count - tapCount) / factor + 1);
+    binCount -= binCount % 2;
+    if (binCount < MIN_BINS) return 0;
+
+    const double *samples = spans[0];
+    if (spanLengths[1] > 0) {
+        double *contiguous = record.reserve(count);
+        std::copy(spans[0], spans[0] + spanLengths[0], contiguous);
+        std::copy(spans[1], spans[1] + spanLengths[1], contiguous + spanLengths[0]);
+        samples = contiguous;
+    }
+
+    // The phase of the center frequency advances by this per sample
+    const double phaseStep = 2.0 * M_PI * center * interval;
+    if (factor != tapFactor || phaseStep != tapPhaseStep) design(factor, phaseStep);
+
+    WindowCache::Window windowValues = WindowCache::instance().window(window, binCount);
+    double *input = decimated.reserve(2 * binCount);
+    double *output = spectrum.reserve(2 * binCount);
+    for (unsigned int position = 0; position < binCount; ++position) {
+        const size_t first = (size_t)position * factor;
+        const double real = Analysis::dotProduct(samples + first, realTaps.data(), tapCount);
+        const double imaginary = Analysis::dotProduct(samples + first, imaginaryTaps.data(), tapCount);
+        // The taps are mixed from the first sample of the filter on, the rest of the mixer phase is applied here
+        const double phase = std::fmod(phaseStep * (double)first, 2.0 * M_PI);
+        // Alternating signs move the center frequency from the first to the middle bin
+        const double scale = (*windowValues)[position] * ((position % 2) ? -1.0 : 1.0);
+        const double cosine = std::cos(phase) * scale;
+        const double sine = std::sin(phase) * scale;
+        input[2 * position] = real * cosine + imaginary * sine;
+        input[2 * position + 1] = imaginary * cosine - real * sine;
+    }
+
+    FftPlanCache::Plan fftPlan = FftPlanCache::instance().plan(FftPlanCache::KIND_C2C, binCount, input, output);
+    fftw_execute_dft(fftPlan.get(), reinterpret_cast<fftw_complex *>(input), reinterpret_cast<fftw_complex *>(output));
+
+    width = 1.0 / interval / factor / binCount;
+    firstFrequency = center - (binCount / 2) * width;
+    return binCount;
+}
+
+/// \brief Designs the low-pass filter and mixes its taps with the center frequency.
+/// The filter is a Blackman windowed sinc with unity gain at the center frequency.
+/// \param factor The decimation factor.
+/// \param phaseStep The phase of the center frequency per sample.
+void ZoomFft::design(unsigned int factor, double phaseStep) {
+    const unsigned int tapCount = PHASE_TAPS * factor + 1;
+    realTaps.resize(tapCount);
+    imaginaryTaps.resize(tapCount);
+    WindowCache::calculate(Dso::WINDOW_BLACKMAN, tapCount, imaginaryTaps.data());
+
+    const double cutoff = CUTOFF / factor; // In cycles per sample
+    const double middle = (tapCount - 1) / 2.0;
+    double sum = 0.0;
+    for (unsigned int tap = 0; tap < tapCount; ++tap) {
+        const double x = tap - middle;
+        const double sinc = (x == 0.0) ? 2.0 * cutoff : std::sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+        realTaps[tap] = sinc * imaginaryTaps[tap];
+        sum += realTaps[tap];
+    }
+    for (unsigned int tap = 0; tap < tapCount; ++tap) {
+        const double lowPass = realTaps[tap] / sum;
+        realTaps[tap] = lowPass * std::cos(phaseStep * tap);
+        imaginaryTaps[tap] = -lowPass * std::sin(phaseStep * tap);
+    }
+    tapFactor = factor;
+    tapPhaseStep = phaseStep;
+}
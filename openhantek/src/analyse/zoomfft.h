@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "definitions.h"
+#include "scratchbuffer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ZoomFft                                                     zoomfft.h
+/// \brief Calculates the spectrum of a narrow band around a center frequency.
+/// The record is mixed down by the center frequency, low-pass filtered and
+/// decimated by the zoom factor, then a complex FFT of the decimated samples
+/// gives the bins of the band. The bins are as narrow as those of the whole
+/// record, but the FFT is smaller by the zoom factor. The mixer is part of the
+/// filter taps and the filter is only evaluated for the kept samples, so the
+/// record is read once and no mixed copy of it is needed.
+class ZoomFft {
+  public:
+    /// \brief Calculates the complex spectrum of the band.
+    /// \param spans The samples as two contiguous spans, the second one may be empty.
+    /// \param spanLengths The number of samples in the spans.
+    /// \param interval The time between two samples in s.
+    /// \param center The center of the band in Hz.
+    /// \param factor The decimation factor, the band is the samplerate divided by it.
+    /// \param window The window function applied to the decimated samples.
+    /// \return The number of bins, 0 if the record is too short for the filter.
+    unsigned int transform(const double *const spans[2], const size_t spanLengths[2], double interval, double center,
+                           unsigned int factor, Dso::WindowFunction window);
+
+    /// \return The interleaved real and imaginary parts of the bins, beginning with the lowest frequency.
+    const double *bins() const { return spectrum.data(); }
+    /// \return A buffer for the power of the bins, it is free after transform().
+    double *power() { return decimated.data(); }
+    /// \return The frequency of the first bin in Hz.
+    double start() const { return firstFrequency; }
+    /// \return The frequency step between two bins in Hz.
+    double binWidth() const { return width; }
+
+    static const unsigned int PHASE_TAPS = 32; ///< The length of the filter in decimated samples
+    static const unsigned int MIN_BINS = 16;   ///< The minimal number of decimated samples
+
+  private:
+    void design(unsigned int factor, double phaseStep);
+
+    std::vector<double> realTaps;      ///< The filter taps mixed with the cosine of the center frequency
+    std::vector<double> imaginaryTaps; ///< The filter taps mixed with the negative sine of the center frequency
+    unsigned int tapFactor = 0;        ///< The decimation factor the taps are designed for
+    double tapPhaseStep = 0.0;         ///< The phase step of the center frequency the taps are mixed with
+    ScratchBuffer record;              ///< The contiguous samples, if they are split into two spans
+    ScratchBuffer decimated;           ///< The windowed decimated samples, then the power of the bins
+    ScratchBuffer spectrum;            ///< The complex bins
+    double firstFrequency = 0.0;
+    double width = 0.0;
+};
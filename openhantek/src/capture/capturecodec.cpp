@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cstring>
+
+#include "capture/capturecodec.h"
+
+namespace {
+/// \brief Packs the zigzag coded differences of the codes.
+/// \param output The buffer, it has to hold count * sizeof(Code) bytes and a byte for every group.
+/// \return The number of bytes written.
+template <typename Code> size_t packCodes(const Code *codes, size_t count, uchar *output) {
+    const unsigned codeBits = sizeof(Code) * 8;
+    uchar *out = output;
+    Code previous = 0;
+    Code zigzag[Capture::PACK_GROUP];
+    for (size_t first = 0; first < count; first += Capture::PACK_GROUP) {
+        const size_t length = std::min(count - first, Capture::PACK_GROUP);
+        unsigned combined = 0;
+        for (size_t index = 0; index < length; ++index) {
+            // The differences wrap around like the codes, the sign is the top bit
+            const Code delta = (Code)(codes[first + index] - previous);
+            previous = codes[first + index];
+            zigzag[index] = (Code)(((unsigned)delta << 1) ^ (0u - ((unsigned)delta >> (codeBits - 1))));
+            combined |= zigzag[index];
+        }
+        unsigned bits = 0;
+        while (combined >> bits) ++bits;
+        *(out++) = (uchar)bits;
+
+        // The values are stored from the least significant bit on, a group ends at a byte boundary
+        uint32_t buffer = 0;
+        unsigned filled = 0;
+        for (size_t index = 0; index < length; ++index) {
+            buffer |= (uint32_t)zigzag[index] << filled;
+            filled += bits;
+            while (filled >= 8) {
+                *(out++) = (uchar)buffer;
+                buffer >>= 8;
+                filled -= 8;
+            }
+        }
+        if (filled) *(out++) = (uchar)buffer;
+    }
+    return (size_t)(out - output);
+}
+
+/// \brief Restores the codes from the packed differences.
+/// \return false, if the packed data doesn't match the number of codes.
+template <typename Code> bool unpackCodes(const uchar *input, size_t size, size_t count, Code *codes) {
+    const uchar *in = input;
+    const uchar *const end = input + size;
+    Code previous = 0;
+    for (size_t first = 0; first < count; first += Capture::PACK_GROUP) {
+        const size_t length = std::min(count - first, Capture::PACK_GROUP);
+        if (in == end) return false;
+        const unsigned bits = *(in++);
+        if (bits > sizeof(Code) * 8 || (size_t)(end - in) < (length * bits + 7) / 8) return false;
+
+        const uint32_t mask = (1u << bits) - 1;
+        uint32_t buffer = 0;
+        unsigned filled = 0;
+        for (size_t index = 0; index < length; ++index) {
+            while (filled < bits) {
+                buffer |= (uint32_t)*(in++) << filled;
+                filled += 8;
+            }
+            const unsigned zigzag = buffer & mask;
+            buffer >>= bits;
+            filled -= bits;
+            previous = (Code)(previous + ((zigzag >> 1) ^ (0u - (zigzag & 1u))));
+            codes[first + index] = previous;
+        }
+    }
+    return in == end;
+}
+} // namespace
+
+namespace Capture {
+
+void encodeChunk(const void *codes, size_t count, bool wide, std::vector<char> &chunk) {
+    const size_t rawSize = count * (wide ? sizeof(uint16_t) : sizeof(uint8_t));
+    const size_t groups = (count + PACK_GROUP - 1) / PACK_GROUP;
+    chunk.resize(sizeof(ChunkHeader) + padded(rawSize + groups));
+    uchar *payload = reinterpret_cast<uchar *>(chunk.data()) + sizeof(ChunkHeader);
+
+    ChunkHeader header;
+    header.method = CHUNK_PACKED;
+    header.reserved = 0;
+    header.size = wide ? packCodes(static_cast<const uint16_t *>(codes), count, payload)
+                       : packCodes(static_cast<const uint8_t *>(codes), count, payload);
+    if (header.size >= rawSize) {
+        // Noise over the whole range doesn't get smaller
+        header.method = CHUNK_RAW;
+        header.size = rawSize;
+        std::memcpy(payload, codes, rawSize);
+    }
+    std::memcpy(chunk.data(), &header, sizeof(header));
+    const size_t size = sizeof(ChunkHeader) + padded(header.size);
+    std::fill(chunk.begin() + sizeof(ChunkHeader) + header.size, chunk.begin() + size, 0);
+    chunk.resize(size);
+}
+
+uint64_t chunkSize(const uchar *chunk, uint64_t available) {
+    if (available < sizeof(ChunkHeader)) return 0;
+    const ChunkHeader *header = reinterpret_cast<const ChunkHeader *>(chunk);
+    if (header->method > CHUNK_PACKED || header->size > available - sizeof(ChunkHeader)) return 0;
+    const uint64_t size = sizeof(ChunkHeader) + padded(header->size);
+    return (size <= available) ? size : 0;
+}
+
+bool decodeChunk(const uchar *chunk, size_t count, bool wide, void *codes) {
+    const ChunkHeader *header = reinterpret_cast<const ChunkHeader *>(chunk);
+    const uchar *payload = chunk + sizeof(ChunkHeader);
+    if (header->method == CHUNK_RAW) {
+        const size_t rawSize = count * (wide ? sizeof(uint16_t) : sizeof(uint8_t));
+        if (header->size != rawSize) return false;
+        std::memcpy(codes, payload, rawSize);
+        return true;
+    }
+    return wide ? unpackCodes(payload, (size_t)header->size, count, static_cast<uint16_t *>(codes))
+                : unpackCodes(payload, (size_t)header->size, count, static_cast<uint8_t *>(codes));
+}
+}
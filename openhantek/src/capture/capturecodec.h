@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QtGlobal>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "capture/captureformat.h"
+
+/// \brief The lossless codec of the chunks in compressed frames.
+/// The differences of consecutive codes are zigzag coded, so small steps in
+/// both directions become small numbers. They are packed in groups of
+/// PACK_GROUP with the number of bits the largest one needs, a byte before
+/// every group holds that number. A noisy signal with a few codes of noise
+/// takes 3 or 4 bits per sample, a flat line one byte per group. Chunks that
+/// don't get smaller are stored raw.
+namespace Capture {
+
+static const size_t PACK_GROUP = 16; ///< The codes that are packed with the same number of bits
+
+/// \brief Encodes the codes of a channel as a chunk.
+/// \param codes The codes, uint16_t if wide, otherwise uint8_t.
+/// \param count The number of codes.
+/// \param wide true for 16 bit codes.
+/// \param chunk Set to the ChunkHeader and the encoded codes, padded to PADDING with zeros.
+void encodeChunk(const void *codes, size_t count, bool wide, std::vector<char> &chunk);
+
+/// \brief Gets the size of a chunk.
+/// \param chunk The start of the chunk.
+/// \param available The bytes from the start of the chunk to the end of the frame.
+/// \return The size of the chunk including the header and the padding, 0 if it doesn't fit.
+uint64_t chunkSize(const uchar *chunk, uint64_t available);
+
+/// \brief Decodes a chunk, chunkSize() has to accept it.
+/// \param chunk The start of the chunk.
+/// \param count The number of codes.
+/// \param wide true for 16 bit codes.
+/// \param codes The buffer for the codes, uint16_t if wide, otherwise uint8_t.
+/// \return false, if the chunk is damaged, the codes are undefined then.
+bool decodeChunk(const uchar *chunk, size_t count, bool wide, void *codes);
+}
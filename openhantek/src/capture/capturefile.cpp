@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCoreApplication>
+#include <cstring>
+
+#include "capture/capturecodec.h"
+#include "capture/capturefile.h"
+
+CaptureFile::~CaptureFile() { close(); }
+
+bool CaptureFile::open(const QString &fileName) {
+    close();
+
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    size = (quint64)file.size();
+    if (size < sizeof(Capture::FileHeader)) {
+        error = QCoreApplication::translate("CaptureFile", "The file is too short");
+        close();
+        return false;
+    }
+    data = file.map(0, (qint64)size);
+    if (data == nullptr) {
+        error = file.errorString();
+        close();
+        return false;
+    }
+
+    header = reinterpret_cast<const Capture::FileHeader *>(data);
+    if (std::memcmp(header->magic, Capture::FILE_MAGIC, sizeof(header->magic)) != 0) {
+        error = QCoreApplication::translate("CaptureFile", "The file is not a capture file");
+        close();
+        return false;
+    }
+    if (header->version < Capture::FILE_VERSION_MIN || header->version > Capture::FILE_VERSION) {
+        error = QCoreApplication::translate("CaptureFile", "The capture format version %1 is not supported")
+                    .arg(header->version);
+        close();
+        return false;
+    }
+
+    quint64 offset = sizeof(Capture::FileHeader);
+    while (validFrame(offset)) {
+        frames.push_back(offset);
+        offset += reinterpret_cast<const Capture::FrameHeader *>(data + offset)->size;
+    }
+    truncated = offset != size;
+    error.clear();
+    return true;
+}
+
+void CaptureFile::close() {
+    if (data) file.unmap(const_cast<uchar *>(data));
+    file.close();
+    data = nullptr;
+    size = 0;
+    header = nullptr;
+    std::vector<quint64>().swap(frames);
+    truncated = false;
+}
+
+QString CaptureFile::model() const {
+    if (!header) return QString();
+    return QString::fromUtf8(header->model, (int)qstrnlen(header->model, sizeof(header->model)));
+}
+
+const Capture::FrameHeader *CaptureFile::frameHeader(size_t index) const {
+    return reinterpret_cast<const Capture::FrameHeader *>(data + frames[index]);
+}
+
+const Capture::ChannelHeader *CaptureFile::channelHeader(size_t index, unsigned channel) const {
+    return reinterpret_cast<const Capture::ChannelHeader *>(frameHeader(index) + 1) + channel;
+}
+
+void CaptureFile::readFrame(size_t index, DSOsamples &target) const {
+    const Capture::FrameHeader *frame = frameHeader(index);
+    const Capture::ChannelHeader *channels = reinterpret_cast<const Capture::ChannelHeader *>(frame + 1);
+    const uchar *codes = reinterpret_cast<const uchar *>(channels + frame->channels);
+    const bool wide = frame->flags & Capture::FRAME_WIDE;
+    const bool compressed = frame->flags & Capture::FRAME_COMPRESSED;
+    const size_t codeSize = wide ? sizeof(uint16_t) : sizeof(uint8_t);
+    const uchar *const frameEnd = reinterpret_cast<const uchar *>(frame) + frame->size;
+
+    target.compact = true;
+    target.samplerate = frame->samplerate;
+    target.append = frame->flags & Capture::FRAME_APPEND;
+    target.timestamp = frame->timestamp;
+    target.compactData.resize(frame->channels);
+    for (unsigned channel = 0; channel < frame->channels; ++channel) {
+        DSOcompactChannel &compactChannel = target.compactData[channel];
+        const size_t count = channels[channel].count;
+        compactChannel.wide = wide;
+        compactChannel.scale = channels[channel].scale;
+        compactChannel.shift = channels[channel].shift;
+        if (compressed) {
+            // The chunks were checked when the file was opened, a damaged chunk is read as zero codes
+            bool decoded;
+            if (wide) {
+                compactChannel.codes16.resize(count);
+                decoded = Capture::decodeChunk(codes, count, true, compactChannel.codes16.data());
+                if (!decoded) compactChannel.codes16.assign(count, 0);
+                compactChannel.codes8.clear();
+            } else {
+                compactChannel.codes8.resize(count);
+                decoded = Capture::decodeChunk(codes, count, false, compactChannel.codes8.data());
+                if (!decoded) compactChannel.codes8.assign(count, 0);
+                compactChannel.codes16.clear();
+            }
+            codes += Capture::chunkSize(codes, (quint64)(frameEnd - codes));
+            continue;
+        }
+        if (wide) {
+            const uint16_t *first = reinterpret_cast<const uint16_t *>(codes);
+            compactChannel.codes16.assign(first, first + count);
+            compactChannel.codes8.clear();
+        } else {
+            compactChannel.codes8.assign(codes, codes + count);
+            compactChannel.codes16.clear();
+        }
+        codes += Capture::padded(count * codeSize);
+    }
+}
+
+/// \brief Checks if a complete frame with consistent sizes starts at the offset.
+bool CaptureFile::validFrame(quint64 offset) const {
+    if (size - offset < sizeof(Capture::FrameHeader)) return false;
+    const Capture::FrameHeader *frame = reinterpret_cast<const Capture::FrameHeader *>(data + offset);
+    if (frame->magic != Capture::FRAME_MAGIC || frame->channels != header->channels) return false;
+
+    const quint64 headers = sizeof(Capture::FrameHeader) + frame->channels * sizeof(Capture::ChannelHeader);
+    if (frame->size < headers || frame->size > size - offset || frame->size % Capture::PADDING) return false;
+
+    // The codes of all channels have to fit in the frame
+    const Capture::ChannelHeader *channels = reinterpret_cast<const Capture::ChannelHeader *>(frame + 1);
+    const quint64 codeSize = (frame->flags & Capture::FRAME_WIDE) ? sizeof(uint16_t) : sizeof(uint8_t);
+    if (frame->flags & Capture::FRAME_COMPRESSED) {
+        // Every chunk holds its size, a packed group takes at least one byte
+        quint64 position = offset + headers;
+        const quint64 end = offset + frame->size;
+        for (unsigned channel = 0; channel < frame->channels; ++channel) {
+            const uchar *chunk = data + position;
+            const quint64 chunkSize = Capture::chunkSize(chunk, end - position);
+            if (chunkSize == 0) return false;
+            const Capture::ChunkHeader *chunkHeader = reinterpret_cast<const Capture::ChunkHeader *>(chunk);
+            const quint64 count = channels[channel].count;
+            if (chunkHeader->method == Capture::CHUNK_RAW ? chunkHeader->size != count * codeSize
+                                                          : count > chunkHeader->size * Capture::PACK_GROUP)
+                return false;
+            position += chunkSize;
+        }
+        return true;
+    }
+    quint64 codes = 0;
+    for (unsigned channel = 0; channel < frame->channels; ++channel) {
+        if (channels[channel].count > frame->size / codeSize) return false;
+        codes += Capture::padded(channels[channel].count * codeSize);
+    }
+    return headers + codes <= frame->size;
+}
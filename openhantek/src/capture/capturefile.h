@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <vector>
+
+#include "capture/captureformat.h"
+#include "dsosamples.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class CaptureFile                                             capturefile.h
+/// \brief Reads a file written by the CaptureRecorder.
+/// The file is mapped into memory, so only the pages of the frames that are
+/// read are loaded and a recording can be larger than the memory. Opening the
+/// file only walks the frame headers to build the index for the random access.
+/// A recording that was cut off is read up to the last complete frame.
+class CaptureFile {
+  public:
+    ~CaptureFile();
+
+    /// \brief Maps a capture file and indexes its frames.
+    /// \param fileName The name of the file.
+    /// \return true on success, otherwise errorString() describes the problem.
+    bool open(const QString &fileName);
+
+    /// \brief Unmaps the file.
+    void close();
+
+    /// \return The description of the last error.
+    QString errorString() const { return error; }
+    /// \return The number of channels of every frame.
+    unsigned channelCount() const { return header ? header->channels : 0; }
+    /// \return The name of the device model the file was recorded with.
+    QString model() const;
+    /// \return The number of complete frames.
+    size_t frameCount() const { return frames.size(); }
+    /// \return true, if the file ends with an incomplete or damaged frame.
+    bool isTruncated() const { return truncated; }
+
+    /// \brief Gets the header of a frame.
+    /// \param index The index of the frame, it has to be less than frameCount().
+    const Capture::FrameHeader *frameHeader(size_t index) const;
+
+    /// \brief Gets the settings of a channel in a frame.
+    /// \param index The index of the frame, it has to be less than frameCount().
+    /// \param channel The channel, it has to be less than channelCount().
+    const Capture::ChannelHeader *channelHeader(size_t index, unsigned channel) const;
+
+    /// \brief Copies the codes of a frame into a compact frame.
+    /// The buffers of the target are reused.
+    /// \param index The index of the frame, it has to be less than frameCount().
+    /// \param target The frame that is filled.
+    void readFrame(size_t index, DSOsamples &target) const;
+
+  private:
+    bool validFrame(quint64 offset) const;
+
+    QFile file;
+    const uchar *data = nullptr;                ///< The mapped file
+    quint64 size = 0;                           ///< The size of the mapped file in bytes
+    const Capture::FileHeader *header = nullptr; ///< The start of the mapped file
+    std::vector<quint64> frames;                ///< The offsets of the frames in the file
+    bool truncated = false;
+    QString error;
+};
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cstdint>
+
+/// \namespace Capture
+/// \brief The binary capture file format.
+/// A capture file is a FileHeader followed by the frames. Every frame is a
+/// FrameHeader, a ChannelHeader for every channel and the raw codes of the
+/// channels. The codes of a channel are padded to a multiple of 8 bytes, so all
+/// headers and codes are aligned when the file is mapped into memory. All values
+/// are stored in the byte order of the recording machine, which is little endian
+/// on all supported platforms. The voltage of a code is code * scale + shift.
+/// In a compressed frame the codes of every channel are stored as a chunk
+/// instead, a ChunkHeader followed by the encoded codes, see capturecodec.h.
+/// Every chunk can be decoded on its own, so the frames stay random accessible.
+namespace Capture {
+
+static const char FILE_MAGIC[8] = {'O', 'H', 'C', 'A', 'P', 'T', 'U', 'R'}; ///< The start of every capture file
+static const uint32_t FILE_VERSION = 2;                                      ///< The current format version
+static const uint32_t FILE_VERSION_MIN = 1;                                  ///< The oldest readable version
+static const uint32_t FRAME_MAGIC = 0x4d415246;                              ///< "FRAM", the start of every frame
+static const unsigned PADDING = 8; ///< The alignment of the headers and codes
+
+/// \brief The flags of a frame.
+enum FrameFlags : uint32_t {
+    FRAME_APPEND = 1,    ///< The samples continue the previous frame, the roll mode stream
+    FRAME_WIDE = 2,      ///< The codes are 16 bit instead of 8 bit
+    FRAME_COMPRESSED = 4 ///< The codes of every channel are stored as a chunk
+};
+
+/// \brief The encoding of the codes in a chunk.
+enum ChunkMethod : uint32_t {
+    CHUNK_RAW = 0,   ///< The codes unchanged, if they couldn't be compressed
+    CHUNK_PACKED = 1 ///< The differences packed with the bits they need, see Capture::packCodes()
+};
+
+/// \brief The start of a capture file.
+struct FileHeader {
+    char magic[8];     ///< FILE_MAGIC
+    uint32_t version;  ///< FILE_VERSION
+    uint32_t channels; ///< The number of channels of every frame
+    char model[48];    ///< The name of the device model, zero terminated
+};
+
+/// \brief The start of a frame.
+struct FrameHeader {
+    uint32_t magic;      ///< FRAME_MAGIC
+    uint32_t flags;      ///< The FrameFlags
+    uint64_t size;       ///< The size of the frame including this header in bytes
+    uint64_t index;      ///< The number of the frame since the start of the recording
+    int64_t timestamp;   ///< Steady clock time in ns the data was received at
+    double samplerate;   ///< The samplerate in S/s
+    double triggerPoint; ///< The position of the trigger in samples, negative in roll mode
+    uint32_t channels;   ///< The number of ChannelHeader after this header
+    uint32_t reserved;   ///< Always 0
+};
+
+/// \brief The conversion of the codes of a channel in a frame.
+struct ChannelHeader {
+    uint64_t count; ///< The number of codes, 0 if the channel is unused
+    double scale;   ///< Volts per code
+    double shift;   ///< Voltage of the code 0
+    double gain;    ///< The gain of the channel in V/div
+    double offset;  ///< The offset of the channel in divs
+};
+
+/// \brief The start of the codes of a channel in a compressed frame.
+struct ChunkHeader {
+    uint32_t method;   ///< The ChunkMethod
+    uint32_t reserved; ///< Always 0
+    uint64_t size;     ///< The size of the encoded codes after this header in bytes, without the padding
+};
+
+static_assert(sizeof(FileHeader) % PADDING == 0, "The file header has to keep the frames aligned");
+static_assert(sizeof(FrameHeader) % PADDING == 0, "The frame header has to keep the channels aligned");
+static_assert(sizeof(ChannelHeader) % PADDING == 0, "The channel header has to keep the codes aligned");
+static_assert(sizeof(ChunkHeader) % PADDING == 0, "The chunk header has to keep the codes aligned");
+
+/// \brief Rounds a size up to the alignment of the format.
+inline uint64_t padded(uint64_t size) { return (size + PADDING - 1) / PADDING * PADDING; }
+}
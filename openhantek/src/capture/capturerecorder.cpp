@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include <QRunnable>
+
+#include "capture/capturecodec.h"
+#include "capture/captureformat.h"
+#include "capture/capturerecorder.h"
+
+namespace {
+/// \brief Runs the writer loop of the recorder.
+class WriterThread : public QThread {
+  public:
+    explicit WriterThread(std::function<void()> job) : job(job) {}
+
+  protected:
+    void run() override { job(); }
+
+  private:
+    std::function<void()> job;
+};
+
+/// \brief Encodes a part of the chunks of a block on a worker thread.
+class CompressJob : public QRunnable {
+  public:
+    explicit CompressJob(std::function<void()> job) : job(job) {}
+
+    void run() override { job(); }
+
+  private:
+    std::function<void()> job;
+};
+}
+
+const size_t CaptureRecorder::BLOCK_SIZE;
+const unsigned CaptureRecorder::BLOCK_COUNT;
+const int CaptureRecorder::FLUSH_INTERVAL;
+
+CaptureRecorder::CaptureRecorder() : recording(false), recorded(0), dropped(0) {}
+
+CaptureRecorder::~CaptureRecorder() { stop(); }
+
+bool CaptureRecorder::start(const QString &fileName, const QString &model, unsigned channels, bool compress) {
+    stop();
+
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        error = file.errorString();
+        return false;
+    }
+    Capture::FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Capture::FILE_MAGIC, sizeof(header.magic));
+    header.version = Capture::FILE_VERSION;
+    header.channels = channels;
+    qstrncpy(header.model, model.toUtf8().constData(), sizeof(header.model));
+    if (file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != (qint64)sizeof(header)) {
+        error = file.errorString();
+        file.close();
+        return false;
+    }
+
+    recorded.store(0);
+    dropped.store(0);
+    frameIndex = 0;
+    stopping = false;
+    this->compress = compress;
+    error.clear();
+    age.start();
+    writer.reset(new WriterThread([this]() { writeBlocks(); }));
+    writer->setObjectName("captureRecorderThread");
+    writer->start();
+    recording.store(true, std::memory_order_release);
+    return true;
+}
+
+void CaptureRecorder::stop() {
+    if (!writer) return;
+    {
+        QMutexLocker locker(&mutex);
+        recording.store(false, std::memory_order_release);
+        handOver();
+        stopping = true;
+        blockFilled.wakeAll();
+    }
+    writer->wait();
+    writer.reset();
+    file.close();
+
+    // Give the memory of the blocks back
+    std::vector<char>().swap(current);
+    spare.clear();
+    blocks = 0;
+    std::vector<Chunk>().swap(chunks);
+    std::vector<std::vector<char>>().swap(encoded);
+    std::vector<char>().swap(compressed);
+}
+
+void CaptureRecorder::record(const DSOsamples &frame, double triggerPoint, const ChannelInfo *channels) {
+    QMutexLocker locker(&mutex);
+    if (!isRecording()) return;
+    const quint64 index = frameIndex++;
+    if (!frame.compact) {
+        // Only raw codes are stored, the acquisition keeps the frames compact while recording
+        ++dropped;
+        return;
+    }
+
+    const unsigned channelCount = (unsigned)frame.compactData.size();
+    bool wide = false;
+    for (const DSOcompactChannel &channel : frame.compactData) wide = wide || (channel.wide && channel.size());
+    const size_t codeSize = wide ? sizeof(uint16_t) : sizeof(uint8_t);
+    size_t size = sizeof(Capture::FrameHeader) + channelCount * sizeof(Capture::ChannelHeader);
+    for (const DSOcompactChannel &channel : frame.compactData) size += Capture::padded(channel.size() * codeSize);
+
+    // Start a new block if the frame doesn't fit, drop the frame if all blocks are waiting for the disk
+    if (!current.empty() && current.size() + size > BLOCK_SIZE) handOver();
+    if (current.capacity() == 0) {
+        if (!spare.empty()) {
+            current.swap(spare.back());
+            spare.pop_back();
+        } else if (blocks < BLOCK_COUNT) {
+            current.reserve(std::max(BLOCK_SIZE, size));
+            ++blocks;
+        } else {
+            ++dropped;
+            return;
+        }
+    }
+
+    // The new bytes are zero, so the padding is already set
+    const size_t position = current.size();
+    current.resize(position + size);
+    char *target = current.data() + position;
+
+    Capture::FrameHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = Capture::FRAME_MAGIC;
+    header.flags = (frame.append ? Capture::FRAME_APPEND : 0) | (wide ? Capture::FRAME_WIDE : 0);
+    header.size = size;
+    header.index = index;
+    header.timestamp = frame.timestamp;
+    header.samplerate = frame.samplerate;
+    header.triggerPoint = triggerPoint;
+    header.channels = channelCount;
+    std::memcpy(target, &header, sizeof(header));
+    target += sizeof(header);
+
+    for (unsigned channel = 0; channel < channelCount; ++channel) {
+        const DSOcompactChannel &compactChannel = frame.compactData[channel];
+        Capture::ChannelHeader channelHeader;
+        channelHeader.count = compactChannel.size();
+        channelHeader.scale = compactChannel.scale;
+        channelHeader.shift = compactChannel.shift;
+        channelHeader.gain = channels[channel].gain;
+        channelHeader.offset = channels[channel].offset;
+        std::memcpy(target, &channelHeader, sizeof(channelHeader));
+        target += sizeof(channelHeader);
+    }
+    for (const DSOcompactChannel &compactChannel : frame.compactData) {
+        if (wide) {
+            // 8 bit codes of a wide frame are widened, so all channels of a frame have the same code size
+            uint16_t *codes = reinterpret_cast<uint16_t *>(target);
+            if (compactChannel.wide)
+                std::memcpy(codes, compactChannel.codes16.data(), compactChannel.size() * codeSize);
+            else
+                std::copy(compactChannel.codes8.begin(), compactChannel.codes8.end(), codes);
+        } else
+            std::memcpy(target, compactChannel.codes8.data(), compactChannel.size());
+        target += Capture::padded(compactChannel.size() * codeSize);
+    }
+    ++recorded;
+
+    if (current.size() >= BLOCK_SIZE || age.elapsed() >= FLUSH_INTERVAL) handOver();
+}
+
+QString CaptureRecorder::errorString() const {
+    QMutexLocker locker(&mutex);
+    return error;
+}
+
+/// \brief Queues the current block for the writer thread, the mutex has to be locked.
+void CaptureRecorder::handOver() {
+    age.restart();
+    if (current.empty()) return;
+    filled.push_back(std::move(current));
+    current = std::vector<char>();
+    blockFilled.wakeOne();
+}
+
+/// \brief Writes the filled blocks until the recorder is stopped, runs on the writer thread.
+void CaptureRecorder::writeBlocks() {
+    QMutexLocker locker(&mutex);
+    for (;;) {
+        while (filled.empty() && !stopping) blockFilled.wait(&mutex);
+        if (filled.empty()) return;
+
+        std::vector<char> block = std::move(filled.front());
+        filled.pop_front();
+        locker.unlock();
+        const std::vector<char> &output = compress ? compressBlock(block) : block;
+        const qint64 written = file.write(output.data(), (qint64)output.size());
+        locker.relock();
+
+        if (written != (qint64)output.size() && error.isEmpty()) {
+            // The disk is full or gone, the recording ends
+            error = file.errorString();
+            recording.store(false, std::memory_order_release);
+        }
+        block.clear();
+        spare.push_back(std::move(block));
+    }
+}
+
+/// \brief Stores the codes of all frames of a block as chunks, runs on the writer thread.
+/// The headers of the frames are kept, only their flags and sizes change.
+/// \param block The frames with the raw codes.
+/// \return The compressed frames, they stay valid until the next call.
+const std::vector<char> &CaptureRecorder::compressBlock(const std::vector<char> &block) {
+    // The headers are copied, the frames in the block don't have to be aligned
+    chunks.clear();
+    for (size_t position = 0; position < block.size();) {
+        Capture::FrameHeader header;
+        std::memcpy(&header, block.data() + position, sizeof(header));
+        const bool wide = header.flags & Capture::FRAME_WIDE;
+        const size_t codeSize = wide ? sizeof(uint16_t) : sizeof(uint8_t);
+        const char *channelHeaders = block.data() + position + sizeof(header);
+        const char *codes = channelHeaders + header.channels * sizeof(Capture::ChannelHeader);
+        for (unsigned channel = 0; channel < header.channels; ++channel) {
+            Capture::ChannelHeader channelHeader;
+            std::memcpy(&channelHeader, channelHeaders + channel * sizeof(channelHeader), sizeof(channelHeader));
+            chunks.push_back(Chunk{codes, (size_t)channelHeader.count, wide});
+            codes += Capture::padded(channelHeader.count * codeSize);
+        }
+        position += header.size;
+    }
+    if (encoded.size() < chunks.size()) encoded.resize(chunks.size());
+
+    // Every job encodes a range of the chunks into their own buffers
+    const auto encodeRange = [this](size_t first, size_t last) {
+        for (size_t index = first; index < last; ++index)
+            Capture::encodeChunk(chunks[index].codes, chunks[index].count, chunks[index].wide, encoded[index]);
+    };
+    const size_t jobs = std::min((size_t)std::max(compressors.maxThreadCount(), 1), chunks.size());
+    if (jobs < 2) {
+        encodeRange(0, chunks.size());
+    } else {
+        for (size_t job = 0; job < jobs; ++job) {
+            const size_t first = chunks.size() * job / jobs;
+            const size_t last = chunks.size() * (job + 1) / jobs;
+            compressors.start(new CompressJob([encodeRange, first, last]() { encodeRange(first, last); }));
+        }
+        compressors.waitForDone();
+    }
+
+    compressed.clear();
+    size_t chunk = 0;
+    for (size_t position = 0; position < block.size();) {
+        Capture::FrameHeader header;
+        std::memcpy(&header, block.data() + position, sizeof(header));
+        const size_t headers = sizeof(header) + header.channels * sizeof(Capture::ChannelHeader);
+        const size_t start = compressed.size();
+        compressed.insert(compressed.end(), block.begin() + position, block.begin() + position + headers);
+        for (unsigned channel = 0; channel < header.channels; ++channel, ++chunk)
+            compressed.insert(compressed.end(), encoded[chunk].begin(), encoded[chunk].end());
+        position += header.size;
+
+        header.flags |= Capture::FRAME_COMPRESSED;
+        header.size = compressed.size() - start;
+        std::memcpy(compressed.data() + start, &header, sizeof(header));
+    }
+    return compressed;
+}
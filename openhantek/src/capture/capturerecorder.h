@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "dsosamples.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class CaptureRecorder                                     capturerecorder.h
+/// \brief Streams every acquired frame to a capture file.
+/// The acquisition copies the raw codes of a frame into the current block, a
+/// full block is handed over to a writer thread, which writes it with one large
+/// sequential write. All blocks are reused, so the memory is bounded. If all
+/// blocks wait for the disk, the frames are dropped and counted instead of
+/// stalling the acquisition. The format is described in captureformat.h.
+/// If the frames are compressed, the writer thread encodes the channels of all
+/// frames in a block in parallel before the block is written, so the
+/// acquisition only copies the codes like before.
+class CaptureRecorder {
+  public:
+    /// \brief The settings of a channel that are stored with every frame.
+    struct ChannelInfo {
+        double gain = 0.0;   ///< The gain in V/div
+        double offset = 0.0; ///< The offset in divs
+    };
+
+    CaptureRecorder();
+    ~CaptureRecorder();
+
+    /// \brief Creates the capture file and starts the writer thread.
+    /// \param fileName The name of the file, it is overwritten.
+    /// \param model The name of the device model.
+    /// \param channels The number of channels of every frame.
+    /// \param compress true to store the codes with the lossless codec of capturecodec.h.
+    /// \return true on success, otherwise errorString() describes the problem.
+    bool start(const QString &fileName, const QString &model, unsigned channels, bool compress = false);
+
+    /// \brief Writes the pending frames and closes the file.
+    void stop();
+
+    /// \return true, if the frames are recorded.
+    bool isRecording() const { return recording.load(std::memory_order_acquire); }
+
+    /// \brief Queues a frame for the file, only the raw codes of compact frames are stored.
+    /// \param frame The frame, it is only read during the call.
+    /// \param triggerPoint The position of the trigger in samples, negative if there is none.
+    /// \param channels The settings of every channel of the frame.
+    void record(const DSOsamples &frame, double triggerPoint, const ChannelInfo *channels);
+
+    /// \return The description of the last error.
+    QString errorString() const;
+    /// \return The number of frames that were queued since the start.
+    quint64 framesRecorded() const { return recorded.load(std::memory_order_relaxed); }
+    /// \return The number of frames that were dropped since the start, because the disk was too slow.
+    quint64 framesDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+    static const size_t BLOCK_SIZE = 4 << 20; ///< The size of a write in bytes
+    static const unsigned BLOCK_COUNT = 16;   ///< The maximal number of blocks waiting for the disk
+    static const int FLUSH_INTERVAL = 500;    ///< The maximal age of a partly filled block in ms
+
+  private:
+    void handOver();
+    void writeBlocks();
+    const std::vector<char> &compressBlock(const std::vector<char> &block);
+
+    QFile file;
+    std::unique_ptr<QThread> writer;
+    std::atomic<bool> recording;
+    std::atomic<quint64> recorded;
+    std::atomic<quint64> dropped;
+    bool compress = false; ///< true, if the frames are compressed, only changed while the writer is stopped
+
+    // Only used by the writer thread
+    /// \brief The codes of a channel in a frame of the block that is compressed.
+    struct Chunk {
+        const char *codes; ///< The raw codes in the block
+        size_t count;      ///< The number of codes
+        bool wide;         ///< true for 16 bit codes
+    };
+    std::vector<Chunk> chunks;              ///< The channels of all frames of the block
+    std::vector<std::vector<char>> encoded; ///< The encoded chunks in the order of the channels
+    std::vector<char> compressed;           ///< The compressed block
+    QThreadPool compressors;                ///< Encodes the chunks in parallel
+
+    // Protected by mutex
+    mutable QMutex mutex;
+    QWaitCondition blockFilled;           ///< Wakes the writer thread
+    std::vector<char> current;            ///< The block that is filled by the acquisition
+    std::deque<std::vector<char>> filled; ///< The blocks waiting for the disk
+    std::vector<std::vector<char>> spare; ///< The written blocks, ready to be reused
+    unsigned blocks = 0;                  ///< The number of allocated blocks
+    QElapsedTimer age;                    ///< The time since the last block was handed over
+    quint64 frameIndex = 0;               ///< The index of the next frame
+    bool stopping = false;                ///< true, if the writer should finish
+    QString error;
+};
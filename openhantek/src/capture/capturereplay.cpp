@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include "capture/capturereplay.h"
+
+const int CaptureReplay::MAX_INTERVAL;
+
+CaptureReplay::CaptureReplay(QObject *parent) : QObject(parent), timer(new QTimer(this)) {
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, this, &CaptureReplay::next);
+}
+
+bool CaptureReplay::open(const QString &fileName) {
+    position = 0;
+    return file.open(fileName);
+}
+
+void CaptureReplay::play() {
+    if (playing || !file.frameCount()) return;
+    if (position >= file.frameCount()) position = 0;
+    playing = true;
+    sampleBuffer.setLossless(true);
+    emit playingChanged(true);
+    next();
+}
+
+void CaptureReplay::pause() {
+    if (!playing) return;
+    playing = false;
+    timer->stop();
+    sampleBuffer.setLossless(false);
+    emit playingChanged(false);
+}
+
+void CaptureReplay::seek(unsigned index) {
+    if (!file.frameCount()) return;
+    position = std::min(index, (unsigned)file.frameCount() - 1);
+    publish(position++);
+    if (playing) timer->start(interval(position - 1));
+}
+
+void CaptureReplay::setSpeed(double speed) { this->speed = speed; }
+
+/// \brief Publishes the frame at the position and schedules the next one.
+void CaptureReplay::next() {
+    if (!playing) return;
+    if (position >= file.frameCount()) {
+        pause();
+        return;
+    }
+    publish(position++);
+    timer->start(interval(position - 1));
+}
+
+void CaptureReplay::publish(unsigned index) {
+    file.readFrame(index, sampleBuffer.writeFrame());
+    if (!sampleBuffer.publish()) emit samplesAvailable();
+    emit positionChanged(index);
+}
+
+/// \brief Calculates the time between a frame and the following one.
+/// \param index The index of the published frame.
+/// \return The scaled interval in ms.
+int CaptureReplay::interval(unsigned index) const {
+    if (speed <= 0.0 || index + 1 >= file.frameCount()) return 0;
+
+    const Capture::FrameHeader *frame = file.frameHeader(index);
+    double seconds = (file.frameHeader(index + 1)->timestamp - frame->timestamp) / 1e9;
+    if (seconds <= 0.0 && frame->samplerate > 0.0 && frame->channels) {
+        // No usable timestamps, the frame lasts as long as its samples
+        seconds = file.channelHeader(index, 0)->count / frame->samplerate;
+    }
+    return (int)std::min(std::max(seconds * 1e3 / speed, 0.0), (double)MAX_INTERVAL);
+}
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+#include "capture/capturefile.h"
+#include "dsosamples.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class CaptureReplay                                         capturereplay.h
+/// \brief Plays a capture file back as the source of the analysis.
+/// It takes the place of the HantekDsoControl: the frames are published through
+/// a DSOsampleBuffer and announced with samplesAvailable(). The frames follow
+/// each other with the recorded intervals, divided by the speed. While playing
+/// the buffer is lossless, so every frame of the file is analyzed.
+class CaptureReplay : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit CaptureReplay(QObject *parent = nullptr);
+
+    /// \brief Opens a capture file, has to be called before the replay is moved to its thread.
+    /// \param fileName The name of the file.
+    /// \return true on success, otherwise getFile().errorString() describes the problem.
+    bool open(const QString &fileName);
+
+    /// \return The file that is played back, it doesn't change while playing.
+    const CaptureFile &getFile() const { return file; }
+
+    /// \return The buffer the frames are passed to the analysis with.
+    DSOsampleBuffer &getSampleBuffer() { return sampleBuffer; }
+
+    static const int MAX_INTERVAL = 1000; ///< The maximal time between two frames in ms
+
+  public slots:
+    /// \brief Plays the frames from the current position on.
+    void play();
+    /// \brief Stops after the current frame.
+    void pause();
+    /// \brief Publishes the frame at the index and continues there.
+    /// \param index The index of the frame, it is limited to the last frame.
+    void seek(unsigned index);
+    /// \brief Sets the speed of the replay.
+    /// \param speed The factor for the recorded speed, 0 for as fast as the analysis can keep up.
+    void setSpeed(double speed);
+
+  private:
+    void next();
+    void publish(unsigned index);
+    int interval(unsigned index) const;
+
+    CaptureFile file;
+    DSOsampleBuffer sampleBuffer;
+    QTimer *timer;
+    unsigned position = 0; ///< The next frame that is published
+    double speed = 1.0;
+    bool playing = false;
+
+  signals:
+    void samplesAvailable();              ///< A new frame is available in the sample buffer
+    void positionChanged(unsigned index); ///< The frame at the index was published
+    void playingChanged(bool playing);    ///< The replay was started or stopped
+};
@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "capture/framehistory.h"
+
+namespace {
+/// \brief Copies the codes and the conversion parameters of a channel, the buffers of the target are reused.
+void copyChannel(const DSOcompactChannel &source, DSOcompactChannel &target) {
+    target.wide = source.wide;
+    target.scale = source.scale;
+    target.shift = source.shift;
+    if (source.wide) {
+        target.codes16.assign(source.codes16.begin(), source.codes16.end());
+        target.codes8.clear();
+    } else {
+        target.codes8.assign(source.codes8.begin(), source.codes8.end());
+        target.codes16.clear();
+    }
+}
+}
+
+FrameHistory::FrameHistory() : enabled(false), frameCount(0) {}
+
+void FrameHistory::setCapacity(size_t bytes) {
+    QMutexLocker locker(&mutex);
+    capacity = bytes;
+    while (!frames.empty() && used > capacity) dropOldest();
+    if (capacity == 0) {
+        // Nothing will be kept, so the memory is given back
+        std::deque<Entry>().swap(frames);
+        spare = Entry();
+    }
+    enabled.store(capacity > 0, std::memory_order_relaxed);
+    frameCount.store((unsigned)frames.size(), std::memory_order_relaxed);
+}
+
+void FrameHistory::store(const DSOsamples &frame) {
+    if (!frame.compact || frame.append) return;
+
+    size_t size = 0;
+    for (const DSOcompactChannel &channel : frame.compactData)
+        size += channel.size() * (channel.wide ? sizeof(uint16_t) : sizeof(uint8_t));
+
+    QMutexLocker locker(&mutex);
+    if (size == 0 || size > capacity) return;
+    while (!frames.empty() && used + size > capacity) dropOldest();
+
+    Entry entry;
+    std::swap(entry, spare);
+    entry.channels.resize(frame.compactData.size());
+    for (size_t channel = 0; channel < frame.compactData.size(); ++channel)
+        copyChannel(frame.compactData[channel], entry.channels[channel]);
+    entry.samplerate = frame.samplerate;
+    entry.timestamp = frame.timestamp;
+    entry.frameId = frame.frameId;
+    entry.size = size;
+    used += size;
+    frames.push_back(std::move(entry));
+    frameCount.store((unsigned)frames.size(), std::memory_order_relaxed);
+}
+
+bool FrameHistory::load(unsigned index, DSOsamples &target) const {
+    QMutexLocker locker(&mutex);
+    if (index >= frames.size()) return false;
+
+    const Entry &entry = frames[index];
+    target.data.resize(entry.channels.size());
+    for (std::vector<double> &voltages : target.data) {
+        // The voltages of a frame that wasn't compact aren't needed anymore
+        if (target.compact)
+            voltages.clear();
+        else
+            std::vector<double>().swap(voltages);
+    }
+    target.compact = true;
+    target.append = false;
+    target.samplerate = entry.samplerate;
+    target.timestamp = entry.timestamp;
+    target.frameId = entry.frameId;
+    target.compactData.resize(entry.channels.size());
+    for (size_t channel = 0; channel < entry.channels.size(); ++channel)
+        copyChannel(entry.channels[channel], target.compactData[channel]);
+    return true;
+}
+
+void FrameHistory::clear() {
+    QMutexLocker locker(&mutex);
+    while (!frames.empty()) dropOldest();
+    frameCount.store(0, std::memory_order_relaxed);
+}
+
+/// \brief Drops the oldest frame, its buffers are kept for the next frame.
+void FrameHistory::dropOldest() {
+    used -= frames.front().size;
+    spare = std::move(frames.front());
+    frames.pop_front();
+}
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "dsosamples.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class FrameHistory                                           framehistory.h
+/// \brief Keeps the raw codes of the last acquired frames in memory.
+/// The frames are stored as compact frames with the conversion parameters of
+/// every channel, so they can be converted and analyzed again after the
+/// acquisition stopped, even if the gain or the samplerate changed since. The
+/// oldest frames are dropped when the codes exceed the memory limit. The buffers
+/// of the dropped frames are reused, a full history doesn't allocate anymore.
+/// Roll mode frames only continue the previous frame, they aren't kept.
+class FrameHistory {
+  public:
+    FrameHistory();
+
+    /// \brief Sets the memory for the codes, the oldest frames are dropped if they don't fit anymore.
+    /// Can be called from any thread.
+    /// \param bytes The memory in bytes, 0 disables the history and frees it.
+    void setCapacity(size_t bytes);
+
+    /// \return true, if the frames are kept, they have to be compact then.
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    /// \brief Keeps a copy of a compact frame, other frames are ignored.
+    /// \param frame The frame, it is only read during the call.
+    void store(const DSOsamples &frame);
+
+    /// \brief Copies a kept frame into a frame for the analysis.
+    /// The buffers of the target are reused.
+    /// \param index The index of the frame, 0 is the oldest frame.
+    /// \param target The frame that is filled.
+    /// \return false, if there is no frame with the index.
+    bool load(unsigned index, DSOsamples &target) const;
+
+    /// \brief Drops all frames but keeps the memory limit.
+    void clear();
+
+    /// \return The number of kept frames, can be called from any thread.
+    unsigned count() const { return frameCount.load(std::memory_order_relaxed); }
+
+  private:
+    /// \brief A kept frame.
+    struct Entry {
+        std::vector<DSOcompactChannel> channels;
+        double samplerate = 0.0;
+        qint64 timestamp = 0;
+        quint64 frameId = 0;
+        size_t size = 0; ///< The size of the codes in bytes
+    };
+
+    void dropOldest();
+
+    mutable QMutex mutex;
+    std::deque<Entry> frames; ///< The kept frames from the oldest to the newest
+    Entry spare;              ///< The buffers of the last dropped frame
+    size_t capacity = 0;      ///< The memory limit for the codes in bytes
+    size_t used = 0;          ///< The size of the codes of all kept frames in bytes
+    std::atomic<bool> enabled;
+    std::atomic<unsigned> frameCount;
+};
@@ -1,6 +1,10 @@
 // SPDX-License-Identifier: GPL-2.0+
 
 #include "DsoConfigAnalysisPage.h"
+#include "channelfilter.h"
+#include "mathengine.h"
+#include "utils/dsoStrings.h"
+#include "windowcache.h"
 
 DsoConfigAnalysisPage::DsoConfigAnalysisPage(DsoSettings *settings, QWidget *parent)
     : QWidget(parent), settings(settings) {
@@ -39,6 +43,51 @@ DsoConfigAnalysisPage::DsoConfigAnalysisPage(DsoSettings *settings, QWidget *par
     minimumMagnitudeLayout->addWidget(minimumMagnitudeSpinBox);
     minimumMagnitudeLayout->addWidget(minimumMagnitudeUnitLabel);
 
+    QStringList averagingStrings;
+    averagingStrings << tr("Off") << tr("Linear") << tr("Exponential") << tr("RMS") << tr("Max hold")
+                     << tr("Min hold");
+
+    averagingLabel = new QLabel(tr("Averaging"));
+    averagingComboBox = new QComboBox();
+    averagingComboBox->addItems(averagingStrings);
+    averagingComboBox->setCurrentIndex(settings->scope.spectrumAveraging);
+
+    averagesLabel = new QLabel(tr("Averaged frames"));
+    averagesSpinBox = new QSpinBox();
+    averagesSpinBox->setMinimum(2);
+    averagesSpinBox->setMaximum(1024);
+    averagesSpinBox->setValue(settings->scope.spectrumAverages);
+    averagesSpinBox->setToolTip(tr("The linear, exponential and RMS averages give every new frame this share, "
+                                   "the holds keep the extremes until they are reset"));
+
+    spectrogramCheckBox = new QCheckBox(tr("Spectrogram"));
+    spectrogramCheckBox->setToolTip(tr("Shows the spectra of short segments of the records as scrolling waterfall "
+                                       "instead of the spectrum graphs"));
+    spectrogramCheckBox->setChecked(settings->scope.spectrogram);
+
+    spectrogramSegmentLabel = new QLabel(tr("Spectrogram segment"));
+    spectrogramSegmentComboBox = new QComboBox();
+    for (unsigned int segment = 256; segment <= 16384; segment *= 2) {
+        spectrogramSegmentComboBox->addItem(tr("%1 samples").arg(segment), segment);
+        if (segment <= settings->scope.spectrogramSegment)
+            spectrogramSegmentComboBox->setCurrentIndex(spectrogramSegmentComboBox->count() - 1);
+    }
+
+    patientPlanningCheckBox = new QCheckBox(tr("Search for the fastest FFT algorithm thoroughly"));
+    patientPlanningCheckBox->setToolTip(tr("Planning takes much longer when the record length changes, "
+                                           "the result is stored and reused on the next start"));
+    patientPlanningCheckBox->setChecked(settings->scope.spectrumPatientPlanning);
+
+    singlePrecisionCheckBox = new QCheckBox(tr("Calculate the spectrum with single precision"));
+    singlePrecisionCheckBox->setToolTip(tr("Faster on slow computers, the precision is still far beyond the "
+                                           "resolution of the oscilloscope"));
+    singlePrecisionCheckBox->setChecked(settings->scope.spectrumSinglePrecision);
+
+    gpuCheckBox = new QCheckBox(tr("Calculate the spectrum on the graphics card"));
+    gpuCheckBox->setToolTip(tr("Needs OpenGL 4.3, only used for the whole record without averaging, zoom or "
+                               "spectrogram. The spectrum is not exported then"));
+    gpuCheckBox->setChecked(settings->scope.spectrumGpu);
+
     spectrumLayout = new QGridLayout();
     spectrumLayout->addWidget(windowFunctionLabel, 0, 0);
     spectrumLayout->addWidget(windowFunctionComboBox, 0, 1);
@@ -46,12 +95,145 @@ DsoConfigAnalysisPage::DsoConfigAnalysisPage(DsoSettings *settings, QWidget *par
     spectrumLayout->addLayout(referenceLevelLayout, 1, 1);
     spectrumLayout->addWidget(minimumMagnitudeLabel, 2, 0);
     spectrumLayout->addLayout(minimumMagnitudeLayout, 2, 1);
+    spectrumLayout->addWidget(averagingLabel, 3, 0);
+    spectrumLayout->addWidget(averagingComboBox, 3, 1);
+    spectrumLayout->addWidget(averagesLabel, 4, 0);
+    spectrumLayout->addWidget(averagesSpinBox, 4, 1);
+    spectrumLayout->addWidget(spectrogramCheckBox, 5, 0, 1, 2);
+    spectrumLayout->addWidget(spectrogramSegmentLabel, 6, 0);
+    spectrumLayout->addWidget(spectrogramSegmentComboBox, 6, 1);
+    spectrumLayout->addWidget(patientPlanningCheckBox, 7, 0, 1, 2);
+    spectrumLayout->addWidget(singlePrecisionCheckBox, 8, 0, 1, 2);
+    spectrumLayout->addWidget(gpuCheckBox, 9, 0, 1, 2);
 
     spectrumGroup = new QGroupBox(tr("Spectrum"));
     spectrumGroup->setLayout(spectrumLayout);
 
+    QStringList frequencyEstimatorStrings;
+    frequencyEstimatorStrings << tr("Autocorrelation") << tr("Zero crossings") << tr("Spectral peak");
+
+    frequencyEstimatorLabel = new QLabel(tr("Frequency estimation"));
+    frequencyEstimatorComboBox = new QComboBox();
+    frequencyEstimatorComboBox->addItems(frequencyEstimatorStrings);
+    frequencyEstimatorComboBox->setCurrentIndex(settings->scope.frequencyEstimator);
+
+    frequencyLayout = new QGridLayout();
+    frequencyLayout->addWidget(frequencyEstimatorLabel, 0, 0);
+    frequencyLayout->addWidget(frequencyEstimatorComboBox, 0, 1);
+
+    frequencyGroup = new QGroupBox(tr("Frequency"));
+    frequencyGroup->setLayout(frequencyLayout);
+
+    measurementLayout = new QGridLayout();
+    for (int measurement = 0; measurement < Dso::MEASUREMENT_COUNT; ++measurement) {
+        measurementCheckBox[measurement] = new QCheckBox(Dso::measurementString((Dso::Measurement)measurement));
+        measurementCheckBox[measurement]->setChecked((settings->scope.measurements >> measurement) & 1u);
+        measurementLayout->addWidget(measurementCheckBox[measurement], measurement / 5, measurement % 5);
+    }
+
+    analysisRegionCheckBox = new QCheckBox(tr("Analyze only the samples between the markers"));
+    analysisRegionCheckBox->setToolTip(tr("The amplitude, frequency and measurements only use the selected part "
+                                          "of the record, in roll mode the whole record is analyzed"));
+    analysisRegionCheckBox->setChecked(settings->scope.analysisRegion);
+    spectrumRegionCheckBox = new QCheckBox(tr("Calculate the spectrum between the markers as well"));
+    spectrumRegionCheckBox->setToolTip(tr("The spectrum gets wider bins, the spectral frequency estimators follow it"));
+    spectrumRegionCheckBox->setChecked(settings->scope.spectrumRegion);
+    spectrumRegionCheckBox->setEnabled(settings->scope.analysisRegion);
+    connect(analysisRegionCheckBox, SIGNAL(toggled(bool)), spectrumRegionCheckBox, SLOT(setEnabled(bool)));
+    const int regionRow = (Dso::MEASUREMENT_COUNT + 4) / 5;
+    measurementLayout->addWidget(analysisRegionCheckBox, regionRow, 0, 1, 5);
+    measurementLayout->addWidget(spectrumRegionCheckBox, regionRow + 1, 0, 1, 5);
+
+    measurementGroup = new QGroupBox(tr("Measurements"));
+    measurementGroup->setLayout(measurementLayout);
+
+    QStringList filterTypeStrings;
+    filterTypeStrings << tr("Off") << tr("Low-pass") << tr("High-pass") << tr("Band-pass");
+    QStringList filterDesignStrings;
+    filterDesignStrings << tr("FIR") << tr("IIR");
+
+    filterLayout = new QGridLayout();
+    filterLayout->addWidget(new QLabel(tr("Filter")), 0, 1);
+    filterLayout->addWidget(new QLabel(tr("Design")), 0, 2);
+    filterLayout->addWidget(new QLabel(tr("Lower cutoff")), 0, 3);
+    filterLayout->addWidget(new QLabel(tr("Upper cutoff")), 0, 4);
+    filterLayout->addWidget(new QLabel(tr("Taps")), 0, 5);
+    filterLayout->addWidget(new QLabel(tr("Order")), 0, 6);
+    for (unsigned int channel = 0; channel < settings->scope.physicalChannels; ++channel) {
+        const DsoSettingsScopeFilter &filter = settings->scope.voltage[channel].filter;
+        filterTypeComboBox.append(new QComboBox());
+        filterTypeComboBox[channel]->addItems(filterTypeStrings);
+        filterTypeComboBox[channel]->setCurrentIndex(filter.type);
+        filterDesignComboBox.append(new QComboBox());
+        filterDesignComboBox[channel]->addItems(filterDesignStrings);
+        filterDesignComboBox[channel]->setCurrentIndex(filter.design);
+        filterDesignComboBox[channel]->setToolTip(tr("The FIR filter has a linear phase, the IIR filter is a "
+                                                     "Butterworth filter that settles faster"));
+        filterLowSiSpinBox.append(new SiSpinBox(UNIT_HERTZ));
+        filterLowSiSpinBox[channel]->setMinimum(1.0);
+        filterLowSiSpinBox[channel]->setMaximum(100e6);
+        filterLowSiSpinBox[channel]->setValue(filter.low);
+        filterHighSiSpinBox.append(new SiSpinBox(UNIT_HERTZ));
+        filterHighSiSpinBox[channel]->setMinimum(1.0);
+        filterHighSiSpinBox[channel]->setMaximum(100e6);
+        filterHighSiSpinBox[channel]->setValue(filter.high);
+        filterTapsSpinBox.append(new QSpinBox());
+        filterTapsSpinBox[channel]->setMinimum(3);
+        filterTapsSpinBox[channel]->setMaximum(ChannelFilter::MAX_TAPS);
+        filterTapsSpinBox[channel]->setSingleStep(2);
+        filterTapsSpinBox[channel]->setValue(filter.taps);
+        filterOrderSpinBox.append(new QSpinBox());
+        filterOrderSpinBox[channel]->setMinimum(2);
+        filterOrderSpinBox[channel]->setMaximum(ChannelFilter::MAX_ORDER);
+        filterOrderSpinBox[channel]->setSingleStep(2);
+        filterOrderSpinBox[channel]->setValue(filter.order);
+
+        const int row = channel + 1;
+        filterLayout->addWidget(new QLabel(settings->scope.voltage[channel].name), row, 0);
+        filterLayout->addWidget(filterTypeComboBox[channel], row, 1);
+        filterLayout->addWidget(filterDesignComboBox[channel], row, 2);
+        filterLayout->addWidget(filterLowSiSpinBox[channel], row, 3);
+        filterLayout->addWidget(filterHighSiSpinBox[channel], row, 4);
+        filterLayout->addWidget(filterTapsSpinBox[channel], row, 5);
+        filterLayout->addWidget(filterOrderSpinBox[channel], row, 6);
+    }
+
+    filterGroup = new QGroupBox(tr("Channel filters"));
+    filterGroup->setToolTip(tr("The filtered samples are shown, triggered, measured and exported"));
+    filterGroup->setLayout(filterLayout);
+
+    mathLayout = new QGridLayout();
+    const char *factorNames[2] = {"a", "b"};
+    for (int factor = 0; factor < 2; ++factor) {
+        mathFactorLabel[factor] = new QLabel(tr("Factor %1 of a * CH1 + b * CH2").arg(factorNames[factor]));
+        mathFactorSpinBox[factor] = new QDoubleSpinBox();
+        mathFactorSpinBox[factor]->setDecimals(3);
+        mathFactorSpinBox[factor]->setMinimum(-1000.0);
+        mathFactorSpinBox[factor]->setMaximum(1000.0);
+        mathFactorSpinBox[factor]->setValue(settings->scope.mathFactors[factor]);
+        mathLayout->addWidget(mathFactorLabel[factor], factor, 0);
+        mathLayout->addWidget(mathFactorSpinBox[factor], factor, 1);
+    }
+
+    mathExpressionLabel = new QLabel(tr("Formula"));
+    mathExpressionLineEdit = new QLineEdit(settings->scope.mathExpression);
+    mathExpressionLineEdit->setToolTip(tr("Uses ch1, ch2, numbers, + - * / and abs(), sqrt(), min(,), max(,)"));
+    mathExpressionStatusLabel = new QLabel();
+    checkMathExpression(settings->scope.mathExpression);
+    connect(mathExpressionLineEdit, SIGNAL(textChanged(QString)), this, SLOT(checkMathExpression(QString)));
+    mathLayout->addWidget(mathExpressionLabel, 2, 0);
+    mathLayout->addWidget(mathExpressionLineEdit, 2, 1);
+    mathLayout->addWidget(mathExpressionStatusLabel, 3, 0, 1, 2);
+
+    mathGroup = new QGroupBox(tr("Math channel"));
+    mathGroup->setLayout(mathLayout);
+
     mainLayout = new QVBoxLayout();
     mainLayout->addWidget(spectrumGroup);
+    mainLayout->addWidget(frequencyGroup);
+    mainLayout->addWidget(measurementGroup);
+    mainLayout->addWidget(filterGroup);
+    mainLayout->addWidget(mathGroup);
     mainLayout->addStretch(1);
 
     setLayout(mainLayout);
@@ -59,7 +241,43 @@ DsoConfigAnalysisPage::DsoConfigAnalysisPage(DsoSettings *settings, QWidget *par
 
 /// \brief Saves the new settings.
 void DsoConfigAnalysisPage::saveSettings() {
-    settings->scope.spectrumWindow = (Dso::WindowFunction)windowFunctionComboBox->currentIndex();
+    Dso::WindowFunction window = (Dso::WindowFunction)windowFunctionComboBox->currentIndex();
+    if (window != settings->scope.spectrumWindow) WindowCache::instance().prepare(window);
+    settings->scope.spectrumWindow = window;
     settings->scope.spectrumReference = referenceLevelSpinBox->value();
     settings->scope.spectrumLimit = minimumMagnitudeSpinBox->value();
+    settings->scope.spectrumAveraging = (Dso::SpectrumAveraging)averagingComboBox->currentIndex();
+    settings->scope.spectrumAverages = averagesSpinBox->value();
+    settings->scope.spectrogram = spectrogramCheckBox->isChecked();
+    settings->scope.spectrogramSegment = spectrogramSegmentComboBox->currentData().toUInt();
+    settings->scope.spectrumPatientPlanning = patientPlanningCheckBox->isChecked();
+    settings->scope.spectrumSinglePrecision = singlePrecisionCheckBox->isChecked();
+    settings->scope.spectrumGpu = gpuCheckBox->isChecked();
+    settings->scope.frequencyEstimator = (Dso::FrequencyEstimator)frequencyEstimatorComboBox->currentIndex();
+    settings->scope.measurements = 0;
+    for (int measurement = 0; measurement < Dso::MEASUREMENT_COUNT; ++measurement)
+        if (measurementCheckBox[measurement]->isChecked()) settings->scope.measurements |= 1u << measurement;
+    settings->scope.analysisRegion = analysisRegionCheckBox->isChecked();
+    settings->scope.spectrumRegion = spectrumRegionCheckBox->isChecked();
+    for (int channel = 0; channel < filterTypeComboBox.count(); ++channel) {
+        DsoSettingsScopeFilter &filter = settings->scope.voltage[channel].filter;
+        filter.type = (Dso::FilterType)filterTypeComboBox[channel]->currentIndex();
+        filter.design = (Dso::FilterDesign)filterDesignComboBox[channel]->currentIndex();
+        filter.low = filterLowSiSpinBox[channel]->value();
+        filter.high = filterHighSiSpinBox[channel]->value();
+        filter.taps = filterTapsSpinBox[channel]->value();
+        filter.order = filterOrderSpinBox[channel]->value();
+    }
+    for (int factor = 0; factor < 2; ++factor) settings->scope.mathFactors[factor] = mathFactorSpinBox[factor]->value();
+    settings->scope.mathExpression = mathExpressionLineEdit->text();
+}
+
+/// \brief Shows if the formula of the math channel is valid.
+/// \param text The formula.
+void DsoConfigAnalysisPage::checkMathExpression(const QString &text) {
+    MathExpression expression;
+    if (expression.compile(text))
+        mathExpressionStatusLabel->clear();
+    else
+        mathExpressionStatusLabel->setText(expression.errorString());
 }
@@ -1,9 +1,11 @@
 // SPDX-License-Identifier: GPL-2.0+
 
+#include <QList>
 #include <QWidget>
 
 #include "definitions.h"
 #include "settings.h"
+#include "sispinbox.h"
 
 #include <QCheckBox>
 #include <QComboBox>
@@ -12,6 +14,7 @@
 #include <QGroupBox>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QLineEdit>
 #include <QSpinBox>
 #include <QVBoxLayout>
 
@@ -27,6 +30,9 @@ class DsoConfigAnalysisPage : public QWidget {
   public slots:
     void saveSettings();
 
+  private slots:
+    void checkMathExpression(const QString &text);
+
   private:
     DsoSettings *settings;
 
@@ -46,4 +52,45 @@ class DsoConfigAnalysisPage : public QWidget {
     QDoubleSpinBox *minimumMagnitudeSpinBox;
     QLabel *minimumMagnitudeUnitLabel;
     QHBoxLayout *minimumMagnitudeLayout;
+
+    QLabel *averagingLabel;
+    QComboBox *averagingComboBox;
+    QLabel *averagesLabel;
+    QSpinBox *averagesSpinBox;
+
+    QCheckBox *spectrogramCheckBox;
+    QLabel *spectrogramSegmentLabel;
+    QComboBox *spectrogramSegmentComboBox;
+
+    QCheckBox *patientPlanningCheckBox;
+    QCheckBox *singlePrecisionCheckBox;
+    QCheckBox *gpuCheckBox;
+
+    QGroupBox *frequencyGroup;
+    QGridLayout *frequencyLayout;
+    QLabel *frequencyEstimatorLabel;
+    QComboBox *frequencyEstimatorComboBox;
+
+    QGroupBox *measurementGroup;
+    QGridLayout *measurementLayout;
+    QCheckBox *measurementCheckBox[Dso::MEASUREMENT_COUNT];
+    QCheckBox *analysisRegionCheckBox;
+    QCheckBox *spectrumRegionCheckBox;
+
+    QGroupBox *filterGroup;
+    QGridLayout *filterLayout;
+    QList<QComboBox *> filterTypeComboBox;   ///< The passed band of every real channel
+    QList<QComboBox *> filterDesignComboBox; ///< FIR or IIR filter of every real channel
+    QList<SiSpinBox *> filterLowSiSpinBox;   ///< The lower cutoff of every real channel
+    QList<SiSpinBox *> filterHighSiSpinBox;  ///< The upper cutoff of every real channel
+    QList<QSpinBox *> filterTapsSpinBox;     ///< The FIR length of every real channel
+    QList<QSpinBox *> filterOrderSpinBox;    ///< The IIR order of every real channel
+
+    QGroupBox *mathGroup;
+    QGridLayout *mathLayout;
+    QLabel *mathFactorLabel[2];
+    QDoubleSpinBox *mathFactorSpinBox[2];
+    QLabel *mathExpressionLabel;
+    QLineEdit *mathExpressionLineEdit;
+    QLabel *mathExpressionStatusLabel;
 };
@@ -17,8 +17,30 @@ DsoConfigScopePage::DsoConfigScopePage(DsoSettings *settings, QWidget *parent) :
     digitalPhosphorDepthLabel = new QLabel(tr("Digital phosphor depth"));
     digitalPhosphorDepthSpinBox = new QSpinBox();
     digitalPhosphorDepthSpinBox->setMinimum(2);
-    digitalPhosphorDepthSpinBox->setMaximum(99);
+    phosphorAccumulationCheckBox = new QCheckBox(tr("Intensity graded phosphor"));
+    phosphorAccumulationCheckBox->setToolTip(tr("Accumulates the graphs in one image that fades out, "
+                                                "the depth sets the number of frames until it has faded"));
+    phosphorAccumulationCheckBox->setChecked(settings->view.phosphorAccumulation);
+    updatePhosphorDepthRange(settings->view.phosphorAccumulation);
     digitalPhosphorDepthSpinBox->setValue(settings->view.digitalPhosphorDepth);
+    persistenceMapCheckBox = new QCheckBox(tr("Persistence map"));
+    persistenceMapCheckBox->setToolTip(tr("Shows how often every point was hit by the voltage graphs, "
+                                          "the map starts again when the scaling changes"));
+    persistenceMapCheckBox->setChecked(settings->view.persistenceMap);
+    xyDensityCheckBox = new QCheckBox(tr("XY density map"));
+    xyDensityCheckBox->setToolTip(tr("Shows how often every point was hit by the XY graphs, "
+                                     "with digital phosphor the previous frames fade out over the depth"));
+    xyDensityCheckBox->setChecked(settings->view.xyDensity);
+    maximumFrameRateSpinBox = new QSpinBox();
+    maximumFrameRateSpinBox->setRange(0, 240);
+    maximumFrameRateSpinBox->setPrefix(tr("Draw at most "));
+    maximumFrameRateSpinBox->setSuffix(tr(" frames per second"));
+    maximumFrameRateSpinBox->setSpecialValueText(tr("Draw at the refresh rate of the display"));
+    maximumFrameRateSpinBox->setToolTip(tr("The acquisition isn't slowed down, the newest frame is drawn"));
+    maximumFrameRateSpinBox->setValue(settings->view.maximumFrameRate);
+    powerSavingCheckBox = new QCheckBox(tr("Draw slowly while the window is in the background"));
+    powerSavingCheckBox->setChecked(settings->view.powerSaving);
+    connect(phosphorAccumulationCheckBox, &QCheckBox::toggled, this, &DsoConfigScopePage::updatePhosphorDepthRange);
 
     graphLayout = new QGridLayout();
     graphLayout->addWidget(antialiasingCheckBox, 0, 0, 1, 2);
@@ -26,12 +48,47 @@ DsoConfigScopePage::DsoConfigScopePage(DsoSettings *settings, QWidget *parent) :
     graphLayout->addWidget(interpolationComboBox, 1, 1);
     graphLayout->addWidget(digitalPhosphorDepthLabel, 2, 0);
     graphLayout->addWidget(digitalPhosphorDepthSpinBox, 2, 1);
+    graphLayout->addWidget(phosphorAccumulationCheckBox, 3, 0, 1, 2);
+    graphLayout->addWidget(persistenceMapCheckBox, 4, 0, 1, 2);
+    graphLayout->addWidget(xyDensityCheckBox, 5, 0, 1, 2);
+    graphLayout->addWidget(maximumFrameRateSpinBox, 6, 0, 1, 2);
+    graphLayout->addWidget(powerSavingCheckBox, 7, 0, 1, 2);
 
     graphGroup = new QGroupBox(tr("Graph"));
     graphGroup->setLayout(graphLayout);
 
+    compactSamplesCheckBox = new QCheckBox(tr("Store samples compactly (saves memory for long records)"));
+    compactSamplesCheckBox->setChecked(settings->scope.compactSamples);
+    losslessCaptureCheckBox = new QCheckBox(tr("Analyze every frame (the acquisition waits for the analysis)"));
+    losslessCaptureCheckBox->setToolTip(tr("Otherwise frames are skipped if the analysis is too slow, "
+                                           "so the display always shows the latest frame"));
+    losslessCaptureCheckBox->setChecked(settings->scope.losslessCapture);
+    historyMemorySpinBox = new QSpinBox();
+    historyMemorySpinBox->setRange(0, 4096);
+    historyMemorySpinBox->setSingleStep(16);
+    historyMemorySpinBox->setPrefix(tr("Keep the last frames in "));
+    historyMemorySpinBox->setSuffix(tr(" MiB"));
+    historyMemorySpinBox->setSpecialValueText(tr("Don't keep the last frames"));
+    historyMemorySpinBox->setToolTip(tr("The frames can be browsed after stopping the oscilloscope, "
+                                        "they are stored compactly while the history is used"));
+    historyMemorySpinBox->setValue((int)settings->scope.historyMemory);
+    compressCapturesCheckBox = new QCheckBox(tr("Compress recorded captures (lossless)"));
+    compressCapturesCheckBox->setToolTip(tr("The codes are packed by the writer thread, "
+                                            "older versions of OpenHantek can't replay the captures"));
+    compressCapturesCheckBox->setChecked(settings->scope.compressCaptures);
+
+    acquisitionLayout = new QVBoxLayout();
+    acquisitionLayout->addWidget(compactSamplesCheckBox);
+    acquisitionLayout->addWidget(losslessCaptureCheckBox);
+    acquisitionLayout->addWidget(historyMemorySpinBox);
+    acquisitionLayout->addWidget(compressCapturesCheckBox);
+
+    acquisitionGroup = new QGroupBox(tr("Acquisition"));
+    acquisitionGroup->setLayout(acquisitionLayout);
+
     mainLayout = new QVBoxLayout();
     mainLayout->addWidget(graphGroup);
+    mainLayout->addWidget(acquisitionGroup);
     mainLayout->addStretch(1);
 
     setLayout(mainLayout);
@@ -42,4 +99,19 @@ void DsoConfigScopePage::saveSettings() {
     settings->view.antialiasing = antialiasingCheckBox->isChecked();
     settings->view.interpolation = (Dso::InterpolationMode)interpolationComboBox->currentIndex();
     settings->view.digitalPhosphorDepth = digitalPhosphorDepthSpinBox->value();
+    settings->view.phosphorAccumulation = phosphorAccumulationCheckBox->isChecked();
+    settings->view.persistenceMap = persistenceMapCheckBox->isChecked();
+    settings->view.xyDensity = xyDensityCheckBox->isChecked();
+    settings->view.maximumFrameRate = maximumFrameRateSpinBox->value();
+    settings->view.powerSaving = powerSavingCheckBox->isChecked();
+    settings->scope.compactSamples = compactSamplesCheckBox->isChecked();
+    settings->scope.losslessCapture = losslessCaptureCheckBox->isChecked();
+    settings->scope.historyMemory = (unsigned)historyMemorySpinBox->value();
+    settings->scope.compressCaptures = compressCapturesCheckBox->isChecked();
+}
+
+/// \brief The accumulated phosphor costs the same for every depth, so it allows much deeper ones.
+/// \param accumulation true, if the intensity graded phosphor is selected.
+void DsoConfigScopePage::updatePhosphorDepthRange(bool accumulation) {
+    digitalPhosphorDepthSpinBox->setMaximum(accumulation ? 1000 : DsoSettingsView::PHOSPHOR_LAYERS_MAX);
 }
@@ -27,6 +27,9 @@ class DsoConfigScopePage : public QWidget {
   public slots:
     void saveSettings();
 
+  private slots:
+    void updatePhosphorDepthRange(bool accumulation);
+
   private:
     DsoSettings *settings;
 
@@ -37,6 +40,18 @@ class DsoConfigScopePage : public QWidget {
     QCheckBox *antialiasingCheckBox;
     QLabel *digitalPhosphorDepthLabel;
     QSpinBox *digitalPhosphorDepthSpinBox;
+    QCheckBox *phosphorAccumulationCheckBox;
+    QCheckBox *persistenceMapCheckBox;
+    QCheckBox *xyDensityCheckBox;
     QLabel *interpolationLabel;
     QComboBox *interpolationComboBox;
+    QSpinBox *maximumFrameRateSpinBox;
+    QCheckBox *powerSavingCheckBox;
+
+    QGroupBox *acquisitionGroup;
+    QVBoxLayout *acquisitionLayout;
+    QCheckBox *compactSamplesCheckBox;
+    QCheckBox *losslessCaptureCheckBox;
+    QSpinBox *historyMemorySpinBox;
+    QCheckBox *compressCapturesCheckBox;
 };
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cmath>
+
+#include "densitymap.h"
+
+#include "analysiskernels.h"
+#include "dataanalyzerresult.h"
+#include "viewconstants.h"
+
+const unsigned int DensityMap::WIDTH;
+const unsigned int DensityMap::HEIGHT;
+const unsigned int DensityMap::BLOCK;
+
+namespace {
+/// Faded hits below this are removed, so old frames disappear completely
+const float MINIMUM_HITS = 0.01f;
+}
+
+DensityMap::DensityMap() : bins(WIDTH * HEIGHT, 0.0f) {
+    for (int axis = 0; axis < 2; ++axis) {
+        values[axis].resize(BLOCK);
+        positions[axis].resize(BLOCK);
+    }
+}
+
+void DensityMap::clear() {
+    std::fill(bins.begin(), bins.end(), 0.0f);
+    peak = 0.0f;
+}
+
+void DensityMap::add(const SampleValues &x, const SampleValues &y, size_t count, double xScale, double xOffset,
+                     double yScale, double yOffset, double decay) {
+    if (xScale != lastXScale || xOffset != lastXOffset || yScale != lastYScale || yOffset != lastYOffset) {
+        clear();
+        lastXScale = xScale;
+        lastXOffset = xOffset;
+        lastYScale = yScale;
+        lastYOffset = yOffset;
+    }
+
+    // The untouched bins keep their order, so the faded peak is still the maximum of them
+    if (decay > 0.0) {
+        const float factor = (float)decay;
+        for (float &bin : bins) {
+            bin *= factor;
+            if (bin < MINIMUM_HITS) bin = 0.0f;
+        }
+        peak *= factor;
+    } else
+        clear();
+
+    const float columnFactor = (float)(xScale * WIDTH / DIVS_TIME);
+    const float columnOffset = (float)((xOffset + DIVS_TIME / 2) * WIDTH / DIVS_TIME);
+    const float rowFactor = (float)(yScale * HEIGHT / DIVS_VOLTAGE);
+    const float rowOffset = (float)((yOffset + DIVS_VOLTAGE / 2) * HEIGHT / DIVS_VOLTAGE);
+    for (size_t first = 0; first < count; first += BLOCK) {
+        const unsigned int block = (unsigned)std::min((size_t)BLOCK, count - first);
+        for (unsigned int pair = 0; pair < block; ++pair) {
+            values[0][pair] = (float)x.at(first + pair);
+            values[1][pair] = (float)y.at(first + pair);
+        }
+        Analysis::quantize(values[0].data(), columnFactor, columnOffset, (int)WIDTH, positions[0].data(), block);
+        Analysis::quantize(values[1].data(), rowFactor, rowOffset, (int)HEIGHT, positions[1].data(), block);
+
+        // The pairs beyond the screen are limited to -1 and the size, they are skipped
+        for (unsigned int pair = 0; pair < block; ++pair) {
+            const int column = positions[0][pair];
+            const int row = positions[1][pair];
+            if (column < 0 || column >= (int)WIDTH || row < 0 || row >= (int)HEIGHT) continue;
+            float &bin = bins[(size_t)row * WIDTH + (size_t)column];
+            bin += 1.0f;
+            peak = std::max(peak, bin);
+        }
+    }
+}
+
+void DensityMap::colorize(std::vector<quint8> &image) const {
+    const std::vector<quint8> &colormap = PersistenceMap::colormap();
+    const double scale = 255.0 / std::log(1.0 + std::max(peak, 1.0f));
+    image.resize(bins.size() * 4);
+    for (size_t bin = 0; bin < bins.size(); ++bin) {
+        quint8 *pixel = &image[bin * 4];
+        if (bins[bin] == 0.0f) {
+            pixel[3] = 0;
+            continue;
+        }
+        const int level = std::min((int)(std::log(1.0 + bins[bin]) * scale), 255);
+        std::copy(&colormap[level * 4], &colormap[level * 4] + 4, pixel);
+    }
+}
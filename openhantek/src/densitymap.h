@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QtGlobal>
+#include <cstddef>
+#include <vector>
+
+#include "persistencemap.h"
+
+struct SampleValues;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class DensityMap                                               densitymap.h
+/// \brief Counts how often the sample pairs of XY graphs hit every point of the screen.
+/// The pairs are binned into a fixed grid over the screen, so the memory and
+/// the drawing don't depend on the record length. The previous frames fade
+/// out with every new one, like the phosphor of an analog oscilloscope.
+class DensityMap {
+  public:
+    DensityMap();
+
+    /// \brief Forgets all frames.
+    void clear();
+
+    /// \brief Fades out the previous frames and adds the sample pairs of a frame.
+    /// The map starts again if the scaling is not the same as for the last frame.
+    /// \param x The voltages of the horizontal channel.
+    /// \param y The voltages of the vertical channel.
+    /// \param count The number of pairs, both channels need at least as many samples.
+    /// \param xScale The divs per volt of the horizontal channel.
+    /// \param xOffset The horizontal position of the zero line in divs.
+    /// \param yScale The divs per volt of the vertical channel.
+    /// \param yOffset The vertical position of the zero line in divs.
+    /// \param decay The factor for the hits of the previous frames, 0 only shows this frame.
+    void add(const SampleValues &x, const SampleValues &y, size_t count, double xScale, double xOffset,
+             double yScale, double yOffset, double decay);
+
+    /// \brief Colors the hits on a logarithmic scale like the persistence map.
+    /// \param image The RGBA pixels, row by row beginning with the bottom row, bins without hits are transparent.
+    void colorize(std::vector<quint8> &image) const;
+
+    static const unsigned int WIDTH = PersistenceMap::WIDTH;   ///< The columns over the screen
+    static const unsigned int HEIGHT = PersistenceMap::HEIGHT; ///< The rows over the screen
+    static const unsigned int BLOCK = 4096;                    ///< The pairs that are quantized at once
+
+  private:
+    std::vector<float> bins;
+    float peak = 0.0f;
+    // The buffers of a block of pairs
+    std::vector<float> values[2];
+    std::vector<int> positions[2];
+    // The scaling of the frames in the map
+    double lastXScale = 0.0;
+    double lastXOffset = 0.0;
+    double lastYScale = 0.0;
+    double lastYOffset = 0.0;
+};
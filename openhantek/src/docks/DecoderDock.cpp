@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCheckBox>
+#include <QCloseEvent>
+#include <QComboBox>
+#include <QDockWidget>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QListWidget>
+#include <QSpinBox>
+
+#include <algorithm>
+
+#include "DecoderDock.h"
+#include "dockwindows.h"
+
+#include "dataanalyzerresult.h"
+#include "settings.h"
+#include "sispinbox.h"
+#include "utils/dsoStrings.h"
+#include "utils/printutils.h"
+
+const int DecoderDock::MAX_LISTED;
+
+////////////////////////////////////////////////////////////////////////////////
+// class DecoderDock
+/// \brief Initializes the protocol decoder docking window.
+/// \param settings The target settings object.
+/// \param parent The parent widget.
+/// \param flags Flags for the window manager.
+DecoderDock::DecoderDock(DsoSettings *settings, QWidget *parent, Qt::WindowFlags flags)
+    : QDockWidget(tr("Decoder"), parent, flags), settings(settings) {
+    DsoSettingsScopeDecoder &decoder = settings->scope.decoder;
+
+    // Initialize elements
+    this->protocolComboBox = new QComboBox();
+    this->protocolComboBox->addItems(QStringList() << tr("Off") << tr("UART") << tr("SPI") << tr("I2C"));
+    for (int source = 0; source < 2; ++source) {
+        this->sourceLabel[source] = new QLabel();
+        this->sourceComboBox[source] = new QComboBox();
+        for (unsigned int channel = 0; channel < settings->scope.physicalChannels; ++channel)
+            this->sourceComboBox[source]->addItem(settings->scope.voltage[(int)channel].name);
+    }
+    this->thresholdSiSpinBox = new SiSpinBox(UNIT_VOLTS);
+    this->thresholdSiSpinBox->setMinimum(-100.0);
+    this->thresholdSiSpinBox->setMaximum(100.0);
+    this->hysteresisSiSpinBox = new SiSpinBox(UNIT_VOLTS);
+    this->hysteresisSiSpinBox->setMinimum(0.0);
+    this->hysteresisSiSpinBox->setMaximum(10.0);
+
+    // Other baudrates can be typed in
+    this->baudrateLabel = new QLabel(tr("Baudrate"));
+    this->baudrateComboBox = new QComboBox();
+    this->baudrateComboBox->setEditable(true);
+    this->baudrateComboBox->setInsertPolicy(QComboBox::NoInsert);
+    for (int baudrate : {300, 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600})
+        this->baudrateComboBox->addItem(QString::number(baudrate));
+    this->characterLabel = new QLabel(tr("Character"));
+    this->dataBitsComboBox = new QComboBox();
+    for (unsigned int bits = 5; bits <= 9; ++bits) this->dataBitsComboBox->addItem(QString::number(bits), bits);
+    this->parityComboBox = new QComboBox();
+    this->parityComboBox->addItems(QStringList() << tr("N") << tr("O") << tr("E"));
+    this->stopBitsComboBox = new QComboBox();
+    for (unsigned int bits = 1; bits <= 2; ++bits) this->stopBitsComboBox->addItem(QString::number(bits), bits);
+    this->invertedCheckBox = new QCheckBox(tr("Inverted"));
+
+    this->clockSlopeLabel = new QLabel(tr("Sampling edge"));
+    this->clockSlopeComboBox = new QComboBox();
+    for (int slope = Dso::SLOPE_POSITIVE; slope < Dso::SLOPE_COUNT; ++slope)
+        this->clockSlopeComboBox->addItem(Dso::slopeString((Dso::Slope)slope));
+    this->wordBitsLabel = new QLabel(tr("Word bits"));
+    this->wordBitsSpinBox = new QSpinBox();
+    this->wordBitsSpinBox->setRange(1, 32);
+    this->lsbFirstCheckBox = new QCheckBox(tr("LSB first"));
+
+    this->countLabel = new QLabel();
+    this->annotationList = new QListWidget();
+    this->annotationList->setUniformItemSizes(true);
+
+    QHBoxLayout *characterLayout = new QHBoxLayout();
+    characterLayout->addWidget(this->dataBitsComboBox);
+    characterLayout->addWidget(this->parityComboBox);
+    characterLayout->addWidget(this->stopBitsComboBox);
+
+    this->dockLayout = new QGridLayout();
+    this->dockLayout->setColumnMinimumWidth(0, 64);
+    this->dockLayout->setColumnStretch(1, 1);
+    this->dockLayout->addWidget(new QLabel(tr("Protocol")), 0, 0);
+    this->dockLayout->addWidget(this->protocolComboBox, 0, 1);
+    this->dockLayout->addWidget(this->sourceLabel[0], 1, 0);
+    this->dockLayout->addWidget(this->sourceComboBox[0], 1, 1);
+    this->dockLayout->addWidget(this->sourceLabel[1], 2, 0);
+    this->dockLayout->addWidget(this->sourceComboBox[1], 2, 1);
+    this->dockLayout->addWidget(new QLabel(tr("Threshold")), 3, 0);
+    this->dockLayout->addWidget(this->thresholdSiSpinBox, 3, 1);
+    this->dockLayout->addWidget(new QLabel(tr("Hysteresis")), 4, 0);
+    this->dockLayout->addWidget(this->hysteresisSiSpinBox, 4, 1);
+    this->dockLayout->addWidget(this->baudrateLabel, 5, 0);
+    this->dockLayout->addWidget(this->baudrateComboBox, 5, 1);
+    this->dockLayout->addWidget(this->characterLabel, 6, 0);
+    this->dockLayout->addLayout(characterLayout, 6, 1);
+    this->dockLayout->addWidget(this->invertedCheckBox, 7, 1);
+    this->dockLayout->addWidget(this->clockSlopeLabel, 8, 0);
+    this->dockLayout->addWidget(this->clockSlopeComboBox, 8, 1);
+    this->dockLayout->addWidget(this->wordBitsLabel, 9, 0);
+    this->dockLayout->addWidget(this->wordBitsSpinBox, 9, 1);
+    this->dockLayout->addWidget(this->lsbFirstCheckBox, 10, 1);
+    this->dockLayout->addWidget(this->countLabel, 11, 0, 1, 2);
+    this->dockLayout->addWidget(this->annotationList, 12, 0, 1, 2);
+    this->dockLayout->setRowStretch(12, 1);
+
+    this->dockWidget = new QWidget();
+    SetupDockWidget(this, dockWidget, dockLayout);
+    // The list takes the remaining height
+    dockWidget->setSizePolicy(QSizePolicy(QSizePolicy::Minimum, QSizePolicy::Expanding, QSizePolicy::DefaultType));
+
+    // Set values
+    this->protocolComboBox->setCurrentIndex(decoder.protocol);
+    for (int source = 0; source < 2; ++source)
+        this->sourceComboBox[source]->setCurrentIndex((int)decoder.sources[source]);
+    this->thresholdSiSpinBox->setValue(decoder.threshold);
+    this->hysteresisSiSpinBox->setValue(decoder.hysteresis);
+    this->baudrateComboBox->setEditText(QString::number(decoder.baudrate));
+    this->dataBitsComboBox->setCurrentIndex(this->dataBitsComboBox->findData(decoder.dataBits));
+    this->parityComboBox->setCurrentIndex(decoder.parity);
+    this->stopBitsComboBox->setCurrentIndex(this->stopBitsComboBox->findData(decoder.stopBits));
+    this->invertedCheckBox->setChecked(decoder.inverted);
+    this->clockSlopeComboBox->setCurrentIndex(decoder.clockSlope);
+    this->wordBitsSpinBox->setValue((int)decoder.wordBits);
+    this->lsbFirstCheckBox->setChecked(decoder.lsbFirst);
+    updateVisibility();
+
+    // Connect signals and slots, the analyzer takes the settings with the next frame
+    connect(this->protocolComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) {
+                this->settings->scope.decoder.protocol = (Dso::Protocol)index;
+                updateVisibility();
+                if (index == Dso::PROTOCOL_OFF) showAnnotations(nullptr);
+            });
+    for (int source = 0; source < 2; ++source)
+        connect(this->sourceComboBox[source], static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+                [this, source](int index) {
+                    if (index >= 0) this->settings->scope.decoder.sources[source] = (unsigned)index;
+                });
+    connect(this->thresholdSiSpinBox, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            [this](double value) { this->settings->scope.decoder.threshold = value; });
+    connect(this->hysteresisSiSpinBox, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            [this](double value) { this->settings->scope.decoder.hysteresis = value; });
+    connect(this->baudrateComboBox, &QComboBox::editTextChanged, [this](const QString &text) {
+        bool valid;
+        const double baudrate = text.toDouble(&valid);
+        if (valid && baudrate > 0.0) this->settings->scope.decoder.baudrate = baudrate;
+    });
+    connect(this->dataBitsComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) {
+                this->settings->scope.decoder.dataBits = this->dataBitsComboBox->itemData(index).toUInt();
+            });
+    connect(this->parityComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) { this->settings->scope.decoder.parity = (Dso::Parity)index; });
+    connect(this->stopBitsComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) {
+                this->settings->scope.decoder.stopBits = this->stopBitsComboBox->itemData(index).toUInt();
+            });
+    connect(this->invertedCheckBox, &QCheckBox::toggled,
+            [this](bool checked) { this->settings->scope.decoder.inverted = checked; });
+    connect(this->clockSlopeComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) { this->settings->scope.decoder.clockSlope = (Dso::Slope)index; });
+    connect(this->wordBitsSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            [this](int value) { this->settings->scope.decoder.wordBits = (unsigned)value; });
+    connect(this->lsbFirstCheckBox, &QCheckBox::toggled,
+            [this](bool checked) { this->settings->scope.decoder.lsbFirst = checked; });
+}
+
+/// \brief Don't close the dock, just hide it
+/// \param event The close event that should be handled.
+void DecoderDock::closeEvent(QCloseEvent *event) {
+    this->hide();
+
+    event->accept();
+}
+
+void DecoderDock::showAnnotations(const DataAnalyzerResult *result) {
+    if (!isVisible()) return;
+    if (!result || settings->scope.decoder.protocol == Dso::PROTOCOL_OFF) {
+        countLabel->clear();
+        annotationList->clear();
+        return;
+    }
+
+    const std::vector<ProtocolAnnotation> &annotations = result->annotations();
+    const DataChannel *source = result->data((int)settings->scope.decoder.sources[0]);
+    const double interval = source ? source->voltage.interval : 0.0;
+    countLabel->setText(tr("%n annotation(s)", "", (int)annotations.size()));
+
+    // The list is filled again for every frame, so it is limited to the newest annotations
+    annotationList->setUpdatesEnabled(false);
+    annotationList->clear();
+    const size_t first = annotations.size() - std::min(annotations.size(), (size_t)MAX_LISTED);
+    for (size_t index = first; index < annotations.size(); ++index) {
+        const ProtocolAnnotation &annotation = annotations[index];
+        QListWidgetItem *item = new QListWidgetItem(
+            QString("%1\t%2").arg(valueToString(annotation.start * interval, UNIT_SECONDS, 6), annotation.text),
+            annotationList);
+        if (annotation.error) item->setForeground(Qt::red);
+    }
+    annotationList->setUpdatesEnabled(true);
+}
+
+/// \brief Shows the settings of the selected protocol only.
+void DecoderDock::updateVisibility() {
+    const Dso::Protocol protocol = settings->scope.decoder.protocol;
+    const bool uart = protocol == Dso::PROTOCOL_UART;
+    const bool spi = protocol == Dso::PROTOCOL_SPI;
+    const bool i2c = protocol == Dso::PROTOCOL_I2C;
+
+    sourceLabel[0]->setText(spi ? tr("Clock") : (i2c ? tr("SCL") : tr("Data")));
+    sourceLabel[1]->setText(spi ? tr("Data") : tr("SDA"));
+    sourceLabel[1]->setVisible(spi || i2c);
+    sourceComboBox[1]->setVisible(spi || i2c);
+    for (QWidget *widget : std::initializer_list<QWidget *>{baudrateLabel, baudrateComboBox, characterLabel,
+                                                             dataBitsComboBox, parityComboBox, stopBitsComboBox,
+                                                             invertedCheckBox})
+        widget->setVisible(uart);
+    for (QWidget *widget : std::initializer_list<QWidget *>{clockSlopeLabel, clockSlopeComboBox, wordBitsLabel,
+                                                             wordBitsSpinBox, lsbFirstCheckBox})
+        widget->setVisible(spi);
+}
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QDockWidget>
+#include <QGridLayout>
+
+#include "definitions.h"
+#include "settings.h"
+
+class QLabel;
+class QCheckBox;
+class QComboBox;
+class QListWidget;
+class QSpinBox;
+
+class DataAnalyzerResult;
+class SiSpinBox;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class DecoderDock                                             dockwindows.h
+/// \brief Dock window for the serial protocol decoder.
+/// It contains the protocol, its sources and format, and lists the decoded
+/// annotations of the newest frame.
+class DecoderDock : public QDockWidget {
+    Q_OBJECT
+
+  public:
+    DecoderDock(DsoSettings *settings, QWidget *parent, Qt::WindowFlags flags = 0);
+
+    /// \brief Lists the annotations of a result, nothing is done while the dock is hidden.
+    /// \param result The analyzed frame.
+    void showAnnotations(const DataAnalyzerResult *result);
+
+    static const int MAX_LISTED = 1000; ///< Only the newest annotations are listed
+
+  protected:
+    void closeEvent(QCloseEvent *event);
+
+  private:
+    void updateVisibility();
+
+    QGridLayout *dockLayout;        ///< The main layout for the dock window
+    QWidget *dockWidget;            ///< The main widget for the dock window
+    QComboBox *protocolComboBox;    ///< Selects the decoded protocol
+    QLabel *sourceLabel[2];         ///< The names of the sources of the protocol
+    QComboBox *sourceComboBox[2];   ///< Select the channels of the sources
+    SiSpinBox *thresholdSiSpinBox;  ///< Selects the logic threshold
+    SiSpinBox *hysteresisSiSpinBox; ///< Selects the hysteresis around the threshold
+    QLabel *baudrateLabel;          ///< The label for the UART baudrate
+    QComboBox *baudrateComboBox;    ///< Selects the UART baudrate, other rates can be entered
+    QLabel *characterLabel;         ///< The label for the UART character format
+    QComboBox *dataBitsComboBox;    ///< Selects the UART data bits
+    QComboBox *parityComboBox;      ///< Selects the UART parity
+    QComboBox *stopBitsComboBox;    ///< Selects the UART stop bits
+    QCheckBox *invertedCheckBox;    ///< Selects if the UART line idles low
+    QLabel *clockSlopeLabel;        ///< The label for the SPI sampling edge
+    QComboBox *clockSlopeComboBox;  ///< Selects the SPI clock edge the data is sampled at
+    QLabel *wordBitsLabel;          ///< The label for the SPI word length
+    QSpinBox *wordBitsSpinBox;      ///< Selects the bits of a SPI word
+    QCheckBox *lsbFirstCheckBox;    ///< Selects if the SPI words begin with the least significant bit
+    QLabel *countLabel;             ///< Shows the number of annotations in the frame
+    QListWidget *annotationList;    ///< Lists the annotations
+
+    DsoSettings *settings; ///< The settings provided by the parent class
+};
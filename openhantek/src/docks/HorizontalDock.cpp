@@ -13,6 +13,9 @@
 #include "HorizontalDock.h"
 #include "dockwindows.h"
 
+#include "analyse/equivalenttime.h"
+#include "hantek/acquisitionmodes.h"
+
 #include "settings.h"
 #include "sispinbox.h"
 #include "utils/dsoStrings.h"
@@ -62,6 +65,16 @@ HorizontalDock::HorizontalDock(DsoSettings *settings, QWidget *parent, Qt::Windo
     for (int format = Dso::GRAPHFORMAT_TY; format < Dso::GRAPHFORMAT_COUNT; ++format)
         this->formatComboBox->addItem(Dso::graphFormatString((Dso::GraphFormat)format));
 
+    this->acquisitionModeLabel = new QLabel(tr("Acquisition"));
+    this->acquisitionModeComboBox = new QComboBox();
+    for (int mode = Dso::ACQUISITION_NORMAL; mode < Dso::ACQUISITION_COUNT; ++mode)
+        this->acquisitionModeComboBox->addItem(Dso::acquisitionModeString((Dso::AcquisitionMode)mode));
+    this->acquisitionModeComboBox->setItemData(Dso::ACQUISITION_EQUIVALENT,
+                                               tr("Needs a repetitive signal and the software trigger"),
+                                               Qt::ToolTipRole);
+    this->acquisitionCountLabel = new QLabel();
+    this->acquisitionCountComboBox = new QComboBox();
+
     this->dockLayout = new QGridLayout();
     this->dockLayout->setColumnMinimumWidth(0, 64);
     this->dockLayout->setColumnStretch(1, 1);
@@ -75,6 +88,10 @@ HorizontalDock::HorizontalDock(DsoSettings *settings, QWidget *parent, Qt::Windo
     this->dockLayout->addWidget(this->recordLengthComboBox, 3, 1);
     this->dockLayout->addWidget(this->formatLabel, 4, 0);
     this->dockLayout->addWidget(this->formatComboBox, 4, 1);
+    this->dockLayout->addWidget(this->acquisitionModeLabel, 5, 0);
+    this->dockLayout->addWidget(this->acquisitionModeComboBox, 5, 1);
+    this->dockLayout->addWidget(this->acquisitionCountLabel, 6, 0);
+    this->dockLayout->addWidget(this->acquisitionCountComboBox, 6, 1);
 
     this->dockWidget = new QWidget();
     SetupDockWidget(this, dockWidget, dockLayout);
@@ -85,6 +102,10 @@ HorizontalDock::HorizontalDock(DsoSettings *settings, QWidget *parent, Qt::Windo
     connect(this->frequencybaseSiSpinBox, SELECT<double>::OVERLOAD_OF(&QDoubleSpinBox::valueChanged), this, &HorizontalDock::frequencybaseSelected);
     connect(this->recordLengthComboBox, SELECT<int>::OVERLOAD_OF(&QComboBox::currentIndexChanged), this, &HorizontalDock::recordLengthSelected);
     connect(this->formatComboBox, SELECT<int>::OVERLOAD_OF(&QComboBox::currentIndexChanged), this, &HorizontalDock::formatSelected);
+    connect(this->acquisitionModeComboBox, SELECT<int>::OVERLOAD_OF(&QComboBox::currentIndexChanged), this,
+            &HorizontalDock::acquisitionModeSelected);
+    connect(this->acquisitionCountComboBox, SELECT<int>::OVERLOAD_OF(&QComboBox::currentIndexChanged), this,
+            &HorizontalDock::acquisitionCountSelected);
 
     // Set values
     this->setSamplerate(settings->scope.horizontal.samplerate);
@@ -92,6 +113,7 @@ HorizontalDock::HorizontalDock(DsoSettings *settings, QWidget *parent, Qt::Windo
     this->setFrequencybase(settings->scope.horizontal.frequencybase);
     // this->setRecordLength(settings->scope.horizontal.recordLength);
     this->setFormat(settings->scope.horizontal.format);
+    this->setAcquisitionMode(settings->scope.horizontal.acquisitionMode);
 }
 
 /// \brief Don't close the dock, just hide it.
@@ -164,6 +186,42 @@ int HorizontalDock::setFormat(Dso::GraphFormat format) {
     return -1;
 }
 
+/// \brief Changes the acquisition mode, the counts are taken from the settings.
+/// \param mode The processing of the samples.
+void HorizontalDock::setAcquisitionMode(Dso::AcquisitionMode mode) {
+    QSignalBlocker blocker(acquisitionModeComboBox);
+    if (mode >= Dso::ACQUISITION_NORMAL && mode < Dso::ACQUISITION_COUNT)
+        acquisitionModeComboBox->setCurrentIndex(mode);
+    updateAcquisitionCounts();
+}
+
+/// \brief Fills the count combo box with the powers of two the acquisition mode supports.
+/// The count is hidden in normal mode, it has no effect there.
+void HorizontalDock::updateAcquisitionCounts() {
+    QSignalBlocker blocker(acquisitionCountComboBox);
+    const Dso::AcquisitionMode mode = (Dso::AcquisitionMode)acquisitionModeComboBox->currentIndex();
+    unsigned maximum = Hantek::AcquisitionProcessor::MAXIMUM_AVERAGES;
+    unsigned count = settings->scope.horizontal.averages;
+    acquisitionCountLabel->setText(tr("Averages"));
+    if (mode == Dso::ACQUISITION_HIGHRES) {
+        maximum = Hantek::AcquisitionProcessor::MAXIMUM_FACTOR;
+        count = settings->scope.horizontal.highResolution;
+        acquisitionCountLabel->setText(tr("Samples"));
+    } else if (mode == Dso::ACQUISITION_EQUIVALENT) {
+        maximum = EquivalentTimeSampler::MAXIMUM_FACTOR;
+        count = settings->scope.horizontal.equivalentTime;
+        acquisitionCountLabel->setText(tr("Steps"));
+    }
+
+    acquisitionCountComboBox->clear();
+    for (unsigned step = 2; step <= maximum; step *= 2) {
+        acquisitionCountComboBox->addItem(QString::number(step), step);
+        if (step <= count) acquisitionCountComboBox->setCurrentIndex(acquisitionCountComboBox->count() - 1);
+    }
+    acquisitionCountLabel->setVisible(mode != Dso::ACQUISITION_NORMAL);
+    acquisitionCountComboBox->setVisible(mode != Dso::ACQUISITION_NORMAL);
+}
+
 /// \brief Updates the available record lengths in the combo box.
 /// \param recordLengths The available record lengths for the combo box.
 void HorizontalDock::availableRecordLengthsChanged(const std::vector<unsigned> &recordLengths) {
@@ -231,3 +289,27 @@ void HorizontalDock::formatSelected(int index) {
     settings->scope.horizontal.format = (Dso::GraphFormat)index;
     emit formatChanged(settings->scope.horizontal.format);
 }
+
+/// \brief Called when the acquisition mode combo box changes its value.
+/// \param index The index of the combo box item.
+void HorizontalDock::acquisitionModeSelected(int index) {
+    settings->scope.horizontal.acquisitionMode = (Dso::AcquisitionMode)index;
+    updateAcquisitionCounts();
+    const unsigned count = settings->scope.horizontal.acquisitionMode == Dso::ACQUISITION_NORMAL
+                               ? 1
+                               : acquisitionCountComboBox->currentData().toUInt();
+    emit acquisitionModeChanged(settings->scope.horizontal.acquisitionMode, count);
+}
+
+/// \brief Called when the count combo box changes its value.
+/// \param index The index of the combo box item.
+void HorizontalDock::acquisitionCountSelected(int index) {
+    const unsigned count = acquisitionCountComboBox->itemData(index).toUInt();
+    if (settings->scope.horizontal.acquisitionMode == Dso::ACQUISITION_HIGHRES)
+        settings->scope.horizontal.highResolution = count;
+    else if (settings->scope.horizontal.acquisitionMode == Dso::ACQUISITION_EQUIVALENT)
+        settings->scope.horizontal.equivalentTime = count;
+    else
+        settings->scope.horizontal.averages = count;
+    emit acquisitionModeChanged(settings->scope.horizontal.acquisitionMode, count);
+}
@@ -29,9 +29,11 @@ class HorizontalDock : public QDockWidget {
     double setTimebase(double timebase);
     void setRecordLength(unsigned int recordLength);
     int setFormat(Dso::GraphFormat format);
+    void setAcquisitionMode(Dso::AcquisitionMode mode);
 
   protected:
     void closeEvent(QCloseEvent *event);
+    void updateAcquisitionCounts();
 
     QGridLayout *dockLayout;           ///< The main layout for the dock window
     QWidget *dockWidget;               ///< The main widget for the dock window
@@ -40,6 +42,8 @@ class HorizontalDock : public QDockWidget {
     QLabel *frequencybaseLabel;        ///< The label for the frequencybase spinbox
     QLabel *recordLengthLabel;         ///< The label for the record length combobox
     QLabel *formatLabel;               ///< The label for the format combobox
+    QLabel *acquisitionModeLabel;      ///< The label for the acquisition mode combobox
+    QLabel *acquisitionCountLabel;     ///< The label for the averages or the samples per group
     SiSpinBox *samplerateSiSpinBox;    ///< Selects the samplerate for aquisitions
     SiSpinBox *timebaseSiSpinBox;      ///< Selects the timebase for voltage graphs
     SiSpinBox *frequencybaseSiSpinBox; ///< Selects the frequencybase for spectrum graphs
@@ -47,6 +51,9 @@ class HorizontalDock : public QDockWidget {
     QComboBox *formatComboBox;         ///< Selects the way the sampled data is
                                        /// interpreted and shown
 
+    QComboBox *acquisitionModeComboBox;  ///< Selects the processing of the samples
+    QComboBox *acquisitionCountComboBox; ///< Selects the averaged frames or the samples per group
+
     DsoSettings *settings = nullptr; ///< The settings provided by the parent class
     QList<double> timebaseSteps;     ///< Steps for the timebase spinbox
 
@@ -63,6 +70,8 @@ class HorizontalDock : public QDockWidget {
     void timebaseSelected(double timebase);
     void recordLengthSelected(int index);
     void formatSelected(int index);
+    void acquisitionModeSelected(int index);
+    void acquisitionCountSelected(int index);
 
   signals:
     void frequencybaseChanged(double frequencybase);      ///< The frequencybase has been changed
@@ -70,4 +79,6 @@ class HorizontalDock : public QDockWidget {
     void timebaseChanged(double timebase);                ///< The timebase has been changed
     void recordLengthChanged(unsigned long recordLength); ///< The recordd length has been changed
     void formatChanged(Dso::GraphFormat format);          ///< The viewing format has been changed
+    /// \brief The acquisition mode or its count has been changed.
+    void acquisitionModeChanged(Dso::AcquisitionMode mode, unsigned count);
 };
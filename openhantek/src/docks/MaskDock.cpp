@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCheckBox>
+#include <QCloseEvent>
+#include <QComboBox>
+#include <QDir>
+#include <QDockWidget>
+#include <QDoubleSpinBox>
+#include <QFile>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTextStream>
+
+#include "MaskDock.h"
+#include "dockwindows.h"
+
+#include "dataanalyzerresult.h"
+#include "masktest.h"
+#include "settings.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// class MaskDock
+/// \brief Initializes the mask test docking window.
+/// \param settings The target settings object.
+/// \param parent The parent widget.
+/// \param flags Flags for the window manager.
+MaskDock::MaskDock(DsoSettings *settings, QWidget *parent, Qt::WindowFlags flags)
+    : QDockWidget(tr("Mask test"), parent, flags), settings(settings) {
+    DsoSettingsScopeMask &mask = settings->scope.mask;
+
+    // Initialize elements
+    this->enabledCheckBox = new QCheckBox(tr("Test"));
+    this->channelComboBox = new QComboBox();
+    for (const DsoSettingsScopeVoltage &voltage : settings->scope.voltage) this->channelComboBox->addItem(voltage.name);
+    this->areasLabel = new QLabel();
+    this->loadButton = new QPushButton(tr("Load..."));
+    this->saveButton = new QPushButton(tr("Save..."));
+    this->clearButton = new QPushButton(tr("Clear"));
+    for (QDoubleSpinBox **spinBox : {&this->xToleranceSpinBox, &this->yToleranceSpinBox}) {
+        *spinBox = new QDoubleSpinBox();
+        (*spinBox)->setRange(0.0, 5.0);
+        (*spinBox)->setSingleStep(0.1);
+        (*spinBox)->setSuffix(tr(" div"));
+    }
+    this->xToleranceSpinBox->setToolTip(tr("Horizontal distance of a created mask"));
+    this->yToleranceSpinBox->setToolTip(tr("Vertical distance of a created mask"));
+    this->createButton = new QPushButton(tr("Create from graph"));
+    this->stopOnFailCheckBox = new QCheckBox(tr("Stop on failure"));
+    this->saveOnFailCheckBox = new QCheckBox(tr("Save failures"));
+    this->savePathButton = new QPushButton();
+    this->totalLabel = new QLabel();
+    this->passedLabel = new QLabel();
+    this->failedLabel = new QLabel();
+    this->resetButton = new QPushButton(tr("Reset"));
+
+    QHBoxLayout *fileLayout = new QHBoxLayout();
+    fileLayout->addWidget(this->loadButton);
+    fileLayout->addWidget(this->saveButton);
+    fileLayout->addWidget(this->clearButton);
+    QHBoxLayout *toleranceLayout = new QHBoxLayout();
+    toleranceLayout->addWidget(this->xToleranceSpinBox);
+    toleranceLayout->addWidget(this->yToleranceSpinBox);
+
+    this->dockLayout = new QGridLayout();
+    this->dockLayout->setColumnMinimumWidth(0, 64);
+    this->dockLayout->setColumnStretch(1, 1);
+    this->dockLayout->addWidget(this->enabledCheckBox, 0, 0);
+    this->dockLayout->addWidget(this->channelComboBox, 0, 1);
+    this->dockLayout->addWidget(new QLabel(tr("Mask")), 1, 0);
+    this->dockLayout->addWidget(this->areasLabel, 1, 1);
+    this->dockLayout->addLayout(fileLayout, 2, 0, 1, 2);
+    this->dockLayout->addWidget(new QLabel(tr("Tolerance")), 3, 0);
+    this->dockLayout->addLayout(toleranceLayout, 3, 1);
+    this->dockLayout->addWidget(this->createButton, 4, 1);
+    this->dockLayout->addWidget(this->stopOnFailCheckBox, 5, 0, 1, 2);
+    this->dockLayout->addWidget(this->saveOnFailCheckBox, 6, 0);
+    this->dockLayout->addWidget(this->savePathButton, 6, 1);
+    this->dockLayout->addWidget(new QLabel(tr("Tested")), 7, 0);
+    this->dockLayout->addWidget(this->totalLabel, 7, 1);
+    this->dockLayout->addWidget(new QLabel(tr("Passed")), 8, 0);
+    this->dockLayout->addWidget(this->passedLabel, 8, 1);
+    this->dockLayout->addWidget(new QLabel(tr("Failed")), 9, 0);
+    this->dockLayout->addWidget(this->failedLabel, 9, 1);
+    this->dockLayout->addWidget(this->resetButton, 10, 1);
+
+    this->dockWidget = new QWidget();
+    SetupDockWidget(this, dockWidget, dockLayout);
+
+    // Set values
+    this->enabledCheckBox->setChecked(mask.enabled);
+    if (mask.channel < (unsigned)settings->scope.voltage.size())
+        this->channelComboBox->setCurrentIndex((int)mask.channel);
+    this->xToleranceSpinBox->setValue(mask.xTolerance);
+    this->yToleranceSpinBox->setValue(mask.yTolerance);
+    this->stopOnFailCheckBox->setChecked(mask.stopOnFail);
+    this->saveOnFailCheckBox->setChecked(mask.saveOnFail);
+    this->savePathButton->setText(mask.savePath.isEmpty() ? tr("Home directory") : QDir(mask.savePath).dirName());
+    this->savePathButton->setToolTip(mask.savePath.isEmpty() ? QDir::homePath() : mask.savePath);
+    updateMask();
+    showResult(nullptr);
+
+    // Connect signals and slots, the analyzer takes the settings with the next frame
+    connect(this->enabledCheckBox, &QCheckBox::toggled,
+            [this](bool checked) { this->settings->scope.mask.enabled = checked; });
+    connect(this->channelComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) {
+                if (index >= 0) this->settings->scope.mask.channel = (unsigned)index;
+            });
+    connect(this->loadButton, &QPushButton::clicked, [this]() { loadMask(); });
+    connect(this->saveButton, &QPushButton::clicked, [this]() { saveMask(); });
+    connect(this->clearButton, &QPushButton::clicked, [this]() {
+        this->settings->scope.mask.polygons.clear();
+        updateMask();
+        emit maskChanged();
+    });
+    connect(this->xToleranceSpinBox, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            [this](double value) { this->settings->scope.mask.xTolerance = value; });
+    connect(this->yToleranceSpinBox, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            [this](double value) { this->settings->scope.mask.yTolerance = value; });
+    connect(this->createButton, &QPushButton::clicked, [this]() { emit createRequested(); });
+    connect(this->stopOnFailCheckBox, &QCheckBox::toggled,
+            [this](bool checked) { this->settings->scope.mask.stopOnFail = checked; });
+    connect(this->saveOnFailCheckBox, &QCheckBox::toggled,
+            [this](bool checked) { this->settings->scope.mask.saveOnFail = checked; });
+    connect(this->savePathButton, &QPushButton::clicked, [this]() { selectSavePath(); });
+    connect(this->resetButton, &QPushButton::clicked, [this]() {
+        showResult(nullptr);
+        emit countersReset();
+    });
+}
+
+/// \brief Don't close the dock, just hide it
+/// \param event The close event that should be handled.
+void MaskDock::closeEvent(QCloseEvent *event) {
+    this->hide();
+
+    event->accept();
+}
+
+void MaskDock::showResult(const DataAnalyzerResult *result) {
+    if (result && result->mask().created) {
+        settings->scope.mask.polygons = *result->mask().created;
+        updateMask();
+        emit maskChanged();
+    }
+
+    const quint64 total = result ? result->mask().total : 0;
+    const quint64 failures = result ? result->mask().failures : 0;
+    totalLabel->setText(QString::number(total));
+    passedLabel->setText(QString::number(total - failures));
+    failedLabel->setText(total ? QString("%1 (%2 %)").arg(failures).arg(100.0 * failures / total, 0, 'f', 2)
+                               : QString::number(failures));
+}
+
+/// \brief Reads the mask from a text file.
+void MaskDock::loadMask() {
+    const QString filename =
+        QFileDialog::getOpenFileName(this, tr("Load mask"), QString(), tr("Mask files (*.mask);;All files (*)"));
+    if (filename.isEmpty()) return;
+
+    QFile file(filename);
+    std::vector<QPolygonF> polygons;
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text) || !MaskTest::parse(QTextStream(&file).readAll(), polygons)) {
+        QMessageBox::warning(this, tr("Load mask"), tr("The file %1 is no valid mask.").arg(filename));
+        return;
+    }
+    settings->scope.mask.polygons = polygons;
+    updateMask();
+    emit maskChanged();
+}
+
+/// \brief Writes the mask to a text file.
+void MaskDock::saveMask() {
+    QString filename =
+        QFileDialog::getSaveFileName(this, tr("Save mask"), QString(), tr("Mask files (*.mask);;All files (*)"));
+    if (filename.isEmpty()) return;
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        QMessageBox::warning(this, tr("Save mask"), tr("The file %1 can't be written.").arg(filename));
+        return;
+    }
+    QTextStream stream(&file);
+    stream << "# OpenHantek mask, one polygon per line as x,y points in divs\n";
+    stream << MaskTest::format(settings->scope.mask.polygons);
+}
+
+/// \brief Selects the directory the failed frames are saved to.
+void MaskDock::selectSavePath() {
+    const QString path = QFileDialog::getExistingDirectory(
+        this, tr("Save failures to"),
+        settings->scope.mask.savePath.isEmpty() ? QDir::homePath() : settings->scope.mask.savePath);
+    if (path.isEmpty()) return;
+
+    settings->scope.mask.savePath = path;
+    savePathButton->setText(QDir(path).dirName());
+    savePathButton->setToolTip(path);
+}
+
+/// \brief Shows the number of areas and enables the buttons that need a mask.
+void MaskDock::updateMask() {
+    const int areas = (int)settings->scope.mask.polygons.size();
+    areasLabel->setText(areas ? tr("%n area(s)", "", areas) : tr("None"));
+    saveButton->setEnabled(areas > 0);
+    clearButton->setEnabled(areas > 0);
+}
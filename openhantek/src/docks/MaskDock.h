@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QDockWidget>
+#include <QGridLayout>
+
+#include "definitions.h"
+#include "settings.h"
+
+class QLabel;
+class QCheckBox;
+class QComboBox;
+class QDoubleSpinBox;
+class QPushButton;
+
+class DataAnalyzerResult;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class MaskDock                                                dockwindows.h
+/// \brief Dock window for the mask test.
+/// It contains the tested channel, loads, saves and creates the mask, selects
+/// what happens with failed frames and shows the pass/fail counters.
+class MaskDock : public QDockWidget {
+    Q_OBJECT
+
+  public:
+    MaskDock(DsoSettings *settings, QWidget *parent, Qt::WindowFlags flags = 0);
+
+    /// \brief Shows the counters of a result and takes the mask that was created around its graph.
+    /// \param result The analyzed frame.
+    void showResult(const DataAnalyzerResult *result);
+
+  protected:
+    void closeEvent(QCloseEvent *event);
+
+  private:
+    void loadMask();
+    void saveMask();
+    void selectSavePath();
+    void updateMask();
+
+    QGridLayout *dockLayout;           ///< The main layout for the dock window
+    QWidget *dockWidget;               ///< The main widget for the dock window
+    QCheckBox *enabledCheckBox;        ///< Enables the mask test
+    QComboBox *channelComboBox;        ///< Selects the tested channel
+    QLabel *areasLabel;                ///< Shows the number of areas in the mask
+    QPushButton *loadButton;           ///< Loads the mask from a file
+    QPushButton *saveButton;           ///< Saves the mask to a file
+    QPushButton *clearButton;          ///< Removes the mask
+    QDoubleSpinBox *xToleranceSpinBox; ///< Selects the horizontal distance of a created mask
+    QDoubleSpinBox *yToleranceSpinBox; ///< Selects the vertical distance of a created mask
+    QPushButton *createButton;         ///< Creates a mask around the next graph
+    QCheckBox *stopOnFailCheckBox;     ///< Stops the acquisition when a frame fails
+    QCheckBox *saveOnFailCheckBox;     ///< Saves the frames that fail
+    QPushButton *savePathButton;       ///< Selects the directory for the failed frames
+    QLabel *totalLabel;                ///< Shows the number of tested frames
+    QLabel *passedLabel;               ///< Shows the number of passed frames
+    QLabel *failedLabel;               ///< Shows the number of failed frames
+    QPushButton *resetButton;          ///< Restarts the counters
+
+    DsoSettings *settings; ///< The settings provided by the parent class
+
+  signals:
+    void maskChanged();     ///< The mask in the settings was replaced
+    void createRequested(); ///< A mask should be created around the next graph
+    void countersReset();   ///< The counters should be restarted
+};
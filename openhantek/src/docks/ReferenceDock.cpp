@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCloseEvent>
+#include <QComboBox>
+#include <QDockWidget>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QInputDialog>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+
+#include "ReferenceDock.h"
+#include "dockwindows.h"
+
+#include "capture/capturefile.h"
+#include "settings.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// class ReferenceDock
+/// \brief Initializes the reference waveform docking window.
+/// \param settings The target settings object.
+/// \param parent The parent widget.
+/// \param flags Flags for the window manager.
+ReferenceDock::ReferenceDock(DsoSettings *settings, QWidget *parent, Qt::WindowFlags flags)
+    : QDockWidget(tr("References"), parent, flags), settings(settings) {
+    this->dockLayout = new QGridLayout();
+    this->dockLayout->setColumnMinimumWidth(0, 64);
+    this->dockLayout->setColumnStretch(1, 1);
+
+    for (unsigned int slot = 0; slot < ReferenceWaveforms::COUNT; ++slot) {
+        // Initialize elements
+        QLabel *slotLabel = new QLabel(tr("Ref %1").arg(slot + 1));
+        QPalette palette = slotLabel->palette();
+        palette.setColor(QPalette::WindowText, ReferenceWaveforms::color(slot));
+        slotLabel->setPalette(palette);
+        this->channelComboBox[slot] = new QComboBox();
+        for (const DsoSettingsScopeVoltage &voltage : settings->scope.voltage)
+            this->channelComboBox[slot]->addItem(voltage.name);
+        this->storeButton[slot] = new QPushButton(tr("Store"));
+        this->loadButton[slot] = new QPushButton(tr("Load..."));
+        this->clearButton[slot] = new QPushButton(tr("Clear"));
+        this->nameLabel[slot] = new QLabel();
+
+        QHBoxLayout *slotLayout = new QHBoxLayout();
+        slotLayout->addWidget(this->channelComboBox[slot], 1);
+        slotLayout->addWidget(this->storeButton[slot]);
+        slotLayout->addWidget(this->loadButton[slot]);
+        slotLayout->addWidget(this->clearButton[slot]);
+        this->dockLayout->addWidget(slotLabel, (int)slot * 2, 0);
+        this->dockLayout->addLayout(slotLayout, (int)slot * 2, 1);
+        this->dockLayout->addWidget(this->nameLabel[slot], (int)slot * 2 + 1, 1);
+        showReference(slot, nullptr);
+
+        // Connect signals and slots
+        connect(this->storeButton[slot], &QPushButton::clicked, [this, slot]() {
+            const int channel = this->channelComboBox[slot]->currentIndex();
+            if (channel >= 0) emit storeRequested(slot, (unsigned)channel);
+        });
+        connect(this->loadButton[slot], &QPushButton::clicked, [this, slot]() { loadReference(slot); });
+        connect(this->clearButton[slot], &QPushButton::clicked, [this, slot]() { emit cleared(slot); });
+    }
+
+    this->dockWidget = new QWidget();
+    SetupDockWidget(this, dockWidget, dockLayout);
+}
+
+/// \brief Don't close the dock, just hide it
+/// \param event The close event that should be handled.
+void ReferenceDock::closeEvent(QCloseEvent *event) {
+    this->hide();
+
+    event->accept();
+}
+
+void ReferenceDock::showReference(unsigned int slot, const ReferenceWaveform *waveform) {
+    nameLabel[slot]->setText(waveform ? waveform->name : tr("Empty"));
+    clearButton[slot]->setEnabled(waveform != nullptr);
+    if (waveform && (int)waveform->channel < channelComboBox[slot]->count())
+        channelComboBox[slot]->setCurrentIndex((int)waveform->channel);
+}
+
+/// \brief Reads a frame of a capture file into a slot.
+/// The selected channel is read from the file and the frame is asked for if there are several.
+void ReferenceDock::loadReference(unsigned int slot) {
+    const QString fileName =
+        QFileDialog::getOpenFileName(this, tr("Load reference"), QString(), tr("Capture files (*.ohc)"));
+    if (fileName.isEmpty()) return;
+
+    CaptureFile file;
+    if (!file.open(fileName)) {
+        QMessageBox::warning(this, tr("Load reference"), file.errorString());
+        return;
+    }
+    const int channel = channelComboBox[slot]->currentIndex();
+    const QString channelName = channelComboBox[slot]->currentText();
+    if (channel < 0 || (unsigned)channel >= file.channelCount() || file.frameCount() == 0) {
+        QMessageBox::warning(this, tr("Load reference"),
+                             tr("The file %1 has no frames of %2.").arg(fileName, channelName));
+        return;
+    }
+    int frame = 1;
+    if (file.frameCount() > 1) {
+        bool accepted;
+        frame = QInputDialog::getInt(this, tr("Load reference"), tr("Frame:"), 1, 1, (int)file.frameCount(), 1,
+                                     &accepted);
+        if (!accepted) return;
+    }
+
+    std::shared_ptr<ReferenceWaveform> waveform =
+        ReferenceWaveforms::fromCapture(file, (size_t)frame - 1, (unsigned)channel);
+    if (!waveform) {
+        QMessageBox::warning(this, tr("Load reference"),
+                             tr("Frame %1 has no samples of %2.").arg(frame).arg(channelName));
+        return;
+    }
+    waveform->name = tr("%1, frame %2").arg(QFileInfo(fileName).fileName()).arg(frame);
+    emit loaded(slot, std::move(waveform));
+}
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QDockWidget>
+#include <QGridLayout>
+#include <memory>
+
+#include "definitions.h"
+#include "referencewaveforms.h"
+#include "settings.h"
+
+class QLabel;
+class QComboBox;
+class QPushButton;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ReferenceDock                                           dockwindows.h
+/// \brief Dock window for the reference waveforms.
+/// Every slot stores the graph of a channel or a frame of a capture file, the
+/// reference is drawn with the gain and offset of the selected channel.
+class ReferenceDock : public QDockWidget {
+    Q_OBJECT
+
+  public:
+    ReferenceDock(DsoSettings *settings, QWidget *parent, Qt::WindowFlags flags = 0);
+
+    /// \brief Shows the name of the waveform in a slot.
+    /// \param slot The slot.
+    /// \param waveform The waveform, nullptr if the slot is empty.
+    void showReference(unsigned int slot, const ReferenceWaveform *waveform);
+
+  protected:
+    void closeEvent(QCloseEvent *event);
+
+  private:
+    void loadReference(unsigned int slot);
+
+    QGridLayout *dockLayout;                               ///< The main layout for the dock window
+    QWidget *dockWidget;                                   ///< The main widget for the dock window
+    QComboBox *channelComboBox[ReferenceWaveforms::COUNT]; ///< Select the channel of the references
+    QPushButton *storeButton[ReferenceWaveforms::COUNT];   ///< Store the graphs of the channels
+    QPushButton *loadButton[ReferenceWaveforms::COUNT];    ///< Load frames of capture files
+    QPushButton *clearButton[ReferenceWaveforms::COUNT];   ///< Empty the slots
+    QLabel *nameLabel[ReferenceWaveforms::COUNT];          ///< Show where the references came from
+
+    DsoSettings *settings; ///< The settings provided by the parent class
+
+  signals:
+    void storeRequested(unsigned int slot, unsigned int channel); ///< The shown graph should be stored
+    /// A waveform was loaded for the slot
+    void loaded(unsigned int slot, std::shared_ptr<const ReferenceWaveform> waveform);
+    void cleared(unsigned int slot); ///< The slot should be emptied
+};
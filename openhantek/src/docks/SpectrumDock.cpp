@@ -40,6 +40,15 @@ SpectrumDock::SpectrumDock(DsoSettings *settings, QWidget *parent, Qt::WindowFla
         this->usedCheckBox.append(new QCheckBox(settings->scope.voltage[channel].name));
     }
 
+    // The zoomed spectrum resolves a narrow band around the center frequency
+    this->zoomCheckBox = new QCheckBox(tr("Zoom"));
+    this->zoomCenterSiSpinBox = new SiSpinBox(UNIT_HERTZ);
+    this->zoomCenterSiSpinBox->setMinimum(0.0);
+    this->zoomCenterSiSpinBox->setMaximum(100e6);
+    this->zoomFactorComboBox = new QComboBox();
+    for (unsigned int factor = 2; factor <= 1024; factor *= 2)
+        this->zoomFactorComboBox->addItem(QString("x%1").arg(factor), factor);
+
     this->dockLayout = new QGridLayout();
     this->dockLayout->setColumnMinimumWidth(0, 64);
     this->dockLayout->setColumnStretch(1, 1);
@@ -47,6 +56,10 @@ SpectrumDock::SpectrumDock(DsoSettings *settings, QWidget *parent, Qt::WindowFla
         this->dockLayout->addWidget(this->usedCheckBox[channel], channel, 0);
         this->dockLayout->addWidget(this->magnitudeComboBox[channel], channel, 1);
     }
+    const int zoomRow = settings->scope.voltage.count();
+    this->dockLayout->addWidget(this->zoomCheckBox, zoomRow, 0);
+    this->dockLayout->addWidget(this->zoomCenterSiSpinBox, zoomRow, 1);
+    this->dockLayout->addWidget(this->zoomFactorComboBox, zoomRow + 1, 1);
 
     this->dockWidget = new QWidget();
     SetupDockWidget(this, dockWidget, dockLayout);
@@ -56,12 +69,17 @@ SpectrumDock::SpectrumDock(DsoSettings *settings, QWidget *parent, Qt::WindowFla
         connect(this->magnitudeComboBox[channel], SIGNAL(currentIndexChanged(int)), this, SLOT(magnitudeSelected(int)));
         connect(this->usedCheckBox[channel], SIGNAL(toggled(bool)), this, SLOT(usedSwitched(bool)));
     }
+    connect(this->zoomCheckBox, SIGNAL(toggled(bool)), this, SLOT(zoomSwitched(bool)));
+    connect(this->zoomCenterSiSpinBox, SIGNAL(valueChanged(double)), this, SLOT(zoomCenterSelected(double)));
+    connect(this->zoomFactorComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(zoomFactorSelected(int)));
 
     // Set values
     for (int channel = 0; channel < settings->scope.voltage.count(); ++channel) {
         this->setMagnitude(channel, settings->scope.spectrum[channel].magnitude);
         this->setUsed(channel, settings->scope.spectrum[channel].used);
     }
+    this->setZoom(settings->scope.spectrumZoom, settings->scope.spectrumZoomCenter,
+                  settings->scope.spectrumZoomFactor);
 }
 
 /// \brief Cleans up everything.
@@ -101,6 +119,19 @@ int SpectrumDock::setUsed(int channel, bool used) {
     return -1;
 }
 
+/// \brief Sets the zoomed spectrum.
+/// \param zoom true if the spectrum should be zoomed around the center frequency.
+/// \param center The center frequency in Hz.
+/// \param factor The zoom factor, the band is the samplerate divided by it.
+void SpectrumDock::setZoom(bool zoom, double center, unsigned int factor) {
+    this->zoomCheckBox->setChecked(zoom);
+    this->zoomCenterSiSpinBox->setValue(center);
+    int index = this->zoomFactorComboBox->findData(factor);
+    if (index != -1) this->zoomFactorComboBox->setCurrentIndex(index);
+    this->zoomCenterSiSpinBox->setEnabled(zoom);
+    this->zoomFactorComboBox->setEnabled(zoom);
+}
+
 /// \brief Called when the source combo box changes it's value.
 /// \param index The index of the combo box item.
 void SpectrumDock::magnitudeSelected(int index) {
@@ -132,3 +163,21 @@ void SpectrumDock::usedSwitched(bool checked) {
         emit usedChanged(channel, checked);
     }
 }
+
+/// \brief Called when the zoom checkbox is switched.
+/// \param checked The check-state of the checkbox.
+void SpectrumDock::zoomSwitched(bool checked) {
+    settings->scope.spectrumZoom = checked;
+    this->zoomCenterSiSpinBox->setEnabled(checked);
+    this->zoomFactorComboBox->setEnabled(checked);
+}
+
+/// \brief Called when the zoom center spinbox changes its value.
+/// \param center The center frequency in Hz.
+void SpectrumDock::zoomCenterSelected(double center) { settings->scope.spectrumZoomCenter = center; }
+
+/// \brief Called when the zoom factor combo box changes its value.
+/// \param index The index of the combo box item.
+void SpectrumDock::zoomFactorSelected(int index) {
+    settings->scope.spectrumZoomFactor = this->zoomFactorComboBox->itemData(index).toUInt();
+}
@@ -28,6 +28,7 @@ class SpectrumDock : public QDockWidget {
 
     int setMagnitude(int channel, double magnitude);
     int setUsed(int channel, bool used);
+    void setZoom(bool zoom, double center, unsigned int factor);
 
   protected:
     void closeEvent(QCloseEvent *event);
@@ -36,6 +37,9 @@ class SpectrumDock : public QDockWidget {
     QWidget *dockWidget;                  ///< The main widget for the dock window
     QList<QCheckBox *> usedCheckBox;      ///< Enable/disable spectrum for a channel
     QList<QComboBox *> magnitudeComboBox; ///< Select the vertical magnitude for the spectrums
+    QCheckBox *zoomCheckBox;              ///< Enable/disable the zoomed spectrum
+    SiSpinBox *zoomCenterSiSpinBox;       ///< Select the center frequency of the zoomed spectrum
+    QComboBox *zoomFactorComboBox;        ///< Select the zoom factor of the zoomed spectrum
 
     DsoSettings *settings; ///< The settings provided by the parent class
 
@@ -45,6 +49,9 @@ class SpectrumDock : public QDockWidget {
   public slots:
     void magnitudeSelected(int index);
     void usedSwitched(bool checked);
+    void zoomSwitched(bool checked);
+    void zoomCenterSelected(double center);
+    void zoomFactorSelected(int index);
 
   signals:
     void magnitudeChanged(unsigned int channel, double magnitude); ///< A magnitude has been selected
@@ -4,6 +4,7 @@
 #include <QCloseEvent>
 #include <QComboBox>
 #include <QDockWidget>
+#include <QDoubleSpinBox>
 #include <QLabel>
 
 #include <cmath>
@@ -48,6 +49,37 @@ TriggerDock::TriggerDock(DsoSettings *settings, const QStringList *specialTrigge
     this->sourceComboBox->addItems(this->sourceStandardStrings);
     this->sourceComboBox->addItems(this->sourceSpecialStrings);
 
+    this->hysteresisLabel = new QLabel(tr("Hysteresis"));
+    this->hysteresisSpinBox = new QDoubleSpinBox();
+    this->hysteresisSpinBox->setRange(0.0, 2.0);
+    this->hysteresisSpinBox->setSingleStep(0.05);
+    this->hysteresisSpinBox->setSuffix(tr(" div"));
+    this->hysteresisSpinBox->setToolTip(tr("The signal has to leave the level by this distance before the software "
+                                           "trigger accepts the next edge"));
+
+    this->typeLabel = new QLabel(tr("Type"));
+    this->typeComboBox = new QComboBox();
+    for (int type = Dso::TRIGGERTYPE_EDGE; type < Dso::TRIGGERTYPE_COUNT; ++type)
+        this->typeComboBox->addItem(Dso::triggerTypeString((Dso::TriggerType)type));
+
+    this->heightLabel = new QLabel(tr("Upper level"));
+    this->heightSpinBox = new QDoubleSpinBox();
+    this->heightSpinBox->setRange(0.0, 8.0);
+    this->heightSpinBox->setSingleStep(0.1);
+    this->heightSpinBox->setSuffix(tr(" div"));
+    this->heightSpinBox->setToolTip(tr("The distance of the upper level of runt and window triggers above the "
+                                       "trigger level"));
+
+    this->durationLabel = new QLabel(tr("Duration"));
+    this->durationSiSpinBox = new SiSpinBox(UNIT_SECONDS);
+    this->durationSiSpinBox->setMinimum(1e-9);
+    this->durationSiSpinBox->setMaximum(1e3);
+    this->durationSiSpinBox->setToolTip(tr("The pulse width or the timeout"));
+    this->shorterCheckBox = new QCheckBox(tr("Shorter pulses"));
+    this->sincCheckBox = new QCheckBox(tr("Sin(x)/x alignment"));
+    this->sincCheckBox->setToolTip(tr("Interpolate the trigger point with sin(x)/x, so the graphs stay in place even "
+                                      "with few samples per period"));
+
     this->dockLayout = new QGridLayout();
     this->dockLayout->setColumnMinimumWidth(0, 64);
     this->dockLayout->setColumnStretch(1, 1);
@@ -57,6 +89,16 @@ TriggerDock::TriggerDock(DsoSettings *settings, const QStringList *specialTrigge
     this->dockLayout->addWidget(this->sourceComboBox, 1, 1);
     this->dockLayout->addWidget(this->slopeLabel, 2, 0);
     this->dockLayout->addWidget(this->slopeComboBox, 2, 1);
+    this->dockLayout->addWidget(this->hysteresisLabel, 3, 0);
+    this->dockLayout->addWidget(this->hysteresisSpinBox, 3, 1);
+    this->dockLayout->addWidget(this->typeLabel, 4, 0);
+    this->dockLayout->addWidget(this->typeComboBox, 4, 1);
+    this->dockLayout->addWidget(this->heightLabel, 5, 0);
+    this->dockLayout->addWidget(this->heightSpinBox, 5, 1);
+    this->dockLayout->addWidget(this->durationLabel, 6, 0);
+    this->dockLayout->addWidget(this->durationSiSpinBox, 6, 1);
+    this->dockLayout->addWidget(this->shorterCheckBox, 7, 1);
+    this->dockLayout->addWidget(this->sincCheckBox, 8, 1);
 
     this->dockWidget = new QWidget();
     SetupDockWidget(this, dockWidget, dockLayout);
@@ -65,11 +107,24 @@ TriggerDock::TriggerDock(DsoSettings *settings, const QStringList *specialTrigge
     connect(this->modeComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(modeSelected(int)));
     connect(this->slopeComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(slopeSelected(int)));
     connect(this->sourceComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(sourceSelected(int)));
+    connect(this->hysteresisSpinBox, SIGNAL(valueChanged(double)), this, SLOT(hysteresisSelected(double)));
+    connect(this->typeComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(typeSelected(int)));
+    connect(this->heightSpinBox, SIGNAL(valueChanged(double)), this, SLOT(heightSelected(double)));
+    connect(this->durationSiSpinBox, SIGNAL(valueChanged(double)), this, SLOT(durationSelected(double)));
+    connect(this->shorterCheckBox, SIGNAL(toggled(bool)), this, SLOT(shorterToggled(bool)));
+    connect(this->sincCheckBox, SIGNAL(toggled(bool)), this, SLOT(sincToggled(bool)));
 
     // Set values
     this->setMode(settings->scope.trigger.mode);
     this->setSlope(settings->scope.trigger.slope);
     this->setSource(settings->scope.trigger.special, settings->scope.trigger.source);
+    this->hysteresisSpinBox->setValue(settings->scope.trigger.hysteresis);
+    this->typeComboBox->setCurrentIndex(settings->scope.trigger.type);
+    this->heightSpinBox->setValue(settings->scope.trigger.height);
+    this->durationSiSpinBox->setValue(settings->scope.trigger.duration);
+    this->shorterCheckBox->setChecked(settings->scope.trigger.shorter);
+    this->sincCheckBox->setChecked(settings->scope.trigger.sinc);
+    this->updateSoftwareTrigger();
 }
 
 /// \brief Cleans up everything.
@@ -123,10 +178,24 @@ int TriggerDock::setSource(bool special, unsigned int id) {
     return index;
 }
 
+/// \brief Enables the settings that are used by the selected software trigger.
+void TriggerDock::updateSoftwareTrigger() {
+    const bool software = settings->scope.trigger.mode == Dso::TRIGGERMODE_SOFTWARE;
+    const Dso::TriggerType type = settings->scope.trigger.type;
+    this->hysteresisSpinBox->setEnabled(software);
+    this->typeComboBox->setEnabled(software);
+    this->sincCheckBox->setEnabled(software);
+    this->heightSpinBox->setEnabled(software && (type == Dso::TRIGGERTYPE_RUNT || type == Dso::TRIGGERTYPE_WINDOW));
+    this->durationSiSpinBox->setEnabled(software &&
+                                        (type == Dso::TRIGGERTYPE_PULSEWIDTH || type == Dso::TRIGGERTYPE_TIMEOUT));
+    this->shorterCheckBox->setEnabled(software && type == Dso::TRIGGERTYPE_PULSEWIDTH);
+}
+
 /// \brief Called when the mode combo box changes it's value.
 /// \param index The index of the combo box item.
 void TriggerDock::modeSelected(int index) {
     settings->scope.trigger.mode = (Dso::TriggerMode)index;
+    this->updateSoftwareTrigger();
     emit modeChanged(settings->scope.trigger.mode);
 }
 
@@ -152,3 +221,30 @@ void TriggerDock::sourceSelected(int index) {
     settings->scope.trigger.special = special;
     emit sourceChanged(special, id);
 }
+
+/// \brief Called when the hysteresis spin box changes it's value.
+/// \param hysteresis The hysteresis of the software trigger in divs.
+void TriggerDock::hysteresisSelected(double hysteresis) { settings->scope.trigger.hysteresis = hysteresis; }
+
+/// \brief Called when the software trigger type combo box changes it's value.
+/// \param index The index of the combo box item.
+void TriggerDock::typeSelected(int index) {
+    settings->scope.trigger.type = (Dso::TriggerType)index;
+    this->updateSoftwareTrigger();
+}
+
+/// \brief Called when the upper level spin box changes it's value.
+/// \param height The distance of the upper level above the trigger level in divs.
+void TriggerDock::heightSelected(double height) { settings->scope.trigger.height = height; }
+
+/// \brief Called when the duration spin box changes it's value.
+/// \param duration The pulse width or timeout in s.
+void TriggerDock::durationSelected(double duration) { settings->scope.trigger.duration = duration; }
+
+/// \brief Called when the shorter pulses check box is toggled.
+/// \param shorter true to trigger on pulses shorter than the duration.
+void TriggerDock::shorterToggled(bool shorter) { settings->scope.trigger.shorter = shorter; }
+
+/// \brief Called when the sin(x)/x alignment check box is toggled.
+/// \param sinc true to interpolate the trigger point with sin(x)/x.
+void TriggerDock::sincToggled(bool sinc) { settings->scope.trigger.sinc = sinc; }
@@ -11,6 +11,7 @@
 class QLabel;
 class QCheckBox;
 class QComboBox;
+class QDoubleSpinBox;
 
 class SiSpinBox;
 
@@ -32,14 +33,24 @@ class TriggerDock : public QDockWidget {
   protected:
     void closeEvent(QCloseEvent *event);
 
-    QGridLayout *dockLayout;   ///< The main layout for the dock window
-    QWidget *dockWidget;       ///< The main widget for the dock window
-    QLabel *modeLabel;         ///< The label for the trigger mode combobox
-    QLabel *sourceLabel;       ///< The label for the trigger source combobox
-    QLabel *slopeLabel;        ///< The label for the trigger slope combobox
-    QComboBox *modeComboBox;   ///< Select the triggering mode
-    QComboBox *sourceComboBox; ///< Select the source for triggering
-    QComboBox *slopeComboBox;  ///< Select the slope that causes triggering
+    QGridLayout *dockLayout;           ///< The main layout for the dock window
+    QWidget *dockWidget;               ///< The main widget for the dock window
+    QLabel *modeLabel;                 ///< The label for the trigger mode combobox
+    QLabel *sourceLabel;               ///< The label for the trigger source combobox
+    QLabel *slopeLabel;                ///< The label for the trigger slope combobox
+    QLabel *hysteresisLabel;           ///< The label for the hysteresis spinbox
+    QLabel *typeLabel;                 ///< The label for the software trigger type combobox
+    QLabel *heightLabel;               ///< The label for the upper level spinbox
+    QLabel *durationLabel;             ///< The label for the duration spinbox
+    QComboBox *modeComboBox;           ///< Select the triggering mode
+    QComboBox *sourceComboBox;         ///< Select the source for triggering
+    QComboBox *slopeComboBox;          ///< Select the slope that causes triggering
+    QDoubleSpinBox *hysteresisSpinBox; ///< Select the hysteresis of the software trigger
+    QComboBox *typeComboBox;           ///< Select the condition of the software trigger
+    QDoubleSpinBox *heightSpinBox;     ///< Select the upper level of runt and window triggers
+    SiSpinBox *durationSiSpinBox;      ///< Select the pulse width or timeout
+    QCheckBox *shorterCheckBox;        ///< Trigger on shorter pulses instead of longer ones
+    QCheckBox *sincCheckBox;           ///< Align the trigger point with sin(x)/x instead of linearly
 
     DsoSettings *settings; ///< The settings provided by the parent class
 
@@ -48,10 +59,19 @@ class TriggerDock : public QDockWidget {
     QStringList sourceSpecialStrings;  ///< Strings for the special trigger sources
     QStringList slopeStrings;          ///< Strings for the trigger slopes
 
+  private:
+    void updateSoftwareTrigger();
+
   protected slots:
     void modeSelected(int index);
     void slopeSelected(int index);
     void sourceSelected(int index);
+    void hysteresisSelected(double hysteresis);
+    void typeSelected(int index);
+    void heightSelected(double height);
+    void durationSelected(double duration);
+    void shorterToggled(bool shorter);
+    void sincToggled(bool sinc);
 
   signals:
     void modeChanged(Dso::TriggerMode);                ///< The trigger mode has been changed
@@ -124,7 +124,7 @@ int VoltageDock::setGain(int channel, double gain) {
 /// \param mode The math-mode.
 /// \return Index of math-mode, -1 on error.
 int VoltageDock::setMode(Dso::MathMode mode) {
-    if (mode >= Dso::MATHMODE_1ADD2 && mode <= Dso::MATHMODE_2SUB1) {
+    if (mode >= Dso::MATHMODE_1ADD2 && mode < Dso::MATHMODE_COUNT) {
         this->miscComboBox[settings->scope.physicalChannels]->setCurrentIndex(mode);
         return mode;
     }
@@ -5,6 +5,9 @@
 #include <QFileDialog>
 #include <QGridLayout>
 #include <QLabel>
+#include <QSignalBlocker>
+#include <QStringList>
+#include <QTime>
 #include <QTimer>
 
 #include "dsowidget.h"
@@ -15,12 +18,26 @@
 #include "hantek/definitions.h"
 #include "settings.h"
 #include "utils/dsoStrings.h"
+#include "utils/instrumentation.h"
 #include "utils/printutils.h"
 #include "widgets/levelslider.h"
 
+namespace {
+/// \brief Compares two measured values, NaN stands for a missing value and equals itself.
+bool sameValue(double a, double b) { return a == b || (std::isnan(a) && std::isnan(b)); }
+
+/// \brief Compares the measured values element by element, see sameValue().
+template <size_t N> bool sameValues(const std::array<double, N> &a, const std::array<double, N> &b) {
+    for (size_t index = 0; index < N; ++index)
+        if (!sameValue(a[index], b[index])) return false;
+    return true;
+}
+}
+
 DsoWidget::DsoWidget(DsoSettings *settings, QWidget *parent, Qt::WindowFlags flags)
     : QWidget(parent, flags), settings(settings), generator(new GlGenerator(&settings->scope, &settings->view)),
-      mainScope(new GlScope(settings, generator)), zoomScope(new GlScope(settings, generator)) {
+      mainScope(new GlScope(settings, generator, &references, &shared)),
+      zoomScope(new GlScope(settings, generator, &references, &shared)) {
 
     // Palette for this widget
     QPalette palette;
@@ -29,6 +46,11 @@ DsoWidget::DsoWidget(DsoSettings *settings, QWidget *parent, Qt::WindowFlags fla
 
     // The OpenGL accelerated scope widgets
     zoomScope->setZoomMode(true);
+    // The main scope is always shown, the zoomed one shares its context
+    connect(mainScope, &GlScope::spectrumComputeAvailable, this, &DsoWidget::spectrumComputeAvailable);
+    generatorThread.setObjectName("generatorThread");
+    generator->moveToThread(&generatorThread);
+    generatorThread.start();
 
     // The offset sliders for all possible channels
     offsetSlider = new LevelSlider(Qt::RightArrow);
@@ -136,6 +158,8 @@ DsoWidget::DsoWidget(DsoSettings *settings, QWidget *parent, Qt::WindowFlags fla
     measurementLayout->setColumnStretch(3, 2);
     measurementLayout->setColumnStretch(4, 3);
     measurementLayout->setColumnStretch(5, 3);
+    measurementLayout->setColumnStretch(6, 12);
+    shownMeasurements.resize(settings->scope.voltage.count());
     for (int channel = 0; channel < settings->scope.voltage.count(); ++channel) {
         tablePalette.setColor(QPalette::WindowText, settings->view.screen.voltage[channel]);
         measurementNameLabel.append(new QLabel(settings->scope.voltage[channel].name));
@@ -155,6 +179,8 @@ DsoWidget::DsoWidget(DsoSettings *settings, QWidget *parent, Qt::WindowFlags fla
         measurementFrequencyLabel.append(new QLabel());
         measurementFrequencyLabel[channel]->setAlignment(Qt::AlignRight);
         measurementFrequencyLabel[channel]->setPalette(palette);
+        measurementDetailsLabel.append(new QLabel());
+        measurementDetailsLabel[channel]->setPalette(palette);
         setMeasurementVisible(channel, settings->scope.voltage[channel].used);
         measurementLayout->addWidget(measurementNameLabel[channel], channel, 0);
         measurementLayout->addWidget(measurementMiscLabel[channel], channel, 1);
@@ -162,6 +188,7 @@ DsoWidget::DsoWidget(DsoSettings *settings, QWidget *parent, Qt::WindowFlags fla
         measurementLayout->addWidget(measurementMagnitudeLabel[channel], channel, 3);
         measurementLayout->addWidget(measurementAmplitudeLabel[channel], channel, 4);
         measurementLayout->addWidget(measurementFrequencyLabel[channel], channel, 5);
+        measurementLayout->addWidget(measurementDetailsLabel[channel], channel, 6);
         if ((unsigned int)channel < settings->scope.physicalChannels)
             updateVoltageCoupling(channel);
         else
@@ -212,14 +239,21 @@ DsoWidget::DsoWidget(DsoSettings *settings, QWidget *parent, Qt::WindowFlags fla
     connect(offsetSlider, &LevelSlider::valueChanged, this, &DsoWidget::updateOffset);
     connect(triggerPositionSlider, &LevelSlider::valueChanged, this, &DsoWidget::updateTriggerPosition);
     connect(triggerLevelSlider, &LevelSlider::valueChanged, this, &DsoWidget::updateTriggerLevel);
+    connect(&measurementThrottle, &UpdateThrottle::update, this, &DsoWidget::updateMeasurements);
     connect(markerSlider, &LevelSlider::valueChanged, [this](int index, double value) {
         updateMarker(index, value);
-        mainScope->update();
-        zoomScope->update();
+        mainScope->requestRender();
+        zoomScope->requestRender();
     });
 }
 
-void DsoWidget::showNewData(std::unique_ptr<DataAnalyzerResult> data) {
+DsoWidget::~DsoWidget() {
+    generatorThread.quit();
+    generatorThread.wait();
+    delete generator;
+}
+
+void DsoWidget::showNewData(std::shared_ptr<const DataAnalyzerResult> data) {
     if (!data) return;
     this->data = std::move(data);
     emit doShowNewData();
@@ -241,11 +275,14 @@ void DsoWidget::setMeasurementVisible(unsigned int channel, bool visible) {
     measurementMagnitudeLabel[channel]->setVisible(visible);
     measurementAmplitudeLabel[channel]->setVisible(visible);
     measurementFrequencyLabel[channel]->setVisible(visible);
+    measurementDetailsLabel[channel]->setVisible(visible);
     if (!visible) {
         measurementGainLabel[channel]->setText(QString());
         measurementMagnitudeLabel[channel]->setText(QString());
         measurementAmplitudeLabel[channel]->setText(QString());
         measurementFrequencyLabel[channel]->setText(QString());
+        measurementDetailsLabel[channel]->setText(QString());
+        shownMeasurements[channel].valid = false;
     }
 }
 
@@ -400,9 +437,45 @@ void DsoWidget::updateVoltageUsed(unsigned int channel, bool used) {
     updateVoltageDetails(channel);
 }
 
+void DsoWidget::showSettings() {
+    {
+        QSignalBlocker offsetBlocker(offsetSlider);
+        QSignalBlocker positionBlocker(triggerPositionSlider);
+        QSignalBlocker levelBlocker(triggerLevelSlider);
+        QSignalBlocker markerBlocker(markerSlider);
+        const int voltageCount = settings->scope.voltage.count();
+        for (int channel = 0; channel < voltageCount; ++channel) {
+            offsetSlider->setValue(channel, settings->scope.voltage[channel].offset);
+            offsetSlider->setValue(voltageCount + channel, settings->scope.spectrum[channel].offset);
+        }
+        triggerPositionSlider->setValue(0, settings->scope.trigger.position);
+        for (unsigned int channel = 0; channel < settings->scope.physicalChannels; ++channel) {
+            adaptTriggerLevelSlider(channel);
+            triggerLevelSlider->setValue((int)channel, settings->scope.voltage[(int)channel].trigger);
+        }
+        for (int marker = 0; marker < MARKER_COUNT; ++marker)
+            markerSlider->setValue(marker, settings->scope.horizontal.marker[marker]);
+    }
+
+    for (unsigned int channel = 0; channel < (unsigned int)settings->scope.voltage.count(); ++channel) {
+        if (channel < settings->scope.physicalChannels) updateVoltageCoupling(channel);
+        updateVoltageUsed(channel, settings->scope.voltage[(int)channel].used);
+        updateVoltageGain(channel);
+        updateSpectrumUsed(channel, settings->scope.spectrum[(int)channel].used);
+    }
+    updateMathMode();
+    updateTriggerSource();
+    updateFrequencybase(settings->scope.horizontal.frequencybase);
+    updateSamplerate(settings->scope.horizontal.samplerate);
+    updateTimebase(settings->scope.horizontal.timebase);
+    mainScope->requestRender();
+    zoomScope->requestRender();
+}
+
 /// \brief Change the record length.
 void DsoWidget::updateRecordLength(unsigned long size) {
     settingsRecordLengthLabel->setText(valueToString(size, UNIT_SAMPLES, 4));
+    shownRecordLength = size;
 }
 
 /// \brief Export the oscilloscope screen to a file.
@@ -431,26 +504,122 @@ void DsoWidget::updateZoom(bool enabled) {
     repaint();
 }
 
+/// \brief Formats the value of an automatic measurement.
+/// \param measurement The measurement.
+/// \param value The value of the measurement.
+/// \return The value with its unit.
+QString DsoWidget::measurementValueString(Dso::Measurement measurement, double value) {
+    switch (measurement) {
+    case Dso::MEASUREMENT_RISETIME:
+    case Dso::MEASUREMENT_FALLTIME:
+    case Dso::MEASUREMENT_PERIOD:
+        return valueToString(value, UNIT_SECONDS, 4);
+    case Dso::MEASUREMENT_DUTYCYCLE:
+    case Dso::MEASUREMENT_OVERSHOOT:
+        return tr("%L1 %").arg(value, 0, 'f', 1);
+    case Dso::MEASUREMENT_PHASE:
+        return tr("%L1°").arg(value, 0, 'f', 1);
+    default:
+        return valueToString(value, UNIT_VOLTS, 4);
+    }
+}
+
+/// \brief Formats the automatic measurements of a channel.
+/// \param channelData The analyzed data of the channel, the NaN measurements are skipped.
+/// \return The names and values of the measurements, followed by the voltage step between the markers.
+QString DsoWidget::measurementsToString(const DataChannel *channelData) {
+    QStringList values;
+    for (int measurement = 0; measurement < Dso::MEASUREMENT_COUNT; ++measurement) {
+        const double value = channelData->measurements[measurement];
+        if (std::isnan(value)) continue;
+        values << Dso::measurementString((Dso::Measurement)measurement) + " " +
+                      measurementValueString((Dso::Measurement)measurement, value);
+    }
+    // The difference of the voltages at the markers, read in the same pass as the measurements
+    const double markerDelta = channelData->markerVoltages[1] - channelData->markerVoltages[0];
+    if (!std::isnan(markerDelta)) values << QChar(0x394) + QString("V ") + valueToString(markerDelta, UNIT_VOLTS, 4);
+    return values.join("  ");
+}
+
+/// \brief Formats the statistics of the automatic measurements of a channel as table.
+/// \param channelData The analyzed data of the channel, measurements without values are skipped.
+/// \return The rich text table.
+QString DsoWidget::measurementStatisticsToString(const DataChannel *channelData) {
+    QString table = "<table><tr><th></th><th>" + tr("Mean") + "</th><th>" + tr("Deviation") + "</th><th>" +
+                    tr("Min") + "</th><th>" + tr("Max") + "</th>";
+    for (double percentile : RunningStatistics::PERCENTILES)
+        table += "<th>" + tr("P%1").arg(percentile * 100) + "</th>";
+    table += "<th>" + tr("Count") + "</th></tr>";
+
+    for (int measurement = 0; measurement < Dso::MEASUREMENT_COUNT; ++measurement) {
+        const RunningStatistics::Summary &summary = channelData->measurementStatistics[measurement];
+        if (summary.count == 0) continue;
+        auto cell = [measurement](double value) {
+            return "<td align=right>" + measurementValueString((Dso::Measurement)measurement, value) + "</td>";
+        };
+        table += "<tr><td>" + Dso::measurementString((Dso::Measurement)measurement) + "</td>" + cell(summary.mean) +
+                 cell(summary.deviation) + cell(summary.minimum) + cell(summary.maximum);
+        for (double percentile : summary.percentiles) table += cell(percentile);
+        table += "<td align=right>" + QString::number(summary.count) + "</td></tr>";
+    }
+    return table + "</table>";
+}
+
+bool DsoWidget::storeReference(unsigned int slot, unsigned int channel) {
+    std::shared_ptr<const GlGraphs> graphs = generator->graphs();
+    if (!graphs || channel >= (unsigned)settings->scope.voltage.count()) return false;
+    std::shared_ptr<ReferenceWaveform> waveform =
+        ReferenceWaveforms::fromGraph(graphs->channel(Dso::CHANNELMODE_VOLTAGE, (int)channel, 0), channel,
+                                      &settings->scope);
+    if (!waveform) return false;
+    waveform->name = tr("%1 at %2").arg(settings->scope.voltage[(int)channel].name,
+                                       QTime::currentTime().toString("hh:mm:ss"));
+    references.set(slot, std::move(waveform));
+    return true;
+}
+
 /// \brief Prints analyzed data.
 void DsoWidget::doShowNewData() {
-    if (exportNextFrame) {
-        exportNextFrame->exportSamples(data.get());
-        exportNextFrame.reset(nullptr);
-    }
+    Instrumentation::count(Instrumentation::COUNTER_DISPLAYED);
+
+    if (exportNextFrame) exportQueue.enqueue(std::move(exportNextFrame), data);
 
-    generator->generateGraphs(data.get());
+    generator->requestGraphs(data);
 
-    updateRecordLength(data.get()->getMaxSamples());
+    // Nobody reads the numbers faster than the screen shows them
+    measurementThrottle.request();
+}
+
+/// \brief Prints the measurements of the latest frame, only the changed values are formatted again.
+void DsoWidget::updateMeasurements() {
+    if (!data) return;
+
+    if (data->getMaxSamples() != shownRecordLength) updateRecordLength(data->getMaxSamples());
 
     for (int channel = 0; channel < settings->scope.voltage.count(); ++channel) {
-        if (settings->scope.voltage[channel].used && data.get()->data(channel)) {
+        const DataChannel *channelData = data->data(channel);
+        if (!settings->scope.voltage[channel].used || !channelData) continue;
+
+        ShownMeasurements &shown = shownMeasurements[channel];
+        if (!shown.valid || !sameValue(shown.amplitude, channelData->amplitude)) {
             // Amplitude string representation (4 significant digits)
-            measurementAmplitudeLabel[channel]->setText(
-                valueToString(data.get()->data(channel)->amplitude, UNIT_VOLTS, 4));
+            measurementAmplitudeLabel[channel]->setText(valueToString(channelData->amplitude, UNIT_VOLTS, 4));
+            shown.amplitude = channelData->amplitude;
+        }
+        if (!shown.valid || !sameValue(shown.frequency, channelData->frequency)) {
             // Frequency string representation (5 significant digits)
-            measurementFrequencyLabel[channel]->setText(
-                valueToString(data.get()->data(channel)->frequency, UNIT_HERTZ, 5));
+            measurementFrequencyLabel[channel]->setText(valueToString(channelData->frequency, UNIT_HERTZ, 5));
+            shown.frequency = channelData->frequency;
+        }
+        if (!shown.valid || !sameValues(shown.measurements, channelData->measurements) ||
+            !sameValues(shown.markerVoltages, channelData->markerVoltages)) {
+            measurementDetailsLabel[channel]->setText(measurementsToString(channelData));
+            shown.measurements = channelData->measurements;
+            shown.markerVoltages = channelData->markerVoltages;
         }
+        // The statistics grow with every frame
+        measurementDetailsLabel[channel]->setToolTip(measurementStatisticsToString(channelData));
+        shown.valid = true;
     }
 }
 
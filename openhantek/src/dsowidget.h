@@ -5,11 +5,18 @@
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QList>
+#include <QThread>
+#include <array>
 #include <memory>
+#include <vector>
 
 #include "exporter.h"
+#include "exportqueue.h"
 #include "glscope.h"
+#include "glsharedresources.h"
 #include "levelslider.h"
+#include "referencewaveforms.h"
+#include "updatethrottle.h"
 
 class DataAnalyzer;
 class DsoSettings;
@@ -28,15 +35,41 @@ class DsoWidget : public QWidget {
     /// \param parent The parent widget.
     /// \param flags Flags for the window manager.
     DsoWidget(DsoSettings *settings, QWidget *parent = 0, Qt::WindowFlags flags = 0);
-    void showNewData(std::unique_ptr<DataAnalyzerResult> data);
+    ~DsoWidget();
+    void showNewData(std::shared_ptr<const DataAnalyzerResult> data);
+    /// \brief Gets the queue that writes the exports in the background.
+    ExportQueue &getExportQueue() { return exportQueue; }
+    /// \brief Gets the reference waveforms that are drawn with the live graphs.
+    ReferenceWaveforms &getReferences() { return references; }
+    /// \brief Stores the shown graph of a channel as reference waveform.
+    /// \param slot The slot of the reference, it has to be less than ReferenceWaveforms::COUNT.
+    /// \param channel The voltage channel.
+    /// \return false, if the channel has no graph.
+    bool storeReference(unsigned int slot, unsigned int channel);
+    /// \brief Shows all settings again after they were replaced, e.g. by a snapshot.
+    /// The sliders are moved without sending their values back.
+    void showSettings();
 
   protected:
+    /// \brief The values a line of the measurement table was formatted from.
+    struct ShownMeasurements {
+        bool valid = false;                                      ///< false, if the labels have to be formatted
+        double amplitude = 0.0;                                  ///< The amplitude of the signal
+        double frequency = 0.0;                                  ///< The frequency of the signal
+        std::array<double, Dso::MEASUREMENT_COUNT> measurements; ///< The automatic measurements
+        std::array<double, MARKER_COUNT> markerVoltages;         ///< The voltages at the markers
+    };
+
     void adaptTriggerLevelSlider(unsigned int channel);
     void setMeasurementVisible(unsigned int channel, bool visible);
     void updateMarkerDetails();
     void updateSpectrumDetails(unsigned int channel);
     void updateTriggerDetails();
     void updateVoltageDetails(unsigned int channel);
+    void updateMeasurements();
+    static QString measurementValueString(Dso::Measurement measurement, double value);
+    static QString measurementsToString(const DataChannel *channelData);
+    static QString measurementStatisticsToString(const DataChannel *channelData);
 
     QGridLayout *mainLayout;            ///< The main layout for this widget
     LevelSlider *offsetSlider;          ///< The sliders for the graph offsets
@@ -65,13 +98,21 @@ class DsoWidget : public QWidget {
     QList<QLabel *> measurementMiscLabel;      ///< Coupling or math mode
     QList<QLabel *> measurementAmplitudeLabel; ///< Amplitude of the signal (V)
     QList<QLabel *> measurementFrequencyLabel; ///< Frequency of the signal (Hz)
-
-    DsoSettings *settings;  ///< The settings provided by the main window
-    GlGenerator *generator; ///< The generator for the OpenGL vertex arrays
-    GlScope *mainScope;     ///< The main scope screen
-    GlScope *zoomScope;     ///< The optional magnified scope screen
-    std::unique_ptr<Exporter> exportNextFrame;
-    std::unique_ptr<DataAnalyzerResult> data;
+    QList<QLabel *> measurementDetailsLabel;   ///< The enabled automatic measurements
+
+    DsoSettings *settings;         ///< The settings provided by the main window
+    GlGenerator *generator;        ///< The generator for the OpenGL vertex arrays
+    QThread generatorThread;       ///< Generates the graphs, so deep records don't block the gui
+    ReferenceWaveforms references; ///< The stored waveforms, both scopes draw them
+    GlSharedResources shared;      ///< The textures and buffers both scopes draw
+    GlScope *mainScope;            ///< The main scope screen
+    GlScope *zoomScope;            ///< The optional magnified scope screen
+    std::unique_ptr<Exporter> exportNextFrame;        ///< Queued with the next frame
+    ExportQueue exportQueue;                          ///< Writes the exports in the background
+    std::shared_ptr<const DataAnalyzerResult> data;   ///< The frame that is shown
+    UpdateThrottle measurementThrottle;               ///< Limits the measurement table to the display refresh
+    std::vector<ShownMeasurements> shownMeasurements; ///< The values in the measurement table per channel
+    unsigned long shownRecordLength = 0;              ///< The record length in the settings table
   public slots:
     // Horizontal axis
     // void horizontalFormatChanged(HorizontalFormat format);
@@ -120,4 +161,5 @@ class DsoWidget : public QWidget {
     void triggerPositionChanged(double value);                    ///< The pretrigger has been changed
     void triggerLevelChanged(unsigned int channel, double value); ///< A trigger level has been changed
     void markerChanged(unsigned int marker, double value);        ///< A marker position has been changed
+    void spectrumComputeAvailable(bool available);                ///< The scopes can calculate the spectra
 };
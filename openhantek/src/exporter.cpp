@@ -2,7 +2,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <string>
 
 #include <QCoreApplication>
 #include <QFile>
@@ -10,10 +13,10 @@
 #include <QImage>
 #include <QMutex>
 #include <QPainter>
-#include <QPixmap>
 #include <QPrintDialog>
 #include <QPrinter>
-#include <QTextStream>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include "exporter.h"
 
@@ -22,15 +25,84 @@
 #include "glgenerator.h"
 #include "settings.h"
 #include "utils/dsoStrings.h"
+#include "utils/floatformat.h"
 #include "utils/printutils.h"
 
 #define tr(msg) QCoreApplication::translate("Exporter", msg)
 
-Exporter::Exporter(DsoSettings *settings, const QString &filename, ExportFormat format)
-    : settings(settings), filename(filename), format(format) {}
+namespace {
+/// \brief Formats a block of rows of the CSV export.
+class FormatJob : public QRunnable {
+  public:
+    explicit FormatJob(std::function<void()> job) : job(job) {}
+
+    void run() override { job(); }
+
+  private:
+    std::function<void()> job;
+};
+
+static const int NPY_ALIGNMENT = 64; ///< The data of a NumPy file starts at a multiple of this offset
+
+/// \brief Gets the points of a trace, reduced to the extremes of every pixel column of the paint device.
+/// The minimum and maximum of a column are kept in the order of the samples, so the polyline covers the same
+/// pixels as the polyline through all samples. Traces with at most two samples per column are kept completely.
+/// \param graph The points in divs, the previous content is replaced.
+/// \param first The first visible sample.
+/// \param last The last visible sample.
+/// \param start The horizontal position of sample 0 in divs.
+/// \param step The horizontal distance between two samples in divs.
+/// \param pixelsPerDiv The pixel columns of the paint device in a div.
+/// \param value Gets the vertical position of a sample in divs.
+template <class Value>
+void tracePoints(std::vector<QPointF> &graph, unsigned first, unsigned last, double start, double step,
+                 double pixelsPerDiv, Value value) {
+    graph.clear();
+    if (step * pixelsPerDiv >= 0.5) {
+        graph.reserve(last - first + 1);
+        for (unsigned position = first; position <= last; ++position)
+            graph.push_back(QPointF(start + position * step, value(position)));
+        return;
+    }
+
+    graph.reserve((size_t)(2.0 * (last - first + 1) * step * pixelsPerDiv) + 4);
+    unsigned position = first;
+    while (position <= last) {
+        const double column = std::floor((start + position * step) * pixelsPerDiv);
+        unsigned minimumPosition = position, maximumPosition = position;
+        double minimum = value(position), maximum = minimum;
+        unsigned next = position + 1;
+        for (; next <= last && std::floor((start + next * step) * pixelsPerDiv) == column; ++next) {
+            const double level = value(next);
+            if (level < minimum) {
+                minimum = level;
+                minimumPosition = next;
+            } else if (level > maximum) {
+                maximum = level;
+                maximumPosition = next;
+            }
+        }
+        if (minimumPosition == maximumPosition) {
+            graph.push_back(QPointF(start + minimumPosition * step, minimum));
+        } else if (minimumPosition < maximumPosition) {
+            graph.push_back(QPointF(start + minimumPosition * step, minimum));
+            graph.push_back(QPointF(start + maximumPosition * step, maximum));
+        } else {
+            graph.push_back(QPointF(start + maximumPosition * step, maximum));
+            graph.push_back(QPointF(start + minimumPosition * step, minimum));
+        }
+        position = next;
+    }
+}
+}
+
+const unsigned Exporter::BLOCK_ROWS;
+
+Exporter::Exporter(const DsoSettings *settings, const QString &filename, ExportFormat format)
+    : options(settings->options), scope(settings->scope), view(settings->view), filename(filename), format(format) {}
 
 Exporter *Exporter::createPrintExporter(DsoSettings *settings) {
-    std::unique_ptr<QPrinter> printer = printPaintDevice(settings);
+    std::unique_ptr<QPrinter> printer = printPaintDevice(settings->view);
     // Show the printing dialog
     QPrintDialog dialog(printer.get());
     dialog.setWindowTitle(tr("Print oscillograph"));
@@ -44,7 +116,7 @@ Exporter *Exporter::createPrintExporter(DsoSettings *settings) {
 Exporter *Exporter::createSaveToFileExporter(DsoSettings *settings) {
     QStringList filters;
     filters << tr("Portable Document Format (*.pdf)") << tr("Image (*.png *.xpm *.jpg)")
-            << tr("Comma-Separated Values (*.csv)");
+            << tr("Comma-Separated Values (*.csv)") << tr("NumPy array (*.npy)");
 
     QFileDialog fileDialog(nullptr, tr("Export file..."), QString(), filters.join(";;"));
     fileDialog.setFileMode(QFileDialog::AnyFile);
@@ -55,35 +127,42 @@ Exporter *Exporter::createSaveToFileExporter(DsoSettings *settings) {
                         (ExportFormat)(EXPORT_FORMAT_PDF + filters.indexOf(fileDialog.selectedNameFilter())));
 }
 
-std::unique_ptr<QPrinter> Exporter::printPaintDevice(DsoSettings *settings) {
+Exporter *Exporter::createFileExporter(DsoSettings *settings, const QString &filename, ExportFormat format) {
+    return new Exporter(settings, filename, format);
+}
+
+QString Exporter::name() const { return format == EXPORT_FORMAT_PRINTER ? tr("the printer") : filename; }
+
+std::unique_ptr<QPrinter> Exporter::printPaintDevice(const DsoSettingsView &view) {
     // We need a QPrinter for printing, pdf- and ps-export
     std::unique_ptr<QPrinter> printer = std::unique_ptr<QPrinter>(new QPrinter(QPrinter::HighResolution));
-    printer->setOrientation(settings->view.zoom ? QPrinter::Portrait : QPrinter::Landscape);
+    printer->setOrientation(view.zoom ? QPrinter::Portrait : QPrinter::Landscape);
     printer->setPageMargins(20, 20, 20, 20, QPrinter::Millimeter);
     return printer;
 }
 
 bool Exporter::exportSamples(const DataAnalyzerResult *result) {
     if (this->format == EXPORT_FORMAT_CSV) { return exportCVS(result); }
+    if (this->format == EXPORT_FORMAT_NPY) return exportNPY(result);
 
     // Choose the color values we need
     DsoSettingsColorValues *colorValues;
-    if (this->format == EXPORT_FORMAT_IMAGE && settings->view.screenColorImages)
-        colorValues = &(settings->view.screen);
+    if (this->format == EXPORT_FORMAT_IMAGE && view.screenColorImages)
+        colorValues = &(view.screen);
     else
-        colorValues = &(settings->view.print);
+        colorValues = &(view.print);
 
     std::unique_ptr<QPaintDevice> paintDevice;
 
     if (this->format == EXPORT_FORMAT_IMAGE) {
-        // We need a QPixmap for image-export
-        QPixmap *qPixmap = new QPixmap(settings->options.imageSize);
-        qPixmap->fill(colorValues->background);
-        paintDevice = std::unique_ptr<QPaintDevice>(qPixmap);
+        // A QImage can be painted outside of the gui thread, unlike a QPixmap
+        QImage *image = new QImage(options.imageSize, QImage::Format_RGB32);
+        image->fill(colorValues->background);
+        paintDevice = std::unique_ptr<QPaintDevice>(image);
     } else if (this->format == EXPORT_FORMAT_PRINTER) {
         paintDevice = std::move(selectedPrinter);
     } else {
-        std::unique_ptr<QPrinter> printer = printPaintDevice(settings);
+        std::unique_ptr<QPrinter> printer = printPaintDevice(view);
         printer->setOutputFileName(this->filename);
         printer->setOutputFormat((this->format == EXPORT_FORMAT_PDF) ? QPrinter::PdfFormat : QPrinter::NativeFormat);
         paintDevice = std::move(printer);
@@ -105,13 +184,13 @@ bool Exporter::exportSamples(const DataAnalyzerResult *result) {
     double stretchBase = (double)(paintDevice->width() - lineHeight * 10) / 4;
 
     // Print trigger details
-    painter.setPen(colorValues->voltage[settings->scope.trigger.source]);
-    QString levelString = valueToString(settings->scope.voltage[settings->scope.trigger.source].trigger, UNIT_VOLTS, 3);
-    QString pretriggerString = tr("%L1%").arg((int)(settings->scope.trigger.position * 100 + 0.5));
+    painter.setPen(colorValues->voltage[scope.trigger.source]);
+    QString levelString = valueToString(scope.voltage[scope.trigger.source].trigger, UNIT_VOLTS, 3);
+    QString pretriggerString = tr("%L1%").arg((int)(scope.trigger.position * 100 + 0.5));
     painter.drawText(QRectF(0, 0, lineHeight * 10, lineHeight),
                      tr("%1  %2  %3  %4")
-                         .arg(settings->scope.voltage[settings->scope.trigger.source].name,
-                              Dso::slopeString(settings->scope.trigger.slope), levelString, pretriggerString));
+                         .arg(scope.voltage[scope.trigger.source].name,
+                              Dso::slopeString(scope.trigger.slope), levelString, pretriggerString));
 
     double scopeHeight;
 
@@ -122,46 +201,46 @@ bool Exporter::exportSamples(const DataAnalyzerResult *result) {
                          QTextOption(Qt::AlignRight));
         // Print samplerate
         painter.drawText(QRectF(lineHeight * 10 + stretchBase, 0, stretchBase, lineHeight),
-                         valueToString(settings->scope.horizontal.samplerate, UNIT_SAMPLES) + tr("/s"),
+                         valueToString(scope.horizontal.samplerate, UNIT_SAMPLES) + tr("/s"),
                          QTextOption(Qt::AlignRight));
         // Print timebase
         painter.drawText(QRectF(lineHeight * 10 + stretchBase * 2, 0, stretchBase, lineHeight),
-                         valueToString(settings->scope.horizontal.timebase, UNIT_SECONDS, 0) + tr("/div"),
+                         valueToString(scope.horizontal.timebase, UNIT_SECONDS, 0) + tr("/div"),
                          QTextOption(Qt::AlignRight));
         // Print frequencybase
         painter.drawText(QRectF(lineHeight * 10 + stretchBase * 3, 0, stretchBase, lineHeight),
-                         valueToString(settings->scope.horizontal.frequencybase, UNIT_HERTZ, 0) + tr("/div"),
+                         valueToString(scope.horizontal.frequencybase, UNIT_HERTZ, 0) + tr("/div"),
                          QTextOption(Qt::AlignRight));
 
         // Draw the measurement table
         stretchBase = (double)(paintDevice->width() - lineHeight * 6) / 10;
         int channelCount = 0;
-        for (int channel = settings->scope.voltage.count() - 1; channel >= 0; channel--) {
-            if ((settings->scope.voltage[channel].used || settings->scope.spectrum[channel].used) &&
+        for (int channel = scope.voltage.count() - 1; channel >= 0; channel--) {
+            if ((scope.voltage[channel].used || scope.spectrum[channel].used) &&
                 result->data(channel)) {
                 ++channelCount;
                 double top = (double)paintDevice->height() - channelCount * lineHeight;
 
                 // Print label
                 painter.setPen(colorValues->voltage[channel]);
-                painter.drawText(QRectF(0, top, lineHeight * 4, lineHeight), settings->scope.voltage[channel].name);
+                painter.drawText(QRectF(0, top, lineHeight * 4, lineHeight), scope.voltage[channel].name);
                 // Print coupling/math mode
-                if ((unsigned int)channel < settings->scope.physicalChannels)
+                if ((unsigned int)channel < scope.physicalChannels)
                     painter.drawText(QRectF(lineHeight * 4, top, lineHeight * 2, lineHeight),
-                                     Dso::couplingString((Dso::Coupling)settings->scope.voltage[channel].misc));
+                                     Dso::couplingString((Dso::Coupling)scope.voltage[channel].misc));
                 else
                     painter.drawText(QRectF(lineHeight * 4, top, lineHeight * 2, lineHeight),
-                                     Dso::mathModeString((Dso::MathMode)settings->scope.voltage[channel].misc));
+                                     Dso::mathModeString((Dso::MathMode)scope.voltage[channel].misc));
 
                 // Print voltage gain
                 painter.drawText(QRectF(lineHeight * 6, top, stretchBase * 2, lineHeight),
-                                 valueToString(settings->scope.voltage[channel].gain, UNIT_VOLTS, 0) + tr("/div"),
+                                 valueToString(scope.voltage[channel].gain, UNIT_VOLTS, 0) + tr("/div"),
                                  QTextOption(Qt::AlignRight));
                 // Print spectrum magnitude
-                if (settings->scope.spectrum[channel].used) {
+                if (scope.spectrum[channel].used) {
                     painter.setPen(colorValues->spectrum[channel]);
                     painter.drawText(QRectF(lineHeight * 6 + stretchBase * 2, top, stretchBase * 2, lineHeight),
-                                     valueToString(settings->scope.spectrum[channel].magnitude, UNIT_DECIBEL, 0) +
+                                     valueToString(scope.spectrum[channel].magnitude, UNIT_DECIBEL, 0) +
                                          tr("/div"),
                                      QTextOption(Qt::AlignRight));
                 }
@@ -183,12 +262,12 @@ bool Exporter::exportSamples(const DataAnalyzerResult *result) {
         painter.setPen(colorValues->text);
 
         // Calculate variables needed for zoomed scope
-        double divs = fabs(settings->scope.horizontal.marker[1] - settings->scope.horizontal.marker[0]);
-        double time = divs * settings->scope.horizontal.timebase;
+        double divs = fabs(scope.horizontal.marker[1] - scope.horizontal.marker[0]);
+        double time = divs * scope.horizontal.timebase;
         double zoomFactor = DIVS_TIME / divs;
-        double zoomOffset = (settings->scope.horizontal.marker[0] + settings->scope.horizontal.marker[1]) / 2;
+        double zoomOffset = (scope.horizontal.marker[0] + scope.horizontal.marker[1]) / 2;
 
-        if (settings->view.zoom) {
+        if (view.zoom) {
             scopeHeight = (double)(paintDevice->height() - (channelCount + 5) * lineHeight) / 2;
             double top = 2.5 * lineHeight + scopeHeight;
 
@@ -204,7 +283,7 @@ bool Exporter::exportSamples(const DataAnalyzerResult *result) {
                              valueToString(time / DIVS_TIME, UNIT_SECONDS, 3) + tr("/div"),
                              QTextOption(Qt::AlignRight));
             painter.drawText(QRectF(lineHeight * 10 + stretchBase * 3, top, stretchBase, lineHeight),
-                             valueToString(divs * settings->scope.horizontal.frequencybase / DIVS_TIME, UNIT_HERTZ, 3) +
+                             valueToString(divs * scope.horizontal.frequencybase / DIVS_TIME, UNIT_HERTZ, 3) +
                                  tr("/div"),
                              QTextOption(Qt::AlignRight));
         } else {
@@ -227,18 +306,21 @@ bool Exporter::exportSamples(const DataAnalyzerResult *result) {
         // Draw the graphs
         painter.setRenderHint(QPainter::Antialiasing);
         painter.setBrush(Qt::NoBrush);
+        std::vector<QPointF> graph;
 
-        for (int zoomed = 0; zoomed < (settings->view.zoom ? 2 : 1); ++zoomed) {
-            switch (settings->scope.horizontal.format) {
+        for (int zoomed = 0; zoomed < (view.zoom ? 2 : 1); ++zoomed) {
+            // The traces are reduced to the resolution of the paint device
+            const double pixelsPerDiv = (paintDevice->width() - 1) / DIVS_TIME * (zoomed ? zoomFactor : 1.0);
+            switch (scope.horizontal.format) {
             case Dso::GRAPHFORMAT_TY:
                 // Add graphs for channels
-                for (int channel = 0; channel < settings->scope.voltage.count(); ++channel) {
-                    if (settings->scope.voltage[channel].used && result->data(channel)) {
+                for (int channel = 0; channel < scope.voltage.count(); ++channel) {
+                    if (scope.voltage[channel].used && result->data(channel)) {
                         painter.setPen(QPen(colorValues->voltage[channel], 0));
 
                         // What's the horizontal distance between sampling points?
                         double horizontalFactor =
-                            result->data(channel)->voltage.interval / settings->scope.horizontal.timebase;
+                            result->data(channel)->voltage.interval / scope.horizontal.timebase;
                         // How many samples are visible?
                         double centerPosition, centerOffset;
                         if (zoomed) {
@@ -253,52 +335,54 @@ bool Exporter::exportSamples(const DataAnalyzerResult *result) {
                                                          (int)result->data(channel)->voltage.sample.size() - 1);
 
                         // Draw graph
-                        QPointF *graph = new QPointF[lastPosition - firstPosition + 1];
-
-                        for (unsigned int position = firstPosition; position <= lastPosition; ++position)
-                            graph[position - firstPosition] = QPointF(position * horizontalFactor - DIVS_TIME / 2,
-                                                                      result->data(channel)->voltage.sample[position] /
-                                                                              settings->scope.voltage[channel].gain +
-                                                                          settings->scope.voltage[channel].offset);
-
-                        painter.drawPolyline(graph, lastPosition - firstPosition + 1);
-                        delete[] graph;
+                        const SampleValues &voltage = result->data(channel)->voltage;
+                        const DsoSettingsScopeVoltage &voltageSettings = scope.voltage[channel];
+                        tracePoints(graph, firstPosition, lastPosition, -DIVS_TIME / 2, horizontalFactor,
+                                    pixelsPerDiv, [&voltage, &voltageSettings](unsigned position) {
+                                        return voltage.at(position) / voltageSettings.gain + voltageSettings.offset;
+                                    });
+                        painter.drawPolyline(graph.data(), (int)graph.size());
                     }
                 }
 
                 // Add spectrum graphs
-                for (int channel = 0; channel < settings->scope.spectrum.count(); ++channel) {
-                    if (settings->scope.spectrum[channel].used && result->data(channel)) {
+                for (int channel = 0; channel < scope.spectrum.count(); ++channel) {
+                    if (scope.spectrum[channel].used && result->data(channel) &&
+                        !result->data(channel)->spectrum.sample.empty()) {
                         painter.setPen(QPen(colorValues->spectrum[channel], 0));
 
                         // What's the horizontal distance between sampling points?
                         double horizontalFactor =
-                            result->data(channel)->spectrum.interval / settings->scope.horizontal.frequencybase;
+                            result->data(channel)->spectrum.interval / scope.horizontal.frequencybase;
+                        // The zoomed spectrum is centered on the screen
+                        const double startPosition =
+                            (result->data(channel)->spectrumStart - scope.spectrumOrigin()) /
+                            scope.horizontal.frequencybase;
                         // How many samples are visible?
                         double centerPosition, centerOffset;
                         if (zoomed) {
-                            centerPosition = (zoomOffset + DIVS_TIME / 2) / horizontalFactor;
+                            centerPosition = (zoomOffset + DIVS_TIME / 2 - startPosition) / horizontalFactor;
                             centerOffset = DIVS_TIME / horizontalFactor / zoomFactor / 2;
                         } else {
-                            centerPosition = DIVS_TIME / 2 / horizontalFactor;
+                            centerPosition = (DIVS_TIME / 2 - startPosition) / horizontalFactor;
                             centerOffset = DIVS_TIME / horizontalFactor / 2;
                         }
-                        unsigned int firstPosition = qMax((int)(centerPosition - centerOffset), 0);
-                        unsigned int lastPosition = qMin((int)(centerPosition + centerOffset),
-                                                         (int)result->data(channel)->spectrum.sample.size() - 1);
+                        int first = qMax((int)(centerPosition - centerOffset), 0);
+                        int last = qMin((int)(centerPosition + centerOffset),
+                                        (int)result->data(channel)->spectrum.sample.size() - 1);
+                        if (last < first) continue;
+                        unsigned int firstPosition = (unsigned int)first;
+                        unsigned int lastPosition = (unsigned int)last;
 
                         // Draw graph
-                        QPointF *graph = new QPointF[lastPosition - firstPosition + 1];
-
-                        for (unsigned int position = firstPosition; position <= lastPosition; ++position)
-                            graph[position - firstPosition] =
-                                QPointF(position * horizontalFactor - DIVS_TIME / 2,
-                                        result->data(channel)->spectrum.sample[position] /
-                                                settings->scope.spectrum[channel].magnitude +
-                                            settings->scope.spectrum[channel].offset);
-
-                        painter.drawPolyline(graph, lastPosition - firstPosition + 1);
-                        delete[] graph;
+                        const std::vector<double> &spectrum = result->data(channel)->spectrum.sample;
+                        const DsoSettingsScopeSpectrum &spectrumSettings = scope.spectrum[channel];
+                        tracePoints(graph, firstPosition, lastPosition, startPosition - DIVS_TIME / 2,
+                                    horizontalFactor, pixelsPerDiv, [&spectrum, &spectrumSettings](unsigned position) {
+                                        return spectrum[position] / spectrumSettings.magnitude +
+                                               spectrumSettings.offset;
+                                    });
+                        painter.drawPolyline(graph.data(), (int)graph.size());
                     }
                 }
                 break;
@@ -324,87 +408,153 @@ bool Exporter::exportSamples(const DataAnalyzerResult *result) {
     drawGrids(painter, colorValues, lineHeight, scopeHeight, paintDevice->width());
     painter.end();
 
-    if (this->format == EXPORT_FORMAT_IMAGE) static_cast<QPixmap *>(paintDevice.get())->save(this->filename);
+    if (this->format == EXPORT_FORMAT_IMAGE) return static_cast<QImage *>(paintDevice.get())->save(this->filename);
 
     return true;
 }
 
-bool Exporter::exportCVS(const DataAnalyzerResult *result) {
-    QFile csvFile(this->filename);
-    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
-
-    QTextStream csvStream(&csvFile);
-
-    int chCount = settings->scope.voltage.count();
-    std::vector<const SampleValues *> voltageData(size_t(chCount), nullptr);
-    std::vector<const SampleValues *> spectrumData(size_t(chCount), nullptr);
-    size_t maxRow = 0;
-    bool isSpectrumUsed = false;
-    double timeInterval = 0;
-    double freqInterval = 0;
-
+/// \brief Collects the columns of the exported table, the time axis and the used voltages first.
+/// \param result The analyzed frame.
+/// \param columns The columns, they are appended.
+/// \return The number of rows of the table.
+size_t Exporter::tableColumns(const DataAnalyzerResult *result, std::vector<Column> &columns) const {
+    const int chCount = scope.voltage.count();
+    size_t rows = 0;
+    Column axis;
+    axis.name = "t";
+    columns.push_back(axis);
     for (int channel = 0; channel < chCount; ++channel) {
-        if (result->data(channel)) {
-            if (settings->scope.voltage[channel].used) {
-                voltageData[channel] = &(result->data(channel)->voltage);
-                maxRow = std::max(maxRow, voltageData[channel]->sample.size());
-                timeInterval = result->data(channel)->voltage.interval;
-            }
-            if (settings->scope.spectrum[channel].used) {
-                spectrumData[channel] = &(result->data(channel)->spectrum);
-                maxRow = std::max(maxRow, spectrumData[channel]->sample.size());
-                freqInterval = result->data(channel)->spectrum.interval;
-                isSpectrumUsed = true;
-            }
-        }
+        if (!result->data(channel) || !scope.voltage[channel].used) continue;
+        Column column;
+        column.name = scope.voltage[channel].name;
+        column.samples = &result->data(channel)->voltage;
+        columns.push_back(column);
+        columns.front().interval = result->data(channel)->voltage.interval;
+        rows = std::max(rows, column.samples->sample.size());
     }
 
-    // Start with channel names
-    csvStream << "\"t\"";
+    const size_t frequencyAxis = columns.size();
     for (int channel = 0; channel < chCount; ++channel) {
-        if (voltageData[channel] != nullptr) { csvStream << ",\"" << settings->scope.voltage[channel].name << "\""; }
-    }
-    if (isSpectrumUsed) {
-        csvStream << ",\"f\"";
-        for (int channel = 0; channel < chCount; ++channel) {
-            if (spectrumData[channel] != nullptr) {
-                csvStream << ",\"" << settings->scope.spectrum[channel].name << "\"";
-            }
+        if (!result->data(channel) || !scope.spectrum[channel].used) continue;
+        if (columns.size() == frequencyAxis) {
+            axis.name = "f";
+            columns.push_back(axis);
         }
+        Column column;
+        column.name = scope.spectrum[channel].name;
+        column.samples = &result->data(channel)->spectrum;
+        columns.push_back(column);
+        columns[frequencyAxis].interval = result->data(channel)->spectrum.interval;
+        rows = std::max(rows, column.samples->sample.size());
     }
-    csvStream << "\n";
+    return rows;
+}
 
-    for (unsigned int row = 0; row < maxRow; ++row) {
+bool Exporter::exportCVS(const DataAnalyzerResult *result) {
+    QFile csvFile(this->filename);
+    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
 
-        csvStream << timeInterval * row;
-        for (int channel = 0; channel < chCount; ++channel) {
-            if (voltageData[channel] != nullptr) {
-                csvStream << ",";
-                if (row < voltageData[channel]->sample.size()) { csvStream << voltageData[channel]->sample[row]; }
-            }
-        }
+    std::vector<Column> columns;
+    const size_t rows = tableColumns(result, columns);
 
-        if (isSpectrumUsed) {
-            csvStream << "," << freqInterval * row;
-            for (int channel = 0; channel < chCount; ++channel) {
-                if (spectrumData[channel] != nullptr) {
-                    csvStream << ",";
-                    if (row < spectrumData[channel]->sample.size()) { csvStream << spectrumData[channel]->sample[row]; }
+    // Start with channel names
+    QByteArray header;
+    for (const Column &column : columns) {
+        if (!header.isEmpty()) header += ',';
+        header += '"' + column.name.toUtf8() + '"';
+    }
+    header += '\n';
+    if (csvFile.write(header) != header.size()) return false;
+
+    // The blocks of rows are formatted in parallel and written in order, a group of blocks at a time
+    QThreadPool formatters;
+    const size_t blockCount = (rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    const size_t groupSize = (size_t)std::max(formatters.maxThreadCount(), 1);
+    std::vector<std::string> blocks(std::min(blockCount, groupSize));
+    for (size_t group = 0; group < blockCount; group += groupSize) {
+        const size_t groupBlocks = std::min(groupSize, blockCount - group);
+        for (size_t block = 0; block < groupBlocks; ++block) {
+            const size_t firstRow = (group + block) * BLOCK_ROWS;
+            const size_t lastRow = std::min(firstRow + BLOCK_ROWS, rows);
+            std::string *text = &blocks[block];
+            formatters.start(new FormatJob([&columns, text, firstRow, lastRow]() {
+                text->resize((lastRow - firstRow) * columns.size() * (FloatFormat::MAX_LENGTH + 1));
+                char *position = &(*text)[0];
+                for (size_t row = firstRow; row < lastRow; ++row) {
+                    for (size_t index = 0; index < columns.size(); ++index) {
+                        const Column &column = columns[index];
+                        if (index) *position++ = ',';
+                        if (!column.samples)
+                            position = FloatFormat::format(column.interval * row, position);
+                        else if (row < column.samples->sample.size())
+                            position = FloatFormat::format(column.samples->at(row), position);
+                    }
+                    *position++ = '\n';
                 }
-            }
+                text->resize(position - text->data());
+            }));
+        }
+        formatters.waitForDone();
+        for (size_t block = 0; block < groupBlocks; ++block) {
+            const qint64 size = (qint64)blocks[block].size();
+            if (csvFile.write(blocks[block].data(), size) != size) return false;
         }
-        csvStream << "\n";
+        if (progress) progress((double)(group + groupBlocks) / blockCount);
     }
 
     csvFile.close();
+    return csvFile.error() == QFile::NoError;
+}
 
-    return true;
+/// \brief Writes the table of the CSV export as a NumPy array of doubles.
+/// The array has one row per sample and the columns of the CSV export, missing values are NaN.
+bool Exporter::exportNPY(const DataAnalyzerResult *result) {
+    QFile npyFile(this->filename);
+    if (!npyFile.open(QIODevice::WriteOnly)) return false;
+
+    std::vector<Column> columns;
+    const size_t rows = tableColumns(result, columns);
+
+    // Format version 1.0, the header is padded with spaces so the data is aligned
+    QByteArray header = QString("{'descr': '%1f8', 'fortran_order': False, 'shape': (%2, %3), }")
+                            .arg(Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? '<' : '>')
+                            .arg(rows)
+                            .arg(columns.size())
+                            .toLatin1();
+    const int prefixSize = 10;
+    header += QByteArray((NPY_ALIGNMENT - (prefixSize + header.size() + 1) % NPY_ALIGNMENT) % NPY_ALIGNMENT, ' ');
+    header += '\n';
+    QByteArray prefix("\x93NUMPY\x01\x00", 8);
+    prefix += char(header.size() & 0xff);
+    prefix += char(header.size() >> 8);
+    if (npyFile.write(prefix + header) != prefixSize + header.size()) return false;
+
+    const double missing = std::numeric_limits<double>::quiet_NaN();
+    std::vector<double> block(BLOCK_ROWS * columns.size());
+    for (size_t firstRow = 0; firstRow < rows; firstRow += BLOCK_ROWS) {
+        const size_t lastRow = std::min(firstRow + BLOCK_ROWS, rows);
+        double *value = block.data();
+        for (size_t row = firstRow; row < lastRow; ++row) {
+            for (const Column &column : columns) {
+                if (!column.samples)
+                    *value++ = column.interval * row;
+                else
+                    *value++ = row < column.samples->sample.size() ? column.samples->at(row) : missing;
+            }
+        }
+        const qint64 size = (qint64)((value - block.data()) * sizeof(double));
+        if (npyFile.write(reinterpret_cast<const char *>(block.data()), size) != size) return false;
+        if (progress) progress((double)lastRow / rows);
+    }
+
+    npyFile.close();
+    return npyFile.error() == QFile::NoError;
 }
 
 void Exporter::drawGrids(QPainter &painter, DsoSettingsColorValues *colorValues, double lineHeight, double scopeHeight,
                          int scopeWidth) {
     painter.setRenderHint(QPainter::Antialiasing, false);
-    for (int zoomed = 0; zoomed < (settings->view.zoom ? 2 : 1); ++zoomed) {
+    for (int zoomed = 0; zoomed < (view.zoom ? 2 : 1); ++zoomed) {
         // Set DIVS_TIME x DIVS_VOLTAGE matrix for oscillograph
         painter.setMatrix(QMatrix((scopeWidth - 1) / DIVS_TIME, 0, 0, -(scopeHeight - 1) / DIVS_VOLTAGE,
                                   (double)(scopeWidth - 1) / 2,
@@ -5,37 +5,70 @@
 #include <QPainter>
 #include <QPrinter>
 #include <QSize>
+#include <functional>
 #include <memory>
+#include <vector>
+
+#include "settings.h"
 
-class DsoSettings;
 class DataAnalyzerResult;
-class DsoSettingsColorValues;
+struct SampleValues;
 
 ////////////////////////////////////////////////////////////////////////////////
 /// \enum ExportFormat                                                exporter.h
 /// \brief Possible file formats for the export.
-enum ExportFormat { EXPORT_FORMAT_PRINTER, EXPORT_FORMAT_PDF, EXPORT_FORMAT_IMAGE, EXPORT_FORMAT_CSV };
+enum ExportFormat {
+    EXPORT_FORMAT_PRINTER,
+    EXPORT_FORMAT_PDF,
+    EXPORT_FORMAT_IMAGE,
+    EXPORT_FORMAT_CSV,
+    EXPORT_FORMAT_NPY
+};
 
 ////////////////////////////////////////////////////////////////////////////////
 /// \class Exporter                                                   exporter.h
 /// \brief Exports the oscilloscope screen to a file or prints it.
+/// The settings are copied when the exporter is created, so the export can run
+/// in any thread while the settings change.
 class Exporter {
   public:
     static Exporter *createPrintExporter(DsoSettings *settings);
     static Exporter *createSaveToFileExporter(DsoSettings *settings);
+    /// \brief Creates an exporter for a file without asking, like for the frames that failed the mask test.
+    static Exporter *createFileExporter(DsoSettings *settings, const QString &filename, ExportFormat format);
 
     /// \brief Print the document (May be a file too)
     bool exportSamples(const DataAnalyzerResult *result);
 
+    /// \brief Sets the function that is called with the finished fraction of a table export.
+    void setProgressHandler(std::function<void(double)> handler) { progress = handler; }
+
+    /// \return The file name or a description of the printer.
+    QString name() const;
+
+    static const unsigned BLOCK_ROWS = 16384; ///< The rows that are formatted and written together
+
   private:
-    Exporter(DsoSettings *settings, const QString &filename, ExportFormat format);
+    /// \brief A column of the exported table.
+    struct Column {
+        QString name;                                 ///< The title of the column
+        const SampleValues *samples = nullptr; ///< The values, nullptr for the time or frequency axis
+        double interval = 0.0;                 ///< The step of the axis
+    };
+
+    Exporter(const DsoSettings *settings, const QString &filename, ExportFormat format);
     void setFormat(ExportFormat format);
+    size_t tableColumns(const DataAnalyzerResult *result, std::vector<Column> &columns) const;
     bool exportCVS(const DataAnalyzerResult *result);
-    static std::unique_ptr<QPrinter> printPaintDevice(DsoSettings *settings);
+    bool exportNPY(const DataAnalyzerResult *result);
+    static std::unique_ptr<QPrinter> printPaintDevice(const DsoSettingsView &view);
     void drawGrids(QPainter &painter, DsoSettingsColorValues *colorValues, double lineHeight, double scopeHeight,
                    int scopeWidth);
-    DsoSettings *settings;
+    DsoSettingsOptions options;
+    DsoSettingsScope scope;
+    DsoSettingsView view;
     std::unique_ptr<QPrinter> selectedPrinter;
+    std::function<void(double)> progress;
 
     QString filename;
     ExportFormat format;
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QRunnable>
+#include <functional>
+
+#include "exportqueue.h"
+
+#include "dataanalyzerresult.h"
+#include "exporter.h"
+
+namespace {
+/// \brief Runs one export in the worker thread.
+class ExportJob : public QRunnable {
+  public:
+    explicit ExportJob(std::function<void()> job) : job(job) {}
+
+    void run() override { job(); }
+
+  private:
+    std::function<void()> job;
+};
+}
+
+ExportQueue::ExportQueue(QObject *parent) : QObject(parent) {
+    worker.setMaxThreadCount(1);
+    // The thread waits for the next export instead of being started again for every one
+    worker.setExpiryTimeout(-1);
+}
+
+ExportQueue::~ExportQueue() { worker.waitForDone(); }
+
+void ExportQueue::enqueue(std::unique_ptr<Exporter> exporter, std::shared_ptr<const DataAnalyzerResult> result) {
+    if (!exporter || !result) return;
+    queued.ref();
+
+    // std::function needs a copyable job, so the exporter is shared with it
+    std::shared_ptr<Exporter> job(std::move(exporter));
+    worker.start(new ExportJob([this, job, result]() {
+        const QString name = job->name();
+        int percent = -1;
+        job->setProgressHandler([this, &name, &percent](double fraction) {
+            if ((int)(fraction * 100) == percent) return;
+            percent = (int)(fraction * 100);
+            emit exportProgress(name, percent);
+        });
+
+        emit exportStarted(name);
+        const bool success = job->exportSamples(result.get());
+        queued.deref();
+        emit exportFinished(name, success);
+    }));
+}
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QThreadPool>
+#include <memory>
+
+class DataAnalyzerResult;
+class Exporter;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ExportQueue                                             exportqueue.h
+/// \brief Runs the exports in a background thread.
+/// Every export keeps a reference to its frame, so the acquisition and the
+/// display continue while it is written. The exports run one after another in
+/// the order they were queued.
+class ExportQueue : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit ExportQueue(QObject *parent = nullptr);
+    /// \brief Waits for the queued exports.
+    ~ExportQueue();
+
+    /// \brief Queues the export of a frame.
+    /// \param exporter The exporter, it is deleted when the export is done.
+    /// \param result The frame that is exported.
+    void enqueue(std::unique_ptr<Exporter> exporter, std::shared_ptr<const DataAnalyzerResult> result);
+
+    /// \return The number of exports that are queued or running.
+    int pending() const { return queued.loadAcquire(); }
+
+  private:
+    QThreadPool worker; ///< Has one thread, so the exports don't compete for the disk
+    QAtomicInt queued;
+
+  signals:
+    void exportStarted(const QString &name);                ///< The export to the file or printer started
+    void exportProgress(const QString &name, int percent);  ///< Part of a table export was written
+    void exportFinished(const QString &name, bool success); ///< The export is done
+};
@@ -1,11 +1,60 @@
 // SPDX-License-Identifier: GPL-2.0+
 
+#define _USE_MATH_DEFINES
 #include <QMutex>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 
 #include "glgenerator.h"
 
+#include "analysiskernels.h"
 #include "dataanalyzer.h"
 #include "settings.h"
+#include "utils/instrumentation.h"
+
+namespace {
+const size_t MAX_RECYCLED = 32; ///< The number of dropped objects that are kept for reuse
+
+/// \brief Takes an object from the list that isn't shared anymore or creates a new one.
+/// \param recycled The dropped objects.
+template <typename T> std::shared_ptr<T> reuse(std::vector<std::shared_ptr<T>> &recycled) {
+    // Only the list holds the object, nobody can share it again
+    for (auto object = recycled.begin(); object != recycled.end(); ++object) {
+        if (object->use_count() != 1) continue;
+        // The last reads of the other threads happened before they released the object
+        std::atomic_thread_fence(std::memory_order_acquire);
+        std::shared_ptr<T> result = std::move(*object);
+        recycled.erase(object);
+        return result;
+    }
+    if (recycled.size() > MAX_RECYCLED) recycled.erase(recycled.begin());
+    return std::make_shared<T>();
+}
+
+/// \brief Calculates the taps of the sin(x)/x polyphase filters.
+/// \return The taps for every upsampling factor 2^n at index n. The taps of a phase follow each other, every phase
+/// is normalized to a gain of one, so flat lines stay flat.
+std::vector<std::vector<GLfloat>> sincTaps() {
+    const int taps = (int)GlGenerator::SINC_TAPS;
+    std::vector<std::vector<GLfloat>> tables;
+    for (unsigned factor = 1; factor <= GlGenerator::SINC_MAX_FACTOR; factor *= 2) {
+        std::vector<GLfloat> table;
+        for (unsigned phase = 0; phase < factor; ++phase) {
+            std::vector<double> weights;
+            double sum = 0.0;
+            for (int tap = -taps + 1; tap <= taps; ++tap) {
+                const double x = ((double)phase / factor - tap) * M_PI;
+                weights.push_back((x == 0.0) ? 1.0 : taps * std::sin(x) * std::sin(x / taps) / (x * x));
+                sum += weights.back();
+            }
+            for (double weight : weights) table.push_back((GLfloat)(weight / sum));
+        }
+        tables.push_back(std::move(table));
+    }
+    return tables;
+}
+}
 
 GlGenerator::GlGenerator(DsoSettingsScope *scope, DsoSettingsView *view) : settings(scope), view(view) {
     // Grid
@@ -94,17 +143,245 @@ GlGenerator::GlGenerator(DsoSettingsScope *scope, DsoSettingsView *view) : setti
     *(glIterator++) = DIVS_VOLTAGE / 2;
 }
 
-const std::vector<GLfloat> &GlGenerator::channel(int mode, int channel, int index) const {
-    return vaChannel[mode][channel][index];
+const GlGraph &GlGraphs::channel(int mode, int channel, int index) const {
+    static const GlGraph empty;
+    // The settings may already have more channels or phosphor layers than the last frame
+    if ((size_t)channel >= layers[mode].size() || (size_t)index >= layers[mode][channel].size()) return empty;
+    return *layers[mode][channel][index];
+}
+
+const std::vector<GLubyte> *GlGraphs::persistenceImage(int channel) const {
+    return ((size_t)channel < persistence.size()) ? persistence[(size_t)channel].get() : nullptr;
+}
+
+std::shared_ptr<const Spectrogram> GlGraphs::spectrogram(int channel) const {
+    return ((size_t)channel < spectrograms.size()) ? spectrograms[(size_t)channel] : nullptr;
 }
 
 const std::vector<GLfloat> &GlGenerator::grid(int a) const { return vaGrid[a]; }
 
-bool GlGenerator::isReady() const { return ready; }
+void GlGenerator::requestGraphs(std::shared_ptr<const DataAnalyzerResult> result) {
+    QMutexLocker locker(&handoverMutex);
+    const bool queued = pending != nullptr;
+    pending = std::move(result);
+    if (!queued) QMetaObject::invokeMethod(this, "generatePending", Qt::QueuedConnection);
+}
+
+std::shared_ptr<const GlGraphs> GlGenerator::graphs() const {
+    QMutexLocker locker(&handoverMutex);
+    return published;
+}
+
+/// \brief Generates the graphs of the newest requested result.
+void GlGenerator::generatePending() {
+    std::shared_ptr<const DataAnalyzerResult> result;
+    {
+        QMutexLocker locker(&handoverMutex);
+        result = std::move(pending);
+        pending.reset();
+    }
+    if (result) generateGraphs(result.get());
+}
+
+/// \brief Hands the current layers over to the scopes.
+void GlGenerator::publishGraphs() {
+    std::shared_ptr<GlGraphs> graphs = std::make_shared<GlGraphs>();
+    for (int mode = Dso::CHANNELMODE_VOLTAGE; mode < Dso::CHANNELMODE_COUNT; ++mode) {
+        graphs->layers[mode].resize(vaChannel[mode].size());
+        for (size_t channel = 0; channel < vaChannel[mode].size(); ++channel)
+            graphs->layers[mode][channel].assign(vaChannel[mode][channel].begin(), vaChannel[mode][channel].end());
+    }
+    graphs->persistence.assign(persistenceImages.begin(), persistenceImages.end());
+    graphs->spectrograms.assign(spectrograms.begin(), spectrograms.end());
+    graphs->annotations = annotations;
+    graphs->generation = generated;
+    graphs->frameId = frameId;
+    graphs->timestamp = frameTimestamp;
+
+    {
+        QMutexLocker locker(&handoverMutex);
+        published = std::move(graphs);
+    }
+    emit graphsGenerated();
+}
+
+/// \return An empty graph for a new layer, the memory of a dropped layer is reused.
+std::shared_ptr<GlGraph> GlGenerator::newGraph() {
+    std::shared_ptr<GlGraph> graph = reuse(recycled);
+    graph->clear();
+    graph->interval = 0.0;
+    graph->start = 0.0;
+    graph->timeDomain = false;
+    return graph;
+}
+
+/// \brief Replaces a layer with an empty one.
+/// Published layers may be drawn at the moment, so they are never changed.
+void GlGenerator::dropLayer(std::shared_ptr<GlGraph> &layer) {
+    if (layer->empty()) return;
+    recycled.push_back(std::move(layer));
+    layer = newGraph();
+}
+
+const size_t GlGenerator::PYRAMID_BASE;
+const unsigned GlGenerator::SINC_TAPS;
+const unsigned GlGenerator::SINC_MAX_FACTOR;
+
+void GlGraph::clear() {
+    samples.clear();
+    for (std::vector<GLfloat> &level : pyramid) level.clear();
+}
+
+void GlGenerator::buildPyramid(GlGraph &graph) {
+    // Every level halves the samples, the last one has at least two buckets
+    size_t levels = 0;
+    while ((PYRAMID_BASE << (levels + 1)) < graph.samples.size()) ++levels;
+    graph.pyramid.resize(levels);
+
+    for (size_t level = 0; level < levels; ++level) {
+        std::vector<GLfloat> &peaks = graph.pyramid[level];
+        if (level == 0) {
+            // The first level is calculated from the samples
+            const size_t count = graph.samples.size();
+            peaks.resize((count + PYRAMID_BASE - 1) / PYRAMID_BASE * 2);
+            std::vector<GLfloat>::iterator peakIterator = peaks.begin();
+            for (size_t position = 0; position < count; position += PYRAMID_BASE) {
+                const std::vector<GLfloat>::const_iterator begin = graph.samples.begin() + position;
+                const auto bucket = std::minmax_element(begin, begin + std::min(PYRAMID_BASE, count - position));
+                // Keep the order of the peaks, so the line doesn't go back in time
+                *(peakIterator++) = *std::min(bucket.first, bucket.second);
+                *(peakIterator++) = *std::max(bucket.first, bucket.second);
+            }
+            continue;
+        }
+
+        // The other levels combine two buckets of the level below
+        const std::vector<GLfloat> &below = graph.pyramid[level - 1];
+        const size_t buckets = below.size() / 2;
+        peaks.resize((buckets + 1) / 2 * 2);
+        for (size_t bucket = 0; bucket < buckets; bucket += 2) {
+            const size_t second = (bucket + 1 < buckets) ? bucket + 1 : bucket;
+            const GLfloat *early = &below[bucket * 2];
+            const GLfloat *late = &below[second * 2];
+            const bool minimumEarly = std::min(early[0], early[1]) <= std::min(late[0], late[1]);
+            const bool maximumEarly = std::max(early[0], early[1]) >= std::max(late[0], late[1]);
+            if (minimumEarly == maximumEarly) {
+                // Both peaks are in one bucket, they are in order already
+                const GLfloat *both = minimumEarly ? early : late;
+                peaks[bucket] = both[0];
+                peaks[bucket + 1] = both[1];
+            } else if (minimumEarly) {
+                peaks[bucket] = std::min(early[0], early[1]);
+                peaks[bucket + 1] = std::max(late[0], late[1]);
+            } else {
+                peaks[bucket] = std::max(early[0], early[1]);
+                peaks[bucket + 1] = std::min(late[0], late[1]);
+            }
+        }
+    }
+}
+
+bool GlGenerator::decimate(const GlGraph &graph, double left, double right, double xScale, unsigned int columns,
+                           GlGraph &result) {
+    if (graph.interval <= 0.0 || columns == 0 || right <= left) return false;
+    const double step = graph.interval * xScale;
+    size_t bucket = (size_t)((right - left) / step / columns);
+    if (bucket <= 2) return false;
+
+    // Take the coarsest level of the pyramid that still has two values for every column
+    size_t level = 0;
+    const bool fromPyramid = bucket >= PYRAMID_BASE && !graph.pyramid.empty() && !graph.pyramid[0].empty();
+    if (fromPyramid) {
+        while (level + 1 < graph.pyramid.size() && (PYRAMID_BASE << (level + 1)) <= bucket) ++level;
+        bucket = PYRAMID_BASE << level;
+    }
+
+    // The buckets start at multiples of their size, so the peaks don't jump while the range is moved
+    const double origin = graph.start * xScale - DIVS_TIME / 2;
+    const double firstBucket = std::floor((left - origin) / step / bucket);
+    const double lastBucket = std::ceil((right - origin) / step / bucket);
+    const size_t count = graph.samples.size();
+    const size_t first = std::min((size_t)std::max(firstBucket, 0.0) * bucket, count);
+    const size_t last = std::min((size_t)std::max(lastBucket + 1.0, 0.0) * bucket, count);
+
+    result.interval = graph.interval * bucket / 2;
+    result.start = graph.start + first * graph.interval;
+    if (fromPyramid) {
+        // Only the visible part of the level is copied, that doesn't depend on the length of the record
+        const std::vector<GLfloat> &peaks = graph.pyramid[level];
+        const size_t begin = std::min(first / bucket * 2, peaks.size());
+        const size_t end = std::min((last + bucket - 1) / bucket * 2, peaks.size());
+        result.samples.assign(peaks.begin() + begin, peaks.begin() + end);
+        return true;
+    }
+
+    result.samples.resize((last - first + bucket - 1) / bucket * 2);
+    std::vector<GLfloat>::iterator resultIterator = result.samples.begin();
+    for (size_t position = first; position < last; position += bucket) {
+        const std::vector<GLfloat>::const_iterator begin = graph.samples.begin() + position;
+        const auto peaks = std::minmax_element(begin, begin + std::min(bucket, last - position));
+        // Keep the order of the peaks, so the line doesn't go back in time
+        if (peaks.first < peaks.second) {
+            *(resultIterator++) = *peaks.first;
+            *(resultIterator++) = *peaks.second;
+        } else {
+            *(resultIterator++) = *peaks.second;
+            *(resultIterator++) = *peaks.first;
+        }
+    }
+    return true;
+}
+
+bool GlGenerator::interpolate(const GlGraph &graph, double left, double right, double xScale, unsigned int columns,
+                              GlGraph &result) {
+    static const std::vector<std::vector<GLfloat>> tables = sincTaps();
+
+    if (graph.interval <= 0.0 || graph.samples.size() < 2 || columns == 0 || right <= left) return false;
+    const double step = graph.interval * xScale;
+    const double columnsPerSample = step * columns / (right - left);
+    unsigned int level = 0;
+    while ((1u << level) < SINC_MAX_FACTOR && columnsPerSample / (1u << level) > 2.0) ++level;
+    if (level == 0) return false;
+    const unsigned int factor = 1u << level;
+
+    // The visible samples and one more on each side
+    const double origin = graph.start * xScale - DIVS_TIME / 2;
+    const size_t count = graph.samples.size();
+    const double firstVisible = std::floor((left - origin) / step) - 1.0;
+    const double lastVisible = std::ceil((right - origin) / step) + 2.0;
+    const size_t first = (size_t)std::min(std::max(firstVisible, 0.0), count - 1.0);
+    const size_t last = (size_t)std::min(std::max(lastVisible, first + 1.0), (double)count);
+    const size_t length = last - first;
+
+    // The taps beyond the ends of the record get the first and last sample, the taps inside it the real samples
+    std::vector<GLfloat> padded(length + 2 * SINC_TAPS);
+    for (size_t index = 0; index < padded.size(); ++index) {
+        const double position = (double)first + index - SINC_TAPS;
+        padded[index] = graph.samples[(size_t)std::min(std::max(position, 0.0), count - 1.0)];
+    }
+
+    // Every phase is one filter over all samples, so the taps are applied to whole blocks
+    const std::vector<GLfloat> &taps = tables[level];
+    std::vector<GLfloat> values(length);
+    result.samples.resize((length - 1) * factor + 1);
+    for (unsigned int phase = 0; phase < factor; ++phase) {
+        std::fill(values.begin(), values.end(), 0.0f);
+        for (unsigned int tap = 0; tap < 2 * SINC_TAPS; ++tap)
+            Analysis::multiplyAdd(padded.data() + tap + 1, taps[phase * 2 * SINC_TAPS + tap], values.data(),
+                                  (unsigned)length);
+        for (size_t index = 0; index * factor + phase < result.samples.size(); ++index)
+            result.samples[index * factor + phase] = values[index];
+    }
+
+    result.interval = graph.interval / factor;
+    result.start = graph.start + first * graph.interval;
+    return true;
+}
 
 void GlGenerator::generateGraphs(const DataAnalyzerResult *result) {
+    Instrumentation::ScopedStage stage(Instrumentation::STAGE_GENERATE, result->frameId());
 
-    int digitalPhosphorDepth = view->digitalPhosphorDepth;
+    int digitalPhosphorDepth = view->phosphorLayers(*settings);
 
     // Handle all digital phosphor related list manipulations
     for (int mode = Dso::CHANNELMODE_VOLTAGE; mode < Dso::CHANNELMODE_COUNT; ++mode) {
@@ -112,83 +389,60 @@ void GlGenerator::generateGraphs(const DataAnalyzerResult *result) {
         vaChannel[mode].resize(settings->voltage.count());
 
         for (unsigned int channel = 0; channel < vaChannel[mode].size(); ++channel) {
-            // Move the last list element to the front
-            vaChannel[mode][channel].push_front(std::vector<GLfloat>());
+            // Drop the oldest layer and add a new one to the front
+            std::deque<std::shared_ptr<GlGraph>> &layers = vaChannel[mode][channel];
+            while (!layers.empty() && (int)layers.size() >= digitalPhosphorDepth) {
+                recycled.push_back(std::move(layers.back()));
+                layers.pop_back();
+            }
+            layers.push_front(newGraph());
 
-            // Resize lists for vector array to fit the digital phosphor depth
-            vaChannel[mode][channel].resize(digitalPhosphorDepth);
+            // Fill the lists to the digital phosphor depth
+            while ((int)layers.size() < digitalPhosphorDepth) layers.push_back(newGraph());
         }
     }
 
-    ready = true;
+    ++generated;
+    frameId = result->frameId();
+    frameTimestamp = result->timestamp();
+
+    // The maps take a lot of memory, they are only kept while they are shown
+    const bool persistenceShown = view->persistenceMap && settings->horizontal.format == Dso::GRAPHFORMAT_TY;
+    const bool densityShown = view->xyDensity && settings->horizontal.format == Dso::GRAPHFORMAT_XY;
+    if (!persistenceShown) persistence.clear();
+    if (!densityShown) density.clear();
+    if (!persistenceShown && !densityShown) persistenceImages.clear();
+    if (!settings->spectrogram || settings->horizontal.format != Dso::GRAPHFORMAT_TY) spectrograms.clear();
+    annotations.reset();
 
-    unsigned int preTrigSamples = 0;
-    unsigned int postTrigSamples = 0;
     switch (settings->horizontal.format) {
     case Dso::GRAPHFORMAT_TY: {
-        unsigned int swTriggerStart = 0;
-        // check trigger point for software trigger
-        if (settings->trigger.mode == Dso::TRIGGERMODE_SOFTWARE && settings->trigger.source <= 1) {
-            unsigned int channel = settings->trigger.source;
-            if (settings->voltage[channel].used && result->data(channel) &&
-                !result->data(channel)->voltage.sample.empty()) {
-                double value;
-                double level = settings->voltage[channel].trigger;
-                unsigned int sampleCount = result->data(channel)->voltage.sample.size();
-                double timeDisplay = settings->horizontal.timebase * 10;
-                double samplesDisplay = timeDisplay * settings->horizontal.samplerate;
-                if (samplesDisplay >= sampleCount) {
-                    // For sure not enough samples to adjust for jitter.
-                    // Following options exist:
-                    //    1: Decrease sample rate
-                    //    2: Change trigger mode to auto
-                    //    3: Ignore samples
-                    // For now #3 is chosen
-                    timestampDebug(QString("Too few samples to make a steady "
-                                           "picture. Decrease sample rate"));
-                    return;
-                }
-                preTrigSamples = (settings->trigger.position * samplesDisplay);
-                postTrigSamples = sampleCount - (samplesDisplay - preTrigSamples);
-
-                if (settings->trigger.slope == Dso::SLOPE_POSITIVE) {
-                    double prev = INT_MAX;
-                    for (unsigned int i = preTrigSamples; i < postTrigSamples; i++) {
-                        value = result->data(channel)->voltage.sample[i];
-                        if (value > level && prev <= level) {
-                            int rising = 0;
-                            for (unsigned int k = i + 1; k < i + 11 && k < sampleCount; k++) {
-                                if (result->data(channel)->voltage.sample[k] >= value) { rising++; }
-                            }
-                            if (rising > 7) {
-                                swTriggerStart = i;
-                                break;
-                            }
-                        }
-                        prev = value;
-                    }
-                } else if (settings->trigger.slope == Dso::SLOPE_NEGATIVE) {
-                    double prev = INT_MIN;
-                    for (unsigned int i = preTrigSamples; i < postTrigSamples; i++) {
-                        value = result->data(channel)->voltage.sample[i];
-                        if (value < level && prev >= level) {
-                            int falling = 0;
-                            for (unsigned int k = i + 1; k < i + 11 && k < sampleCount; k++) {
-                                if (result->data(channel)->voltage.sample[k] < value) { falling++; }
-                            }
-                            if (falling > 7) {
-                                swTriggerStart = i;
-                                break;
-                            }
-                        }
-                        prev = value;
-                    }
-                }
-            }
-            if (swTriggerStart == 0) {
-                timestampDebug(QString("Trigger not asserted. Data ignored"));
-                return;
+        // The analyzer found the trigger point, the graphs start the pretrigger samples before it
+        unsigned int firstSample;
+        double triggerShift;
+        if (!DataAnalyzer::screenStart(result, settings, firstSample, triggerShift)) {
+            timestampDebug(QString("Trigger not asserted. Data ignored"));
+            Instrumentation::count(Instrumentation::COUNTER_IGNORED);
+            return;
+        }
+
+        // The decoded protocol is placed like the samples, only the annotations on the screen are kept
+        const std::vector<ProtocolAnnotation> &decoded = result->annotations();
+        const DataChannel *decoderSource = result->data(settings->decoder.sources[0]);
+        if (!decoded.empty() && decoderSource) {
+            const double interval = decoderSource->voltage.interval;
+            const double screenTime = settings->horizontal.timebase * DIVS_TIME;
+            std::shared_ptr<std::vector<ProtocolAnnotation>> visible =
+                std::make_shared<std::vector<ProtocolAnnotation>>();
+            for (const ProtocolAnnotation &annotation : decoded) {
+                const double start = (annotation.start - firstSample) * interval + triggerShift;
+                const double end = (annotation.end - firstSample) * interval + triggerShift;
+                if (end < 0.0 || start > screenTime) continue;
+                visible->push_back(annotation);
+                visible->back().start = start;
+                visible->back().end = end;
             }
+            if (!visible->empty()) annotations = std::move(visible);
         }
 
         // Add graphs for channels
@@ -198,63 +452,81 @@ void GlGenerator::generateGraphs(const DataAnalyzerResult *result) {
                 if (((mode == Dso::CHANNELMODE_VOLTAGE) ? settings->voltage[channel].used
                                                         : settings->spectrum[channel].used) &&
                     result->data(channel) && !result->data(channel)->voltage.sample.empty()) {
-                    // Check if the sample count has changed
-                    size_t sampleCount = (mode == Dso::CHANNELMODE_VOLTAGE)
+                    // Check if the sample count has changed, the scopes transform the record of an offloaded spectrum
+                    const bool offloaded =
+                        mode == Dso::CHANNELMODE_SPECTRUM && result->data(channel)->spectrumOffloaded;
+                    size_t sampleCount = (mode == Dso::CHANNELMODE_VOLTAGE || offloaded)
                                              ? result->data(channel)->voltage.sample.size()
                                              : result->data(channel)->spectrum.sample.size();
-                    if (mode == Dso::CHANNELMODE_VOLTAGE) sampleCount -= (swTriggerStart - preTrigSamples);
-                    size_t neededSize = sampleCount * 2;
-
-#if 0
-                    for(unsigned int index = 0; index < digitalPhosphorDepth; ++index) {
-                        if(vaChannel[mode][channel][index].size() != neededSize)
-                            vaChannel[mode][channel][index].clear(); // Something was changed, drop old traces
-                    }
-#endif
-
-                    // Set size directly to avoid reallocations
-                    vaChannel[mode][(size_t)channel].front().resize(neededSize);
-
-                    // Iterator to data for direct access
-                    std::vector<GLfloat>::iterator glIterator = vaChannel[mode][(size_t)channel].front().begin();
+                    if (mode == Dso::CHANNELMODE_VOLTAGE) sampleCount -= std::min(sampleCount, (size_t)firstSample);
 
-                    // What's the horizontal distance between sampling points?
-                    double horizontalFactor;
-                    if (mode == Dso::CHANNELMODE_VOLTAGE)
-                        horizontalFactor = result->data(channel)->voltage.interval / settings->horizontal.timebase;
-                    else
-                        horizontalFactor =
-                            result->data(channel)->spectrum.interval / settings->horizontal.frequencybase;
-
-                    // Fill vector array
+                    // Only the values are stored, the scope calculates the positions when it draws them
+                    GlGraph &graph = *vaChannel[mode][(size_t)channel].front();
+                    graph.samples.resize(sampleCount);
+                    std::vector<GLfloat>::iterator glIterator = graph.samples.begin();
                     if (mode == Dso::CHANNELMODE_VOLTAGE) {
-                        std::vector<double>::const_iterator dataIterator =
-                            result->data(channel)->voltage.sample.begin();
-                        const double gain = settings->voltage[channel].gain;
-                        const double offset = settings->voltage[channel].offset;
-                        const double invert = settings->voltage[channel].inverted ? -1.0 : 1.0;
-
-                        std::advance(dataIterator, swTriggerStart - preTrigSamples);
-
-                        for (unsigned int position = 0; position < sampleCount; ++position) {
-                            *(glIterator++) = position * horizontalFactor - DIVS_TIME / 2;
-                            *(glIterator++) = *(dataIterator++) / gain * invert + offset;
-                        }
+                        // The samples are read in place, in roll mode they wrap around the end of the ring
+                        const SampleValues &voltage = result->data(channel)->voltage;
+                        graph.interval = voltage.interval;
+                        graph.start = triggerShift;
+
+                        for (unsigned int position = 0; position < sampleCount; ++position)
+                            *(glIterator++) = (GLfloat)voltage.at(firstSample + position);
+                    } else if (offloaded) {
+                        // Without roll mode the record is a single span
+                        const SampleValues &voltage = result->data(channel)->voltage;
+                        graph.interval = voltage.interval;
+                        graph.start = -settings->spectrumOrigin();
+                        graph.timeDomain = true;
+                        std::copy(voltage.sample.begin(), voltage.sample.end(), glIterator);
                     } else {
-                        std::vector<double>::const_iterator dataIterator =
-                            result->data(channel)->spectrum.sample.begin();
-                        const double magnitude = settings->spectrum[channel].magnitude;
-                        const double offset = settings->spectrum[channel].offset;
-
-                        for (unsigned int position = 0; position < sampleCount; ++position) {
-                            *(glIterator++) = position * horizontalFactor - DIVS_TIME / 2;
-                            *(glIterator++) = *(dataIterator++) / magnitude + offset;
+                        const SampleValues &spectrum = result->data(channel)->spectrum;
+                        graph.interval = spectrum.interval;
+                        // The zoomed spectrum is centered on the screen
+                        graph.start = result->data(channel)->spectrumStart - settings->spectrumOrigin();
+                        std::copy(spectrum.sample.begin(), spectrum.sample.begin() + sampleCount, glIterator);
+
+                        // The short time spectra scroll through the waterfall, the scopes upload the new rows
+                        const DataChannel *channelData = result->data(channel);
+                        if (settings->spectrogram && channelData->spectrogramBins > 0) {
+                            spectrograms.resize((size_t)settings->voltage.size());
+                            std::shared_ptr<Spectrogram> &spectrogram = spectrograms[(size_t)channel];
+                            if (!spectrogram) spectrogram = std::make_shared<Spectrogram>();
+                            const DsoSettingsScopeSpectrum &scale = settings->spectrum[channel];
+                            spectrogram->add(channelData->spectrogram.sample.data(),
+                                             (unsigned)(channelData->spectrogram.sample.size() /
+                                                        channelData->spectrogramBins),
+                                             channelData->spectrogramBins, -settings->spectrumOrigin(),
+                                             channelData->spectrogram.interval,
+                                             1.0 / settings->horizontal.frequencybase, 1.0 / scale.magnitude,
+                                             scale.offset);
                         }
                     }
+                    // The peaks of the voltages are no peaks of the spectrum
+                    if (!graph.timeDomain) buildPyramid(graph);
+
+                    if (mode == Dso::CHANNELMODE_VOLTAGE && view->persistenceMap) {
+                        // Every frame is counted at the position it has on the screen
+                        const DsoSettingsScopeVoltage &voltage = settings->voltage[channel];
+                        persistence.resize((size_t)settings->voltage.size());
+                        persistenceImages.resize((size_t)settings->voltage.size());
+                        std::unique_ptr<PersistenceMap> &map = persistence[(size_t)channel];
+                        if (!map) map.reset(new PersistenceMap());
+                        const double yScale = (voltage.inverted ? -1.0 : 1.0) / voltage.gain;
+                        map->add(graph, 1.0 / settings->horizontal.timebase, yScale, voltage.offset,
+                                 view->interpolation != Dso::INTERPOLATION_OFF);
+
+                        // The image of the last frame may still be uploaded by the scopes
+                        std::shared_ptr<std::vector<GLubyte>> &image = persistenceImages[(size_t)channel];
+                        if (image) recycledImages.push_back(std::move(image));
+                        image = reuse(recycledImages);
+                        map->colorize(*image);
+                    }
                 } else {
                     // Delete all vector arrays
-                    for (unsigned index = 0; index < (unsigned)digitalPhosphorDepth; ++index)
-                        vaChannel[mode][channel][index].clear();
+                    for (std::shared_ptr<GlGraph> &layer : vaChannel[mode][(size_t)channel]) dropLayer(layer);
+                    if (mode == Dso::CHANNELMODE_SPECTRUM && (size_t)channel < spectrograms.size())
+                        spectrograms[(size_t)channel].reset();
                 }
             }
         }
@@ -262,33 +534,21 @@ void GlGenerator::generateGraphs(const DataAnalyzerResult *result) {
 
     case Dso::GRAPHFORMAT_XY:
         for (int channel = 0; channel < settings->voltage.size(); ++channel) {
+            // Delete all spectrum graphs
+            for (std::shared_ptr<GlGraph> &layer : vaChannel[Dso::CHANNELMODE_SPECTRUM][(size_t)channel])
+                dropLayer(layer);
+
             // For even channel numbers check if this channel is used and this and the
             // following channel are available at the data analyzer
             if (channel % 2 == 0 && channel + 1 < settings->voltage.size() && settings->voltage[channel].used &&
                 result->data(channel) && !result->data(channel)->voltage.sample.empty() && result->data(channel + 1) &&
                 !result->data(channel + 1)->voltage.sample.empty()) {
-                // Check if the sample count has changed
                 const unsigned sampleCount = qMin(result->data(channel)->voltage.sample.size(),
                                                   result->data(channel + 1)->voltage.sample.size());
-                const unsigned neededSize = sampleCount * 2;
-                for (unsigned index = 0; index < (unsigned)digitalPhosphorDepth; ++index) {
-                    if (vaChannel[Dso::CHANNELMODE_VOLTAGE][(size_t)channel][index].size() != neededSize)
-                        vaChannel[Dso::CHANNELMODE_VOLTAGE][(size_t)channel][index]
-                            .clear(); // Something was changed, drop old traces
-                }
-
-                // Set size directly to avoid reallocations
-                vaChannel[Dso::CHANNELMODE_VOLTAGE][(size_t)channel].front().resize(neededSize);
-
-                // Iterator to data for direct access
-                std::vector<GLfloat>::iterator glIterator =
-                    vaChannel[Dso::CHANNELMODE_VOLTAGE][channel].front().begin();
-
-                // Fill vector array
                 unsigned int xChannel = channel;
                 unsigned int yChannel = channel + 1;
-                std::vector<double>::const_iterator xIterator = result->data(xChannel)->voltage.sample.begin();
-                std::vector<double>::const_iterator yIterator = result->data(yChannel)->voltage.sample.begin();
+                const SampleValues &xVoltage = result->data(xChannel)->voltage;
+                const SampleValues &yVoltage = result->data(yChannel)->voltage;
                 const double xGain = settings->voltage[xChannel].gain;
                 const double yGain = settings->voltage[yChannel].gain;
                 const double xOffset = settings->voltage[xChannel].offset;
@@ -296,19 +556,53 @@ void GlGenerator::generateGraphs(const DataAnalyzerResult *result) {
                 const double xInvert = settings->voltage[xChannel].inverted ? -1.0 : 1.0;
                 const double yInvert = settings->voltage[yChannel].inverted ? -1.0 : 1.0;
 
+                if (view->xyDensity) {
+                    // The pairs are binned instead of drawn, the digital phosphor depth sets the fading
+                    for (std::shared_ptr<GlGraph> &layer : vaChannel[Dso::CHANNELMODE_VOLTAGE][(size_t)channel])
+                        dropLayer(layer);
+                    density.resize((size_t)settings->voltage.size());
+                    persistenceImages.resize((size_t)settings->voltage.size());
+                    std::unique_ptr<DensityMap> &map = density[(size_t)channel];
+                    if (!map) map.reset(new DensityMap());
+                    const double decay =
+                        view->digitalPhosphor ? std::pow(0.01, 1.0 / std::max(view->digitalPhosphorDepth, 1)) : 0.0;
+                    map->add(xVoltage, yVoltage, sampleCount, xInvert / xGain, xOffset, yInvert / yGain, yOffset,
+                             decay);
+
+                    // The image of the last frame may still be uploaded by the scopes
+                    std::shared_ptr<std::vector<GLubyte>> &image = persistenceImages[(size_t)channel];
+                    if (image) recycledImages.push_back(std::move(image));
+                    image = reuse(recycledImages);
+                    map->colorize(*image);
+                    continue;
+                }
+
+                // Check if the sample count has changed
+                const unsigned neededSize = sampleCount * 2;
+                for (std::shared_ptr<GlGraph> &layer : vaChannel[Dso::CHANNELMODE_VOLTAGE][(size_t)channel]) {
+                    if (layer->samples.size() != neededSize) dropLayer(layer); // Something was changed, drop old traces
+                }
+
+                // Set size directly to avoid reallocations
+                GlGraph &graph = *vaChannel[Dso::CHANNELMODE_VOLTAGE][(size_t)channel].front();
+                graph.samples.resize(neededSize);
+                graph.interval = 0.0;
+
+                // Iterator to data for direct access
+                std::vector<GLfloat>::iterator glIterator = graph.samples.begin();
+
+                // Fill vector array
                 for (unsigned int position = 0; position < sampleCount; ++position) {
-                    *(glIterator++) = *(xIterator++) / xGain * xInvert + xOffset;
-                    *(glIterator++) = *(yIterator++) / yGain * yInvert + yOffset;
+                    *(glIterator++) = xVoltage.at(position) / xGain * xInvert + xOffset;
+                    *(glIterator++) = yVoltage.at(position) / yGain * yInvert + yOffset;
                 }
             } else {
                 // Delete all vector arrays
-                for (unsigned int index = 0; index < (unsigned)digitalPhosphorDepth; ++index)
-                    vaChannel[Dso::CHANNELMODE_VOLTAGE][(size_t)channel][index].clear();
+                for (std::shared_ptr<GlGraph> &layer : vaChannel[Dso::CHANNELMODE_VOLTAGE][(size_t)channel])
+                    dropLayer(layer);
+                if ((size_t)channel < density.size()) density[(size_t)channel].reset();
+                if ((size_t)channel < persistenceImages.size()) persistenceImages[(size_t)channel].reset();
             }
-
-            // Delete all spectrum graphs
-            for (unsigned int index = 0; index < (unsigned)digitalPhosphorDepth; ++index)
-                vaChannel[Dso::CHANNELMODE_SPECTRUM][(size_t)channel][index].clear();
         }
         break;
 
@@ -316,5 +610,5 @@ void GlGenerator::generateGraphs(const DataAnalyzerResult *result) {
         break;
     }
 
-    emit graphsGenerated();
+    publishGraphs();
 }
@@ -3,19 +3,69 @@
 #pragma once
 
 #include <deque>
+#include <memory>
 
 #include <QGLFunctions>
+#include <QMutex>
 #include <QObject>
 
 #include "dataanalyzerresult.h"
+#include "densitymap.h"
+#include "persistencemap.h"
 #include "scopesettings.h"
+#include "spectrogram.h"
 #include "viewconstants.h"
 #include "viewsettings.h"
 class GlScope;
 
+/// \brief One phosphor layer of a graph.
+/// Graphs over time or frequency only hold the sample values, the position of a
+/// vertex follows from its index and the values are scaled when they are drawn.
+/// XY graphs hold the vertex positions in divs.
+struct GlGraph {
+    std::vector<GLfloat> samples; ///< The sample values or the interleaved x/y positions
+    double interval = 0.0;        ///< The time or frequency between two samples, 0 for x/y positions
+    double start = 0.0;           ///< The time or frequency of the first sample
+    /// true, if a spectrum graph holds the voltages of the record, the scopes transform them on the gpu
+    bool timeDomain = false;
+    /// The minimum and maximum of every bucket of GlGenerator::PYRAMID_BASE samples in the order they occur, every
+    /// level doubles the buckets
+    std::vector<std::vector<GLfloat>> pyramid;
+
+    bool empty() const { return samples.empty(); }
+    size_t vertexCount() const { return (interval > 0.0) ? samples.size() : samples.size() / 2; }
+    void clear();
+};
+
+/// \brief The graphs of one generated frame.
+/// The graphs are published by the generator thread and never changed
+/// afterwards, so the scopes can draw them while the next frame is generated.
+struct GlGraphs {
+    /// The phosphor layers of every graph, beginning with the newest one
+    std::vector<std::vector<std::shared_ptr<const GlGraph>>> layers[Dso::CHANNELMODE_COUNT];
+    /// The colored persistence maps of the voltage graphs or density maps of the XY graphs, nullptr if there is none
+    std::vector<std::shared_ptr<const std::vector<GLubyte>>> persistence;
+    /// The waterfalls of the spectrum graphs, nullptr if there is none
+    std::vector<std::shared_ptr<const Spectrogram>> spectrograms;
+    /// The decoded protocol on the screen, the positions are the times in s from the left edge, nullptr if empty
+    std::shared_ptr<const std::vector<ProtocolAnnotation>> annotations;
+    unsigned int generation = 0; ///< The number of generated frames, the layers move by one with every frame
+    quint64 frameId = 0;         ///< The id of the newest frame, see DSOsamples::frameId
+    qint64 timestamp = 0;        ///< The steady clock time in ns the newest frame was received at
+
+    /// \return The layer of a graph, an empty graph if there is none.
+    const GlGraph &channel(int mode, int channel, int index) const;
+    /// \return The persistence map of a voltage graph, nullptr if there is none.
+    const std::vector<GLubyte> *persistenceImage(int channel) const;
+    /// \return The waterfall of a spectrum graph, nullptr if there is none.
+    std::shared_ptr<const Spectrogram> spectrogram(int channel) const;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 /// \class GlGenerator
 /// \brief Generates the vertex arrays for the GlScope classes.
+/// The graphs are generated on the thread of the generator, the gui thread
+/// only hands over the results and takes the finished graphs.
 class GlGenerator : public QObject {
     Q_OBJECT
 
@@ -24,17 +74,79 @@ class GlGenerator : public QObject {
     /// \param settings The target settings object.
     /// \param parent The parent widget.
     GlGenerator(DsoSettingsScope *scope, DsoSettingsView *view);
-    void generateGraphs(const DataAnalyzerResult *result);
-    const std::vector<GLfloat> &channel(int mode, int channel, int index) const;
+    /// \brief Queues a result for the generation, it may be called from any thread.
+    /// A result that wasn't generated yet is replaced, so the display never falls behind.
+    void requestGraphs(std::shared_ptr<const DataAnalyzerResult> result);
+    /// \return The newest generated graphs, nullptr before the first frame.
+    std::shared_ptr<const GlGraphs> graphs() const;
     const std::vector<GLfloat> &grid(int a) const;
-    bool isReady() const;
+
+    /// \brief Reduces a graph to the minimum and maximum of every pixel column.
+    /// The peaks stay visible while a deep record only needs a few vertices. If
+    /// the graph has a pyramid, only its visible part of the fitting level is
+    /// copied, so zooming and panning cost the same for any record length.
+    /// \param graph The values of a graph over time or frequency.
+    /// \param left The left end of the visible range in divs.
+    /// \param right The right end of the visible range in divs.
+    /// \param xScale The divs per second or hertz.
+    /// \param columns The number of pixel columns of the visible range.
+    /// \param result The reduced graph with two values for every column.
+    /// \return false, if the graph has no more than two samples per column, result is unchanged then.
+    static bool decimate(const GlGraph &graph, double left, double right, double xScale, unsigned int columns,
+                         GlGraph &result);
+
+    /// \brief Upsamples the visible part of a graph with sin(x)/x.
+    /// A polyphase filter with precomputed Lanczos taps calculates the values
+    /// between the samples until there are about two pixel columns between the
+    /// values. Only the visible samples are filtered.
+    /// \param graph The values of a voltage graph.
+    /// \param left The left end of the visible range in divs.
+    /// \param right The right end of the visible range in divs.
+    /// \param xScale The divs per second.
+    /// \param columns The number of pixel columns of the visible range.
+    /// \param result The upsampled graph, it passes through the samples.
+    /// \return false, if the samples are dense enough already, result is unchanged then.
+    static bool interpolate(const GlGraph &graph, double left, double right, double xScale, unsigned int columns,
+                            GlGraph &result);
+
+    static const size_t PYRAMID_BASE = 4;       ///< The samples in a bucket of the finest pyramid level
+    static const unsigned SINC_TAPS = 8;        ///< The samples on each side of the sin(x)/x filter
+    static const unsigned SINC_MAX_FACTOR = 16; ///< The maximal upsampling factor, a power of two
+
+  private slots:
+    void generatePending();
+
+  public:
+    /// \brief Generates the graphs of a result in the calling thread, instead of queuing it with requestGraphs().
+    /// The generated graphs are published like the queued ones. Mustn't run while a queued result is generated.
+    void generateGraphs(const DataAnalyzerResult *result);
 
   private:
+    void publishGraphs();
+    std::shared_ptr<GlGraph> newGraph();
+    void dropLayer(std::shared_ptr<GlGraph> &layer);
+    /// \brief Calculates the min/max pyramid of the samples of a graph.
+    static void buildPyramid(GlGraph &graph);
+
     DsoSettingsScope *settings;
     DsoSettingsView *view;
-    std::vector<std::deque<std::vector<GLfloat>>> vaChannel[Dso::CHANNELMODE_COUNT];
+    std::vector<std::deque<std::shared_ptr<GlGraph>>> vaChannel[Dso::CHANNELMODE_COUNT];
+    std::vector<std::shared_ptr<GlGraph>> recycled; ///< Dropped layers, reused when no frame holds them anymore
+    std::vector<std::unique_ptr<PersistenceMap>> persistence; ///< The maps of the voltage graphs
+    std::vector<std::unique_ptr<DensityMap>> density;                     ///< The maps of the XY graphs
+    std::vector<std::shared_ptr<std::vector<GLubyte>>> persistenceImages; ///< The colored maps
+    std::vector<std::shared_ptr<std::vector<GLubyte>>> recycledImages;    ///< Dropped images for reuse
+    std::vector<std::shared_ptr<Spectrogram>> spectrograms;               ///< The waterfalls of the spectra
+    std::shared_ptr<const std::vector<ProtocolAnnotation>> annotations;   ///< The visible protocol annotations
     std::vector<GLfloat> vaGrid[3];
-    bool ready = false;
+    unsigned int generated = 0; ///< The number of generated frames
+    quint64 frameId = 0;        ///< The id of the newest generated frame
+    qint64 frameTimestamp = 0;  ///< The time the newest generated frame was received at
+
+    /// Protects the handover between the threads
+    mutable QMutex handoverMutex;
+    std::shared_ptr<const DataAnalyzerResult> pending; ///< The next result that should be generated
+    std::shared_ptr<const GlGraphs> published;         ///< The newest generated graphs
   signals:
     void graphsGenerated(); ///< The graphs are ready to be drawn
 };
@@ -3,15 +3,92 @@
 #include <cmath>
 
 #include <QColor>
+#include <QImage>
+#include <QOpenGLFramebufferObjectFormat>
+#include <QPainter>
 
 #include "glscope.h"
 
 #include "glgenerator.h"
+#include "glsharedresources.h"
 #include "settings.h"
+#include "utils/frametrace.h"
+#include "utils/instrumentation.h"
+
+namespace {
+/// The position of a sample follows from its index, so only the value has to be uploaded
+const char *const VERTEX_SHADER = "#version 130\n"
+                                  "in float value;\n"
+                                  "uniform vec2 scale;\n"
+                                  "uniform vec2 offset;\n"
+                                  "void main() {\n"
+                                  "    vec2 position = vec2(float(gl_VertexID), value) * scale + offset;\n"
+                                  "    gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 0.0, 1.0);\n"
+                                  "    gl_FrontColor = gl_Color;\n"
+                                  "}\n";
+const char *const FRAGMENT_SHADER = "#version 130\n"
+                                    "void main() { gl_FragColor = gl_Color; }\n";
+
+#ifndef GL_RGBA16F
+#define GL_RGBA16F 0x881A
+#endif
+
+// The decoded protocol is drawn in a row above the bottom of the screen, in divs from the bottom
+const double ANNOTATION_BOTTOM = 0.2;
+const double ANNOTATION_TOP = 0.9;
+} // namespace
+
+GlScope::GlScope(DsoSettings *settings, const GlGenerator *generator, const ReferenceWaveforms *references,
+                 GlSharedResources *shared, QWidget *parent)
+    : QOpenGLWidget(parent), settings(settings), generator(generator), references(references), shared(shared) {
+    // The graphs are generated on another thread, the scope is updated on its own thread
+    connect(generator, &GlGenerator::graphsGenerated, this, &GlScope::requestRender);
+    connect(references, &ReferenceWaveforms::changed, this, &GlScope::requestRender);
+    connect(&renderThrottle, &UpdateThrottle::update, this, &GlScope::render);
+    connect(this, &QOpenGLWidget::frameSwapped, this, &GlScope::frameSwapped);
+}
+
+GlScope::~GlScope() {
+    // The buffers of the graphs belong to the context of this widget, the shared objects are freed by their owner
+    makeCurrent();
+    for (std::vector<GraphBuffers> &graphs : graphBuffers)
+        for (GraphBuffers &graph : graphs)
+            for (QOpenGLBuffer &buffer : graph.layers) buffer.destroy();
+    program.reset();
+    phosphor.reset();
+    if (labelTexture) glDeleteTextures(1, &labelTexture);
+    doneCurrent();
+}
+
+const int GlScope::IDLE_RATE;
 
-GlScope::GlScope(DsoSettings *settings, const GlGenerator *generator, QWidget *parent)
-    : GL_WIDGET_CLASS(parent), settings(settings), generator(generator) {
-    connect(generator, &GlGenerator::graphsGenerated, [this]() { update(); });
+void GlScope::requestRender() {
+    const bool background = settings->view.powerSaving && !window()->isActiveWindow();
+    renderThrottle.setMaximumRate(background ? IDLE_RATE : settings->view.maximumFrameRate);
+    renderThrottle.request();
+}
+
+/// \brief Repaints the scope unless the previous paint is still waiting for the swap or can't be seen.
+void GlScope::render() {
+    if (awaitingSwap || !isVisible() || window()->isMinimized()) {
+        renderPending = true;
+        return;
+    }
+    renderPending = false;
+    update();
+}
+
+/// \brief Paints the frame that arrived while the previous one was waiting for the vertical sync.
+void GlScope::frameSwapped() {
+    awaitingSwap = false;
+    if (renderPending) render();
+}
+
+/// \brief Paints the frames that arrived while the window was minimized.
+void GlScope::showEvent(QShowEvent *event) {
+    QOpenGLWidget::showEvent(event);
+    awaitingSwap = false;
+    if (renderPending) render();
 }
 
 /// \brief Initializes OpenGL output.
@@ -29,15 +106,59 @@ void GlScope::initializeGL() {
     glLineStipple(1, 0x3333);
 
     glEnableClientState(GL_VERTEX_ARRAY);
+
+    // Draw from client side arrays if the context has no vertex buffers
+    QOpenGLBuffer probe(QOpenGLBuffer::VertexBuffer);
+    useBuffers = probe.create();
+    probe.destroy();
+
+    // The samples are scaled on the cpu if the shader is not supported
+    program.reset(new QOpenGLShaderProgram());
+    program->addShaderFromSourceCode(QOpenGLShader::Vertex, VERTEX_SHADER);
+    program->addShaderFromSourceCode(QOpenGLShader::Fragment, FRAGMENT_SHADER);
+    // The values take the place of the vertex array, some drivers only draw if attribute 0 is used
+    program->bindAttributeLocation("value", 0);
+    useShaders = useBuffers && program->link();
+    if (!useShaders) program.reset();
+    // The transformed spectra are written into the vertex buffers, they are only drawn with the shader
+    emit spectrumComputeAvailable(useShaders && shared->spectrumCompute());
+
+    // Without framebuffers the graphs of all scopes fade out in layers
+    if (!QOpenGLFramebufferObject::hasOpenGLFramebufferObjects()) settings->view.phosphorFramebuffers = false;
 }
 
 /// \brief Draw the graphs and the grid.
 void GlScope::paintGL() {
+    Instrumentation::ScopedStage stage(Instrumentation::STAGE_DRAW);
+
     // Clear OpenGL buffer and configure settings
     glClear(GL_COLOR_BUFFER_BIT);
     glLineWidth(1);
 
-    if (settings->view.digitalPhosphorDepth > 0 && generator->isReady()) { drawGraph(); }
+    // The graphs stay the same while they are drawn, even if the next frame is generated meanwhile
+    graphs = generator->graphs();
+    if (graphs) stage.setFrame(graphs->frameId);
+    if (settings->view.phosphorLayers(settings->scope) > 0 && graphs) {
+        if (useBuffers) uploadGraphs();
+        if (settings->view.accumulatesPhosphor(settings->scope)) {
+            accumulateGraphs();
+            drawPhosphor();
+        } else {
+            phosphor.reset();
+            drawGraph();
+        }
+    }
+
+    // The references are drawn without phosphor, they don't change
+    if (settings->scope.horizontal.format == Dso::GRAPHFORMAT_TY) drawReferences();
+
+    // The mask is drawn over the graphs, so the violations can be seen
+    if (!settings->scope.mask.polygons.empty() && settings->scope.horizontal.format == Dso::GRAPHFORMAT_TY)
+        drawMask();
+
+    // The decoded protocol is drawn over the graphs
+    if (graphs && graphs->annotations && settings->scope.horizontal.format == Dso::GRAPHFORMAT_TY)
+        drawAnnotations();
 
     if (!this->zoomed) {
         // Draw vertical lines at marker positions
@@ -65,6 +186,10 @@ void GlScope::paintGL() {
 
     // Draw grid
     this->drawGrid();
+
+    // The way of the frame ends when it was drawn the first time, the buffers are swapped after this
+    if (graphs) FrameTrace::addDisplayed(graphs->frameId, graphs->timestamp, Instrumentation::now());
+    awaitingSwap = true;
 }
 
 /// \brief Resize the widget.
@@ -72,6 +197,7 @@ void GlScope::paintGL() {
 /// \param height The new height of the widget.
 void GlScope::resizeGL(int width, int height) {
     glViewport(0, 0, (GLint)width, (GLint)height);
+    viewportSize = QSize(width, height);
 
     glMatrixMode(GL_PROJECTION);
 
@@ -86,6 +212,13 @@ void GlScope::resizeGL(int width, int height) {
     glMatrixMode(GL_MODELVIEW);
 }
 
+/// \brief Pushes the modelview matrix and magnifies the area between the markers.
+void GlScope::pushZoomMatrix() {
+    glPushMatrix();
+    glScalef(DIVS_TIME / fabs(settings->scope.horizontal.marker[1] - settings->scope.horizontal.marker[0]), 1.0, 1.0);
+    glTranslatef(-(settings->scope.horizontal.marker[0] + settings->scope.horizontal.marker[1]) / 2, 0.0, 0.0);
+}
+
 /// \brief Set the zoom mode for this GlScope.
 /// \param zoomed true magnifies the area between the markers.
 void GlScope::setZoomMode(bool zoomed) { this->zoomed = zoomed; }
@@ -114,16 +247,218 @@ void GlScope::drawGrid() {
 }
 
 void GlScope::drawGraphDepth(int mode, int channel, int index) {
-    if (generator->channel(mode, channel, index).empty()) return;
+    if (graphs->channel(mode, channel, index).empty()) return;
     QColor trColor;
     if (mode == Dso::CHANNELMODE_VOLTAGE)
         trColor = settings->view.screen.voltage[channel].darker(fadingFactor[index]);
     else
         trColor = settings->view.screen.spectrum[channel].darker(fadingFactor[index]);
-    glColor4f(trColor.redF(), trColor.greenF(), trColor.blueF(), trColor.alphaF());
-    glVertexPointer(2, GL_FLOAT, 0, &generator->channel(mode, channel, index).front());
-    glDrawArrays((settings->view.interpolation == Dso::INTERPOLATION_OFF) ? GL_POINTS : GL_LINE_STRIP, 0,
-                 generator->channel(mode, channel, index).size() / 2);
+    glColor4f(trColor.redF() * graphWeight, trColor.greenF() * graphWeight, trColor.blueF() * graphWeight,
+              trColor.alphaF());
+    const GLenum primitive = (settings->view.interpolation == Dso::INTERPOLATION_OFF) ? GL_POINTS : GL_LINE_STRIP;
+
+    if (useBuffers) {
+        GraphBuffers &graph = graphBuffers[mode][channel];
+        const unsigned int slot = graph.slot(index);
+        if (graph.counts[slot] == 0) return;
+        graph.layers[slot].bind();
+        if (graph.intervals[slot] > 0.0) {
+            drawValues(mode, channel, graph.intervals[slot], graph.starts[slot], primitive, graph.counts[slot]);
+        } else {
+            glVertexPointer(2, GL_FLOAT, 0, nullptr);
+            glDrawArrays(primitive, 0, graph.counts[slot]);
+        }
+        graph.layers[slot].release();
+        return;
+    }
+
+    // The voltages of a spectrum are only transformed into a vertex buffer
+    if (graphs->channel(mode, channel, index).timeDomain) return;
+    const GlGraph &graph = visibleGraph(mode, channel, graphs->channel(mode, channel, index));
+    glVertexPointer(2, GL_FLOAT, 0, vertexPositions(mode, channel, graph));
+    glDrawArrays(primitive, 0, (GLsizei)graph.vertexCount());
+}
+
+/// \brief Draws the values in the bound vertex buffer with the shader.
+/// \param interval The time or frequency between two samples.
+/// \param start The time or frequency of the first sample.
+/// \param primitive The OpenGL primitive.
+/// \param count The number of samples.
+void GlScope::drawValues(int mode, int channel, double interval, double start, GLenum primitive, GLsizei count) {
+    const GraphTransform transform = graphTransform(mode, channel);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    program->bind();
+    program->setUniformValue("scale", (GLfloat)(interval * transform.xScale), (GLfloat)transform.yScale);
+    program->setUniformValue("offset", (GLfloat)(start * transform.xScale - DIVS_TIME / 2),
+                             (GLfloat)transform.yOffset);
+    program->enableAttributeArray(0);
+    program->setAttributeBuffer(0, GL_FLOAT, 0, 1);
+    glDrawArrays(primitive, 0, count);
+    program->disableAttributeArray(0);
+    program->release();
+    glEnableClientState(GL_VERTEX_ARRAY);
+}
+
+/// \return The scaling of the values of a graph with the current settings.
+GlScope::GraphTransform GlScope::graphTransform(int mode, int channel) const {
+    GraphTransform transform;
+    if (mode == Dso::CHANNELMODE_VOLTAGE) {
+        const DsoSettingsScopeVoltage &voltage = settings->scope.voltage[channel];
+        transform.xScale = 1.0 / settings->scope.horizontal.timebase;
+        transform.yScale = (voltage.inverted ? -1.0 : 1.0) / voltage.gain;
+        transform.yOffset = voltage.offset;
+    } else {
+        const DsoSettingsScopeSpectrum &spectrum = settings->scope.spectrum[channel];
+        transform.xScale = 1.0 / settings->scope.horizontal.frequencybase;
+        transform.yScale = 1.0 / spectrum.magnitude;
+        transform.yOffset = spectrum.offset;
+    }
+    return transform;
+}
+
+/// \brief Calculates the vertex positions of a graph on the cpu.
+/// \return The interleaved x/y positions, they stay valid until the next call.
+const GLfloat *GlScope::vertexPositions(int mode, int channel, const GlGraph &graph) {
+    // XY graphs are generated as positions already
+    if (graph.interval <= 0.0) return graph.samples.data();
+
+    const GraphTransform transform = graphTransform(mode, channel);
+    const double xStep = graph.interval * transform.xScale;
+    const double xOffset = graph.start * transform.xScale - DIVS_TIME / 2;
+    positions.resize(graph.samples.size() * 2);
+    std::vector<GLfloat>::iterator position = positions.begin();
+    for (size_t index = 0; index < graph.samples.size(); ++index) {
+        *(position++) = (GLfloat)(index * xStep + xOffset);
+        *(position++) = (GLfloat)(graph.samples[index] * transform.yScale + transform.yOffset);
+    }
+    return positions.data();
+}
+
+/// \brief Gets the range of the graphs that is visible in this scope.
+/// \param left The left end of the range in divs.
+/// \param right The right end of the range in divs.
+void GlScope::visibleRange(double &left, double &right) const {
+    left = -DIVS_TIME / 2;
+    right = DIVS_TIME / 2;
+    if (!zoomed) return;
+    left = std::min(settings->scope.horizontal.marker[0], settings->scope.horizontal.marker[1]);
+    right = std::max(settings->scope.horizontal.marker[0], settings->scope.horizontal.marker[1]);
+}
+
+/// \brief Reduces a graph over time or frequency to the pixel columns of the visible range.
+/// Voltage graphs with sparse samples are interpolated with sin(x)/x instead if it is enabled.
+/// \return The reduced graph or the graph itself if it is small enough, it stays valid until the next call.
+const GlGraph &GlScope::visibleGraph(int mode, int channel, const GlGraph &graph) {
+    double left, right;
+    visibleRange(left, right);
+    // The columns of the whole screen show the visible range
+    const double xScale = graphTransform(mode, channel).xScale;
+    const unsigned int columns = (unsigned)std::max(width(), 1);
+    if (mode == Dso::CHANNELMODE_VOLTAGE && settings->view.interpolation == Dso::INTERPOLATION_SINC &&
+        GlGenerator::interpolate(graph, left, right, xScale, columns, reduced))
+        return reduced;
+    const bool reduce = GlGenerator::decimate(graph, left, right, xScale, columns, reduced);
+    return reduce ? reduced : graph;
+}
+
+/// \brief Brings the vertex buffers up to date with the generator.
+/// After a single new frame the layers only moved by one, so only the newest
+/// layer is uploaded. Other layers are only uploaded if they changed, for
+/// example after several frames or a change of the phosphor depth. With the
+/// shader only the sample values are uploaded, otherwise the positions are
+/// calculated here and have to be uploaded again when the scaling changes.
+/// The graphs are reduced to the pixel columns, so they are reduced again when
+/// the visible range, the size of the widget or the interpolation changes.
+void GlScope::uploadGraphs() {
+    const unsigned int generation = graphs->generation;
+    const unsigned int depth = (unsigned)settings->view.phosphorLayers(settings->scope);
+    const bool nextFrame = generation == uploadedGeneration + 1;
+
+    double left, right;
+    visibleRange(left, right);
+    const bool viewChanged = left != uploadedLeft || right != uploadedRight || width() != uploadedColumns ||
+                             settings->view.interpolation != uploadedInterpolation;
+    uploadedLeft = left;
+    uploadedRight = right;
+    uploadedColumns = width();
+    uploadedInterpolation = settings->view.interpolation;
+
+    for (int mode = Dso::CHANNELMODE_VOLTAGE; mode < Dso::CHANNELMODE_COUNT; ++mode) {
+        graphBuffers[mode].resize((size_t)settings->scope.voltage.count());
+        for (int channel = 0; channel < settings->scope.voltage.count(); ++channel) {
+            GraphBuffers &graph = graphBuffers[mode][channel];
+            if (graph.layers.size() != depth) {
+                for (QOpenGLBuffer &buffer : graph.layers) buffer.destroy();
+                // Copies of a QOpenGLBuffer share its buffer object, so every layer is constructed on its own
+                graph.layers.clear();
+                graph.layers.reserve(depth);
+                for (unsigned int layer = 0; layer < depth; ++layer)
+                    graph.layers.emplace_back(QOpenGLBuffer::VertexBuffer);
+                graph.counts.assign(depth, 0);
+                graph.sources.assign(depth, 0);
+                graph.intervals.assign(depth, 0.0);
+                graph.starts.assign(depth, 0.0);
+                graph.newest = 0;
+                for (QOpenGLBuffer &buffer : graph.layers) {
+                    buffer.create();
+                    buffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+                }
+            } else if (generation != uploadedGeneration) {
+                // The oldest buffer becomes the newest layer
+                graph.newest = (graph.newest + depth - 1) % depth;
+                graph.counts[graph.newest] = 0;
+                graph.sources[graph.newest] = 0;
+            }
+
+            // Graphs that were reduced for another range or positions with an old scaling are outdated
+            const GraphTransform transform = graphTransform(mode, channel);
+            const bool rescaled = viewChanged || graph.transform.xScale != transform.xScale ||
+                                  (!useShaders && graph.transform != transform);
+            graph.transform = transform;
+
+            for (unsigned int index = 0; index < depth; ++index) {
+                const GlGraph &generated = graphs->channel(mode, channel, (int)index);
+                const unsigned int slot = graph.slot((int)index);
+                const size_t source = generated.vertexCount();
+                // The layers behind the newest one are still in the buffers after a single frame
+                if (!rescaled || generated.interval <= 0.0) {
+                    if (nextFrame && index > 0 && graph.sources[slot] == source) continue;
+                    if (!nextFrame && generation == uploadedGeneration && graph.sources[slot] == source) continue;
+                }
+
+                if (generated.timeDomain) {
+                    // The spectrum is transformed from the voltages straight into the buffer
+                    GlSpectrumCompute *compute = useShaders ? shared->spectrumCompute() : nullptr;
+                    double interval = 0.0, start = 0.0;
+                    graph.sources[slot] = source;
+                    graph.counts[slot] = compute ? compute->transform(generated, settings->scope, left, right,
+                                                                      transform.xScale, (unsigned)std::max(width(), 1),
+                                                                      graph.layers[slot], interval, start)
+                                                 : 0;
+                    graph.intervals[slot] = interval;
+                    graph.starts[slot] = start;
+                    continue;
+                }
+
+                const GlGraph &layer = visibleGraph(mode, channel, generated);
+                const GLsizei count = (GLsizei)layer.vertexCount();
+                const bool values = useShaders && layer.interval > 0.0;
+                graph.sources[slot] = source;
+                graph.counts[slot] = count;
+                graph.intervals[slot] = values ? layer.interval : 0.0;
+                graph.starts[slot] = layer.start;
+                if (count == 0) continue;
+                const GLfloat *data = values ? layer.samples.data() : vertexPositions(mode, channel, layer);
+                const int size = (int)((values ? count : count * 2) * sizeof(GLfloat));
+                graph.layers[slot].bind();
+                // Allocating the storage again orphans the old one, the driver doesn't wait until it was drawn
+                graph.layers[slot].allocate(data, size);
+                graph.layers[slot].release();
+            }
+        }
+    }
+    uploadedGeneration = generation;
 }
 
 void GlScope::drawGraph() {
@@ -134,19 +469,14 @@ void GlScope::drawGraph() {
     }
 
     // Apply zoom settings via matrix transformation
-    if (this->zoomed) {
-        glPushMatrix();
-        glScalef(DIVS_TIME / fabs(settings->scope.horizontal.marker[1] - settings->scope.horizontal.marker[0]), 1.0,
-                 1.0);
-        glTranslatef(-(settings->scope.horizontal.marker[0] + settings->scope.horizontal.marker[1]) / 2, 0.0, 0.0);
-    }
+    if (this->zoomed) pushZoomMatrix();
 
     // Values we need for the fading of the digital phosphor
-    if ((int)fadingFactor.size() != settings->view.digitalPhosphorDepth) {
-        fadingFactor.resize((size_t)settings->view.digitalPhosphorDepth);
+    if ((int)fadingFactor.size() != settings->view.phosphorLayers(settings->scope)) {
+        fadingFactor.resize((size_t)settings->view.phosphorLayers(settings->scope));
         fadingFactor[0] = 100;
-        double fadingRatio = pow(10.0, 2.0 / settings->view.digitalPhosphorDepth);
-        for (size_t index = 1; index < (size_t)settings->view.digitalPhosphorDepth; ++index)
+        double fadingRatio = pow(10.0, 2.0 / settings->view.phosphorLayers(settings->scope));
+        for (size_t index = 1; index < (size_t)settings->view.phosphorLayers(settings->scope); ++index)
             fadingFactor[index] = fadingFactor[index - 1] * fadingRatio;
     }
 
@@ -156,9 +486,13 @@ void GlScope::drawGraph() {
         for (int mode = Dso::CHANNELMODE_VOLTAGE; mode < Dso::CHANNELMODE_COUNT; ++mode) {
             for (int channel = 0; channel < settings->scope.voltage.count(); ++channel) {
                 if (!channelUsed(mode, channel)) continue;
+                if (mode == Dso::CHANNELMODE_VOLTAGE && settings->view.persistenceMap && drawPersistence(channel))
+                    continue;
+                if (mode == Dso::CHANNELMODE_SPECTRUM && settings->scope.spectrogram && drawSpectrogram(channel))
+                    continue;
 
                 // Draw graph for all available depths
-                for (int index = settings->view.digitalPhosphorDepth - 1; index >= 0; index--) {
+                for (int index = settings->view.phosphorLayers(settings->scope) - 1; index >= 0; index--) {
                     drawGraphDepth(mode, channel, index);
                 }
             }
@@ -169,7 +503,8 @@ void GlScope::drawGraph() {
         // Real and virtual channels
         for (int channel = 0; channel < settings->scope.voltage.count() - 1; channel += 2) {
             if (settings->scope.voltage[channel].used) {
-                for (int index = settings->view.digitalPhosphorDepth - 1; index >= 0; index--) {
+                if (settings->view.xyDensity && drawPersistence(channel)) continue;
+                for (int index = settings->view.phosphorLayers(settings->scope) - 1; index >= 0; index--) {
                     drawGraphDepth(Dso::CHANNELMODE_VOLTAGE, channel, index);
                 }
             }
@@ -186,6 +521,298 @@ void GlScope::drawGraph() {
     if (this->zoomed) glPopMatrix();
 }
 
+/// \brief Adds the newest graphs to the phosphor image.
+/// The image fades out by exp(-1 / depth) with every frame, the new graphs are
+/// weighted, so a graph that stays the same reaches its full color.
+void GlScope::accumulateGraphs() {
+    double left, right;
+    visibleRange(left, right);
+    if (!phosphor || phosphor->size() != viewportSize || left != phosphorLeft || right != phosphorRight) {
+        // The image is of another range, it is started again
+        QOpenGLFramebufferObjectFormat format;
+        format.setInternalTextureFormat(GL_RGBA16F);
+        phosphor.reset(new QOpenGLFramebufferObject(viewportSize, format));
+        if (!phosphor->isValid()) {
+            phosphor.reset();
+            // The layers are generated again with the next frame, until then only the newest graph is drawn
+            settings->view.phosphorFramebuffers = false;
+            drawGraph();
+            return;
+        }
+        phosphor->bind();
+        glClearColor(0.0, 0.0, 0.0, 0.0);
+        glClear(GL_COLOR_BUFFER_BIT);
+        phosphor->release();
+        QColor bg = settings->view.screen.background;
+        glClearColor(bg.redF(), bg.greenF(), bg.blueF(), bg.alphaF());
+        phosphorLeft = left;
+        phosphorRight = right;
+        accumulatedGeneration = graphs->generation - 1;
+    }
+    if (accumulatedGeneration == graphs->generation) return;
+    accumulatedGeneration = graphs->generation;
+
+    const double decay = std::exp(-1.0 / settings->view.digitalPhosphorDepth);
+    phosphor->bind();
+    // Blending black with the decay as transparency fades the image
+    glColor4f(0.0, 0.0, 0.0, (GLfloat)(1.0 - decay));
+    drawScreenQuad(false);
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    graphWeight = (GLfloat)(1.0 - decay);
+    drawGraph();
+    graphWeight = 1.0;
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    phosphor->release();
+}
+
+/// \brief Adds the phosphor image to the screen.
+void GlScope::drawPhosphor() {
+    glBindTexture(GL_TEXTURE_2D, phosphor->texture());
+    glEnable(GL_TEXTURE_2D);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glColor4f(1.0, 1.0, 1.0, 1.0);
+    drawScreenQuad(true);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/// \brief Draws the reference waveforms with the current gain and offset of their channels.
+/// With the shader the values are uploaded once into a static buffer of all
+/// views, changes of the scaling or the zoom only change the uniforms and the matrix.
+void GlScope::drawReferences() {
+    if (this->zoomed) pushZoomMatrix();
+    const GLenum primitive = (settings->view.interpolation == Dso::INTERPOLATION_OFF) ? GL_POINTS : GL_LINE_STRIP;
+    for (unsigned int slot = 0; slot < ReferenceWaveforms::COUNT; ++slot) {
+        std::shared_ptr<const ReferenceWaveform> waveform = references->get(slot);
+        if (!waveform || (int)waveform->channel >= settings->scope.voltage.count()) {
+            shared->clearReference(slot);
+            continue;
+        }
+
+        const QColor color = ReferenceWaveforms::color(slot);
+        glColor4f(color.redF(), color.greenF(), color.blueF(), color.alphaF());
+        // The waveform begins relative to the trigger
+        const double start =
+            waveform->start + settings->scope.trigger.position * DIVS_TIME * settings->scope.horizontal.timebase;
+        const GLsizei count = (GLsizei)waveform->samples.size();
+        if (useShaders) {
+            QOpenGLBuffer &buffer = shared->bindReference(slot, waveform);
+            drawValues(Dso::CHANNELMODE_VOLTAGE, (int)waveform->channel, waveform->interval, start, primitive,
+                       count);
+            buffer.release();
+            continue;
+        }
+
+        // Without the shader the positions are calculated like the ones of the live graphs
+        const GraphTransform transform = graphTransform(Dso::CHANNELMODE_VOLTAGE, (int)waveform->channel);
+        const double xStep = waveform->interval * transform.xScale;
+        const double xOffset = start * transform.xScale - DIVS_TIME / 2;
+        positions.resize(waveform->samples.size() * 2);
+        std::vector<GLfloat>::iterator position = positions.begin();
+        for (size_t index = 0; index < waveform->samples.size(); ++index) {
+            *(position++) = (GLfloat)(index * xStep + xOffset);
+            *(position++) = (GLfloat)(waveform->samples[index] * transform.yScale + transform.yOffset);
+        }
+        glVertexPointer(2, GL_FLOAT, 0, positions.data());
+        glDrawArrays(primitive, 0, count);
+    }
+    if (this->zoomed) glPopMatrix();
+}
+
+/// \brief Draws the forbidden areas of the mask test.
+/// The mask is rasterized like it is tested, it is only uploaded again when it changed.
+void GlScope::drawMask() {
+    shared->bindMask(settings->scope.mask.polygons);
+
+    // The mask covers the screen, the zoom is applied by the matrix
+    static const GLfloat corners[] = {-DIVS_TIME / 2, -DIVS_VOLTAGE / 2, DIVS_TIME / 2, -DIVS_VOLTAGE / 2,
+                                      DIVS_TIME / 2,  DIVS_VOLTAGE / 2,  -DIVS_TIME / 2, DIVS_VOLTAGE / 2};
+    static const GLfloat textureCorners[] = {0.0, 0.0, 1.0, 0.0, 1.0, 1.0, 0.0, 1.0};
+    if (this->zoomed) pushZoomMatrix();
+    glEnable(GL_TEXTURE_2D);
+    glColor4f(1.0f, 0.25f, 0.25f, 0.3f);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glTexCoordPointer(2, GL_FLOAT, 0, textureCorners);
+    glVertexPointer(2, GL_FLOAT, 0, corners);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (this->zoomed) glPopMatrix();
+}
+
+/// \brief Fills the whole viewport with the current color.
+/// \param textured true maps the bound texture onto the viewport.
+void GlScope::drawScreenQuad(bool textured) {
+    static const GLfloat corners[] = {-1.0, -1.0, 1.0, -1.0, 1.0, 1.0, -1.0, 1.0};
+    static const GLfloat textureCorners[] = {0.0, 0.0, 1.0, 0.0, 1.0, 1.0, 0.0, 1.0};
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    if (textured) {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, 0, textureCorners);
+    }
+    glVertexPointer(2, GL_FLOAT, 0, corners);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    if (textured) glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+}
+
+/// \brief Draws the persistence map of a voltage graph or the density map of a XY graph.
+/// \return false, if the generator has no map for the graph yet.
+bool GlScope::drawPersistence(int channel) {
+    const std::vector<GLubyte> *image = graphs->persistenceImage(channel);
+    if (!image || image->empty()) return false;
+
+    // The map is uploaded once for all views
+    shared->bindPersistence(channel, *image, graphs->generation);
+
+    // The map covers the screen, the zoom is applied by the matrix
+    static const GLfloat corners[] = {-DIVS_TIME / 2, -DIVS_VOLTAGE / 2, DIVS_TIME / 2, -DIVS_VOLTAGE / 2,
+                                      DIVS_TIME / 2,  DIVS_VOLTAGE / 2,  -DIVS_TIME / 2, DIVS_VOLTAGE / 2};
+    static const GLfloat textureCorners[] = {0.0, 0.0, 1.0, 0.0, 1.0, 1.0, 0.0, 1.0};
+    glEnable(GL_TEXTURE_2D);
+    glColor4f(1.0, 1.0, 1.0, 1.0);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glTexCoordPointer(2, GL_FLOAT, 0, textureCorners);
+    glVertexPointer(2, GL_FLOAT, 0, corners);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+/// \brief Draws the waterfall of a spectrum graph, the newest spectrum at the top.
+/// Only the rows that were added since the last upload of any view are copied
+/// into the texture, the ring scrolls by shifting the texture coordinates.
+/// \return false, if the generator has no waterfall for the graph yet.
+bool GlScope::drawSpectrogram(int channel) {
+    std::shared_ptr<const Spectrogram> source = graphs->spectrogram(channel);
+    if (!source) return false;
+
+    // The oldest row is at the bottom and the newest one at the top, the zoom is applied by the matrix
+    const GLfloat top = shared->bindSpectrogram(channel, source);
+    static const GLfloat corners[] = {-DIVS_TIME / 2, -DIVS_VOLTAGE / 2, DIVS_TIME / 2, -DIVS_VOLTAGE / 2,
+                                      DIVS_TIME / 2,  DIVS_VOLTAGE / 2,  -DIVS_TIME / 2, DIVS_VOLTAGE / 2};
+    const GLfloat textureCorners[] = {0.0, top - 1.0f, 1.0, top - 1.0f, 1.0, top, 0.0, top};
+    glEnable(GL_TEXTURE_2D);
+    glColor4f(1.0, 1.0, 1.0, 1.0);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glTexCoordPointer(2, GL_FLOAT, 0, textureCorners);
+    glVertexPointer(2, GL_FLOAT, 0, corners);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+/// \brief Draws the annotations of the protocol decoder as boxes with their text.
+/// The boxes are drawn in divs, the texts are painted into a texture that
+/// covers the viewport. The texture is only painted again if the annotations
+/// or the visible range changed, a text is left out if its box is too narrow.
+void GlScope::drawAnnotations() {
+    double left, right;
+    visibleRange(left, right);
+    const double xScale = 1.0 / settings->scope.horizontal.timebase;
+    const GLfloat bottom = (GLfloat)(-DIVS_VOLTAGE / 2 + ANNOTATION_BOTTOM);
+    const GLfloat top = (GLfloat)(-DIVS_VOLTAGE / 2 + ANNOTATION_TOP);
+
+    annotationBoxes.clear();
+    annotationErrors.clear();
+    annotationOutlines.clear();
+    for (const ProtocolAnnotation &annotation : *graphs->annotations) {
+        const GLfloat start = (GLfloat)(annotation.start * xScale - DIVS_TIME / 2);
+        const GLfloat end = (GLfloat)(annotation.end * xScale - DIVS_TIME / 2);
+        if (end < left || start > right) continue;
+        std::vector<GLfloat> &boxes = annotation.error ? annotationErrors : annotationBoxes;
+        boxes.insert(boxes.end(), {start, bottom, end, bottom, end, top, start, bottom, end, top, start, top});
+        // Conditions without a length are only the vertical lines
+        annotationOutlines.insert(annotationOutlines.end(),
+                                  {start, bottom, start, top, end, bottom, end, top, start, bottom, end, bottom});
+    }
+
+    const unsigned int source = settings->scope.decoder.sources[0];
+    const QColor color = (source < (unsigned)settings->view.screen.voltage.size())
+                             ? settings->view.screen.voltage[(int)source]
+                             : settings->view.screen.text;
+    if (this->zoomed) pushZoomMatrix();
+    glColor4f(color.redF(), color.greenF(), color.blueF(), 0.25f);
+    glVertexPointer(2, GL_FLOAT, 0, annotationBoxes.data());
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(annotationBoxes.size() / 2));
+    glColor4f(1.0f, 0.25f, 0.25f, 0.5f);
+    glVertexPointer(2, GL_FLOAT, 0, annotationErrors.data());
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(annotationErrors.size() / 2));
+    glColor4f(color.redF(), color.greenF(), color.blueF(), color.alphaF());
+    glVertexPointer(2, GL_FLOAT, 0, annotationOutlines.data());
+    glDrawArrays(GL_LINES, 0, (GLsizei)(annotationOutlines.size() / 2));
+    if (this->zoomed) glPopMatrix();
+
+    if (labelTexture == 0) {
+        glGenTextures(1, &labelTexture);
+        glBindTexture(GL_TEXTURE_2D, labelTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        labeledAnnotations.reset();
+    } else {
+        glBindTexture(GL_TEXTURE_2D, labelTexture);
+    }
+    if (labeledAnnotations != graphs->annotations || labeledLeft != left || labeledRight != right ||
+        labeledSize != viewportSize) {
+        labeledAnnotations = graphs->annotations;
+        labeledLeft = left;
+        labeledRight = right;
+        labeledSize = viewportSize;
+
+        QImage labels(viewportSize, QImage::Format_RGBA8888_Premultiplied);
+        labels.fill(Qt::transparent);
+        {
+            QPainter painter(&labels);
+            painter.setFont(font());
+            painter.setPen(settings->view.screen.text);
+            const QFontMetrics metrics = painter.fontMetrics();
+            const double pixels = labels.width() / (right - left);
+            const QRectF row(0.0, labels.height() * (1.0 - ANNOTATION_TOP / DIVS_VOLTAGE), 0.0,
+                             labels.height() * (ANNOTATION_TOP - ANNOTATION_BOTTOM) / DIVS_VOLTAGE);
+            for (const ProtocolAnnotation &annotation : *graphs->annotations) {
+                const double start = (annotation.start * xScale - DIVS_TIME / 2 - left) * pixels;
+                const double end = (annotation.end * xScale - DIVS_TIME / 2 - left) * pixels;
+                if (end < 0.0 || start > labels.width() || end - start < metrics.size(0, annotation.text).width() + 4)
+                    continue;
+                painter.drawText(QRectF(start, row.top(), end - start, row.height()), Qt::AlignCenter,
+                                 annotation.text);
+            }
+        }
+        // The rows of the texture begin at the bottom
+        labels = labels.mirrored();
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, labels.width(), labels.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     labels.constBits());
+    }
+
+    glEnable(GL_TEXTURE_2D);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glColor4f(1.0, 1.0, 1.0, 1.0);
+    drawScreenQuad(true);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 bool GlScope::channelUsed(int mode, int channel) {
     return (mode == Dso::CHANNELMODE_VOLTAGE) ? settings->scope.voltage[channel].used
                                               : settings->scope.spectrum[channel].used;
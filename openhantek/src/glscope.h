@@ -3,50 +3,154 @@
 #pragma once
 
 #include <QMetaObject>
-#include <QtGlobal>
-#include <array>
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 4, 0))
+#include <QOpenGLBuffer>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLShaderProgram>
 #include <QOpenGLWidget>
-using GL_WIDGET_CLASS = QOpenGLWidget;
-#else
-#include <QGLWidget>
-using GL_WIDGET_CLASS = QGLWidget;
-#endif
+#include <QtGlobal>
+#include <memory>
+#include <vector>
 
 #include "definitions.h"
+#include "glgenerator.h"
+#include "referencewaveforms.h"
+#include "updatethrottle.h"
 
-class GlGenerator;
 class DsoSettings;
+class GlSharedResources;
 
 ////////////////////////////////////////////////////////////////////////////////
 /// \class GlScope                                                     glscope.h
 /// \brief OpenGL accelerated widget that displays the oscilloscope screen.
-class GlScope : public GL_WIDGET_CLASS {
+class GlScope : public QOpenGLWidget {
     Q_OBJECT
 
   public:
     /// \brief Initializes the scope widget.
     /// \param settings The settings that should be used.
+    /// \param generator The generator of the live graphs.
+    /// \param references The reference waveforms that are drawn with the live graphs.
+    /// \param shared The textures and buffers of all scope views, it has to outlive the painting.
     /// \param parent The parent widget.
-    GlScope(DsoSettings *settings, const GlGenerator *generator, QWidget *parent = 0);
+    GlScope(DsoSettings *settings, const GlGenerator *generator, const ReferenceWaveforms *references,
+            GlSharedResources *shared, QWidget *parent = 0);
+    ~GlScope();
 
     void setZoomMode(bool zoomed);
 
+    /// \brief Schedules a repaint with the newest graphs.
+    /// The requests are limited to the refresh rate of the display, the maximum
+    /// frame rate of the view settings and one paint per swap of the buffers.
+    /// Nothing is painted while the window is minimized.
+    void requestRender();
+
+    static const int IDLE_RATE = 4; ///< The frame rate while the window is in the background with power saving
+
+  signals:
+    /// \brief Tells if the spectra can be calculated on the gpu, emitted when the context is initialized.
+    void spectrumComputeAvailable(bool available);
+
   protected:
     void initializeGL() override;
     void paintGL() override;
     void resizeGL(int width, int height) override;
+    void showEvent(QShowEvent *event) override;
+
+    void render();
+    void frameSwapped();
 
     void drawGrid();
     void drawGraphDepth(int mode, int channel, int index);
     void drawGraph();
     bool channelUsed(int mode, int channel);
+    void uploadGraphs();
+    void accumulateGraphs();
+    void drawPhosphor();
+    void drawScreenQuad(bool textured);
+    bool drawPersistence(int channel);
+    bool drawSpectrogram(int channel);
+    void drawAnnotations();
+    void drawMask();
+    void drawReferences();
+    void pushZoomMatrix();
 
   private:
+    /// \brief Maps the sample values of a graph to divs.
+    struct GraphTransform {
+        double xScale = 0.0;  ///< Divs per second or hertz
+        double yScale = 0.0;  ///< Divs per volt or decibel
+        double yOffset = 0.0; ///< The vertical position of the zero line in divs
+
+        bool operator!=(const GraphTransform &other) const {
+            return xScale != other.xScale || yScale != other.yScale || yOffset != other.yOffset;
+        }
+    };
+
+    /// \brief The vertex buffers of the phosphor layers of one graph.
+    /// The buffers are used as ring, so only the newest layer has to be uploaded for a new frame.
+    struct GraphBuffers {
+        std::vector<QOpenGLBuffer> layers; ///< The buffer of every layer
+        std::vector<GLsizei> counts;       ///< The number of vertices in every buffer
+        std::vector<size_t> sources;       ///< The number of generated vertices a buffer was made from
+        std::vector<double> intervals;     ///< The sample interval of the values in a buffer, 0 for positions
+        std::vector<double> starts;        ///< The time or frequency of the first value in a buffer
+        GraphTransform transform;          ///< The transform of the positions calculated on the cpu
+        unsigned int newest = 0;           ///< The buffer of the newest layer
+
+        unsigned int slot(int index) const { return (newest + (unsigned)index) % layers.size(); }
+    };
+
+    GraphTransform graphTransform(int mode, int channel) const;
+    const GLfloat *vertexPositions(int mode, int channel, const GlGraph &graph);
+    const GlGraph &visibleGraph(int mode, int channel, const GlGraph &graph);
+    void visibleRange(double &left, double &right) const;
+    void drawValues(int mode, int channel, double interval, double start, GLenum primitive, GLsizei count);
+
     DsoSettings *settings;
     const GlGenerator *generator;
+    const ReferenceWaveforms *references;
+    GlSharedResources *shared; ///< The objects that are uploaded once for all views
+    std::shared_ptr<const GlGraphs> graphs; ///< The graphs that are drawn
     std::vector<double> fadingFactor;
 
     std::vector<GLfloat> vaMarker[2];
     bool zoomed = false;
+
+    UpdateThrottle renderThrottle; ///< Limits the paints to the frame rate
+    bool awaitingSwap = false;     ///< true, if the last paint hasn't been shown yet
+    bool renderPending = false;    ///< true, if a paint was requested while it couldn't be done
+
+    bool useBuffers = false;             ///< true, if the graphs are drawn from vertex buffers
+    bool useShaders = false;             ///< true, if the vertex shader calculates the positions of the samples
+    unsigned int uploadedGeneration = 0; ///< The generator frame that is in the buffers
+
+    std::unique_ptr<QOpenGLShaderProgram> program; ///< Turns the sample values into vertices
+    std::vector<GLfloat> positions;                ///< The positions of a graph if there is no shader
+    GlGraph reduced;                               ///< The graph reduced to the pixel columns
+
+    // The visible range the buffers were reduced for
+    double uploadedLeft = 0.0;
+    double uploadedRight = 0.0;
+    int uploadedColumns = 0;
+    Dso::InterpolationMode uploadedInterpolation = Dso::INTERPOLATION_OFF;
+
+    std::unique_ptr<QOpenGLFramebufferObject> phosphor; ///< The accumulated graphs of the intensity graded phosphor
+    unsigned int accumulatedGeneration = 0;             ///< The newest generator frame in the phosphor image
+    double phosphorLeft = 0.0;                          ///< The visible range of the phosphor image
+    double phosphorRight = 0.0;
+    QSize viewportSize;
+    GLfloat graphWeight = 1.0; ///< Scales the colors of the graphs
+
+    std::vector<GLfloat> annotationBoxes;    ///< The triangles of the annotation boxes
+    std::vector<GLfloat> annotationErrors;   ///< The triangles of the boxes of annotations with errors
+    std::vector<GLfloat> annotationOutlines; ///< The lines around the annotation boxes
+    GLuint labelTexture = 0;                 ///< The texts of the annotations
+    /// The annotations and the visible range the texts were painted for
+    std::shared_ptr<const std::vector<ProtocolAnnotation>> labeledAnnotations;
+    double labeledLeft = 0.0;
+    double labeledRight = 0.0;
+    QSize labeledSize;
+
+    /// The vertex buffers of every graph
+    std::vector<GraphBuffers> graphBuffers[Dso::CHANNELMODE_COUNT];
 };
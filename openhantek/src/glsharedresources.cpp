@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include "glsharedresources.h"
+
+#include "masktest.h"
+#include "persistencemap.h"
+#include "spectrogram.h"
+
+GlSharedResources::~GlSharedResources() {
+    // The views may already be gone, every context of the share group can free the objects
+    QOpenGLContext *context = QOpenGLContext::globalShareContext();
+    if (!context) return;
+    QOffscreenSurface surface;
+    surface.setFormat(context->format());
+    surface.create();
+    if (!context->makeCurrent(&surface)) return;
+
+    for (ReferenceBuffer &reference : referenceBuffers) reference.buffer.destroy();
+    for (GLuint texture : persistenceTextures)
+        if (texture) glDeleteTextures(1, &texture);
+    for (SpectrogramTexture &spectrogram : spectrogramTextures)
+        if (spectrogram.texture) glDeleteTextures(1, &spectrogram.texture);
+    if (maskTexture) glDeleteTextures(1, &maskTexture);
+    if (compute) compute->destroy();
+    context->doneCurrent();
+}
+
+void GlSharedResources::bindPersistence(int channel, const std::vector<GLubyte> &image, unsigned int generation) {
+    if (persistenceTextures.size() <= (size_t)channel) {
+        persistenceTextures.resize((size_t)channel + 1, 0);
+        persistenceUploads.resize((size_t)channel + 1, 0);
+    }
+    GLuint &texture = persistenceTextures[(size_t)channel];
+    unsigned int &uploaded = persistenceUploads[(size_t)channel];
+    if (texture == 0) {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, PersistenceMap::WIDTH, PersistenceMap::HEIGHT, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, image.data());
+        uploaded = generation;
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    // The map only changes with a new frame, a view that paints an older frame keeps the newer map
+    if ((int)(generation - uploaded) > 0) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, PersistenceMap::WIDTH, PersistenceMap::HEIGHT, GL_RGBA,
+                        GL_UNSIGNED_BYTE, image.data());
+        uploaded = generation;
+    }
+}
+
+GLfloat GlSharedResources::bindSpectrogram(int channel, const std::shared_ptr<const Spectrogram> &source) {
+    if (spectrogramTextures.size() <= (size_t)channel) spectrogramTextures.resize((size_t)channel + 1);
+    SpectrogramTexture &spectrogram = spectrogramTextures[(size_t)channel];
+    if (spectrogram.texture == 0) {
+        glGenTextures(1, &spectrogram.texture);
+        glBindTexture(GL_TEXTURE_2D, spectrogram.texture);
+        // The rows must not be blended with the other end of the ring
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, Spectrogram::WIDTH, Spectrogram::HEIGHT, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, nullptr);
+        spectrogram.source.reset();
+    } else {
+        glBindTexture(GL_TEXTURE_2D, spectrogram.texture);
+    }
+    if (spectrogram.source != source) {
+        spectrogram.source = source;
+        spectrogram.revision = 0;
+    }
+
+    unsigned int first = 0;
+    const unsigned int count = source->changes(spectrogram.revision, spectrogramRows, first);
+    if (count > 0) {
+        // The new rows wrap around the end of the ring
+        const unsigned int tail = std::min(count, Spectrogram::HEIGHT - first);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, (GLint)first, Spectrogram::WIDTH, (GLsizei)tail, GL_RGBA,
+                        GL_UNSIGNED_BYTE, spectrogramRows.data());
+        if (count > tail)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Spectrogram::WIDTH, (GLsizei)(count - tail), GL_RGBA,
+                            GL_UNSIGNED_BYTE, spectrogramRows.data() + (size_t)tail * Spectrogram::WIDTH * 4);
+        spectrogram.next = (first + count) % Spectrogram::HEIGHT;
+    }
+    return (GLfloat)spectrogram.next / Spectrogram::HEIGHT;
+}
+
+QOpenGLBuffer &GlSharedResources::bindReference(unsigned int slot,
+                                                const std::shared_ptr<const ReferenceWaveform> &waveform) {
+    ReferenceBuffer &reference = referenceBuffers[slot];
+    if (!reference.buffer.isCreated()) {
+        reference.buffer.create();
+        reference.buffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    }
+    reference.buffer.bind();
+    if (reference.source != waveform) {
+        reference.buffer.allocate(waveform->samples.data(), (int)(waveform->samples.size() * sizeof(GLfloat)));
+        reference.source = waveform;
+    }
+    return reference.buffer;
+}
+
+void GlSharedResources::clearReference(unsigned int slot) {
+    ReferenceBuffer &reference = referenceBuffers[slot];
+    reference.buffer.destroy();
+    reference.source.reset();
+}
+
+void GlSharedResources::bindMask(const std::vector<QPolygonF> &polygons) {
+    const bool created = maskTexture == 0;
+    if (created) {
+        glGenTextures(1, &maskTexture);
+        glBindTexture(GL_TEXTURE_2D, maskTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    } else
+        glBindTexture(GL_TEXTURE_2D, maskTexture);
+    if (created || maskPolygons != polygons) {
+        maskPolygons = polygons;
+        std::vector<quint8> pixels;
+        MaskTest::rasterize(maskPolygons, pixels);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, MaskTest::WIDTH, MaskTest::HEIGHT, 0, GL_ALPHA, GL_UNSIGNED_BYTE,
+                     pixels.data());
+    }
+}
+
+GlSpectrumCompute *GlSharedResources::spectrumCompute() {
+    if (!computeChecked) {
+        computeChecked = true;
+        compute.reset(new GlSpectrumCompute());
+        if (!compute->initialize()) compute.reset();
+    }
+    return compute.get();
+}
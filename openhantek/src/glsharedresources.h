@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QOpenGLBuffer>
+#include <QPolygonF>
+#include <QtGlobal>
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "glspectrumcompute.h"
+#include "referencewaveforms.h"
+
+class Spectrogram;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class GlSharedResources                                 glsharedresources.h
+/// \brief The textures and buffers that look the same in every scope view.
+/// The persistence maps, the waterfalls, the reference waveforms and the mask
+/// don't depend on the visible range, so they are uploaded once for all views.
+/// The contexts of the views share their objects, the application enables
+/// Qt::AA_ShareOpenGLContexts. Every function has to be called with the
+/// context of a view current, the objects are freed in the global share context.
+class GlSharedResources {
+  public:
+    GlSharedResources() = default;
+    GlSharedResources(const GlSharedResources &) = delete;
+    GlSharedResources &operator=(const GlSharedResources &) = delete;
+    ~GlSharedResources();
+
+    /// \brief Binds the texture of the persistence map or density map of a channel.
+    /// \param channel The channel.
+    /// \param image The RGBA pixels of the map.
+    /// \param generation The generator frame of the map, a map of a newer frame is uploaded.
+    void bindPersistence(int channel, const std::vector<GLubyte> &image, unsigned int generation);
+
+    /// \brief Binds the texture of the waterfall of a channel, the new rows are uploaded.
+    /// \param channel The channel.
+    /// \param source The waterfall of the channel.
+    /// \return The texture row after the newest row, relative to the height.
+    GLfloat bindSpectrogram(int channel, const std::shared_ptr<const Spectrogram> &source);
+
+    /// \brief Binds the vertex buffer of a reference waveform, the waveform is uploaded once.
+    /// \param slot The slot of the waveform.
+    /// \param waveform The waveform in the slot.
+    /// \return The bound buffer.
+    QOpenGLBuffer &bindReference(unsigned int slot, const std::shared_ptr<const ReferenceWaveform> &waveform);
+
+    /// \brief Frees the vertex buffer of an empty reference slot.
+    void clearReference(unsigned int slot);
+
+    /// \brief Binds the texture of the forbidden areas of the mask test.
+    /// \param polygons The mask, it is rasterized again if it changed.
+    void bindMask(const std::vector<QPolygonF> &polygons);
+
+    /// \brief Gets the gpu transform of the spectra, the shaders are compiled by the first call.
+    /// \return The transform, nullptr if the contexts have no compute shaders.
+    GlSpectrumCompute *spectrumCompute();
+
+  private:
+    std::vector<GLuint> persistenceTextures;      ///< The colored persistence maps of the voltage graphs
+    std::vector<unsigned int> persistenceUploads; ///< The generator frame in every texture
+
+    /// \brief The texture of the waterfall of a spectrum graph.
+    struct SpectrogramTexture {
+        GLuint texture = 0;
+        std::shared_ptr<const Spectrogram> source; ///< The waterfall in the texture
+        quint64 revision = 0;                      ///< The revision of the uploaded rows
+        unsigned int next = 0;                     ///< The row after the newest uploaded row
+    };
+    std::vector<SpectrogramTexture> spectrogramTextures; ///< The waterfalls of the spectrum graphs
+    std::vector<quint8> spectrogramRows;                 ///< The rows that are uploaded
+
+    /// \brief The vertex buffer of a reference waveform, the waveform never changes, so it is uploaded once.
+    struct ReferenceBuffer {
+        QOpenGLBuffer buffer;
+        std::shared_ptr<const ReferenceWaveform> source; ///< The waveform in the buffer
+    };
+    std::array<ReferenceBuffer, ReferenceWaveforms::COUNT> referenceBuffers;
+
+    GLuint maskTexture = 0;              ///< The forbidden areas of the mask test
+    std::vector<QPolygonF> maskPolygons; ///< The mask in the texture
+
+    std::unique_ptr<GlSpectrumCompute> compute; ///< The transform of the spectra, nullptr if not supported
+    bool computeChecked = false;                ///< true, if the support of compute shaders was checked
+};
@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cmath>
+
+#include <QByteArray>
+#include <QOpenGLContext>
+
+#include "glspectrumcompute.h"
+
+#include "glgenerator.h"
+#include "viewconstants.h"
+#include "windowcache.h"
+
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+
+const unsigned int GlSpectrumCompute::MIN_LENGTH;
+const unsigned int GlSpectrumCompute::MAX_LENGTH;
+const unsigned int GlSpectrumCompute::GROUP_SIZE;
+
+namespace {
+// The buffers are bound to fixed points, every shader declares the ones it uses
+const GLuint BINDING_SAMPLES = 0;
+const GLuint BINDING_WINDOW = 1;
+const GLuint BINDING_BINS = 2;
+const GLuint BINDING_LEVELS = 3;
+const GLuint BINDING_PEAKS = 4;
+
+/// Multiplies the samples with the window and stores them in bit reversed order for the butterflies
+const char *const WINDOW_SHADER = "layout(std430, binding = 0) readonly buffer Samples { float samples[]; };\n"
+                                  "layout(std430, binding = 1) readonly buffer Window { float window[]; };\n"
+                                  "layout(std430, binding = 2) writeonly buffer Bins { vec2 bins[]; };\n"
+                                  "uniform int count;\n"
+                                  "uniform int bits;\n"
+                                  "void main() {\n"
+                                  "    uint index = gl_GlobalInvocationID.x;\n"
+                                  "    if (index >= uint(count)) return;\n"
+                                  "    uint reversed = bitfieldReverse(index) >> uint(32 - bits);\n"
+                                  "    bins[reversed] = vec2(samples[index] * window[index], 0.0);\n"
+                                  "}\n";
+/// One radix-2 stage of the transform in place, every invocation combines two bins
+const char *const BUTTERFLY_SHADER = "layout(std430, binding = 2) buffer Bins { vec2 bins[]; };\n"
+                                     "uniform int count;\n"
+                                     "uniform int span;\n"
+                                     "void main() {\n"
+                                     "    uint index = gl_GlobalInvocationID.x;\n"
+                                     "    if (index >= uint(count / 2)) return;\n"
+                                     "    uint step = uint(span);\n"
+                                     "    uint offset = index & (step - 1u);\n"
+                                     "    uint first = ((index - offset) << 1) + offset;\n"
+                                     "    float angle = -3.14159265358979 * float(offset) / float(step);\n"
+                                     "    vec2 twiddle = vec2(cos(angle), sin(angle));\n"
+                                     "    vec2 odd = bins[first + step];\n"
+                                     "    odd = vec2(odd.x * twiddle.x - odd.y * twiddle.y,\n"
+                                     "               odd.x * twiddle.y + odd.y * twiddle.x);\n"
+                                     "    vec2 even = bins[first];\n"
+                                     "    bins[first] = even + odd;\n"
+                                     "    bins[first + step] = even - odd;\n"
+                                     "}\n";
+/// The levels in dB like Analysis::complexPower()
+const char *const POWER_SHADER = "layout(std430, binding = 2) readonly buffer Bins { vec2 bins[]; };\n"
+                                 "layout(std430, binding = 3) writeonly buffer Levels { float levels[]; };\n"
+                                 "uniform int count;\n"
+                                 "uniform float factor;\n"
+                                 "uniform float offset;\n"
+                                 "uniform float limit;\n"
+                                 "void main() {\n"
+                                 "    uint index = gl_GlobalInvocationID.x;\n"
+                                 "    if (index >= uint(count)) return;\n"
+                                 "    float power = dot(bins[index], bins[index]) * factor;\n"
+                                 "    levels[index] = (power > 0.0)\n"
+                                 "                    ? max(3.01029995664 * log2(power) + offset, limit) : limit;\n"
+                                 "}\n";
+/// The minimum and maximum of every bucket in the order of the bins, like GlGenerator::decimate()
+const char *const DECIMATE_SHADER = "layout(std430, binding = 3) readonly buffer Levels { float levels[]; };\n"
+                                    "layout(std430, binding = 4) writeonly buffer Peaks { float peaks[]; };\n"
+                                    "uniform int first;\n"
+                                    "uniform int last;\n"
+                                    "uniform int bucket;\n"
+                                    "uniform int buckets;\n"
+                                    "void main() {\n"
+                                    "    uint index = gl_GlobalInvocationID.x;\n"
+                                    "    if (index >= uint(buckets)) return;\n"
+                                    "    int begin = first + int(index) * bucket;\n"
+                                    "    int end = min(begin + bucket, last);\n"
+                                    "    int lowest = begin;\n"
+                                    "    int highest = begin;\n"
+                                    "    for (int position = begin + 1; position < end; ++position) {\n"
+                                    "        if (levels[position] < levels[lowest]) lowest = position;\n"
+                                    "        if (levels[position] >= levels[highest]) highest = position;\n"
+                                    "    }\n"
+                                    "    peaks[2u * index] = levels[min(lowest, highest)];\n"
+                                    "    peaks[2u * index + 1u] = levels[max(lowest, highest)];\n"
+                                    "}\n";
+
+/// \brief Compiles a compute shader with the work group size of the class.
+/// \return The linked program, nullptr if it couldn't be compiled.
+std::unique_ptr<QOpenGLShaderProgram> computeProgram(const char *body) {
+    const QByteArray source = QByteArray("#version 430\nlayout(local_size_x = ") +
+                              QByteArray::number(GlSpectrumCompute::GROUP_SIZE) + ") in;\n" + body;
+    std::unique_ptr<QOpenGLShaderProgram> program(new QOpenGLShaderProgram());
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Compute, source) || !program->link()) program.reset();
+    return program;
+}
+} // namespace
+
+bool GlSpectrumCompute::initialize() {
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (!context || context->isOpenGLES() || context->format().version() < qMakePair(4, 3)) return false;
+
+    dispatchCompute = reinterpret_cast<DispatchComputeFunction>(context->getProcAddress("glDispatchCompute"));
+    memoryBarrier = reinterpret_cast<MemoryBarrierFunction>(context->getProcAddress("glMemoryBarrier"));
+    bindBufferBase = reinterpret_cast<BindBufferBaseFunction>(context->getProcAddress("glBindBufferBase"));
+    if (!dispatchCompute || !memoryBarrier || !bindBufferBase) return false;
+
+    windowProgram = computeProgram(WINDOW_SHADER);
+    butterflyProgram = computeProgram(BUTTERFLY_SHADER);
+    powerProgram = computeProgram(POWER_SHADER);
+    decimateProgram = computeProgram(DECIMATE_SHADER);
+    if (!windowProgram || !butterflyProgram || !powerProgram || !decimateProgram) {
+        destroy();
+        return false;
+    }
+
+    for (QOpenGLBuffer *buffer : {&samples, &window, &bins, &levels}) {
+        buffer->create();
+        buffer->setUsagePattern(QOpenGLBuffer::StreamDraw);
+    }
+    return true;
+}
+
+void GlSpectrumCompute::destroy() {
+    windowProgram.reset();
+    butterflyProgram.reset();
+    powerProgram.reset();
+    decimateProgram.reset();
+    for (QOpenGLBuffer *buffer : {&samples, &window, &bins, &levels}) buffer->destroy();
+    binsCapacity = 0;
+    levelsCapacity = 0;
+    windowLength = 0;
+}
+
+GLsizei GlSpectrumCompute::transform(const GlGraph &graph, const DsoSettingsScope &scope, double left, double right,
+                                     double xScale, unsigned int columns, QOpenGLBuffer &target, double &interval,
+                                     double &start) {
+    interval = 0.0;
+    start = 0.0;
+    if (!windowProgram || graph.interval <= 0.0) return 0;
+
+    // The radix-2 transform takes the largest power of two samples that fits into the record
+    unsigned int length = 1;
+    unsigned int bits = 0;
+    while ((size_t)length * 2 <= graph.samples.size() && length < MAX_LENGTH) {
+        length *= 2;
+        ++bits;
+    }
+    if (length < MIN_LENGTH) return 0;
+    const unsigned int dftLength = length / 2;
+    const unsigned int binCount = dftLength + 1;
+    const double binWidth = 1.0 / graph.interval / length;
+
+    // The window only changes with the function or the record length
+    if (windowFunction != scope.spectrumWindow || windowLength != length) {
+        const WindowCache::Window cached = WindowCache::instance().window(scope.spectrumWindow, length);
+        coefficients.assign(cached->begin(), cached->end());
+        window.bind();
+        window.allocate(coefficients.data(), (int)(length * sizeof(GLfloat)));
+        window.release();
+        windowFunction = scope.spectrumWindow;
+        windowLength = length;
+    }
+    samples.bind();
+    // Allocating the storage again orphans the old one, the driver doesn't wait until it was read
+    samples.allocate(graph.samples.data(), (int)(length * sizeof(GLfloat)));
+    samples.release();
+    reserve(bins, (size_t)length * 2 * sizeof(GLfloat), binsCapacity);
+
+    // The levels are only reduced with more than two bins in a column, see GlGenerator::decimate()
+    size_t bucket = 0, first = 0, last = binCount;
+    const double step = binWidth * xScale;
+    if (columns > 0 && right > left && step > 0.0) bucket = (size_t)((right - left) / step / columns);
+    const bool reduce = bucket > 2;
+    if (reduce) {
+        // The buckets start at multiples of their size, so the peaks don't jump while the range is moved
+        const double origin = graph.start * xScale - DIVS_TIME / 2;
+        const double firstBucket = std::floor((left - origin) / step / bucket);
+        const double lastBucket = std::ceil((right - origin) / step / bucket);
+        first = std::min((size_t)std::max(firstBucket, 0.0) * bucket, (size_t)binCount);
+        last = std::min((size_t)std::max(lastBucket + 1.0, 0.0) * bucket, (size_t)binCount);
+    }
+    const size_t buckets = reduce ? (last - first + bucket - 1) / bucket : 0;
+    const GLsizei count = (GLsizei)(reduce ? buckets * 2 : binCount);
+    if (count == 0) return 0;
+    target.bind();
+    target.allocate((int)(count * sizeof(GLfloat)));
+    target.release();
+
+    bindStorage(BINDING_SAMPLES, samples);
+    bindStorage(BINDING_WINDOW, window);
+    bindStorage(BINDING_BINS, bins);
+    windowProgram->bind();
+    windowProgram->setUniformValue("count", (GLint)length);
+    windowProgram->setUniformValue("bits", (GLint)bits);
+    dispatch(length);
+
+    butterflyProgram->bind();
+    butterflyProgram->setUniformValue("count", (GLint)length);
+    for (unsigned int span = 1; span < length; span *= 2) {
+        butterflyProgram->setUniformValue("span", (GLint)span);
+        dispatch(dftLength);
+    }
+
+    // The levels are scaled like the spectrum of the analyzer
+    const double correctionFactor = 1.0 / dftLength / dftLength;
+    const double offset = 60 - scope.spectrumReference - 20 * log10(dftLength) - 10 * log10(correctionFactor);
+    if (reduce) reserve(levels, (size_t)binCount * sizeof(GLfloat), levelsCapacity);
+    bindStorage(BINDING_LEVELS, reduce ? levels : target);
+    powerProgram->bind();
+    powerProgram->setUniformValue("count", (GLint)binCount);
+    powerProgram->setUniformValue("factor", (GLfloat)correctionFactor);
+    powerProgram->setUniformValue("offset", (GLfloat)offset);
+    powerProgram->setUniformValue("limit", (GLfloat)(scope.spectrumLimit - scope.spectrumReference));
+    dispatch(binCount);
+
+    interval = binWidth;
+    start = graph.start;
+    if (reduce) {
+        bindStorage(BINDING_PEAKS, target);
+        decimateProgram->bind();
+        decimateProgram->setUniformValue("first", (GLint)first);
+        decimateProgram->setUniformValue("last", (GLint)last);
+        decimateProgram->setUniformValue("bucket", (GLint)bucket);
+        decimateProgram->setUniformValue("buckets", (GLint)buckets);
+        dispatch((unsigned int)buckets);
+        interval = binWidth * bucket / 2;
+        start = graph.start + first * binWidth;
+    }
+    (reduce ? decimateProgram : powerProgram)->release();
+
+    // The vertex shader reads the target as attribute array
+    memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    return count;
+}
+
+/// \brief Binds a buffer to a binding point of the shader storage.
+void GlSpectrumCompute::bindStorage(GLuint binding, const QOpenGLBuffer &buffer) {
+    bindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer.bufferId());
+}
+
+/// \brief Runs the bound program and waits with the next one until its results are written.
+/// \param invocations The number of invocations, the shaders skip the ones beyond their count.
+void GlSpectrumCompute::dispatch(unsigned int invocations) {
+    dispatchCompute((invocations + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+    memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+/// \brief Grows the storage of a buffer, its content is undefined afterwards.
+/// \param buffer The buffer.
+/// \param size The needed size in bytes.
+/// \param capacity The current size of the storage, it is updated.
+void GlSpectrumCompute::reserve(QOpenGLBuffer &buffer, size_t size, size_t &capacity) {
+    if (size <= capacity) return;
+    buffer.bind();
+    buffer.allocate((int)size);
+    buffer.release();
+    capacity = size;
+}
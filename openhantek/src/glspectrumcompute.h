@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <memory>
+#include <vector>
+
+#include "scopesettings.h"
+
+struct GlGraph;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class GlSpectrumCompute                                 glspectrumcompute.h
+/// \brief Calculates the spectra of the scopes with OpenGL compute shaders.
+/// The voltages of a record are windowed, transformed by a radix-2 FFT,
+/// converted into levels and reduced to the pixel columns on the gpu. The
+/// levels are written straight into the vertex buffer of the graph, so the
+/// spectrum never goes back to the cpu. The transform takes the largest power
+/// of two samples from the beginning of the record. Needs OpenGL 4.3, every
+/// function has to be called with a context of the share group current.
+class GlSpectrumCompute {
+  public:
+    GlSpectrumCompute() = default;
+    GlSpectrumCompute(const GlSpectrumCompute &) = delete;
+    GlSpectrumCompute &operator=(const GlSpectrumCompute &) = delete;
+
+    /// \brief Compiles the shaders.
+    /// \return false, if the context has no compute shaders, the object can't be used then.
+    bool initialize();
+
+    /// \brief Frees the buffers and shaders, the context has to be current.
+    void destroy();
+
+    /// \brief Transforms the voltages of a graph into the levels of its spectrum.
+    /// The levels are reduced to the minimum and maximum of every pixel column
+    /// like GlGenerator::decimate() does if there are more than two per column.
+    /// \param graph A spectrum graph with the voltages, see GlGraph::timeDomain.
+    /// \param scope The settings of the spectrum.
+    /// \param left The left end of the visible range in divs.
+    /// \param right The right end of the visible range in divs.
+    /// \param xScale The divs per hertz.
+    /// \param columns The number of pixel columns of the visible range.
+    /// \param target The vertex buffer, its storage is allocated for the levels.
+    /// \param interval Set to the frequency between two levels in the target.
+    /// \param start Set to the frequency of the first level in the target.
+    /// \return The number of levels in the target, 0 if the record is too short or too long.
+    GLsizei transform(const GlGraph &graph, const DsoSettingsScope &scope, double left, double right, double xScale,
+                      unsigned int columns, QOpenGLBuffer &target, double &interval, double &start);
+
+    static const unsigned int MIN_LENGTH = 64;       ///< The shortest transformed record
+    static const unsigned int MAX_LENGTH = 1u << 23; ///< The longest transformed record
+    static const unsigned int GROUP_SIZE = 256;      ///< The invocations in a work group of the shaders
+
+  private:
+    // The functions of OpenGL 4.3 are resolved by hand, the context may be a compatibility profile
+    typedef void(QOPENGLF_APIENTRYP DispatchComputeFunction)(GLuint, GLuint, GLuint);
+    typedef void(QOPENGLF_APIENTRYP MemoryBarrierFunction)(GLbitfield);
+    typedef void(QOPENGLF_APIENTRYP BindBufferBaseFunction)(GLenum, GLuint, GLuint);
+
+    void bindStorage(GLuint binding, const QOpenGLBuffer &buffer);
+    void dispatch(unsigned int invocations);
+    static void reserve(QOpenGLBuffer &buffer, size_t size, size_t &capacity);
+
+    DispatchComputeFunction dispatchCompute = nullptr;
+    MemoryBarrierFunction memoryBarrier = nullptr;
+    BindBufferBaseFunction bindBufferBase = nullptr;
+
+    std::unique_ptr<QOpenGLShaderProgram> windowProgram;    ///< Windows the samples in bit reversed order
+    std::unique_ptr<QOpenGLShaderProgram> butterflyProgram; ///< Calculates one stage of the FFT
+    std::unique_ptr<QOpenGLShaderProgram> powerProgram;     ///< Converts the bins into levels
+    std::unique_ptr<QOpenGLShaderProgram> decimateProgram;  ///< Reduces the levels to the pixel columns
+
+    QOpenGLBuffer samples;     ///< The voltages of the record
+    QOpenGLBuffer window;      ///< The coefficients of the window function
+    QOpenGLBuffer bins;        ///< The complex bins of the transform
+    QOpenGLBuffer levels;      ///< The levels of the bins if they are reduced
+    size_t binsCapacity = 0;   ///< The storage of the bins in bytes
+    size_t levelsCapacity = 0; ///< The storage of the levels in bytes
+
+    Dso::WindowFunction windowFunction = Dso::WINDOW_HANN; ///< The function in the window buffer
+    unsigned int windowLength = 0;                         ///< The length of the window buffer, 0 if empty
+    std::vector<GLfloat> coefficients;                     ///< The window as floats for the upload
+};
@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include "acquisitionmodes.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HANTEK_ACQUISITION_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define HANTEK_ACQUISITION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Hantek {
+
+namespace {
+
+// The averaging kernels update the means with mean += ((code << 16) - mean) >> shift,
+// the summing kernels add up groups of factor consecutive codes.
+
+template <typename Code> void averageScalar(const Code *codes, unsigned count, int32_t *mean, unsigned shift) {
+    for (unsigned index = 0; index < count; ++index)
+        mean[index] += (((int32_t)codes[index] << 16) - mean[index]) >> shift;
+}
+
+template <typename Code> void sumScalar(const Code *codes, unsigned groups, unsigned factor, uint32_t *sums) {
+    for (unsigned group = 0; group < groups; ++group) {
+        const Code *first = codes + group * factor;
+        uint32_t sum = 0;
+        for (unsigned index = 0; index < factor; ++index) sum += first[index];
+        sums[group] = sum;
+    }
+}
+
+#ifdef HANTEK_ACQUISITION_SSE2
+/// \brief Updates four means with four 32 bit codes.
+inline void averageSse2(__m128i codes, int32_t *mean, __m128i shift) {
+    __m128i *target = reinterpret_cast<__m128i *>(mean);
+    const __m128i current = _mm_loadu_si128(target);
+    _mm_storeu_si128(target,
+                     _mm_add_epi32(current, _mm_sra_epi32(_mm_sub_epi32(_mm_slli_epi32(codes, 16), current), shift)));
+}
+
+void average8Sse2(const uint8_t *codes, unsigned count, int32_t *mean, unsigned shift) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    unsigned index = 0;
+
+    for (; index + 16 <= count; index += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(codes + index));
+        const __m128i lower = _mm_unpacklo_epi8(bytes, zero);
+        const __m128i upper = _mm_unpackhi_epi8(bytes, zero);
+        averageSse2(_mm_unpacklo_epi16(lower, zero), mean + index, shiftCount);
+        averageSse2(_mm_unpackhi_epi16(lower, zero), mean + index + 4, shiftCount);
+        averageSse2(_mm_unpacklo_epi16(upper, zero), mean + index + 8, shiftCount);
+        averageSse2(_mm_unpackhi_epi16(upper, zero), mean + index + 12, shiftCount);
+    }
+
+    averageScalar(codes + index, count - index, mean + index, shift);
+}
+
+void average16Sse2(const uint16_t *codes, unsigned count, int32_t *mean, unsigned shift) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i shiftCount = _mm_cvtsi32_si128((int)shift);
+    unsigned index = 0;
+
+    for (; index + 8 <= count; index += 8) {
+        const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(codes + index));
+        averageSse2(_mm_unpacklo_epi16(words, zero), mean + index, shiftCount);
+        averageSse2(_mm_unpackhi_epi16(words, zero), mean + index + 4, shiftCount);
+    }
+
+    averageScalar(codes + index, count - index, mean + index, shift);
+}
+
+/// \brief Sums the groups with the sums of absolute differences to zero, eight codes per sum.
+void sum8Sse2(const uint8_t *codes, unsigned groups, unsigned factor, uint32_t *sums) {
+    const __m128i zero = _mm_setzero_si128();
+    unsigned group = 0;
+
+    if (factor % 16 == 0) {
+        for (; group < groups; ++group) {
+            const uint8_t *first = codes + group * factor;
+            __m128i sum = zero;
+            for (unsigned index = 0; index < factor; index += 16)
+                sum = _mm_add_epi64(
+                    sum, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(first + index)), zero));
+            sums[group] = (uint32_t)(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+        }
+    } else if (factor == 8) {
+        for (; group + 2 <= groups; group += 2) {
+            const __m128i sum =
+                _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(codes + group * 8)), zero);
+            sums[group] = (uint32_t)_mm_cvtsi128_si32(sum);
+            sums[group + 1] = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+        }
+    }
+
+    sumScalar(codes + group * factor, groups - group, factor, sums + group);
+}
+#endif
+
+#ifdef HANTEK_ACQUISITION_NEON
+/// \brief Updates four means with four 32 bit codes, shift holds the negative shift count.
+inline void averageNeon(uint32x4_t codes, int32_t *mean, int32x4_t shift) {
+    const int32x4_t current = vld1q_s32(mean);
+    const int32x4_t value = vreinterpretq_s32_u32(vshlq_n_u32(codes, 16));
+    vst1q_s32(mean, vaddq_s32(current, vshlq_s32(vsubq_s32(value, current), shift)));
+}
+
+void average8Neon(const uint8_t *codes, unsigned count, int32_t *mean, unsigned shift) {
+    const int32x4_t shiftCount = vdupq_n_s32(-(int32_t)shift);
+    unsigned index = 0;
+
+    for (; index + 16 <= count; index += 16) {
+        const uint8x16_t bytes = vld1q_u8(codes + index);
+        const uint16x8_t lower = vmovl_u8(vget_low_u8(bytes));
+        const uint16x8_t upper = vmovl_u8(vget_high_u8(bytes));
+        averageNeon(vmovl_u16(vget_low_u16(lower)), mean + index, shiftCount);
+        averageNeon(vmovl_u16(vget_high_u16(lower)), mean + index + 4, shiftCount);
+        averageNeon(vmovl_u16(vget_low_u16(upper)), mean + index + 8, shiftCount);
+        averageNeon(vmovl_u16(vget_high_u16(upper)), mean + index + 12, shiftCount);
+    }
+
+    averageScalar(codes + index, count - index, mean + index, shift);
+}
+
+void average16Neon(const uint16_t *codes, unsigned count, int32_t *mean, unsigned shift) {
+    const int32x4_t shiftCount = vdupq_n_s32(-(int32_t)shift);
+    unsigned index = 0;
+
+    for (; index + 8 <= count; index += 8) {
+        const uint16x8_t words = vld1q_u16(codes + index);
+        averageNeon(vmovl_u16(vget_low_u16(words)), mean + index, shiftCount);
+        averageNeon(vmovl_u16(vget_high_u16(words)), mean + index + 4, shiftCount);
+    }
+
+    averageScalar(codes + index, count - index, mean + index, shift);
+}
+
+void sum8Neon(const uint8_t *codes, unsigned groups, unsigned factor, uint32_t *sums) {
+    unsigned group = 0;
+
+    if (factor % 16 == 0) {
+        for (; group < groups; ++group) {
+            const uint8_t *first = codes + group * factor;
+            uint32_t sum = 0;
+            for (unsigned index = 0; index < factor; index += 16) sum += vaddlvq_u8(vld1q_u8(first + index));
+            sums[group] = sum;
+        }
+    } else if (factor == 8) {
+        for (; group < groups; ++group) sums[group] = vaddlv_u8(vld1_u8(codes + group * 8));
+    }
+
+    sumScalar(codes + group * factor, groups - group, factor, sums + group);
+}
+#endif
+
+typedef void (*Average8Kernel)(const uint8_t *, unsigned, int32_t *, unsigned);
+typedef void (*Average16Kernel)(const uint16_t *, unsigned, int32_t *, unsigned);
+typedef void (*Sum8Kernel)(const uint8_t *, unsigned, unsigned, uint32_t *);
+
+/// \brief Selects the fastest 8 bit averaging kernel the cpu supports.
+Average8Kernel selectAverage8() {
+#if defined(HANTEK_ACQUISITION_SSE2)
+    return average8Sse2;
+#elif defined(HANTEK_ACQUISITION_NEON)
+    return average8Neon;
+#else
+    return averageScalar<uint8_t>;
+#endif
+}
+
+/// \brief Selects the fastest 10 bit averaging kernel the cpu supports.
+Average16Kernel selectAverage16() {
+#if defined(HANTEK_ACQUISITION_SSE2)
+    return average16Sse2;
+#elif defined(HANTEK_ACQUISITION_NEON)
+    return average16Neon;
+#else
+    return averageScalar<uint16_t>;
+#endif
+}
+
+/// \brief Selects the fastest 8 bit summing kernel the cpu supports.
+Sum8Kernel selectSum8() {
+#if defined(HANTEK_ACQUISITION_SSE2)
+    return sum8Sse2;
+#elif defined(HANTEK_ACQUISITION_NEON)
+    return sum8Neon;
+#else
+    return sumScalar<uint8_t>;
+#endif
+}
+
+/// \return log2 of the largest power of two that isn't larger than value.
+unsigned floorLog2(unsigned value) {
+    unsigned log = 0;
+    while (value >> (log + 1)) ++log;
+    return log;
+}
+
+/// \brief Replaces the codes by their rounded means.
+template <typename Code> void storeMeans(const int32_t *mean, size_t count, Code *codes) {
+    for (size_t index = 0; index < count; ++index) codes[index] = (Code)((mean[index] + 0x8000) >> 16);
+}
+
+/// \brief Replaces the codes by the rounded means of the groups.
+template <typename Code>
+void storeGroups(const uint32_t *sums, size_t groups, unsigned factorLog, std::vector<Code> &codes) {
+    const uint32_t half = (1u << factorLog) >> 1;
+    for (size_t group = 0; group < groups; ++group) codes[group] = (Code)((sums[group] + half) >> factorLog);
+    codes.resize(groups);
+}
+}
+
+const unsigned AcquisitionProcessor::MAXIMUM_AVERAGES;
+const unsigned AcquisitionProcessor::MAXIMUM_FACTOR;
+
+void AcquisitionProcessor::setMode(Dso::AcquisitionMode mode, unsigned count) {
+    const unsigned maximum =
+        mode == Dso::ACQUISITION_AVERAGE ? MAXIMUM_AVERAGES : (mode == Dso::ACQUISITION_HIGHRES ? MAXIMUM_FACTOR : 1);
+    this->mode = mode;
+    this->countLog = floorLog2(std::max(1u, std::min(count, maximum)));
+    this->count = 1u << this->countLog;
+    reset();
+}
+
+void AcquisitionProcessor::reset() {
+    for (ChannelAverage &state : averages) state.frames = 0;
+}
+
+void AcquisitionProcessor::process(unsigned channel, DSOcompactChannel &codes, std::vector<double> *voltages) {
+    if (mode == Dso::ACQUISITION_AVERAGE)
+        average(averages[channel], codes, voltages);
+    else if (mode == Dso::ACQUISITION_HIGHRES)
+        decimate(codes, voltages);
+}
+
+void AcquisitionProcessor::average(ChannelAverage &state, DSOcompactChannel &codes, std::vector<double> *voltages) {
+    static const Average8Kernel average8 = selectAverage8();
+    static const Average16Kernel average16 = selectAverage16();
+
+    const size_t size = codes.size();
+    if (state.mean.size() != size || state.wide != codes.wide || state.scale != codes.scale ||
+        state.shift != codes.shift) {
+        // The first frame overwrites the mean, so the old values don't have to be cleared
+        state.mean.resize(size);
+        state.frames = 0;
+        state.wide = codes.wide;
+        state.scale = codes.scale;
+        state.shift = codes.shift;
+    }
+
+    // Until the count is reached, frame n is weighted with 1 / 2^floor(log2(n)) instead of 1 / n
+    state.frames = std::min(state.frames + 1, count);
+    const unsigned shift = floorLog2(state.frames);
+    if (codes.wide)
+        average16(codes.codes16.data(), (unsigned)size, state.mean.data(), shift);
+    else
+        average8(codes.codes8.data(), (unsigned)size, state.mean.data(), shift);
+
+    if (voltages) {
+        const double scale = codes.scale / 65536.0;
+        voltages->resize(size);
+        for (size_t index = 0; index < size; ++index) (*voltages)[index] = state.mean[index] * scale + codes.shift;
+    } else if (codes.wide)
+        storeMeans(state.mean.data(), size, codes.codes16.data());
+    else
+        storeMeans(state.mean.data(), size, codes.codes8.data());
+}
+
+void AcquisitionProcessor::decimate(DSOcompactChannel &codes, std::vector<double> *voltages) {
+    static const Sum8Kernel sum8 = selectSum8();
+
+    const size_t groups = codes.size() >> countLog;
+    sums.resize(groups);
+    if (codes.wide)
+        sumScalar(codes.codes16.data(), (unsigned)groups, count, sums.data());
+    else
+        sum8(codes.codes8.data(), (unsigned)groups, count, sums.data());
+
+    if (voltages) {
+        const double scale = codes.scale / count;
+        voltages->resize(groups);
+        for (size_t group = 0; group < groups; ++group) (*voltages)[group] = sums[group] * scale + codes.shift;
+    } else if (codes.wide)
+        storeGroups(sums.data(), groups, countLog, codes.codes16);
+    else
+        storeGroups(sums.data(), groups, countLog, codes.codes8);
+}
+}
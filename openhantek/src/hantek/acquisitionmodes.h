@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "definitions.h"
+#include "dsosamples.h"
+
+namespace Hantek {
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class AcquisitionProcessor                               acquisitionmodes.h
+/// \brief Applies the acquisition mode to the sample codes of a frame.
+/// The codes are combined as integers before they are converted into voltages.
+/// In averaging mode every sample is the running mean of the samples at the
+/// same distance to the trigger point in the last frames, it is kept as fixed
+/// point value with 16 fractional bits. After the warm up the mean is weighted
+/// exponentially with the time constant of the selected number of frames, so
+/// no frame has to be kept. This approximates the plain mean of the last
+/// frames. Only frames placed by a hardware trigger are averaged, the caller
+/// passes the others unprocessed. In high resolution mode every group of
+/// consecutive codes is summed up, the samplerate drops by the size of the
+/// group and every fourfold increase of the group adds one effective bit.
+class AcquisitionProcessor {
+  public:
+    static const unsigned MAXIMUM_AVERAGES = 256; ///< The most frames that are averaged
+    static const unsigned MAXIMUM_FACTOR = 64;    ///< The largest group of the high resolution mode
+
+    /// \brief Selects the processing, the running means are restarted.
+    /// \param mode The acquisition mode.
+    /// \param count The number of frames averaged or the group size, rounded down to a power of two.
+    void setMode(Dso::AcquisitionMode mode, unsigned count);
+
+    /// \return true, if the codes are processed at all, the equivalent time sampling is done by the analysis.
+    bool isActive() const { return mode == Dso::ACQUISITION_AVERAGE || mode == Dso::ACQUISITION_HIGHRES; }
+
+    /// \return true, if consecutive frames are averaged, they have to be aligned by the trigger.
+    bool isAveraging() const { return mode == Dso::ACQUISITION_AVERAGE; }
+
+    /// \return The factor the samplerate is divided by, 1 if the samples aren't decimated.
+    unsigned getDecimation() const { return mode == Dso::ACQUISITION_HIGHRES ? count : 1; }
+
+    /// \brief Restarts the running means, the next frame is shown as it is.
+    void reset();
+
+    /// \brief Processes the codes of a channel.
+    /// The running mean of a channel restarts on its own if the number of
+    /// samples or the conversion parameters of the codes change.
+    /// \param channel The channel the codes belong to.
+    /// \param codes The codes of the frame, they are replaced by the rounded result if voltages is nullptr.
+    /// \param voltages The buffer for the result at full precision, nullptr if the frame is stored compact.
+    void process(unsigned channel, DSOcompactChannel &codes, std::vector<double> *voltages);
+
+  private:
+    /// \brief The running mean of a channel.
+    struct ChannelAverage {
+        std::vector<int32_t> mean; ///< The mean code of every sample, fixed point with 16 fractional bits
+        unsigned frames = 0;       ///< The number of frames in the mean, at most the selected count
+        bool wide = false;         ///< The code size of the mean
+        double scale = 0.0;        ///< The conversion parameters of the mean
+        double shift = 0.0;
+    };
+
+    void average(ChannelAverage &state, DSOcompactChannel &codes, std::vector<double> *voltages);
+    void decimate(DSOcompactChannel &codes, std::vector<double> *voltages);
+
+    Dso::AcquisitionMode mode = Dso::ACQUISITION_NORMAL;
+    unsigned count = 1;    ///< The number of averaged frames or the group size, a power of two
+    unsigned countLog = 0; ///< log2(count)
+    ChannelAverage averages[HANTEK_CHANNELS];
+    std::vector<uint32_t> sums; ///< The sums of the groups in high resolution mode, reused for every frame
+};
+}
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QtGlobal>
+#include <cmath>
+
+#include "acquisitionscheduler.h"
+
+#define SCHEDULER_WINDOW_MIN 0.5      ///< The minimal time around the predicted completion that is polled tightly in ms
+#define SCHEDULER_WINDOW_PART 0.1     ///< The part of the predicted latency that is polled tightly
+#define SCHEDULER_HISTORY_WEIGHT 0.25 ///< The weight of a new latency in the moving average
+
+void AcquisitionScheduler::setFrameTime(double frameTime) {
+    if (std::fabs(frameTime - this->frameTime) <= this->frameTime * 0.01) return;
+
+    this->frameTime = frameTime;
+    history = 0;
+}
+
+void AcquisitionScheduler::setPretriggerTime(double pretriggerTime) { this->pretriggerTime = pretriggerTime; }
+
+void AcquisitionScheduler::captureStarted() {
+    timer.start();
+    capturing = true;
+    triggerOn = false;
+}
+
+void AcquisitionScheduler::captureReady() {
+    if (!capturing) return;
+
+    const double captureLatency = elapsed();
+    if (history)
+        latency += (captureLatency - latency) * SCHEDULER_HISTORY_WEIGHT;
+    else
+        latency = captureLatency;
+    ++history;
+    capturing = false;
+}
+
+void AcquisitionScheduler::triggerEnabled() { triggerOn = true; }
+
+bool AcquisitionScheduler::isCapturing() const { return capturing; }
+
+bool AcquisitionScheduler::isTriggerDue() const { return capturing && !triggerOn && elapsed() >= pretriggerTime; }
+
+bool AcquisitionScheduler::isForceTriggerDue() const { return capturing && elapsed() >= forceTriggerTime(); }
+
+bool AcquisitionScheduler::isRestartDue() const { return capturing && elapsed() >= restartTime(); }
+
+double AcquisitionScheduler::predictedLatency() const {
+    if (!history) return frameTime;
+    return qMax(frameTime, latency);
+}
+
+double AcquisitionScheduler::nextPoll(bool autoTrigger) const {
+    if (!capturing) return cycleTime();
+
+    const double now = elapsed();
+    const double predicted = predictedLatency();
+    const double window = qMax(SCHEDULER_WINDOW_MIN, predicted * SCHEDULER_WINDOW_PART);
+
+    double delay;
+    if (now < frameTime - window) {
+        // The buffer can't be filled yet, wait until it nearly is
+        delay = frameTime - window - now;
+    } else if (now < predicted - window) {
+        // The last captures needed longer, but a trigger may still arrive early
+        delay = qMin(predicted - window - now, (double)cycleTime());
+    } else if (now < predicted + window) {
+        // The capture should be ready any moment
+        delay = window / 4;
+    } else {
+        // Still waiting for the trigger, back off gradually
+        delay = qBound(window / 4, (now - predicted) / 4, (double)cycleTime());
+    }
+
+    // Don't miss the moments the trigger has to be handled
+    if (!triggerOn && pretriggerTime > now) delay = qMin(delay, pretriggerTime - now);
+    if (autoTrigger && forceTriggerTime() > now) delay = qMin(delay, forceTriggerTime() - now);
+    if (restartTime() > now) delay = qMin(delay, restartTime() - now);
+
+    return qBound(0.0, delay, 1000.0);
+}
+
+int AcquisitionScheduler::cycleTime() const { return qBound(10, (int)(frameTime / 4), 1000); }
+
+double AcquisitionScheduler::elapsed() const { return timer.nsecsElapsed() / 1e6; }
+
+double AcquisitionScheduler::forceTriggerTime() const { return pretriggerTime + 8 * cycleTime(); }
+
+double AcquisitionScheduler::restartTime() const { return qMax(20.0 * cycleTime(), 4000.0); }
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QElapsedTimer>
+
+/// \brief Decides when the capture state of the device should be checked next.
+/// The time a capture needs until it is ready is predicted from the time the
+/// buffer needs to be filled and the latencies of the last captures. The
+/// device is only polled rarely, until the capture is expected to be finished.
+/// Near the predicted completion it is polled tightly, and the polling backs
+/// off again if the capture is still waiting for a trigger.
+class AcquisitionScheduler {
+  public:
+    /// \brief Sets the time the device needs to fill its buffer once.
+    /// The capture history is discarded if the time changes.
+    /// \param frameTime The buffer fill time in ms.
+    void setFrameTime(double frameTime);
+
+    /// \brief Sets the time that has to pass until the trigger may be enabled.
+    /// \param pretriggerTime The pretrigger time in ms.
+    void setPretriggerTime(double pretriggerTime);
+
+    /// \brief A new capture was started.
+    void captureStarted();
+
+    /// \brief The device reported that the capture is ready.
+    /// The latency of the capture is added to the history.
+    void captureReady();
+
+    /// \brief The trigger was enabled for the current capture.
+    void triggerEnabled();
+
+    /// \return true, if the current capture has been started.
+    bool isCapturing() const;
+
+    /// \return true, if the pretrigger buffer is filled and the trigger wasn't enabled yet.
+    bool isTriggerDue() const;
+
+    /// \return true, if the trigger should be forced in auto trigger mode.
+    bool isForceTriggerDue() const;
+
+    /// \return true, if the capture takes too long and should be restarted.
+    bool isRestartDue() const;
+
+    /// \return The predicted time from the start until the capture is ready in ms.
+    double predictedLatency() const;
+
+    /// \brief Calculates the time until the capture state should be checked again.
+    /// \param autoTrigger true, if the trigger is forced after a while.
+    /// \return The delay in ms, it may be fractional near the predicted completion.
+    double nextPoll(bool autoTrigger) const;
+
+    /// \return The coarse polling interval, 25% of the frame time but between 10 ms and 1 s.
+    int cycleTime() const;
+
+  private:
+    double elapsed() const;
+    double forceTriggerTime() const;
+    double restartTime() const;
+
+    QElapsedTimer timer;         ///< Measures the time since the capture was started
+    double frameTime = 0.0;      ///< The buffer fill time in ms
+    double pretriggerTime = 0.0; ///< Time until the trigger may be enabled in ms
+    bool capturing = false;      ///< true, if a capture has been started
+    bool triggerOn = false;      ///< true, if the trigger of the current capture is enabled
+    double latency = 0.0;        ///< Moving average of the capture latencies in ms
+    unsigned history = 0;        ///< The number of captures in the latency average
+};
@@ -94,6 +94,7 @@ struct ControlSpecification {
     bool supportsCaptureState = true;
     bool supportsOffset = true;
     bool supportsCouplingRelays = true;
+    bool supportsStreaming = false; ///< The device can be read continuously without gaps
 };
 
 }
@@ -54,10 +54,15 @@ enum Coupling {
 /// \enum MathMode
 /// \brief The different math modes for the math-channel.
 enum MathMode {
-    MATHMODE_1ADD2, ///< Add the values of the channels
-    MATHMODE_1SUB2, ///< Subtract CH2 from CH1
-    MATHMODE_2SUB1, ///< Subtract CH1 from CH2
-    MATHMODE_COUNT  ///< The total number of math modes
+    MATHMODE_1ADD2,      ///< Add the values of the channels
+    MATHMODE_1SUB2,      ///< Subtract CH2 from CH1
+    MATHMODE_2SUB1,      ///< Subtract CH1 from CH2
+    MATHMODE_1MUL2,      ///< Multiply the values of the channels
+    MATHMODE_ABS1,       ///< Absolute value of CH1
+    MATHMODE_ABS2,       ///< Absolute value of CH2
+    MATHMODE_SCALEDSUM,  ///< Add the values of the channels multiplied with the math factors
+    MATHMODE_EXPRESSION, ///< Evaluate the formula of the user
+    MATHMODE_COUNT       ///< The total number of math modes
 };
 
 /// \enum TriggerMode
@@ -78,6 +83,17 @@ enum Slope {
     SLOPE_COUNT     ///< Total number of trigger slopes
 };
 
+/// \enum TriggerType
+/// \brief The conditions of the software trigger.
+enum TriggerType {
+    TRIGGERTYPE_EDGE,       ///< The signal crosses the level
+    TRIGGERTYPE_PULSEWIDTH, ///< A pulse is longer or shorter than the duration
+    TRIGGERTYPE_RUNT,       ///< A pulse crosses the level but not the upper level
+    TRIGGERTYPE_WINDOW,     ///< The signal leaves or enters the window between the levels
+    TRIGGERTYPE_TIMEOUT,    ///< The signal stays beyond the level for longer than the duration
+    TRIGGERTYPE_COUNT       ///< Total number of trigger types
+};
+
 /// \enum WindowFunction
 /// \brief The supported window functions.
 /// These are needed for spectrum analysis and are applied to the sample values
@@ -101,6 +117,90 @@ enum WindowFunction {
     WINDOW_COUNT            ///< Total number of window functions
 };
 
+/// \enum AcquisitionMode
+/// \brief The processing of the sample codes right after they were received.
+enum AcquisitionMode {
+    ACQUISITION_NORMAL,     ///< Every frame is shown as it was sampled
+    ACQUISITION_AVERAGE,    ///< Running mean of the frames with the same trigger point
+    ACQUISITION_HIGHRES,    ///< Boxcar mean of consecutive samples, for a lower samplerate
+    ACQUISITION_EQUIVALENT, ///< Frames of a repetitive signal interleaved by their software trigger points
+    ACQUISITION_COUNT       ///< Total number of acquisition modes
+};
+
+/// \enum FrequencyEstimator
+/// \brief The methods to measure the frequency of a signal.
+enum FrequencyEstimator {
+    FREQUENCY_AUTOCORRELATION, ///< Peak of the autocorrelation, needs an inverse dft
+    FREQUENCY_ZEROCROSSING,    ///< Interpolated crossings of the mean voltage
+    FREQUENCY_SPECTRALPEAK,    ///< Interpolated strongest bin of the spectrum
+    FREQUENCY_COUNT            ///< Total number of frequency estimators
+};
+
+/// \enum SpectrumAveraging
+/// \brief The methods to combine the spectra of consecutive frames.
+enum SpectrumAveraging {
+    AVERAGING_OFF,         ///< Every frame shows its own spectrum
+    AVERAGING_LINEAR,      ///< Equally weighted mean of the levels in dB
+    AVERAGING_EXPONENTIAL, ///< Exponentially weighted mean of the levels in dB
+    AVERAGING_RMS,         ///< Equally weighted mean of the power, shown in dB
+    AVERAGING_MAXHOLD,     ///< Highest level of every bin
+    AVERAGING_MINHOLD,     ///< Lowest level of every bin
+    AVERAGING_COUNT        ///< Total number of averaging methods
+};
+
+/// \enum FilterType
+/// \brief The responses of the channel filters.
+enum FilterType {
+    FILTER_OFF,      ///< The samples aren't filtered
+    FILTER_LOWPASS,  ///< Passes the frequencies below the upper cutoff
+    FILTER_HIGHPASS, ///< Passes the frequencies above the lower cutoff
+    FILTER_BANDPASS, ///< Passes the frequencies between the cutoffs
+    FILTER_COUNT     ///< Total number of filter types
+};
+
+/// \enum FilterDesign
+/// \brief The implementations of the channel filters.
+enum FilterDesign {
+    FILTERDESIGN_FIR,  ///< Linear phase windowed sinc, convolved with overlap-save FFTs
+    FILTERDESIGN_IIR,  ///< Butterworth response as cascade of biquad sections
+    FILTERDESIGN_COUNT ///< Total number of filter designs
+};
+
+/// \enum Protocol
+/// \brief The serial protocols that can be decoded from the channels.
+enum Protocol {
+    PROTOCOL_OFF,  ///< Nothing is decoded
+    PROTOCOL_UART, ///< Asynchronous serial data on one channel
+    PROTOCOL_SPI,  ///< Synchronous serial data with the clock on the first and the data on the second source
+    PROTOCOL_I2C,  ///< Two wire bus with SCL on the first and SDA on the second source
+    PROTOCOL_COUNT ///< Total number of protocols
+};
+
+/// \enum Parity
+/// \brief The parity bit of an UART character.
+enum Parity {
+    PARITY_NONE, ///< No parity bit
+    PARITY_ODD,  ///< The number of set data and parity bits is odd
+    PARITY_EVEN, ///< The number of set data and parity bits is even
+    PARITY_COUNT ///< Total number of parity modes
+};
+
+/// \enum Measurement
+/// \brief The automatic measurements of a channel, the enabled ones are a set of bits.
+enum Measurement {
+    MEASUREMENT_RMS,       ///< Root mean square voltage
+    MEASUREMENT_MEAN,      ///< Mean voltage
+    MEASUREMENT_MINIMUM,   ///< Smallest voltage
+    MEASUREMENT_MAXIMUM,   ///< Largest voltage
+    MEASUREMENT_RISETIME,  ///< Mean time from 10% to 90% of the amplitude on rising edges
+    MEASUREMENT_FALLTIME,  ///< Mean time from 90% to 10% of the amplitude on falling edges
+    MEASUREMENT_DUTYCYCLE, ///< Share of the periods above 50% of the amplitude in percent
+    MEASUREMENT_PERIOD,    ///< Mean time between the rising crossings of 50% of the amplitude
+    MEASUREMENT_OVERSHOOT, ///< Maximum above the high level in percent of the step between the levels
+    MEASUREMENT_PHASE,     ///< Delay of the rising edges against the first channel in degrees
+    MEASUREMENT_COUNT      ///< Total number of measurements
+};
+
 /// \enum InterpolationMode
 /// \brief The different interpolation modes for the graphs.
 enum InterpolationMode {
@@ -118,6 +218,14 @@ Q_DECLARE_METATYPE(Dso::Coupling)
 Q_DECLARE_METATYPE(Dso::GraphFormat)
 Q_DECLARE_METATYPE(Dso::ChannelMode)
 Q_DECLARE_METATYPE(Dso::WindowFunction)
+Q_DECLARE_METATYPE(Dso::AcquisitionMode)
+Q_DECLARE_METATYPE(Dso::FrequencyEstimator)
+Q_DECLARE_METATYPE(Dso::SpectrumAveraging)
+Q_DECLARE_METATYPE(Dso::FilterType)
+Q_DECLARE_METATYPE(Dso::FilterDesign)
+Q_DECLARE_METATYPE(Dso::Protocol)
+Q_DECLARE_METATYPE(Dso::Parity)
+Q_DECLARE_METATYPE(Dso::Measurement)
 Q_DECLARE_METATYPE(Dso::InterpolationMode)
 
 ////////////////////////////////////////////////////////////////////////////////
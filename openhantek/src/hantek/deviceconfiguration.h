@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <vector>
+
+#include "definitions.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \struct DeviceChannelConfiguration              hantek/deviceconfiguration.h
+/// \brief The settings of one channel of the device.
+struct DeviceChannelConfiguration {
+    bool used = false;                         ///< true, if the channel is sampled
+    Dso::Coupling coupling = Dso::COUPLING_DC; ///< The coupling of the input
+    double gain = 1.0;                         ///< The voltage of the whole screen height in V
+    double offset = 0.5;                       ///< The offset of the screen center (0.0 - 1.0)
+    double triggerLevel = 0.0;                 ///< The trigger level in V
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \struct DeviceConfiguration                     hantek/deviceconfiguration.h
+/// \brief All settings of the device that are applied together.
+/// HantekDsoControl::applyConfiguration() sets them in one call on the thread
+/// of the device, so every changed command is sent once in the next cycle
+/// instead of one transfer after the other for every single setting.
+struct DeviceConfiguration {
+    std::vector<DeviceChannelConfiguration> channels; ///< The physical channels
+
+    bool samplerateSet = false; ///< true sets the samplerate, false the record time
+    double samplerate = 1e6;    ///< The samplerate in S/s
+    double recordTime = 1e-2;   ///< The duration of a record in s
+    unsigned recordLength = 0;  ///< The record length, its index if the device has a list of them
+
+    Dso::TriggerMode triggerMode = Dso::TRIGGERMODE_NORMAL; ///< Automatic, normal or single trigger
+    double pretriggerPosition = 0.0;                         ///< The pretrigger position in s
+    Dso::Slope triggerSlope = Dso::SLOPE_POSITIVE;           ///< The edge the trigger reacts to
+    bool triggerSpecial = false;                             ///< true, if the source is a special trigger input
+    unsigned triggerSource = 0;                              ///< The trigger source
+
+    Dso::AcquisitionMode acquisitionMode = Dso::ACQUISITION_NORMAL; ///< The processing of the codes
+    unsigned acquisitionCount = 1;                                  ///< The averaged frames or the samples per group
+
+    bool streaming = false;       ///< true, if the device is read continuously
+    bool compactSamples = false;  ///< true, if the frames are kept as raw codes
+    bool losslessCapture = false; ///< true, if the acquisition waits for the analysis
+    unsigned historyMemory = 0;   ///< The memory of the frame history in MiB, 0 disables it
+};
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QMutexLocker>
+
+#include "devicemanager.h"
+
+#include "hantekdsocontrol.h"
+#include "usb/uploadFirmware.h"
+#include "usb/usbdevice.h"
+#include "utils/printutils.h"
+
+DeviceManager::DeviceManager(libusb_context *context) : context(context) {
+    if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+        int error = libusb_hotplug_register_callback(
+            context, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED, static_cast<libusb_hotplug_flag>(0),
+            LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, hotplugArrived, this,
+            &hotplugHandle);
+        hotplug = error == LIBUSB_SUCCESS;
+        if (!hotplug)
+            qWarning().noquote() << QCoreApplication::translate("", "Can't watch the usb devices: %1")
+                                        .arg(libUsbErrorString(error));
+    }
+    timer.setInterval(hotplug ? EVENT_INTERVAL : POLL_INTERVAL);
+    connect(&timer, &QTimer::timeout, this, &DeviceManager::handleEvents);
+}
+
+DeviceManager::~DeviceManager() {
+    if (hotplug) libusb_hotplug_deregister_callback(context, hotplugHandle);
+    for (libusb_device *device : arrivals) libusb_unref_device(device);
+}
+
+void DeviceManager::watch(USBDevice *device, HantekDsoControl *dsoControl) {
+    units.emplace_back();
+    Unit *unit = &units.back();
+    unit->device = device;
+    unit->dsoControl = dsoControl;
+
+    // Both signals are emitted in the thread of the device, they are queued
+    connect(device, &USBDevice::deviceDisconnected, this, [this, unit]() { connectionLost(unit); });
+    connect(dsoControl, &HantekDsoControl::communicationError, this, [this, unit]() { communicationFailed(unit); });
+
+    if (hotplug) timer.start();
+}
+
+void DeviceManager::connectionLost(Unit *unit) {
+    if (unit->lost) return;
+    unit->lost = true;
+    qWarning().noquote() << QCoreApplication::translate("", "%1: Connection lost, waiting for the device")
+                                .arg(QString::fromStdString(unit->device->getModel().name));
+    emit deviceLost(unit->device);
+
+    if (!hotplug) timer.start();
+}
+
+void DeviceManager::communicationFailed(Unit *unit) {
+    // A lost device is resumed when it is reconnected, resume() does nothing for it
+    HantekDsoControl *dsoControl = unit->dsoControl;
+    QTimer::singleShot(RETRY_DELAY, dsoControl, [dsoControl]() { dsoControl->resume(); });
+}
+
+void DeviceManager::handleEvents() {
+    if (hotplug) {
+        // The callback is called by any thread that handles the events, the other threads don't wait for them
+        struct timeval tv = {0, 0};
+        libusb_handle_events_timeout_completed(context, &tv, nullptr);
+    } else {
+        pollDevices();
+    }
+
+    std::vector<libusb_device *> arrived;
+    {
+        QMutexLocker locker(&arrivalMutex);
+        arrived.swap(arrivals);
+    }
+    for (libusb_device *device : arrived) deviceArrived(device);
+}
+
+void DeviceManager::pollDevices() {
+    bool lost = false;
+    for (const Unit &unit : units) lost |= unit.lost && !unit.reconnecting;
+    if (!lost) {
+        timer.stop();
+        return;
+    }
+
+    libusb_device **deviceList;
+    ssize_t deviceCount = libusb_get_device_list(context, &deviceList);
+    if (deviceCount < 0) return;
+    QMutexLocker locker(&arrivalMutex);
+    for (ssize_t deviceIterator = 0; deviceIterator < deviceCount; ++deviceIterator) {
+        if (isWatched(deviceList[deviceIterator])) continue;
+        libusb_ref_device(deviceList[deviceIterator]);
+        arrivals.push_back(deviceList[deviceIterator]);
+    }
+    libusb_free_device_list(deviceList, true);
+}
+
+void DeviceManager::deviceArrived(libusb_device *device) {
+    struct libusb_device_descriptor descriptor;
+    if (libusb_get_device_descriptor(device, &descriptor) != LIBUSB_SUCCESS) {
+        libusb_unref_device(device);
+        return;
+    }
+
+    for (Unit &unit : units) {
+        if (!unit.lost || unit.reconnecting) continue;
+        const DSOModel &model = unit.device->getModel();
+
+        // The device restarts with its final ids after the upload and arrives again
+        if (descriptor.idVendor == model.vendorIDnoFirmware && descriptor.idProduct == model.productIDnoFirmware) {
+            USBDevice uploadDevice(model, device, context);
+            UploadFirmware uploader;
+            if (!uploader.startUpload(&uploadDevice))
+                qWarning().noquote() << QCoreApplication::translate("", "%1: Firmware upload failed: %2")
+                                            .arg(QString::fromStdString(model.name), uploader.getErrorMessage());
+            break;
+        }
+
+        if (descriptor.idVendor == model.vendorID && descriptor.idProduct == model.productID) {
+            // The device is only used in the thread of its control object
+            unit.reconnecting = true;
+            Unit *target = &unit;
+            libusb_ref_device(device);
+            QTimer::singleShot(0, unit.dsoControl, [this, target, device]() {
+                QString errorMessage;
+                const bool success = target->device->reattach(device, errorMessage);
+                libusb_unref_device(device);
+                if (success) target->dsoControl->resume();
+                QTimer::singleShot(0, this, [this, target, success, errorMessage]() {
+                    reconnected(target, success, errorMessage);
+                });
+            });
+            break;
+        }
+    }
+    libusb_unref_device(device);
+}
+
+void DeviceManager::reconnected(Unit *unit, bool success, const QString &errorMessage) {
+    unit->reconnecting = false;
+    const QString modelName = QString::fromStdString(unit->device->getModel().name);
+    if (!success) {
+        qWarning().noquote() << QCoreApplication::translate("", "%1: Can't reconnect: %2").arg(modelName, errorMessage);
+        return;
+    }
+
+    unit->lost = false;
+    qDebug().noquote() << QCoreApplication::translate("", "%1: Reconnected").arg(modelName);
+    emit deviceReconnected(unit->device);
+}
+
+bool DeviceManager::isWatched(libusb_device *device) const {
+    for (const Unit &unit : units) {
+        if (unit.device->getRawDevice() == device) return true;
+    }
+    return false;
+}
+
+int LIBUSB_CALL DeviceManager::hotplugArrived(libusb_context *, libusb_device *device, libusb_hotplug_event,
+                                              void *manager) {
+    DeviceManager *self = static_cast<DeviceManager *>(manager);
+    libusb_ref_device(device);
+    QMutexLocker locker(&self->arrivalMutex);
+    self->arrivals.push_back(device);
+    return 0;
+}
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <libusb-1.0/libusb.h>
+#include <list>
+#include <vector>
+
+class HantekDsoControl;
+class USBDevice;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class DeviceManager                                   hantek/devicemanager.h
+/// \brief Reconnects lost devices, when they appear on the bus again.
+/// The watched devices keep their USBDevice, HantekDsoControl and all settings
+/// and buffers while they are disconnected. A reappearing device of the same
+/// model gets its firmware uploaded again, if it needs one, and when it has
+/// restarted with the firmware it replaces the lost one and the acquisition is
+/// resumed with the settings it had. The arrivals are reported by the hotplug
+/// events of libusb, without hotplug support the device list is polled while a
+/// device is lost. Failed transfers of a connected device are retried after a
+/// while instead of stopping the communication.
+///
+/// The manager lives in the main thread. The devices are only touched in the
+/// threads of their HantekDsoControl.
+class DeviceManager : public QObject {
+    Q_OBJECT
+
+  public:
+    /// \param context The usb context the devices belong to.
+    explicit DeviceManager(libusb_context *context = nullptr);
+    ~DeviceManager();
+
+    /// \brief Starts watching a device, it is reconnected if it gets lost.
+    /// \param device The usb device, it has to outlive the manager.
+    /// \param dsoControl The control object of the device, it has to outlive the manager.
+    void watch(USBDevice *device, HantekDsoControl *dsoControl);
+
+    static const int EVENT_INTERVAL = 100; ///< The time between two checks for hotplug events in ms
+    static const int POLL_INTERVAL = 1000; ///< The time between two searches without hotplug support in ms
+    static const int RETRY_DELAY = 1000;   ///< The time until the communication is resumed after an error in ms
+
+  signals:
+    void deviceLost(USBDevice *device);        ///< The device was disconnected
+    void deviceReconnected(USBDevice *device); ///< The device is connected again and the acquisition resumed
+
+  private:
+    /// \brief A watched device.
+    struct Unit {
+        USBDevice *device = nullptr;
+        HantekDsoControl *dsoControl = nullptr;
+        bool lost = false;         ///< true, while the device is disconnected
+        bool reconnecting = false; ///< true, while a reappeared device is attached
+    };
+
+    void connectionLost(Unit *unit);
+    void communicationFailed(Unit *unit);
+    void handleEvents();
+    void pollDevices();
+    void deviceArrived(libusb_device *device);
+    void reconnected(Unit *unit, bool success, const QString &errorMessage);
+    bool isWatched(libusb_device *device) const;
+
+    static int LIBUSB_CALL hotplugArrived(libusb_context *context, libusb_device *device,
+                                          libusb_hotplug_event event, void *manager);
+
+    libusb_context *context; ///< The usb context of the devices
+    std::list<Unit> units;   ///< The watched devices, the list keeps the pointers to them valid
+    QTimer timer;            ///< Handles the hotplug events or polls the device list
+    bool hotplug = false;    ///< true, if the hotplug callback is registered
+    libusb_hotplug_callback_handle hotplugHandle;
+    QMutex arrivalMutex;                   ///< Protects the arrivals, the callback runs in any event handling thread
+    std::vector<libusb_device *> arrivals; ///< The referenced devices that arrived since the last check
+};
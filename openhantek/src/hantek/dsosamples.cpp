@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include "dsosamples.h"
+#include "sampleconversion.h"
+
+void DSOcompactChannel::clear() {
+    codes8.clear();
+    codes16.clear();
+}
+
+void DSOcompactChannel::release() {
+    std::vector<uint8_t>().swap(codes8);
+    std::vector<uint16_t>().swap(codes16);
+}
+
+const unsigned DSOcompactChannel::WIDE_CODES;
+
+void DSOcompactChannel::toVoltage(double *target) const {
+    table.update(wide ? WIDE_CODES : 256, scale, shift);
+    if (wide) {
+        // Replayed codes may come from a damaged file, they must not leave the table
+        const double *voltages = table.data();
+        for (size_t index = 0; index < codes16.size(); ++index)
+            target[index] = voltages[codes16[index] & (WIDE_CODES - 1)];
+    } else {
+        Hantek::convertSamples8(codes8.data(), (unsigned)codes8.size(), 0, 1, target, (unsigned)codes8.size(), table);
+    }
+}
+
+size_t DSOsamples::sampleCount(unsigned channel) const {
+    if (compact) return channel < compactData.size() ? compactData[channel].size() : 0;
+    return channel < data.size() ? data[channel].size() : 0;
+}
+
+void DSOsamples::copyVoltage(unsigned channel, std::vector<double> &target, bool append) const {
+    const size_t offset = append ? target.size() : 0;
+    const size_t count = sampleCount(channel);
+
+    target.resize(offset + count);
+    if (!count) return;
+
+    if (compact)
+        compactData[channel].toVoltage(target.data() + offset);
+    else
+        std::copy(data[channel].begin(), data[channel].end(), target.begin() + offset);
+}
+
+const unsigned DSOsampleBuffer::FRESH;
+const unsigned DSOsampleBuffer::INDEX_MASK;
+const unsigned DSOsampleBuffer::LOSSLESS_TIMEOUT;
+
+DSOsampleBuffer::DSOsampleBuffer() : middle(1), timestamp(0), lossless(false) {}
+
+bool DSOsampleBuffer::publish() {
+    if (lossless.load()) {
+        // The timeout keeps the acquisition alive if the reader stopped
+        QMutexLocker locker(&waitMutex);
+        while (middle.load(std::memory_order_acquire) & FRESH)
+            if (!frameTaken.wait(&waitMutex, LOSSLESS_TIMEOUT)) break;
+    }
+
+    timestamp.store(frames[back].timestamp, std::memory_order_release);
+    // Release the written frame to the reader and continue with the frame that was in the middle
+    const unsigned previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+    back = previous & INDEX_MASK;
+    return (previous & FRESH) != 0;
+}
+
+DSOsamples *DSOsampleBuffer::takeFrame() {
+    if (!(middle.load(std::memory_order_acquire) & FRESH)) return nullptr;
+    // Give the frame that was read back to the writer
+    const unsigned previous = middle.exchange(front, std::memory_order_acq_rel);
+    front = previous & INDEX_MASK;
+    if (lossless.load()) {
+        QMutexLocker locker(&waitMutex);
+        frameTaken.wakeAll();
+    }
+    return &frames[front];
+}
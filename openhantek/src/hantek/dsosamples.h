@@ -2,14 +2,110 @@
 
 #pragma once
 
-#include <QReadLocker>
-#include <QReadWriteLock>
-#include <QWriteLocker>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtGlobal>
+#include <atomic>
+#include <cstdint>
 #include <vector>
 
+#include "sampleconversion.h"
+
+/// \brief The raw sample codes of one channel.
+/// The voltage of a sample is code * scale + shift.
+struct DSOcompactChannel {
+    std::vector<uint8_t> codes8;   ///< The codes of devices with 8 bit samples
+    std::vector<uint16_t> codes16; ///< The codes of devices with more than 8 bit samples
+    bool wide = false;             ///< true, if codes16 is used
+    double scale = 1.0;            ///< Volts per code
+    double shift = 0.0;            ///< Voltage of the code 0
+
+    static const unsigned WIDE_CODES = 1024; ///< The number of codes of the devices with more than 8 bit samples
+
+    size_t size() const { return wide ? codes16.size() : codes8.size(); }
+    void clear();
+    void release();
+
+    /// \brief Converts the codes into voltages.
+    /// The voltages of the codes are looked up in a table, that is kept until
+    /// scale or shift change. The frames are reused, so the table usually is too.
+    /// \param target The buffer the voltages are written to, it has to hold size() values.
+    void toVoltage(double *target) const;
+
+  private:
+    mutable Hantek::VoltageTable table; ///< Only used by the reader of the frame
+};
+
 struct DSOsamples {
-    std::vector<std::vector<double>> data; ///< Pointer to input data from device
-    double samplerate = 0.0;               ///< The samplerate of the input data
-    bool append = false;                   ///< true, if waiting data should be appended
-    mutable QReadWriteLock lock;
+    std::vector<std::vector<double>> data;      ///< Pointer to input data from device, if not compact
+    std::vector<DSOcompactChannel> compactData; ///< Raw codes of the input data, if compact
+    bool compact = false;                       ///< true, if the data is stored as raw codes
+    double samplerate = 0.0;                    ///< The samplerate of the input data
+    bool append = false;                        ///< true, if waiting data should be appended
+    qint64 timestamp = 0;                       ///< Steady clock time in ns the data was received at
+    quint64 frameId = 0;                        ///< Unique, monotonic id of the frame, see Instrumentation
+
+    /// \brief Gets the number of samples of a channel, regardless of the storage.
+    size_t sampleCount(unsigned channel) const;
+
+    /// \brief Writes the voltages of a channel into a buffer.
+    /// Compact data is converted on the fly.
+    /// \param channel The channel that should be copied.
+    /// \param target The buffer for the voltages.
+    /// \param append true, if the voltages should be appended to target.
+    void copyVoltage(unsigned channel, std::vector<double> &target, bool append) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class DSOsampleBuffer                                          dsosamples.h
+/// \brief Lock-free triple buffer between the acquisition and the analysis.
+/// The acquisition fills the back frame and publishes it, the analysis takes the
+/// latest published frame and owns it until it takes the next one. Neither side
+/// ever waits for the other, a published frame that wasn't taken yet is replaced
+/// by the next one. In lossless mode publish() waits until the previous frame was
+/// taken instead. There has to be exactly one writer and one reader thread.
+class DSOsampleBuffer {
+  public:
+    DSOsampleBuffer();
+
+    /// \brief Gets the frame the acquisition writes to.
+    /// The buffers of the frame still hold an older frame, their capacity is reused.
+    /// \return The back frame, it changes with every publish().
+    DSOsamples &writeFrame() { return frames[back]; }
+
+    /// \brief Makes the back frame the latest frame.
+    /// The reader only has to be notified if this returns false, otherwise the
+    /// notification for the dropped frame is still pending.
+    /// \return true, if the previous frame wasn't taken and has been dropped.
+    bool publish();
+
+    /// \brief Selects if publish() waits for the reader.
+    /// \param enable true, if no frame should be dropped.
+    void setLossless(bool enable) { lossless.store(enable); }
+
+    /// \brief Takes the latest published frame.
+    /// The returned frame belongs to the reader until the next call, it may be
+    /// modified, for example to move its buffers out.
+    /// \return The frame, nullptr if no frame was published since the last call.
+    DSOsamples *takeFrame();
+
+    /// \return true, if the reader took the latest published frame, so publish() doesn't replace one.
+    bool isLatestTaken() const { return !(middle.load(std::memory_order_acquire) & FRESH); }
+
+    /// \return The timestamp of the latest published frame.
+    qint64 latestTimestamp() const { return timestamp.load(std::memory_order_acquire); }
+
+  private:
+    static const unsigned FRESH = 4;               ///< Set in middle, if the middle frame wasn't taken yet
+    static const unsigned INDEX_MASK = 3;          ///< The index of the frame in middle
+    static const unsigned LOSSLESS_TIMEOUT = 1000; ///< Maximal wait for the reader in ms
+
+    DSOsamples frames[3];
+    unsigned back = 0;            ///< The frame of the writer
+    std::atomic<unsigned> middle; ///< The latest published frame
+    unsigned front = 2;           ///< The frame of the reader
+    std::atomic<qint64> timestamp;
+    std::atomic<bool> lossless;
+    QMutex waitMutex;          ///< Only used in lossless mode
+    QWaitCondition frameTaken; ///< Signaled when the reader took a frame in lossless mode
 };
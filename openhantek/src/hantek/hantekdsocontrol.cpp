@@ -1,25 +1,38 @@
 // SPDX-License-Identifier: GPL-2.0+
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <iterator>
 #include <limits>
 #include <vector>
 
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QEventLoop>
 #include <QList>
 #include <QMutex>
 #include <QTimer>
 
 #include "hantek/hantekdsocontrol.h"
+#include "hantek/sampleconversion.h"
 
+#include "usb/transfercalibration.h"
 #include "usb/usbdevice.h"
+#include "utils/instrumentation.h"
 #include "utils/printutils.h"
+#include "utils/threadscheduling.h"
+#include "viewconstants.h"
 #include <stdexcept>
 
 using namespace Hantek;
 
 /// \brief Start sampling process.
 void HantekDsoControl::startSampling() {
+    // A new segmented acquisition starts with an empty segment store
+    if (segmentCount) segmentsCaptured = 0;
+    // The history holds the frames of the latest run
+    history.clear();
     sampling = true;
 
     // Emit signals for initial settings
@@ -42,6 +55,7 @@ void HantekDsoControl::startSampling() {
 /// \brief Stop sampling process.
 void HantekDsoControl::stopSampling() {
     sampling = false;
+    emit historyAvailable(history.count());
     emit samplingStopped();
 }
 
@@ -49,7 +63,13 @@ const QStringList *HantekDsoControl::getSpecialTriggerSources() { return &(speci
 
 const USBDevice *HantekDsoControl::getDevice() const { return device; }
 
-const DSOsamples &HantekDsoControl::getLastSamples() { return result; }
+DSOsampleBuffer &HantekDsoControl::getSampleBuffer() { return sampleBuffer; }
+
+CaptureRecorder &HantekDsoControl::getRecorder() { return recorder; }
+
+bool HantekDsoControl::isStreamingSupported() const { return specification.supportsStreaming; }
+
+unsigned HantekDsoControl::getSegmentsCaptured() const { return segmentsCaptured; }
 
 HantekDsoControl::HantekDsoControl(USBDevice *device) : device(device) {
     if (device == nullptr) throw new std::runtime_error("No usb device for HantekDsoControl");
@@ -257,6 +277,8 @@ HantekDsoControl::HantekDsoControl(USBDevice *device) : device(device) {
 
     case MODEL_DSO6022BE:
         device->overwriteInPacketLength(16384);
+        // Keep several sample transfers in flight to get close to the usb bandwidth
+        device->setEnableAsyncTransfer(true);
         // 6022BE do not support any bulk commands
         device->setEnableBulkTransfer(false);
         specification.useControlNoBulk = true;
@@ -264,6 +286,7 @@ HantekDsoControl::HantekDsoControl(USBDevice *device) : device(device) {
         specification.supportsCaptureState = false;
         specification.supportsOffset = false;
         specification.supportsCouplingRelays = false;
+        specification.supportsStreaming = true;
 
         this->control[CONTROLINDEX_SETVOLTDIV_CH1] = new ControlSetVoltDIV_CH1();
         this->controlCode[CONTROLINDEX_SETVOLTDIV_CH1] = CONTROL_SETVOLTDIV_CH1;
@@ -308,6 +331,18 @@ HantekDsoControl::HantekDsoControl(USBDevice *device) : device(device) {
         throw new std::runtime_error("unknown model");
     }
 
+    // The samplerate queries of the timebase and samplerate settings are answered from the table
+    samplerateTable.build(specification);
+
+    // The commands that are sent initially hold the settings, they are sent again after a reconnection
+    std::copy(std::begin(commandPending), std::end(commandPending), std::begin(settingsCommand));
+    std::copy(std::begin(controlPending), std::end(controlPending), std::begin(settingsControl));
+    for (BulkCode code : {specification.command.bulk.setRecordLength, specification.command.bulk.setChannels,
+                          specification.command.bulk.setGain, specification.command.bulk.setSamplerate,
+                          specification.command.bulk.setTrigger, specification.command.bulk.setPretrigger}) {
+        if (code != (BulkCode)-1 && command[code]) settingsCommand[code] = true;
+    }
+
     this->previousSampleCount = 0;
 
     // Get channel level data
@@ -345,6 +380,8 @@ double HantekDsoControl::getMaxSamplerate() {
 }
 
 /// \brief Updates the interval of the periodic thread timer.
+/// The standard mode is polled by the acquisition scheduler, that gets the
+/// expected buffer fill time here.
 void HantekDsoControl::updateInterval() {
     // Check the current oscilloscope state everytime 25% of the time the buffer
     // should be refilled
@@ -356,6 +393,11 @@ void HantekDsoControl::updateInterval() {
 
     // Not more often than every 10 ms though but at least once every second
     cycleTime = qBound(10, cycleTime, 1000);
+
+    if (!isRollMode()) {
+        scheduler.setFrameTime((double)getRecordLength() / controlsettings.samplerate.current * 1000);
+        scheduler.setPretriggerTime(controlsettings.trigger.position * 1000);
+    }
 }
 
 bool HantekDsoControl::isRollMode() const {
@@ -366,6 +408,13 @@ bool HantekDsoControl::isFastRate() const {
     return controlsettings.samplerate.limits == &specification.samplerate.multi;
 }
 
+bool HantekDsoControl::isHardwareTriggered() const {
+    // The software trigger is searched by the analysis, after the frames were combined, and a timed out auto
+    // trigger leaves the frame at a random position
+    return !isRollMode() && !streaming && !specification.isSoftwareTriggerDevice &&
+           controlsettings.trigger.mode != Dso::TRIGGERMODE_SOFTWARE && !triggerForced;
+}
+
 int HantekDsoControl::getRecordLength() const {
     return controlsettings.samplerate.limits->recordLengths[controlsettings.recordLengthId];
 }
@@ -401,14 +450,17 @@ std::pair<int, unsigned> HantekDsoControl::getCaptureState() const {
     return std::make_pair((int)response.getCaptureState(), response.getTriggerPoint());
 }
 
-std::vector<unsigned char> HantekDsoControl::getSamples(unsigned &previousSampleCount) const {
+int HantekDsoControl::getSamples(unsigned &previousSampleCount, std::vector<unsigned char> &data,
+                                 quint64 &frameId) const {
+    frameId = 0;
     if (!specification.useControlNoBulk) {
         // Request data
         int errorCode = device->bulkCommand(command[BULK_GETDATA], 1);
         if (errorCode < 0) {
             qWarning() << "Getting sample data failed: " << libUsbErrorString(errorCode);
             emit communicationError();
-            return std::vector<unsigned char>();
+            data.clear();
+            return errorCode;
         }
     }
 
@@ -424,36 +476,125 @@ std::vector<unsigned char> HantekDsoControl::getSamples(unsigned &previousSample
 
     unsigned dataLength = (specification.sampleSize > 8) ? totalSampleCount * 2 : totalSampleCount;
 
-    // Save raw data to temporary buffer
-    std::vector<unsigned char> data(dataLength);
-    int errorcode = device->bulkReadMulti(data.data(), dataLength);
+    // Save raw data to the reused buffer, this only allocates if the buffer grows
+    data.resize(dataLength);
+    ThreadScheduling::lockBuffer(data);
+    int errorcode;
+    {
+        Instrumentation::ScopedStage stage(Instrumentation::STAGE_USBREAD);
+        errorcode = device->bulkReadMulti(data.data(), dataLength);
+        if (errorcode >= 0) {
+            frameId = Instrumentation::nextFrameId();
+            stage.setFrame(frameId);
+        }
+    }
     if (errorcode < 0) {
         qWarning() << "Getting sample data failed: " << libUsbErrorString(errorcode);
-        return std::vector<unsigned char>();
+        data.clear();
+        return errorcode;
     }
     data.resize((size_t)errorcode);
+    Instrumentation::count(Instrumentation::COUNTER_FRAMES);
+    Instrumentation::count(Instrumentation::COUNTER_USBBYTES, (quint64)errorcode);
 
     static unsigned id = 0;
     ++id;
     timestampDebug(QString("Received packet %1").arg(id));
 
-    return data;
+    return errorcode;
 }
 
-void HantekDsoControl::convertRawDataToSamples(const std::vector<unsigned char> &rawData) {
+void HantekDsoControl::convertRawDataToSamples(const std::vector<unsigned char> &rawData, quint64 frameId) {
+    // Frames cut out of the stream get their id here
+    if (!frameId) frameId = Instrumentation::nextFrameId();
+    Instrumentation::ScopedStage stage(Instrumentation::STAGE_CONVERT, frameId);
     const size_t totalSampleCount = (specification.sampleSize > 8) ? rawData.size() / 2 : rawData.size();
 
-    QWriteLocker locker(&result.lock);
-    result.samplerate = controlsettings.samplerate.current;
+    // The recorder and the history store raw codes, so the frames are compact while they are used
+    const bool compact = compactSamples || recorder.isRecording() || history.isEnabled();
+    // The acquisition modes work on the codes, averaging needs frames that are aligned by the trigger. The frames
+    // without a hardware trigger are shown unchanged, the running mean is kept for the next triggered frame.
+    const bool processed =
+        acquisition.isActive() && !isRollMode() && (isHardwareTriggered() || !acquisition.isAveraging());
+    const bool extract = compact || processed;
+    DSOsamples &result = sampleBuffer.writeFrame();
+    result.samplerate = controlsettings.samplerate.current / (processed ? acquisition.getDecimation() : 1);
     result.append = isRollMode();
-    // Prepare result buffers
+    result.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+    result.frameId = frameId;
+    // Prepare result buffers. They are only resized, so their capacity is reused across acquisitions
     result.data.resize(HANTEK_CHANNELS);
-    for (int channelCounter = 0; channelCounter < HANTEK_CHANNELS; ++channelCounter)
-        result.data[channelCounter].clear();
+    result.compactData.resize(HANTEK_CHANNELS);
+    if (result.compact != compact) {
+        // Give the memory of the storage that isn't used anymore back
+        for (unsigned channel = 0; channel < HANTEK_CHANNELS; ++channel) {
+            std::vector<double>().swap(result.data[channel]);
+            result.compactData[channel].release();
+        }
+        result.compact = compact;
+    }
+    // The buffers of the stored channels are resized in place, so a frame of the same length isn't filled with zeros
+    // before it is written. Only the channels that aren't stored this time are cleared
+    bool stored[HANTEK_CHANNELS] = {};
+    auto clearUnstored = [&]() {
+        for (unsigned channel = 0; channel < HANTEK_CHANNELS; ++channel) {
+            if (stored[channel]) continue;
+            result.data[channel].clear();
+            result.compactData[channel].clear();
+        }
+    };
 
     const unsigned extraBitsSize = specification.sampleSize - 8;             // Number of extra bits
     const unsigned short extraBitsMask = (0x00ff << extraBitsSize) & 0xff00; // Mask for extra bits extraction
 
+    // Store a channel either as voltages or as raw codes with the conversion parameters
+    auto store8 = [&](unsigned channel, unsigned start, unsigned stride, size_t count, double scale, double shift) {
+        stored[channel] = true;
+        if (extract) {
+            DSOcompactChannel &compactChannel = result.compactData[channel];
+            compactChannel.wide = false;
+            compactChannel.scale = scale;
+            compactChannel.shift = shift;
+            compactChannel.codes16.clear();
+            compactChannel.codes8.resize(count);
+            ThreadScheduling::lockBuffer(compactChannel.codes8);
+            extractSamples8(rawData.data(), totalSampleCount, start, stride, compactChannel.codes8.data(), count);
+        } else {
+            voltageTables[channel].update(1u << specification.sampleSize, scale, shift);
+            result.compactData[channel].clear();
+            result.data[channel].resize(count);
+            ThreadScheduling::lockBuffer(result.data[channel]);
+            convertSamples8(rawData.data(), totalSampleCount, start, stride, result.data[channel].data(), count,
+                            voltageTables[channel]);
+        }
+    };
+    auto store10 = [&](unsigned channel, unsigned start, unsigned lowOffset, unsigned highShift, size_t count,
+                       double scale, double shift) {
+        const unsigned char *low = rawData.data();
+        const unsigned char *high = rawData.data() + totalSampleCount;
+        stored[channel] = true;
+        if (extract) {
+            DSOcompactChannel &compactChannel = result.compactData[channel];
+            compactChannel.wide = true;
+            compactChannel.scale = scale;
+            compactChannel.shift = shift;
+            compactChannel.codes8.clear();
+            compactChannel.codes16.resize(count);
+            ThreadScheduling::lockBuffer(compactChannel.codes16);
+            extractSamples10(low, high, totalSampleCount, start, HANTEK_CHANNELS, lowOffset, highShift, extraBitsMask,
+                             compactChannel.codes16.data(), count);
+        } else {
+            voltageTables[channel].update(1u << specification.sampleSize, scale, shift);
+            result.compactData[channel].clear();
+            result.data[channel].resize(count);
+            ThreadScheduling::lockBuffer(result.data[channel]);
+            convertSamples10(low, high, totalSampleCount, start, HANTEK_CHANNELS, lowOffset, highShift, extraBitsMask,
+                             result.data[channel].data(), count, voltageTables[channel]);
+        }
+    };
+
     // Convert channel data
     if (isFastRate()) {
         // Fast rate mode, one channel is using all buffers
@@ -462,43 +603,51 @@ void HantekDsoControl::convertRawDataToSamples(const std::vector<unsigned char>
             if (controlsettings.voltage[channel].used) break;
         }
 
-        if (channel >= HANTEK_CHANNELS) return;
-
-        // Resize sample vector
-        result.data[channel].resize(totalSampleCount);
+        if (channel >= HANTEK_CHANNELS) {
+            clearUnstored();
+            return;
+        }
 
         const int gainID = (int)controlsettings.voltage[channel].gain;
         const unsigned short limit = specification.voltageLimit[channel][gainID];
         const double offset = controlsettings.voltage[channel].offsetReal;
         const double gainStep = specification.gainSteps[gainID];
+        const double scale = gainStep / limit;
+        const double shift = -offset * gainStep;
 
         // Convert data from the oscilloscope and write it into the sample buffer
         unsigned bufferPosition = controlsettings.trigger.point * 2;
         if (specification.sampleSize > 8) {
-            for (unsigned pos = 0; pos < totalSampleCount; ++pos, ++bufferPosition) {
-                if (bufferPosition >= totalSampleCount) bufferPosition %= totalSampleCount;
-
-                const unsigned short low = rawData[bufferPosition];
-                const unsigned extraBitsPosition = bufferPosition % HANTEK_CHANNELS;
-                const unsigned shift = (8 - (HANTEK_CHANNELS - 1 - extraBitsPosition) * extraBitsSize);
-                const unsigned short high =
-                    ((unsigned short int)rawData[totalSampleCount + bufferPosition - extraBitsPosition] << shift) &
-                    extraBitsMask;
-
-                result.data[channel][pos] = ((double)(low + high) / limit - offset) * gainStep;
+            const unsigned char *low = rawData.data();
+            const unsigned char *high = rawData.data() + totalSampleCount;
+            stored[channel] = true;
+            if (extract) {
+                DSOcompactChannel &compactChannel = result.compactData[channel];
+                compactChannel.wide = true;
+                compactChannel.scale = scale;
+                compactChannel.shift = shift;
+                compactChannel.codes8.clear();
+                compactChannel.codes16.resize(totalSampleCount);
+                ThreadScheduling::lockBuffer(compactChannel.codes16);
+                extractSamples10FastRate<HANTEK_CHANNELS>(low, high, totalSampleCount, bufferPosition, extraBitsSize,
+                                                          extraBitsMask, compactChannel.codes16.data(),
+                                                          totalSampleCount);
+            } else {
+                voltageTables[channel].update(1u << specification.sampleSize, scale, shift);
+                result.compactData[channel].clear();
+                result.data[channel].resize(totalSampleCount);
+                ThreadScheduling::lockBuffer(result.data[channel]);
+                convertSamples10FastRate<HANTEK_CHANNELS>(low, high, totalSampleCount, bufferPosition, extraBitsSize,
+                                                          extraBitsMask, result.data[channel].data(),
+                                                          totalSampleCount, voltageTables[channel]);
             }
         } else {
-            for (unsigned pos = 0; pos < totalSampleCount; ++pos, ++bufferPosition) {
-                if (bufferPosition >= totalSampleCount) bufferPosition %= totalSampleCount;
-
-                double dataBuf = (double)((int)rawData[bufferPosition]);
-                result.data[channel][pos] = (dataBuf / limit - offset) * gainStep;
-            }
+            store8(channel, bufferPosition, 1, totalSampleCount, scale, shift);
         }
     } else {
         // Normal mode, channels are using their separate buffers
         for (unsigned channel = 0; channel < HANTEK_CHANNELS; ++channel) {
-            result.data[channel].resize(totalSampleCount / HANTEK_CHANNELS);
+            size_t sampleCount = totalSampleCount / HANTEK_CHANNELS;
 
             const int gainID = controlsettings.voltage[channel].gain;
             const unsigned short limit = specification.voltageLimit[channel][gainID];
@@ -511,127 +660,73 @@ void HantekDsoControl::convertRawDataToSamples(const std::vector<unsigned char>
                 // Additional most significant bits after the normal data
                 unsigned extraBitsIndex = 8 - channel * 2; // Bit position offset for extra bits extraction
 
-                for (unsigned realPosition = 0; realPosition < result.data[channel].size();
-                     ++realPosition, bufferPosition += HANTEK_CHANNELS) {
-                    if (bufferPosition >= totalSampleCount) bufferPosition %= totalSampleCount;
-
-                    const unsigned short low = rawData[bufferPosition + HANTEK_CHANNELS - 1 - channel];
-                    const unsigned short high =
-                        ((unsigned short int)rawData[totalSampleCount + bufferPosition] << extraBitsIndex) &
-                        extraBitsMask;
-
-                    result.data[channel][realPosition] = ((double)(low + high) / limit - offset) * gainStep;
-                }
+                store10(channel, bufferPosition, HANTEK_CHANNELS - 1 - channel, extraBitsIndex, sampleCount,
+                        gainStep / limit, -offset * gainStep);
             } else if (device->getUniqueModelID() == MODEL_DSO6022BE) {
                 // if device is 6022BE, drop heading & trailing samples
                 const unsigned DROP_DSO6022_HEAD = 0x410;
                 const unsigned DROP_DSO6022_TAIL = 0x3F0;
-                if (!isRollMode()) {
-                    result.data[channel].resize(result.data[channel].size() - (DROP_DSO6022_HEAD + DROP_DSO6022_TAIL));
+                // Frames cut out of the stream contain no stale data
+                if (!isRollMode() && !streaming) {
+                    const size_t dropped = DROP_DSO6022_HEAD + DROP_DSO6022_TAIL;
+                    sampleCount = sampleCount > dropped ? sampleCount - dropped : 0;
                     // if device is 6022BE, offset DROP_DSO6022_HEAD incrementally
                     bufferPosition += DROP_DSO6022_HEAD * 2;
                 }
                 bufferPosition += channel;
-                for (unsigned pos = 0; pos < result.data[channel].size(); ++pos, bufferPosition += HANTEK_CHANNELS) {
-                    if (bufferPosition >= totalSampleCount) bufferPosition %= totalSampleCount;
-                    double dataBuf = (double)((int)(rawData[bufferPosition] - 0x83));
-                    result.data[channel][pos] = (dataBuf / limit) * gainStep;
-                }
+                // The samples are biased by 0x83
+                store8(channel, bufferPosition, HANTEK_CHANNELS, sampleCount, gainStep / limit,
+                       -0x83 * gainStep / limit);
             } else {
                 bufferPosition += HANTEK_CHANNELS - 1 - channel;
-                for (unsigned pos = 0; pos < result.data[channel].size(); ++pos, bufferPosition += HANTEK_CHANNELS) {
-                    if (bufferPosition >= totalSampleCount) bufferPosition %= totalSampleCount;
-                    double dataBuf = (double)((int)(rawData[bufferPosition]));
-                    result.data[channel][pos] = (dataBuf / limit - offset) * gainStep;
-                }
+                store8(channel, bufferPosition, HANTEK_CHANNELS, sampleCount, gainStep / limit, -offset * gainStep);
             }
         }
     }
-}
 
-double HantekDsoControl::getBestSamplerate(double samplerate, bool fastRate, bool maximum,
-                                           unsigned *downsampler) const {
-    // Abort if the input value is invalid
-    if (samplerate <= 0.0) return 0.0;
-
-    double bestSamplerate = 0.0;
+    clearUnstored();
 
-    // Get samplerate specifications for this mode and model
-    const ControlSamplerateLimits *limits;
-    if (fastRate)
-        limits = &(specification.samplerate.multi);
-    else
-        limits = &(specification.samplerate.single);
-
-    // Get downsampling factor that would provide the requested rate
-    double bestDownsampler =
-        (double)limits->base / specification.bufferDividers[controlsettings.recordLengthId] / samplerate;
-    // Base samplerate sufficient, or is the maximum better?
-    if (bestDownsampler < 1.0 &&
-        (samplerate <= limits->max / specification.bufferDividers[controlsettings.recordLengthId] || !maximum)) {
-        bestDownsampler = 0.0;
-        bestSamplerate = limits->max / specification.bufferDividers[controlsettings.recordLengthId];
-    } else {
-        switch (specification.command.bulk.setSamplerate) {
-        case BULK_SETTRIGGERANDSAMPLERATE:
-            // DSO-2090 supports the downsampling factors 1, 2, 4 and 5 using
-            // valueFast or all even values above using valueSlow
-            if ((maximum && bestDownsampler <= 5.0) || (!maximum && bestDownsampler < 6.0)) {
-                // valueFast is used
-                if (maximum) {
-                    // The samplerate shall not be higher, so we round up
-                    bestDownsampler = ceil(bestDownsampler);
-                    if (bestDownsampler > 2.0) // 3 and 4 not possible with the DSO-2090
-                        bestDownsampler = 5.0;
-                } else {
-                    // The samplerate shall not be lower, so we round down
-                    bestDownsampler = floor(bestDownsampler);
-                    if (bestDownsampler > 2.0 && bestDownsampler < 5.0) // 3 and 4 not possible with the DSO-2090
-                        bestDownsampler = 2.0;
-                }
-            } else {
-                // valueSlow is used
-                if (maximum) {
-                    bestDownsampler = ceil(bestDownsampler / 2.0) * 2.0; // Round up to next even value
-                } else {
-                    bestDownsampler = floor(bestDownsampler / 2.0) * 2.0; // Round down to next even value
-                }
-                if (bestDownsampler > 2.0 * 0x10001) // Check for overflow
-                    bestDownsampler = 2.0 * 0x10001;
-            }
-            break;
+    // Combine the codes, compact frames get the rounded codes and the others the voltages at full precision
+    if (!processed) return;
+    for (unsigned channel = 0; channel < HANTEK_CHANNELS; ++channel) {
+        if (!result.compactData[channel].size()) continue;
+        acquisition.process(channel, result.compactData[channel], compact ? nullptr : &result.data[channel]);
+    }
+}
 
-        case BULK_CSETTRIGGERORSAMPLERATE:
-            // DSO-5200 may not supports all downsampling factors, requires testing
-            if (maximum) {
-                bestDownsampler = ceil(bestDownsampler); // Round up to next integer value
-            } else {
-                bestDownsampler = floor(bestDownsampler); // Round down to next integer value
-            }
-            break;
+void HantekDsoControl::recordSamples() {
+    if (!recorder.isRecording()) return;
 
-        case BULK_ESETTRIGGERORSAMPLERATE:
-            // DSO-2250 doesn't have a fast value, so it supports all downsampling
-            // factors
-            if (maximum) {
-                bestDownsampler = ceil(bestDownsampler); // Round up to next integer value
-            } else {
-                bestDownsampler = floor(bestDownsampler); // Round down to next integer value
-            }
-            break;
+    CaptureRecorder::ChannelInfo channels[HANTEK_CHANNELS];
+    for (unsigned channel = 0; channel < HANTEK_CHANNELS; ++channel) {
+        channels[channel].gain = specification.gainSteps[controlsettings.voltage[channel].gain] / DIVS_VOLTAGE;
+        channels[channel].offset = (controlsettings.voltage[channel].offsetReal - 0.5) * DIVS_VOLTAGE;
+    }
+    // The samplerate of the frame is lower than the one of the device in high resolution mode
+    const DSOsamples &frame = sampleBuffer.writeFrame();
+    const double triggerPoint = isRollMode() ? -1.0 : controlsettings.trigger.position * frame.samplerate;
+    recorder.record(frame, triggerPoint, channels);
+}
 
-        default:
-            return 0.0;
-        }
+void HantekDsoControl::storeHistory() {
+    if (history.isEnabled()) history.store(sampleBuffer.writeFrame());
+}
 
-        // Limit maximum downsampler value to avoid overflows in the sent commands
-        if (bestDownsampler > limits->maxDownsampler) bestDownsampler = limits->maxDownsampler;
+void HantekDsoControl::publishSamples() {
+    // At most one notification is queued, the analysis takes the latest frame when it handles it
+    if (sampleBuffer.publish())
+        Instrumentation::count(Instrumentation::COUNTER_SKIPPED);
+    else
+        emit samplesAvailable();
+}
 
-        bestSamplerate = limits->base / bestDownsampler / specification.bufferDividers[controlsettings.recordLengthId];
-    }
+double HantekDsoControl::getBestSamplerate(double samplerate, bool fastRate, bool maximum,
+                                           unsigned *downsampler) const {
+    // Abort if the input value is invalid
+    if (samplerate <= 0.0) return 0.0;
 
-    if (downsampler) *downsampler = (unsigned)bestDownsampler;
-    return bestSamplerate;
+    return samplerateTable.find(samplerate, fastRate, maximum,
+                                specification.bufferDividers[controlsettings.recordLengthId], downsampler);
 }
 
 unsigned HantekDsoControl::getSampleCount() const {
@@ -686,17 +781,18 @@ unsigned HantekDsoControl::updateRecordLength(unsigned index) {
 
     controlsettings.recordLengthId = index;
 
-    if (bDividerChanged) {
-        this->updateSamplerateLimits();
+    // Pre-size the raw sample buffer, so the acquisitions don't have to grow it. The roll mode
+    // packet size would need a request to the device, the buffer grows on the first packet there.
+    if (!isRollMode())
+        rawSamples.reserve((specification.sampleSize > 8) ? this->getSampleCount() * 2 : this->getSampleCount());
 
-        // Samplerate dividers changed, recalculate it
-        this->restoreTargets();
-    }
+    // The samplerate is recalculated for the new divider by setRecordLength
+    if (bDividerChanged) this->updateSamplerateLimits();
 
     return controlsettings.samplerate.limits->recordLengths[index];
 }
 
-unsigned HantekDsoControl::updateSamplerate(unsigned downsampler, bool fastRate) {
+bool HantekDsoControl::storeSamplerate(unsigned &downsampler, bool fastRate) {
     // Get samplerate limits
     Hantek::ControlSamplerateLimits *limits =
         fastRate ? &specification.samplerate.multi : &specification.samplerate.single;
@@ -786,13 +882,28 @@ unsigned HantekDsoControl::updateSamplerate(unsigned downsampler, bool fastRate)
         break;
     }
     default:
-        return UINT_MAX;
+        return false;
     }
 
-    // Update settings
+    return true;
+}
+
+unsigned HantekDsoControl::updateSamplerate(unsigned downsampler, bool fastRate) {
+    // Get samplerate limits
+    Hantek::ControlSamplerateLimits *limits =
+        fastRate ? &specification.samplerate.multi : &specification.samplerate.single;
     bool fastRateChanged = fastRate != (controlsettings.samplerate.limits == &specification.samplerate.multi);
+
+    // The commands are only sent again if the selection changed, not if only the divider of the record length did
+    if (!samplerateStored || fastRateChanged || downsampler != controlsettings.samplerate.downsampler) {
+        if (!this->storeSamplerate(downsampler, fastRate)) return UINT_MAX;
+        samplerateStored = true;
+    }
+
+    // Update settings
     if (fastRateChanged) { controlsettings.samplerate.limits = limits; }
 
+    double previousSamplerate = controlsettings.samplerate.current;
     controlsettings.samplerate.downsampler = downsampler;
     if (downsampler)
         controlsettings.samplerate.current = controlsettings.samplerate.limits->base /
@@ -802,7 +913,8 @@ unsigned HantekDsoControl::updateSamplerate(unsigned downsampler, bool fastRate)
             controlsettings.samplerate.limits->max / specification.bufferDividers[controlsettings.recordLengthId];
 
     // Update dependencies
-    this->setPretriggerPosition(controlsettings.trigger.position);
+    if (fastRateChanged || controlsettings.samplerate.current != previousSamplerate)
+        this->setPretriggerPosition(controlsettings.trigger.position);
 
     // Emit signals for changed settings
     if (fastRateChanged) {
@@ -927,9 +1039,14 @@ Dso::ErrorCode HantekDsoControl::setRecordTime(double duration) {
         bool fastRate = (controlsettings.usedChannels <= 1) &&
                         (maxSamplerate >= specification.samplerate.multi.base /
                                               specification.bufferDividers[controlsettings.recordLengthId]);
+        // Fast rate mode records both buffers with one channel
+        if (fastRate)
+            maxSamplerate = (double)specification.samplerate.multi.recordLengths[controlsettings.recordLengthId] /
+                            duration;
 
         // What is the nearest, at most as high samplerate the scope can provide?
         unsigned downsampler = 0;
+        getBestSamplerate(maxSamplerate, fastRate, true, &(downsampler));
 
         // Set the calculated samplerate
         if (this->updateSamplerate(downsampler, fastRate) == UINT_MAX)
@@ -1267,7 +1384,69 @@ Dso::ErrorCode HantekDsoControl::setTriggerSlope(Dso::Slope slope) {
     return Dso::ErrorCode::ERROR_NONE;
 }
 
-void HantekDsoControl::forceTrigger() { commandPending[BULK_FORCETRIGGER] = true; }
+void HantekDsoControl::forceTrigger() {
+    commandPending[BULK_FORCETRIGGER] = true;
+    triggerForced = true;
+}
+
+/// \brief Selects how the converted samples are stored.
+/// \param enable true, if the samples should be kept as raw codes and only be
+/// converted to voltages by the consumer. This needs 4 to 8 times less memory.
+void HantekDsoControl::setCompactSamples(bool enable) { compactSamples = enable; }
+
+/// \brief Selects if the acquisition waits for the analysis instead of dropping frames.
+/// \param enable true, if every frame should be analyzed.
+void HantekDsoControl::setLosslessCapture(bool enable) { sampleBuffer.setLossless(enable); }
+
+/// \brief Selects the processing of the sample codes right after they were received.
+/// Has to be called on the thread of the device, the codes are processed there.
+/// \param mode The ::Dso::AcquisitionMode.
+/// \param count The number of averaged frames or the number of samples combined into one.
+void HantekDsoControl::setAcquisitionMode(Dso::AcquisitionMode mode, unsigned count) {
+    acquisition.setMode(mode, count);
+}
+
+/// \brief Enables/disables the segmented acquisition.
+/// Consecutive triggered frames are stored raw in a preallocated segment store
+/// without converting or analyzing them. Sampling stops when all segments are
+/// captured, they can be shown afterwards with showSegment().
+/// \param count The number of segments, 0 to disable the segmented acquisition.
+/// \return See ::Dso::ErrorCode.
+Dso::ErrorCode HantekDsoControl::setSegmentedAcquisition(unsigned count) {
+    if (!device->isConnected()) return Dso::ErrorCode::ERROR_CONNECTION;
+    if (count && (isRollMode() || streaming)) return Dso::ErrorCode::ERROR_UNSUPPORTED;
+
+    segmentCount = count;
+    segmentsCaptured = 0;
+    return Dso::ErrorCode::ERROR_NONE;
+}
+
+/// \brief Converts a captured segment, it is analyzed like a new frame.
+/// Has to be called on the thread of the device, the segment is converted in its next cycle.
+/// \param index The index of the segment.
+void HantekDsoControl::showSegment(unsigned index) { segmentRequested = (int)index; }
+
+/// \brief Sets the memory for the history of the last frames.
+/// The frames are kept as raw codes, so they are compact while the history is enabled.
+/// \param megabytes The memory in MiB, 0 disables the history.
+void HantekDsoControl::setHistoryMemory(unsigned megabytes) { history.setCapacity((size_t)megabytes << 20); }
+
+/// \brief Shows a frame of the history, it is analyzed like a new frame.
+/// Only used while the acquisition is stopped, otherwise the next frame would replace it right away.
+/// Has to be called on the thread of the device.
+/// \param index The index of the frame, 0 is the oldest frame.
+void HantekDsoControl::showHistory(unsigned index) { historyRequested = (int)index; }
+
+/// \brief Enables/disables reading the device continuously.
+/// The stream itself is started and stopped by the acquisition loop.
+/// \param enable true, if the device should be streamed.
+/// \return See ::Dso::ErrorCode.
+Dso::ErrorCode HantekDsoControl::setStreaming(bool enable) {
+    if (!specification.supportsStreaming) return Dso::ErrorCode::ERROR_UNSUPPORTED;
+
+    streaming = enable;
+    return Dso::ErrorCode::ERROR_NONE;
+}
 
 /// \brief Set the trigger position.
 /// \param position The new trigger position (in s).
@@ -1370,12 +1549,118 @@ Dso::ErrorCode HantekDsoControl::stringCommand(const QString &commandString) {
         return Dso::ErrorCode::ERROR_UNSUPPORTED;
 }
 
-void HantekDsoControl::run() {
-    int errorCode = 0;
+bool HantekDsoControl::runStreaming() {
+    if (!this->sampling) {
+        if (device->isStreaming()) device->stopStreaming();
+        return true;
+    }
+
+    const unsigned frameLength = this->getSampleCount();
+    if (!device->isStreaming()) {
+        // Buffer about a second of data, but at least a few frames
+        const unsigned sampleBytes = isFastRate() ? 1 : HANTEK_CHANNELS;
+        const double bytesPerSecond = controlsettings.samplerate.current * sampleBytes;
+        const unsigned bufferSize =
+            qMax(frameLength * 4, (unsigned)qMin(bytesPerSecond, (double)HANTEK_STREAM_BUFFER_MAX));
+
+        // The calibrated transfers keep at least as much data in flight, it bridges the scheduling gaps
+        const unsigned transferSize = device->isAsyncTransferEnabled()
+                                          ? device->getTransferConfiguration().transferSize
+                                          : HANTEK_STREAM_TRANSFER_SIZE;
+        const unsigned transferCount =
+            qMax(device->getTransferConfiguration().transferCount,
+                 (unsigned)((unsigned long long)HANTEK_STREAM_TRANSFERS * HANTEK_STREAM_TRANSFER_SIZE / transferSize));
+        int errorCode = device->startStreaming(transferSize, transferCount, bufferSize, sampleBytes);
+        if (errorCode < 0) {
+            qWarning() << "Starting stream failed: " << libUsbErrorString(errorCode);
+            if (errorCode == LIBUSB_ERROR_NO_DEVICE) {
+                emit communicationError();
+                return false;
+            }
+            return true;
+        }
+
+        timestampDebug("Starting to stream");
+        this->streamDropped = 0;
+    }
+
+    // Cut all complete frames out of the stream, in the order they were received
+    rawSamples.resize(frameLength);
+    ThreadScheduling::lockBuffer(rawSamples);
+    do {
+        int errorCode = device->readStream(rawSamples.data(), frameLength, qMax(cycleTime, 10));
+        if (errorCode < 0) {
+            qWarning() << "Reading stream failed: " << libUsbErrorString(errorCode);
+            if (errorCode == LIBUSB_ERROR_NO_DEVICE) {
+                emit communicationError();
+                return false;
+            }
+            device->stopStreaming();
+            return true;
+        }
+        if (errorCode == 0) break;
+        Instrumentation::count(Instrumentation::COUNTER_FRAMES);
+        Instrumentation::count(Instrumentation::COUNTER_USBBYTES, frameLength);
+
+        convertRawDataToSamples(rawSamples);
+        this->recordSamples();
+        this->storeHistory();
+        // The frames the analysis didn't take yet stay in the stream, so no part of it is left out
+        if (!this->waitForAnalysis()) return false;
+        this->publishSamples();
+
+        if (controlsettings.trigger.mode == Dso::TRIGGERMODE_SINGLE) {
+            this->stopSampling();
+            device->stopStreaming();
+            break;
+        }
+    } while (device->getStreamAvailable() >= frameLength);
 
-    // Send all pending bulk commands
+    const unsigned long long dropped = device->getStreamDroppedBytes();
+    if (dropped != this->streamDropped) {
+        emit statusMessage(tr("Stream overflow, %1 bytes dropped").arg(dropped - this->streamDropped), 1000);
+        this->streamDropped = dropped;
+    }
+
+    return true;
+}
+
+/// \brief Waits until the analysis took the previous frame, the stream keeps receiving meanwhile.
+/// After HANTEK_STREAM_HANDOFF_WAIT the frame is dropped, the analysis may have stopped.
+/// \return false, if the communication with the device failed.
+bool HantekDsoControl::waitForAnalysis() {
+    QElapsedTimer timer;
+    timer.start();
+    while (!sampleBuffer.isLatestTaken() && timer.elapsed() < HANTEK_STREAM_HANDOFF_WAIT) {
+        const int errorCode = device->waitForEvents(HANTEK_EVENT_WAIT_MAX * 1000);
+        if (errorCode == LIBUSB_ERROR_NO_DEVICE) {
+            emit communicationError();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HantekDsoControl::applyPendingCommands() {
+    bool reconfigured = false;
+    return sendPendingCommands(reconfigured);
+}
+
+/// \brief Sends the pending bulk and control commands.
+/// Settings changed between two cycles only modify the command buffers, so a
+/// command that was changed several times is only sent once with its latest
+/// state. The pending flag is reset before the command is copied, a change
+/// during the transfer is sent in the next cycle. All control commands are
+/// sent in one burst.
+/// \param reconfigured Is set to true, if a command changed the device settings.
+/// \return false, if the communication with the device failed.
+bool HantekDsoControl::sendPendingCommands(bool &reconfigured) {
+    int errorCode;
+
+    // Bulk commands have to be sent one by one, every command needs a preceding BeginCommand control
     for (int cIndex = 0; cIndex < BULK_COUNT; ++cIndex) {
         if (!commandPending[cIndex]) continue;
+        commandPending[cIndex] = false;
 
         timestampDebug(
             QString("Sending bulk command:%1").arg(hexDump(command[cIndex]->data(), command[cIndex]->getSize())));
@@ -1383,36 +1668,209 @@ void HantekDsoControl::run() {
         errorCode = device->bulkCommand(command[cIndex]);
         if (errorCode < 0) {
             qWarning("Sending bulk command %02x failed: %s", cIndex, libUsbErrorString(errorCode).toLocal8Bit().data());
+            commandPending[cIndex] = true;
             emit communicationError();
-            return;
-        } else
-            commandPending[cIndex] = false;
+            return false;
+        }
+
+        // Forcing the trigger doesn't change the settings
+        if (cIndex != BULK_FORCETRIGGER) reconfigured = true;
     }
 
-    // Send all pending control commands
+    // Collect the control commands
+    std::vector<USBControlWrite> writes;
+    std::vector<int> writeIndex;
     for (int cIndex = 0; cIndex < CONTROLINDEX_COUNT; ++cIndex) {
         if (!this->controlPending[cIndex]) continue;
+        this->controlPending[cIndex] = false;
 
         timestampDebug(QString("Sending control command %1:%2")
-                           .arg(QString::number(this->controlCode[control], 16),
-                                hexDump(this->control[control]->data(), this->control[control]->getSize())));
+                           .arg(QString::number(this->controlCode[cIndex], 16),
+                                hexDump(this->control[cIndex]->data(), this->control[cIndex]->getSize())));
+
+        USBControlWrite write;
+        write.request = this->controlCode[cIndex];
+        const unsigned char *data = this->control[cIndex]->data();
+        write.data.assign(data, data + this->control[cIndex]->getSize());
+        writes.push_back(std::move(write));
+        writeIndex.push_back(cIndex);
+    }
+    if (writes.empty()) return true;
 
-        errorCode = device->controlWrite(this->controlCode[cIndex], this->control[cIndex]->data(),
-                                         this->control[cIndex]->getSize());
-        if (errorCode < 0) {
-            qWarning("Sending control command %2x failed: %s", this->controlCode[cIndex],
-                     libUsbErrorString(errorCode).toLocal8Bit().data());
+    errorCode = device->controlWriteBatch(writes);
+    for (size_t write = 0; write < writes.size(); ++write) {
+        if (writes[write].result >= 0) {
+            reconfigured = true;
+            continue;
+        }
 
-            if (errorCode == LIBUSB_ERROR_NO_DEVICE) {
-                emit communicationError();
-                return;
-            }
-        } else
-            this->controlPending[cIndex] = false;
+        // Failed commands are retried in the next cycle, unless a newer state is pending by then anyway
+        qWarning("Sending control command %2x failed: %s", writes[write].request,
+                 libUsbErrorString(writes[write].result).toLocal8Bit().data());
+        this->controlPending[writeIndex[write]] = true;
+    }
+
+    if (errorCode == LIBUSB_ERROR_NO_DEVICE) {
+        emit communicationError();
+        return false;
+    }
+    return true;
+}
+
+/// \brief Reads the ready frame into the next slot of the segment store.
+void HantekDsoControl::captureSegment() {
+    if (segmentsCaptured == 0) {
+        // Allocate the whole store before the first segment, so storing a segment never allocates
+        const unsigned sampleCount = this->getSampleCount();
+        const size_t segmentSize = (specification.sampleSize > 8) ? sampleCount * 2 : sampleCount;
+        segments.resize(segmentCount);
+        for (std::vector<unsigned char> &segment : segments) segment.reserve(segmentSize);
+        segmentSettings.resize(segmentCount);
+        segmentTimestamps.resize(segmentCount);
+        segmentFrameIds.resize(segmentCount);
+    }
+    if (segmentsCaptured >= segments.size()) return;
+
+    if (this->getSamples(previousSampleCount, segments[segmentsCaptured], segmentFrameIds[segmentsCaptured]) <= 0)
+        return;
+    segmentSettings[segmentsCaptured] = controlsettings;
+    segmentTimestamps[segmentsCaptured] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              std::chrono::steady_clock::now().time_since_epoch())
+                                              .count();
+    ++segmentsCaptured;
+
+    if (segmentsCaptured == segmentCount) {
+        timestampDebug(QString("Captured %1 segments").arg(segmentsCaptured));
+        this->stopSampling();
+        emit segmentsComplete(segmentCount);
+    }
+}
+
+/// \brief Converts the requested segment with the gains, offsets, samplerate and trigger point it was captured with.
+void HantekDsoControl::showRequestedSegment() {
+    const unsigned index = (unsigned)segmentRequested;
+    segmentRequested = -1;
+    if (index >= segmentsCaptured) return;
+
+    // The segments are separate captures, they aren't averaged with each other or the next frames
+    const Hantek::ControlSettings currentSettings = controlsettings;
+    controlsettings = segmentSettings[index];
+    acquisition.reset();
+    convertRawDataToSamples(segments[index], segmentFrameIds[index]);
+    acquisition.reset();
+    controlsettings = currentSettings;
+    sampleBuffer.writeFrame().timestamp = segmentTimestamps[index];
+    this->publishSamples();
+}
+
+/// \brief Publishes the requested frame of the history with the conversion parameters it was acquired with.
+void HantekDsoControl::showRequestedHistory() {
+    const unsigned index = (unsigned)historyRequested;
+    historyRequested = -1;
+    if (sampling || !history.load(index, sampleBuffer.writeFrame())) return;
+    this->publishSamples();
+}
+
+/// \brief Applies the cached usb transfers or calibrates them at the highest samplerate.
+/// The device limits the throughput at lower samplerates, so it sends as fast as it can while it is measured.
+/// \return false, if the communication failed.
+bool HantekDsoControl::calibrateTransfers() {
+    transfersCalibrated = true;
+    if (TransferCalibration::applyCached(device)) return true;
+
+    bool reconfigured = false;
+    const ControlSettingsSamplerate samplerate = controlsettings.samplerate;
+    const bool switched = specification.isSoftwareTriggerDevice && !specification.sampleSteps.isEmpty() &&
+                          samplerate.current < specification.sampleSteps.back();
+    if (switched) {
+        this->setSamplerate(specification.sampleSteps.back());
+        if (!this->sendPendingCommands(reconfigured)) return false;
+    }
+
+    const unsigned sampleBytes = (specification.sampleSize > 8) ? 2 : 1;
+    TransferCalibration::calibrate(device, controlsettings.samplerate.current * HANTEK_CHANNELS * sampleBytes);
+
+    if (!switched) return true;
+    this->setSamplerate(samplerate.current);
+    controlsettings.samplerate.target = samplerate.target;
+    return this->sendPendingCommands(reconfigured);
+}
+
+void HantekDsoControl::resume() {
+    if (!device->isConnected()) return;
+
+    for (int cIndex = 0; cIndex < BULK_COUNT; ++cIndex) commandPending[cIndex] |= settingsCommand[cIndex];
+    for (int cIndex = 0; cIndex < CONTROLINDEX_COUNT; ++cIndex) controlPending[cIndex] |= settingsControl[cIndex];
+
+    // A frame that was captured before the interruption is lost
+    this->previousSampleCount = 0;
+    this->captureState = CAPTURE_WAITING;
+    this->rollState = ROLL_STARTSAMPLING;
+    this->_samplingStarted = false;
+    if (device->isStreaming()) device->stopStreaming();
+
+    if (!scheduled) {
+        scheduled = true;
+        QTimer::singleShot(0, this, &HantekDsoControl::run);
+    }
+}
+
+void HantekDsoControl::applyConfiguration(const DeviceConfiguration &configuration) {
+    if (!device->isConnected()) return;
+
+    const unsigned channels = (unsigned)std::min(configuration.channels.size(), (size_t)HANTEK_CHANNELS);
+    for (unsigned channel = 0; channel < channels; ++channel) {
+        const DeviceChannelConfiguration &channelConfiguration = configuration.channels[channel];
+        this->setCoupling(channel, channelConfiguration.coupling);
+        this->setGain(channel, channelConfiguration.gain);
+        this->setOffset(channel, channelConfiguration.offset);
+        this->setTriggerLevel(channel, channelConfiguration.triggerLevel);
+        this->setChannelUsed(channel, channelConfiguration.used);
     }
+    if (configuration.samplerateSet)
+        this->setSamplerate(configuration.samplerate);
+    else
+        this->setRecordTime(configuration.recordTime);
+    this->setRecordLength(configuration.recordLength);
+    this->setTriggerMode(configuration.triggerMode);
+    this->setPretriggerPosition(configuration.pretriggerPosition);
+    this->setTriggerSlope(configuration.triggerSlope);
+    this->setTriggerSource(configuration.triggerSpecial, configuration.triggerSource);
+    this->setAcquisitionMode(configuration.acquisitionMode, configuration.acquisitionCount);
+    this->setStreaming(configuration.streaming);
+    this->setCompactSamples(configuration.compactSamples);
+    this->setLosslessCapture(configuration.losslessCapture);
+    this->setHistoryMemory(configuration.historyMemory);
+}
+
+void HantekDsoControl::run() {
+    int errorCode = 0;
+    bool reconfigured = false;
+    scheduled = false;
+
+    // The communication pauses while the device is disconnected, resume() continues it
+    if (!device->isConnected()) return;
+
+    // Send all settings that changed since the last cycle
+    if (!this->sendPendingCommands(reconfigured)) return;
+    // The free running devices are read fastest with the transfers calibrated on this host
+    if (!transfersCalibrated && device->isAsyncTransferEnabled() && !this->calibrateTransfers()) return;
+    // The running means start over with the new settings
+    if (reconfigured) acquisition.reset();
+
+    // Show a captured segment if one was selected
+    if (segmentRequested >= 0) this->showRequestedSegment();
+    // Or a frame of the history
+    if (historyRequested >= 0) this->showRequestedHistory();
+
+    // Data that is still in flight was sampled with the old settings
+    if ((reconfigured || !streaming) && device->isStreaming()) device->stopStreaming();
 
     // State machine for the device communication
-    if (isRollMode()) {
+    if (streaming) {
+        // Streaming mode
+        if (!this->runStreaming()) return;
+    } else if (isRollMode()) {
         // Roll mode
         this->captureState = CAPTURE_WAITING;
         bool toNextState = true;
@@ -1472,10 +1930,13 @@ void HantekDsoControl::run() {
             break;
 
         case ROLL_GETDATA: {
-            std::vector<unsigned char> rawData = this->getSamples(previousSampleCount);
+            quint64 frameId;
+            this->getSamples(previousSampleCount, rawSamples, frameId);
             if (this->_samplingStarted) {
-                convertRawDataToSamples(rawData);
-                emit samplesAvailable();
+                convertRawDataToSamples(rawSamples, frameId);
+                this->recordSamples();
+                this->storeHistory();
+                this->publishSamples();
             }
         }
 
@@ -1512,15 +1973,25 @@ void HantekDsoControl::run() {
         case CAPTURE_READY:
         case CAPTURE_READY2250:
         case CAPTURE_READY5200: {
-            std::vector<unsigned char> rawData = this->getSamples(previousSampleCount);
-            if (this->_samplingStarted) {
-                convertRawDataToSamples(rawData);
-                emit samplesAvailable();
+            scheduler.captureReady();
+            if (segmentCount && this->sampling) {
+                // Only store the frame, the segments are processed when all are captured
+                if (this->_samplingStarted) this->captureSegment();
+            } else {
+                quint64 frameId;
+                this->getSamples(previousSampleCount, rawSamples, frameId);
+                if (this->_samplingStarted) {
+                    convertRawDataToSamples(rawSamples, frameId);
+                    this->recordSamples();
+                    this->storeHistory();
+                    this->publishSamples();
+                }
             }
         }
 
             // Check if we're in single trigger mode
-            if (controlsettings.trigger.mode == Dso::TRIGGERMODE_SINGLE && this->_samplingStarted) this->stopSampling();
+            if (controlsettings.trigger.mode == Dso::TRIGGERMODE_SINGLE && this->_samplingStarted && !segmentCount)
+                this->stopSampling();
 
             // Sampling completed, restart it when necessary
             this->_samplingStarted = false;
@@ -1533,9 +2004,7 @@ void HantekDsoControl::run() {
             this->previousSampleCount = this->getSampleCount();
 
             if (this->_samplingStarted && this->lastTriggerMode == controlsettings.trigger.mode) {
-                ++this->cycleCounter;
-
-                if (this->cycleCounter == this->startCycle && !isRollMode()) {
+                if (scheduler.isTriggerDue()) {
                     // Buffer refilled completely since start of sampling, enable the
                     // trigger now
                     errorCode = device->bulkCommand(command[BULK_ENABLETRIGGER]);
@@ -1547,9 +2016,9 @@ void HantekDsoControl::run() {
                         break;
                     }
 
+                    scheduler.triggerEnabled();
                     timestampDebug("Enabling trigger");
-                } else if (this->cycleCounter >= 8 + this->startCycle &&
-                           controlsettings.trigger.mode == Dso::TRIGGERMODE_AUTO) {
+                } else if (scheduler.isForceTriggerDue() && controlsettings.trigger.mode == Dso::TRIGGERMODE_AUTO) {
                     // Force triggering
                     errorCode = device->bulkCommand(command[BULK_FORCETRIGGER]);
                     if (errorCode < 0) {
@@ -1560,10 +2029,11 @@ void HantekDsoControl::run() {
                         break;
                     }
 
+                    triggerForced = true;
                     timestampDebug("Forcing trigger");
                 }
 
-                if (this->cycleCounter < 20 || this->cycleCounter < 4000 / cycleTime) break;
+                if (!scheduler.isRestartDue()) break;
             }
 
             // Start capturing
@@ -1579,8 +2049,8 @@ void HantekDsoControl::run() {
             timestampDebug("Starting to capture");
 
             this->_samplingStarted = true;
-            this->cycleCounter = 0;
-            this->startCycle = controlsettings.trigger.position * 1000 / cycleTime + 1;
+            this->triggerForced = false;
+            scheduler.captureStarted();
             this->lastTriggerMode = controlsettings.trigger.mode;
             break;
 
@@ -1592,9 +2062,20 @@ void HantekDsoControl::run() {
     }
 
     this->updateInterval();
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 4, 0))
-    QTimer::singleShot(cycleTime, this, &HantekDsoControl::run);
-#else
-    QTimer::singleShot(cycleTime, this, SLOT(run()));
-#endif
+
+    // Wait for the predicted capture completion in standard mode, streaming waits while reading
+    double delay = cycleTime;
+    if (streaming) {
+        if (this->sampling) delay = 0;
+    } else if (!isRollMode() && this->sampling)
+        delay = scheduler.nextPoll(controlsettings.trigger.mode == Dso::TRIGGERMODE_AUTO);
+
+    // Timers are too coarse for short delays, handle usb events meanwhile instead
+    if (delay < HANTEK_EVENT_WAIT_MAX) {
+        if (delay > 0) device->waitForEvents((unsigned)(delay * 1000));
+        delay = 0;
+    }
+
+    scheduled = true;
+    QTimer::singleShot((int)delay, Qt::PreciseTimer, this, &HantekDsoControl::run);
 }
@@ -2,13 +2,20 @@
 
 #pragma once
 
+#include "acquisitionmodes.h"
+#include "acquisitionscheduler.h"
 #include "bulkStructs.h"
+#include "capture/capturerecorder.h"
+#include "capture/framehistory.h"
 #include "controlStructs.h"
 #include "dsosamples.h"
+#include "sampleconversion.h"
+#include "sampleratetable.h"
 #include "states.h"
 #include "controlspecification.h"
 #include "controlsettings.h"
 #include "controlindexes.h"
+#include "deviceconfiguration.h"
 #include "utils/dataarray.h"
 #include "utils/printutils.h"
 
@@ -67,8 +74,18 @@ class HantekDsoControl : public QObject {
     /// Return the associated usb device.
     const USBDevice *getDevice() const;
 
-    /// Return the last sample set
-    const DSOsamples &getLastSamples();
+    /// Return the buffer the sample sets are passed to the analysis with
+    DSOsampleBuffer &getSampleBuffer();
+
+    /// Return the recorder that streams the frames to disk, it can be started and stopped from any thread
+    CaptureRecorder &getRecorder();
+
+    /// \brief Check if the device supports gapless streaming.
+    bool isStreamingSupported() const;
+
+    /// \brief Gets the number of segments of the segmented acquisition.
+    /// \return The number of segments that can be shown by showSegment().
+    unsigned getSegmentsCaptured() const;
 
     /// \brief Sends bulk/control commands directly.
     /// <p>
@@ -83,9 +100,26 @@ class HantekDsoControl : public QObject {
     /// \return See ::Dso::ErrorCode.
     Dso::ErrorCode stringCommand(const QString &commandString);
 
+    /// \return true, if only the first channel is sampled, with the samplerate of both channels.
+    bool isFastRate() const;
+
+    /// \return The bits per sample of the device.
+    unsigned getSampleSize() const { return specification.sampleSize; }
+
+    /// \brief Sends the changed settings to the device outside of the acquisition loop.
+    /// Together with convertRawDataToSamples() the conversion can be run on its own, without run().
+    /// \return false, if the communication with the device failed.
+    bool applyPendingCommands();
+
+    /// \brief Converts raw oscilloscope data to sample data
+    /// The samples are written into the back frame of the sample buffer.
+    /// \param frameId The id of the frame from getSamples(), 0 if a new id should be assigned.
+    void convertRawDataToSamples(const std::vector<unsigned char> &rawData, quint64 frameId = 0);
+
   private:
     bool isRollMode() const;
-    bool isFastRate() const;
+    /// \return true, if the frames are placed by a hardware trigger, so consecutive frames can be averaged.
+    bool isHardwareTriggered() const;
     int getRecordLength() const;
 
     /// \brief Calculated the nearest samplerate supported by the oscilloscope.
@@ -107,6 +141,12 @@ class HantekDsoControl : public QObject {
 
     void updateInterval();
 
+    /// \brief Passes the converted frame to the recorder if it is recording.
+    void recordSamples();
+
+    /// \brief Keeps the converted frame in the history if it is enabled.
+    void storeHistory();
+
     /// \brief Calculates the trigger point from the CommandGetCaptureState data.
     /// \param value The data value that contains the trigger point.
     /// \return The calculated trigger point for the given data.
@@ -117,10 +157,26 @@ class HantekDsoControl : public QObject {
     std::pair<int, unsigned> getCaptureState() const;
 
     /// \brief Gets sample data from the oscilloscope
-    std::vector<unsigned char> getSamples(unsigned &previousSampleCount) const;
-
-    /// \brief Converts raw oscilloscope data to sample data
-    void convertRawDataToSamples(const std::vector<unsigned char> &rawData);
+    /// \param data The buffer for the raw data, it is resized to the received length.
+    /// Its capacity is kept, so a reused buffer doesn't need to be reallocated.
+    /// \param frameId Set to the id of the received frame, so the read can be traced.
+    /// \return Number of received bytes on success, libusb error code on error.
+    int getSamples(unsigned &previousSampleCount, std::vector<unsigned char> &data, quint64 &frameId) const;
+
+    /// \brief Publishes the converted samples and notifies the analysis.
+    void publishSamples();
+
+    /// \brief Cuts the available frames out of the device stream and converts them.
+    /// Starts the stream if necessary.
+    /// \return false, if the communication with the device failed.
+    bool runStreaming();
+    bool waitForAnalysis();
+
+    bool sendPendingCommands(bool &reconfigured);
+    bool calibrateTransfers();
+    void captureSegment();
+    void showRequestedSegment();
+    void showRequestedHistory();
 
     /// \brief Sets the size of the sample buffer without updating dependencies.
     /// \param index The record length index that should be set.
@@ -134,6 +190,12 @@ class HantekDsoControl : public QObject {
     /// \return The downsampling factor that has been set.
     unsigned updateSamplerate(unsigned downsampler, bool fastRate);
 
+    /// \brief Stores the downsampler in the samplerate commands and marks them pending.
+    /// \param downsampler The downsampling factor, it is adapted to the nearest one the command supports.
+    /// \param fastRate true, if one channel uses all buffers.
+    /// \return false, if the model has no samplerate command.
+    bool storeSamplerate(unsigned &downsampler, bool fastRate);
+
     /// \brief Restore the samplerate/timebase targets after divider updates.
     void restoreTargets();
 
@@ -157,28 +219,64 @@ class HantekDsoControl : public QObject {
                                                                          /// control commands
     bool controlPending[Hantek::CONTROLINDEX_COUNT] = {false};           ///< true, when the control
     /// command should be executed
+    bool settingsCommand[Hantek::BULK_COUNT] = {false};         ///< true, if the bulk command holds settings
+    bool settingsControl[Hantek::CONTROLINDEX_COUNT] = {false}; ///< true, if the control command holds settings
 
     // Device setup
     Hantek::ControlSpecification specification; ///< The specifications of the device
     Hantek::ControlSettings controlsettings;    ///< The current settings of the device
+    Hantek::SamplerateTable samplerateTable;    ///< The samplerates the device can be set to
+    bool samplerateStored = false;              ///< true, if the samplerate commands hold a selection
+    bool transfersCalibrated = false;           ///< true, if the usb transfers were calibrated or taken from the cache
 
     // Results
-    DSOsamples result;
+    std::vector<unsigned char> rawSamples; ///< The raw sample buffer, reused for every acquisition
+    DSOsampleBuffer sampleBuffer;     ///< Hands the converted frames over to the analysis
+    bool compactSamples = false;      ///< Store the results as raw codes instead of voltages
+    CaptureRecorder recorder;         ///< Records the frames, they are compact while it is recording
+    FrameHistory history;             ///< The last frames, they are compact while it is enabled
+    int historyRequested = -1;        ///< The frame of the history that should be shown next, -1 if none
     unsigned previousSampleCount = 0; ///< The expected total number of samples at
                                       /// the last check before sampling started
+    Hantek::VoltageTable voltageTables[HANTEK_CHANNELS]; ///< The voltages of the codes of every channel
+    Hantek::AcquisitionProcessor acquisition;            ///< Averages or decimates the codes before the conversion
 
     // State of the communication thread
+    bool scheduled = false; ///< true, while the next run() is scheduled
     int captureState = Hantek::CAPTURE_WAITING;
     int rollState = 0;
     bool _samplingStarted = false;
+    bool triggerForced = false; ///< true, if the trigger of the running capture was forced
     Dso::TriggerMode lastTriggerMode = (Dso::TriggerMode)-1;
-    int cycleCounter = 0;
-    int startCycle = 0;
-    int cycleTime = 0;
+    AcquisitionScheduler scheduler; ///< Decides when the capture state is checked in standard mode
+    int cycleTime = 0;              ///< The polling interval in roll mode in ms
+
+    // Streaming
+    bool streaming = false;               ///< true, if the device should be read continuously
+    unsigned long long streamDropped = 0; ///< The dropped stream bytes that were already reported
+
+    // Segmented acquisition
+    std::vector<std::vector<unsigned char>> segments;     ///< The raw data of the segments
+    std::vector<Hantek::ControlSettings> segmentSettings; ///< The settings every segment was captured with
+    std::vector<qint64> segmentTimestamps;                ///< The steady clock time every segment was received at
+    std::vector<quint64> segmentFrameIds;                 ///< The frame id of every segment
+    unsigned segmentCount = 0;                            ///< The number of segments to capture, 0 if disabled
+    unsigned segmentsCaptured = 0;                        ///< The number of segments captured so far
+    int segmentRequested = -1;                            ///< The segment that should be shown next, -1 if none
 
   public slots:
     void startSampling();
     void stopSampling();
+    /// \brief Restarts the communication after it failed or the device was reconnected.
+    /// All settings are sent to the device again, because a reconnected device
+    /// starts with its defaults. The acquisition continues with the state it had.
+    void resume();
+
+    /// \brief Applies all settings of a configuration at once.
+    /// The changed commands are sent together in the next cycle. Call it on the
+    /// thread of this object, e.g. with a queued invocation, so no cycle can run
+    /// between the single settings.
+    void applyConfiguration(const DeviceConfiguration &configuration);
 
     Dso::ErrorCode setRecordLength(unsigned size);
     Dso::ErrorCode setSamplerate(double samplerate = 0.0);
@@ -195,12 +293,22 @@ class HantekDsoControl : public QObject {
     Dso::ErrorCode setTriggerSlope(Dso::Slope slope);
     Dso::ErrorCode setPretriggerPosition(double position);
     void forceTrigger();
+    Dso::ErrorCode setStreaming(bool enable);
+    void setCompactSamples(bool enable);
+    void setLosslessCapture(bool enable);
+    void setAcquisitionMode(Dso::AcquisitionMode mode, unsigned count);
+    Dso::ErrorCode setSegmentedAcquisition(unsigned count);
+    void showSegment(unsigned index);
+    void setHistoryMemory(unsigned megabytes);
+    void showHistory(unsigned index);
 
   signals:
     void samplingStarted();                                  ///< The oscilloscope started sampling/waiting for trigger
     void samplingStopped();                                  ///< The oscilloscope stopped sampling/waiting for trigger
     void statusMessage(const QString &message, int timeout); ///< Status message about the oscilloscope
     void samplesAvailable();                                 ///< New sample data is available
+    void segmentsComplete(unsigned count);                   ///< All segments of a segmented acquisition were captured
+    void historyAvailable(unsigned count);                   ///< The sampling stopped with count frames in the history
 
     void availableRecordLengthsChanged(const std::vector<unsigned> &recordLengths); ///< The available record
                                                                                     /// lengths, empty list for
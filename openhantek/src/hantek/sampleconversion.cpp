@@ -0,0 +1,467 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <cstring>
+
+#include "sampleconversion.h"
+
+#include "definitions.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HANTEK_CONVERSION_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(HANTEK_CONVERSION_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HANTEK_CONVERSION_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define HANTEK_CONVERSION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Hantek {
+
+namespace {
+
+// The kernels convert one contiguous span without wrap around. The vector loops
+// only run while there is at least one more sample behind the block, because the
+// block loads read up to one byte past their last sample.
+
+// The scalar kernels are instantiated for the strides of the data layouts, so the
+// compiler can unroll and vectorize the loops. Stride 0 is the runtime stride.
+
+/// \brief Calls the instance of a kernel for the stride.
+#define HANTEK_DISPATCH_STRIDE(stride, kernel, ...)                                                                    \
+    switch (stride) {                                                                                                  \
+    case 1:                                                                                                            \
+        kernel<1>(1, __VA_ARGS__);                                                                                     \
+        break;                                                                                                         \
+    case 2:                                                                                                            \
+        kernel<2>(2, __VA_ARGS__);                                                                                     \
+        break;                                                                                                         \
+    default:                                                                                                           \
+        kernel<0>(stride, __VA_ARGS__);                                                                                \
+    }
+
+template <unsigned Stride>
+inline void convert8Span(unsigned stride, const unsigned char *raw, unsigned count, double *output, double scale,
+                         double shift) {
+    if (Stride) stride = Stride;
+    for (unsigned index = 0; index < count; ++index) output[index] = raw[index * stride] * scale + shift;
+}
+
+template <unsigned Stride>
+inline void convert10Span(unsigned stride, const unsigned char *low, const unsigned char *high, unsigned highShift,
+                          unsigned short highMask, unsigned count, double *output, double scale, double shift) {
+    if (Stride) stride = Stride;
+    for (unsigned index = 0; index < count; ++index)
+        output[index] =
+            (low[index * stride] + (((unsigned short)high[index * stride] << highShift) & highMask)) * scale + shift;
+}
+
+template <unsigned Stride>
+inline void extract8Span(unsigned stride, const unsigned char *raw, unsigned count, uint8_t *output) {
+    if (Stride) stride = Stride;
+    for (unsigned index = 0; index < count; ++index) output[index] = raw[index * stride];
+}
+
+template <unsigned Stride>
+inline void extract10Span(unsigned stride, const unsigned char *low, const unsigned char *high, unsigned highShift,
+                          unsigned short highMask, unsigned count, uint16_t *output) {
+    if (Stride) stride = Stride;
+    for (unsigned index = 0; index < count; ++index)
+        output[index] =
+            (uint16_t)(low[index * stride] + (((unsigned short)high[index * stride] << highShift) & highMask));
+}
+
+template <unsigned Stride>
+inline void lookup8Span(unsigned stride, const unsigned char *raw, unsigned count, double *output,
+                        const double *table) {
+    if (Stride) stride = Stride;
+    for (unsigned index = 0; index < count; ++index) output[index] = table[raw[index * stride]];
+}
+
+template <unsigned Stride>
+inline void lookup10Span(unsigned stride, const unsigned char *low, const unsigned char *high, unsigned highShift,
+                         unsigned short highMask, unsigned count, double *output, const double *table) {
+    if (Stride) stride = Stride;
+    for (unsigned index = 0; index < count; ++index)
+        output[index] = table[low[index * stride] + (((unsigned short)high[index * stride] << highShift) & highMask)];
+}
+
+void convert8Scalar(const unsigned char *raw, unsigned stride, unsigned count, double *output, double scale,
+                    double shift) {
+    HANTEK_DISPATCH_STRIDE(stride, convert8Span, raw, count, output, scale, shift)
+}
+
+void convert10Scalar(const unsigned char *low, const unsigned char *high, unsigned stride, unsigned highShift,
+                     unsigned short highMask, unsigned count, double *output, double scale, double shift) {
+    HANTEK_DISPATCH_STRIDE(stride, convert10Span, low, high, highShift, highMask, count, output, scale, shift)
+}
+
+/// \brief Combines the samples of a contiguous span of the fast rate layout.
+/// Every group of Channels samples shares the byte with its extra bits, that is
+/// stored at the position of the first sample of the group. The shifts of the
+/// slots in a group are loop invariant, so the full groups are unrolled.
+/// \param position The position of the first sample in the ring buffer.
+/// \param store Called with the output index and the combined value of every sample.
+template <unsigned Channels, class Store>
+inline void combineFastRateSpan(const unsigned char *low, const unsigned char *high, unsigned position, unsigned count,
+                                unsigned extraBits, unsigned short highMask, const Store &store) {
+    unsigned shifts[Channels];
+    for (unsigned slot = 0; slot < Channels; ++slot) shifts[slot] = 8 - (Channels - 1 - slot) * extraBits;
+    auto single = [&](unsigned index) {
+        const unsigned sample = position + index;
+        const unsigned slot = sample % Channels;
+        store(index, low[sample] + (((unsigned short)high[sample - slot] << shifts[slot]) & highMask));
+    };
+
+    // The span may start and end within a group
+    unsigned index = 0;
+    for (; index < count && (position + index) % Channels; ++index) single(index);
+    for (; index + Channels <= count; index += Channels) {
+        const unsigned short extra = high[position + index];
+        for (unsigned slot = 0; slot < Channels; ++slot)
+            store(index + slot, low[position + index + slot] + ((extra << shifts[slot]) & highMask));
+    }
+    for (; index < count; ++index) single(index);
+}
+
+#ifdef HANTEK_CONVERSION_SSE2
+/// \brief Converts eight 16 bit values to doubles and stores them scaled.
+inline void store8Sse2(__m128i values, double *output, __m128d scale, __m128d shift) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lower = _mm_unpacklo_epi16(values, zero);
+    const __m128i upper = _mm_unpackhi_epi16(values, zero);
+    _mm_storeu_pd(output, _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(lower), scale), shift));
+    _mm_storeu_pd(output + 2, _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(lower, 0xee)), scale), shift));
+    _mm_storeu_pd(output + 4, _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(upper), scale), shift));
+    _mm_storeu_pd(output + 6, _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(upper, 0xee)), scale), shift));
+}
+
+void convert8Sse2(const unsigned char *raw, unsigned stride, unsigned count, double *output, double scale,
+                  double shift) {
+    const __m128d scaleVector = _mm_set1_pd(scale);
+    const __m128d shiftVector = _mm_set1_pd(shift);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowByteMask = _mm_set1_epi16(0x00ff);
+    unsigned index = 0;
+
+    if (stride == 1) {
+        for (; index + 16 <= count; index += 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(raw + index));
+            store8Sse2(_mm_unpacklo_epi8(bytes, zero), output + index, scaleVector, shiftVector);
+            store8Sse2(_mm_unpackhi_epi8(bytes, zero), output + index + 8, scaleVector, shiftVector);
+        }
+    } else if (stride == 2) {
+        for (; index + 8 < count; index += 8) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(raw + index * 2));
+            store8Sse2(_mm_and_si128(bytes, lowByteMask), output + index, scaleVector, shiftVector);
+        }
+    }
+
+    convert8Scalar(raw + index * stride, stride, count - index, output + index, scale, shift);
+}
+
+void convert10Sse2(const unsigned char *low, const unsigned char *high, unsigned stride, unsigned highShift,
+                   unsigned short highMask, unsigned count, double *output, double scale, double shift) {
+    unsigned index = 0;
+
+    if (stride == 2) {
+        const __m128d scaleVector = _mm_set1_pd(scale);
+        const __m128d shiftVector = _mm_set1_pd(shift);
+        const __m128i lowByteMask = _mm_set1_epi16(0x00ff);
+        const __m128i highMaskVector = _mm_set1_epi16((short)highMask);
+        const __m128i highShiftCount = _mm_cvtsi32_si128((int)highShift);
+
+        for (; index + 8 < count; index += 8) {
+            const __m128i lowBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(low + index * 2));
+            const __m128i highBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(high + index * 2));
+            const __m128i extraBits =
+                _mm_and_si128(_mm_sll_epi16(_mm_and_si128(highBytes, lowByteMask), highShiftCount), highMaskVector);
+            store8Sse2(_mm_add_epi16(_mm_and_si128(lowBytes, lowByteMask), extraBits), output + index, scaleVector,
+                       shiftVector);
+        }
+    }
+
+    convert10Scalar(low + index * stride, high + index * stride, stride, highShift, highMask, count - index,
+                    output + index, scale, shift);
+}
+#endif
+
+#ifdef HANTEK_CONVERSION_AVX2
+/// \brief Converts eight 32 bit values to doubles and stores them scaled.
+__attribute__((target("avx2"))) inline void store8Avx2(__m256i values, double *output, __m256d scale,
+                                                        __m256d shift) {
+    const __m256d lower = _mm256_cvtepi32_pd(_mm256_castsi256_si128(values));
+    const __m256d upper = _mm256_cvtepi32_pd(_mm256_extracti128_si256(values, 1));
+    _mm256_storeu_pd(output, _mm256_add_pd(_mm256_mul_pd(lower, scale), shift));
+    _mm256_storeu_pd(output + 4, _mm256_add_pd(_mm256_mul_pd(upper, scale), shift));
+}
+
+__attribute__((target("avx2"))) void convert8Avx2(const unsigned char *raw, unsigned stride, unsigned count,
+                                                   double *output, double scale, double shift) {
+    const __m256d scaleVector = _mm256_set1_pd(scale);
+    const __m256d shiftVector = _mm256_set1_pd(shift);
+    const __m128i lowByteMask = _mm_set1_epi16(0x00ff);
+    unsigned index = 0;
+
+    if (stride == 1) {
+        for (; index + 8 <= count; index += 8) {
+            const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(raw + index));
+            store8Avx2(_mm256_cvtepu8_epi32(bytes), output + index, scaleVector, shiftVector);
+        }
+    } else if (stride == 2) {
+        for (; index + 8 < count; index += 8) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(raw + index * 2));
+            store8Avx2(_mm256_cvtepu16_epi32(_mm_and_si128(bytes, lowByteMask)), output + index, scaleVector,
+                       shiftVector);
+        }
+    }
+
+    convert8Scalar(raw + index * stride, stride, count - index, output + index, scale, shift);
+}
+
+__attribute__((target("avx2"))) void convert10Avx2(const unsigned char *low, const unsigned char *high,
+                                                    unsigned stride, unsigned highShift, unsigned short highMask,
+                                                    unsigned count, double *output, double scale, double shift) {
+    unsigned index = 0;
+
+    if (stride == 2) {
+        const __m256d scaleVector = _mm256_set1_pd(scale);
+        const __m256d shiftVector = _mm256_set1_pd(shift);
+        const __m128i lowByteMask = _mm_set1_epi16(0x00ff);
+        const __m128i highMaskVector = _mm_set1_epi16((short)highMask);
+        const __m128i highShiftCount = _mm_cvtsi32_si128((int)highShift);
+
+        for (; index + 8 < count; index += 8) {
+            const __m128i lowBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(low + index * 2));
+            const __m128i highBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(high + index * 2));
+            const __m128i extraBits =
+                _mm_and_si128(_mm_sll_epi16(_mm_and_si128(highBytes, lowByteMask), highShiftCount), highMaskVector);
+            const __m128i values = _mm_add_epi16(_mm_and_si128(lowBytes, lowByteMask), extraBits);
+            store8Avx2(_mm256_cvtepu16_epi32(values), output + index, scaleVector, shiftVector);
+        }
+    }
+
+    convert10Scalar(low + index * stride, high + index * stride, stride, highShift, highMask, count - index,
+                    output + index, scale, shift);
+}
+#endif
+
+#ifdef HANTEK_CONVERSION_NEON
+/// \brief Converts eight 16 bit values to doubles and stores them scaled.
+inline void store8Neon(uint16x8_t values, double *output, float64x2_t scale, float64x2_t shift) {
+    const uint32x4_t lower = vmovl_u16(vget_low_u16(values));
+    const uint32x4_t upper = vmovl_u16(vget_high_u16(values));
+    const uint64x2_t parts[4] = {vmovl_u32(vget_low_u32(lower)), vmovl_u32(vget_high_u32(lower)),
+                                 vmovl_u32(vget_low_u32(upper)), vmovl_u32(vget_high_u32(upper))};
+    for (int part = 0; part < 4; ++part)
+        vst1q_f64(output + part * 2, vaddq_f64(vmulq_f64(vcvtq_f64_u64(parts[part]), scale), shift));
+}
+
+void convert8Neon(const unsigned char *raw, unsigned stride, unsigned count, double *output, double scale,
+                  double shift) {
+    const float64x2_t scaleVector = vdupq_n_f64(scale);
+    const float64x2_t shiftVector = vdupq_n_f64(shift);
+    unsigned index = 0;
+
+    if (stride == 1) {
+        for (; index + 8 <= count; index += 8)
+            store8Neon(vmovl_u8(vld1_u8(raw + index)), output + index, scaleVector, shiftVector);
+    } else if (stride == 2) {
+        for (; index + 8 < count; index += 8)
+            store8Neon(vmovl_u8(vld2_u8(raw + index * 2).val[0]), output + index, scaleVector, shiftVector);
+    }
+
+    convert8Scalar(raw + index * stride, stride, count - index, output + index, scale, shift);
+}
+
+void convert10Neon(const unsigned char *low, const unsigned char *high, unsigned stride, unsigned highShift,
+                   unsigned short highMask, unsigned count, double *output, double scale, double shift) {
+    unsigned index = 0;
+
+    if (stride == 2) {
+        const float64x2_t scaleVector = vdupq_n_f64(scale);
+        const float64x2_t shiftVector = vdupq_n_f64(shift);
+        const uint16x8_t highMaskVector = vdupq_n_u16(highMask);
+        const int16x8_t highShiftVector = vdupq_n_s16((short)highShift);
+
+        for (; index + 8 < count; index += 8) {
+            const uint16x8_t lowValues = vmovl_u8(vld2_u8(low + index * 2).val[0]);
+            const uint16x8_t highValues = vmovl_u8(vld2_u8(high + index * 2).val[0]);
+            const uint16x8_t extraBits = vandq_u16(vshlq_u16(highValues, highShiftVector), highMaskVector);
+            store8Neon(vaddq_u16(lowValues, extraBits), output + index, scaleVector, shiftVector);
+        }
+    }
+
+    convert10Scalar(low + index * stride, high + index * stride, stride, highShift, highMask, count - index,
+                    output + index, scale, shift);
+}
+#endif
+
+typedef void (*Convert8Kernel)(const unsigned char *, unsigned, unsigned, double *, double, double);
+typedef void (*Convert10Kernel)(const unsigned char *, const unsigned char *, unsigned, unsigned, unsigned short,
+                                unsigned, double *, double, double);
+
+/// \brief Selects the fastest 8 bit kernel the cpu supports.
+Convert8Kernel selectConvert8() {
+#ifdef HANTEK_CONVERSION_AVX2
+    if (__builtin_cpu_supports("avx2")) return convert8Avx2;
+#endif
+#if defined(HANTEK_CONVERSION_SSE2)
+    return convert8Sse2;
+#elif defined(HANTEK_CONVERSION_NEON)
+    return convert8Neon;
+#else
+    return convert8Scalar;
+#endif
+}
+
+/// \brief Selects the fastest 10 bit kernel the cpu supports.
+Convert10Kernel selectConvert10() {
+#ifdef HANTEK_CONVERSION_AVX2
+    if (__builtin_cpu_supports("avx2")) return convert10Avx2;
+#endif
+#if defined(HANTEK_CONVERSION_SSE2)
+    return convert10Sse2;
+#elif defined(HANTEK_CONVERSION_NEON)
+    return convert10Neon;
+#else
+    return convert10Scalar;
+#endif
+}
+
+#if defined(HANTEK_CONVERSION_SSE2) || defined(HANTEK_CONVERSION_NEON)
+/// The vector kernels convert several samples per instruction, that is faster than a lookup per sample
+const bool VECTOR_KERNELS = true;
+#else
+const bool VECTOR_KERNELS = false;
+#endif
+
+/// \brief Splits a strided read from a ring buffer into contiguous spans.
+/// \param span Called with the buffer position, the output index and the
+/// sample count of every span.
+template <class Span>
+void forEachSpan(unsigned rawLength, unsigned start, unsigned stride, unsigned count, const Span &span) {
+    if (!rawLength || !stride) return;
+
+    start %= rawLength;
+    for (unsigned done = 0; done < count;) {
+        unsigned spanCount = (rawLength - start + stride - 1) / stride;
+        if (spanCount > count - done) spanCount = count - done;
+
+        span(start, done, spanCount);
+
+        done += spanCount;
+        start = (start + spanCount * stride) % rawLength;
+    }
+}
+}
+
+void convertSamples8(const unsigned char *raw, unsigned rawLength, unsigned start, unsigned stride, double *output,
+                     unsigned count, double scale, double shift) {
+    static const Convert8Kernel kernel = selectConvert8();
+
+    forEachSpan(rawLength, start, stride, count, [&](unsigned position, unsigned index, unsigned spanCount) {
+        kernel(raw + position, stride, spanCount, output + index, scale, shift);
+    });
+}
+
+void VoltageTable::update(unsigned codes, double scale, double shift) {
+    if (codes == values.size() && scale == tableScale && shift == tableShift) return;
+
+    values.resize(codes);
+    for (unsigned code = 0; code < codes; ++code) values[code] = code * scale + shift;
+    tableScale = scale;
+    tableShift = shift;
+}
+
+void convertSamples8(const unsigned char *raw, unsigned rawLength, unsigned start, unsigned stride, double *output,
+                     unsigned count, const VoltageTable &table) {
+    static const Convert8Kernel kernel = selectConvert8();
+
+    forEachSpan(rawLength, start, stride, count, [&](unsigned position, unsigned index, unsigned spanCount) {
+        if (VECTOR_KERNELS && stride <= 2)
+            kernel(raw + position, stride, spanCount, output + index, table.scale(), table.shift());
+        else
+            HANTEK_DISPATCH_STRIDE(stride, lookup8Span, raw + position, spanCount, output + index, table.data())
+    });
+}
+
+void convertSamples10(const unsigned char *low, const unsigned char *high, unsigned rawLength, unsigned start,
+                      unsigned stride, unsigned lowOffset, unsigned highShift, unsigned short highMask, double *output,
+                      unsigned count, double scale, double shift) {
+    static const Convert10Kernel kernel = selectConvert10();
+
+    forEachSpan(rawLength, start, stride, count, [&](unsigned position, unsigned index, unsigned spanCount) {
+        kernel(low + position + lowOffset, high + position, stride, highShift, highMask, spanCount, output + index,
+               scale, shift);
+    });
+}
+
+void convertSamples10(const unsigned char *low, const unsigned char *high, unsigned rawLength, unsigned start,
+                      unsigned stride, unsigned lowOffset, unsigned highShift, unsigned short highMask, double *output,
+                      unsigned count, const VoltageTable &table) {
+    static const Convert10Kernel kernel = selectConvert10();
+
+    forEachSpan(rawLength, start, stride, count, [&](unsigned position, unsigned index, unsigned spanCount) {
+        if (VECTOR_KERNELS && stride == 2)
+            kernel(low + position + lowOffset, high + position, stride, highShift, highMask, spanCount,
+                   output + index, table.scale(), table.shift());
+        else
+            HANTEK_DISPATCH_STRIDE(stride, lookup10Span, low + position + lowOffset, high + position, highShift,
+                                   highMask, spanCount, output + index, table.data())
+    });
+}
+
+void extractSamples8(const unsigned char *raw, unsigned rawLength, unsigned start, unsigned stride, uint8_t *output,
+                     unsigned count) {
+    forEachSpan(rawLength, start, stride, count, [&](unsigned position, unsigned index, unsigned spanCount) {
+        if (stride == 1) {
+            memcpy(output + index, raw + position, spanCount);
+            return;
+        }
+        HANTEK_DISPATCH_STRIDE(stride, extract8Span, raw + position, spanCount, output + index)
+    });
+}
+
+void extractSamples10(const unsigned char *low, const unsigned char *high, unsigned rawLength, unsigned start,
+                      unsigned stride, unsigned lowOffset, unsigned highShift, unsigned short highMask,
+                      uint16_t *output, unsigned count) {
+    forEachSpan(rawLength, start, stride, count, [&](unsigned position, unsigned index, unsigned spanCount) {
+        HANTEK_DISPATCH_STRIDE(stride, extract10Span, low + position + lowOffset, high + position, highShift, highMask,
+                               spanCount, output + index)
+    });
+}
+
+template <unsigned Channels>
+void convertSamples10FastRate(const unsigned char *low, const unsigned char *high, unsigned rawLength, unsigned start,
+                              unsigned extraBits, unsigned short highMask, double *output, unsigned count,
+                              const VoltageTable &table) {
+    const double *voltages = table.data();
+    forEachSpan(rawLength, start, 1, count, [&](unsigned position, unsigned index, unsigned spanCount) {
+        double *target = output + index;
+        combineFastRateSpan<Channels>(low, high, position, spanCount, extraBits, highMask,
+                                      [&](unsigned sample, unsigned value) { target[sample] = voltages[value]; });
+    });
+}
+
+template <unsigned Channels>
+void extractSamples10FastRate(const unsigned char *low, const unsigned char *high, unsigned rawLength, unsigned start,
+                              unsigned extraBits, unsigned short highMask, uint16_t *output, unsigned count) {
+    forEachSpan(rawLength, start, 1, count, [&](unsigned position, unsigned index, unsigned spanCount) {
+        uint16_t *target = output + index;
+        combineFastRateSpan<Channels>(low, high, position, spanCount, extraBits, highMask,
+                                      [&](unsigned sample, unsigned value) { target[sample] = (uint16_t)value; });
+    });
+}
+
+template void convertSamples10FastRate<HANTEK_CHANNELS>(const unsigned char *, const unsigned char *, unsigned,
+                                                        unsigned, unsigned, unsigned short, double *, unsigned,
+                                                        const VoltageTable &);
+template void extractSamples10FastRate<HANTEK_CHANNELS>(const unsigned char *, const unsigned char *, unsigned,
+                                                        unsigned, unsigned, unsigned short, uint16_t *, unsigned);
+}
@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Hantek {
+
+/// \brief The voltages of all sample codes of a channel.
+/// The devices have at most 1024 different codes, so a sample can be converted
+/// with a single lookup. The table is only rebuilt when the parameters of the
+/// conversion change, that is when the gain, the offset or the model change.
+class VoltageTable {
+  public:
+    /// \brief Fills the table, nothing is done if the parameters didn't change.
+    /// \param codes The number of codes, 256 for 8 bit samples.
+    /// \param scale The factor applied to the code.
+    /// \param shift The value added after scaling.
+    void update(unsigned codes, double scale, double shift);
+
+    /// \return The voltages of the codes.
+    const double *data() const { return values.data(); }
+    /// \return The number of codes in the table.
+    unsigned size() const { return (unsigned)values.size(); }
+    double scale() const { return tableScale; }
+    double shift() const { return tableShift; }
+
+  private:
+    std::vector<double> values;
+    double tableScale = 0.0;
+    double tableShift = 0.0;
+};
+
+/// \brief Converts 8 bit samples from a ring buffer into voltages.
+/// The samples are read at start, start + stride, ... wrapping around at
+/// rawLength, and written as raw * scale + shift. The wrap around is resolved
+/// into at most a few contiguous spans, that are converted by the fastest kernel
+/// supported by the cpu (AVX2, SSE2, NEON or plain C++).
+/// \param raw The raw sample buffer.
+/// \param rawLength The length of the ring buffer in bytes.
+/// \param start The position of the first sample.
+/// \param stride The distance between two samples in bytes.
+/// \param output The buffer for the converted samples.
+/// \param count The number of samples that should be converted.
+/// \param scale The factor applied to the raw value.
+/// \param shift The value added after scaling.
+void convertSamples8(const unsigned char *raw, unsigned rawLength, unsigned start, unsigned stride, double *output,
+                     unsigned count, double scale, double shift);
+
+/// \brief Converts 8 bit samples from a ring buffer with the voltages of a table.
+/// Strides without a vector kernel are converted with lookups, the vector
+/// kernels calculate the voltages with the parameters of the table.
+/// \param table The voltages of the codes, it has to hold 256 codes.
+void convertSamples8(const unsigned char *raw, unsigned rawLength, unsigned start, unsigned stride, double *output,
+                     unsigned count, const VoltageTable &table);
+
+/// \brief Converts 10 bit samples with separately stored extra bits into voltages.
+/// Sample n is low[pos + lowOffset] + ((high[pos] << highShift) & highMask) with
+/// pos = (start + n * stride) wrapping around at rawLength.
+/// \param low The buffer with the lower 8 bits of the samples.
+/// \param high The buffer with the extra bits of the samples.
+/// \param rawLength The length of the ring buffers in bytes.
+/// \param start The position of the first sample.
+/// \param stride The distance between two samples in bytes.
+/// \param lowOffset The offset of the lower bits relative to the position.
+/// \param highShift The left shift of the extra bits.
+/// \param highMask The mask for the shifted extra bits.
+/// \param output The buffer for the converted samples.
+/// \param count The number of samples that should be converted.
+/// \param scale The factor applied to the raw value.
+/// \param shift The value added after scaling.
+void convertSamples10(const unsigned char *low, const unsigned char *high, unsigned rawLength, unsigned start,
+                      unsigned stride, unsigned lowOffset, unsigned highShift, unsigned short highMask, double *output,
+                      unsigned count, double scale, double shift);
+
+/// \brief Converts 10 bit samples with the voltages of a table, like convertSamples8() with a table.
+/// \param table The voltages of the codes, it has to hold all combined codes.
+void convertSamples10(const unsigned char *low, const unsigned char *high, unsigned rawLength, unsigned start,
+                      unsigned stride, unsigned lowOffset, unsigned highShift, unsigned short highMask, double *output,
+                      unsigned count, const VoltageTable &table);
+
+/// \brief Converts the 10 bit samples of the fast rate mode into voltages.
+/// All samples are consecutive, every group of Channels samples shares the byte
+/// with the extra bits, that is stored at the position of the first sample of the
+/// group in the high buffer. Sample slot s of a group has its extra bits shifted
+/// left by 8 - (Channels - 1 - s) * extraBits. The converter is instantiated for
+/// HANTEK_CHANNELS.
+/// \param low The buffer with the lower 8 bits of the samples.
+/// \param high The buffer with the extra bits of the samples.
+/// \param rawLength The length of the ring buffers in bytes, a multiple of Channels.
+/// \param start The position of the first sample.
+/// \param extraBits The number of extra bits of every sample.
+/// \param highMask The mask for the shifted extra bits.
+/// \param output The buffer for the converted samples.
+/// \param count The number of samples that should be converted.
+/// \param table The voltages of the codes, it has to hold all combined codes.
+template <unsigned Channels>
+void convertSamples10FastRate(const unsigned char *low, const unsigned char *high, unsigned rawLength, unsigned start,
+                              unsigned extraBits, unsigned short highMask, double *output, unsigned count,
+                              const VoltageTable &table);
+
+/// \brief Copies 8 bit samples out of a ring buffer without converting them.
+/// Reads the samples like convertSamples8().
+/// \param raw The raw sample buffer.
+/// \param rawLength The length of the ring buffer in bytes.
+/// \param start The position of the first sample.
+/// \param stride The distance between two samples in bytes.
+/// \param output The buffer for the sample codes.
+/// \param count The number of samples that should be copied.
+void extractSamples8(const unsigned char *raw, unsigned rawLength, unsigned start, unsigned stride, uint8_t *output,
+                     unsigned count);
+
+/// \brief Combines 10 bit samples with separately stored extra bits without converting them.
+/// Reads the samples like convertSamples10().
+void extractSamples10(const unsigned char *low, const unsigned char *high, unsigned rawLength, unsigned start,
+                      unsigned stride, unsigned lowOffset, unsigned highShift, unsigned short highMask,
+                      uint16_t *output, unsigned count);
+
+/// \brief Combines the 10 bit samples of the fast rate mode without converting them.
+/// Reads the samples like convertSamples10FastRate().
+template <unsigned Channels>
+void extractSamples10FastRate(const unsigned char *low, const unsigned char *high, unsigned rawLength, unsigned start,
+                              unsigned extraBits, unsigned short highMask, uint16_t *output, unsigned count);
+}
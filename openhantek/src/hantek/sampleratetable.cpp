@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include "sampleratetable.h"
+
+using namespace Hantek;
+
+void SamplerateTable::build(const ControlSpecification &specification) {
+    const ControlSamplerateLimits *limits[2] = {&specification.samplerate.single, &specification.samplerate.multi};
+    for (unsigned fastRate = 0; fastRate < 2; ++fastRate) {
+        Mode &mode = modes[fastRate];
+        mode.base = limits[fastRate]->base;
+        mode.max = limits[fastRate]->max;
+        mode.downsampler.clear();
+
+        bool evenOnly = false;
+        switch (specification.command.bulk.setSamplerate) {
+        case BULK_SETTRIGGERANDSAMPLERATE:
+            // DSO-2090 supports the downsampling factors 1, 2 and 5 using valueFast
+            // or all even values above using valueSlow
+            evenOnly = true;
+            break;
+        case BULK_CSETTRIGGERORSAMPLERATE:
+        case BULK_ESETTRIGGERORSAMPLERATE:
+            // DSO-5200 and DSO-2250 support all downsampling factors
+            break;
+        default:
+            continue;
+        }
+
+        // Limit maximum downsampler value to avoid overflows in the sent commands
+        const unsigned last = std::min(limits[fastRate]->maxDownsampler, 2u * 0x10001);
+        mode.downsampler.reserve(evenOnly ? last / 2 + 2 : last + 1);
+        for (unsigned downsampler = 1; downsampler <= last; ++downsampler) {
+            if (evenOnly && (downsampler == 3 || downsampler == 4 || (downsampler > 5 && downsampler % 2))) continue;
+            mode.downsampler.push_back(downsampler);
+        }
+
+        // Without downsampling the maximum is used, a base as high as the maximum isn't a separate samplerate
+        if (!mode.downsampler.empty() && mode.base >= mode.max) mode.downsampler.erase(mode.downsampler.begin());
+        mode.downsampler.insert(mode.downsampler.begin(), 0);
+    }
+}
+
+double SamplerateTable::find(double samplerate, bool fastRate, bool maximum, unsigned divider,
+                             unsigned *downsampler) const {
+    const Mode &mode = modes[fastRate ? 1 : 0];
+    if (mode.downsampler.empty() || !divider) return 0.0;
+
+    // The samplerates fall with the index, the search finds the first one below (or at) the target
+    std::vector<unsigned>::const_iterator best;
+    if (maximum) {
+        // The highest samplerate that isn't higher than the target, or the lowest one
+        best = std::partition_point(mode.downsampler.begin(), mode.downsampler.end(), [&](unsigned value) {
+            return mode.samplerate(value) / divider > samplerate;
+        });
+        if (best == mode.downsampler.end()) --best;
+    } else {
+        // The lowest samplerate that isn't lower than the target, or the highest one
+        best = std::partition_point(mode.downsampler.begin(), mode.downsampler.end(), [&](unsigned value) {
+            return mode.samplerate(value) / divider >= samplerate;
+        });
+        if (best != mode.downsampler.begin()) --best;
+    }
+
+    if (downsampler) *downsampler = *best;
+    return mode.samplerate(*best) / divider;
+}
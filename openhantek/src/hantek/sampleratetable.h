@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <vector>
+
+#include "controlspecification.h"
+
+namespace Hantek {
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class SamplerateTable                                     sampleratetable.h
+/// \brief Holds every samplerate a model can be set to.
+/// The table is built once per model from the samplerate limits and the
+/// downsampling factors the samplerate command can encode. It holds the
+/// downsamplers of both channel modes, sorted by falling samplerate, with 0 as
+/// the maximum samplerate. The divider of the record length scales all
+/// samplerates equally, so a query for any record length is a binary search.
+class SamplerateTable {
+  public:
+    /// \brief Collects the downsamplers that the samplerate command of the model supports.
+    /// \param specification The specification of the model, the table is empty for unknown commands.
+    void build(const ControlSpecification &specification);
+
+    /// \brief Finds the nearest samplerate supported by the oscilloscope.
+    /// \param samplerate The target samplerate, that should be met as good as possible.
+    /// \param fastRate true, if the fast rate mode is enabled.
+    /// \param maximum The target samplerate is the maximum allowed when true, the minimum otherwise.
+    /// \param divider The samplerate divider of the record length.
+    /// \param downsampler Pointer to where the selected downsampling factor should be written.
+    /// \return The nearest samplerate supported, 0.0 if the table is empty.
+    double find(double samplerate, bool fastRate, bool maximum, unsigned divider, unsigned *downsampler) const;
+
+  private:
+    /// \brief The samplerates of a channel mode.
+    struct Mode {
+        double base = 0.0;                 ///< The base for sample rate calculations
+        double max = 0.0;                  ///< The samplerate of downsampler 0
+        std::vector<unsigned> downsampler; ///< The supported downsamplers in ascending order
+
+        /// \return The samplerate of a downsampler without the divider of the record length.
+        double samplerate(unsigned downsampler) const { return downsampler ? base / downsampler : max; }
+    };
+
+    Mode modes[2]; ///< The single channel and the fast rate mode
+};
+}
@@ -746,3 +746,128 @@ exit:
     fclose(image);
     return ret;
 }
+
+/*****************************************************************************/
+
+/*
+ * For collecting the segments of an image with parse_ihex().
+ */
+static int segment_poke(void *context, uint32_t addr, bool external, const unsigned char *data, size_t len) {
+    std::vector<ezusb_segment> *segments = (std::vector<ezusb_segment> *)context;
+    (void)external;
+
+    segments->push_back(ezusb_segment());
+    segments->back().addr = addr;
+    segments->back().data.assign(data, data + len);
+    return 0;
+}
+
+int ezusb_parse_ihex(const char *path, std::vector<ezusb_segment> &segments) {
+    FILE *image;
+    int status;
+
+    image = fopen(path, "rb");
+    if (image == NULL) {
+        logerror("%s: unable to open for input.\n", path);
+        return -2;
+    }
+
+    segments.clear();
+    status = parse_ihex(image, &segments, NULL, segment_poke);
+    if (status < 0) {
+        logerror("unable to parse %s\n", path);
+        segments.clear();
+    }
+    fclose(image);
+    return status;
+}
+
+/*
+ * Writes the segments of a parsed image, the mode of ctx decides which.
+ */
+static int poke_segments(struct ram_poke_context *ctx, const std::vector<ezusb_segment> &segments,
+                         bool (*is_external)(uint32_t off, size_t len)) {
+    int status;
+
+    for (const ezusb_segment &segment : segments) {
+        status = ram_poke(ctx, segment.addr, is_external(segment.addr, segment.data.size()), segment.data.data(),
+                          segment.data.size());
+        if (status < 0) return -1;
+    }
+    return 0;
+}
+
+int ezusb_load_ram_segments(libusb_device_handle *device, const std::vector<ezusb_segment> &segments, int fx_type,
+                            int stage) {
+    uint32_t cpucs_addr;
+    bool (*is_external)(uint32_t off, size_t len);
+    struct ram_poke_context ctx;
+
+    if (fx_type == FX_TYPE_FX3) {
+        logerror("parsed images can't be loaded to the FX3\n");
+        return -1;
+    }
+
+    /* EZ-USB original/FX and FX2 devices differ, apart from the 8051 core */
+    switch (fx_type) {
+    case FX_TYPE_FX2LP:
+        cpucs_addr = 0xe600;
+        is_external = fx2lp_is_external;
+        break;
+    case FX_TYPE_FX2:
+        cpucs_addr = 0xe600;
+        is_external = fx2_is_external;
+        break;
+    default:
+        cpucs_addr = 0x7f92;
+        is_external = fx_is_external;
+        break;
+    }
+
+    /* use only first stage loader? */
+    if (stage == 0) {
+        ctx.mode = internal_only;
+
+        /* if required, halt the CPU while we overwrite its code/data */
+        if (cpucs_addr && !ezusb_cpucs(device, cpucs_addr, false)) return -1;
+
+        /* 2nd stage, first part? loader was already uploaded */
+    } else {
+        ctx.mode = skip_internal;
+
+        /* let CPU run; overwrite the 2nd stage loader later */
+        if (verbose) logerror("2nd stage: write external memory\n");
+    }
+
+    /* write the segments, first (maybe only) time */
+    ctx.device = device;
+    ctx.total = ctx.count = 0;
+    if (poke_segments(&ctx, segments, is_external) < 0) {
+        logerror("unable to upload the image\n");
+        return -1;
+    }
+
+    /* second part of 2nd stage: write the segments again */
+    if (stage) {
+        ctx.mode = skip_external;
+
+        /* if needed, halt the CPU while we overwrite the 1st stage loader */
+        if (cpucs_addr && !ezusb_cpucs(device, cpucs_addr, false)) return -1;
+
+        /* at least write the interrupt vectors (at 0x0000) for reset! */
+        if (verbose) logerror("2nd stage: write on-chip memory\n");
+        if (poke_segments(&ctx, segments, is_external) < 0) {
+            logerror("unable to completely upload the image\n");
+            return -1;
+        }
+    }
+
+    if (verbose && (ctx.count != 0)) {
+        logerror("... WROTE: %d bytes, %d segments, avg %d\n", (int)ctx.total, (int)ctx.count,
+                 (int)(ctx.total / ctx.count));
+    }
+
+    /* if required, reset the CPU so it runs what we just uploaded */
+    if (cpucs_addr && !ezusb_cpucs(device, cpucs_addr, true)) return -1;
+    return 0;
+}
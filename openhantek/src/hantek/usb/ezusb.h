@@ -21,6 +21,7 @@
  */
 
 #include <inttypes.h>
+#include <vector>
 
 struct libusb_device_handle;
 
@@ -92,6 +93,28 @@ extern int ezusb_load_ram(libusb_device_handle *device, const char *path, int fx
  */
 extern int ezusb_load_eeprom(libusb_device_handle *device, const char *path, int fx_type, int img_type, int config);
 
+/*
+ * A contiguous memory segment of a parsed firmware image.
+ */
+struct ezusb_segment {
+    uint32_t addr;                   /* The target address */
+    std::vector<unsigned char> data; /* The bytes of the segment */
+};
+
+/*
+ * This function parses an Intel HEX image file into its memory segments,
+ * so the image can be uploaded to many devices without reading it again.
+ * Returns 0 on success, negative values on errors.
+ */
+extern int ezusb_parse_ihex(const char *path, std::vector<ezusb_segment> &segments);
+
+/*
+ * This function uploads a parsed image into RAM, like ezusb_load_ram()
+ * does with an Intel HEX file. The FX3 isn't supported.
+ */
+extern int ezusb_load_ram_segments(libusb_device_handle *device, const std::vector<ezusb_segment> &segments,
+                                   int fx_type, int stage);
+
 /* Verbosity level (default 1). Can be increased or decreased with options v/q
  */
 extern int verbose;
@@ -6,11 +6,38 @@
 #include <QDebug>
 #include <QList>
 #include <QTemporaryFile>
+#include <QThread>
+#include <chrono>
 
 #include "ezusb.h"
+#include "uploadFirmware.h"
 #include "utils/printutils.h"
 #include <libusb-1.0/libusb.h>
 
+namespace {
+/// \return true, if the descriptor belongs to a supported device with firmware.
+bool hasFirmware(const libusb_device_descriptor &descriptor) {
+    for (const DSOModel &model : supportedModels) {
+        if (descriptor.idVendor == model.vendorID && descriptor.idProduct == model.productID) return true;
+    }
+    return false;
+}
+
+/// \brief Counts the arrivals of devices with firmware.
+int LIBUSB_CALL countArrival(libusb_context *, libusb_device *device, libusb_hotplug_event, void *arrivals) {
+    struct libusb_device_descriptor descriptor;
+    if (libusb_get_device_descriptor(device, &descriptor) == LIBUSB_SUCCESS && hasFirmware(descriptor))
+        ++*static_cast<unsigned *>(arrivals);
+    return 0;
+}
+
+/// \return The steady clock time in ms.
+qint64 milliseconds() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+}
+
 FindDevices::FindDevices(libusb_context *context) : context(context) {}
 
 // Iterate through all usb devices
@@ -36,12 +63,12 @@ std::list<std::unique_ptr<USBDevice>> FindDevices::findDevices() {
         for (DSOModel &model : supportedModels) {
             // Check VID and PID for firmware flashed devices
             if (descriptor.idVendor == model.vendorID && descriptor.idProduct == model.productID) {
-                devices.push_back(std::unique_ptr<USBDevice>(new USBDevice(model, device)));
+                devices.push_back(std::unique_ptr<USBDevice>(new USBDevice(model, device, context)));
                 break;
             }
             // Devices without firmware have different VID/PIDs
             if (descriptor.idVendor == model.vendorIDnoFirmware && descriptor.idProduct == model.productIDnoFirmware) {
-                devices.push_back(std::unique_ptr<USBDevice>(new USBDevice(model, device)));
+                devices.push_back(std::unique_ptr<USBDevice>(new USBDevice(model, device, context)));
                 break;
             }
         }
@@ -58,6 +85,87 @@ std::list<std::unique_ptr<USBDevice>> FindDevices::findDevices() {
     return devices;
 }
 
+bool FindDevices::waitForDevices(unsigned count, int timeout) {
+    const qint64 deadline = milliseconds() + timeout;
+
+    if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+        while (countReadyDevices() < count) {
+            if (milliseconds() >= deadline) return false;
+            QThread::msleep(POLL_INTERVAL);
+        }
+        return true;
+    }
+
+    // The devices that are already connected are counted while the callback is registered
+    unsigned arrivals = 0;
+    libusb_hotplug_callback_handle handle;
+    int error = libusb_hotplug_register_callback(context, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED, LIBUSB_HOTPLUG_ENUMERATE,
+                                                 LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+                                                 LIBUSB_HOTPLUG_MATCH_ANY, countArrival, &arrivals, &handle);
+    if (error != LIBUSB_SUCCESS) {
+        errorMessage = QCoreApplication::translate("", "Can't wait for the devices: %1").arg(libUsbErrorString(error));
+        return false;
+    }
+    while (arrivals < count) {
+        const qint64 remaining = deadline - milliseconds();
+        if (remaining <= 0) break;
+        struct timeval tv = {(long)(remaining / 1000), (long)(remaining % 1000 * 1000)};
+        libusb_handle_events_timeout_completed(context, &tv, nullptr);
+    }
+    libusb_hotplug_deregister_callback(context, handle);
+    return arrivals >= count;
+}
+
+std::unique_ptr<USBDevice> FindDevices::connectReadyDevice(int deviceIndex, int timeout, QStringList &warnings) {
+    std::list<std::unique_ptr<USBDevice>> devices = findDevices();
+    if (devices.empty()) {
+        errorMessage = QCoreApplication::translate("", "No Hantek oscilloscope found: %1").arg(errorMessage);
+        return nullptr;
+    }
+
+    //////// Upload firmwares for all connected devices in parallel ////////
+    unsigned withFirmware = 0;
+    for (const auto &i : devices) {
+        if (!i->needsFirmware()) ++withFirmware;
+    }
+    const unsigned uploaded = UploadFirmware::uploadAll(devices, warnings);
+    devices.clear();
+
+    //////// Connect to the selected device, wait for the restart after a firmware upload ////////
+    if (uploaded && !waitForDevices(withFirmware + uploaded, timeout))
+        warnings << QCoreApplication::translate("", "Not all devices restarted after the firmware upload");
+    devices = findDevices();
+    int readyIndex = 0;
+    for (auto &i : devices) {
+        QString connectMessage;
+        if (i->needsFirmware() || !i->connectDevice(connectMessage)) continue;
+        if (readyIndex++ == deviceIndex) return std::move(i);
+    }
+
+    errorMessage = QCoreApplication::translate("", "The device %1 is not ready, the firmware upload may have failed "
+                                                   "or the connection could not be established: %2")
+                       .arg(deviceIndex)
+                       .arg(errorMessage);
+    return nullptr;
+}
+
+/// \return The number of connected devices, that have a firmware.
+unsigned FindDevices::countReadyDevices() {
+    libusb_device **deviceList;
+    ssize_t deviceCount = libusb_get_device_list(context, &deviceList);
+    if (deviceCount < 0) return 0;
+
+    unsigned count = 0;
+    for (ssize_t deviceIterator = 0; deviceIterator < deviceCount; ++deviceIterator) {
+        struct libusb_device_descriptor descriptor;
+        if (libusb_get_device_descriptor(deviceList[deviceIterator], &descriptor) == LIBUSB_SUCCESS &&
+            hasFirmware(descriptor))
+            ++count;
+    }
+    libusb_free_device_list(deviceList, true);
+    return count;
+}
+
 const QString &FindDevices::getErrorMessage() const { return errorMessage; }
 
 bool FindDevices::allDevicesNoAccessError() const { return noAccessDevices; }
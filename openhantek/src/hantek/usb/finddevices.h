@@ -3,6 +3,7 @@
 #pragma once
 
 #include <QString>
+#include <QStringList>
 #include <memory>
 
 #include "definitions.h"
@@ -19,10 +20,28 @@ class FindDevices {
   public:
     FindDevices(libusb_context *context = nullptr);
     std::list<std::unique_ptr<USBDevice>> findDevices();
+    /// \brief Waits until the given number of devices with firmware are connected.
+    /// After a firmware upload the devices restart and connect again with their
+    /// final ids. The hotplug events of libusb end the wait as soon as the last
+    /// device is back, without hotplug support the device list is polled.
+    /// \param count The number of devices with firmware, including those that already had one.
+    /// \param timeout The maximal wait in ms.
+    /// \return true, if the devices are connected, false after the timeout.
+    bool waitForDevices(unsigned count, int timeout);
+    /// \brief Uploads the firmware to all found devices and connects to one of the ready devices.
+    /// \param deviceIndex The index of the device among the ready devices.
+    /// \param timeout The maximal wait for the restart of the devices after the upload in ms.
+    /// \param warnings Is extended by the failed uploads, the other devices may still be usable.
+    /// \return The connected device, nullptr on failure, getErrorMessage() has the reason then.
+    std::unique_ptr<USBDevice> connectReadyDevice(int deviceIndex, int timeout, QStringList &warnings);
     const QString &getErrorMessage() const;
     bool allDevicesNoAccessError() const;
 
+    static const int POLL_INTERVAL = 100; ///< The time between two searches without hotplug support in ms
+
   private:
+    unsigned countReadyDevices();
+
     libusb_context *context; ///< The usb context used for this device
     QString errorMessage;
     bool noAccessDevices = false;
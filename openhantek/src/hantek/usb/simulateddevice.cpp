@@ -0,0 +1,348 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "simulateddevice.h"
+
+#include "bulkStructs.h"
+#include "models.h"
+
+using namespace Hantek;
+
+namespace {
+const char *const WAVEFORM_NAMES[SimulatedDevice::WAVEFORM_COUNT] = {"sine", "square", "noise", "burst"};
+
+const unsigned DEFAULT_PERIOD[HANTEK_CHANNELS] = {100, 250};    ///< The signal periods in samples
+const double DEFAULT_AMPLITUDE[HANTEK_CHANNELS] = {0.75, 0.5}; ///< The amplitudes as fraction of half the range
+
+/// \brief The model name without the "DSO-" prefix in upper case, like it is accepted on the command line.
+QString shortModelName(const QString &name) {
+    QString shortName = name.toUpper();
+    if (shortName.startsWith("DSO-")) shortName.remove(0, 4);
+    return shortName;
+}
+}
+
+SimulatedDevice::SimulatedDevice(const DSOModel &model, Waveform waveform) : USBDevice(model) {
+    const Model id = model.uniqueModelID;
+    sampleSize = (id == MODEL_DSO5200 || id == MODEL_DSO5200A) ? 10 : 8;
+    if (sampleSize > 8) {
+        center = 0x200;
+        halfRange = 0x1ff;
+    } else {
+        // The DSO-6022BE has no offset control, its samples are biased instead
+        center = (id == MODEL_DSO6022BE) ? 0x83 : 0x80;
+        halfRange = std::min<unsigned short>(center, 0xff - center);
+    }
+
+    for (unsigned channel = 0; channel < HANTEK_CHANNELS; ++channel)
+        setSignal(channel, waveform, DEFAULT_PERIOD[channel], DEFAULT_AMPLITUDE[channel]);
+}
+
+std::unique_ptr<SimulatedDevice> SimulatedDevice::create(const QString &description, QString &errorMessage) {
+    const QStringList parts = description.split(':');
+    const QString modelName = shortModelName(parts[0]);
+    auto model = std::find_if(supportedModels.begin(), supportedModels.end(), [&modelName](const DSOModel &candidate) {
+        return shortModelName(QString::fromStdString(candidate.name)) == modelName;
+    });
+    if (model == supportedModels.end()) {
+        errorMessage = QCoreApplication::translate("", "Unknown model %1, the models are: %2")
+                           .arg(parts[0], descriptionHelp());
+        return nullptr;
+    }
+
+    Waveform waveform = WAVEFORM_SINE;
+    if (parts.size() > 1) {
+        waveform = WAVEFORM_COUNT;
+        for (int index = 0; index < WAVEFORM_COUNT; ++index)
+            if (parts[1].compare(WAVEFORM_NAMES[index], Qt::CaseInsensitive) == 0) waveform = (Waveform)index;
+    }
+    if (parts.size() > 2 || waveform == WAVEFORM_COUNT) {
+        errorMessage = QCoreApplication::translate("", "Invalid simulated device %1, valid are: %2")
+                           .arg(description, descriptionHelp());
+        return nullptr;
+    }
+
+    return std::unique_ptr<SimulatedDevice>(new SimulatedDevice(*model, waveform));
+}
+
+QString SimulatedDevice::descriptionHelp() {
+    QStringList models;
+    for (const DSOModel &model : supportedModels) {
+        const QString name = QString::fromStdString(model.name);
+        if (!models.contains(name)) models << name;
+    }
+    QStringList waveforms;
+    for (const char *name : WAVEFORM_NAMES) waveforms << name;
+    return QString("%1[:%2]").arg(models.join(", "), waveforms.join("|"));
+}
+
+void SimulatedDevice::setSignal(unsigned channel, Waveform waveform, unsigned period, double amplitude) {
+    Generator &generator = generators[channel];
+    generator.waveform = waveform;
+    generator.amplitude = std::max(0.0, std::min(amplitude, 1.0)) * halfRange;
+    generator.position = 0;
+    generator.table.clear();
+    if (waveform == WAVEFORM_NOISE) return;
+
+    // The periodic waveforms are only calculated once, generating a frame just copies them
+    period = std::max(period, 2u);
+    const unsigned length = (waveform == WAVEFORM_BURST) ? period * (BURST_PERIODS + BURST_SILENCE) : period;
+    generator.table.resize(length);
+    for (unsigned index = 0; index < length; ++index) {
+        double value;
+        if (waveform == WAVEFORM_SQUARE)
+            value = (index < period / 2) ? 1.0 : -1.0;
+        else if (waveform == WAVEFORM_BURST && index >= period * BURST_PERIODS)
+            value = 0.0;
+        else
+            value = std::sin(2.0 * M_PI * index / period);
+        generator.table[index] = (unsigned short)std::lround(center + value * generator.amplitude);
+    }
+}
+
+bool SimulatedDevice::connectDevice(QString &errorMessage) {
+    Q_UNUSED(errorMessage);
+    connected = true;
+    return true;
+}
+
+bool SimulatedDevice::isConnected() { return connected; }
+
+/// \brief Answers the capture state request, the other bulk reads return zeros.
+int SimulatedDevice::bulkRead(unsigned char *data, unsigned int length, int attempts) {
+    Q_UNUSED(attempts);
+    if (!connected) return LIBUSB_ERROR_NO_DEVICE;
+
+    std::memset(data, 0, length);
+    if (response == BULK_GETCAPTURESTATE && length > 0) {
+        // Every capture is ready immediately and triggered at the start of the buffer
+        CaptureState ready = CAPTURE_READY;
+        if (model.uniqueModelID == MODEL_DSO2250)
+            ready = CAPTURE_READY2250;
+        else if (model.uniqueModelID == MODEL_DSO5200 || model.uniqueModelID == MODEL_DSO5200A)
+            ready = CAPTURE_READY5200;
+        data[0] = (unsigned char)(captured ? ready : CAPTURE_WAITING);
+    }
+    response = 0;
+    return (int)length;
+}
+
+int SimulatedDevice::bulkCommand(DataArray<unsigned char> *command, int attempts) {
+    Q_UNUSED(attempts);
+    if (!connected) return LIBUSB_ERROR_NO_DEVICE;
+    if (!allowBulkTransfer) return LIBUSB_SUCCESS;
+
+    switch (command->data()[0]) {
+    case BULK_STARTSAMPLING:
+        captured = true;
+        break;
+    case BULK_GETDATA:
+        captured = false;
+        break;
+    case BULK_GETCAPTURESTATE:
+        response = BULK_GETCAPTURESTATE;
+        break;
+    default:
+        updateChannels(command);
+        break;
+    }
+    return (int)command->getSize();
+}
+
+int SimulatedDevice::bulkReadMulti(unsigned char *data, unsigned length, int attempts) {
+    Q_UNUSED(attempts);
+    if (!connected) return LIBUSB_ERROR_NO_DEVICE;
+
+    generate(data, length, true);
+    return (int)length;
+}
+
+int SimulatedDevice::startStreaming(unsigned transferSize, unsigned transferCount, unsigned bufferSize,
+                                    unsigned alignment) {
+    Q_UNUSED(transferSize);
+    Q_UNUSED(transferCount);
+    Q_UNUSED(bufferSize);
+    Q_UNUSED(alignment);
+    if (!connected) return LIBUSB_ERROR_NO_DEVICE;
+
+    streaming = true;
+    return LIBUSB_SUCCESS;
+}
+
+void SimulatedDevice::stopStreaming() { streaming = false; }
+
+bool SimulatedDevice::isStreaming() const { return streaming; }
+
+/// \brief Generates the requested data, the stream never waits and never drops data.
+int SimulatedDevice::readStream(unsigned char *data, unsigned length, unsigned timeout) {
+    Q_UNUSED(timeout);
+    if (!connected) return LIBUSB_ERROR_NO_DEVICE;
+    if (!streaming) return LIBUSB_ERROR_NOT_FOUND;
+
+    generate(data, length, false);
+    return (int)length;
+}
+
+/// \return Always 0, so the acquisition reads one frame per cycle and stays responsive.
+unsigned SimulatedDevice::getStreamAvailable() const { return 0; }
+
+unsigned long long SimulatedDevice::getStreamDroppedBytes() const { return 0; }
+
+/// \brief Sleeps for the timeout, there are no transfers to handle.
+int SimulatedDevice::waitForEvents(unsigned timeout) {
+    if (!connected) return LIBUSB_ERROR_NO_DEVICE;
+    QThread::usleep(timeout);
+    return LIBUSB_SUCCESS;
+}
+
+int SimulatedDevice::controlWriteBatch(std::vector<USBControlWrite> &writes) {
+    for (USBControlWrite &write : writes) write.result = connected ? (int)write.data.size() : LIBUSB_ERROR_NO_DEVICE;
+    return connected ? LIBUSB_SUCCESS : LIBUSB_ERROR_NO_DEVICE;
+}
+
+/// \brief Answers the speed and offset limit requests, the other reads return zeros.
+int SimulatedDevice::controlRead(unsigned char request, unsigned char *data, unsigned int length, int value,
+                                 int index, int attempts) {
+    Q_UNUSED(index);
+    Q_UNUSED(attempts);
+    if (!connected) return LIBUSB_ERROR_NO_DEVICE;
+
+    std::memset(data, 0, length);
+    if (request == CONTROL_GETSPEED && length > 0) {
+        data[0] = CONNECTION_HIGHSPEED;
+    } else if (request == CONTROL_VALUE && value == VALUE_OFFSETLIMITS) {
+        // The big endian start and end of every offset range, the whole range is usable
+        for (unsigned position = 0; position + 3 < length; position += 4) {
+            data[position + 2] = 0xff;
+            data[position + 3] = 0xff;
+        }
+    }
+    return (int)length;
+}
+
+unsigned short SimulatedDevice::nextCode(unsigned channel) {
+    Generator &generator = generators[channel];
+    if (generator.waveform == WAVEFORM_NOISE) {
+        noiseState ^= noiseState << 13;
+        noiseState ^= noiseState >> 17;
+        noiseState ^= noiseState << 5;
+        const double value = noiseState / 4294967295.0 * 2.0 - 1.0;
+        return (unsigned short)std::lround(center + value * generator.amplitude);
+    }
+
+    const unsigned short code = generator.table[generator.position];
+    if (++generator.position == generator.table.size()) generator.position = 0;
+    return code;
+}
+
+/// \brief Fills a buffer in the data layout of the model.
+/// \param data The buffer.
+/// \param length The length of the buffer in bytes.
+/// \param stale true, if the frame contains the stale samples of the DSO-6022BE.
+void SimulatedDevice::generate(unsigned char *data, unsigned length, bool stale) {
+    if (sampleSize > 8) {
+        generate10(data, length);
+        return;
+    }
+
+    unsigned head = 0;
+    unsigned tail = 0;
+    if (stale && model.uniqueModelID == MODEL_DSO6022BE && length / HANTEK_CHANNELS > STALE_HEAD + STALE_TAIL) {
+        head = STALE_HEAD;
+        tail = STALE_TAIL;
+    }
+    generate8(data, length, head, tail);
+}
+
+/// \brief Fills a buffer with 8 bit samples.
+/// The samples of both channels alternate, the second channel comes first
+/// except on the DSO-6022BE. In fast rate mode the buffer only contains the
+/// samples of one channel.
+/// \param data The buffer.
+/// \param length The length of the buffer in bytes.
+/// \param head The number of stale samples per channel at the start.
+/// \param tail The number of stale samples per channel at the end.
+void SimulatedDevice::generate8(unsigned char *data, unsigned length, unsigned head, unsigned tail) {
+    if (fastRate) {
+        for (unsigned position = 0; position < length; ++position)
+            data[position] = (unsigned char)nextCode(fastRateChannel);
+        return;
+    }
+
+    const bool secondFirst = model.uniqueModelID != MODEL_DSO6022BE;
+    const unsigned count = length / HANTEK_CHANNELS;
+    std::memset(data, STALE_CODE, length);
+    for (unsigned sample = head; sample < count - tail; ++sample) {
+        unsigned char *samples = data + sample * HANTEK_CHANNELS;
+        for (unsigned channel = 0; channel < HANTEK_CHANNELS; ++channel)
+            samples[secondFirst ? HANTEK_CHANNELS - 1 - channel : channel] = (unsigned char)nextCode(channel);
+    }
+}
+
+/// \brief Fills a buffer with 10 bit samples.
+/// The first half of the buffer contains the lower 8 bits like generate8(),
+/// the second half the extra bits. Two consecutive samples share the extra
+/// bits byte at the position of the first one, the first sample is stored in
+/// bits 2-3 and the second one in bits 0-1.
+/// \param data The buffer.
+/// \param length The length of the buffer in bytes.
+void SimulatedDevice::generate10(unsigned char *data, unsigned length) {
+    const unsigned count = length / 2;
+    unsigned char *low = data;
+    unsigned char *high = data + count;
+    std::memset(data, 0, length);
+
+    if (fastRate) {
+        for (unsigned position = 0; position < count; ++position) {
+            const unsigned short code = nextCode(fastRateChannel);
+            low[position] = (unsigned char)code;
+            high[position - position % 2] |= (unsigned char)((code >> 8) << ((1 - position % 2) * 2));
+        }
+        return;
+    }
+
+    for (unsigned position = 0; position + HANTEK_CHANNELS <= count; position += HANTEK_CHANNELS) {
+        for (unsigned channel = 0; channel < HANTEK_CHANNELS; ++channel) {
+            const unsigned short code = nextCode(channel);
+            low[position + HANTEK_CHANNELS - 1 - channel] = (unsigned char)code;
+            high[position] |= (unsigned char)((code >> 8) << (channel * 2));
+        }
+    }
+}
+
+/// \brief Takes the used channels and the fast rate mode from the model specific bulk commands.
+void SimulatedDevice::updateChannels(DataArray<unsigned char> *command) {
+    const unsigned char code = command->data()[0];
+    switch (model.uniqueModelID) {
+    case MODEL_DSO2090:
+    case MODEL_DSO2150:
+        if (code == BULK_SETTRIGGERANDSAMPLERATE) {
+            BulkSetTriggerAndSamplerate *setTrigger = static_cast<BulkSetTriggerAndSamplerate *>(command);
+            fastRate = setTrigger->getFastRate();
+            fastRateChannel = (setTrigger->getUsedChannels() == USED_CH2) ? 1 : 0;
+        }
+        break;
+    case MODEL_DSO2250:
+        if (code == BULK_BSETCHANNELS)
+            fastRateChannel = (static_cast<BulkSetChannels2250 *>(command)->getUsedChannels() == BUSED_CH2) ? 1 : 0;
+        else if (code == BULK_ESETTRIGGERORSAMPLERATE)
+            fastRate = static_cast<BulkSetSamplerate2250 *>(command)->getFastRate();
+        break;
+    case MODEL_DSO5200:
+    case MODEL_DSO5200A:
+        if (code == BULK_ESETTRIGGERORSAMPLERATE) {
+            BulkSetTrigger5200 *setTrigger = static_cast<BulkSetTrigger5200 *>(command);
+            fastRate = setTrigger->getFastRate();
+            fastRateChannel = (setTrigger->getUsedChannels() == USED_CH2) ? 1 : 0;
+        }
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "usbdevice.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class SimulatedDevice                                     simulateddevice.h
+/// \brief A device without hardware, that generates test signals.
+/// The device answers the commands of HantekDsoControl like the emulated model
+/// and delivers the samples in the data layout of that model: interleaved 8 bit
+/// channels, the channel order and 0x83 bias of the DSO-6022BE including the
+/// stale head and tail of its frames, the separately stored extra bits of the
+/// 10 bit models and the single channel of the fast rate mode.
+///
+/// The samples are generated as fast as they are requested, so the acquisition
+/// runs at the speed of the computer. This makes the device usable for
+/// benchmarks and for tests without an oscilloscope. The signals are defined in
+/// raw codes around the middle of the code range, the gain and offset settings
+/// of the device don't change them.
+class SimulatedDevice : public USBDevice {
+    Q_OBJECT
+
+  public:
+    /// \brief The generated signal shapes.
+    enum Waveform {
+        WAVEFORM_SINE,   ///< A sine wave
+        WAVEFORM_SQUARE, ///< A square wave with 50% duty cycle
+        WAVEFORM_NOISE,  ///< Uniformly distributed white noise
+        WAVEFORM_BURST,  ///< Bursts of BURST_PERIODS sine periods, followed by silence
+        WAVEFORM_COUNT
+    };
+
+    /// \param model The emulated model.
+    /// \param waveform The signal of both channels.
+    SimulatedDevice(const DSOModel &model, Waveform waveform = WAVEFORM_SINE);
+
+    /// \brief Creates a device from a description.
+    /// \param description The name of the model, optionally followed by ':' and the waveform,
+    ///        e.g. "DSO-2090:square". The "DSO-" prefix and the case are ignored.
+    /// \param errorMessage Set to the reason, if the description is invalid.
+    /// \return The device or nullptr, if the description is invalid.
+    static std::unique_ptr<SimulatedDevice> create(const QString &description, QString &errorMessage);
+    /// \return The valid descriptions, for the help text of the command line.
+    static QString descriptionHelp();
+
+    /// \brief Changes the signal of a channel.
+    /// \param channel The channel.
+    /// \param waveform The signal shape.
+    /// \param period The period of the signal in samples.
+    /// \param amplitude The amplitude as fraction of half the code range.
+    void setSignal(unsigned channel, Waveform waveform, unsigned period, double amplitude);
+
+    static const unsigned BURST_PERIODS = 4;   ///< The sine periods in a burst
+    static const unsigned BURST_SILENCE = 16;  ///< The periods of silence after a burst
+    static const unsigned STALE_HEAD = 0x410;  ///< The stale samples per channel before a DSO-6022BE frame
+    static const unsigned STALE_TAIL = 0x3F0;  ///< The stale samples per channel after a DSO-6022BE frame
+    static const unsigned char STALE_CODE = 0; ///< The code of the stale samples
+
+    bool connectDevice(QString &errorMessage) override;
+    bool isConnected() override;
+
+    int bulkRead(unsigned char *data, unsigned int length, int attempts = HANTEK_ATTEMPTS) override;
+    int bulkCommand(DataArray<unsigned char> *command, int attempts = HANTEK_ATTEMPTS) override;
+    int bulkReadMulti(unsigned char *data, unsigned length, int attempts = HANTEK_ATTEMPTS_MULTI) override;
+
+    int startStreaming(unsigned transferSize, unsigned transferCount, unsigned bufferSize,
+                       unsigned alignment) override;
+    void stopStreaming() override;
+    bool isStreaming() const override;
+    int readStream(unsigned char *data, unsigned length, unsigned timeout = HANTEK_TIMEOUT) override;
+    unsigned getStreamAvailable() const override;
+    unsigned long long getStreamDroppedBytes() const override;
+    int waitForEvents(unsigned timeout) override;
+
+    int controlWriteBatch(std::vector<USBControlWrite> &writes) override;
+    int controlRead(unsigned char request, unsigned char *data, unsigned int length, int value = 0, int index = 0,
+                    int attempts = HANTEK_ATTEMPTS) override;
+
+  private:
+    /// \brief The generator of one channel.
+    struct Generator {
+        Waveform waveform = WAVEFORM_SINE;
+        std::vector<unsigned short> table; ///< One repetition of the periodic waveforms
+        size_t position = 0;               ///< The position of the next sample in the table
+        double amplitude = 0.0;            ///< The amplitude in codes
+    };
+
+    unsigned short nextCode(unsigned channel);
+    void generate(unsigned char *data, unsigned length, bool stale);
+    void generate8(unsigned char *data, unsigned length, unsigned head, unsigned tail);
+    void generate10(unsigned char *data, unsigned length);
+    void updateChannels(DataArray<unsigned char> *command);
+
+    Generator generators[HANTEK_CHANNELS];
+    unsigned sampleSize;          ///< The bits per sample of the model
+    unsigned short center;        ///< The code of 0 V
+    unsigned short halfRange;     ///< The largest amplitude in codes
+    uint32_t noiseState = 1;      ///< The state of the xorshift noise generator
+    bool connected = false;       ///< true, after connectDevice()
+    bool streaming = false;       ///< true, after startStreaming()
+    bool captured = false;        ///< true, if a frame was captured and not read yet
+    bool fastRate = false;        ///< true, if a single channel uses both buffers
+    unsigned fastRateChannel = 0; ///< The channel in fast rate mode
+    unsigned char response = 0;   ///< The bulk command whose response is read next
+};
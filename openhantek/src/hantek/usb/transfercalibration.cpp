@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSettings>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "transfercalibration.h"
+
+#include "utils/printutils.h"
+
+const unsigned TransferCalibration::READ_LENGTH;
+const unsigned TransferCalibration::TOLERANCE;
+
+namespace {
+const unsigned TRANSFER_SIZES[] = {4096, 16384, 65536, 262144}; ///< The candidate transfer sizes in bytes
+const unsigned TRANSFER_COUNTS[] = {2, 4, 8, 16};               ///< The candidate numbers of transfers in flight
+
+/// \return The settings group of the cached configuration of a device.
+QString cacheGroup(const QString &identity) { return QString("usbTransfers/%1").arg(identity); }
+}
+
+bool TransferCalibration::applyCached(USBDevice *device) {
+    const QString identity = device->getIdentity();
+    if (identity.isEmpty()) return false;
+
+    QSettings store;
+    store.beginGroup(cacheGroup(identity));
+    USBTransferConfiguration configuration;
+    configuration.transferSize = store.value("transferSize").toUInt();
+    configuration.transferCount = store.value("transferCount").toUInt();
+    if (!configuration.transferSize || !configuration.transferCount) return false;
+    device->setTransferConfiguration(configuration);
+    return true;
+}
+
+bool TransferCalibration::calibrate(USBDevice *device, double sourceRate) {
+    USBTransferConfiguration configuration;
+    const double throughput = measure(device, configuration);
+    if (throughput <= 0.0) {
+        qWarning() << "Calibrating the usb transfers failed, the default transfers are used";
+        return false;
+    }
+    timestampDebug(QString("Calibrated usb transfers of %1 bytes, %2 in flight: %3 MB/s")
+                       .arg(configuration.transferSize)
+                       .arg(configuration.transferCount)
+                       .arg(throughput / 1e6, 0, 'f', 1));
+
+    // Every configuration reaches the rate of the device then, the one of the host is still unknown
+    if (sourceRate > 0.0 && throughput * (100 + TOLERANCE) >= sourceRate * 100) {
+        timestampDebug("The usb transfers are limited by the samplerate, the calibration isn't cached");
+        return true;
+    }
+    const QString identity = device->getIdentity();
+    if (identity.isEmpty()) return true;
+    QSettings store;
+    store.beginGroup(cacheGroup(identity));
+    store.setValue("transferSize", configuration.transferSize);
+    store.setValue("transferCount", configuration.transferCount);
+    store.setValue("throughput", throughput);
+    return true;
+}
+
+double TransferCalibration::measure(USBDevice *device, USBTransferConfiguration &configuration) {
+    const USBTransferConfiguration previous = device->getTransferConfiguration();
+    std::vector<unsigned char> buffer(READ_LENGTH);
+
+    // The reads use whole packets, so several candidates may end up with the same size
+    const unsigned packetLength = (unsigned)std::max(device->getInPacketLength(), 1);
+    std::vector<unsigned> sizes;
+    for (unsigned size : TRANSFER_SIZES) sizes.push_back(std::max(packetLength, size / packetLength * packetLength));
+    std::sort(sizes.begin(), sizes.end());
+    sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+
+    double bestThroughput = 0.0;
+    USBTransferConfiguration best = previous;
+    std::vector<std::pair<USBTransferConfiguration, double>> results;
+    for (unsigned size : sizes) {
+        for (unsigned count : TRANSFER_COUNTS) {
+            USBTransferConfiguration candidate;
+            candidate.transferSize = size;
+            candidate.transferCount = count;
+            device->setTransferConfiguration(candidate);
+
+            // The first read fills the pipeline of the device and of the host controller
+            if (device->bulkReadMulti(buffer.data(), size * count) == LIBUSB_ERROR_NO_DEVICE) {
+                device->setTransferConfiguration(previous);
+                return 0.0;
+            }
+
+            QElapsedTimer timer;
+            timer.start();
+            const int received = device->bulkReadMulti(buffer.data(), READ_LENGTH);
+            const qint64 elapsed = timer.nsecsElapsed();
+            // A read that stopped early measured a timeout, not the throughput
+            if (received < (int)READ_LENGTH / 2 || elapsed <= 0) continue;
+
+            const double throughput = received * 1e9 / elapsed;
+            results.push_back(std::make_pair(candidate, throughput));
+            if (throughput > bestThroughput) bestThroughput = throughput;
+        }
+    }
+    if (results.empty()) {
+        device->setTransferConfiguration(previous);
+        return 0.0;
+    }
+
+    // Of the equally fast configurations the one with the least data in flight has the lowest latency
+    double selectedThroughput = 0.0;
+    unsigned long long bestInFlight = ~0ull;
+    for (const std::pair<USBTransferConfiguration, double> &result : results) {
+        if (result.second * (100 + TOLERANCE) < bestThroughput * 100) continue;
+        const unsigned long long inFlight = (unsigned long long)result.first.transferSize * result.first.transferCount;
+        if (inFlight >= bestInFlight) continue;
+        bestInFlight = inFlight;
+        best = result.first;
+        selectedThroughput = result.second;
+    }
+
+    device->setTransferConfiguration(best);
+    configuration = best;
+    return selectedThroughput;
+}
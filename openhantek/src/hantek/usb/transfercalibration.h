@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include "usbdevice.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class TransferCalibration                         usb/transfercalibration.h
+/// \brief Finds the fastest asynchronous reads of a device on this host.
+/// The throughput of the bulk reads depends on the host controller as much as
+/// on the device, so one fixed transfer size and queue depth is far from the
+/// best on most hosts. The calibration reads the free running data of the
+/// device with every combination of the candidate sizes and depths and selects
+/// the fastest one. Combinations within a few percent of the fastest one count
+/// as equal, the one with the fewest bytes in flight is taken then. The result
+/// is cached per device identity, so later connections only apply it. A result
+/// that is limited by the data rate of the device instead of the host isn't
+/// cached, the device should send as fast as it can while it is calibrated.
+class TransferCalibration {
+  public:
+    /// \brief Applies the cached configuration of the device.
+    /// \param device The connected device.
+    /// \return true, if a cached configuration was applied.
+    static bool applyCached(USBDevice *device);
+
+    /// \brief Measures the transfers of the device and applies the fastest configuration.
+    /// The device has to deliver data continuously and has to use the asynchronous reads.
+    /// \param device The connected device.
+    /// \param sourceRate The bytes per second the device sends, 0.0 if unknown.
+    /// \return true, if a calibrated configuration was applied, the device keeps its transfers otherwise.
+    static bool calibrate(USBDevice *device, double sourceRate);
+
+    /// \brief Measures the candidate configurations.
+    /// The candidate transfer sizes are rounded to multiples of the packet length of the device, like the reads
+    /// do, so every effective size is measured once.
+    /// \param device The connected device, its transfers are left at the selected configuration.
+    /// \param configuration Set to the fastest configuration with the effective transfer size.
+    /// \return The throughput of the selected configuration in bytes per second, 0.0 if every read failed.
+    static double measure(USBDevice *device, USBTransferConfiguration &configuration);
+
+  private:
+    static const unsigned READ_LENGTH = 1u << 21; ///< The bytes read with every candidate
+    static const unsigned TOLERANCE = 5;          ///< The throughput difference in percent that counts as equal
+};
@@ -2,19 +2,63 @@
 
 #include <QCoreApplication>
 #include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QString>
 #include <QTemporaryFile>
 #include <libusb-1.0/libusb.h>
+#include <map>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "ezusb.h"
 #include "uploadFirmware.h"
 #include "usbdevice.h"
 #include "utils/printutils.h"
 
+namespace {
+QMutex cacheMutex;                                                    ///< Protects the cache
+std::map<QString, std::unique_ptr<std::vector<ezusb_segment>>> cache; ///< The parsed images by resource name
+
+/// \brief Gets a parsed firmware image, it is parsed on the first request.
+/// \param resource The name of the image in the resources.
+/// \param errorMessage Set to the reason, if the image can't be parsed.
+/// \return The segments of the image, nullptr on failure. They are never changed or freed.
+const std::vector<ezusb_segment> *firmwareImage(const QString &resource, QString &errorMessage) {
+    QMutexLocker locker(&cacheMutex);
+    std::unique_ptr<std::vector<ezusb_segment>> &image = cache[resource];
+    if (image) return image.get();
+
+    // The parser reads files, so the image is extracted once
+    QFile file(resource);
+    std::unique_ptr<QTemporaryFile> temporary(QTemporaryFile::createNativeFile(file));
+    if (!temporary || !temporary->open()) {
+        errorMessage = QCoreApplication::translate("", "Couldn't extract the firmware %1").arg(resource);
+        return nullptr;
+    }
+    std::unique_ptr<std::vector<ezusb_segment>> segments(new std::vector<ezusb_segment>());
+    if (ezusb_parse_ihex(temporary->fileName().toUtf8().constData(), *segments) < 0) {
+        errorMessage = QCoreApplication::translate("", "Couldn't parse the firmware %1").arg(resource);
+        return nullptr;
+    }
+    image = std::move(segments);
+    return image.get();
+}
+}
+
 bool UploadFirmware::startUpload(USBDevice *device) {
     if (device->isConnected() || !device->needsFirmware()) return false;
 
+    // Get the parsed images, they are only read from the resources for the first device of a model
+    const QString token = QString::fromStdString(device->getModel().firmwareToken);
+    const std::vector<ezusb_segment> *loader =
+        firmwareImage(QString(":/firmware/%1-loader.hex").arg(token), errorMessage);
+    if (!loader) return false;
+    const std::vector<ezusb_segment> *firmware =
+        firmwareImage(QString(":/firmware/%1-firmware.hex").arg(token), errorMessage);
+    if (!firmware) return false;
+
     // Open device
     libusb_device_handle *handle;
     int errorCode = libusb_open(device->getRawDevice(), &handle);
@@ -24,17 +68,6 @@ bool UploadFirmware::startUpload(USBDevice *device) {
         return false;
     }
 
-    // Write firmware from resources to temp files
-    QFile firmwareRes(
-        QString(":/firmware/%1-firmware.hex").arg(QString::fromStdString(device->getModel().firmwareToken)));
-    auto temp_firmware_path = std::unique_ptr<QTemporaryFile>(QTemporaryFile::createNativeFile(firmwareRes));
-    if (!temp_firmware_path) return false;
-    temp_firmware_path->open();
-    QFile loaderRes(QString(":/firmware/%1-loader.hex").arg(QString::fromStdString(device->getModel().firmwareToken)));
-    auto temp_loader_path = std::unique_ptr<QTemporaryFile>(QTemporaryFile::createNativeFile(loaderRes));
-    if (!temp_loader_path) return false;
-    temp_loader_path->open();
-
     /* We need to claim the first interface */
     libusb_set_auto_detach_kernel_driver(handle, 1);
     int status = libusb_claim_interface(handle, 0);
@@ -45,20 +78,20 @@ bool UploadFirmware::startUpload(USBDevice *device) {
     }
 
     // Write loader
-    status = ezusb_load_ram(handle, temp_loader_path->fileName().toUtf8().constData(), FX_TYPE_FX2, IMG_TYPE_HEX, 0);
+    status = ezusb_load_ram_segments(handle, *loader, FX_TYPE_FX2, 0);
 
     if (status != LIBUSB_SUCCESS) {
-        errorMessage = QString("ezusb_load_ram(loader_path) failed: %1").arg(libusb_error_name(status));
+        errorMessage = QString("ezusb_load_ram_segments(loader) failed: %1").arg(libusb_error_name(status));
         libusb_release_interface(handle, 0);
         libusb_close(handle);
         return false;
     }
 
     // Write firmware
-    status = ezusb_load_ram(handle, temp_firmware_path->fileName().toUtf8().constData(), FX_TYPE_FX2, IMG_TYPE_HEX, 1);
+    status = ezusb_load_ram_segments(handle, *firmware, FX_TYPE_FX2, 1);
 
     if (status != LIBUSB_SUCCESS) {
-        errorMessage = QString("ezusb_load_ram(firmware_path) failed: %1").arg(libusb_error_name(status));
+        errorMessage = QString("ezusb_load_ram_segments(firmware) failed: %1").arg(libusb_error_name(status));
         libusb_release_interface(handle, 0);
         libusb_close(handle);
         return false;
@@ -70,3 +103,32 @@ bool UploadFirmware::startUpload(USBDevice *device) {
 }
 
 const QString &UploadFirmware::getErrorMessage() const { return errorMessage; }
+
+unsigned UploadFirmware::uploadAll(const std::list<std::unique_ptr<USBDevice>> &devices, QStringList &errorMessages) {
+    std::vector<USBDevice *> pending;
+    for (const auto &device : devices) {
+        if (!device->isConnected() && device->needsFirmware()) pending.push_back(device.get());
+    }
+
+    // libusb may be used from several threads, every thread only opens its own device
+    std::vector<UploadFirmware> uploads(pending.size());
+    std::vector<char> uploaded(pending.size(), false);
+    std::vector<std::thread> threads;
+    for (size_t index = 0; index < pending.size(); ++index) {
+        threads.emplace_back([&uploads, &uploaded, &pending, index]() {
+            uploaded[index] = uploads[index].startUpload(pending[index]);
+        });
+    }
+    for (std::thread &thread : threads) thread.join();
+
+    unsigned count = 0;
+    for (size_t index = 0; index < pending.size(); ++index) {
+        if (uploaded[index]) {
+            ++count;
+        } else {
+            errorMessages << QString("%1: %2").arg(QString::fromStdString(pending[index]->getModel().name),
+                                                   uploads[index].getErrorMessage());
+        }
+    }
+    return count;
+}
@@ -3,18 +3,32 @@
 #pragma once
 
 #include <QString>
+#include <QStringList>
+#include <list>
+#include <memory>
 
 class USBDevice;
 
 /**
  * Extracts the firmware from the applications resources, and uploads the
  * firmware to the given device.
+ *
+ * The firmware images are parsed only once per model, the parsed images are
+ * kept for the lifetime of the process and shared by all uploads.
  */
 class UploadFirmware {
   public:
     bool startUpload(USBDevice *device);
     const QString &getErrorMessage() const;
 
+    /// \brief Uploads the firmware to all devices that need it, every device in its own thread.
+    /// The devices only need a few control transfers each, so the time of the
+    /// upload doesn't grow with the number of devices.
+    /// \param devices The found devices, devices that already have a firmware are skipped.
+    /// \param errorMessages Gets the reason of every failed upload.
+    /// \return The number of devices the firmware was uploaded to.
+    static unsigned uploadAll(const std::list<std::unique_ptr<USBDevice>> &devices, QStringList &errorMessages);
+
   private:
     QString errorMessage;
 };
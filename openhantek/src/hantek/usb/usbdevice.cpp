@@ -1,10 +1,14 @@
 // SPDX-License-Identifier: GPL-2.0+
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QList>
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include "usbdevice.h"
+#include "usbstream.h"
 
 #include "controlStructs.h"
 #include "models.h"
@@ -12,11 +16,61 @@
 
 using namespace Hantek;
 
-USBDevice::USBDevice(DSOModel model, libusb_device *device) : model(model), device(device) {
+namespace {
+/// \brief Bookkeeping for one transfer slot of USBDevice::bulkReadMultiAsync.
+struct AsyncReadSlot {
+    libusb_transfer *transfer = nullptr;
+    unsigned chunk = 0;     ///< The index of the chunk this transfer reads
+    int attempt = 0;        ///< The number of attempts already done for this chunk
+    bool busy = false;      ///< true, while the transfer is submitted
+    bool completed = false; ///< true, when the transfer finished and wasn't handled yet
+};
+
+void LIBUSB_CALL asyncReadCallback(libusb_transfer *transfer) {
+    static_cast<AsyncReadSlot *>(transfer->user_data)->completed = true;
+}
+
+/// \brief Translates the status of a finished transfer into a libusb error code.
+int transferStatusError(libusb_transfer_status status) {
+    switch (status) {
+    case LIBUSB_TRANSFER_COMPLETED:
+        return LIBUSB_SUCCESS;
+    case LIBUSB_TRANSFER_TIMED_OUT:
+        return LIBUSB_ERROR_TIMEOUT;
+    case LIBUSB_TRANSFER_CANCELLED:
+        return LIBUSB_ERROR_INTERRUPTED;
+    case LIBUSB_TRANSFER_STALL:
+        return LIBUSB_ERROR_PIPE;
+    case LIBUSB_TRANSFER_NO_DEVICE:
+        return LIBUSB_ERROR_NO_DEVICE;
+    case LIBUSB_TRANSFER_OVERFLOW:
+        return LIBUSB_ERROR_OVERFLOW;
+    default:
+        return LIBUSB_ERROR_IO;
+    }
+}
+
+/// \brief Stores the result of a finished USBDevice::controlWriteBatch transfer.
+void LIBUSB_CALL asyncWriteCallback(libusb_transfer *transfer) {
+    USBControlWrite *write = static_cast<USBControlWrite *>(transfer->user_data);
+    write->result = (transfer->status == LIBUSB_TRANSFER_COMPLETED) ? transfer->actual_length
+                                                                     : transferStatusError(transfer->status);
+}
+}
+
+USBDevice::USBDevice(DSOModel model, libusb_device *device, libusb_context *context)
+    : model(model), context(context), device(device) {
     libusb_ref_device(device);
     libusb_get_device_descriptor(device, &descriptor);
 }
 
+USBDevice::USBDevice(DSOModel model) : model(model), context(nullptr), device(nullptr) {
+    descriptor = libusb_device_descriptor();
+    descriptor.idVendor = (uint16_t)model.vendorID;
+    descriptor.idProduct = (uint16_t)model.productID;
+    inPacketLength = outPacketLength = 512;
+}
+
 bool USBDevice::connectDevice(QString &errorMessage) {
     if (needsFirmware()) return false;
     if (isConnected()) return true;
@@ -59,7 +113,22 @@ bool USBDevice::connectDevice(QString &errorMessage) {
     return true;
 }
 
-USBDevice::~USBDevice() { connectionLost(); }
+USBDevice::~USBDevice() {
+    connectionLost();
+    if (device) libusb_unref_device(device);
+}
+
+bool USBDevice::reattach(libusb_device *newDevice, QString &errorMessage) {
+    if (isConnected()) connectionLost();
+
+    // The old device may be the same, so the new one is referenced first
+    libusb_ref_device(newDevice);
+    if (device) libusb_unref_device(device);
+    device = newDevice;
+    libusb_get_device_descriptor(device, &descriptor);
+
+    return connectDevice(errorMessage);
+}
 
 int USBDevice::claimInterface(const libusb_interface_descriptor *interfaceDescriptor, int endpointOut, int endPointIn) {
     int errorCode = libusb_claim_interface(this->handle, interfaceDescriptor->bInterfaceNumber);
@@ -83,10 +152,11 @@ int USBDevice::claimInterface(const libusb_interface_descriptor *interfaceDescri
 }
 
 void USBDevice::connectionLost() {
-    libusb_unref_device(device);
-
     if (!this->handle) return;
 
+    // Cancel the stream transfers before the handle is closed
+    stream.reset();
+
     // Release claimed interface
     libusb_release_interface(this->handle, this->interface);
     this->interface = -1;
@@ -174,6 +244,8 @@ int USBDevice::bulkCommand(DataArray<unsigned char> *command, int attempts) {
 int USBDevice::bulkReadMulti(unsigned char *data, unsigned length, int attempts) {
     if (!this->handle) return LIBUSB_ERROR_NO_DEVICE;
 
+    if (allowAsyncTransfer) return this->bulkReadMultiAsync(data, length, attempts);
+
     int errorCode = 0;
 
     errorCode = this->getConnectionSpeed();
@@ -194,6 +266,188 @@ int USBDevice::bulkReadMulti(unsigned char *data, unsigned length, int attempts)
         return errorCode;
 }
 
+/// \brief Multi packet bulk read from the oscilloscope using asynchronous transfers.
+/// The data is split into chunks of up to USBTransferConfiguration::transferSize
+/// bytes and USBTransferConfiguration::transferCount of them are kept in flight,
+/// so the bus doesn't idle between packets. A short transfer ends the read like in bulkReadMulti().
+/// \param data Buffer for the sent/recieved data.
+/// \param length The length of data contained in the packets.
+/// \param attempts The number of attempts, that are done on timeouts. Only one transfer may be in flight to
+/// retry a chunk, the device fills the queued transfers in order, so the later ones would already take the
+/// data of a resubmitted chunk.
+/// \return Number of received bytes on success, libusb error code on error,
+/// LIBUSB_ERROR_INVALID_PARAM for several attempts with several transfers in flight.
+int USBDevice::bulkReadMultiAsync(unsigned char *data, unsigned length, int attempts) {
+    if (!this->handle) return LIBUSB_ERROR_NO_DEVICE;
+    if (attempts != 1 && transferConfiguration.transferCount > 1) return LIBUSB_ERROR_INVALID_PARAM;
+
+    int errorCode = this->getConnectionSpeed();
+    if (errorCode < 0) return errorCode;
+    if (this->inPacketLength <= 0) return LIBUSB_ERROR_INVALID_PARAM;
+    if (length == 0) return 0;
+
+    // Every chunk but the last one is a multiple of the packet length
+    const unsigned packetLength = (unsigned)this->inPacketLength;
+    const unsigned chunkSize = qMax(packetLength, transferConfiguration.transferSize / packetLength * packetLength);
+    const unsigned chunkCount = (length + chunkSize - 1) / chunkSize;
+    std::vector<int> chunkReceived(chunkCount, -1);
+
+    // The transfer slots are handed to libusb by address, the vector isn't resized afterwards
+    std::vector<AsyncReadSlot> transferSlots(qMax(transferConfiguration.transferCount, 1u));
+    unsigned nextChunk = 0;
+    int inFlight = 0;
+    bool stopped = false;
+    errorCode = LIBUSB_SUCCESS;
+
+    auto submit = [&](AsyncReadSlot &slot, unsigned chunk) {
+        const unsigned offset = chunk * chunkSize;
+        libusb_fill_bulk_transfer(slot.transfer, this->handle, HANTEK_EP_IN, data + offset,
+                                  (int)qMin(chunkSize, length - offset), asyncReadCallback, &slot,
+                                  HANTEK_TIMEOUT_MULTI);
+        slot.chunk = chunk;
+        slot.completed = false;
+        int result = libusb_submit_transfer(slot.transfer);
+        if (result == LIBUSB_SUCCESS) {
+            slot.busy = true;
+            ++inFlight;
+        }
+        return result;
+    };
+    auto stop = [&](int error) {
+        if (error < 0 && errorCode == LIBUSB_SUCCESS) errorCode = error;
+        if (stopped) return;
+        stopped = true;
+        for (AsyncReadSlot &slot : transferSlots)
+            if (slot.busy) libusb_cancel_transfer(slot.transfer);
+    };
+
+    // Fill the pipeline
+    for (AsyncReadSlot &slot : transferSlots) {
+        if (nextChunk >= chunkCount) break;
+        slot.transfer = libusb_alloc_transfer(0);
+        if (!slot.transfer) {
+            stop(LIBUSB_ERROR_NO_MEM);
+            break;
+        }
+        int result = submit(slot, nextChunk++);
+        if (result < 0) {
+            stop(result);
+            break;
+        }
+    }
+
+    // Handle completions and keep the pipeline filled until all data is read
+    while (inFlight > 0) {
+        struct timeval timeout = {0, HANTEK_TIMEOUT_MULTI * 1000};
+        int result = libusb_handle_events_timeout_completed(this->context, &timeout, nullptr);
+        if (result < 0 && result != LIBUSB_ERROR_INTERRUPTED) stop(result);
+
+        for (AsyncReadSlot &slot : transferSlots) {
+            if (!slot.busy || !slot.completed) continue;
+            slot.busy = false;
+            --inFlight;
+
+            libusb_transfer *transfer = slot.transfer;
+            if (!stopped && transfer->status == LIBUSB_TRANSFER_TIMED_OUT && transfer->actual_length == 0 &&
+                (++slot.attempt < attempts || attempts == -1)) {
+                result = submit(slot, slot.chunk);
+                if (result == LIBUSB_SUCCESS) continue;
+                stop(result);
+                continue;
+            }
+
+            if (transfer->status == LIBUSB_TRANSFER_COMPLETED || transfer->actual_length > 0) {
+                chunkReceived[slot.chunk] = transfer->actual_length;
+                // A short transfer marks the end of the available data
+                if (transfer->actual_length < transfer->length) stop(LIBUSB_SUCCESS);
+            } else if (!stopped || transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+                stop(transferStatusError(transfer->status));
+            }
+
+            if (stopped || nextChunk >= chunkCount) continue;
+            slot.attempt = 0;
+            result = submit(slot, nextChunk++);
+            if (result < 0) stop(result);
+        }
+    }
+
+    for (AsyncReadSlot &slot : transferSlots)
+        if (slot.transfer) libusb_free_transfer(slot.transfer);
+
+    // Only the data up to the first incomplete chunk is contiguous
+    unsigned received = 0;
+    for (unsigned chunk = 0; chunk < chunkCount && chunkReceived[chunk] >= 0; ++chunk) {
+        received += chunkReceived[chunk];
+        if ((unsigned)chunkReceived[chunk] < qMin(chunkSize, length - chunk * chunkSize)) break;
+    }
+
+    if (errorCode == LIBUSB_ERROR_NO_DEVICE) connectionLost();
+    if (received > 0)
+        return received;
+    else
+        return errorCode;
+}
+
+int USBDevice::startStreaming(unsigned transferSize, unsigned transferCount, unsigned bufferSize,
+                              unsigned alignment) {
+    if (!this->handle) return LIBUSB_ERROR_NO_DEVICE;
+
+    if (!stream) stream.reset(new USBStream(context, handle, HANTEK_EP_IN));
+    int errorCode = stream->start(transferSize, transferCount, bufferSize, alignment);
+    if (errorCode == LIBUSB_ERROR_NO_DEVICE) connectionLost();
+    return errorCode;
+}
+
+void USBDevice::stopStreaming() {
+    if (stream) stream->stop();
+}
+
+bool USBDevice::isStreaming() const { return stream && stream->isRunning(); }
+
+/// \brief Reads the next data from the stream started by startStreaming().
+/// Consecutive reads return consecutive data, as long as the ring buffer didn't
+/// overflow in between (See getStreamDroppedBytes()).
+/// \param data Buffer for the recieved data.
+/// \param length The number of bytes that should be read.
+/// \param timeout The maximum time in ms to wait for the data.
+/// \return Number of received bytes on success, 0 if the data didn't arrive in
+/// time, libusb error code on error.
+int USBDevice::readStream(unsigned char *data, unsigned length, unsigned timeout) {
+    if (!this->handle) return LIBUSB_ERROR_NO_DEVICE;
+    if (!stream) return LIBUSB_ERROR_NOT_FOUND;
+
+    int errorCode = stream->read(data, length, timeout);
+    if (errorCode == LIBUSB_ERROR_NO_DEVICE) connectionLost();
+    return errorCode;
+}
+
+unsigned USBDevice::getStreamAvailable() const { return stream ? stream->available() : 0; }
+
+unsigned long long USBDevice::getStreamDroppedBytes() const { return stream ? stream->droppedBytes() : 0; }
+
+/// \brief Handles usb events until the timeout expires.
+/// This is used to wait for short periods with a finer resolution than timers
+/// provide, completed asynchronous transfers are processed in the meantime.
+/// \param timeout The time to wait in µs.
+/// \return LIBUSB_SUCCESS on success, libusb error code on error.
+int USBDevice::waitForEvents(unsigned timeout) {
+    if (!this->handle) return LIBUSB_ERROR_NO_DEVICE;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (;;) {
+        const qint64 elapsed = timer.nsecsElapsed() / 1000;
+        if (elapsed >= (qint64)timeout) return LIBUSB_SUCCESS;
+
+        const unsigned remaining = timeout - (unsigned)elapsed;
+        struct timeval tv;
+        tv.tv_sec = remaining / 1000000;
+        tv.tv_usec = remaining % 1000000;
+        int errorCode = libusb_handle_events_timeout_completed(context, &tv, nullptr);
+        if (errorCode < 0 && errorCode != LIBUSB_ERROR_INTERRUPTED) return errorCode;
+    }
+}
+
 /// \brief Control transfer to the oscilloscope.
 /// \param type The request type, also sets the direction of the transfer.
 /// \param request The request field of the packet.
@@ -231,6 +485,72 @@ int USBDevice::controlWrite(unsigned char request, unsigned char *data, unsigned
                                  attempts);
 }
 
+/// \brief Sends several control writes to the oscilloscope in one burst.
+/// All writes are submitted at once as asynchronous transfers, so they are
+/// sent in order without waiting for the completion of the previous one.
+/// \param writes The control writes, their result is set when this returns.
+/// \return LIBUSB_SUCCESS if all writes were sent, the first libusb error code
+/// otherwise.
+int USBDevice::controlWriteBatch(std::vector<USBControlWrite> &writes) {
+    if (!this->handle) return LIBUSB_ERROR_NO_DEVICE;
+
+    std::vector<libusb_transfer *> transfers(writes.size(), nullptr);
+    std::vector<std::vector<unsigned char>> buffers(writes.size());
+    int inFlight = 0;
+    int errorCode = LIBUSB_SUCCESS;
+
+    for (size_t index = 0; index < writes.size(); ++index) {
+        USBControlWrite &write = writes[index];
+        write.result = LIBUSB_ERROR_INTERRUPTED;
+        if (errorCode < 0) continue;
+
+        transfers[index] = libusb_alloc_transfer(0);
+        if (!transfers[index]) {
+            errorCode = LIBUSB_ERROR_NO_MEM;
+            continue;
+        }
+
+        buffers[index].resize(LIBUSB_CONTROL_SETUP_SIZE + write.data.size());
+        libusb_fill_control_setup(buffers[index].data(), LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_ENDPOINT_OUT,
+                                  write.request, 0, 0, (uint16_t)write.data.size());
+        std::copy(write.data.begin(), write.data.end(), buffers[index].begin() + LIBUSB_CONTROL_SETUP_SIZE);
+        libusb_fill_control_transfer(transfers[index], this->handle, buffers[index].data(), asyncWriteCallback,
+                                     &write, HANTEK_TIMEOUT);
+
+        int result = libusb_submit_transfer(transfers[index]);
+        if (result < 0) {
+            write.result = result;
+            errorCode = result;
+            continue;
+        }
+        // Marks the write as in flight until the callback stores its result
+        write.result = LIBUSB_ERROR_BUSY;
+        ++inFlight;
+    }
+
+    // Wait until all submitted writes are finished
+    while (inFlight > 0) {
+        struct timeval timeout = {0, HANTEK_TIMEOUT * 1000};
+        int result = libusb_handle_events_timeout_completed(this->context, &timeout, nullptr);
+        if (result < 0 && result != LIBUSB_ERROR_INTERRUPTED) {
+            for (size_t index = 0; index < writes.size(); ++index)
+                if (writes[index].result == LIBUSB_ERROR_BUSY) libusb_cancel_transfer(transfers[index]);
+        }
+
+        inFlight = 0;
+        for (const USBControlWrite &write : writes)
+            if (write.result == LIBUSB_ERROR_BUSY) ++inFlight;
+    }
+
+    for (size_t index = 0; index < writes.size(); ++index) {
+        if (transfers[index]) libusb_free_transfer(transfers[index]);
+        if (writes[index].result < 0 && errorCode == LIBUSB_SUCCESS) errorCode = writes[index].result;
+    }
+
+    if (errorCode == LIBUSB_ERROR_NO_DEVICE) connectionLost();
+    return errorCode;
+}
+
 /// \brief Control read to the oscilloscope.
 /// \param request The request field of the packet.
 /// \param data Buffer for the sent/recieved data.
@@ -274,6 +594,23 @@ int USBDevice::getPacketSize() {
     return -1;
 }
 
+QString USBDevice::getIdentity() const {
+    if (!device) return QString();
+    const QString model = QString::fromStdString(this->model.name);
+
+    // Most devices don't have a serial number, the port identifies them as long as they aren't moved
+    if (handle && descriptor.iSerialNumber) {
+        unsigned char serial[256];
+        const int length = libusb_get_string_descriptor_ascii(handle, descriptor.iSerialNumber, serial, sizeof(serial));
+        if (length > 0) return QString("%1_serial_%2").arg(model, QString::fromLatin1((const char *)serial, length));
+    }
+    uint8_t ports[8];
+    const int portCount = libusb_get_port_numbers(device, ports, sizeof(ports));
+    QStringList path;
+    for (int port = 0; port < portCount; ++port) path << QString::number(ports[port]);
+    return QString("%1_port_%2-%3").arg(model).arg(libusb_get_bus_number(device)).arg(path.join('.'));
+}
+
 /// \brief Get the oscilloscope model.
 /// \return The ::Model of the connected Hantek DSO.
 int USBDevice::getUniqueModelID() { return model.uniqueModelID; }
@@ -284,4 +621,10 @@ const DSOModel &USBDevice::getModel() const { return model; }
 
 void USBDevice::setEnableBulkTransfer(bool enable) { allowBulkTransfer = enable; }
 
+void USBDevice::setEnableAsyncTransfer(bool enable) { allowAsyncTransfer = enable; }
+
+void USBDevice::setTransferConfiguration(const USBTransferConfiguration &configuration) {
+    transferConfiguration = configuration;
+}
+
 void USBDevice::overwriteInPacketLength(int len) { inPacketLength = len; }
@@ -6,30 +6,60 @@
 #include <QStringList>
 #include <libusb-1.0/libusb.h>
 #include <memory>
+#include <vector>
 
 #include "controlbegin.h"
 #include "definitions.h"
 #include "models.h"
 #include "utils/dataarray.h"
 
-#define HANTEK_TIMEOUT 500       ///< Timeout for USB transfers in ms
-#define HANTEK_TIMEOUT_MULTI 100 ///< Timeout for multi packet USB transfers in ms
-#define HANTEK_ATTEMPTS 3        ///< The number of transfer attempts
-#define HANTEK_ATTEMPTS_MULTI 1  ///< The number of multi packet transfer attempts
+#define HANTEK_TIMEOUT 500                 ///< Timeout for USB transfers in ms
+#define HANTEK_TIMEOUT_MULTI 100           ///< Timeout for multi packet USB transfers in ms
+#define HANTEK_ATTEMPTS 3                  ///< The number of transfer attempts
+#define HANTEK_ATTEMPTS_MULTI 1            ///< The number of multi packet transfer attempts
+#define HANTEK_ASYNC_TRANSFERS 4           ///< The number of asynchronous bulk transfers kept in flight
+#define HANTEK_ASYNC_TRANSFER_SIZE 16384   ///< The maximum size of one asynchronous bulk transfer in bytes
+#define HANTEK_STREAM_TRANSFERS 32         ///< The number of transfers kept in flight while streaming
+#define HANTEK_STREAM_TRANSFER_SIZE 65536  ///< The size of one transfer while streaming in bytes
+#define HANTEK_STREAM_BUFFER_MAX 0x4000000 ///< The maximum size of the streaming ring buffer in bytes
+#define HANTEK_STREAM_HANDOFF_WAIT 1000    ///< The longest wait for the analysis to take a streamed frame in ms
+#define HANTEK_EVENT_WAIT_MAX 2            ///< Shorter delays are waited by handling usb events, in ms
+
+class USBStream;
+
+/// \brief A vendor control write that is sent as part of a batch.
+struct USBControlWrite {
+    unsigned char request;           ///< The request field of the packet
+    std::vector<unsigned char> data; ///< The payload of the packet
+    int result = LIBUSB_SUCCESS;     ///< Number of sent bytes on success, libusb error code on error
+};
+
+/// \brief The size and number of the bulk transfers kept in flight by the asynchronous reads.
+struct USBTransferConfiguration {
+    unsigned transferSize = HANTEK_ASYNC_TRANSFER_SIZE; ///< The maximum size of one transfer in bytes
+    unsigned transferCount = HANTEK_ASYNC_TRANSFERS;    ///< The number of transfers kept in flight
+};
 
 /// \brief This class handles the USB communication with an usb device that has
-/// one in and one out endpoint.
+/// one in and one out endpoint. The transfers used by HantekDsoControl are
+/// virtual, so SimulatedDevice can replace the hardware.
 class USBDevice : public QObject {
     Q_OBJECT
 
   public:
-    USBDevice(DSOModel model, libusb_device *device);
+    USBDevice(DSOModel model, libusb_device *device, libusb_context *context = nullptr);
     ~USBDevice();
-    bool connectDevice(QString &errorMessage);
+    virtual bool connectDevice(QString &errorMessage);
+
+    /// \brief Replaces the usb device by a reappeared one of the same model and connects to it.
+    /// \param newDevice The device that was found again, it has to carry the firmware already.
+    /// \param errorMessage Set to the reason, if the connection fails.
+    /// \return true, if the connection is up.
+    virtual bool reattach(libusb_device *newDevice, QString &errorMessage);
 
     /// \brief Check if the oscilloscope is connected.
     /// \return true, if a connection is up.
-    bool isConnected();
+    virtual bool isConnected();
     bool needsFirmware();
 
     // Various methods to handle USB transfers
@@ -45,28 +75,58 @@ class USBDevice : public QObject {
     int bulkTransfer(unsigned char endpoint, unsigned char *data, unsigned int length, int attempts = HANTEK_ATTEMPTS,
                      unsigned int timeout = HANTEK_TIMEOUT);
     int bulkWrite(unsigned char *data, unsigned int length, int attempts = HANTEK_ATTEMPTS);
-    int bulkRead(unsigned char *data, unsigned int length, int attempts = HANTEK_ATTEMPTS);
-
-    int bulkCommand(DataArray<unsigned char> *command, int attempts = HANTEK_ATTEMPTS);
-    int bulkReadMulti(unsigned char *data, unsigned length, int attempts = HANTEK_ATTEMPTS_MULTI);
+    virtual int bulkRead(unsigned char *data, unsigned int length, int attempts = HANTEK_ATTEMPTS);
+
+    virtual int bulkCommand(DataArray<unsigned char> *command, int attempts = HANTEK_ATTEMPTS);
+    virtual int bulkReadMulti(unsigned char *data, unsigned length, int attempts = HANTEK_ATTEMPTS_MULTI);
+    int bulkReadMultiAsync(unsigned char *data, unsigned length, int attempts = HANTEK_ATTEMPTS_MULTI);
+
+    /// \brief Starts reading the IN endpoint continuously into a ring buffer.
+    /// \param transferSize The size of one transfer in bytes.
+    /// \param transferCount The number of transfers kept in flight.
+    /// \param bufferSize The capacity of the ring buffer in bytes.
+    /// \param alignment The bytes of one sample of all channels, an overflow drops whole samples.
+    /// \return LIBUSB_SUCCESS on success, libusb error code on error.
+    virtual int startStreaming(unsigned transferSize, unsigned transferCount, unsigned bufferSize,
+                               unsigned alignment);
+    virtual void stopStreaming();
+    virtual bool isStreaming() const;
+    virtual int readStream(unsigned char *data, unsigned length, unsigned timeout = HANTEK_TIMEOUT);
+    virtual unsigned getStreamAvailable() const;
+    virtual unsigned long long getStreamDroppedBytes() const;
+    virtual int waitForEvents(unsigned timeout);
 
     int controlTransfer(unsigned char type, unsigned char request, unsigned char *data, unsigned int length, int value,
                         int index, int attempts = HANTEK_ATTEMPTS);
     int controlWrite(unsigned char request, unsigned char *data, unsigned int length, int value = 0, int index = 0,
                      int attempts = HANTEK_ATTEMPTS);
-    int controlRead(unsigned char request, unsigned char *data, unsigned int length, int value = 0, int index = 0,
-                    int attempts = HANTEK_ATTEMPTS);
+    virtual int controlWriteBatch(std::vector<USBControlWrite> &writes);
+    virtual int controlRead(unsigned char request, unsigned char *data, unsigned int length, int value = 0,
+                            int index = 0, int attempts = HANTEK_ATTEMPTS);
 
     int getConnectionSpeed();
     int getPacketSize();
     int getUniqueModelID();
+    /// \return The key of this device in caches, its serial number or the port it is connected to.
+    /// Empty, if the device isn't connected to usb.
+    QString getIdentity() const;
 
     libusb_device *getRawDevice() const;
     const DSOModel &getModel() const;
     void setEnableBulkTransfer(bool enable);
+    void setEnableAsyncTransfer(bool enable);
+    bool isAsyncTransferEnabled() const { return allowAsyncTransfer; }
+    /// \brief Sets the transfers of the asynchronous reads, see TransferCalibration.
+    void setTransferConfiguration(const USBTransferConfiguration &configuration);
+    const USBTransferConfiguration &getTransferConfiguration() const { return transferConfiguration; }
     void overwriteInPacketLength(int len);
+    int getInPacketLength() const { return inPacketLength; }
 
   protected:
+    /// \brief Creates a device without usb hardware, the transfers have to be implemented by the subclass.
+    /// \param model The model the device identifies as.
+    explicit USBDevice(DSOModel model);
+
     int claimInterface(const libusb_interface_descriptor *interfaceDescriptor, int endpointOut, int endPointIn);
     void connectionLost();
 
@@ -76,12 +136,16 @@ class USBDevice : public QObject {
 
     // Libusb specific variables
     struct libusb_device_descriptor descriptor;
-    libusb_device *device; ///< The USB handle for the oscilloscope
+    libusb_context *context; ///< The usb context the device belongs to
+    libusb_device *device;   ///< The USB handle for the oscilloscope
     libusb_device_handle *handle = nullptr;
     int interface;
     int outPacketLength; ///< Packet length for the OUT endpoint
     int inPacketLength;  ///< Packet length for the IN endpoint
     bool allowBulkTransfer = true;
+    bool allowAsyncTransfer = false;   ///< bulkReadMulti keeps several transfers in flight
+    USBTransferConfiguration transferConfiguration; ///< The transfers of bulkReadMultiAsync
+    std::unique_ptr<USBStream> stream; ///< The continuous IN stream, if streaming
   signals:
     void deviceDisconnected(); ///< The device has been disconnected
 };
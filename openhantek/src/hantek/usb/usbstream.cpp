@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+#include <cstring>
+
+#include "usbstream.h"
+
+#include "utils/threadscheduling.h"
+
+USBStream::USBStream(libusb_context *context, libusb_device_handle *handle, unsigned char endpoint)
+    : context(context), handle(handle), endpoint(endpoint) {}
+
+USBStream::~USBStream() { stop(); }
+
+int USBStream::start(unsigned transferSize, unsigned transferCount, unsigned bufferSize, unsigned alignment) {
+    if (isRunning()) stop();
+    if (!alignment) alignment = 1;
+    // The ring holds whole samples, so it stays aligned when it wraps around
+    bufferSize = bufferSize / alignment * alignment;
+    if (!transferSize || !transferCount || bufferSize < transferSize) return LIBUSB_ERROR_INVALID_PARAM;
+
+    this->alignment = alignment;
+    buffer.assign(bufferSize, 0);
+    ThreadScheduling::lockBuffer(buffer);
+    bufferStart = 0;
+    bufferFill = 0;
+    dropped = 0;
+    error = LIBUSB_SUCCESS;
+    stopping = false;
+
+    transferData.resize(transferCount);
+    transfers.assign(transferCount, nullptr);
+    for (unsigned index = 0; index < transferCount; ++index) {
+        transferData[index].resize(transferSize);
+        ThreadScheduling::lockBuffer(transferData[index]);
+        transfers[index] = libusb_alloc_transfer(0);
+        if (!transfers[index]) {
+            stop();
+            return LIBUSB_ERROR_NO_MEM;
+        }
+        libusb_fill_bulk_transfer(transfers[index], handle, endpoint, transferData[index].data(), (int)transferSize,
+                                  transferCallback, this, 0);
+
+        int errorCode = libusb_submit_transfer(transfers[index]);
+        if (errorCode < 0) {
+            stop();
+            return errorCode;
+        }
+        ++inFlight;
+    }
+
+    return LIBUSB_SUCCESS;
+}
+
+void USBStream::stop() {
+    stopping = true;
+    for (libusb_transfer *transfer : transfers)
+        if (transfer) libusb_cancel_transfer(transfer);
+
+    // The cancelled transfers have to be reaped before they can be freed
+    while (inFlight > 0)
+        if (handleEvents(100) < 0) break;
+
+    for (libusb_transfer *transfer : transfers)
+        if (transfer) libusb_free_transfer(transfer);
+    transfers.clear();
+    transferData.clear();
+    inFlight = 0;
+    bufferFill = 0;
+}
+
+bool USBStream::isRunning() const { return !transfers.empty() && !stopping; }
+
+int USBStream::read(unsigned char *data, unsigned length, unsigned timeout) {
+    if (length > buffer.size()) return LIBUSB_ERROR_INVALID_PARAM;
+
+    QElapsedTimer timer;
+    timer.start();
+    while (bufferFill < length) {
+        if (error < 0) return error;
+        if (!isRunning()) return LIBUSB_ERROR_NO_DEVICE;
+
+        const qint64 elapsed = timer.elapsed();
+        if (elapsed >= (qint64)timeout) return 0;
+
+        int errorCode = handleEvents(timeout - (unsigned)elapsed);
+        if (errorCode < 0) return errorCode;
+    }
+
+    // Copy the data out of the ring buffer, it may wrap around once
+    const unsigned firstPart = qMin(length, (unsigned)buffer.size() - bufferStart);
+    memcpy(data, buffer.data() + bufferStart, firstPart);
+    memcpy(data + firstPart, buffer.data(), length - firstPart);
+    bufferStart = (bufferStart + length) % buffer.size();
+    bufferFill -= length;
+
+    return length;
+}
+
+int USBStream::poll() {
+    if (error < 0) return error;
+    return handleEvents(0);
+}
+
+unsigned USBStream::available() const { return bufferFill; }
+
+unsigned long long USBStream::droppedBytes() const { return dropped; }
+
+void LIBUSB_CALL USBStream::transferCallback(libusb_transfer *transfer) {
+    static_cast<USBStream *>(transfer->user_data)->transferCompleted(transfer);
+}
+
+void USBStream::transferCompleted(libusb_transfer *transfer) {
+    --inFlight;
+
+    if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
+        const unsigned length = (unsigned)transfer->actual_length;
+        const unsigned capacity = (unsigned)buffer.size();
+
+        // Drop the oldest data if the consumer can't keep up. Only whole samples are dropped, otherwise the
+        // channels of the following samples would be swapped.
+        if (bufferFill + length > capacity) {
+            const unsigned excess = bufferFill + length - capacity;
+            const unsigned overflow = qMin(bufferFill, (excess + alignment - 1) / alignment * alignment);
+            bufferStart = (bufferStart + overflow) % capacity;
+            bufferFill -= overflow;
+            dropped += overflow;
+        }
+
+        const unsigned end = (bufferStart + bufferFill) % capacity;
+        const unsigned firstPart = qMin(length, capacity - end);
+        memcpy(buffer.data() + end, transfer->buffer, firstPart);
+        memcpy(buffer.data(), transfer->buffer + firstPart, length - firstPart);
+        bufferFill += length;
+    } else if (transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+        if (error == LIBUSB_SUCCESS)
+            error = (transfer->status == LIBUSB_TRANSFER_NO_DEVICE) ? LIBUSB_ERROR_NO_DEVICE : LIBUSB_ERROR_IO;
+        stopping = true;
+    }
+
+    if (stopping) return;
+
+    int errorCode = libusb_submit_transfer(transfer);
+    if (errorCode < 0) {
+        if (error == LIBUSB_SUCCESS) error = errorCode;
+        stopping = true;
+        return;
+    }
+    ++inFlight;
+}
+
+int USBStream::handleEvents(unsigned timeout) {
+    struct timeval tv;
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+    int errorCode = libusb_handle_events_timeout_completed(context, &tv, nullptr);
+    if (errorCode == LIBUSB_ERROR_INTERRUPTED) return LIBUSB_SUCCESS;
+    return errorCode;
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <libusb-1.0/libusb.h>
+#include <vector>
+
+/// \brief Continuous bulk IN stream from an usb device.
+/// A ring of transfers is kept submitted all the time, every completed transfer
+/// is copied into a ring buffer and resubmitted immediately. Consumers cut the
+/// data out of the ring buffer in the order it was received, so there are no
+/// gaps between consecutive reads as long as the ring buffer doesn't overflow.
+/// All methods have to be called from the same thread, the transfer callbacks
+/// are only run while read() is handling libusb events.
+class USBStream {
+  public:
+    /// \param context The usb context the device belongs to.
+    /// \param handle The opened device handle.
+    /// \param endpoint The IN endpoint that should be streamed.
+    USBStream(libusb_context *context, libusb_device_handle *handle, unsigned char endpoint);
+    ~USBStream();
+
+    /// \brief Submits the transfers and starts streaming.
+    /// \param transferSize The size of one transfer in bytes.
+    /// \param transferCount The number of transfers kept in flight.
+    /// \param bufferSize The capacity of the ring buffer in bytes.
+    /// \param alignment The bytes of one sample of all channels, overflows drop whole samples.
+    /// \return LIBUSB_SUCCESS on success, libusb error code on error.
+    int start(unsigned transferSize, unsigned transferCount, unsigned bufferSize, unsigned alignment);
+
+    /// \brief Cancels all transfers and waits until they are finished.
+    /// Data that is still in the ring buffer is discarded.
+    void stop();
+
+    /// \brief Check if transfers are submitted.
+    bool isRunning() const;
+
+    /// \brief Reads the next data from the stream.
+    /// \param data Buffer for the received data.
+    /// \param length The number of bytes that should be read.
+    /// \param timeout The maximum time in ms to wait for the data.
+    /// \return length on success, 0 if not enough data arrived within the
+    /// timeout, libusb error code on error.
+    int read(unsigned char *data, unsigned length, unsigned timeout);
+
+    /// \brief Handles pending transfer completions without waiting.
+    /// \return LIBUSB_SUCCESS on success, libusb error code on error.
+    int poll();
+
+    /// \return The number of bytes that can be read without waiting.
+    unsigned available() const;
+
+    /// \return The number of bytes that were dropped because the ring buffer
+    /// was full, since the stream was started.
+    unsigned long long droppedBytes() const;
+
+  private:
+    static void LIBUSB_CALL transferCallback(libusb_transfer *transfer);
+    void transferCompleted(libusb_transfer *transfer);
+    int handleEvents(unsigned timeout);
+
+    libusb_context *context;
+    libusb_device_handle *handle;
+    unsigned char endpoint;
+
+    std::vector<libusb_transfer *> transfers;             ///< The transfers of the ring
+    std::vector<std::vector<unsigned char>> transferData; ///< Buffers of the transfers
+    unsigned inFlight = 0;                                ///< The number of submitted transfers
+    bool stopping = false;                                ///< true, if finished transfers shouldn't be resubmitted
+    int error = LIBUSB_SUCCESS;                           ///< The first error that stopped the stream
+
+    std::vector<unsigned char> buffer; ///< The ring buffer
+    unsigned bufferStart = 0;          ///< Position of the oldest byte in the ring buffer
+    unsigned bufferFill = 0;           ///< Number of bytes in the ring buffer
+    unsigned long long dropped = 0;    ///< Bytes lost due to ring buffer overflows
+    unsigned alignment = 1;            ///< The bytes of one sample of all channels
+};
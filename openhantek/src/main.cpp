@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0+
 
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QDebug>
 #include <QDesktopWidget>
 #include <QLibraryInfo>
@@ -8,48 +9,105 @@
 #include <QLocale>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QStatusBar>
 #include <QTimer>
 #include <QTranslator>
 #include <QVBoxLayout>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 #include <libusb-1.0/libusb.h>
 
+#include "capture/capturereplay.h"
 #include "dataanalyzer.h"
+#include "devicemanager.h"
+#include "framealigner.h"
 #include "hantekdsocontrol.h"
 #include "mainwindow.h"
+#include "replaywindow.h"
 #include "settings.h"
 #include "usb/finddevices.h"
+#include "usb/simulateddevice.h"
 #include "usb/uploadFirmware.h"
 #include "usb/usbdevice.h"
+#include "utils/frametrace.h"
+#include "utils/schedulingoptions.h"
 
 using namespace Hantek;
 
+namespace {
+static const int FIRMWARE_TIMEOUT = 10000; ///< The maximal wait for the restart of the devices after the upload in ms
+}
+
+/// \brief The objects that belong to one connected device.
+struct DeviceSession {
+    DeviceSession(std::unique_ptr<USBDevice> usbDevice, unsigned index)
+        : device(std::move(usbDevice)), dsoControl(device.get()),
+          settings(index ? QString("device%1").arg(index + 1) : QString()) {}
+
+    std::unique_ptr<USBDevice> device;
+    QThread dsoControlThread;
+    HantekDsoControl dsoControl;
+    DataAnalyzer dataAnalyser;
+    DsoSettings settings;
+    OpenHantekMainWindow *mainWindow = nullptr;
+};
+
 void showMessage(const QString &message) {
     QMessageBox::information(nullptr, QCoreApplication::translate("", "No connection established!"), message);
 }
 
-/// \brief Initialize resources and translations and show the main window.
-int main(int argc, char *argv[]) {
-    //////// Set application information ////////
-    QCoreApplication::setOrganizationName("OpenHantek");
-    QCoreApplication::setOrganizationDomain("www.openhantek.org");
-    QCoreApplication::setApplicationName("OpenHantek");
-    QCoreApplication::setApplicationVersion(VERSION);
+/// \brief Shows the frames of a capture file instead of a device.
+/// \param application The application, it is executed until the window is closed.
+/// \param fileName The name of the capture file.
+/// \return The exit code of the application.
+int replayCapture(QApplication &application, const QString &fileName) {
+    CaptureReplay replay;
+    if (!replay.open(fileName)) {
+        QMessageBox::critical(nullptr, QCoreApplication::translate("", "Replay"),
+                              QCoreApplication::translate("", "Can't open the capture file %1: %2")
+                                  .arg(fileName, replay.getFile().errorString()));
+        return -1;
+    }
 
-    QApplication openHantekApplication(argc, argv);
+    // The settings of the device are only used for the display and not saved
+    DsoSettings settings;
+    settings.setChannelCount(replay.getFile().channelCount());
+    ReplayWindow::applyCaptureSettings(&replay, &settings);
 
-    //////// Load translations ////////
-    QTranslator qtTranslator;
-    if (qtTranslator.load("qt_" + QLocale::system().name(), QLibraryInfo::location(QLibraryInfo::TranslationsPath)))
-        openHantekApplication.installTranslator(&qtTranslator);
+    QThread dataAnalyzerThread;
+    dataAnalyzerThread.setObjectName("dataAnalyzerThread");
+    DataAnalyzer dataAnalyser;
+    dataAnalyser.setSourceData(&replay.getSampleBuffer());
+    dataAnalyser.applySettings(&settings.scope);
+    dataAnalyser.moveToThread(&dataAnalyzerThread);
 
-    QTranslator openHantekTranslator;
-    if (openHantekTranslator.load(QLocale(), QLatin1String("openhantek"), QLatin1String("_"),
-                                  QLatin1String(":/translations"))) {
-        openHantekApplication.installTranslator(&openHantekTranslator);
-    }
+    QThread replayThread;
+    replayThread.setObjectName("replayThread");
+    replay.moveToThread(&replayThread);
+    QObject::connect(&replay, &CaptureReplay::samplesAvailable, &dataAnalyser, &DataAnalyzer::samplesAvailable);
+
+    ReplayWindow *replayWindow = new ReplayWindow(&replay, &dataAnalyser, &settings);
+    replayWindow->show();
+
+    dataAnalyzerThread.start();
+    replayThread.start();
+    QMetaObject::invokeMethod(&replay, "seek", Qt::QueuedConnection, Q_ARG(unsigned, 0));
+    int res = application.exec();
+
+    replayThread.quit();
+    replayThread.wait(10000);
+    dataAnalyzerThread.quit();
+    dataAnalyzerThread.wait(10000);
+    return res;
+}
+
+/// \brief Finds the connected devices, uploads their firmware and lets the user select them.
+/// \param application The application, it is executed while the selection dialog is shown.
+/// \return The selected and connected devices, empty if no device is ready. The reason was shown to the user.
+std::vector<std::unique_ptr<USBDevice>> selectDevices(QApplication &application) {
+    std::vector<std::unique_ptr<USBDevice>> selectedDevices;
 
     //////// Find matching usb devices ////////
     libusb_context *context;
@@ -57,7 +115,7 @@ int main(int argc, char *argv[]) {
 
     if (error) {
         showMessage(QCoreApplication::translate("", "Can't initalize USB: %1").arg(libUsbErrorString(error)));
-        return -1;
+        return selectedDevices;
     }
 
     FindDevices findDevices;
@@ -71,24 +129,28 @@ int main(int argc, char *argv[]) {
                                                     "href='https://github.com/OpenHantek/openhantek/"
                                                     "'>website</a> for help: %1")
                         .arg(findDevices.getErrorMessage()));
-        return -1;
+        return selectedDevices;
     }
 
-    //////// Upload firmwares for all connected devices ////////
+    //////// Upload firmwares for all connected devices in parallel and wait for their restart ////////
+    unsigned withFirmware = 0;
     for (const auto &i : devices) {
-        QString modelName = QString::fromStdString(i->getModel().name);
-        if (i->needsFirmware()) {
-            UploadFirmware uf;
-            uf.startUpload(i.get());
-        }
+        if (!i->needsFirmware()) ++withFirmware;
     }
+    QStringList uploadErrors;
+    const unsigned uploaded = UploadFirmware::uploadAll(devices, uploadErrors);
+    for (const QString &message : uploadErrors) qWarning().noquote() << message;
     devices.clear();
+    if (uploaded && !findDevices.waitForDevices(withFirmware + uploaded, FIRMWARE_TIMEOUT))
+        qWarning().noquote() << QCoreApplication::translate("", "Not all devices restarted after the firmware upload");
 
-    //////// Select device - Autoselect if only one device is ready ////////
+    //////// Select devices - Autoselect if only one device is ready ////////
     std::unique_ptr<QDialog> dialog = std::unique_ptr<QDialog>(new QDialog);
     QListWidget *w = new QListWidget(dialog.get());
+    w->setSelectionMode(QAbstractItemView::MultiSelection);
 
     devices = findDevices.findDevices();
+    int readyDevices = 0;
     for (auto &i : devices) {
         QString modelName = QString::fromStdString(i->getModel().name);
 
@@ -100,7 +162,8 @@ int main(int argc, char *argv[]) {
         QString errorMessage;
         if (i->connectDevice(errorMessage)) {
             w->addItem(QCoreApplication::translate("Firmware upload dialog", "%1: Ready").arg(modelName));
-            w->setCurrentRow(w->count() - 1);
+            w->item(w->count() - 1)->setSelected(true);
+            ++readyDevices;
         } else {
             w->addItem(QCoreApplication::translate("Firmware upload dialog", "%1: %2")
                            .arg(modelName)
@@ -108,8 +171,9 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    if (w->currentRow() == -1 || devices.size() > 1) {
-        QPushButton *btn = new QPushButton(QCoreApplication::translate("", "Connect to first device"), dialog.get());
+    if (readyDevices == 0 || devices.size() > 1) {
+        QPushButton *btn =
+            new QPushButton(QCoreApplication::translate("", "Connect to selected devices"), dialog.get());
         dialog->move(QApplication::desktop()->screen()->rect().center() - w->rect().center());
         dialog->setWindowTitle(QCoreApplication::translate("", "Firmware upload"));
         dialog->setLayout(new QVBoxLayout());
@@ -117,70 +181,215 @@ int main(int argc, char *argv[]) {
         dialog->layout()->addWidget(btn);
         btn->connect(btn, &QPushButton::clicked, QCoreApplication::instance(), &QCoreApplication::quit);
         dialog->show();
-        openHantekApplication.exec();
+        application.exec();
         dialog->close();
     }
-    int selectedDevice = w->currentRow();
-    dialog.reset(nullptr);
 
-    std::unique_ptr<USBDevice> device;
+    // The list contains one entry per found device
     int indexCounter = 0;
     for (auto &i : devices) {
-        if (indexCounter == selectedDevice) {
-            device = std::move(i);
-            break;
-        }
+        if (w->item(indexCounter++)->isSelected() && !i->needsFirmware() && i->isConnected())
+            selectedDevices.push_back(std::move(i));
     }
+    dialog.reset(nullptr);
     devices.clear();
 
-    if (device == nullptr || device->needsFirmware() || !device->isConnected()) {
+    if (selectedDevices.empty()) {
         showMessage(QCoreApplication::translate("", "A device was found, but the "
                                                     "firmware upload seem to have "
                                                     "failed or the connection "
                                                     "could not be established: %1")
                         .arg(findDevices.getErrorMessage()));
-        return -1;
+    }
+    return selectedDevices;
+}
+
+/// \brief Initialize resources and translations and show the main window.
+int main(int argc, char *argv[]) {
+    //////// Set application information ////////
+    QCoreApplication::setOrganizationName("OpenHantek");
+    QCoreApplication::setOrganizationDomain("www.openhantek.org");
+    QCoreApplication::setApplicationName("OpenHantek");
+    QCoreApplication::setApplicationVersion(VERSION);
+
+    // The scope views draw the same textures and buffers
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+    QApplication openHantekApplication(argc, argv);
+
+    //////// Parse command line ////////
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption alignOption("align-frames",
+                                   QCoreApplication::translate("main", "Align the frames of all connected devices "
+                                                                       "by their timestamps, within <ms>."),
+                                   "ms");
+    parser.addOption(alignOption);
+    QCommandLineOption replayOption("replay",
+                                    QCoreApplication::translate("main", "Show the frames of the capture <file> "
+                                                                        "instead of a device."),
+                                    "file");
+    parser.addOption(replayOption);
+    QCommandLineOption simulateOption("simulate",
+                                      QCoreApplication::translate("main", "Use a simulated <device> instead of usb "
+                                                                          "devices: %1")
+                                          .arg(SimulatedDevice::descriptionHelp()),
+                                      "device");
+    parser.addOption(simulateOption);
+    QCommandLineOption traceOption("trace",
+                                   QCoreApplication::translate("main", "Trace the pipeline stages of every frame and "
+                                                                       "write them as Chrome trace JSON to <file> "
+                                                                       "on exit."),
+                                   "file");
+    parser.addOption(traceOption);
+    SchedulingOptions schedulingOptions(parser);
+    parser.process(openHantekApplication);
+    if (parser.isSet(traceOption)) FrameTrace::start();
+    const double alignTolerance = parser.value(alignOption).toDouble();
+
+    //////// Parse the scheduling of the threads ////////
+    {
+        QString errorMessage;
+        if (!schedulingOptions.parse(errorMessage)) {
+            showMessage(errorMessage);
+            return -1;
+        }
     }
 
-    //////// Create DSO control object and move it to a separate thread ////////
-    QThread dsoControlThread;
-    dsoControlThread.setObjectName("dsoControlThread");
-    HantekDsoControl dsoControl(device.get());
-    dsoControl.moveToThread(&dsoControlThread);
-    QObject::connect(&dsoControlThread, &QThread::started, &dsoControl, &HantekDsoControl::run);
-    QObject::connect(&dsoControl, &HantekDsoControl::communicationError, QCoreApplication::instance(),
-                     &QCoreApplication::quit);
-    QObject::connect(device.get(), &USBDevice::deviceDisconnected, QCoreApplication::instance(),
-                     &QCoreApplication::quit);
-
-    //////// Create data analyser object ////////
+    //////// Load translations ////////
+    QTranslator qtTranslator;
+    if (qtTranslator.load("qt_" + QLocale::system().name(), QLibraryInfo::location(QLibraryInfo::TranslationsPath)))
+        openHantekApplication.installTranslator(&qtTranslator);
+
+    QTranslator openHantekTranslator;
+    if (openHantekTranslator.load(QLocale(), QLatin1String("openhantek"), QLatin1String("_"),
+                                  QLatin1String(":/translations"))) {
+        openHantekApplication.installTranslator(&openHantekTranslator);
+    }
+
+    //////// Replay a capture file, no device is needed ////////
+    if (parser.isSet(replayOption)) return replayCapture(openHantekApplication, parser.value(replayOption));
+
+    //////// Select the devices, a simulated device doesn't need usb ////////
+    std::vector<std::unique_ptr<USBDevice>> selectedDevices;
+    if (parser.isSet(simulateOption)) {
+        QString errorMessage;
+        std::unique_ptr<SimulatedDevice> simulated =
+            SimulatedDevice::create(parser.value(simulateOption), errorMessage);
+        if (!simulated || !simulated->connectDevice(errorMessage)) {
+            showMessage(errorMessage);
+            return -1;
+        }
+        selectedDevices.push_back(std::move(simulated));
+    } else {
+        selectedDevices = selectDevices(openHantekApplication);
+        if (selectedDevices.empty()) return -1;
+    }
+
+    //////// Create data analyser thread, it is shared by all devices ////////
     QThread dataAnalyzerThread;
     dataAnalyzerThread.setObjectName("dataAnalyzerThread");
-    DataAnalyzer dataAnalyser;
-    dataAnalyser.setSourceData(&dsoControl.getLastSamples());
-    dataAnalyser.moveToThread(&dataAnalyzerThread);
-    QObject::connect(&dsoControl, &HantekDsoControl::samplesAvailable, &dataAnalyser, &DataAnalyzer::samplesAvailable);
+    schedulingOptions.analysis.applyOnStart(&dataAnalyzerThread);
 
-    //////// Create settings object ////////
-    DsoSettings settings;
-    settings.setChannelCount(dsoControl.getChannelCount());
-    dataAnalyser.applySettings(&settings.scope);
+    // Optionally release the frames of all devices only together
+    std::unique_ptr<FrameAligner> frameAligner;
+    if (alignTolerance > 0 && selectedDevices.size() > 1) {
+        frameAligner = std::unique_ptr<FrameAligner>(new FrameAligner(alignTolerance));
+        frameAligner->moveToThread(&dataAnalyzerThread);
+    }
+
+    //////// Create the objects of every device ////////
+    std::vector<std::unique_ptr<DeviceSession>> sessions;
+    for (auto &device : selectedDevices) {
+        const unsigned index = (unsigned)sessions.size();
+        DeviceSession *session = new DeviceSession(std::move(device), index);
+        sessions.push_back(std::unique_ptr<DeviceSession>(session));
+
+        // Create DSO control object and move it to a separate thread
+        session->dsoControlThread.setObjectName(QString("dsoControlThread%1").arg(index));
+        session->dsoControl.moveToThread(&session->dsoControlThread);
+        schedulingOptions.usb.applyOnStart(&session->dsoControlThread);
+        QObject::connect(&session->dsoControlThread, &QThread::started, &session->dsoControl,
+                         &HantekDsoControl::run);
+
+        // Create data analyser object
+        session->dataAnalyser.setSourceData(&session->dsoControl.getSampleBuffer());
+        session->dataAnalyser.moveToThread(&dataAnalyzerThread);
+        session->dataAnalyser.setWorkerScheduling(schedulingOptions.analysis);
+        if (frameAligner) {
+            const unsigned source = frameAligner->addSource(&session->dsoControl.getSampleBuffer());
+            FrameAligner *aligner = frameAligner.get();
+            DataAnalyzer *dataAnalyser = &session->dataAnalyser;
+            QObject::connect(&session->dsoControl, &HantekDsoControl::samplesAvailable, aligner,
+                             [aligner, source]() { aligner->samplesAvailable(source); });
+            QObject::connect(aligner, &FrameAligner::frameReleased, dataAnalyser,
+                             [dataAnalyser, source](unsigned released) {
+                                 if (released == source) dataAnalyser->samplesAvailable();
+                             });
+        } else {
+            QObject::connect(&session->dsoControl, &HantekDsoControl::samplesAvailable, &session->dataAnalyser,
+                             &DataAnalyzer::samplesAvailable);
+        }
 
-    //////// Create main window ////////
-    OpenHantekMainWindow *openHantekMainWindow = new OpenHantekMainWindow(&dsoControl, &dataAnalyser, &settings);
-    openHantekMainWindow->show();
+        // Create settings object, every additional device has its own profile
+        session->settings.setChannelCount(session->dsoControl.getChannelCount());
+        session->dataAnalyser.applySettings(&session->settings.scope);
+
+        // Create main window, it stays open while its device is disconnected
+        session->mainWindow =
+            new OpenHantekMainWindow(&session->dsoControl, &session->dataAnalyser, &session->settings);
+        session->mainWindow->show();
+    }
+
+    //////// Reconnect lost devices, the simulated device can't get lost ////////
+    DeviceManager deviceManager;
+    if (!parser.isSet(simulateOption)) {
+        for (auto &session : sessions) {
+            deviceManager.watch(session->device.get(), &session->dsoControl);
+            USBDevice *device = session->device.get();
+            OpenHantekMainWindow *mainWindow = session->mainWindow;
+            QObject::connect(&deviceManager, &DeviceManager::deviceLost, mainWindow,
+                             [device, mainWindow](USBDevice *lost) {
+                                 if (lost == device)
+                                     mainWindow->statusBar()->showMessage(QCoreApplication::translate(
+                                         "", "Device disconnected, waiting for it to reconnect"));
+                             });
+            QObject::connect(&deviceManager, &DeviceManager::deviceReconnected, mainWindow,
+                             [device, mainWindow](USBDevice *reconnected) {
+                                 if (reconnected == device)
+                                     mainWindow->statusBar()->showMessage(
+                                         QCoreApplication::translate("", "Device reconnected"), 3000);
+                             });
+        }
+    }
 
-    //////// Start DSO thread and go into GUI main loop
-    dsoControl.startSampling();
+    //////// Keep the buffers in ram, a page fault could delay a usb read ////////
+    schedulingOptions.lockMemory();
+
+    //////// Start DSO threads and go into GUI main loop
     dataAnalyzerThread.start();
-    dsoControlThread.start();
+    for (auto &session : sessions) {
+        session->dsoControl.startSampling();
+        session->dsoControlThread.start();
+    }
     int res = openHantekApplication.exec();
 
     //////// Clean up ////////
-    dsoControlThread.quit();
-    dsoControlThread.wait(10000);
+    for (auto &session : sessions) {
+        session->dsoControlThread.quit();
+        session->dsoControlThread.wait(10000);
+    }
 
     dataAnalyzerThread.quit();
     dataAnalyzerThread.wait(10000);
+
+    //////// Write the trace after all threads stopped ////////
+    if (parser.isSet(traceOption)) {
+        FrameTrace::stop();
+        QString errorMessage;
+        if (!FrameTrace::write(parser.value(traceOption), errorMessage))
+            qWarning().noquote() << QCoreApplication::translate("", "Can't write the trace to %1: %2")
+                                        .arg(parser.value(traceOption), errorMessage);
+    }
     return res;
 }
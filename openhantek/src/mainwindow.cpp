@@ -1,21 +1,30 @@
 // SPDX-License-Identifier: GPL-2.0+
 
+#include <algorithm>
+
 #include <QAction>
 #include <QActionGroup>
 #include <QApplication>
+#include <QDateTime>
 #include <QDir>
 #include <QFileDialog>
+#include <QInputDialog>
+#include <QLabel>
 #include <QLineEdit>
 #include <QMainWindow>
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QSignalBlocker>
 #include <QStatusBar>
 #include <QToolBar>
 
 #include "mainwindow.h"
 
+#include "DecoderDock.h"
 #include "HorizontalDock.h"
+#include "MaskDock.h"
+#include "ReferenceDock.h"
 #include "SpectrumDock.h"
 #include "TriggerDock.h"
 #include "VoltageDock.h"
@@ -30,6 +39,10 @@
 #include "usb/usbdevice.h"
 #include "viewconstants.h"
 
+namespace {
+const int MAX_PENDING_MASK_EXPORTS = 4; ///< Failed frames are only saved while fewer exports are waiting
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // class OpenHantekMainWindow
 /// \brief Initializes the gui elements of the main window.
@@ -51,10 +64,24 @@ OpenHantekMainWindow::OpenHantekMainWindow(HantekDsoControl *dsoControl, DataAna
 
     // Central oszilloscope widget
     dsoWidget = new DsoWidget(settings);
+    connect(dsoWidget, &DsoWidget::spectrumComputeAvailable, dataAnalyzer, &DataAnalyzer::setSpectrumOffload);
     connect(dataAnalyzer, &DataAnalyzer::analyzed,
-            [this]() { dsoWidget->showNewData(this->dataAnalyzer->getNextResult()); });
+            [this]() {
+                std::shared_ptr<const DataAnalyzerResult> result = this->dataAnalyzer->getNextResult();
+                decoderDock->showAnnotations(result.get());
+                maskTested(result);
+                dsoWidget->showNewData(std::move(result));
+            });
     setCentralWidget(dsoWidget);
 
+    // Performance statistics in the status bar
+    statisticsLabel = new QLabel();
+    statisticsLabel->hide();
+    statusBar()->addPermanentWidget(statisticsLabel);
+    statisticsTimer = new QTimer(this);
+    statisticsTimer->setInterval(1000);
+    connect(statisticsTimer, &QTimer::timeout, this, &OpenHantekMainWindow::updateStatistics);
+
     // Subroutines for window elements
     createActions();
     createToolBars();
@@ -119,6 +146,27 @@ void OpenHantekMainWindow::createActions() {
         settings->save();
     });
 
+    storeSnapshotAction = new QAction(tr("&Store configuration..."), this);
+    storeSnapshotAction->setStatusTip(tr("Store the oscilloscope settings as named configuration"));
+    connect(storeSnapshotAction, &QAction::triggered, [this]() {
+        bool accepted = false;
+        const QString name = QInputDialog::getText(this, tr("Store configuration"), tr("Name of the configuration"),
+                                                   QLineEdit::Normal, QString(), &accepted)
+                                 .trimmed();
+        if (!accepted || name.isEmpty()) return;
+        settings->storeSnapshot(name);
+        statusBar()->showMessage(tr("Stored the configuration %1").arg(name), 3000);
+    });
+
+    removeSnapshotAction = new QAction(tr("&Remove configuration..."), this);
+    removeSnapshotAction->setStatusTip(tr("Remove a stored configuration"));
+    connect(removeSnapshotAction, &QAction::triggered, [this]() {
+        bool accepted = false;
+        const QString name = QInputDialog::getItem(this, tr("Remove configuration"), tr("Configuration"),
+                                                   settings->snapshotNames(), 0, false, &accepted);
+        if (accepted && !name.isEmpty()) settings->removeSnapshot(name);
+    });
+
     printAction = new QAction(QIcon(":actions/print.png"), tr("&Print..."), this);
     printAction->setShortcut(tr("Ctrl+P"));
     printAction->setStatusTip(tr("Print the oscilloscope screen"));
@@ -129,6 +177,33 @@ void OpenHantekMainWindow::createActions() {
     exportAsAction->setStatusTip(tr("Export the oscilloscope data to a file"));
     connect(exportAsAction, &QAction::triggered, dsoWidget, &DsoWidget::exportAs);
 
+    recordAction = new QAction(tr("&Record..."), this);
+    recordAction->setCheckable(true);
+    recordAction->setStatusTip(tr("Stream the raw samples of every frame to a capture file"));
+    connect(recordAction, &QAction::toggled, [this](bool enabled) {
+        CaptureRecorder &recorder = dsoControl->getRecorder();
+        if (!enabled) {
+            recorder.stop();
+            QString message = tr("Recorded %1 frames, dropped %2").arg(recorder.framesRecorded()).arg(
+                recorder.framesDropped());
+            if (!recorder.errorString().isEmpty()) message += tr(" (%1)").arg(recorder.errorString());
+            statusBar()->showMessage(message);
+            return;
+        }
+        QString fileName = QFileDialog::getSaveFileName(this, tr("Record capture"), "", tr("Capture files (*.ohc)"));
+        if (fileName.isEmpty() ||
+            !recorder.start(fileName, QString::fromStdString(dsoControl->getDevice()->getModel().name),
+                            dsoControl->getChannelCount(), settings->scope.compressCaptures)) {
+            if (!fileName.isEmpty())
+                QMessageBox::warning(this, tr("Record capture"),
+                                     tr("Can't record to %1: %2").arg(fileName, recorder.errorString()));
+            QSignalBlocker blocker(recordAction);
+            recordAction->setChecked(false);
+            return;
+        }
+        statusBar()->showMessage(tr("Recording to %1").arg(fileName));
+    });
+
     exitAction = new QAction(tr("E&xit"), this);
     exitAction->setShortcut(tr("Ctrl+Q"));
     exitAction->setStatusTip(tr("Exit the application"));
@@ -141,19 +216,121 @@ void OpenHantekMainWindow::createActions() {
         saveWindowGeometry();
 
         DsoConfigDialog configDialog(settings, this);
-        if (configDialog.exec() == QDialog::Accepted) settingsChanged();
+        if (configDialog.exec() == QDialog::Accepted) {
+            // The storage of the frames belongs to the thread of the device
+            HantekDsoControl *control = dsoControl;
+            const bool compactSamples = settings->scope.compactSamples;
+            const bool losslessCapture = settings->scope.losslessCapture;
+            const unsigned historyMemory = settings->scope.historyMemory;
+            QTimer::singleShot(0, dsoControl, [control, compactSamples, losslessCapture, historyMemory]() {
+                control->setCompactSamples(compactSamples);
+                control->setLosslessCapture(losslessCapture);
+                control->setHistoryMemory(historyMemory);
+            });
+            dataAnalyzer->setMathExpression(settings->scope.mathExpression);
+            settingsChanged();
+        }
     });
 
     startStopAction = new QAction(this);
     startStopAction->setShortcut(tr("Space"));
     stopped();
 
+    streamingAction = new QAction(tr("S&treaming"), this);
+    streamingAction->setCheckable(true);
+    streamingAction->setChecked(settings->scope.horizontal.streaming);
+    streamingAction->setEnabled(dsoControl->isStreamingSupported());
+    streamingAction->setStatusTip(tr("Read the oscilloscope continuously without gaps between the frames"));
+    connect(streamingAction, &QAction::toggled, [this](bool enabled) {
+        this->settings->scope.horizontal.streaming = enabled;
+        HantekDsoControl *control = dsoControl;
+        QTimer::singleShot(0, dsoControl, [control, enabled]() { control->setStreaming(enabled); });
+    });
+
+    segmentedAction = new QAction(tr("Se&gmented acquisition..."), this);
+    segmentedAction->setCheckable(true);
+    segmentedAction->setStatusTip(tr("Capture a number of consecutive triggered frames and browse them afterwards"));
+    connect(segmentedAction, &QAction::toggled, [this](bool enabled) {
+        unsigned count = 0;
+        if (enabled) {
+            bool ok;
+            count = (unsigned)QInputDialog::getInt(this, tr("Segmented acquisition"), tr("Number of segments:"),
+                                                   (int)this->settings->scope.horizontal.segments, 2, 100000, 1, &ok);
+            if (!ok) {
+                segmentedAction->setChecked(false);
+                return;
+            }
+            this->settings->scope.horizontal.segments = count;
+        }
+
+        previousSegmentAction->setEnabled(false);
+        nextSegmentAction->setEnabled(false);
+        if (enabled) statusBar()->showMessage(tr("Capturing %1 segments").arg(count));
+
+        // The acquisition mode is checked and changed on the thread of the device, a refusal is reported back
+        HantekDsoControl *control = dsoControl;
+        QTimer::singleShot(0, dsoControl, [this, control, count]() {
+            if (control->setSegmentedAcquisition(count) == Dso::ErrorCode::ERROR_NONE) {
+                if (count) control->startSampling();
+                return;
+            }
+            QTimer::singleShot(0, this, [this]() {
+                statusBar()->showMessage(
+                    tr("Segmented acquisition is not available in roll mode or while streaming"), 3000);
+                QSignalBlocker blocker(segmentedAction);
+                segmentedAction->setChecked(false);
+            });
+        });
+    });
+
+    previousSegmentAction = new QAction(tr("&Previous segment"), this);
+    previousSegmentAction->setShortcut(tr("PgUp"));
+    previousSegmentAction->setEnabled(false);
+    connect(previousSegmentAction, &QAction::triggered, [this]() { showSegment(currentSegment - 1); });
+
+    nextSegmentAction = new QAction(tr("&Next segment"), this);
+    nextSegmentAction->setShortcut(tr("PgDown"));
+    nextSegmentAction->setEnabled(false);
+    connect(nextSegmentAction, &QAction::triggered, [this]() { showSegment(currentSegment + 1); });
+
+    previousFrameAction = new QAction(tr("Previous frame in the &history"), this);
+    previousFrameAction->setShortcut(tr("Ctrl+PgUp"));
+    previousFrameAction->setEnabled(false);
+    previousFrameAction->setStatusTip(tr("Show an older frame of the history while the oscilloscope is stopped"));
+    connect(previousFrameAction, &QAction::triggered, [this]() { showHistory(currentFrame - 1); });
+
+    nextFrameAction = new QAction(tr("Next frame in the h&istory"), this);
+    nextFrameAction->setShortcut(tr("Ctrl+PgDown"));
+    nextFrameAction->setEnabled(false);
+    nextFrameAction->setStatusTip(tr("Show a newer frame of the history while the oscilloscope is stopped"));
+    connect(nextFrameAction, &QAction::triggered, [this]() { showHistory(currentFrame + 1); });
+
     digitalPhosphorAction = new QAction(QIcon(":actions/digitalphosphor.png"), tr("Digital &phosphor"), this);
     digitalPhosphorAction->setCheckable(true);
     digitalPhosphorAction->setChecked(settings->view.digitalPhosphor);
     digitalPhosphor(settings->view.digitalPhosphor);
     connect(digitalPhosphorAction, &QAction::toggled, this, &OpenHantekMainWindow::digitalPhosphor);
 
+    statisticsAction = new QAction(tr("Performance &statistics"), this);
+    statisticsAction->setCheckable(true);
+    statisticsAction->setStatusTip(tr("Show the frame rates and the time spent in every processing stage"));
+    connect(statisticsAction, &QAction::toggled, [this](bool enabled) {
+        statisticsLabel->setVisible(enabled);
+        if (enabled) {
+            lastStatistics = Instrumentation::totals();
+            statisticsTimer->start();
+        } else
+            statisticsTimer->stop();
+    });
+
+    resetMeasurementsAction = new QAction(tr("&Reset measurement statistics"), this);
+    resetMeasurementsAction->setStatusTip(tr("Restart the statistics of the measurements over the frames"));
+    connect(resetMeasurementsAction, &QAction::triggered, [this]() { this->dataAnalyzer->resetStatistics(); });
+
+    resetSpectrumAction = new QAction(tr("Reset &spectrum averages"), this);
+    resetSpectrumAction->setStatusTip(tr("Restart the averages and holds of the spectra"));
+    connect(resetSpectrumAction, &QAction::triggered, [this]() { this->dataAnalyzer->resetSpectrumAverages(); });
+
     zoomAction = new QAction(QIcon(":actions/zoom.png"), tr("&Zoom"), this);
     zoomAction->setCheckable(true);
     zoomAction->setChecked(settings->view.zoom);
@@ -181,21 +358,29 @@ void OpenHantekMainWindow::createMenus() {
     fileMenu->addAction(openAction);
     fileMenu->addAction(saveAction);
     fileMenu->addAction(saveAsAction);
+    snapshotMenu = fileMenu->addMenu(tr("&Configurations"));
+    connect(snapshotMenu, &QMenu::aboutToShow, this, &OpenHantekMainWindow::updateSnapshotMenu);
+    updateSnapshotMenu();
     fileMenu->addSeparator();
     fileMenu->addAction(printAction);
     fileMenu->addAction(exportAsAction);
+    fileMenu->addAction(recordAction);
     fileMenu->addSeparator();
     fileMenu->addAction(exitAction);
 
     viewMenu = menuBar()->addMenu(tr("&View"));
     viewMenu->addAction(digitalPhosphorAction);
     viewMenu->addAction(zoomAction);
+    viewMenu->addAction(statisticsAction);
     viewMenu->addSeparator();
     dockMenu = viewMenu->addMenu(tr("&Docking windows"));
     dockMenu->addAction(horizontalDock->toggleViewAction());
     dockMenu->addAction(spectrumDock->toggleViewAction());
     dockMenu->addAction(triggerDock->toggleViewAction());
     dockMenu->addAction(voltageDock->toggleViewAction());
+    dockMenu->addAction(decoderDock->toggleViewAction());
+    dockMenu->addAction(maskDock->toggleViewAction());
+    dockMenu->addAction(referenceDock->toggleViewAction());
     toolbarMenu = viewMenu->addMenu(tr("&Toolbars"));
     toolbarMenu->addAction(fileToolBar->toggleViewAction());
     toolbarMenu->addAction(oscilloscopeToolBar->toggleViewAction());
@@ -205,6 +390,16 @@ void OpenHantekMainWindow::createMenus() {
     oscilloscopeMenu->addAction(configAction);
     oscilloscopeMenu->addSeparator();
     oscilloscopeMenu->addAction(startStopAction);
+    oscilloscopeMenu->addAction(streamingAction);
+    oscilloscopeMenu->addAction(resetMeasurementsAction);
+    oscilloscopeMenu->addAction(resetSpectrumAction);
+    oscilloscopeMenu->addSeparator();
+    oscilloscopeMenu->addAction(segmentedAction);
+    oscilloscopeMenu->addAction(previousSegmentAction);
+    oscilloscopeMenu->addAction(nextSegmentAction);
+    oscilloscopeMenu->addSeparator();
+    oscilloscopeMenu->addAction(previousFrameAction);
+    oscilloscopeMenu->addAction(nextFrameAction);
 
     menuBar()->addSeparator();
 
@@ -278,6 +473,9 @@ void OpenHantekMainWindow::createDockWindows() {
     triggerDock = new TriggerDock(settings, dsoControl->getSpecialTriggerSources(), this);
     spectrumDock = new SpectrumDock(settings, this);
     voltageDock = new VoltageDock(settings, this);
+    decoderDock = new DecoderDock(settings, this);
+    maskDock = new MaskDock(settings, this);
+    referenceDock = new ReferenceDock(settings, this);
 }
 
 /// \brief Connect general signals and device management signals.
@@ -286,11 +484,26 @@ void OpenHantekMainWindow::connectSignals() {
     connect(this, &OpenHantekMainWindow::settingsChanged, this, &OpenHantekMainWindow::applySettings);
     connect(dsoControl, &HantekDsoControl::statusMessage, statusBar(), &QStatusBar::showMessage);
 
+    // Exports run in the background, their state is shown in the status bar
+    ExportQueue *exportQueue = &dsoWidget->getExportQueue();
+    connect(exportQueue, &ExportQueue::exportStarted, this,
+            [this](const QString &name) { statusBar()->showMessage(tr("Exporting to %1...").arg(name)); });
+    connect(exportQueue, &ExportQueue::exportProgress, this, [this](const QString &name, int percent) {
+        statusBar()->showMessage(tr("Exporting to %1... %2%").arg(name).arg(percent));
+    });
+    connect(exportQueue, &ExportQueue::exportFinished, this, [this](const QString &name, bool success) {
+        statusBar()->showMessage(success ? tr("Exported to %1").arg(name) : tr("The export to %1 failed").arg(name),
+                                 5000);
+    });
+
     // Connect signals to DSO controller and widget
     connect(horizontalDock, &HorizontalDock::samplerateChanged, this, &OpenHantekMainWindow::samplerateSelected);
     connect(horizontalDock, &HorizontalDock::timebaseChanged, this, &OpenHantekMainWindow::timebaseSelected);
     connect(horizontalDock, &HorizontalDock::frequencybaseChanged, dsoWidget, &DsoWidget::updateFrequencybase);
     connect(horizontalDock, &HorizontalDock::recordLengthChanged, this, &OpenHantekMainWindow::recordLengthSelected);
+    // The codes are processed on the thread of the device, the queued connection hands the mode over
+    connect(horizontalDock, &HorizontalDock::acquisitionModeChanged, dsoControl,
+            &HantekDsoControl::setAcquisitionMode);
     // connect(horizontalDock, SIGNAL(formatChanged(HorizontalFormat)),
     // dsoWidget, SLOT(horizontalFormatChanged(HorizontalFormat)));
 
@@ -316,9 +529,48 @@ void OpenHantekMainWindow::connectSignals() {
     connect(spectrumDock, &SpectrumDock::usedChanged, dsoWidget, &DsoWidget::updateSpectrumUsed);
     connect(spectrumDock, &SpectrumDock::magnitudeChanged, dsoWidget, &DsoWidget::updateSpectrumMagnitude);
 
+    connect(maskDock, &MaskDock::maskChanged, [this]() { dataAnalyzer->setMask(settings->scope.mask.polygons); });
+    connect(maskDock, &MaskDock::createRequested, [this]() {
+        dataAnalyzer->createMask(settings->scope.mask.xTolerance, settings->scope.mask.yTolerance);
+    });
+    connect(maskDock, &MaskDock::countersReset, [this]() { dataAnalyzer->resetMaskCounters(); });
+
+    ReferenceWaveforms *references = &dsoWidget->getReferences();
+    connect(referenceDock, &ReferenceDock::storeRequested, [this](unsigned int slot, unsigned int channel) {
+        if (!dsoWidget->storeReference(slot, channel))
+            statusBar()->showMessage(tr("%1 has no graph to store").arg(settings->scope.voltage[(int)channel].name),
+                                     3000);
+    });
+    connect(referenceDock, &ReferenceDock::loaded, references,
+            [references](unsigned int slot, std::shared_ptr<const ReferenceWaveform> waveform) {
+                references->set(slot, std::move(waveform));
+            });
+    connect(referenceDock, &ReferenceDock::cleared, references,
+            [references](unsigned int slot) { references->set(slot, nullptr); });
+    connect(references, &ReferenceWaveforms::changed, referenceDock,
+            [this, references](unsigned int slot) { referenceDock->showReference(slot, references->get(slot).get()); });
+
     // Started/stopped signals from oscilloscope
     connect(dsoControl, &HantekDsoControl::samplingStarted, this, &OpenHantekMainWindow::started);
     connect(dsoControl, &HantekDsoControl::samplingStopped, this, &OpenHantekMainWindow::stopped);
+    // The history can be browsed while the oscilloscope is stopped, the newest frame is still shown
+    connect(dsoControl, &HantekDsoControl::samplingStarted, this, [this]() {
+        historyCount = 0;
+        previousFrameAction->setEnabled(false);
+        nextFrameAction->setEnabled(false);
+    });
+    connect(dsoControl, &HantekDsoControl::historyAvailable, this, [this](unsigned count) {
+        historyCount = count;
+        currentFrame = (int)count - 1;
+        previousFrameAction->setEnabled(count > 1);
+        nextFrameAction->setEnabled(count > 1);
+    });
+    connect(dsoControl, &HantekDsoControl::segmentsComplete, this, [this](unsigned count) {
+        segmentCount = count;
+        previousSegmentAction->setEnabled(true);
+        nextSegmentAction->setEnabled(true);
+        showSegment(0);
+    });
 
     connect(dsoControl, &HantekDsoControl::recordTimeChanged, this, &OpenHantekMainWindow::recordTimeChanged);
     connect(dsoControl, &HantekDsoControl::samplerateChanged, this, &OpenHantekMainWindow::samplerateChanged);
@@ -331,31 +583,79 @@ void OpenHantekMainWindow::connectSignals() {
 }
 
 /// \brief Initialize the device with the current settings.
+/// The settings of the device are applied as one batch on its thread, so they are sent in one cycle.
 void OpenHantekMainWindow::applySettingsToDevice() {
-    for (unsigned int channel = 0; channel < settings->scope.physicalChannels; ++channel) {
-        dsoControl->setCoupling(channel, (Dso::Coupling)settings->scope.voltage[channel].misc);
-        updateVoltageGain(channel);
-        updateOffset(channel);
-        dsoControl->setTriggerLevel(channel, settings->scope.voltage[channel].trigger);
+    const DeviceConfiguration configuration = settings->deviceConfiguration(dsoControl->getAvailableRecordLengths());
+    HantekDsoControl *control = dsoControl;
+    QTimer::singleShot(0, dsoControl, [control, configuration]() { control->applyConfiguration(configuration); });
+    if (!settings->scope.horizontal.samplerateSet) dsoWidget->updateTimebase(settings->scope.horizontal.timebase);
+}
+
+/// \brief Shows the settings in the docks and the scopes after they were replaced.
+/// The docks don't send the values back, applySettingsToDevice() does that in one batch.
+void OpenHantekMainWindow::showSettings() {
+    {
+        QSignalBlocker horizontalBlocker(horizontalDock);
+        horizontalDock->setFormat(settings->scope.horizontal.format);
+        horizontalDock->setFrequencybase(settings->scope.horizontal.frequencybase);
+        horizontalDock->setSamplerate(settings->scope.horizontal.samplerate);
+        horizontalDock->setTimebase(settings->scope.horizontal.timebase);
+        horizontalDock->setRecordLength(settings->scope.horizontal.recordLength);
+        horizontalDock->setAcquisitionMode(settings->scope.horizontal.acquisitionMode);
     }
-    updateUsed(settings->scope.physicalChannels);
-    if (settings->scope.horizontal.samplerateSet)
-        samplerateSelected();
-    else
-        timebaseSelected();
-    if (dsoControl->getAvailableRecordLengths().empty())
-        dsoControl->setRecordLength(settings->scope.horizontal.recordLength);
-    else {
-        auto recLenVec = dsoControl->getAvailableRecordLengths();
-        ptrdiff_t index = std::distance(
-            recLenVec.begin(), std::find(recLenVec.begin(), recLenVec.end(), settings->scope.horizontal.recordLength));
-        dsoControl->setRecordLength(index < 0 ? 1 : index);
+    {
+        QSignalBlocker triggerBlocker(triggerDock);
+        triggerDock->setMode(settings->scope.trigger.mode);
+        triggerDock->setSource(settings->scope.trigger.special, settings->scope.trigger.source);
+        triggerDock->setSlope(settings->scope.trigger.slope);
+    }
+    {
+        QSignalBlocker voltageBlocker(voltageDock);
+        QSignalBlocker spectrumBlocker(spectrumDock);
+        for (int channel = 0; channel < settings->scope.voltage.count(); ++channel) {
+            voltageDock->setGain(channel, settings->scope.voltage[channel].gain);
+            if ((unsigned int)channel < settings->scope.physicalChannels)
+                voltageDock->setCoupling(channel, (Dso::Coupling)settings->scope.voltage[channel].misc);
+            else
+                voltageDock->setMode((Dso::MathMode)settings->scope.voltage[channel].misc);
+            voltageDock->setUsed(channel, settings->scope.voltage[channel].used);
+            spectrumDock->setMagnitude(channel, settings->scope.spectrum[channel].magnitude);
+            spectrumDock->setUsed(channel, settings->scope.spectrum[channel].used);
+        }
+        spectrumDock->setZoom(settings->scope.spectrumZoom, settings->scope.spectrumZoomCenter,
+                              settings->scope.spectrumZoomFactor);
+    }
+    dsoWidget->showSettings();
+}
+
+/// \brief Replaces the settings with a stored configuration and applies it.
+/// \param name The name of the configuration.
+void OpenHantekMainWindow::restoreSnapshot(const QString &name) {
+    if (!settings->loadSnapshot(name)) {
+        statusBar()->showMessage(tr("The configuration %1 can't be restored").arg(name), 3000);
+        return;
+    }
+    showSettings();
+    dataAnalyzer->setMask(settings->scope.mask.polygons);
+    dataAnalyzer->setMathExpression(settings->scope.mathExpression);
+    applySettingsToDevice();
+    statusBar()->showMessage(tr("Restored the configuration %1").arg(name), 3000);
+}
+
+/// \brief Lists the stored configurations in the menu.
+void OpenHantekMainWindow::updateSnapshotMenu() {
+    const QStringList names = settings->snapshotNames();
+    snapshotMenu->clear();
+    snapshotMenu->addAction(storeSnapshotAction);
+    snapshotMenu->addAction(removeSnapshotAction);
+    removeSnapshotAction->setEnabled(!names.isEmpty());
+    if (names.isEmpty()) return;
+
+    snapshotMenu->addSeparator();
+    for (const QString &name : names) {
+        QAction *action = snapshotMenu->addAction(name);
+        connect(action, &QAction::triggered, [this, name]() { restoreSnapshot(name); });
     }
-    dsoControl->setTriggerMode(settings->scope.trigger.mode);
-    dsoControl->setPretriggerPosition(settings->scope.trigger.position * settings->scope.horizontal.timebase *
-                                      DIVS_TIME);
-    dsoControl->setTriggerSlope(settings->scope.trigger.slope);
-    dsoControl->setTriggerSource(settings->scope.trigger.special, settings->scope.trigger.source);
 }
 
 /// \brief The oscilloscope started sampling.
@@ -404,6 +704,9 @@ void OpenHantekMainWindow::applySettings() {
     addDockWidget(Qt::RightDockWidgetArea, triggerDock);
     addDockWidget(Qt::RightDockWidgetArea, voltageDock);
     addDockWidget(Qt::RightDockWidgetArea, spectrumDock);
+    addDockWidget(Qt::RightDockWidgetArea, decoderDock);
+    addDockWidget(Qt::RightDockWidgetArea, maskDock);
+    addDockWidget(Qt::RightDockWidgetArea, referenceDock);
 
     addToolBar(fileToolBar);
     addToolBar(oscilloscopeToolBar);
@@ -499,3 +802,76 @@ void OpenHantekMainWindow::updateVoltageGain(unsigned int channel) {
 
     dsoControl->setGain(channel, settings->scope.voltage[channel].gain * DIVS_VOLTAGE);
 }
+
+/// \brief Shows a segment of the segmented acquisition.
+/// \param index The index of the segment, it wraps around at both ends.
+void OpenHantekMainWindow::showSegment(int index) {
+    if (!segmentCount) return;
+
+    currentSegment = (index % (int)segmentCount + (int)segmentCount) % (int)segmentCount;
+    HantekDsoControl *control = dsoControl;
+    const unsigned segment = (unsigned)currentSegment;
+    QTimer::singleShot(0, dsoControl, [control, segment]() { control->showSegment(segment); });
+    statusBar()->showMessage(tr("Segment %1 of %2").arg(currentSegment + 1).arg(segmentCount));
+}
+
+/// \brief Shows a frame of the history after the oscilloscope stopped.
+/// \param index The index of the frame, 0 is the oldest frame, it is limited to the kept frames.
+void OpenHantekMainWindow::showHistory(int index) {
+    const int count = (int)historyCount;
+    if (!count) return;
+
+    currentFrame = std::max(0, std::min(index, count - 1));
+    HantekDsoControl *control = dsoControl;
+    const unsigned frame = (unsigned)currentFrame;
+    QTimer::singleShot(0, dsoControl, [control, frame]() { control->showHistory(frame); });
+    statusBar()->showMessage(tr("Frame %1 of %2 in the history").arg(currentFrame + 1).arg(count));
+}
+
+/// \brief Shows the pipeline activity since the last update in the status bar.
+void OpenHantekMainWindow::updateStatistics() {
+    const Instrumentation::Totals totals = Instrumentation::totals();
+    const Instrumentation::Rates rates = Instrumentation::rates(lastStatistics, totals);
+    lastStatistics = totals;
+
+    statisticsLabel->setText(
+        tr("%1 fps, %2 shown, %3 skipped, %4 dropped, %5 ignored | USB %6 MB/s | "
+           "Read %7 ms, convert %8 ms, analyze %9 ms, generate %10 ms, draw %11 ms")
+            .arg(rates.framesPerSecond, 0, 'f', 1)
+            .arg(rates.displayedPerSecond, 0, 'f', 1)
+            .arg(rates.skipped)
+            .arg(rates.dropped)
+            .arg(rates.ignored)
+            .arg(rates.usbBytesPerSecond / 1e6, 0, 'f', 2)
+            .arg(rates.stageTime[Instrumentation::STAGE_USBREAD], 0, 'f', 2)
+            .arg(rates.stageTime[Instrumentation::STAGE_CONVERT], 0, 'f', 2)
+            .arg(rates.stageTime[Instrumentation::STAGE_ANALYZE], 0, 'f', 2)
+            .arg(rates.stageTime[Instrumentation::STAGE_GENERATE], 0, 'f', 2)
+            .arg(rates.stageTime[Instrumentation::STAGE_DRAW], 0, 'f', 2));
+}
+
+/// \brief Shows the mask test of a frame and stops or saves it, if it failed.
+/// \param result The analyzed frame.
+void OpenHantekMainWindow::maskTested(const std::shared_ptr<const DataAnalyzerResult> &result) {
+    maskDock->showResult(result.get());
+    if (!result || !result->mask().failed) return;
+
+    const DsoSettingsScopeMask &mask = settings->scope.mask;
+    if (mask.saveOnFail) {
+        // Failures can come faster than they are written, the queue is kept short
+        ExportQueue &exportQueue = dsoWidget->getExportQueue();
+        if (exportQueue.pending() < MAX_PENDING_MASK_EXPORTS) {
+            const QDir directory(mask.savePath.isEmpty() ? QDir::homePath() : mask.savePath);
+            const QString time = QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss-zzz");
+            const QString fileName = directory.filePath(QString("mask-fail-%1.csv").arg(time));
+            exportQueue.enqueue(
+                std::unique_ptr<Exporter>(Exporter::createFileExporter(settings, fileName, EXPORT_FORMAT_CSV)), result);
+        } else
+            statusBar()->showMessage(tr("Mask failure not saved, the exports are behind"), 3000);
+    }
+    if (mask.stopOnFail) {
+        QMetaObject::invokeMethod(dsoControl, "stopSampling", Qt::QueuedConnection);
+        statusBar()->showMessage(tr("Stopped after mask failure with %n violating column(s)", "",
+                                    (int)result->mask().violations));
+    }
+}
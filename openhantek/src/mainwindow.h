@@ -6,7 +6,10 @@
 #include <QTimer>
 #include <memory>
 
+#include "utils/instrumentation.h"
+
 class QActionGroup;
+class QLabel;
 class QLineEdit;
 
 class DataAnalyzer;
@@ -17,6 +20,10 @@ class HorizontalDock;
 class TriggerDock;
 class SpectrumDock;
 class VoltageDock;
+class DecoderDock;
+class MaskDock;
+class ReferenceDock;
+class DataAnalyzerResult;
 
 ////////////////////////////////////////////////////////////////////////////////
 /// \class OpenHantekMainWindow                                     openhantek.h
@@ -43,15 +50,26 @@ class OpenHantekMainWindow : public QMainWindow {
     // Device management
     void connectSignals();
     void applySettingsToDevice();
+    void showSettings();
+    void restoreSnapshot(const QString &name);
+    void updateSnapshotMenu();
+    void maskTested(const std::shared_ptr<const DataAnalyzerResult> &result);
 
     // Actions
     QAction *newAction, *openAction, *saveAction, *saveAsAction;
-    QAction *printAction, *exportAsAction;
+    QAction *storeSnapshotAction, *removeSnapshotAction;
+    QAction *printAction, *exportAsAction, *recordAction;
     QAction *exitAction;
 
     QAction *configAction;
     QAction *startStopAction;
+    QAction *streamingAction;
+    QAction *segmentedAction, *previousSegmentAction, *nextSegmentAction;
+    QAction *previousFrameAction, *nextFrameAction;
     QAction *digitalPhosphorAction, *zoomAction;
+    QAction *statisticsAction;
+    QAction *resetMeasurementsAction;
+    QAction *resetSpectrumAction;
 
     QAction *aboutAction;
 
@@ -59,7 +77,7 @@ class OpenHantekMainWindow : public QMainWindow {
     QLineEdit *commandEdit; ///< Only used if DEBUG is on
 
     // Menus
-    QMenu *fileMenu;
+    QMenu *fileMenu, *snapshotMenu;
     QMenu *viewMenu, *dockMenu, *toolbarMenu;
     QMenu *oscilloscopeMenu;
     QMenu *helpMenu;
@@ -72,6 +90,9 @@ class OpenHantekMainWindow : public QMainWindow {
     TriggerDock *triggerDock;
     SpectrumDock *spectrumDock;
     VoltageDock *voltageDock;
+    DecoderDock *decoderDock;
+    MaskDock *maskDock;
+    ReferenceDock *referenceDock;
 
     // Central widgets
     DsoWidget *dsoWidget;
@@ -83,6 +104,19 @@ class OpenHantekMainWindow : public QMainWindow {
     // Settings used for the whole program
     DsoSettings *settings;
 
+    // Segmented acquisition
+    unsigned segmentCount = 0; ///< The number of captured segments
+    int currentSegment = 0;    ///< The segment that is shown
+
+    // History of the last frames
+    unsigned historyCount = 0; ///< The number of frames in the history when the sampling stopped
+    int currentFrame = 0;      ///< The frame of the history that is shown
+
+    // Performance statistics
+    QLabel *statisticsLabel;
+    QTimer *statisticsTimer;
+    Instrumentation::Totals lastStatistics; ///< The counters at the last update
+
   private slots:
     // View
     void digitalPhosphor(bool enabled);
@@ -90,6 +124,9 @@ class OpenHantekMainWindow : public QMainWindow {
     // Oscilloscope control
     void started();
     void stopped();
+    void showSegment(int index);
+    void showHistory(int index);
+    void updateStatistics();
 
     // Settings management
     void applySettings();
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QColor>
+#include <QRunnable>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "persistencemap.h"
+
+#include "analysiskernels.h"
+#include "glgenerator.h"
+#include "viewconstants.h"
+
+const unsigned int PersistenceMap::WIDTH;
+const unsigned int PersistenceMap::HEIGHT;
+const unsigned int PersistenceMap::PARALLEL_SAMPLES;
+
+/// \brief Bins a part of a graph on a worker thread.
+class PersistenceMap::BinJob : public QRunnable {
+  public:
+    explicit BinJob(std::function<void()> job) : job(job) {}
+
+    void run() override { job(); }
+
+  private:
+    std::function<void()> job;
+};
+
+PersistenceMap::PersistenceMap() : bins(WIDTH * HEIGHT, 0) {}
+
+PersistenceMap::~PersistenceMap() { workers.waitForDone(); }
+
+void PersistenceMap::clear() {
+    std::fill(bins.begin(), bins.end(), 0);
+    peak = 0;
+    frameCount = 0;
+}
+
+int PersistenceMap::column(size_t sample, double columnStep, double columnOffset) const {
+    return (int)std::floor(sample * columnStep + columnOffset);
+}
+
+void PersistenceMap::add(const GlGraph &graph, double xScale, double yScale, double yOffset, bool connected) {
+    if (graph.interval <= 0.0 || graph.samples.empty()) return;
+    if (xScale != lastXScale || yScale != lastYScale || yOffset != lastYOffset || connected != lastConnected) {
+        clear();
+        lastXScale = xScale;
+        lastYScale = yScale;
+        lastYOffset = yOffset;
+        lastConnected = connected;
+    }
+
+    const size_t count = graph.samples.size();
+    const float rowFactor = (float)(yScale * HEIGHT / DIVS_VOLTAGE);
+    const float rowOffset = (float)((yOffset + DIVS_VOLTAGE / 2) * HEIGHT / DIVS_VOLTAGE);
+    const double columnStep = graph.interval * xScale * WIDTH / DIVS_TIME;
+    const double columnOffset = graph.start * xScale * WIDTH / DIVS_TIME;
+    rows.resize(count);
+
+    // The parts end at the borders of columns, so two threads never count the same bin
+    const size_t threads = (size_t)std::max(workers.maxThreadCount(), 1);
+    const size_t parts = (count < PARALLEL_SAMPLES) ? 1 : std::min(threads, count / PARALLEL_SAMPLES);
+    std::vector<size_t> borders(parts + 1, count);
+    borders[0] = 0;
+    for (size_t part = 1; part < parts; ++part) {
+        size_t border = std::max(count * part / parts, borders[part - 1]);
+        while (border < count && border > 0 &&
+               column(border, columnStep, columnOffset) == column(border - 1, columnStep, columnOffset))
+            ++border;
+        borders[part] = border;
+    }
+
+    std::vector<quint32> peaks(parts, 0);
+    for (size_t part = 0; part < parts; ++part) {
+        const std::function<void()> job = [this, &graph, &borders, &peaks, part, rowFactor, rowOffset, columnStep,
+                                           columnOffset, connected]() {
+            const size_t first = borders[part];
+            const size_t last = borders[part + 1];
+            if (first == last) return;
+            Analysis::quantize(graph.samples.data() + first, rowFactor, rowOffset, (int)HEIGHT, rows.data() + first,
+                               (unsigned)(last - first));
+            // The row of the sample before the part is calculated again, it belongs to another thread
+            int previous = rows[first];
+            if (first > 0)
+                Analysis::quantize(graph.samples.data() + first - 1, rowFactor, rowOffset, (int)HEIGHT, &previous, 1);
+            peaks[part] = binRange(first, last, previous, columnStep, columnOffset, connected);
+        };
+        if (parts == 1)
+            job();
+        else
+            workers.start(new BinJob(job));
+    }
+    workers.waitForDone();
+
+    peak = std::max(peak, *std::max_element(peaks.begin(), peaks.end()));
+    ++frameCount;
+    // Halving all bins keeps the relations long before they would overflow
+    if (peak >= (1u << 30)) {
+        for (quint32 &bin : bins) bin /= 2;
+        peak /= 2;
+    }
+}
+
+/// \brief Counts the hits of the samples of a part of the graph.
+/// \param first The first sample of the part.
+/// \param last The sample after the part.
+/// \param previous The row of the sample before the part.
+/// \return The hits of the bin that was hit most by the part.
+quint32 PersistenceMap::binRange(size_t first, size_t last, int previous, double columnStep, double columnOffset,
+                                 bool connected) {
+    quint32 maximum = 0;
+    for (size_t sample = first; sample < last; ++sample) {
+        const int row = rows[sample];
+        // The line from the previous sample ends in the column of this one
+        int lowest = row;
+        int highest = row;
+        if (connected && row > previous)
+            lowest = previous + 1;
+        else if (connected && row < previous)
+            highest = previous - 1;
+        previous = row;
+
+        const int x = column(sample, columnStep, columnOffset);
+        if (x < 0) continue;
+        if (x >= (int)WIDTH) break;
+        lowest = std::max(lowest, 0);
+        highest = std::min(highest, (int)HEIGHT - 1);
+        for (int y = lowest; y <= highest; ++y) {
+            quint32 &bin = bins[(size_t)y * WIDTH + (size_t)x];
+            maximum = std::max(maximum, ++bin);
+        }
+    }
+    return maximum;
+}
+
+const std::vector<quint8> &PersistenceMap::colormap() {
+    static std::vector<quint8> colors;
+    if (colors.empty()) {
+        colors.resize(256 * 4);
+        for (int level = 0; level < 256; ++level) {
+            const QColor color = QColor::fromHsvF((255 - level) / 255.0 * 2.0 / 3.0, 1.0, 1.0);
+            colors[level * 4] = (quint8)color.red();
+            colors[level * 4 + 1] = (quint8)color.green();
+            colors[level * 4 + 2] = (quint8)color.blue();
+            colors[level * 4 + 3] = (quint8)(0x60 + level * 0x9f / 255);
+        }
+    }
+    return colors;
+}
+
+void PersistenceMap::colorize(std::vector<quint8> &image) const {
+    const std::vector<quint8> &colormap = PersistenceMap::colormap();
+    const double scale = 255.0 / std::log(1.0 + std::max(peak, 1u));
+    image.resize(bins.size() * 4);
+    for (size_t bin = 0; bin < bins.size(); ++bin) {
+        quint8 *pixel = &image[bin * 4];
+        if (bins[bin] == 0) {
+            pixel[3] = 0;
+            continue;
+        }
+        const int level = std::min((int)(std::log(1.0 + bins[bin]) * scale), 255);
+        std::copy(&colormap[level * 4], &colormap[level * 4] + 4, pixel);
+    }
+}
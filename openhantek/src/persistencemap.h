@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QThreadPool>
+#include <QtGlobal>
+#include <vector>
+
+struct GlGraph;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class PersistenceMap                                       persistencemap.h
+/// \brief Counts how often every point of the screen was hit by a graph.
+/// The samples of every frame are binned into a fixed grid over the screen,
+/// so thousands of frames can be shown at once, for example as eye diagram.
+/// Long graphs are split at pixel columns and binned by several threads.
+class PersistenceMap {
+  public:
+    PersistenceMap();
+    ~PersistenceMap();
+
+    /// \brief Forgets all frames.
+    void clear();
+
+    /// \brief Adds the samples of a graph over time.
+    /// The map starts again if the scaling is not the same as for the last graph.
+    /// \param graph The graph, its position is the same as on the screen.
+    /// \param xScale The divs per second.
+    /// \param yScale The divs per volt.
+    /// \param yOffset The vertical position of the zero line in divs.
+    /// \param connected true also counts the rows between two samples, like the lines of the graph.
+    void add(const GlGraph &graph, double xScale, double yScale, double yOffset, bool connected);
+
+    /// \brief Colors the hits on a logarithmic scale from blue for single hits to red for the most hit bins.
+    /// \param image The RGBA pixels, row by row beginning with the bottom row, bins without hits are transparent.
+    void colorize(std::vector<quint8> &image) const;
+
+    /// \return The RGBA colors of the 256 levels of colorize(), from blue to red.
+    static const std::vector<quint8> &colormap();
+
+    /// \return The hits of every bin, row by row beginning with the bottom row.
+    const std::vector<quint32> &hits() const { return bins; }
+    /// \return The hits of the bin that was hit most.
+    quint32 maximum() const { return peak; }
+    /// \return The number of frames that were added since the last clear().
+    unsigned int frames() const { return frameCount; }
+
+    static const unsigned int WIDTH = 1000;                ///< The columns over the screen, 100 per div
+    static const unsigned int HEIGHT = 800;                ///< The rows over the screen, 100 per div
+    static const unsigned int PARALLEL_SAMPLES = 1u << 18; ///< Graphs with more samples are split between threads
+
+  private:
+    class BinJob;
+
+    quint32 binRange(size_t first, size_t last, int previous, double columnStep, double columnOffset, bool connected);
+    int column(size_t sample, double columnStep, double columnOffset) const;
+
+    std::vector<quint32> bins;
+    std::vector<int> rows; ///< The row of every sample of the current graph
+    quint32 peak = 0;
+    unsigned int frameCount = 0;
+    // The scaling of the frames in the map
+    double lastXScale = 0.0;
+    double lastYScale = 0.0;
+    double lastYOffset = 0.0;
+    bool lastConnected = false;
+    QThreadPool workers; ///< Bins the parts of long graphs
+};
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include "referencewaveforms.h"
+
+#include "capture/capturefile.h"
+#include "glgenerator.h"
+#include "scopesettings.h"
+#include "viewconstants.h"
+
+const unsigned int ReferenceWaveforms::COUNT;
+const size_t ReferenceWaveforms::MAX_SAMPLES;
+
+void ReferenceWaveforms::set(unsigned int slot, std::shared_ptr<const ReferenceWaveform> waveform) {
+    waveforms[slot] = std::move(waveform);
+    emit changed(slot);
+}
+
+QColor ReferenceWaveforms::color(unsigned int slot) {
+    // Light colors that differ from the default channel colors
+    static const QRgb colors[COUNT] = {0xffffffff, 0xffffa0d0, 0xffa0ffd0, 0xffd0c0ff};
+    return QColor::fromRgba(colors[slot % COUNT]);
+}
+
+std::shared_ptr<ReferenceWaveform> ReferenceWaveforms::fromGraph(const GlGraph &graph, unsigned int channel,
+                                                                 const DsoSettingsScope *scope) {
+    if (graph.empty() || graph.interval <= 0.0) return nullptr;
+
+    std::shared_ptr<ReferenceWaveform> waveform = std::make_shared<ReferenceWaveform>();
+    waveform->channel = channel;
+    waveform->samples.assign(graph.samples.begin(), graph.samples.end());
+    waveform->interval = graph.interval;
+    // The trigger is at the trigger position of the screen
+    waveform->start = graph.start - scope->trigger.position * DIVS_TIME * scope->horizontal.timebase;
+    reduce(*waveform);
+    return waveform;
+}
+
+std::shared_ptr<ReferenceWaveform> ReferenceWaveforms::fromCapture(const CaptureFile &file, size_t index,
+                                                                   unsigned int channel) {
+    const Capture::FrameHeader *frame = file.frameHeader(index);
+    if (frame->samplerate <= 0.0 || file.channelHeader(index, channel)->count == 0) return nullptr;
+
+    DSOsamples samples;
+    file.readFrame(index, samples);
+    std::vector<double> voltages;
+    samples.copyVoltage(channel, voltages, false);
+
+    std::shared_ptr<ReferenceWaveform> waveform = std::make_shared<ReferenceWaveform>();
+    waveform->channel = channel;
+    waveform->samples.assign(voltages.begin(), voltages.end());
+    waveform->interval = 1.0 / frame->samplerate;
+    waveform->start = (frame->triggerPoint >= 0.0) ? -frame->triggerPoint * waveform->interval : 0.0;
+    reduce(*waveform);
+    return waveform;
+}
+
+/// \brief Reduces a long waveform to the minimum and maximum of every bucket.
+/// The waveform is drawn completely for every frame, the pairs keep the peaks visible.
+void ReferenceWaveforms::reduce(ReferenceWaveform &waveform) {
+    if (waveform.samples.size() <= MAX_SAMPLES) return;
+
+    const size_t bucket = (waveform.samples.size() + MAX_SAMPLES / 2 - 1) / (MAX_SAMPLES / 2);
+    std::vector<float> reduced;
+    reduced.reserve(MAX_SAMPLES);
+    for (size_t first = 0; first < waveform.samples.size(); first += bucket) {
+        const std::vector<float>::const_iterator begin = waveform.samples.begin() + first;
+        const std::vector<float>::const_iterator end =
+            waveform.samples.begin() + std::min(first + bucket, waveform.samples.size());
+        const std::pair<std::vector<float>::const_iterator, std::vector<float>::const_iterator> extremes =
+            std::minmax_element(begin, end);
+        // The pair keeps the order of the samples, so the line doesn't jump back
+        const bool minimumFirst = extremes.first < extremes.second;
+        reduced.push_back(minimumFirst ? *extremes.first : *extremes.second);
+        reduced.push_back(minimumFirst ? *extremes.second : *extremes.first);
+    }
+    waveform.interval *= bucket / 2.0;
+    waveform.samples.swap(reduced);
+}
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QColor>
+#include <QObject>
+#include <QString>
+#include <array>
+#include <memory>
+#include <vector>
+
+class CaptureFile;
+struct DsoSettingsScope;
+struct GlGraph;
+
+/// \brief A stored voltage graph that is drawn next to the live graphs.
+/// The waveform is placed relative to the trigger, so it stays aligned with the
+/// live graphs when the timebase or the trigger position change.
+struct ReferenceWaveform {
+    QString name;               ///< Describes where the waveform came from
+    unsigned int channel = 0;   ///< The channel whose gain and offset the waveform is drawn with
+    std::vector<float> samples; ///< The voltages
+    double interval = 0.0;      ///< The time between two samples in s
+    double start = 0.0;         ///< The time of the first sample relative to the trigger in s
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ReferenceWaveforms                               referencewaveforms.h
+/// \brief The slots of the reference waveforms.
+/// The waveforms never change after they were stored, so the scopes upload a
+/// waveform once and only scale it when they draw it. Only used by the gui thread.
+class ReferenceWaveforms : public QObject {
+    Q_OBJECT
+
+  public:
+    /// \return The waveform in a slot, nullptr if the slot is empty.
+    std::shared_ptr<const ReferenceWaveform> get(unsigned int slot) const { return waveforms[slot]; }
+    /// \brief Stores a waveform in a slot.
+    /// \param slot The slot, it has to be less than COUNT.
+    /// \param waveform The waveform, nullptr empties the slot.
+    void set(unsigned int slot, std::shared_ptr<const ReferenceWaveform> waveform);
+
+    /// \return The color the waveform in a slot is drawn with.
+    static QColor color(unsigned int slot);
+
+    /// \brief Takes a snapshot of a generated voltage graph.
+    /// \param graph The newest layer of the graph, its start is the time from the left edge of the screen.
+    /// \param channel The channel of the graph.
+    /// \param scope The settings the graph was generated with.
+    /// \return The waveform without name, nullptr if the graph is empty.
+    static std::shared_ptr<ReferenceWaveform> fromGraph(const GlGraph &graph, unsigned int channel,
+                                                        const DsoSettingsScope *scope);
+    /// \brief Reads a channel of a recorded frame.
+    /// The trigger point of the frame is placed at the trigger, frames in roll mode begin at it.
+    /// \param file The opened capture file.
+    /// \param index The index of the frame, it has to be less than file.frameCount().
+    /// \param channel The channel that is read, it has to be less than file.channelCount().
+    /// \return The waveform without name, nullptr if the channel has no samples.
+    static std::shared_ptr<ReferenceWaveform> fromCapture(const CaptureFile &file, size_t index,
+                                                          unsigned int channel);
+
+    static const unsigned int COUNT = 4;        ///< The number of slots
+    static const size_t MAX_SAMPLES = 1u << 17; ///< Longer waveforms are reduced to minimum/maximum pairs
+
+  private:
+    static void reduce(ReferenceWaveform &waveform);
+
+    std::array<std::shared_ptr<const ReferenceWaveform>, COUNT> waveforms;
+
+  signals:
+    void changed(unsigned int slot); ///< The waveform in the slot was replaced
+};
@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QAction>
+#include <QComboBox>
+#include <QLabel>
+#include <QMenu>
+#include <QMenuBar>
+#include <QSignalBlocker>
+#include <QSlider>
+#include <QStatusBar>
+#include <QToolBar>
+#include <algorithm>
+
+#include "replaywindow.h"
+
+#include "SpectrumDock.h"
+#include "VoltageDock.h"
+#include "capture/capturereplay.h"
+#include "dataanalyzer.h"
+#include "dockwindows.h"
+#include "dsowidget.h"
+#include "settings.h"
+#include "utils/printutils.h"
+#include "viewconstants.h"
+
+/// \brief Initializes the gui elements of the replay window.
+/// \param replay The replay that provides the frames, it runs in its own thread.
+/// \param dataAnalyzer The analyzer of the replayed frames.
+/// \param settings The settings used for the display.
+ReplayWindow::ReplayWindow(CaptureReplay *replay, DataAnalyzer *dataAnalyzer, DsoSettings *settings)
+    : replay(replay), dataAnalyzer(dataAnalyzer), settings(settings) {
+    setWindowIcon(QIcon(":openhantek.png"));
+    setWindowTitle(tr("OpenHantek - Replay of %1").arg(replay->getFile().model()));
+
+    createDockWindows();
+
+    dsoWidget = new DsoWidget(settings);
+    connect(dsoWidget, &DsoWidget::spectrumComputeAvailable, dataAnalyzer, &DataAnalyzer::setSpectrumOffload);
+    connect(dataAnalyzer, &DataAnalyzer::analyzed,
+            [this]() { dsoWidget->showNewData(this->dataAnalyzer->getNextResult()); });
+    setCentralWidget(dsoWidget);
+    dsoWidget->updateSamplerate(settings->scope.horizontal.samplerate);
+    dsoWidget->updateRecordLength(settings->scope.horizontal.recordLength);
+    dsoWidget->updateTimebase(settings->scope.horizontal.timebase);
+
+    createActions();
+    connectSignals();
+
+    const CaptureFile &file = replay->getFile();
+    if (file.isTruncated())
+        statusBar()->showMessage(tr("The capture file is incomplete, %1 frames could be read").arg(file.frameCount()));
+    else
+        statusBar()->showMessage(tr("%1 frames").arg(file.frameCount()));
+}
+
+/// \brief Sets up the display settings for the first frame of a capture file.
+/// \param replay The replay with the opened file.
+/// \param settings The settings, they have the channel count of the file.
+void ReplayWindow::applyCaptureSettings(const CaptureReplay *replay, DsoSettings *settings) {
+    const CaptureFile &file = replay->getFile();
+    if (!file.frameCount()) return;
+
+    const Capture::FrameHeader *frame = file.frameHeader(0);
+    unsigned recordLength = 0;
+    for (unsigned channel = 0; channel < file.channelCount() && channel < settings->scope.physicalChannels;
+         ++channel) {
+        const Capture::ChannelHeader *channelHeader = file.channelHeader(0, channel);
+        if (channelHeader->gain > 0.0) settings->scope.voltage[channel].gain = channelHeader->gain;
+        settings->scope.voltage[channel].offset = channelHeader->offset;
+        settings->scope.voltage[channel].used = channelHeader->count != 0;
+        recordLength = std::max(recordLength, (unsigned)channelHeader->count);
+    }
+    if (frame->samplerate > 0.0) {
+        settings->scope.horizontal.samplerate = frame->samplerate;
+        if (recordLength && !(frame->flags & Capture::FRAME_APPEND))
+            settings->scope.horizontal.timebase = recordLength / frame->samplerate / DIVS_TIME;
+    }
+    settings->scope.horizontal.recordLength = recordLength;
+}
+
+/// \brief Create the playback controls.
+void ReplayWindow::createActions() {
+    playAction = new QAction(QIcon(":actions/start.png"), tr("&Play"), this);
+    playAction->setShortcut(tr("Space"));
+    playAction->setCheckable(true);
+    playAction->setStatusTip(tr("Play the capture file"));
+    connect(playAction, &QAction::toggled, replay, [this](bool enabled) {
+        if (enabled)
+            replay->play();
+        else
+            replay->pause();
+    });
+
+    exitAction = new QAction(tr("E&xit"), this);
+    exitAction->setShortcut(tr("Ctrl+Q"));
+    exitAction->setStatusTip(tr("Exit the application"));
+    connect(exitAction, &QAction::triggered, this, &QWidget::close);
+
+    speedComboBox = new QComboBox();
+    for (double speed : {0.1, 0.25, 0.5, 1.0, 2.0, 5.0, 10.0})
+        speedComboBox->addItem(tr("%1x").arg(speed), speed);
+    speedComboBox->addItem(tr("Maximum"), 0.0);
+    speedComboBox->setCurrentIndex(speedComboBox->findData(1.0));
+    speedComboBox->setToolTip(tr("The speed of the replay compared to the recording"));
+    connect(speedComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), [this](int index) {
+        QMetaObject::invokeMethod(replay, "setSpeed", Qt::QueuedConnection,
+                                  Q_ARG(double, speedComboBox->itemData(index).toDouble()));
+    });
+
+    positionSlider = new QSlider(Qt::Horizontal);
+    positionSlider->setRange(0, std::max((int)replay->getFile().frameCount() - 1, 0));
+    positionSlider->setToolTip(tr("The frame that is shown"));
+    connect(positionSlider, &QSlider::valueChanged, replay, [this](int value) { replay->seek((unsigned)value); });
+    positionLabel = new QLabel();
+
+    QMenu *fileMenu = menuBar()->addMenu(tr("&File"));
+    fileMenu->addAction(playAction);
+    fileMenu->addSeparator();
+    fileMenu->addAction(exitAction);
+
+    QMenu *viewMenu = menuBar()->addMenu(tr("&View"));
+    QMenu *dockMenu = viewMenu->addMenu(tr("&Docking windows"));
+    dockMenu->addAction(voltageDock->toggleViewAction());
+    dockMenu->addAction(spectrumDock->toggleViewAction());
+
+    QToolBar *replayToolBar = new QToolBar(tr("Replay"));
+    replayToolBar->setObjectName(tr("Replay"));
+    replayToolBar->setAllowedAreas(Qt::TopToolBarArea | Qt::BottomToolBarArea);
+    replayToolBar->addAction(playAction);
+    replayToolBar->addWidget(speedComboBox);
+    replayToolBar->addWidget(positionSlider);
+    replayToolBar->addWidget(positionLabel);
+    addToolBar(replayToolBar);
+}
+
+/// \brief Create the docking windows that change the display.
+void ReplayWindow::createDockWindows() {
+    registerDockMetaTypes();
+    voltageDock = new VoltageDock(settings, this);
+    spectrumDock = new SpectrumDock(settings, this);
+    addDockWidget(Qt::RightDockWidgetArea, voltageDock);
+    addDockWidget(Qt::RightDockWidgetArea, spectrumDock);
+}
+
+/// \brief Connect the docks to the display and the replay to the controls.
+void ReplayWindow::connectSignals() {
+    connect(voltageDock, &VoltageDock::usedChanged, dsoWidget, &DsoWidget::updateVoltageUsed);
+    connect(voltageDock, &VoltageDock::couplingChanged, dsoWidget, &DsoWidget::updateVoltageCoupling);
+    connect(voltageDock, &VoltageDock::modeChanged, dsoWidget, &DsoWidget::updateMathMode);
+    connect(voltageDock, &VoltageDock::gainChanged, dsoWidget, &DsoWidget::updateVoltageGain);
+
+    connect(spectrumDock, &SpectrumDock::usedChanged, dsoWidget, &DsoWidget::updateSpectrumUsed);
+    connect(spectrumDock, &SpectrumDock::magnitudeChanged, dsoWidget, &DsoWidget::updateSpectrumMagnitude);
+
+    connect(replay, &CaptureReplay::positionChanged, this, &ReplayWindow::positionChanged);
+    connect(replay, &CaptureReplay::playingChanged, this, &ReplayWindow::playingChanged);
+}
+
+/// \brief Shows the published frame in the controls.
+/// \param index The index of the frame.
+void ReplayWindow::positionChanged(unsigned index) {
+    const CaptureFile &file = replay->getFile();
+    {
+        QSignalBlocker blocker(positionSlider);
+        positionSlider->setValue((int)index);
+    }
+    const double seconds = (file.frameHeader(index)->timestamp - file.frameHeader(0)->timestamp) / 1e9;
+    positionLabel->setText(tr("Frame %1 of %2, %3")
+                               .arg(index + 1)
+                               .arg(file.frameCount())
+                               .arg(valueToString(seconds, UNIT_SECONDS, 4)));
+}
+
+/// \brief Updates the play action when the replay starts or stops.
+/// \param playing true, if the replay is playing.
+void ReplayWindow::playingChanged(bool playing) {
+    QSignalBlocker blocker(playAction);
+    playAction->setChecked(playing);
+    playAction->setText(playing ? tr("&Pause") : tr("&Play"));
+    playAction->setIcon(QIcon(playing ? ":actions/stop.png" : ":actions/start.png"));
+}
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMainWindow>
+
+class QAction;
+class QComboBox;
+class QLabel;
+class QSlider;
+
+class CaptureReplay;
+class DataAnalyzer;
+class DsoSettings;
+class DsoWidget;
+class SpectrumDock;
+class VoltageDock;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ReplayWindow                                           replaywindow.h
+/// \brief The main window for the replay of a capture file.
+/// Shows the frames of a CaptureReplay with the oscilloscope screen, no device
+/// is needed. The voltage and spectrum docks only change the display, the
+/// toolbar controls the playback and selects any frame of the file.
+class ReplayWindow : public QMainWindow {
+    Q_OBJECT
+
+  public:
+    ReplayWindow(CaptureReplay *replay, DataAnalyzer *dataAnalyzer, DsoSettings *settings);
+
+    /// \brief Sets up the display settings for the first frame of a capture file.
+    /// \param replay The replay with the opened file.
+    /// \param settings The settings, they have the channel count of the file.
+    static void applyCaptureSettings(const CaptureReplay *replay, DsoSettings *settings);
+
+  private:
+    void createActions();
+    void createDockWindows();
+    void connectSignals();
+
+    QAction *playAction, *exitAction;
+    QComboBox *speedComboBox;
+    QSlider *positionSlider;
+    QLabel *positionLabel;
+
+    VoltageDock *voltageDock;
+    SpectrumDock *spectrumDock;
+    DsoWidget *dsoWidget;
+
+    CaptureReplay *replay;
+    DataAnalyzer *dataAnalyzer;
+    DsoSettings *settings;
+
+  private slots:
+    void positionChanged(unsigned index);
+    void playingChanged(bool playing);
+};
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "definitions.h"
+#include "viewconstants.h"
+#include <QPolygonF>
+#include <QString>
 #include <QVector>
+#include <vector>
 
 ////////////////////////////////////////////////////////////////////////////////
 /// \struct DsoSettingsScopeHorizontal                                settings.h
@@ -15,6 +19,13 @@ struct DsoSettingsScopeHorizontal {
     unsigned int recordLength = 0; ///< Sample count
     double samplerate = 1e6;       ///< The samplerate of the oscilloscope in S
     bool samplerateSet = false;    ///< The samplerate was set by the user, not the timebase
+    bool streaming = false;        ///< Read the device continuously, if it is supported
+    unsigned segments = 100;       ///< The number of segments of a segmented acquisition
+
+    Dso::AcquisitionMode acquisitionMode = Dso::ACQUISITION_NORMAL; ///< Averaging or high resolution
+    unsigned averages = 16;                                         ///< The frames averaged in averaging mode
+    unsigned highResolution = 4;                                    ///< The samples per group in high resolution mode
+    unsigned equivalentTime = 16;                                   ///< The time steps per sample in equivalent time
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -27,6 +38,12 @@ struct DsoSettingsScopeTrigger {
     Dso::Slope slope = Dso::SLOPE_POSITIVE;          ///< Rising or falling edge causes trigger
     unsigned int source = 0;                         ///< Channel that is used as trigger source
     bool special = false;                            ///< true if the trigger source is not a standard channel
+    double hysteresis = 0.1;                         ///< Hysteresis of the software trigger in divs
+    Dso::TriggerType type = Dso::TRIGGERTYPE_EDGE;   ///< The condition of the software trigger
+    double height = 1.0;                             ///< Distance of the upper runt and window level in divs
+    double duration = 1e-3;                          ///< Pulse width or timeout of the software trigger in s
+    bool shorter = false;                            ///< Trigger on pulses shorter than the duration, not longer ones
+    bool sinc = true;                                ///< Align the software trigger point with sin(x)/x
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -39,17 +56,62 @@ struct DsoSettingsScopeSpectrum {
     bool used;        ///< true if the spectrum is turned on
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/// \struct DsoSettingsScopeFilter                                    settings.h
+/// \brief Holds the settings for the digital filter of a channel.
+struct DsoSettingsScopeFilter {
+    Dso::FilterType type = Dso::FILTER_OFF;           ///< The passed band
+    Dso::FilterDesign design = Dso::FILTERDESIGN_FIR; ///< FIR or IIR filter
+    double low = 1e3;                                 ///< The lower cutoff in Hz
+    double high = 10e3;                               ///< The upper cutoff in Hz
+    unsigned int taps = 255;                          ///< The length of the FIR filter
+    unsigned int order = 4;                           ///< The order of the IIR filter
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 /// \struct DsoSettingsScopeVoltage                                   settings.h
 /// \brief Holds the settings for the normal voltage graphs.
 struct DsoSettingsScopeVoltage {
-    double gain;    ///< The vertical resolution in V/div
-    int misc;       ///< Different enums, coupling for real- and mode for math-channels
-    bool inverted;  ///< true if the channel is inverted (mirrored on cross-axis)
-    QString name;   ///< Name of this channel
-    double offset;  ///< Vertical offset in divs
-    double trigger; ///< Trigger level in V
-    bool used;      ///< true if this channel is enabled
+    double gain;                   ///< The vertical resolution in V/div
+    int misc;                      ///< Different enums, coupling for real- and mode for math-channels
+    bool inverted;                 ///< true if the channel is inverted (mirrored on cross-axis)
+    QString name;                  ///< Name of this channel
+    double offset;                 ///< Vertical offset in divs
+    double trigger;                ///< Trigger level in V
+    bool used;                     ///< true if this channel is enabled
+    DsoSettingsScopeFilter filter; ///< The filter of a real channel, it is applied before the analysis
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \struct DsoSettingsScopeDecoder                                   settings.h
+/// \brief Holds the settings for the serial protocol decoder.
+struct DsoSettingsScopeDecoder {
+    Dso::Protocol protocol = Dso::PROTOCOL_OFF;  ///< The decoded protocol
+    unsigned int sources[2] = {0, 1};            ///< The channels, only the first one is used for UART
+    double threshold = 1.4;                      ///< The logic threshold of the sources in V
+    double hysteresis = 0.2;                     ///< The width of the band around the threshold in V
+    double baudrate = 9600.0;                    ///< The bits per second of UART
+    unsigned int dataBits = 8;                   ///< The data bits of an UART character
+    Dso::Parity parity = Dso::PARITY_NONE;       ///< The parity bit of an UART character
+    unsigned int stopBits = 1;                   ///< The stop bits of an UART character
+    bool inverted = false;                       ///< The UART line idles low
+    Dso::Slope clockSlope = Dso::SLOPE_POSITIVE; ///< The SPI clock edge the data is sampled at
+    unsigned int wordBits = 8;                   ///< The bits of a SPI word
+    bool lsbFirst = false;                       ///< The SPI words begin with the least significant bit
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \struct DsoSettingsScopeMask                                      settings.h
+/// \brief Holds the settings for the mask test.
+struct DsoSettingsScopeMask {
+    bool enabled = false;            ///< true, if the frames are tested against the mask
+    unsigned int channel = 0;        ///< The channel whose graph is tested
+    std::vector<QPolygonF> polygons; ///< The areas the graph must not touch in divs
+    double xTolerance = 0.2;         ///< The horizontal distance of a mask created around a graph in divs
+    double yTolerance = 0.4;         ///< The vertical distance of a mask created around a graph in divs
+    bool stopOnFail = false;         ///< Stop the acquisition when a frame fails
+    bool saveOnFail = false;         ///< Save the frames that fail as CSV file
+    QString savePath;                ///< The directory the failed frames are saved to, the home directory if empty
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -60,9 +122,39 @@ struct DsoSettingsScope {
     DsoSettingsScopeTrigger trigger;            ///< Settings for the trigger
     QVector<DsoSettingsScopeSpectrum> spectrum; ///< Spectrum analysis settings
     QVector<DsoSettingsScopeVoltage> voltage;   ///< Settings for the normal graphs
+    DsoSettingsScopeDecoder decoder;            ///< Settings for the protocol decoder
+    DsoSettingsScopeMask mask;                  ///< Settings for the mask test
 
     unsigned int physicalChannels = 0;                     ///< Number of real channels (No math etc.)
     Dso::WindowFunction spectrumWindow = Dso::WINDOW_HANN; ///< Window function for DFT
     double spectrumReference = 0.0;                        ///< Reference level for spectrum in dBm
     double spectrumLimit = -20.0;                          ///< Minimum magnitude of the spectrum (Avoids peaks)
+    bool compactSamples = false;                           ///< Keep the samples as raw codes to save memory
+    bool losslessCapture = false;                          ///< The acquisition waits for the analysis
+    unsigned int historyMemory = 0;                        ///< The memory for the last frames in MiB, 0 for none
+    bool compressCaptures = true;                          ///< Store the recorded codes with the lossless codec
+    bool spectrumPatientPlanning = false;                  ///< Search longer for the fastest FFT algorithm
+    bool spectrumSinglePrecision = false;                  ///< Transform the records with single precision FFTs
+    bool spectrumGpu = false;                              ///< Transform the records on the gpu if possible
+    unsigned int spectrumAverages = 16;                    ///< Number of frames in the spectrum average
+    bool spectrogram = false;                              ///< Show the spectra as scrolling waterfall
+    unsigned int spectrogramSegment = 1024;                ///< Samples in a segment of the spectrogram
+    bool spectrumZoom = false;                             ///< Show the spectrum of a band around the zoom center
+    double spectrumZoomCenter = 1e3;                       ///< The center of the zoomed band in Hz
+    unsigned int spectrumZoomFactor = 16;                  ///< The samplerate divided by the zoomed bandwidth
+    /// The method that combines the spectra of consecutive frames
+    Dso::SpectrumAveraging spectrumAveraging = Dso::AVERAGING_OFF;
+    /// The method used to measure the frequency of the signals
+    Dso::FrequencyEstimator frequencyEstimator = Dso::FREQUENCY_AUTOCORRELATION;
+    /// The enabled automatic measurements, a bit for every Dso::Measurement
+    unsigned int measurements = (1u << Dso::MEASUREMENT_COUNT) - 1;
+    bool analysisRegion = false; ///< Measure only the samples between the markers, not in roll mode
+    bool spectrumRegion = false; ///< Also transform only the samples between the markers
+    double mathFactors[2] = {1.0, 1.0};   ///< The factors a and b of Dso::MATHMODE_SCALEDSUM
+    QString mathExpression = "ch1 - ch2"; ///< The formula of Dso::MATHMODE_EXPRESSION
+
+    /// \return The frequency at the left edge of the screen in Hz, the zoomed band is centered.
+    double spectrumOrigin() const {
+        return spectrumZoom ? spectrumZoomCenter - horizontal.frequencybase * DIVS_TIME / 2 : 0.0;
+    }
 };
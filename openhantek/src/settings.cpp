@@ -21,19 +21,130 @@
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-#include <QApplication>
+#include <QCoreApplication>
 #include <QColor>
+#include <QDataStream>
 #include <QDebug>
 #include <QSettings>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
 
 #include "settings.h"
 
 #include "definitions.h"
-#include "dsowidget.h"
+#include "viewconstants.h"
+
+// The strings keep the translation context of the gui, but don't need QtWidgets
+#define tr(msg) QCoreApplication::translate("QApplication", msg)
+
+const int DsoSettingsView::PHOSPHOR_LAYERS_MAX;
+
+namespace {
+const quint32 SNAPSHOT_MAGIC = 0x4f485353; ///< "OHSS" at the beginning of every snapshot
+/// The layout of the snapshots, 2 added the acquisition modes and 3 the equivalent time factor
+const quint16 SNAPSHOT_VERSION = 3;
+
+/// \brief Reads or writes the fields of a snapshot, so both directions share one list of fields.
+class SnapshotStream {
+  public:
+    /// \param version The layout of a read snapshot, older ones lack the fields that were added later.
+    SnapshotStream(QDataStream &stream, bool reading, quint16 version = SNAPSHOT_VERSION)
+        : stream(stream), reading(reading), version(version) {}
+
+    /// \return true, if the snapshot has the fields that were added with the version.
+    bool since(quint16 added) const { return version >= added; }
+
+    template <typename T> SnapshotStream &operator&(T &value) {
+        transfer(value, std::is_enum<T>());
+        return *this;
+    }
+
+    SnapshotStream &operator&(std::vector<QPolygonF> &polygons) {
+        quint32 count = (quint32)polygons.size();
+        *this & count;
+        if (reading) polygons.resize(stream.status() == QDataStream::Ok ? count : 0);
+        for (QPolygonF &polygon : polygons) *this & polygon;
+        return *this;
+    }
+
+    /// \brief Checks that the snapshot has the same number of entries as the settings.
+    void count(int size) {
+        qint32 stored = size;
+        *this & stored;
+        if (stored != size) stream.setStatus(QDataStream::ReadCorruptData);
+    }
+
+  private:
+    template <typename T> void transfer(T &value, std::true_type) {
+        qint32 stored = (qint32)value;
+        transfer(stored, std::false_type());
+        value = (T)stored;
+    }
+    template <typename T> void transfer(T &value, std::false_type) {
+        if (reading)
+            stream >> value;
+        else
+            stream << value;
+    }
+
+    QDataStream &stream;
+    bool reading;
+    quint16 version;
+};
+
+/// \brief Transfers the settings of a test setup.
+/// The preferences of the program like the sample storage aren't part of the snapshots.
+void transferScope(SnapshotStream &stream, DsoSettingsScope &scope) {
+    DsoSettingsScopeHorizontal &horizontal = scope.horizontal;
+    stream & horizontal.format & horizontal.frequencybase & horizontal.marker[0] & horizontal.marker[1] &
+        horizontal.timebase & horizontal.recordLength & horizontal.samplerate & horizontal.samplerateSet &
+        horizontal.streaming & horizontal.segments;
+    // The fields of newer versions keep their current values, if an older snapshot is read
+    if (stream.since(2)) stream & horizontal.acquisitionMode & horizontal.averages & horizontal.highResolution;
+    if (stream.since(3)) stream & horizontal.equivalentTime;
+
+    DsoSettingsScopeTrigger &trigger = scope.trigger;
+    stream & trigger.filter & trigger.mode & trigger.position & trigger.slope & trigger.source & trigger.special &
+        trigger.hysteresis & trigger.type & trigger.height & trigger.duration & trigger.shorter & trigger.sinc;
+
+    stream.count(scope.spectrum.count());
+    for (DsoSettingsScopeSpectrum &spectrum : scope.spectrum)
+        stream & spectrum.magnitude & spectrum.offset & spectrum.used;
+
+    stream.count(scope.voltage.count());
+    for (DsoSettingsScopeVoltage &voltage : scope.voltage) {
+        stream & voltage.gain & voltage.misc & voltage.offset & voltage.trigger & voltage.used;
+        DsoSettingsScopeFilter &filter = voltage.filter;
+        stream & filter.type & filter.design & filter.low & filter.high & filter.taps & filter.order;
+    }
+
+    DsoSettingsScopeDecoder &decoder = scope.decoder;
+    stream & decoder.protocol & decoder.sources[0] & decoder.sources[1] & decoder.threshold & decoder.hysteresis &
+        decoder.baudrate & decoder.dataBits & decoder.parity & decoder.stopBits & decoder.inverted &
+        decoder.clockSlope & decoder.wordBits & decoder.lsbFirst;
+
+    DsoSettingsScopeMask &mask = scope.mask;
+    stream & mask.enabled & mask.channel & mask.polygons & mask.xTolerance & mask.yTolerance & mask.stopOnFail &
+        mask.saveOnFail & mask.savePath;
+
+    stream & scope.spectrumWindow & scope.spectrumReference & scope.spectrumLimit & scope.spectrumAveraging &
+        scope.spectrumAverages & scope.spectrogram & scope.spectrogramSegment & scope.spectrumZoom &
+        scope.spectrumZoomCenter & scope.spectrumZoomFactor & scope.frequencyEstimator & scope.measurements &
+        scope.analysisRegion & scope.spectrumRegion & scope.mathFactors[0] & scope.mathFactors[1] &
+        scope.mathExpression;
+}
+} // namespace
 
 /// \brief Set the number of channels.
 /// \param channels The new channel count, that will be applied to lists.
-DsoSettings::DsoSettings() { load(); }
+DsoSettings::DsoSettings(const QString &profile) {
+    // Additional devices get their own settings, so they don't overwrite each other
+    if (!profile.isEmpty())
+        store.reset(new QSettings(QCoreApplication::organizationName(),
+                                  QCoreApplication::applicationName() + "-" + profile));
+    load();
+}
 
 bool DsoSettings::setFilename(const QString &filename) {
     std::unique_ptr<QSettings> local = std::unique_ptr<QSettings>(new QSettings(filename, QSettings::IniFormat));
@@ -66,7 +177,7 @@ void DsoSettings::setChannelCount(unsigned int channels) {
         if (this->scope.spectrum.count() <= channel + 1) {
             DsoSettingsScopeSpectrum newSpectrum;
             newSpectrum.magnitude = 20.0;
-            newSpectrum.name = QApplication::tr("SP%1").arg(channel + 1);
+            newSpectrum.name = tr("SP%1").arg(channel + 1);
             newSpectrum.offset = 0.0;
             newSpectrum.used = false;
             this->scope.spectrum.insert(channel, newSpectrum);
@@ -76,7 +187,7 @@ void DsoSettings::setChannelCount(unsigned int channels) {
             DsoSettingsScopeVoltage newVoltage;
             newVoltage.gain = 1.0;
             newVoltage.misc = Dso::COUPLING_DC;
-            newVoltage.name = QApplication::tr("CH%1").arg(channel + 1);
+            newVoltage.name = tr("CH%1").arg(channel + 1);
             newVoltage.offset = 0.0;
             newVoltage.trigger = 0.0;
             newVoltage.used = false;
@@ -101,7 +212,7 @@ void DsoSettings::setChannelCount(unsigned int channels) {
     if (this->scope.spectrum.count() <= (int)channels) {
         DsoSettingsScopeSpectrum newSpectrum;
         newSpectrum.magnitude = 20.0;
-        newSpectrum.name = QApplication::tr("SPM");
+        newSpectrum.name = tr("SPM");
         newSpectrum.offset = 0.0;
         newSpectrum.used = false;
         this->scope.spectrum.append(newSpectrum);
@@ -110,7 +221,7 @@ void DsoSettings::setChannelCount(unsigned int channels) {
         DsoSettingsScopeVoltage newVoltage;
         newVoltage.gain = 1.0;
         newVoltage.misc = Dso::MATHMODE_1ADD2;
-        newVoltage.name = QApplication::tr("MATH");
+        newVoltage.name = tr("MATH");
         newVoltage.offset = 0.0;
         newVoltage.trigger = 0.0;
         newVoltage.used = false;
@@ -151,6 +262,15 @@ void DsoSettings::load() {
     if (store->contains("recordLength")) this->scope.horizontal.recordLength = store->value("recordLength").toUInt();
     if (store->contains("samplerate")) this->scope.horizontal.samplerate = store->value("samplerate").toDouble();
     if (store->contains("samplerateSet")) this->scope.horizontal.samplerateSet = store->value("samplerateSet").toBool();
+    if (store->contains("streaming")) this->scope.horizontal.streaming = store->value("streaming").toBool();
+    if (store->contains("segments")) this->scope.horizontal.segments = store->value("segments").toUInt();
+    if (store->contains("acquisitionMode"))
+        this->scope.horizontal.acquisitionMode = (Dso::AcquisitionMode)store->value("acquisitionMode").toInt();
+    if (store->contains("averages")) this->scope.horizontal.averages = store->value("averages").toUInt();
+    if (store->contains("highResolution"))
+        this->scope.horizontal.highResolution = store->value("highResolution").toUInt();
+    if (store->contains("equivalentTime"))
+        this->scope.horizontal.equivalentTime = store->value("equivalentTime").toUInt();
     store->endGroup();
     // Trigger
     store->beginGroup("trigger");
@@ -160,6 +280,49 @@ void DsoSettings::load() {
     if (store->contains("slope")) this->scope.trigger.slope = (Dso::Slope)store->value("slope").toInt();
     if (store->contains("source")) this->scope.trigger.source = store->value("source").toInt();
     if (store->contains("special")) this->scope.trigger.special = store->value("special").toInt();
+    if (store->contains("hysteresis")) this->scope.trigger.hysteresis = store->value("hysteresis").toDouble();
+    if (store->contains("type")) this->scope.trigger.type = (Dso::TriggerType)store->value("type").toInt();
+    if (store->contains("height")) this->scope.trigger.height = store->value("height").toDouble();
+    if (store->contains("duration")) this->scope.trigger.duration = store->value("duration").toDouble();
+    if (store->contains("shorter")) this->scope.trigger.shorter = store->value("shorter").toBool();
+    if (store->contains("sinc")) this->scope.trigger.sinc = store->value("sinc").toBool();
+    store->endGroup();
+    // Protocol decoder
+    store->beginGroup("decoder");
+    DsoSettingsScopeDecoder &decoder = this->scope.decoder;
+    if (store->contains("protocol")) decoder.protocol = (Dso::Protocol)store->value("protocol").toInt();
+    if (store->contains("source1")) decoder.sources[0] = store->value("source1").toUInt();
+    if (store->contains("source2")) decoder.sources[1] = store->value("source2").toUInt();
+    if (store->contains("threshold")) decoder.threshold = store->value("threshold").toDouble();
+    if (store->contains("hysteresis")) decoder.hysteresis = store->value("hysteresis").toDouble();
+    if (store->contains("baudrate")) decoder.baudrate = store->value("baudrate").toDouble();
+    if (store->contains("dataBits")) decoder.dataBits = store->value("dataBits").toUInt();
+    if (store->contains("parity")) decoder.parity = (Dso::Parity)store->value("parity").toInt();
+    if (store->contains("stopBits")) decoder.stopBits = store->value("stopBits").toUInt();
+    if (store->contains("inverted")) decoder.inverted = store->value("inverted").toBool();
+    if (store->contains("clockSlope")) decoder.clockSlope = (Dso::Slope)store->value("clockSlope").toInt();
+    if (store->contains("wordBits")) decoder.wordBits = store->value("wordBits").toUInt();
+    if (store->contains("lsbFirst")) decoder.lsbFirst = store->value("lsbFirst").toBool();
+    store->endGroup();
+    // Mask test
+    store->beginGroup("mask");
+    DsoSettingsScopeMask &mask = this->scope.mask;
+    if (store->contains("enabled")) mask.enabled = store->value("enabled").toBool();
+    if (store->contains("channel")) mask.channel = store->value("channel").toUInt();
+    if (store->contains("xTolerance")) mask.xTolerance = store->value("xTolerance").toDouble();
+    if (store->contains("yTolerance")) mask.yTolerance = store->value("yTolerance").toDouble();
+    if (store->contains("stopOnFail")) mask.stopOnFail = store->value("stopOnFail").toBool();
+    if (store->contains("saveOnFail")) mask.saveOnFail = store->value("saveOnFail").toBool();
+    if (store->contains("savePath")) mask.savePath = store->value("savePath").toString();
+    // Loading a profile replaces the mask instead of adding to it
+    mask.polygons.clear();
+    const int polygonCount = store->beginReadArray("polygons");
+    mask.polygons.reserve((size_t)polygonCount);
+    for (int polygon = 0; polygon < polygonCount; ++polygon) {
+        store->setArrayIndex(polygon);
+        mask.polygons.push_back(store->value("points").value<QPolygonF>());
+    }
+    store->endArray();
     store->endGroup();
     // Spectrum
     for (int channel = 0; channel < this->scope.spectrum.count(); ++channel) {
@@ -178,6 +341,13 @@ void DsoSettings::load() {
         if (store->contains("offset")) this->scope.voltage[channel].offset = store->value("offset").toDouble();
         if (store->contains("trigger")) this->scope.voltage[channel].trigger = store->value("trigger").toDouble();
         if (store->contains("used")) this->scope.voltage[channel].used = store->value("used").toBool();
+        DsoSettingsScopeFilter &filter = this->scope.voltage[channel].filter;
+        if (store->contains("filterType")) filter.type = (Dso::FilterType)store->value("filterType").toInt();
+        if (store->contains("filterDesign")) filter.design = (Dso::FilterDesign)store->value("filterDesign").toInt();
+        if (store->contains("filterLow")) filter.low = store->value("filterLow").toDouble();
+        if (store->contains("filterHigh")) filter.high = store->value("filterHigh").toDouble();
+        if (store->contains("filterTaps")) filter.taps = store->value("filterTaps").toUInt();
+        if (store->contains("filterOrder")) filter.order = store->value("filterOrder").toUInt();
         store->endGroup();
     }
     if (store->contains("spectrumLimit")) this->scope.spectrumLimit = store->value("spectrumLimit").toDouble();
@@ -185,6 +355,36 @@ void DsoSettings::load() {
         this->scope.spectrumReference = store->value("spectrumReference").toDouble();
     if (store->contains("spectrumWindow"))
         this->scope.spectrumWindow = (Dso::WindowFunction)store->value("spectrumWindow").toInt();
+    if (store->contains("compactSamples")) this->scope.compactSamples = store->value("compactSamples").toBool();
+    if (store->contains("losslessCapture")) this->scope.losslessCapture = store->value("losslessCapture").toBool();
+    if (store->contains("historyMemory")) this->scope.historyMemory = store->value("historyMemory").toUInt();
+    if (store->contains("compressCaptures"))
+        this->scope.compressCaptures = store->value("compressCaptures").toBool();
+    if (store->contains("spectrumPatientPlanning"))
+        this->scope.spectrumPatientPlanning = store->value("spectrumPatientPlanning").toBool();
+    if (store->contains("spectrumSinglePrecision"))
+        this->scope.spectrumSinglePrecision = store->value("spectrumSinglePrecision").toBool();
+    if (store->contains("spectrumGpu")) this->scope.spectrumGpu = store->value("spectrumGpu").toBool();
+    if (store->contains("spectrumAveraging"))
+        this->scope.spectrumAveraging = (Dso::SpectrumAveraging)store->value("spectrumAveraging").toInt();
+    if (store->contains("spectrumAverages"))
+        this->scope.spectrumAverages = store->value("spectrumAverages").toUInt();
+    if (store->contains("spectrogram")) this->scope.spectrogram = store->value("spectrogram").toBool();
+    if (store->contains("spectrogramSegment"))
+        this->scope.spectrogramSegment = store->value("spectrogramSegment").toUInt();
+    if (store->contains("spectrumZoom")) this->scope.spectrumZoom = store->value("spectrumZoom").toBool();
+    if (store->contains("spectrumZoomCenter"))
+        this->scope.spectrumZoomCenter = store->value("spectrumZoomCenter").toDouble();
+    if (store->contains("spectrumZoomFactor"))
+        this->scope.spectrumZoomFactor = store->value("spectrumZoomFactor").toUInt();
+    if (store->contains("frequencyEstimator"))
+        this->scope.frequencyEstimator = (Dso::FrequencyEstimator)store->value("frequencyEstimator").toInt();
+    if (store->contains("measurements")) this->scope.measurements = store->value("measurements").toUInt();
+    if (store->contains("analysisRegion")) this->scope.analysisRegion = store->value("analysisRegion").toBool();
+    if (store->contains("spectrumRegion")) this->scope.spectrumRegion = store->value("spectrumRegion").toBool();
+    if (store->contains("mathFactor1")) this->scope.mathFactors[0] = store->value("mathFactor1").toDouble();
+    if (store->contains("mathFactor2")) this->scope.mathFactors[1] = store->value("mathFactor2").toDouble();
+    if (store->contains("mathExpression")) this->scope.mathExpression = store->value("mathExpression").toString();
     store->endGroup();
 
     // View
@@ -220,10 +420,16 @@ void DsoSettings::load() {
     store->endGroup();
     // Other view settings
     if (store->contains("digitalPhosphor")) this->view.digitalPhosphor = store->value("digitalPhosphor").toBool();
+    if (store->contains("phosphorAccumulation"))
+        this->view.phosphorAccumulation = store->value("phosphorAccumulation").toBool();
+    if (store->contains("persistenceMap")) this->view.persistenceMap = store->value("persistenceMap").toBool();
+    if (store->contains("xyDensity")) this->view.xyDensity = store->value("xyDensity").toBool();
     if (store->contains("interpolation"))
         this->view.interpolation = (Dso::InterpolationMode)store->value("interpolation").toInt();
     if (store->contains("screenColorImages")) this->view.screenColorImages = store->value("screenColorImages").toBool();
     if (store->contains("zoom")) this->view.zoom = (Dso::InterpolationMode)store->value("zoom").toBool();
+    if (store->contains("maximumFrameRate")) this->view.maximumFrameRate = store->value("maximumFrameRate").toInt();
+    if (store->contains("powerSaving")) this->view.powerSaving = store->value("powerSaving").toBool();
     store->endGroup();
 
     store->beginGroup("window");
@@ -251,6 +457,12 @@ void DsoSettings::save() {
     store->setValue("recordLength", this->scope.horizontal.recordLength);
     store->setValue("samplerate", this->scope.horizontal.samplerate);
     store->setValue("samplerateSet", this->scope.horizontal.samplerateSet);
+    store->setValue("streaming", this->scope.horizontal.streaming);
+    store->setValue("segments", this->scope.horizontal.segments);
+    store->setValue("acquisitionMode", this->scope.horizontal.acquisitionMode);
+    store->setValue("averages", this->scope.horizontal.averages);
+    store->setValue("highResolution", this->scope.horizontal.highResolution);
+    store->setValue("equivalentTime", this->scope.horizontal.equivalentTime);
     store->endGroup();
     // Trigger
     store->beginGroup("trigger");
@@ -260,6 +472,47 @@ void DsoSettings::save() {
     store->setValue("slope", this->scope.trigger.slope);
     store->setValue("source", this->scope.trigger.source);
     store->setValue("special", this->scope.trigger.special);
+    store->setValue("hysteresis", this->scope.trigger.hysteresis);
+    store->setValue("type", this->scope.trigger.type);
+    store->setValue("height", this->scope.trigger.height);
+    store->setValue("duration", this->scope.trigger.duration);
+    store->setValue("shorter", this->scope.trigger.shorter);
+    store->setValue("sinc", this->scope.trigger.sinc);
+    store->endGroup();
+    // Protocol decoder
+    store->beginGroup("decoder");
+    const DsoSettingsScopeDecoder &decoder = this->scope.decoder;
+    store->setValue("protocol", decoder.protocol);
+    store->setValue("source1", decoder.sources[0]);
+    store->setValue("source2", decoder.sources[1]);
+    store->setValue("threshold", decoder.threshold);
+    store->setValue("hysteresis", decoder.hysteresis);
+    store->setValue("baudrate", decoder.baudrate);
+    store->setValue("dataBits", decoder.dataBits);
+    store->setValue("parity", decoder.parity);
+    store->setValue("stopBits", decoder.stopBits);
+    store->setValue("inverted", decoder.inverted);
+    store->setValue("clockSlope", decoder.clockSlope);
+    store->setValue("wordBits", decoder.wordBits);
+    store->setValue("lsbFirst", decoder.lsbFirst);
+    store->endGroup();
+    // Mask test
+    store->beginGroup("mask");
+    const DsoSettingsScopeMask &mask = this->scope.mask;
+    store->setValue("enabled", mask.enabled);
+    store->setValue("channel", mask.channel);
+    store->setValue("xTolerance", mask.xTolerance);
+    store->setValue("yTolerance", mask.yTolerance);
+    store->setValue("stopOnFail", mask.stopOnFail);
+    store->setValue("saveOnFail", mask.saveOnFail);
+    store->setValue("savePath", mask.savePath);
+    store->remove("polygons");
+    store->beginWriteArray("polygons", (int)mask.polygons.size());
+    for (size_t polygon = 0; polygon < mask.polygons.size(); ++polygon) {
+        store->setArrayIndex((int)polygon);
+        store->setValue("points", mask.polygons[polygon]);
+    }
+    store->endArray();
     store->endGroup();
     // Spectrum
     for (int channel = 0; channel < this->scope.spectrum.count(); ++channel) {
@@ -277,11 +530,39 @@ void DsoSettings::save() {
         store->setValue("offset", this->scope.voltage[channel].offset);
         store->setValue("trigger", this->scope.voltage[channel].trigger);
         store->setValue("used", this->scope.voltage[channel].used);
+        const DsoSettingsScopeFilter &filter = this->scope.voltage[channel].filter;
+        store->setValue("filterType", filter.type);
+        store->setValue("filterDesign", filter.design);
+        store->setValue("filterLow", filter.low);
+        store->setValue("filterHigh", filter.high);
+        store->setValue("filterTaps", filter.taps);
+        store->setValue("filterOrder", filter.order);
         store->endGroup();
     }
     store->setValue("spectrumLimit", this->scope.spectrumLimit);
     store->setValue("spectrumReference", this->scope.spectrumReference);
     store->setValue("spectrumWindow", this->scope.spectrumWindow);
+    store->setValue("compactSamples", this->scope.compactSamples);
+    store->setValue("losslessCapture", this->scope.losslessCapture);
+    store->setValue("historyMemory", this->scope.historyMemory);
+    store->setValue("compressCaptures", this->scope.compressCaptures);
+    store->setValue("spectrumPatientPlanning", this->scope.spectrumPatientPlanning);
+    store->setValue("spectrumSinglePrecision", this->scope.spectrumSinglePrecision);
+    store->setValue("spectrumGpu", this->scope.spectrumGpu);
+    store->setValue("spectrumAveraging", this->scope.spectrumAveraging);
+    store->setValue("spectrumAverages", this->scope.spectrumAverages);
+    store->setValue("spectrogram", this->scope.spectrogram);
+    store->setValue("spectrogramSegment", this->scope.spectrogramSegment);
+    store->setValue("spectrumZoom", this->scope.spectrumZoom);
+    store->setValue("spectrumZoomCenter", this->scope.spectrumZoomCenter);
+    store->setValue("spectrumZoomFactor", this->scope.spectrumZoomFactor);
+    store->setValue("frequencyEstimator", this->scope.frequencyEstimator);
+    store->setValue("measurements", this->scope.measurements);
+    store->setValue("analysisRegion", this->scope.analysisRegion);
+    store->setValue("spectrumRegion", this->scope.spectrumRegion);
+    store->setValue("mathFactor1", this->scope.mathFactors[0]);
+    store->setValue("mathFactor2", this->scope.mathFactors[1]);
+    store->setValue("mathExpression", this->scope.mathExpression);
     store->endGroup();
 
     // View
@@ -315,9 +596,14 @@ void DsoSettings::save() {
 
     // Other view settings
     store->setValue("digitalPhosphor", this->view.digitalPhosphor);
+    store->setValue("phosphorAccumulation", this->view.phosphorAccumulation);
+    store->setValue("persistenceMap", this->view.persistenceMap);
+    store->setValue("xyDensity", this->view.xyDensity);
     store->setValue("interpolation", this->view.interpolation);
     store->setValue("screenColorImages", this->view.screenColorImages);
     store->setValue("zoom", this->view.zoom);
+    store->setValue("maximumFrameRate", this->view.maximumFrameRate);
+    store->setValue("powerSaving", this->view.powerSaving);
     store->endGroup();
 
     store->beginGroup("window");
@@ -325,3 +611,133 @@ void DsoSettings::save() {
     store->setValue("state", mainWindowState);
     store->endGroup();
 }
+
+QByteArray DsoSettings::snapshot() const {
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_4);
+    stream << SNAPSHOT_MAGIC << SNAPSHOT_VERSION;
+
+    // The fields are transferred by reference, so a copy is written
+    DsoSettingsScope written = this->scope;
+    SnapshotStream transfer(stream, false);
+    transferScope(transfer, written);
+    return data;
+}
+
+bool DsoSettings::restoreSnapshot(const QByteArray &data) {
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_4);
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != SNAPSHOT_MAGIC || !version || version > SNAPSHOT_VERSION) return false;
+
+    // The settings are only replaced if the whole snapshot could be read
+    DsoSettingsScope restored = this->scope;
+    SnapshotStream transfer(stream, true, version);
+    transferScope(transfer, restored);
+    if (stream.status() != QDataStream::Ok || !stream.atEnd()) return false;
+
+    // The marker visibility isn't a setting
+    for (int marker = 0; marker < MARKER_COUNT; ++marker)
+        restored.horizontal.marker_visible[marker] = this->scope.horizontal.marker_visible[marker];
+    this->scope = restored;
+    return true;
+}
+
+QStringList DsoSettings::snapshotNames() const {
+    QStringList names;
+    for (const QPair<QString, QByteArray> &snapshot : readSnapshots()) names << snapshot.first;
+    return names;
+}
+
+void DsoSettings::storeSnapshot(const QString &name) {
+    QList<QPair<QString, QByteArray>> snapshots = readSnapshots();
+    const QByteArray data = snapshot();
+    bool replaced = false;
+    for (QPair<QString, QByteArray> &stored : snapshots) {
+        if (stored.first != name) continue;
+        stored.second = data;
+        replaced = true;
+    }
+    if (!replaced) snapshots.append(qMakePair(name, data));
+    writeSnapshots(snapshots);
+}
+
+bool DsoSettings::loadSnapshot(const QString &name) {
+    for (const QPair<QString, QByteArray> &snapshot : readSnapshots())
+        if (snapshot.first == name) return restoreSnapshot(snapshot.second);
+    return false;
+}
+
+void DsoSettings::removeSnapshot(const QString &name) {
+    QList<QPair<QString, QByteArray>> snapshots = readSnapshots();
+    for (int index = snapshots.count() - 1; index >= 0; --index)
+        if (snapshots[index].first == name) snapshots.removeAt(index);
+    writeSnapshots(snapshots);
+}
+
+/// \brief Reads all stored snapshots, every one is a single value of the settings file.
+QList<QPair<QString, QByteArray>> DsoSettings::readSnapshots() const {
+    QList<QPair<QString, QByteArray>> snapshots;
+    const int count = store->beginReadArray("snapshots");
+    for (int index = 0; index < count; ++index) {
+        store->setArrayIndex(index);
+        snapshots.append(qMakePair(store->value("name").toString(), store->value("data").toByteArray()));
+    }
+    store->endArray();
+    return snapshots;
+}
+
+/// \brief Replaces the stored snapshots, they are written at once and don't wait for save().
+void DsoSettings::writeSnapshots(const QList<QPair<QString, QByteArray>> &snapshots) {
+    store->remove("snapshots");
+    store->beginWriteArray("snapshots", snapshots.count());
+    for (int index = 0; index < snapshots.count(); ++index) {
+        store->setArrayIndex(index);
+        store->setValue("name", snapshots[index].first);
+        store->setValue("data", snapshots[index].second);
+    }
+    store->endArray();
+    store->sync();
+}
+
+DeviceConfiguration DsoSettings::deviceConfiguration(const std::vector<unsigned> &recordLengths) const {
+    const bool mathUsed = scope.voltage[scope.physicalChannels].used | scope.spectrum[scope.physicalChannels].used;
+    DeviceConfiguration configuration;
+    configuration.channels.resize(scope.physicalChannels);
+    for (unsigned int channel = 0; channel < scope.physicalChannels; ++channel) {
+        const DsoSettingsScopeVoltage &voltage = scope.voltage[channel];
+        DeviceChannelConfiguration &channelConfiguration = configuration.channels[channel];
+        channelConfiguration.used = mathUsed | voltage.used | scope.spectrum[channel].used;
+        channelConfiguration.coupling = (Dso::Coupling)voltage.misc;
+        channelConfiguration.gain = voltage.gain * DIVS_VOLTAGE;
+        channelConfiguration.offset = (voltage.offset / DIVS_VOLTAGE) + 0.5;
+        channelConfiguration.triggerLevel = voltage.trigger;
+    }
+    configuration.samplerateSet = scope.horizontal.samplerateSet;
+    configuration.samplerate = scope.horizontal.samplerate;
+    configuration.recordTime = scope.horizontal.timebase * DIVS_TIME;
+    if (recordLengths.empty())
+        configuration.recordLength = scope.horizontal.recordLength;
+    else {
+        ptrdiff_t index = std::distance(recordLengths.begin(), std::find(recordLengths.begin(), recordLengths.end(),
+                                                                         scope.horizontal.recordLength));
+        configuration.recordLength = (unsigned)(index < 0 ? 1 : index);
+    }
+    configuration.triggerMode = scope.trigger.mode;
+    configuration.pretriggerPosition = scope.trigger.position * scope.horizontal.timebase * DIVS_TIME;
+    configuration.triggerSlope = scope.trigger.slope;
+    configuration.triggerSpecial = scope.trigger.special;
+    configuration.triggerSource = scope.trigger.source;
+    configuration.acquisitionMode = scope.horizontal.acquisitionMode;
+    configuration.acquisitionCount = scope.horizontal.acquisitionMode == Dso::ACQUISITION_HIGHRES
+                                         ? scope.horizontal.highResolution
+                                         : scope.horizontal.averages;
+    configuration.streaming = scope.horizontal.streaming;
+    configuration.compactSamples = scope.compactSamples;
+    configuration.losslessCapture = scope.losslessCapture;
+    configuration.historyMemory = scope.historyMemory;
+    return configuration;
+}
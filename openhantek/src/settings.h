@@ -2,11 +2,17 @@
 
 #pragma once
 
+#include <QByteArray>
+#include <QList>
+#include <QPair>
 #include <QSettings>
 #include <QSize>
 #include <QString>
+#include <QStringList>
 #include <memory>
+#include <vector>
 
+#include "hantek/deviceconfiguration.h"
 #include "scopesettings.h"
 #include "viewsettings.h"
 
@@ -23,7 +29,8 @@ struct DsoSettingsOptions {
 /// \brief Holds the settings of the program.
 class DsoSettings {
   public:
-    DsoSettings();
+    /// \param profile Name of a separate settings profile, the default settings are used if empty.
+    DsoSettings(const QString &profile = QString());
     bool setFilename(const QString &filename);
 
     void setChannelCount(unsigned int channels);
@@ -41,6 +48,37 @@ class DsoSettings {
     /// \brief Save the settings to the harddisk.
     void save();
 
+    /// \brief Serializes the oscilloscope settings into one compact block.
+    /// \return The settings, they can be restored with restoreSnapshot().
+    QByteArray snapshot() const;
+
+    /// \brief Replaces the oscilloscope settings by a snapshot.
+    /// \param data The snapshot, it has to be taken with the same number of channels.
+    /// \return false, if the snapshot is damaged or doesn't fit, the settings are unchanged then.
+    bool restoreSnapshot(const QByteArray &data);
+
+    /// \return The names of the stored snapshots in the order they were stored.
+    QStringList snapshotNames() const;
+
+    /// \brief Stores a snapshot of the current oscilloscope settings with the other settings.
+    /// \param name The name of the snapshot, an existing snapshot with the name is replaced.
+    void storeSnapshot(const QString &name);
+
+    /// \brief Restores a stored snapshot, see restoreSnapshot().
+    /// \return false, if there is no usable snapshot with the name.
+    bool loadSnapshot(const QString &name);
+
+    /// \brief Removes a stored snapshot.
+    void removeSnapshot(const QString &name);
+
+    /// \brief Collects the settings of the device, see HantekDsoControl::applyConfiguration().
+    /// \param recordLengths The selectable record lengths of the device, empty if the length is free.
+    /// \return The physical channels, the horizontal axis and the trigger.
+    DeviceConfiguration deviceConfiguration(const std::vector<unsigned> &recordLengths) const;
+
   private:
+    QList<QPair<QString, QByteArray>> readSnapshots() const;
+    void writeSnapshots(const QList<QPair<QString, QByteArray>> &snapshots);
+
     std::unique_ptr<QSettings> store = std::unique_ptr<QSettings>(new QSettings);
 };
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QColor>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+
+#include "spectrogram.h"
+
+#include "viewconstants.h"
+
+const unsigned int Spectrogram::WIDTH;
+const unsigned int Spectrogram::HEIGHT;
+
+namespace {
+/// \return The RGBA colors of 256 levels from blue to red.
+std::vector<quint8> levelColors() {
+    std::vector<quint8> colormap(256 * 4);
+    for (int level = 0; level < 256; ++level) {
+        const QColor color = QColor::fromHsvF((255 - level) / 255.0 * 2.0 / 3.0, 1.0, 1.0);
+        colormap[level * 4] = (quint8)color.red();
+        colormap[level * 4 + 1] = (quint8)color.green();
+        colormap[level * 4 + 2] = (quint8)color.blue();
+        colormap[level * 4 + 3] = 0xff;
+    }
+    return colormap;
+}
+} // namespace
+
+// The first copy takes the whole ring
+Spectrogram::Spectrogram() : image(WIDTH * HEIGHT * 4, 0), revision(HEIGHT) {}
+
+void Spectrogram::clear() {
+    QMutexLocker locker(&mutex);
+    std::fill(image.begin(), image.end(), 0);
+    next = 0;
+    // Every copy is outdated by a whole ring
+    revision += HEIGHT;
+}
+
+void Spectrogram::add(const double *levels, unsigned int rows, unsigned int binCount, double start, double binWidth,
+                      double xScale, double yScale, double yOffset) {
+    if (start != lastStart || binWidth != lastBinWidth || xScale != lastXScale || yScale != lastYScale ||
+        yOffset != lastYOffset) {
+        clear();
+        lastStart = start;
+        lastBinWidth = binWidth;
+        lastXScale = xScale;
+        lastYScale = yScale;
+        lastYOffset = yOffset;
+    }
+
+    // Rows that would be overwritten by the same spectra are skipped
+    const unsigned int skipped = (rows > HEIGHT) ? rows - HEIGHT : 0;
+    QMutexLocker locker(&mutex);
+    for (unsigned int row = skipped; row < rows; ++row) {
+        colorizeRow(levels + (size_t)row * binCount, binCount, &image[(size_t)next * WIDTH * 4]);
+        next = (next + 1) % HEIGHT;
+    }
+    revision += rows - skipped;
+}
+
+unsigned int Spectrogram::changes(quint64 &revision, std::vector<quint8> &pixels, unsigned int &first) const {
+    QMutexLocker locker(&mutex);
+    const quint64 behind = this->revision - revision;
+    if (behind == 0) return 0;
+    // All rows are copied from the oldest one
+    unsigned int count = HEIGHT;
+    first = next;
+    if (revision != 0 && revision < this->revision && behind < HEIGHT) {
+        count = (unsigned int)behind;
+        first = (next + HEIGHT - count) % HEIGHT;
+    }
+    revision = this->revision;
+
+    // The rows are copied in ring order, they may wrap around the end of the ring
+    const size_t rowSize = WIDTH * 4;
+    const unsigned int tail = std::min(count, HEIGHT - first);
+    pixels.resize(count * rowSize);
+    std::copy(image.begin() + first * rowSize, image.begin() + (first + tail) * rowSize, pixels.begin());
+    std::copy(image.begin(), image.begin() + (count - tail) * rowSize, pixels.begin() + tail * rowSize);
+    return count;
+}
+
+/// \brief Colors the level of the bins in every column of a row.
+/// Every column shows the highest bin in it, or the nearest bin if the bins are wider than the columns.
+void Spectrogram::colorizeRow(const double *levels, unsigned int binCount, quint8 *row) const {
+    static const std::vector<quint8> colormap = levelColors();
+
+    const double step = lastBinWidth * lastXScale * WIDTH / DIVS_TIME; // Columns per bin
+    const double shift = lastStart * lastXScale * WIDTH / DIVS_TIME;   // The column of the first bin
+    if (!(step > 0.0)) {
+        std::fill(row, row + WIDTH * 4, 0);
+        return;
+    }
+    for (unsigned int column = 0; column < WIDTH; ++column) {
+        quint8 *pixel = row + column * 4;
+        // The bins whose frequency is in the column, the one nearest to its center if there is none
+        const double left = (column - shift) / step;
+        const double right = (column + 1 - shift) / step;
+        if (!(right > 0.0)) {
+            pixel[3] = 0;
+            continue;
+        }
+        size_t firstBin = (size_t)std::ceil(std::max(left, 0.0));
+        size_t lastBin = (size_t)std::ceil(right);
+        if (firstBin == lastBin) {
+            firstBin = (size_t)std::floor((left + right) / 2 + 0.5);
+            lastBin = firstBin + 1;
+        }
+        lastBin = std::min(lastBin, (size_t)binCount);
+        if (firstBin >= lastBin) {
+            pixel[3] = 0;
+            continue;
+        }
+
+        const double level = *std::max_element(levels + firstBin, levels + lastBin);
+        const double height = (level * lastYScale + lastYOffset + DIVS_VOLTAGE / 2) / DIVS_VOLTAGE;
+        if (!(height > 0.0)) {
+            pixel[3] = 0;
+            continue;
+        }
+        const int color = std::min((int)(height * 255), 255);
+        std::copy(&colormap[color * 4], &colormap[color * 4] + 4, pixel);
+    }
+}
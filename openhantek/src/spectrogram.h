@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+#include <QtGlobal>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class Spectrogram                                             spectrogram.h
+/// \brief Scrolling waterfall of the short time spectra of a channel.
+/// Every spectrum becomes a row of colored pixels over the frequency axis of
+/// the screen. The rows are kept in a ring of fixed size, the newest row
+/// overwrites the oldest one, so a scope only has to upload the rows that were
+/// added since its last upload. The levels are colored from blue at the bottom
+/// to red at the top of the spectrum graph, levels below the screen are
+/// transparent.
+///
+/// The rows are added by the generator thread and copied by the gui thread.
+class Spectrogram {
+  public:
+    Spectrogram();
+
+    /// \brief Forgets all rows.
+    void clear();
+
+    /// \brief Adds spectra as the newest rows.
+    /// The rows start again if the scaling is not the same as for the last spectra.
+    /// \param levels The levels of the bins in dB, row by row from the oldest spectrum.
+    /// \param rows The number of spectra.
+    /// \param binCount The number of bins in a spectrum.
+    /// \param start The frequency of the first bin relative to the left edge of the screen.
+    /// \param binWidth The frequency step between the bins.
+    /// \param xScale The divs per hertz.
+    /// \param yScale The divs per decibel.
+    /// \param yOffset The vertical position of the zero line in divs.
+    void add(const double *levels, unsigned int rows, unsigned int binCount, double start, double binWidth,
+             double xScale, double yScale, double yOffset);
+
+    /// \brief Copies the rows that were added since an earlier copy.
+    /// All rows are copied for the first copy or if the ring was cleared or overwritten since.
+    /// \param revision The revision of the earlier copy, 0 for none. Is set to the current revision.
+    /// \param pixels Is set to the RGBA pixels of the copied rows.
+    /// \param first Is set to the ring row of the first copied row, the rows wrap around at the end of the ring.
+    /// The row after the copied rows is the one that is written next.
+    /// \return The number of copied rows, 0 if nothing changed.
+    unsigned int changes(quint64 &revision, std::vector<quint8> &pixels, unsigned int &first) const;
+
+    static const unsigned int WIDTH = 1000; ///< The columns over the screen, 100 per div
+    static const unsigned int HEIGHT = 512; ///< The number of rows in the ring
+
+  private:
+    void colorizeRow(const double *levels, unsigned int binCount, quint8 *row) const;
+
+    mutable QMutex mutex;      ///< Protects the ring, it is copied by another thread
+    std::vector<quint8> image; ///< The ring of RGBA rows
+    unsigned int next = 0;     ///< The ring row that is written next
+    quint64 revision;          ///< Counts the written rows, a clear counts as a whole ring
+    // The scaling of the rows in the ring
+    double lastStart = 0.0;
+    double lastBinWidth = 0.0;
+    double lastXScale = 0.0;
+    double lastYScale = 0.0;
+    double lastYOffset = 0.0;
+};
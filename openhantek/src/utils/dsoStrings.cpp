@@ -21,10 +21,13 @@
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-#include <QApplication>
+#include <QCoreApplication>
 
 #include "definitions.h"
 
+// The strings keep the translation context of the gui, but don't need QtWidgets
+#define tr(msg) QCoreApplication::translate("QApplication", msg)
+
 namespace Dso {
 /// \brief Return string representation of the given channel mode.
 /// \param mode The ::ChannelMode that should be returned as string.
@@ -32,9 +35,9 @@ namespace Dso {
 QString channelModeString(ChannelMode mode) {
     switch (mode) {
     case CHANNELMODE_VOLTAGE:
-        return QApplication::tr("Voltage");
+        return tr("Voltage");
     case CHANNELMODE_SPECTRUM:
-        return QApplication::tr("Spectrum");
+        return tr("Spectrum");
     default:
         return QString();
     }
@@ -46,9 +49,9 @@ QString channelModeString(ChannelMode mode) {
 QString graphFormatString(GraphFormat format) {
     switch (format) {
     case GRAPHFORMAT_TY:
-        return QApplication::tr("T - Y");
+        return tr("T - Y");
     case GRAPHFORMAT_XY:
-        return QApplication::tr("X - Y");
+        return tr("X - Y");
     default:
         return QString();
     }
@@ -60,11 +63,11 @@ QString graphFormatString(GraphFormat format) {
 QString couplingString(Coupling coupling) {
     switch (coupling) {
     case COUPLING_AC:
-        return QApplication::tr("AC");
+        return tr("AC");
     case COUPLING_DC:
-        return QApplication::tr("DC");
+        return tr("DC");
     case COUPLING_GND:
-        return QApplication::tr("GND");
+        return tr("GND");
     default:
         return QString();
     }
@@ -76,11 +79,21 @@ QString couplingString(Coupling coupling) {
 QString mathModeString(MathMode mode) {
     switch (mode) {
     case MATHMODE_1ADD2:
-        return QApplication::tr("CH1 + CH2");
+        return tr("CH1 + CH2");
     case MATHMODE_1SUB2:
-        return QApplication::tr("CH1 - CH2");
+        return tr("CH1 - CH2");
     case MATHMODE_2SUB1:
-        return QApplication::tr("CH2 - CH1");
+        return tr("CH2 - CH1");
+    case MATHMODE_1MUL2:
+        return tr("CH1 * CH2");
+    case MATHMODE_ABS1:
+        return tr("|CH1|");
+    case MATHMODE_ABS2:
+        return tr("|CH2|");
+    case MATHMODE_SCALEDSUM:
+        return tr("a * CH1 + b * CH2");
+    case MATHMODE_EXPRESSION:
+        return tr("Formula");
     default:
         return QString();
     }
@@ -92,13 +105,13 @@ QString mathModeString(MathMode mode) {
 QString triggerModeString(TriggerMode mode) {
     switch (mode) {
     case TRIGGERMODE_AUTO:
-        return QApplication::tr("Auto");
+        return tr("Auto");
     case TRIGGERMODE_NORMAL:
-        return QApplication::tr("Normal");
+        return tr("Normal");
     case TRIGGERMODE_SINGLE:
-        return QApplication::tr("Single");
+        return tr("Single");
     case TRIGGERMODE_SOFTWARE:
-        return QApplication::tr("Software");
+        return tr("Software");
     default:
         return QString();
     }
@@ -118,41 +131,79 @@ QString slopeString(Slope slope) {
     }
 }
 
+/// \brief Return string representation of the given software trigger type.
+/// \param type The ::TriggerType that should be returned as string.
+/// \return The string that should be used in labels etc.
+QString triggerTypeString(TriggerType type) {
+    switch (type) {
+    case TRIGGERTYPE_EDGE:
+        return tr("Edge");
+    case TRIGGERTYPE_PULSEWIDTH:
+        return tr("Pulse width");
+    case TRIGGERTYPE_RUNT:
+        return tr("Runt");
+    case TRIGGERTYPE_WINDOW:
+        return tr("Window");
+    case TRIGGERTYPE_TIMEOUT:
+        return tr("Timeout");
+    default:
+        return QString();
+    }
+}
+
+/// \brief Return string representation of the given acquisition mode.
+/// \param mode The ::AcquisitionMode that should be returned as string.
+/// \return The string that should be used in labels etc.
+QString acquisitionModeString(AcquisitionMode mode) {
+    switch (mode) {
+    case ACQUISITION_NORMAL:
+        return tr("Normal");
+    case ACQUISITION_AVERAGE:
+        return tr("Average");
+    case ACQUISITION_HIGHRES:
+        return tr("High resolution");
+    case ACQUISITION_EQUIVALENT:
+        return tr("Equivalent time");
+    default:
+        return QString();
+    }
+}
+
 /// \brief Return string representation of the given dft window function.
 /// \param window The ::WindowFunction that should be returned as string.
 /// \return The string that should be used in labels etc.
 QString windowFunctionString(WindowFunction window) {
     switch (window) {
     case WINDOW_RECTANGULAR:
-        return QApplication::tr("Rectangular");
+        return tr("Rectangular");
     case WINDOW_HAMMING:
-        return QApplication::tr("Hamming");
+        return tr("Hamming");
     case WINDOW_HANN:
-        return QApplication::tr("Hann");
+        return tr("Hann");
     case WINDOW_COSINE:
-        return QApplication::tr("Cosine");
+        return tr("Cosine");
     case WINDOW_LANCZOS:
-        return QApplication::tr("Lanczos");
+        return tr("Lanczos");
     case WINDOW_BARTLETT:
-        return QApplication::tr("Bartlett");
+        return tr("Bartlett");
     case WINDOW_TRIANGULAR:
-        return QApplication::tr("Triangular");
+        return tr("Triangular");
     case WINDOW_GAUSS:
-        return QApplication::tr("Gauss");
+        return tr("Gauss");
     case WINDOW_BARTLETTHANN:
-        return QApplication::tr("Bartlett-Hann");
+        return tr("Bartlett-Hann");
     case WINDOW_BLACKMAN:
-        return QApplication::tr("Blackman");
+        return tr("Blackman");
     // case WINDOW_KAISER:
-    //	return QApplication::tr("Kaiser");
+    //	return tr("Kaiser");
     case WINDOW_NUTTALL:
-        return QApplication::tr("Nuttall");
+        return tr("Nuttall");
     case WINDOW_BLACKMANHARRIS:
-        return QApplication::tr("Blackman-Harris");
+        return tr("Blackman-Harris");
     case WINDOW_BLACKMANNUTTALL:
-        return QApplication::tr("Blackman-Nuttall");
+        return tr("Blackman-Nuttall");
     case WINDOW_FLATTOP:
-        return QApplication::tr("Flat top");
+        return tr("Flat top");
     default:
         return QString();
     }
@@ -165,11 +216,41 @@ QString windowFunctionString(WindowFunction window) {
 QString interpolationModeString(InterpolationMode interpolation) {
     switch (interpolation) {
     case INTERPOLATION_OFF:
-        return QApplication::tr("Off");
+        return tr("Off");
     case INTERPOLATION_LINEAR:
-        return QApplication::tr("Linear");
+        return tr("Linear");
     case INTERPOLATION_SINC:
-        return QApplication::tr("Sinc");
+        return tr("Sinc");
+    default:
+        return QString();
+    }
+}
+
+/// \brief Return string representation of the given automatic measurement.
+/// \param measurement The ::Measurement that should be returned as string.
+/// \return The string that should be used in labels etc.
+QString measurementString(Measurement measurement) {
+    switch (measurement) {
+    case MEASUREMENT_RMS:
+        return tr("RMS");
+    case MEASUREMENT_MEAN:
+        return tr("Mean");
+    case MEASUREMENT_MINIMUM:
+        return tr("Min");
+    case MEASUREMENT_MAXIMUM:
+        return tr("Max");
+    case MEASUREMENT_RISETIME:
+        return tr("Rise");
+    case MEASUREMENT_FALLTIME:
+        return tr("Fall");
+    case MEASUREMENT_DUTYCYCLE:
+        return tr("Duty");
+    case MEASUREMENT_PERIOD:
+        return tr("Period");
+    case MEASUREMENT_OVERSHOOT:
+        return tr("Overshoot");
+    case MEASUREMENT_PHASE:
+        return tr("Phase");
     default:
         return QString();
     }
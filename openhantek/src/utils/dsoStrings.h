@@ -15,6 +15,9 @@ QString couplingString(Coupling coupling);
 QString mathModeString(MathMode mode);
 QString triggerModeString(TriggerMode mode);
 QString slopeString(Slope slope);
+QString triggerTypeString(TriggerType type);
+QString acquisitionModeString(AcquisitionMode mode);
 QString windowFunctionString(WindowFunction window);
 QString interpolationModeString(InterpolationMode interpolation);
+QString measurementString(Measurement measurement);
 }
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <QByteArray>
+
+#include "utils/floatformat.h"
+
+namespace {
+static const unsigned MAX_FRACTION = 17;                 ///< The maximal number of fractional digits
+static const double MAX_MANTISSA = 9007199254740992.0;   ///< 2^53, all smaller integers are exact doubles
+static const double POWERS[MAX_FRACTION + 1] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,
+                                                1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17};
+
+/// \brief Writes the digits of an integer, at least minimum digits.
+char *writeDigits(uint64_t value, unsigned minimum, char *target) {
+    char digits[24];
+    unsigned count = 0;
+    do {
+        digits[count++] = char('0' + value % 10);
+        value /= 10;
+    } while (value || count < minimum);
+    while (count) *target++ = digits[--count];
+    return target;
+}
+}
+
+namespace FloatFormat {
+
+char *format(double value, char *target) {
+    if (std::isnan(value)) {
+        std::memcpy(target, "nan", 3);
+        return target + 3;
+    }
+    if (std::isinf(value)) {
+        if (value < 0) *target++ = '-';
+        std::memcpy(target, "inf", 3);
+        return target + 3;
+    }
+    if (value == 0.0) {
+        *target++ = '0';
+        return target;
+    }
+
+    char *position = target;
+    double magnitude = value;
+    if (magnitude < 0) {
+        *position++ = '-';
+        magnitude = -magnitude;
+    }
+
+    // Find the fewest fractional digits that read back exactly. A mantissa below 2^53 and a
+    // power of ten up to 1e22 are exact, so the division is what a correct parser computes.
+    for (unsigned fraction = 0; fraction <= MAX_FRACTION; ++fraction) {
+        const double shifted = std::round(magnitude * POWERS[fraction]);
+        if (shifted >= MAX_MANTISSA) break;
+        if (shifted / POWERS[fraction] != magnitude) continue;
+
+        const uint64_t mantissa = (uint64_t)shifted;
+        const uint64_t divisor = (uint64_t)POWERS[fraction];
+        position = writeDigits(mantissa / divisor, 1, position);
+        if (fraction) {
+            *position++ = '.';
+            position = writeDigits(mantissa % divisor, fraction, position);
+        }
+        return position;
+    }
+
+    // Very large or small values, 17 significant digits always read back exactly
+    const QByteArray text = QByteArray::number(value, 'g', 17);
+    std::memcpy(target, text.constData(), (size_t)text.size());
+    return target + text.size();
+}
+}
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+namespace FloatFormat {
+
+static const unsigned MAX_LENGTH = 32; ///< The maximal number of characters written by format()
+
+/// \brief Writes the shortest decimal representation that reads back as the same value.
+/// The output doesn't depend on the locale, it always uses a '.' and no thousands
+/// separators. Values with up to 17 fractional digits and less than 2^53 after
+/// the shift are written in fixed notation, all others with 17 significant digits.
+/// \param value The value, NaN is written as "nan" and infinities as "inf" and "-inf".
+/// \param target The buffer, it has to hold MAX_LENGTH characters, no terminating zero is written.
+/// \return The end of the written characters.
+char *format(double value, char *target);
+}
@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <algorithm>
+#include <limits>
+
+#include "frametrace.h"
+
+namespace {
+/// The names of the tracks of the stages, the last one shows the way of the displayed frames
+const char *TRACK_NAMES[] = {"usb read", "convert", "analyze", "generate", "draw", "frames"};
+const char *STAGE_NAMES[] = {"usbread", "convert", "analyze", "generate", "draw", "frame"};
+static_assert(sizeof(TRACK_NAMES) / sizeof(TRACK_NAMES[0]) == Instrumentation::STAGE_COUNT + 1,
+              "Every stage needs a track");
+
+/// \return The time in microseconds relative to the origin of the trace.
+QString microseconds(qint64 time, qint64 origin) { return QString::number((time - origin) / 1e3, 'f', 3); }
+}
+
+std::atomic<bool> FrameTrace::running(false);
+std::atomic<quint64> FrameTrace::lastDisplayed(0);
+QMutex FrameTrace::mutex;
+std::vector<FrameTrace::Event> FrameTrace::events;
+size_t FrameTrace::capacity = 0;
+size_t FrameTrace::next = 0;
+
+void FrameTrace::start(size_t capacity) {
+    QMutexLocker locker(&mutex);
+    events.clear();
+    events.reserve(capacity);
+    FrameTrace::capacity = capacity;
+    next = 0;
+    lastDisplayed.store(0, std::memory_order_relaxed);
+    running.store(capacity > 0, std::memory_order_relaxed);
+}
+
+void FrameTrace::stop() { running.store(false, std::memory_order_relaxed); }
+
+void FrameTrace::addStage(Instrumentation::Stage stage, quint64 frame, qint64 begin, qint64 end) {
+    if (!isRunning()) return;
+    add(Event{stage, frame, begin, end});
+}
+
+void FrameTrace::addDisplayed(quint64 frame, qint64 captured, qint64 displayed) {
+    if (!isRunning() || frame == 0) return;
+    // Several scopes draw the same frame and it is drawn again on every repaint
+    quint64 last = lastDisplayed.load(std::memory_order_relaxed);
+    do {
+        if (frame <= last) return;
+    } while (!lastDisplayed.compare_exchange_weak(last, frame, std::memory_order_relaxed));
+    add(Event{Instrumentation::STAGE_COUNT, frame, captured, displayed});
+}
+
+void FrameTrace::add(const Event &event) {
+    QMutexLocker locker(&mutex);
+    if (events.size() < capacity)
+        events.push_back(event);
+    else if (capacity > 0)
+        events[next] = event;
+    else
+        return;
+    next = (next + 1) % capacity;
+}
+
+bool FrameTrace::write(const QString &filename, QString &errorMessage) {
+    // The events are copied, so the stages don't wait for the file
+    std::vector<Event> copy;
+    {
+        QMutexLocker locker(&mutex);
+        copy.reserve(events.size());
+        if (events.size() == capacity) copy.insert(copy.end(), events.begin() + next, events.end());
+        copy.insert(copy.end(), events.begin(), events.begin() + (events.size() == capacity ? next : events.size()));
+    }
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        errorMessage = file.errorString();
+        return false;
+    }
+
+    qint64 origin = std::numeric_limits<qint64>::max();
+    for (const Event &event : copy) origin = std::min(origin, event.begin);
+
+    QTextStream stream(&file);
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    // Names and orders the tracks
+    for (int track = 0; track <= Instrumentation::STAGE_COUNT; ++track) {
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track << ",\"args\":{\"name\":\""
+               << TRACK_NAMES[track] << "\"}},\n"
+               << "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track
+               << ",\"args\":{\"sort_index\":" << track << "}}";
+        if (track < Instrumentation::STAGE_COUNT || !copy.empty()) stream << ",";
+        stream << "\n";
+    }
+    for (size_t index = 0; index < copy.size(); ++index) {
+        const Event &event = copy[index];
+        if (event.stage == Instrumentation::STAGE_COUNT) {
+            // The frames overlap each other, so they are shown as asynchronous spans
+            stream << "{\"name\":\"" << STAGE_NAMES[event.stage] << "\",\"cat\":\"latency\",\"ph\":\"b\",\"id\":"
+                   << event.frame << ",\"pid\":1,\"tid\":" << event.stage
+                   << ",\"ts\":" << microseconds(event.begin, origin) << ",\"args\":{\"frame\":" << event.frame
+                   << ",\"latencyMs\":" << QString::number((event.end - event.begin) / 1e6, 'f', 3) << "}},\n"
+                   << "{\"name\":\"" << STAGE_NAMES[event.stage] << "\",\"cat\":\"latency\",\"ph\":\"e\",\"id\":"
+                   << event.frame << ",\"pid\":1,\"tid\":" << event.stage
+                   << ",\"ts\":" << microseconds(event.end, origin) << "}";
+        } else {
+            stream << "{\"name\":\"" << STAGE_NAMES[event.stage] << "\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,"
+                   << "\"tid\":" << event.stage << ",\"ts\":" << microseconds(event.begin, origin)
+                   << ",\"dur\":" << QString::number((event.end - event.begin) / 1e3, 'f', 3)
+                   << ",\"args\":{\"frame\":" << event.frame << "}}";
+        }
+        if (index + 1 < copy.size()) stream << ",";
+        stream << "\n";
+    }
+    stream << "]}\n";
+    stream.flush();
+
+    if (file.error() != QFileDevice::NoError) {
+        errorMessage = file.errorString();
+        return false;
+    }
+    return true;
+}
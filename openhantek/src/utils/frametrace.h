@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+
+#include "instrumentation.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class FrameTrace                                        utils/frametrace.h
+/// \brief Process wide record of the pipeline stages of every frame.
+/// While the trace is running, every stage that knows its frame id adds an event
+/// with its start and end time. The scopes add the time a frame was shown first,
+/// so the whole way of a frame from the usb read to the screen can be followed.
+/// The events are held in a ring, the oldest events are overwritten when it is
+/// full. write() exports them in the Chrome trace event format, which can be
+/// viewed with chrome://tracing or https://ui.perfetto.dev.
+///
+/// All methods may be called from any thread. Nothing is recorded while the
+/// trace isn't running, the stages only check an atomic flag then.
+class FrameTrace {
+  public:
+    /// \brief Starts recording, the events of an earlier trace are discarded.
+    /// \param capacity The maximal number of events that are held.
+    static void start(size_t capacity = DEFAULT_CAPACITY);
+    /// \brief Stops recording, the events are kept until the next start().
+    static void stop();
+    /// \return true, if the events are recorded.
+    static bool isRunning() { return running.load(std::memory_order_relaxed); }
+
+    /// \brief Adds one pass through a stage.
+    /// \param stage The stage.
+    /// \param frame The id of the processed frame, see DSOsamples::frameId.
+    /// \param begin The steady clock time in ns the stage started at.
+    /// \param end The steady clock time in ns the stage ended at.
+    static void addStage(Instrumentation::Stage stage, quint64 frame, qint64 begin, qint64 end);
+
+    /// \brief Adds the time a frame was drawn, only the first drawing of a frame is recorded.
+    /// \param frame The id of the drawn frame.
+    /// \param captured The steady clock time in ns the frame was received at.
+    /// \param displayed The steady clock time in ns the drawing was finished at.
+    static void addDisplayed(quint64 frame, qint64 captured, qint64 displayed);
+
+    /// \brief Writes the recorded events as Chrome trace JSON.
+    /// \param filename The target file.
+    /// \param errorMessage Set to the reason, if the file can't be written.
+    /// \return true on success.
+    static bool write(const QString &filename, QString &errorMessage);
+
+    static const size_t DEFAULT_CAPACITY = 1 << 20; ///< The default number of held events
+
+  private:
+    /// \brief A recorded event.
+    struct Event {
+        int stage;     ///< The Instrumentation::Stage, STAGE_COUNT for the whole way of a displayed frame
+        quint64 frame; ///< The id of the frame
+        qint64 begin;  ///< The start in ns
+        qint64 end;    ///< The end in ns
+    };
+
+    static void add(const Event &event);
+
+    static std::atomic<bool> running;
+    static std::atomic<quint64> lastDisplayed; ///< The newest frame that was drawn
+    static QMutex mutex;                       ///< Protects the ring
+    static std::vector<Event> events;          ///< The ring of events
+    static size_t capacity;                    ///< The size of the full ring
+    static size_t next;                        ///< The position of the next event in the full ring
+};
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <chrono>
+
+#include "frametrace.h"
+#include "instrumentation.h"
+
+std::atomic<quint64> Instrumentation::stageTime[STAGE_COUNT];
+std::atomic<quint64> Instrumentation::stageCalls[STAGE_COUNT];
+std::atomic<qint64> Instrumentation::stageLast[STAGE_COUNT];
+std::atomic<quint64> Instrumentation::counter[COUNTER_COUNT];
+std::atomic<quint64> Instrumentation::frameIds(0);
+
+Instrumentation::ScopedStage::ScopedStage(Stage stage, quint64 frame) : stage(stage), frame(frame), start(now()) {}
+
+Instrumentation::ScopedStage::~ScopedStage() {
+    const qint64 end = now();
+    addStageTime(stage, end - start);
+    if (frame && FrameTrace::isRunning()) FrameTrace::addStage(stage, frame, start, end);
+}
+
+qint64 Instrumentation::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void Instrumentation::addStageTime(Stage stage, qint64 time) {
+    stageTime[stage].fetch_add((quint64)time, std::memory_order_relaxed);
+    stageCalls[stage].fetch_add(1, std::memory_order_relaxed);
+    stageLast[stage].store(now(), std::memory_order_relaxed);
+}
+
+quint64 Instrumentation::nextFrameId() { return frameIds.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+void Instrumentation::count(Counter counter, quint64 count) {
+    Instrumentation::counter[counter].fetch_add(count, std::memory_order_relaxed);
+}
+
+Instrumentation::Totals Instrumentation::totals() {
+    Totals totals;
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        totals.stageTime[stage] = stageTime[stage].load(std::memory_order_relaxed);
+        totals.stageCalls[stage] = stageCalls[stage].load(std::memory_order_relaxed);
+        totals.stageLast[stage] = stageLast[stage].load(std::memory_order_relaxed);
+    }
+    for (int index = 0; index < COUNTER_COUNT; ++index)
+        totals.counter[index] = counter[index].load(std::memory_order_relaxed);
+    totals.timestamp = now();
+    return totals;
+}
+
+Instrumentation::Rates Instrumentation::rates(const Totals &previous, const Totals &current) {
+    Rates rates;
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        const quint64 calls = current.stageCalls[stage] - previous.stageCalls[stage];
+        if (calls) rates.stageTime[stage] = (current.stageTime[stage] - previous.stageTime[stage]) / 1e6 / calls;
+    }
+
+    const double seconds = (current.timestamp - previous.timestamp) / 1e9;
+    if (seconds <= 0) return rates;
+    rates.framesPerSecond = (current.counter[COUNTER_FRAMES] - previous.counter[COUNTER_FRAMES]) / seconds;
+    rates.displayedPerSecond = (current.counter[COUNTER_DISPLAYED] - previous.counter[COUNTER_DISPLAYED]) / seconds;
+    rates.skipped = current.counter[COUNTER_SKIPPED] - previous.counter[COUNTER_SKIPPED];
+    rates.dropped = current.counter[COUNTER_DROPPED] - previous.counter[COUNTER_DROPPED];
+    rates.ignored = current.counter[COUNTER_IGNORED] - previous.counter[COUNTER_IGNORED];
+    rates.usbBytesPerSecond = (current.counter[COUNTER_USBBYTES] - previous.counter[COUNTER_USBBYTES]) / seconds;
+    return rates;
+}
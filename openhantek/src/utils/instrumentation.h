@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class Instrumentation                              utils/instrumentation.h
+/// \brief Process wide timing and throughput counters of the acquisition pipeline.
+/// All methods are lock free and may be called from any thread. The counters
+/// only grow, readers take snapshots with totals() and calculate the rates for
+/// their own interval with rates().
+class Instrumentation {
+  public:
+    /// \enum Stage
+    /// \brief The stages of the pipeline that are timed.
+    enum Stage {
+        STAGE_USBREAD,  ///< Reading the samples from the device
+        STAGE_CONVERT,  ///< Converting the raw samples
+        STAGE_ANALYZE,  ///< Analyzing the samples
+        STAGE_GENERATE, ///< Generating the graphs
+        STAGE_DRAW,     ///< Drawing the graphs
+        STAGE_COUNT     ///< The total number of stages
+    };
+
+    /// \enum Counter
+    /// \brief The events that are counted.
+    enum Counter {
+        COUNTER_FRAMES,    ///< Frames received from the device
+        COUNTER_DISPLAYED, ///< Frames that were drawn
+        COUNTER_SKIPPED,   ///< Received frames replaced before they were analyzed
+        COUNTER_DROPPED,   ///< Analyzed frames replaced before they were shown
+        COUNTER_IGNORED,   ///< Frames the graph generator rejected
+        COUNTER_USBBYTES,  ///< Bytes read from the device
+        COUNTER_COUNT      ///< The total number of counters
+    };
+
+    /// \brief A snapshot of all counters.
+    struct Totals {
+        quint64 stageTime[STAGE_COUNT] = {};  ///< Accumulated time of every stage in ns
+        quint64 stageCalls[STAGE_COUNT] = {}; ///< Number of passes through every stage
+        qint64 stageLast[STAGE_COUNT] = {};   ///< Steady clock time the stages were finished last in ns
+        quint64 counter[COUNTER_COUNT] = {};  ///< The event counters
+        qint64 timestamp = 0;                 ///< Steady clock time of the snapshot in ns
+    };
+
+    /// \brief The activity between two snapshots.
+    struct Rates {
+        double stageTime[STAGE_COUNT] = {}; ///< Mean time of one pass through every stage in ms
+        double framesPerSecond = 0.0;       ///< Frames received from the device per second
+        double displayedPerSecond = 0.0;    ///< Frames drawn per second
+        quint64 skipped = 0;                ///< Frames not analyzed in the interval
+        quint64 dropped = 0;                ///< Frames dropped in the interval
+        quint64 ignored = 0;                ///< Frames ignored in the interval
+        double usbBytesPerSecond = 0.0;     ///< Bytes read from the device per second
+    };
+
+    /// \brief Measures the time of a stage for the lifetime of the object.
+    /// The stage is added to the FrameTrace too, if the processed frame is known.
+    class ScopedStage {
+      public:
+        /// \param stage The measured stage.
+        /// \param frame The id of the processed frame, 0 if it isn't known yet.
+        ScopedStage(Stage stage, quint64 frame = 0);
+        ~ScopedStage();
+
+        /// \brief Sets the processed frame, if it is only known while the stage runs.
+        void setFrame(quint64 frame) { this->frame = frame; }
+
+      private:
+        Stage stage;
+        quint64 frame;
+        qint64 start;
+    };
+
+    /// \return The steady clock time in ns, the same clock the sample timestamps use.
+    static qint64 now();
+
+    /// \brief Adds the time of one pass through a stage.
+    /// \param stage The stage.
+    /// \param time The time in ns.
+    static void addStageTime(Stage stage, qint64 time);
+
+    /// \return A new frame id, the ids are unique in the process and grow monotonically, starting at 1.
+    static quint64 nextFrameId();
+
+    /// \brief Increments an event counter.
+    /// \param counter The counter.
+    /// \param count The number of events.
+    static void count(Counter counter, quint64 count = 1);
+
+    /// \return A snapshot of the counters.
+    static Totals totals();
+
+    /// \brief Calculates the activity between two snapshots.
+    static Rates rates(const Totals &previous, const Totals &current);
+
+  private:
+    static std::atomic<quint64> stageTime[STAGE_COUNT];
+    static std::atomic<quint64> stageCalls[STAGE_COUNT];
+    static std::atomic<qint64> stageLast[STAGE_COUNT];
+    static std::atomic<quint64> counter[COUNTER_COUNT];
+    static std::atomic<quint64> frameIds; ///< The last assigned frame id
+};
@@ -2,7 +2,7 @@
 
 #include <cmath>
 
-#include <QApplication>
+#include <QCoreApplication>
 #include <QLocale>
 #include <QStringList>
 
@@ -10,36 +10,39 @@
 
 #include "utils/printutils.h"
 
+// The strings keep the translation context of the gui, but don't need QtWidgets
+#define tr(msg) QCoreApplication::translate("QApplication", msg)
+
 QString libUsbErrorString(int error) {
     switch (error) {
     case LIBUSB_SUCCESS:
-        return QApplication::tr("Success (no error)");
+        return tr("Success (no error)");
     case LIBUSB_ERROR_IO:
-        return QApplication::tr("Input/output error");
+        return tr("Input/output error");
     case LIBUSB_ERROR_INVALID_PARAM:
-        return QApplication::tr("Invalid parameter");
+        return tr("Invalid parameter");
     case LIBUSB_ERROR_ACCESS:
-        return QApplication::tr("Access denied (insufficient permissions)");
+        return tr("Access denied (insufficient permissions)");
     case LIBUSB_ERROR_NO_DEVICE:
-        return QApplication::tr("No such device (it may have been disconnected)");
+        return tr("No such device (it may have been disconnected)");
     case LIBUSB_ERROR_NOT_FOUND:
-        return QApplication::tr("Entity not found");
+        return tr("Entity not found");
     case LIBUSB_ERROR_BUSY:
-        return QApplication::tr("Resource busy");
+        return tr("Resource busy");
     case LIBUSB_ERROR_TIMEOUT:
-        return QApplication::tr("Operation timed out");
+        return tr("Operation timed out");
     case LIBUSB_ERROR_OVERFLOW:
-        return QApplication::tr("Overflow");
+        return tr("Overflow");
     case LIBUSB_ERROR_PIPE:
-        return QApplication::tr("Pipe error");
+        return tr("Pipe error");
     case LIBUSB_ERROR_INTERRUPTED:
-        return QApplication::tr("System call interrupted (perhaps due to signal)");
+        return tr("System call interrupted (perhaps due to signal)");
     case LIBUSB_ERROR_NO_MEM:
-        return QApplication::tr("Insufficient memory");
+        return tr("Insufficient memory");
     case LIBUSB_ERROR_NOT_SUPPORTED:
-        return QApplication::tr("Operation not supported or unimplemented on this platform");
+        return tr("Operation not supported or unimplemented on this platform");
     default:
-        return QApplication::tr("Other error");
+        return tr("Other error");
     }
 }
 
@@ -50,49 +53,49 @@ QString valueToString(double value, Unit unit, int precision) {
     case UNIT_VOLTS: {
         // Voltage string representation
         int logarithm = floor(log10(fabs(value)));
-        if (value < 1e-3)
-            return QApplication::tr("%L1 µV").arg(value / 1e-6, 0, format,
-                                                  (precision <= 0) ? precision
-                                                                   : qBound(0, precision - 7 - logarithm, precision));
-        else if (value < 1.0)
-            return QApplication::tr("%L1 mV").arg(value / 1e-3, 0, format,
-                                                  (precision <= 0) ? precision : (precision - 4 - logarithm));
+        if (fabs(value) < 1e-3)
+            return tr("%L1 µV").arg(value / 1e-6, 0, format,
+                                    (precision <= 0) ? precision
+                                                     : qBound(0, precision - 7 - logarithm, precision));
+        else if (fabs(value) < 1.0)
+            return tr("%L1 mV").arg(value / 1e-3, 0, format,
+                                    (precision <= 0) ? precision : (precision - 4 - logarithm));
         else
-            return QApplication::tr("%L1 V").arg(value, 0, format,
-                                                 (precision <= 0) ? precision : qMax(0, precision - 1 - logarithm));
+            return tr("%L1 V").arg(value, 0, format,
+                                   (precision <= 0) ? precision : qMax(0, precision - 1 - logarithm));
     }
     case UNIT_DECIBEL:
         // Power level string representation
-        return QApplication::tr("%L1 dB").arg(
+        return tr("%L1 dB").arg(
             value, 0, format,
             (precision <= 0) ? precision : qBound(0, precision - 1 - (int)floor(log10(fabs(value))), precision));
 
     case UNIT_SECONDS:
         // Time string representation
         if (value < 1e-9)
-            return QApplication::tr("%L1 ps").arg(
+            return tr("%L1 ps").arg(
                 value / 1e-12, 0, format,
                 (precision <= 0) ? precision : qBound(0, precision - 13 - (int)floor(log10(fabs(value))), precision));
         else if (value < 1e-6)
-            return QApplication::tr("%L1 ns").arg(value / 1e-9, 0, format,
-                                                  (precision <= 0) ? precision
-                                                                   : (precision - 10 - (int)floor(log10(fabs(value)))));
+            return tr("%L1 ns").arg(value / 1e-9, 0, format,
+                                    (precision <= 0) ? precision
+                                                     : (precision - 10 - (int)floor(log10(fabs(value)))));
         else if (value < 1e-3)
-            return QApplication::tr("%L1 µs").arg(value / 1e-6, 0, format,
-                                                  (precision <= 0) ? precision
-                                                                   : (precision - 7 - (int)floor(log10(fabs(value)))));
+            return tr("%L1 µs").arg(value / 1e-6, 0, format,
+                                    (precision <= 0) ? precision
+                                                     : (precision - 7 - (int)floor(log10(fabs(value)))));
         else if (value < 1.0)
-            return QApplication::tr("%L1 ms").arg(value / 1e-3, 0, format,
-                                                  (precision <= 0) ? precision
-                                                                   : (precision - 4 - (int)floor(log10(fabs(value)))));
+            return tr("%L1 ms").arg(value / 1e-3, 0, format,
+                                    (precision <= 0) ? precision
+                                                     : (precision - 4 - (int)floor(log10(fabs(value)))));
         else if (value < 60)
-            return QApplication::tr("%L1 s").arg(
+            return tr("%L1 s").arg(
                 value, 0, format, (precision <= 0) ? precision : (precision - 1 - (int)floor(log10(fabs(value)))));
         else if (value < 3600)
-            return QApplication::tr("%L1 min").arg(
+            return tr("%L1 min").arg(
                 value / 60, 0, format, (precision <= 0) ? precision : (precision - 1 - (int)floor(log10(value / 60))));
         else
-            return QApplication::tr("%L1 h").arg(
+            return tr("%L1 h").arg(
                 value / 3600, 0, format,
                 (precision <= 0) ? precision : qMax(0, precision - 1 - (int)floor(log10(value / 3600))));
 
@@ -100,33 +103,33 @@ QString valueToString(double value, Unit unit, int precision) {
         // Frequency string representation
         int logarithm = floor(log10(fabs(value)));
         if (value < 1e3)
-            return QApplication::tr("%L1 Hz").arg(
+            return tr("%L1 Hz").arg(
                 value, 0, format, (precision <= 0) ? precision : qBound(0, precision - 1 - logarithm, precision));
         else if (value < 1e6)
-            return QApplication::tr("%L1 kHz").arg(value / 1e3, 0, format,
-                                                   (precision <= 0) ? precision : precision + 2 - logarithm);
+            return tr("%L1 kHz").arg(value / 1e3, 0, format,
+                                     (precision <= 0) ? precision : precision + 2 - logarithm);
         else if (value < 1e9)
-            return QApplication::tr("%L1 MHz").arg(value / 1e6, 0, format,
-                                                   (precision <= 0) ? precision : precision + 5 - logarithm);
+            return tr("%L1 MHz").arg(value / 1e6, 0, format,
+                                     (precision <= 0) ? precision : precision + 5 - logarithm);
         else
-            return QApplication::tr("%L1 GHz").arg(value / 1e9, 0, format,
-                                                   (precision <= 0) ? precision : qMax(0, precision + 8 - logarithm));
+            return tr("%L1 GHz").arg(value / 1e9, 0, format,
+                                     (precision <= 0) ? precision : qMax(0, precision + 8 - logarithm));
     }
     case UNIT_SAMPLES: {
         // Sample count string representation
         int logarithm = floor(log10(fabs(value)));
         if (value < 1e3)
-            return QApplication::tr("%L1 S").arg(
+            return tr("%L1 S").arg(
                 value, 0, format, (precision <= 0) ? precision : qBound(0, precision - 1 - logarithm, precision));
         else if (value < 1e6)
-            return QApplication::tr("%L1 kS").arg(value / 1e3, 0, format,
-                                                  (precision <= 0) ? precision : precision + 2 - logarithm);
+            return tr("%L1 kS").arg(value / 1e3, 0, format,
+                                    (precision <= 0) ? precision : precision + 2 - logarithm);
         else if (value < 1e9)
-            return QApplication::tr("%L1 MS").arg(value / 1e6, 0, format,
-                                                  (precision <= 0) ? precision : precision + 5 - logarithm);
+            return tr("%L1 MS").arg(value / 1e6, 0, format,
+                                    (precision <= 0) ? precision : precision + 5 - logarithm);
         else
-            return QApplication::tr("%L1 GS").arg(value / 1e9, 0, format,
-                                                  (precision <= 0) ? precision : qMax(0, precision + 8 - logarithm));
+            return tr("%L1 GS").arg(value / 1e9, 0, format,
+                                    (precision <= 0) ? precision : qMax(0, precision + 8 - logarithm));
     }
     default:
         return QString();
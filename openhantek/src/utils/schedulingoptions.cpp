@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+
+#include "schedulingoptions.h"
+
+SchedulingOptions::SchedulingOptions(QCommandLineParser &parser)
+    : parser(parser),
+      usbPriorityOption("usb-priority",
+                        QCoreApplication::translate("main", "Run the usb threads with the <level> normal, high or "
+                                                            "realtime."),
+                        "level"),
+      usbCpusOption("usb-cpus",
+                    QCoreApplication::translate("main", "Run the usb threads only on the <cpus>, like 0,2-3."),
+                    "cpus"),
+      analysisCpusOption("analysis-cpus",
+                         QCoreApplication::translate("main", "Run the analysis and its workers only on the <cpus>, "
+                                                             "like 0,2-3."),
+                         "cpus"),
+      lockMemoryOption("lock-memory", QCoreApplication::translate("main", "Keep the raw sample buffers, the usb "
+                                                                          "stream and the frame buffers in ram.")) {
+    parser.addOption(usbPriorityOption);
+    parser.addOption(usbCpusOption);
+    parser.addOption(analysisCpusOption);
+    parser.addOption(lockMemoryOption);
+}
+
+bool SchedulingOptions::parse(QString &errorMessage) {
+    if (parser.isSet(usbPriorityOption) && !usb.parsePriority(parser.value(usbPriorityOption), errorMessage))
+        return false;
+    if (parser.isSet(usbCpusOption) && !usb.parseCpus(parser.value(usbCpusOption), errorMessage)) return false;
+    return !parser.isSet(analysisCpusOption) || analysis.parseCpus(parser.value(analysisCpusOption), errorMessage);
+}
+
+void SchedulingOptions::lockMemory() const {
+    if (!parser.isSet(lockMemoryOption)) return;
+    QString errorMessage;
+    if (!ThreadScheduling::lockMemory(errorMessage))
+        qWarning().noquote() << QCoreApplication::translate("", "Can't lock the memory: %1").arg(errorMessage);
+}
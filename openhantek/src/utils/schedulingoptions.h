@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QCommandLineOption>
+
+#include "threadscheduling.h"
+
+class QCommandLineParser;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class SchedulingOptions                           utils/schedulingoptions.h
+/// \brief The command line options of the thread scheduling.
+/// The gui and the daemon accept the same options for the priority and the cpus
+/// of the usb and the analysis threads and for locking the sample buffers.
+class SchedulingOptions {
+  public:
+    /// \brief Adds the options to a parser.
+    /// \param parser The parser of the program, it has to outlive the options.
+    explicit SchedulingOptions(QCommandLineParser &parser);
+
+    /// \brief Reads the options after the parser processed the arguments.
+    /// \param errorMessage Is set to the reason on failure.
+    /// \return false, if an option has an invalid value.
+    bool parse(QString &errorMessage);
+
+    /// \brief Locks the sample buffers in ram, if requested. A failure is logged.
+    void lockMemory() const;
+
+    ThreadScheduling usb;      ///< The scheduling of the usb threads
+    ThreadScheduling analysis; ///< The scheduling of the analysis and its workers
+
+  private:
+    const QCommandLineParser &parser;
+    QCommandLineOption usbPriorityOption;
+    QCommandLineOption usbCpusOption;
+    QCommandLineOption analysisCpusOption;
+    QCommandLineOption lockMemoryOption;
+};
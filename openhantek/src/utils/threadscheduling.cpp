@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QStringList>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "threadscheduling.h"
+
+const int ThreadScheduling::HIGH_NICE;
+const int ThreadScheduling::REALTIME_PRIORITY;
+
+namespace {
+std::atomic<bool> memoryLocked(false); ///< true, if the buffers are locked
+std::atomic<bool> lockFailed(false);   ///< true, if locking a buffer failed and was logged
+
+/// \return The description of a system error code.
+QString systemError(int error) { return QString::fromLocal8Bit(strerror(error)); }
+
+/// \brief Logs a failed scheduling with the name of the thread.
+void warnScheduling(const QString &errorMessage) {
+    qWarning().noquote() << QCoreApplication::translate("", "Can't set the scheduling of %1: %2")
+                                .arg(QThread::currentThread()->objectName(), errorMessage);
+}
+}
+
+bool ThreadScheduling::parsePriority(const QString &text, QString &errorMessage) {
+    static const QStringList NAMES = {"normal", "high", "realtime"};
+    const int index = NAMES.indexOf(text.trimmed().toLower());
+    if (index < 0) {
+        errorMessage = QCoreApplication::translate("", "Unknown priority %1, valid are: %2")
+                           .arg(text, NAMES.join(", "));
+        return false;
+    }
+    priority = (Priority)index;
+    return true;
+}
+
+bool ThreadScheduling::parseCpus(const QString &text, QString &errorMessage) {
+    std::vector<unsigned> parsed;
+    for (const QString &part : text.split(',', QString::SkipEmptyParts)) {
+        const QStringList range = part.split('-');
+        bool firstValid = false;
+        bool lastValid = range.size() == 1;
+        const unsigned first = range.front().trimmed().toUInt(&firstValid);
+        const unsigned last = range.size() == 2 ? range.back().trimmed().toUInt(&lastValid) : first;
+        if (!firstValid || !lastValid || range.size() > 2 || last < first) {
+            errorMessage = QCoreApplication::translate("", "Invalid cpu list %1, expected cpus like 0,2-3").arg(text);
+            return false;
+        }
+        for (unsigned cpu = first; cpu <= last; ++cpu) parsed.push_back(cpu);
+    }
+    std::sort(parsed.begin(), parsed.end());
+    parsed.erase(std::unique(parsed.begin(), parsed.end()), parsed.end());
+    cpus = std::move(parsed);
+    return true;
+}
+
+bool ThreadScheduling::apply(QString &errorMessage) const {
+    QStringList errors;
+
+#if defined(_WIN32)
+    if (priority != PRIORITY_NORMAL &&
+        !SetThreadPriority(GetCurrentThread(),
+                           priority == PRIORITY_REALTIME ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST))
+        errors << QCoreApplication::translate("", "priority error %1").arg(GetLastError());
+    if (!cpus.empty()) {
+        DWORD_PTR mask = 0;
+        for (unsigned cpu : cpus)
+            if (cpu < sizeof(mask) * 8) mask |= (DWORD_PTR)1 << cpu;
+        if (!mask || !SetThreadAffinityMask(GetCurrentThread(), mask))
+            errors << QCoreApplication::translate("", "affinity error %1").arg(GetLastError());
+    }
+#else
+    if (priority == PRIORITY_REALTIME) {
+        // Below the interrupt threads, so the usb transfers are still completed
+        sched_param parameter;
+        parameter.sched_priority = std::min(REALTIME_PRIORITY, sched_get_priority_max(SCHED_FIFO));
+        const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameter);
+        if (error) errors << QCoreApplication::translate("", "real-time priority: %1").arg(systemError(error));
+    } else if (priority == PRIORITY_HIGH) {
+#if defined(__linux__)
+        // The nice value of Linux belongs to the thread
+        if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), HIGH_NICE))
+            errors << QCoreApplication::translate("", "high priority: %1").arg(systemError(errno));
+#else
+        // The highest priority of the default policy
+        int policy = SCHED_OTHER;
+        sched_param parameter;
+        int error = pthread_getschedparam(pthread_self(), &policy, &parameter);
+        if (!error) {
+            parameter.sched_priority = sched_get_priority_max(policy);
+            error = pthread_setschedparam(pthread_self(), policy, &parameter);
+        }
+        if (error) errors << QCoreApplication::translate("", "high priority: %1").arg(systemError(error));
+#endif
+    }
+    if (!cpus.empty()) {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (unsigned cpu : cpus)
+            if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+        const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (error) errors << QCoreApplication::translate("", "cpu affinity: %1").arg(systemError(error));
+#else
+        errors << QCoreApplication::translate("", "cpu affinity isn't supported on this system");
+#endif
+    }
+#endif
+
+    if (errors.isEmpty()) return true;
+    errorMessage = errors.join(", ");
+    return false;
+}
+
+void ThreadScheduling::applyOnce() const {
+    thread_local bool applied = false;
+    if (applied || !isSet()) return;
+    applied = true;
+    QString errorMessage;
+    if (!apply(errorMessage)) warnScheduling(errorMessage);
+}
+
+void ThreadScheduling::applyOnStart(QThread *thread) const {
+    if (!isSet()) return;
+    // Without a context object the connection is direct, the started signal is emitted by the new thread
+    const ThreadScheduling scheduling = *this;
+    QObject::connect(thread, &QThread::started, [scheduling]() {
+        QString errorMessage;
+        if (!scheduling.apply(errorMessage)) warnScheduling(errorMessage);
+    });
+}
+
+bool ThreadScheduling::lockMemory(QString &errorMessage) {
+#if defined(_WIN32)
+    errorMessage = QCoreApplication::translate("", "Locking the memory isn't supported on this system");
+    return false;
+#else
+    Q_UNUSED(errorMessage);
+    memoryLocked.store(true);
+    return true;
+#endif
+}
+
+void ThreadScheduling::lockBuffer(const void *data, size_t size) {
+#if defined(_WIN32)
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+#else
+    if (!size || !memoryLocked.load(std::memory_order_relaxed)) return;
+    if (!mlock(data, size) || lockFailed.exchange(true)) return;
+    const int error = errno;
+    qWarning().noquote() << QCoreApplication::translate("", "Can't lock the sample buffers: %1")
+                                .arg(systemError(error));
+#endif
+}
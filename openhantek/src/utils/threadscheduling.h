@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QString>
+#include <vector>
+
+class QThread;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ThreadScheduling                             utils/threadscheduling.h
+/// \brief The priority and the cpus of a thread of the acquisition or analysis.
+/// The threads run with the default scheduling, shared with the gui and all
+/// other programs of the host. On a busy host the usb thread may then miss its
+/// reads, roll mode data is lost. The usb thread can get a higher or a real-time
+/// priority, and every thread can be pinned to some cpus. The scheduling is
+/// applied by the thread itself, it only takes effect if the system allows it.
+/// Real-time priorities usually need the CAP_SYS_NICE capability or a matching
+/// RLIMIT_RTPRIO, a higher priority RLIMIT_NICE.
+class ThreadScheduling {
+  public:
+    /// \brief The priority levels.
+    enum Priority {
+        PRIORITY_NORMAL,  ///< The default scheduling of the system
+        PRIORITY_HIGH,    ///< A raised priority in the default scheduling
+        PRIORITY_REALTIME ///< Fixed priority real-time scheduling, above all normal threads
+    };
+
+    Priority priority = PRIORITY_NORMAL; ///< The priority of the thread
+    std::vector<unsigned> cpus;          ///< The cpus the thread may run on, empty for all
+
+    /// \return true, if the scheduling of the system is changed at all.
+    bool isSet() const { return priority != PRIORITY_NORMAL || !cpus.empty(); }
+
+    /// \brief Parses a priority level.
+    /// \param text "normal", "high" or "realtime".
+    /// \param errorMessage Is set to the reason on failure.
+    /// \return false, if the text isn't a priority level.
+    bool parsePriority(const QString &text, QString &errorMessage);
+
+    /// \brief Parses a list of cpus.
+    /// \param text The cpu numbers starting at 0 and ranges separated by commas, like "0,2-3".
+    /// \param errorMessage Is set to the reason on failure.
+    /// \return false, if the text isn't a list of cpus.
+    bool parseCpus(const QString &text, QString &errorMessage);
+
+    /// \brief Applies the scheduling to the calling thread.
+    /// \param errorMessage Is set to the reason on failure.
+    /// \return false, if the system refused a part of the scheduling.
+    bool apply(QString &errorMessage) const;
+
+    /// \brief Applies the scheduling to the calling thread, if it wasn't done before in the thread.
+    /// Used by the threads of a pool, a failure is logged.
+    void applyOnce() const;
+
+    /// \brief Applies the scheduling to a thread when it is started.
+    /// Has to be called before the objects of the thread are connected to QThread::started, so the
+    /// scheduling is in place when they start. A failure is logged.
+    /// \param thread The thread, it mustn't be running.
+    void applyOnStart(QThread *thread) const;
+
+    /// \brief Keeps the buffers of the acquisition in ram from now on.
+    /// Only the raw sample buffers, the stream and the frame buffers are locked by lockBuffer(), the
+    /// rest of the process can still be paged out and allocate beyond RLIMIT_MEMLOCK.
+    /// \param errorMessage Is set to the reason on failure.
+    /// \return false, if the memory can't be locked on this system.
+    static bool lockMemory(QString &errorMessage);
+
+    /// \brief Locks the memory of a buffer in ram, if lockMemory() was called.
+    /// The buffers are reused and locked again whenever they are resized, locking pages that are
+    /// locked already only checks them. A failure, usually the RLIMIT_MEMLOCK, is logged once.
+    /// \param data The start of the buffer.
+    /// \param size The size of the buffer in bytes.
+    static void lockBuffer(const void *data, size_t size);
+
+    /// \brief Locks the whole capacity of a vector in ram, if lockMemory() was called.
+    template <typename T> static void lockBuffer(const std::vector<T> &buffer) {
+        lockBuffer(buffer.data(), buffer.capacity() * sizeof(T));
+    }
+
+  private:
+    static const int HIGH_NICE = -10;        ///< The nice value of the high priority
+    static const int REALTIME_PRIORITY = 20; ///< The real-time priority, below the interrupt threads
+};
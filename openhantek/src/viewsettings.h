@@ -1,6 +1,7 @@
 #pragma once
 
 #include "definitions.h"
+#include "scopesettings.h"
 #include <QColor>
 #include <QObject>
 #include <QPoint>
@@ -25,6 +26,8 @@ struct DsoSettingsColorValues {
 /// \struct DsoSettingsView
 /// \brief Holds all view settings.
 struct DsoSettingsView {
+    static const int PHOSPHOR_LAYERS_MAX = 99; ///< The deepest phosphor that is drawn in layers
+
     DsoSettingsColorValues screen = {QColor(0xff, 0xff, 0xff, 0x7f),
                                      QColor(0x00, 0x00, 0x00, 0xff),
                                      QColor(0xff, 0xff, 0xff, 0xff),
@@ -44,7 +47,29 @@ struct DsoSettingsView {
     bool antialiasing = true;                                         ///< Antialiasing for the graphs
     bool digitalPhosphor = false;                                     ///< true slowly fades out the previous graphs
     int digitalPhosphorDepth = 8;                                     ///< Number of channels shown at one time
+    bool phosphorAccumulation = false;                                ///< true accumulates the graphs with decay
+    bool persistenceMap = false;                                      ///< true shows the hits of all frames
+    bool xyDensity = false;                                           ///< true shows the XY graphs as density map
     Dso::InterpolationMode interpolation = Dso::INTERPOLATION_LINEAR; ///< Interpolation mode for the graph
     bool screenColorImages = false;                                   ///< true exports images with screen colors
     bool zoom = false;                                                ///< true if the magnified scope is enabled
+    int maximumFrameRate = 0;                                         ///< Frames drawn per second, 0 for the display
+    bool powerSaving = true;                                          ///< true draws slowly in the background
+    bool phosphorFramebuffers = true;                                 ///< false without framebuffers, isn't stored
+
+    /// \brief Checks if the graphs are accumulated in a framebuffer instead of drawn in fading layers.
+    /// The maps are drawn as textures and aren't accumulated, the graphs beside them keep their layers then.
+    /// \param scope The settings of the shown graphs.
+    /// \return true, if the intensity graded phosphor is drawn.
+    bool accumulatesPhosphor(const DsoSettingsScope &scope) const {
+        return phosphorAccumulation && phosphorFramebuffers && !persistenceMap && !scope.spectrogram &&
+               !(xyDensity && scope.horizontal.format == Dso::GRAPHFORMAT_XY);
+    }
+
+    /// \return The number of graphs that are kept, the accumulated phosphor only needs the newest one.
+    int phosphorLayers(const DsoSettingsScope &scope) const {
+        if (accumulatesPhosphor(scope)) return 1;
+        // The depth of the accumulation may be too deep for layers
+        return digitalPhosphorDepth < PHOSPHOR_LAYERS_MAX ? digitalPhosphorDepth : PHOSPHOR_LAYERS_MAX;
+    }
 };
@@ -129,8 +129,10 @@ const QColor LevelSlider::color(int index) const {
 int LevelSlider::setColor(int index, QColor color) {
     if (index < 0 || index >= this->slider.count()) return -1;
 
+    if (this->slider[index]->color == color) return index;
+
     this->slider[index]->color = color;
-    this->repaint();
+    this->update();
 
     return index;
 }
@@ -151,8 +153,11 @@ const QString LevelSlider::text(int index) const {
 int LevelSlider::setText(int index, QString text) {
     if (index < 0 || index >= this->slider.count()) return -1;
 
+    if (this->slider[index]->text == text) return index;
+
     this->slider[index]->text = text;
     this->calculateWidth();
+    this->update();
 
     return index;
 }
@@ -173,8 +178,10 @@ bool LevelSlider::visible(int index) const {
 int LevelSlider::setVisible(int index, bool visible) {
     if (index < 0 || index >= this->slider.count()) return -1;
 
+    if (this->slider[index]->visible == visible) return index;
+
     this->slider[index]->visible = visible;
-    this->repaint();
+    this->update();
 
     return index;
 }
@@ -203,12 +210,16 @@ double LevelSlider::maximum(int index) const {
 int LevelSlider::setLimits(int index, double minimum, double maximum) {
     if (index < 0 || index >= this->slider.count()) return -1;
 
+    // The trigger level limits are set again with every gain and offset change
+    if (this->slider[index]->minimum == minimum && this->slider[index]->maximum == maximum)
+        return this->fixValue(index);
+
     this->slider[index]->minimum = minimum;
     this->slider[index]->maximum = maximum;
     int result = this->fixValue(index);
 
     this->calculateRect(index);
-    this->repaint();
+    this->update();
 
     return result;
 }
@@ -250,12 +261,15 @@ double LevelSlider::value(int index) const {
 double LevelSlider::setValue(int index, double value) {
     if (index < 0 || index >= this->slider.count()) return -1;
 
-    // Apply new value
+    // Apply new value, the area is only repainted if the slider moved
+    const double previous = this->slider[index]->value;
     this->slider[index]->value = value;
     this->fixValue(index);
 
-    this->calculateRect(index);
-    this->repaint();
+    if (this->slider[index]->value != previous) {
+        this->calculateRect(index);
+        this->update();
+    }
 
     if (this->pressedSlider < 0) emit valueChanged(index, value);
 
@@ -459,7 +473,7 @@ void LevelSlider::resizeEvent(QResizeEvent *event) {
 
     for (int sliderId = 0; sliderId < this->slider.count(); ++sliderId) this->calculateRect(sliderId);
 
-    this->repaint();
+    this->update();
 }
 
 /// \brief Calculate the drawing area for the slider for it's current value.
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QGuiApplication>
+#include <QScreen>
+#include <algorithm>
+#include <cmath>
+
+#include "updatethrottle.h"
+
+const int UpdateThrottle::DEFAULT_INTERVAL;
+
+UpdateThrottle::UpdateThrottle(QObject *parent) : QObject(parent), refreshInterval(DEFAULT_INTERVAL) {
+    QScreen *screen = QGuiApplication::primaryScreen();
+    if (screen && screen->refreshRate() >= 1.0) refreshInterval = (int)std::floor(1000.0 / screen->refreshRate());
+    interval = refreshInterval;
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, &UpdateThrottle::fire);
+}
+
+void UpdateThrottle::request() {
+    // The pending update will show the state of this request too
+    if (timer.isActive()) return;
+
+    const qint64 elapsed = last.isValid() ? last.elapsed() : interval;
+    if (elapsed >= interval)
+        fire();
+    else
+        timer.start(interval - (int)elapsed);
+}
+
+void UpdateThrottle::setMaximumRate(int rate) {
+    interval = (rate > 0) ? std::max(refreshInterval, 1000 / rate) : refreshInterval;
+}
+
+void UpdateThrottle::fire() {
+    last.start();
+    emit update();
+}
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class UpdateThrottle                               widgets/updatethrottle.h
+/// \brief Coalesces update requests to the refresh rate of the display.
+/// The first request after a quiet period is passed on at once, further
+/// requests within one refresh interval are merged into a single update at
+/// its end. The receiver reads the latest state when it gets the signal, so
+/// nothing is lost by dropping the requests in between.
+class UpdateThrottle : public QObject {
+    Q_OBJECT
+
+  public:
+    /// \brief Initializes the throttle with the refresh rate of the primary screen.
+    explicit UpdateThrottle(QObject *parent = nullptr);
+
+    /// \brief Requests an update, it is emitted now or at the end of the current interval.
+    void request();
+
+    /// \brief Limits the updates further than the refresh rate.
+    /// \param rate The maximum updates per second, 0 for the refresh rate of the display.
+    void setMaximumRate(int rate);
+
+    static const int DEFAULT_INTERVAL = 16; ///< The interval if the refresh rate is unknown (ms)
+
+  signals:
+    void update(); ///< The state should be shown
+
+  private:
+    void fire();
+
+    QTimer timer;        ///< Delays the requests within an interval
+    QElapsedTimer last;  ///< Measures the time since the last update
+    int refreshInterval; ///< The refresh interval of the display (ms)
+    int interval;        ///< The minimum time between two updates (ms)
+};
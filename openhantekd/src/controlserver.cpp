@@ -0,0 +1,464 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCoreApplication>
+#include <QTcpSocket>
+#include <QTimer>
+#include <cmath>
+#include <cstring>
+
+#include "controlserver.h"
+
+#include "dataanalyzerresult.h"
+#include "hantekdsocontrol.h"
+#include "headlessdaemon.h"
+#include "settings.h"
+#include "usb/usbdevice.h"
+#include "utils/floatformat.h"
+#include "viewconstants.h"
+
+namespace {
+/// \brief The SCPI names of the automatic measurements, indexed by Dso::Measurement.
+static const char *MEASUREMENT_MNEMONICS[Dso::MEASUREMENT_COUNT] = {
+    "VRMS", "VAVerage", "VMIN", "VMAX", "RISetime", "FALLtime", "DUTYcycle", "PERiod", "OVERshoot", "PHASe"};
+static const char *COUPLING_NAMES[Dso::COUPLING_COUNT] = {"AC", "DC", "GND"};
+static const char *TRIGGERMODE_NAMES[Dso::TRIGGERMODE_COUNT] = {"AUTO", "NORM", "SING", "SOFT"};
+static const char *TRIGGERMODE_MNEMONICS[Dso::TRIGGERMODE_COUNT] = {"AUTO", "NORMal", "SINGle", "SOFTware"};
+
+/// \brief Compares a node of a command with a mnemonic.
+/// \param node The node, case insensitive.
+/// \param mnemonic The long form, its upper case part is the short form.
+/// \return true, if the node is the short or the long form.
+bool matches(const QByteArray &node, const char *mnemonic) {
+    const QByteArray upper = node.toUpper();
+    QByteArray shortForm;
+    for (const char *c = mnemonic; *c && *c >= 'A' && *c <= 'Z'; ++c) shortForm.append(*c);
+    return upper == shortForm || upper == QByteArray(mnemonic).toUpper();
+}
+
+/// \brief Splits a node with a numeric suffix like "CHANnel2".
+/// \param node The node.
+/// \param mnemonic The mnemonic without the suffix.
+/// \param index Is set to the suffix minus one, 0 if there is none.
+/// \return true, if the node matches the mnemonic.
+bool matchesIndexed(const QByteArray &node, const char *mnemonic, unsigned &index) {
+    int digits = node.size();
+    while (digits > 0 && node[digits - 1] >= '0' && node[digits - 1] <= '9') --digits;
+    if (!matches(node.left(digits), mnemonic)) return false;
+    const unsigned number = digits < node.size() ? node.mid(digits).toUInt() : 1;
+    if (number == 0) return false;
+    index = number - 1;
+    return true;
+}
+
+/// \brief Finds the index of a mnemonic in a table.
+/// \return The index, -1 if it isn't in the table.
+int findMnemonic(const QByteArray &node, const char *const *mnemonics, int count) {
+    for (int index = 0; index < count; ++index)
+        if (matches(node, mnemonics[index])) return index;
+    return -1;
+}
+
+/// \brief Parses a boolean argument, "ON", "OFF", "1" or "0".
+bool parseBool(const QByteArray &argument, bool &value) {
+    const QByteArray upper = argument.toUpper();
+    if (upper == "ON" || upper == "1")
+        value = true;
+    else if (upper == "OFF" || upper == "0")
+        value = false;
+    else
+        return false;
+    return true;
+}
+
+void appendNumber(QByteArray &answer, double value) {
+    char number[FloatFormat::MAX_LENGTH];
+    answer.append(number, (int)(FloatFormat::format(value, number) - number));
+}
+}
+
+ControlServer::ControlServer(HeadlessDaemon *daemon, HantekDsoControl *dsoControl, DsoSettings *settings)
+    : daemon(daemon), dsoControl(dsoControl), settings(settings) {
+    server.setParent(this);
+    connect(&server, &QTcpServer::newConnection, this, &ControlServer::acceptClients);
+    connect(dsoControl, &HantekDsoControl::samplingStarted, this, [this]() { sampling = true; });
+    connect(dsoControl, &HantekDsoControl::samplingStopped, this, [this]() { sampling = false; });
+    connect(dsoControl, &HantekDsoControl::samplerateChanged, this,
+            [this](double samplerate) { this->settings->scope.horizontal.samplerate = samplerate; });
+}
+
+bool ControlServer::listen(quint16 port) { return server.listen(QHostAddress::Any, port); }
+
+void ControlServer::acceptClients() {
+    while (QTcpSocket *socket = server.nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { readCommands(socket); });
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void ControlServer::readCommands(QTcpSocket *socket) {
+    while (socket->canReadLine()) {
+        const QByteArray line = socket->readLine().trimmed();
+        QByteArray answers;
+        bool answered = false;
+        for (const QByteArray &part : line.split(';')) {
+            const QByteArray command = part.trimmed();
+            if (command.isEmpty()) continue;
+            QByteArray answer;
+            if (!execute(command, answer)) continue;
+            if (answered) answers.append(';');
+            answers.append(answer);
+            answered = true;
+        }
+        if (!answered) continue;
+        answers.append('\n');
+        socket->write(answers);
+    }
+    // A line without an end would be buffered without limit
+    if (socket->bytesAvailable() > MAX_LINE) socket->abort();
+}
+
+/// \brief Executes a command.
+/// \param command The command with its arguments.
+/// \param answer Is set to the answer of a query.
+/// \return true, if the command is a query that was answered.
+bool ControlServer::execute(const QByteArray &command, QByteArray &answer) {
+    const int space = command.indexOf(' ');
+    QByteArray header = space < 0 ? command : command.left(space);
+    const QByteArray argument = space < 0 ? QByteArray() : command.mid(space + 1).trimmed();
+    const bool isQuery = header.endsWith('?');
+    if (isQuery) header.chop(1);
+    if (header.startsWith(':')) header.remove(0, 1);
+    const QList<QByteArray> nodes = header.split(':');
+
+    const bool known = isQuery ? query(nodes, argument, answer) : setting(nodes, argument, command);
+    if (!known) {
+        pushError(-113, "Undefined header", command);
+        return false;
+    }
+    return isQuery;
+}
+
+/// \brief Applies a setting to the settings and the device.
+/// \return false, if the command is unknown.
+bool ControlServer::setting(const QList<QByteArray> &nodes, const QByteArray &argument, const QByteArray &command) {
+    DsoSettingsScope &scope = settings->scope;
+    const QByteArray &root = nodes[0];
+    bool ok = true;
+    const double value = argument.toDouble(&ok);
+
+    if (nodes.size() == 1) {
+        if (root.toUpper() == "*CLS") {
+            errors.clear();
+        } else if (matches(root, "RUN")) {
+            send(command, [this]() {
+                dsoControl->startSampling();
+                return Dso::ErrorCode::ERROR_NONE;
+            });
+        } else if (matches(root, "STOP")) {
+            send(command, [this]() {
+                dsoControl->stopSampling();
+                return Dso::ErrorCode::ERROR_NONE;
+            });
+        } else if (matches(root, "SINGle")) {
+            scope.trigger.mode = Dso::TRIGGERMODE_SINGLE;
+            send(command, [this]() {
+                const Dso::ErrorCode error = dsoControl->setTriggerMode(Dso::TRIGGERMODE_SINGLE);
+                if (error == Dso::ErrorCode::ERROR_NONE) dsoControl->startSampling();
+                return error;
+            });
+        } else
+            return false;
+        return true;
+    }
+
+    unsigned channel = 0;
+    if (nodes.size() == 2 && matchesIndexed(root, "CHANnel", channel)) {
+        if (channel >= scope.physicalChannels) return reject(-114, "Header suffix out of range", command);
+        return channelSetting(channel, nodes[1], argument, command);
+    }
+    if (nodes.size() != 2) return false;
+    const QByteArray &node = nodes[1];
+
+    if (matches(root, "TIMebase") && matches(node, "SCALe")) {
+        if (!ok || value <= 0.0) return reject(-222, "Data out of range", command);
+        scope.horizontal.timebase = value;
+        scope.horizontal.samplerateSet = false;
+        send(command, [this, value]() { return dsoControl->setRecordTime(value * DIVS_TIME); });
+    } else if (matches(root, "ACQuire") && matches(node, "SRATe")) {
+        if (!ok || value <= 0.0) return reject(-222, "Data out of range", command);
+        scope.horizontal.samplerate = value;
+        scope.horizontal.samplerateSet = true;
+        send(command, [this, value]() { return dsoControl->setSamplerate(value); });
+    } else if (matches(root, "TRIGger")) {
+        if (matches(node, "FORCe")) {
+            send(command, [this]() {
+                dsoControl->forceTrigger();
+                return Dso::ErrorCode::ERROR_NONE;
+            });
+        } else if (matches(node, "MODE")) {
+            const int mode = findMnemonic(argument, TRIGGERMODE_MNEMONICS, Dso::TRIGGERMODE_COUNT);
+            if (mode < 0) return reject(-224, "Illegal parameter value", command);
+            scope.trigger.mode = (Dso::TriggerMode)mode;
+            send(command, [this, mode]() { return dsoControl->setTriggerMode((Dso::TriggerMode)mode); });
+        } else if (matches(node, "SOURce")) {
+            unsigned source = 0;
+            if (!matchesIndexed(argument, "CHANnel", source) || source >= scope.physicalChannels)
+                return reject(-224, "Illegal parameter value", command);
+            scope.trigger.source = source;
+            scope.trigger.special = false;
+            send(command, [this, source]() { return dsoControl->setTriggerSource(false, source); });
+        } else if (matches(node, "SLOPe")) {
+            Dso::Slope slope;
+            if (matches(argument, "POSitive"))
+                slope = Dso::SLOPE_POSITIVE;
+            else if (matches(argument, "NEGative"))
+                slope = Dso::SLOPE_NEGATIVE;
+            else
+                return reject(-224, "Illegal parameter value", command);
+            scope.trigger.slope = slope;
+            send(command, [this, slope]() { return dsoControl->setTriggerSlope(slope); });
+        } else if (matches(node, "LEVel")) {
+            if (!ok || scope.trigger.special) return reject(-222, "Data out of range", command);
+            const unsigned source = scope.trigger.source;
+            scope.voltage[source].trigger = value;
+            send(command, [this, source, value]() { return dsoControl->setTriggerLevel(source, value); });
+        } else if (matches(node, "POSition")) {
+            if (!ok || value < 0.0 || value > 1.0) return reject(-222, "Data out of range", command);
+            scope.trigger.position = value;
+            const double pretrigger = value * scope.horizontal.timebase * DIVS_TIME;
+            send(command, [this, pretrigger]() { return dsoControl->setPretriggerPosition(pretrigger); });
+        } else
+            return false;
+    } else if (matches(root, "WAVeform") && matches(node, "SOURce")) {
+        unsigned source = 0;
+        if (matches(argument, "MATH"))
+            source = scope.physicalChannels;
+        else if (!matchesIndexed(argument, "CHANnel", source) || source >= scope.physicalChannels)
+            return reject(-224, "Illegal parameter value", command);
+        waveformSource = source;
+    } else if (matches(root, "DEBug") && matches(node, "COMMand")) {
+        QByteArray text = argument;
+        if (text.size() >= 2 && text.startsWith('"') && text.endsWith('"')) text = text.mid(1, text.size() - 2);
+        const QString commandString = QString::fromLatin1(text);
+        send(command, [this, commandString]() { return dsoControl->stringCommand(commandString); });
+    } else
+        return false;
+    return true;
+}
+
+/// \brief Applies a setting of a channel.
+/// \return false, if the command is unknown.
+bool ControlServer::channelSetting(unsigned channel, const QByteArray &node, const QByteArray &argument,
+                                   const QByteArray &command) {
+    DsoSettingsScopeVoltage &voltage = settings->scope.voltage[channel];
+    bool ok = true;
+    const double value = argument.toDouble(&ok);
+
+    if (matches(node, "SCALe")) {
+        if (!ok || value <= 0.0) return reject(-222, "Data out of range", command);
+        voltage.gain = value;
+        send(command, [this, channel, value]() { return dsoControl->setGain(channel, value * DIVS_VOLTAGE); });
+    } else if (matches(node, "OFFSet")) {
+        if (!ok || std::fabs(value) > DIVS_VOLTAGE / 2) return reject(-222, "Data out of range", command);
+        voltage.offset = value;
+        send(command, [this, channel, value]() { return dsoControl->setOffset(channel, value / DIVS_VOLTAGE + 0.5); });
+    } else if (matches(node, "DISPlay")) {
+        bool used = false;
+        if (!parseBool(argument, used)) return reject(-224, "Illegal parameter value", command);
+        voltage.used = used;
+        updateChannelsUsed();
+    } else if (matches(node, "COUPling")) {
+        const int coupling = findMnemonic(argument, COUPLING_NAMES, Dso::COUPLING_COUNT);
+        if (coupling < 0) return reject(-224, "Illegal parameter value", command);
+        voltage.misc = coupling;
+        send(command, [this, channel, coupling]() {
+            return dsoControl->setCoupling(channel, (Dso::Coupling)coupling);
+        });
+    } else
+        return false;
+    return true;
+}
+
+/// \brief Answers a query.
+/// \return false, if the query is unknown.
+bool ControlServer::query(const QList<QByteArray> &nodes, const QByteArray &argument, QByteArray &answer) {
+    const DsoSettingsScope &scope = settings->scope;
+    const QByteArray &root = nodes[0];
+
+    if (nodes.size() == 1) {
+        if (root.toUpper() == "*IDN") {
+            answer = "OpenHantek," + QByteArray(dsoControl->getDevice()->getModel().name.c_str()) + ",," +
+                     QCoreApplication::applicationVersion().toLatin1();
+        } else if (root.toUpper() == "*OPC") {
+            answer = "1";
+        } else
+            return false;
+        return true;
+    }
+
+    unsigned channel = 0;
+    if (nodes.size() == 2 && matchesIndexed(root, "CHANnel", channel)) {
+        if (channel >= scope.physicalChannels) return false;
+        return channelQuery(channel, nodes[1], answer);
+    }
+    if (nodes.size() != 2) return false;
+    const QByteArray &node = nodes[1];
+
+    if (matches(root, "TIMebase") && matches(node, "SCALe")) {
+        appendNumber(answer, scope.horizontal.timebase);
+    } else if (matches(root, "ACQuire") && matches(node, "SRATe")) {
+        appendNumber(answer, scope.horizontal.samplerate);
+    } else if (matches(root, "ACQuire") && matches(node, "STATe")) {
+        answer = sampling ? "RUN" : "STOP";
+    } else if (matches(root, "TRIGger") && matches(node, "MODE")) {
+        answer = TRIGGERMODE_NAMES[scope.trigger.mode];
+    } else if (matches(root, "TRIGger") && matches(node, "SOURce")) {
+        answer = scope.trigger.special ? QByteArray("EXT") : "CHAN" + QByteArray::number(scope.trigger.source + 1);
+    } else if (matches(root, "TRIGger") && matches(node, "SLOPe")) {
+        answer = scope.trigger.slope == Dso::SLOPE_POSITIVE ? "POS" : "NEG";
+    } else if (matches(root, "TRIGger") && matches(node, "LEVel")) {
+        appendNumber(answer, scope.trigger.special ? NAN : scope.voltage[scope.trigger.source].trigger);
+    } else if (matches(root, "TRIGger") && matches(node, "POSition")) {
+        appendNumber(answer, scope.trigger.position);
+    } else if (matches(root, "WAVeform")) {
+        const std::shared_ptr<const DataAnalyzerResult> &result = daemon->latestResult();
+        const DataChannel *data =
+            result && waveformSource < result->channelCount() ? result->data((int)waveformSource) : nullptr;
+        if (matches(node, "SOURce"))
+            answer = waveformSource == scope.physicalChannels ? QByteArray("MATH")
+                                                              : "CHAN" + QByteArray::number(waveformSource + 1);
+        else if (matches(node, "POINts"))
+            answer = QByteArray::number((qulonglong)(data ? data->voltage.sample.size() : 0));
+        else if (matches(node, "XINCrement"))
+            appendNumber(answer, data ? data->voltage.interval : NAN);
+        else if (matches(node, "DATA"))
+            waveformData(answer);
+        else
+            return false;
+    } else if (matches(root, "MEASure")) {
+        return measure(node, argument, answer);
+    } else if (matches(root, "SYSTem") && matches(node, "ERRor")) {
+        if (errors.empty()) {
+            answer = "0,\"No error\"";
+        } else {
+            answer = errors.front();
+            errors.pop_front();
+        }
+    } else
+        return false;
+    return true;
+}
+
+/// \brief Answers a query of a channel setting.
+/// \return false, if the query is unknown.
+bool ControlServer::channelQuery(unsigned channel, const QByteArray &node, QByteArray &answer) {
+    const DsoSettingsScopeVoltage &voltage = settings->scope.voltage[channel];
+    if (matches(node, "SCALe"))
+        appendNumber(answer, voltage.gain);
+    else if (matches(node, "OFFSet"))
+        appendNumber(answer, voltage.offset);
+    else if (matches(node, "DISPlay"))
+        answer = voltage.used ? "1" : "0";
+    else if (matches(node, "COUPling"))
+        answer = COUPLING_NAMES[voltage.misc];
+    else
+        return false;
+    return true;
+}
+
+/// \brief Answers a measurement query of the newest frame, NaN if the value is unavailable.
+/// \param node The name of the measurement.
+/// \param argument The channel, the waveform source if it is empty.
+/// \return false, if the measurement or the channel is unknown.
+bool ControlServer::measure(const QByteArray &node, const QByteArray &argument, QByteArray &answer) {
+    unsigned channel = waveformSource;
+    if (matches(argument, "MATH"))
+        channel = settings->scope.physicalChannels;
+    else if (!argument.isEmpty() && !matchesIndexed(argument, "CHANnel", channel))
+        return false;
+
+    const std::shared_ptr<const DataAnalyzerResult> &result = daemon->latestResult();
+    const DataChannel *data = result && channel < result->channelCount() ? result->data((int)channel) : nullptr;
+    if (data && data->voltage.sample.empty()) data = nullptr;
+
+    if (matches(node, "AMPLitude")) {
+        appendNumber(answer, data ? data->amplitude : NAN);
+        return true;
+    }
+    if (matches(node, "FREQuency")) {
+        appendNumber(answer, data ? data->frequency : NAN);
+        return true;
+    }
+    const int measurement = findMnemonic(node, MEASUREMENT_MNEMONICS, Dso::MEASUREMENT_COUNT);
+    if (measurement < 0) return false;
+    appendNumber(answer, data ? data->measurements[(size_t)measurement] : NAN);
+    return true;
+}
+
+/// \brief Writes the voltages of the waveform source as an IEEE 488.2 definite length block of floats.
+/// The floats are in the byte order of the daemon, from the oldest to the newest sample.
+void ControlServer::waveformData(QByteArray &answer) {
+    const std::shared_ptr<const DataAnalyzerResult> &result = daemon->latestResult();
+    const DataChannel *data =
+        result && waveformSource < result->channelCount() ? result->data((int)waveformSource) : nullptr;
+    const size_t count = data ? data->voltage.sample.size() : 0;
+
+    const QByteArray length = QByteArray::number((qulonglong)(count * sizeof(float)));
+    answer = "#" + QByteArray::number(length.size()) + length;
+    const int start = answer.size();
+    answer.resize(start + (int)(count * sizeof(float)));
+    float *values = reinterpret_cast<float *>(answer.data() + start);
+    for (size_t index = 0; index < count; ++index) values[index] = (float)data->voltage.at(index);
+}
+
+/// \brief Enables the channels that are needed for the voltage, spectrum and math graphs.
+void ControlServer::updateChannelsUsed() {
+    const DsoSettingsScope &scope = settings->scope;
+    const unsigned math = scope.physicalChannels;
+    const bool mathUsed = scope.voltage[math].used | scope.spectrum[math].used;
+    for (unsigned channel = 0; channel < scope.physicalChannels; ++channel) {
+        const bool used = mathUsed | scope.voltage[channel].used | scope.spectrum[channel].used;
+        send("CHANnel" + QByteArray::number(channel + 1) + ":DISPlay",
+             [this, channel, used]() { return dsoControl->setChannelUsed(channel, used); });
+    }
+}
+
+/// \brief Runs a setting in the thread of the device without waiting for it.
+/// The settings are applied in the order they were sent, between two acquisition cycles.
+/// \param command The command, it is reported with the error.
+/// \param action Applies the setting, it is called in the thread of the device.
+void ControlServer::send(const QByteArray &command, std::function<Dso::ErrorCode()> action) {
+    QTimer::singleShot(0, dsoControl, [this, command, action]() {
+        const Dso::ErrorCode error = action();
+        if (error == Dso::ErrorCode::ERROR_NONE) return;
+        QTimer::singleShot(0, this, [this, command, error]() {
+            switch (error) {
+            case Dso::ErrorCode::ERROR_CONNECTION:
+                pushError(-240, "Hardware error", command);
+                break;
+            case Dso::ErrorCode::ERROR_UNSUPPORTED:
+                pushError(-241, "Hardware missing", command);
+                break;
+            default:
+                pushError(-222, "Data out of range", command);
+                break;
+            }
+        });
+    });
+}
+
+/// \brief Queues the error of a known command.
+/// \return true, the command was handled.
+bool ControlServer::reject(int code, const char *description, const QByteArray &command) {
+    pushError(code, description, command);
+    return true;
+}
+
+/// \brief Queues an error for ":SYSTem:ERRor?".
+void ControlServer::pushError(int code, const char *description, const QByteArray &command) {
+    if (errors.size() >= MAX_ERRORS) errors.pop_front();
+    // Quotes in the command would end the string of the answer
+    QByteArray text = command;
+    text.replace('"', '\'');
+    errors.push_back(QByteArray::number(code) + ",\"" + description + "; " + text + "\"");
+}
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QTcpServer>
+#include <deque>
+#include <functional>
+
+#include "definitions.h"
+
+class DsoSettings;
+class HantekDsoControl;
+class HeadlessDaemon;
+class QTcpSocket;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class ControlServer                                         controlserver.h
+/// \brief Remote control of the daemon with SCPI-like commands over TCP.
+/// Every line of a client contains one or more commands separated by ';'. Each
+/// command is written with its full path, the mnemonics may be abbreviated to
+/// their upper case part, e.g. ":CHAN1:SCAL 0.5" or ":channel1:scale 0.5".
+/// The answers of the queries in a line are joined with ';' and terminated
+/// by a newline. Numbers are plain SI values without units.
+///
+/// The settings are forwarded to the device thread without waiting for it, so
+/// neither the acquisition nor the other clients are blocked. Failed settings
+/// are queued and can be read with ":SYSTem:ERRor?".
+///
+/// Supported commands:
+/// - *IDN?, *OPC?, *CLS
+/// - :RUN, :STOP, :SINGle, :ACQuire:STATe?
+/// - :TIMebase:SCALe, :ACQuire:SRATe, :TRIGger:POSition
+/// - :CHANnel<n>:SCALe, :OFFSet, :DISPlay, :COUPling
+/// - :TRIGger:MODE, :SOURce, :SLOPe, :LEVel, :FORCe
+/// - :WAVeform:SOURce, :POINts?, :XINCrement?, :DATA? (IEEE 488.2 block of floats)
+/// - :MEASure:AMPLitude?, :FREQuency? and the automatic measurements, e.g. :MEASure:VRMS? CHAN1
+/// - :SYSTem:ERRor?
+/// - :DEBug:COMMand <text>, a command of HantekDsoControl::stringCommand
+class ControlServer : public QObject {
+    Q_OBJECT
+
+  public:
+    /// \param daemon The daemon that provides the analyzed frames.
+    /// \param dsoControl The device, it runs in its own thread.
+    /// \param settings The settings of the device, they are changed by the commands.
+    ControlServer(HeadlessDaemon *daemon, HantekDsoControl *dsoControl, DsoSettings *settings);
+
+    /// \brief Starts accepting clients.
+    /// \param port The TCP port.
+    /// \return true on success, otherwise errorString() describes the problem.
+    bool listen(quint16 port);
+    /// \return The description of the last error.
+    QString errorString() const { return server.errorString(); }
+
+    static const size_t MAX_ERRORS = 32;    ///< Older errors are dropped from the queue
+    static const qint64 MAX_LINE = 1 << 16; ///< A client that sends a longer line is disconnected
+
+  private:
+    void acceptClients();
+    void readCommands(QTcpSocket *socket);
+    bool execute(const QByteArray &command, QByteArray &answer);
+    bool setting(const QList<QByteArray> &nodes, const QByteArray &argument, const QByteArray &command);
+    bool channelSetting(unsigned channel, const QByteArray &node, const QByteArray &argument,
+                        const QByteArray &command);
+    bool query(const QList<QByteArray> &nodes, const QByteArray &argument, QByteArray &answer);
+    bool channelQuery(unsigned channel, const QByteArray &node, QByteArray &answer);
+    bool measure(const QByteArray &node, const QByteArray &argument, QByteArray &answer);
+    void waveformData(QByteArray &answer);
+    void updateChannelsUsed();
+    void send(const QByteArray &command, std::function<Dso::ErrorCode()> action);
+    bool reject(int code, const char *description, const QByteArray &command);
+    void pushError(int code, const char *description, const QByteArray &command);
+
+    HeadlessDaemon *daemon;
+    HantekDsoControl *dsoControl;
+    DsoSettings *settings;
+    QTcpServer server;
+    std::deque<QByteArray> errors; ///< The errors that weren't read by a client yet
+    unsigned waveformSource = 0;   ///< The channel of the waveform queries
+    bool sampling = false;         ///< true, if the device is sampling
+};
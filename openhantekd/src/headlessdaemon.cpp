@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QDebug>
+#include <QStringList>
+#include <cmath>
+#include <cstdio>
+
+#include "headlessdaemon.h"
+
+#include "capture/capturerecorder.h"
+#include "dataanalyzer.h"
+#include "hantekdsocontrol.h"
+#include "settings.h"
+#include "streamserver.h"
+#include "usb/usbdevice.h"
+#include "utils/dsoStrings.h"
+#include "utils/floatformat.h"
+#include "viewconstants.h"
+
+HeadlessDaemon::HeadlessDaemon(HantekDsoControl *dsoControl, DataAnalyzer *dataAnalyzer, DsoSettings *settings)
+    : dsoControl(dsoControl), dataAnalyzer(dataAnalyzer), settings(settings) {
+    connect(dataAnalyzer, &DataAnalyzer::analyzed, this, &HeadlessDaemon::analyzed);
+    connect(&reportTimer, &QTimer::timeout, this, &HeadlessDaemon::writeReport);
+    uptime.start();
+}
+
+/// \brief Initialize the device with the current settings, like the main window of the gui does.
+void HeadlessDaemon::applySettingsToDevice() {
+    dsoControl->applyConfiguration(settings->deviceConfiguration(dsoControl->getAvailableRecordLengths()));
+}
+
+bool HeadlessDaemon::startRecording(const QString &fileName) {
+    CaptureRecorder &recorder = dsoControl->getRecorder();
+    if (!recorder.start(fileName, QString::fromStdString(dsoControl->getDevice()->getModel().name),
+                        dsoControl->getChannelCount())) {
+        qWarning().noquote() << tr("Can't record to %1: %2").arg(fileName, recorder.errorString());
+        return false;
+    }
+    qDebug().noquote() << tr("Recording to %1").arg(fileName);
+    return true;
+}
+
+bool HeadlessDaemon::startReport(const QString &fileName, int interval) {
+    const bool opened = fileName.isEmpty() ? report.open(stdout, QIODevice::WriteOnly)
+                                           : report.open(fileName, QIODevice::WriteOnly | QIODevice::Truncate);
+    if (!opened) {
+        qWarning().noquote() << tr("Can't write the report to %1: %2").arg(fileName, report.errorString());
+        return false;
+    }
+    reportEnabled = true;
+    writeHeader();
+    if (interval > 0)
+        reportTimer.start(interval);
+    else
+        reportEveryFrame = true;
+    return true;
+}
+
+void HeadlessDaemon::stop() {
+    if (stopped) return;
+    stopped = true;
+    reportTimer.stop();
+
+    CaptureRecorder &recorder = dsoControl->getRecorder();
+    if (recorder.isRecording()) {
+        recorder.stop();
+        QString message = tr("Recorded %1 frames, dropped %2").arg(recorder.framesRecorded()).arg(
+            recorder.framesDropped());
+        if (!recorder.errorString().isEmpty()) message += tr(" (%1)").arg(recorder.errorString());
+        qDebug().noquote() << message;
+    }
+    if (reportEnabled) report.close();
+    qDebug().noquote() << tr("Analyzed %1 frames").arg(framesAnalyzed);
+    emit finished();
+}
+
+/// \brief Keeps the newest analyzed frame for the next report line and publishes it.
+void HeadlessDaemon::analyzed() {
+    if (stopped) return;
+    std::shared_ptr<const DataAnalyzerResult> result = dataAnalyzer->getNextResult();
+    if (!result) return;
+    latest = std::move(result);
+    ++framesAnalyzed;
+    if (streamServer) streamServer->publish(latest);
+    if (reportEveryFrame) writeReport();
+    if (frameLimit && framesAnalyzed >= frameLimit) {
+        if (reportEnabled && !reportEveryFrame) writeReport();
+        stop();
+    }
+}
+
+/// \brief Writes the names of the columns, the used channels and the enabled measurements are reported.
+void HeadlessDaemon::writeHeader() {
+    const DsoSettingsScope &scope = settings->scope;
+    QStringList columns;
+    columns << tr("Time") << tr("Frame");
+    for (int channel = 0; channel < scope.voltage.count(); ++channel) {
+        if (!scope.voltage[channel].used) continue;
+        const QString &name = scope.voltage[channel].name;
+        columns << tr("%1 Amplitude").arg(name) << tr("%1 Frequency").arg(name);
+        for (unsigned measurement = 0; measurement < Dso::MEASUREMENT_COUNT; ++measurement) {
+            if ((scope.measurements >> measurement) & 1u)
+                columns << tr("%1 %2").arg(name, Dso::measurementString((Dso::Measurement)measurement));
+        }
+    }
+    report.write(columns.join('\t').toUtf8());
+    report.write("\n");
+    report.flush();
+}
+
+/// \brief Writes the measurements of the newest frame, the values are in SI units and NaN if unavailable.
+void HeadlessDaemon::writeReport() {
+    if (!latest || framesAnalyzed == framesReported) return;
+    framesReported = framesAnalyzed;
+
+    const DsoSettingsScope &scope = settings->scope;
+    QByteArray line;
+    char number[FloatFormat::MAX_LENGTH];
+    auto append = [&line, &number](double value) {
+        line.append('\t');
+        line.append(number, (int)(FloatFormat::format(value, number) - number));
+    };
+
+    line.append(number, (int)(FloatFormat::format(uptime.elapsed() / 1000.0, number) - number));
+    line.append('\t');
+    line.append(QByteArray::number(framesAnalyzed));
+    for (int channel = 0; channel < scope.voltage.count(); ++channel) {
+        if (!scope.voltage[channel].used) continue;
+        const DataChannel *data = (unsigned)channel < latest->channelCount() ? latest->data(channel) : nullptr;
+        const bool valid = data && !data->voltage.sample.empty();
+        append(valid ? data->amplitude : NAN);
+        append(valid ? data->frequency : NAN);
+        for (unsigned measurement = 0; measurement < Dso::MEASUREMENT_COUNT; ++measurement) {
+            if ((scope.measurements >> measurement) & 1u) append(valid ? data->measurements[measurement] : NAN);
+        }
+    }
+    line.append('\n');
+    report.write(line);
+    report.flush();
+}
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include <QTimer>
+#include <memory>
+
+class DataAnalyzer;
+class DataAnalyzerResult;
+class DsoSettings;
+class HantekDsoControl;
+class StreamServer;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class HeadlessDaemon                                       headlessdaemon.h
+/// \brief Runs the acquisition without a display.
+/// The daemon applies the loaded settings to the device, optionally records
+/// every frame and periodically writes the measurements of the latest analyzed
+/// frame as tab-separated lines. It replaces the main window of the gui.
+class HeadlessDaemon : public QObject {
+    Q_OBJECT
+
+  public:
+    /// \brief Connects the daemon to the acquisition and the analysis.
+    /// \param dsoControl The device, it runs in its own thread.
+    /// \param dataAnalyzer The analyzer of the device, it runs in its own thread.
+    /// \param settings The settings of the device, they aren't saved.
+    HeadlessDaemon(HantekDsoControl *dsoControl, DataAnalyzer *dataAnalyzer, DsoSettings *settings);
+
+    /// \brief Initialize the device with the current settings.
+    void applySettingsToDevice();
+
+    /// \brief Records every acquired frame to a capture file.
+    /// \param fileName The name of the capture file, it is overwritten.
+    /// \return true on success, otherwise the error is written to the log.
+    bool startRecording(const QString &fileName);
+
+    /// \brief Writes the measurements periodically.
+    /// \param fileName The name of the report file, the standard output is used if it is empty.
+    /// \param interval The time between two report lines in ms, 0 writes a line for every analyzed frame.
+    /// \return true, if the file could be opened.
+    bool startReport(const QString &fileName, int interval);
+
+    /// \brief Publishes every analyzed frame to the network clients.
+    /// \param server The server, it runs in its own thread.
+    void setStreamServer(StreamServer *server) { streamServer = server; }
+
+    /// \return The newest analyzed frame, nullptr before the first one.
+    const std::shared_ptr<const DataAnalyzerResult> &latestResult() const { return latest; }
+
+    /// \brief Stops the daemon after a number of analyzed frames.
+    /// \param frames The number of frames, 0 runs until the daemon is stopped.
+    void setFrameLimit(quint64 frames) { frameLimit = frames; }
+
+  public slots:
+    /// \brief Stops the recording and writes a summary to the log.
+    void stop();
+
+  private:
+    void writeHeader();
+    void writeReport();
+
+    HantekDsoControl *dsoControl;
+    DataAnalyzer *dataAnalyzer;
+    DsoSettings *settings;
+    StreamServer *streamServer = nullptr;
+
+    std::shared_ptr<const DataAnalyzerResult> latest; ///< The newest analyzed frame
+    quint64 framesAnalyzed = 0;                       ///< The number of frames since the start
+    quint64 framesReported = 0;                       ///< The value of framesAnalyzed at the last report line
+    quint64 frameLimit = 0;                           ///< Stop after this many frames, 0 if unlimited
+    bool stopped = false;
+
+    QFile report;
+    bool reportEnabled = false;
+    bool reportEveryFrame = false;
+    QTimer reportTimer;
+    QElapsedTimer uptime;
+
+  private slots:
+    void analyzed();
+
+  signals:
+    void finished(); ///< The frame limit was reached or the device failed
+};
@@ -0,0 +1,291 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QLibraryInfo>
+#include <QLocale>
+#include <QThread>
+#include <QTimer>
+#include <QTranslator>
+#include <csignal>
+#include <memory>
+#include <vector>
+
+#include <libusb-1.0/libusb.h>
+
+#include "controlserver.h"
+#include "dataanalyzer.h"
+#include "devicemanager.h"
+#include "hantekdsocontrol.h"
+#include "headlessdaemon.h"
+#include "settings.h"
+#include "streamserver.h"
+#include "usb/finddevices.h"
+#include "usb/simulateddevice.h"
+#include "usb/usbdevice.h"
+#include "utils/frametrace.h"
+#include "utils/schedulingoptions.h"
+
+using namespace Hantek;
+
+namespace {
+static const int FIRMWARE_TIMEOUT = 10000;   ///< The maximal wait for the restart of the devices after the upload in ms
+static const int SIGNAL_POLL_INTERVAL = 100; ///< The time between two checks for a termination signal in ms
+
+volatile std::sig_atomic_t terminationRequested = 0;
+
+void requestTermination(int) { terminationRequested = 1; }
+}
+
+/// \brief Connects to a ready usb device, the firmware is uploaded to all found devices first.
+/// \param deviceIndex The index of the device among the ready devices.
+/// \return The connected device, nullptr on failure. The reason is written to the log.
+std::unique_ptr<USBDevice> connectUsbDevice(int deviceIndex) {
+    //////// Find matching usb devices ////////
+    libusb_context *context;
+    int error = libusb_init(&context);
+
+    if (error) {
+        qWarning().noquote()
+            << QCoreApplication::translate("", "Can't initalize USB: %1").arg(libUsbErrorString(error));
+        return nullptr;
+    }
+
+    FindDevices findDevices;
+    QStringList warnings;
+    std::unique_ptr<USBDevice> device = findDevices.connectReadyDevice(deviceIndex, FIRMWARE_TIMEOUT, warnings);
+    for (const QString &message : warnings) qWarning().noquote() << message;
+    if (!device) qWarning().noquote() << findDevices.getErrorMessage();
+    return device;
+}
+
+/// \brief Runs the acquisition of a device without a gui.
+int main(int argc, char *argv[]) {
+    //////// Set application information ////////
+    // Without a configuration file the settings of the gui are used
+    QCoreApplication::setOrganizationName("OpenHantek");
+    QCoreApplication::setOrganizationDomain("www.openhantek.org");
+    QCoreApplication::setApplicationName("OpenHantek");
+    QCoreApplication::setApplicationVersion(VERSION);
+
+    QCoreApplication openHantekApplication(argc, argv);
+
+    //////// Parse command line ////////
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QCoreApplication::translate("main", "Acquires and analyzes the signals of a "
+                                                                         "Hantek oscilloscope without a gui."));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption configOption("config", QCoreApplication::translate("main", "Load the settings from <file>."),
+                                    "file");
+    parser.addOption(configOption);
+    QCommandLineOption deviceOption(
+        "device", QCoreApplication::translate("main", "Use the ready device with <index>, starting at 0."), "index",
+        "0");
+    parser.addOption(deviceOption);
+    QCommandLineOption recordOption("record",
+                                    QCoreApplication::translate("main", "Record every frame to the capture <file>."),
+                                    "file");
+    parser.addOption(recordOption);
+    QCommandLineOption reportOption("report",
+                                    QCoreApplication::translate("main", "Write the measurements to <file> instead of "
+                                                                        "the standard output."),
+                                    "file");
+    parser.addOption(reportOption);
+    QCommandLineOption intervalOption("interval",
+                                      QCoreApplication::translate("main", "Write the measurements every <ms>, 0 for "
+                                                                          "every frame, -1 to disable them."),
+                                      "ms", "1000");
+    parser.addOption(intervalOption);
+    QCommandLineOption framesOption(
+        "frames", QCoreApplication::translate("main", "Stop after <count> analyzed frames."), "count", "0");
+    parser.addOption(framesOption);
+    QCommandLineOption streamOption("stream",
+                                    QCoreApplication::translate("main", "Publish the analyzed frames to network "
+                                                                        "clients on the TCP <port>."),
+                                    "port");
+    parser.addOption(streamOption);
+    QCommandLineOption streamRateOption("stream-rate",
+                                        QCoreApplication::translate("main", "Send at most <fps> frames per second to "
+                                                                            "a client by default, 0 for all frames."),
+                                        "fps", "30");
+    parser.addOption(streamRateOption);
+    QCommandLineOption controlOption("control",
+                                     QCoreApplication::translate("main", "Accept SCPI-like remote control commands "
+                                                                         "on the TCP <port>."),
+                                     "port");
+    parser.addOption(controlOption);
+    QCommandLineOption simulateOption("simulate",
+                                      QCoreApplication::translate("main", "Use a simulated <device> instead of a usb "
+                                                                          "device: %1")
+                                          .arg(SimulatedDevice::descriptionHelp()),
+                                      "device");
+    parser.addOption(simulateOption);
+    QCommandLineOption traceOption("trace",
+                                   QCoreApplication::translate("main", "Trace the pipeline stages of every frame and "
+                                                                       "write them as Chrome trace JSON to <file> "
+                                                                       "on exit."),
+                                   "file");
+    parser.addOption(traceOption);
+    QCommandLineOption noReconnectOption("no-reconnect",
+                                         QCoreApplication::translate("main", "Stop when the device is disconnected "
+                                                                             "or fails, instead of reconnecting."));
+    parser.addOption(noReconnectOption);
+    SchedulingOptions schedulingOptions(parser);
+    parser.process(openHantekApplication);
+    if (parser.isSet(traceOption)) FrameTrace::start();
+
+    //////// Parse the scheduling of the threads ////////
+    {
+        QString errorMessage;
+        if (!schedulingOptions.parse(errorMessage)) {
+            qWarning().noquote() << errorMessage;
+            return -1;
+        }
+    }
+
+    //////// Load translations ////////
+    QTranslator qtTranslator;
+    if (qtTranslator.load("qt_" + QLocale::system().name(), QLibraryInfo::location(QLibraryInfo::TranslationsPath)))
+        openHantekApplication.installTranslator(&qtTranslator);
+
+    //////// Load settings, they are never saved ////////
+    DsoSettings settings;
+    if (parser.isSet(configOption)) {
+        if (!settings.setFilename(parser.value(configOption))) return -1;
+        settings.load();
+    }
+
+    //////// Connect to the selected device, a simulated device doesn't need usb ////////
+    std::unique_ptr<USBDevice> device;
+    if (parser.isSet(simulateOption)) {
+        QString errorMessage;
+        device = SimulatedDevice::create(parser.value(simulateOption), errorMessage);
+        if (!device || !device->connectDevice(errorMessage)) {
+            qWarning().noquote() << errorMessage;
+            return -1;
+        }
+    } else {
+        device = connectUsbDevice(parser.value(deviceOption).toInt());
+        if (!device) return -1;
+    }
+
+    //////// Create DSO control object and move it to a separate thread ////////
+    QThread dsoControlThread;
+    dsoControlThread.setObjectName("dsoControlThread");
+    HantekDsoControl dsoControl(device.get());
+    dsoControl.moveToThread(&dsoControlThread);
+    schedulingOptions.usb.applyOnStart(&dsoControlThread);
+    QObject::connect(&dsoControlThread, &QThread::started, &dsoControl, &HantekDsoControl::run);
+
+    //////// Create data analyser object ////////
+    QThread dataAnalyzerThread;
+    dataAnalyzerThread.setObjectName("dataAnalyzerThread");
+    schedulingOptions.analysis.applyOnStart(&dataAnalyzerThread);
+    DataAnalyzer dataAnalyser;
+    dataAnalyser.setSourceData(&dsoControl.getSampleBuffer());
+    dataAnalyser.setWorkerScheduling(schedulingOptions.analysis);
+    dataAnalyser.moveToThread(&dataAnalyzerThread);
+    QObject::connect(&dsoControl, &HantekDsoControl::samplesAvailable, &dataAnalyser, &DataAnalyzer::samplesAvailable);
+
+    settings.setChannelCount(dsoControl.getChannelCount());
+    dataAnalyser.applySettings(&settings.scope);
+
+    //////// Create the daemon, it takes the place of the main window ////////
+    HeadlessDaemon daemon(&dsoControl, &dataAnalyser, &settings);
+    daemon.applySettingsToDevice();
+    daemon.setFrameLimit(parser.value(framesOption).toULongLong());
+    if (parser.isSet(recordOption) && !daemon.startRecording(parser.value(recordOption))) return -1;
+    const int interval = parser.value(intervalOption).toInt();
+    if (interval >= 0 && !daemon.startReport(parser.value(reportOption), interval)) return -1;
+
+    //////// Optionally accept remote control commands ////////
+    std::unique_ptr<ControlServer> controlServer;
+    if (parser.isSet(controlOption)) {
+        controlServer = std::unique_ptr<ControlServer>(new ControlServer(&daemon, &dsoControl, &settings));
+        if (!controlServer->listen(parser.value(controlOption).toUShort())) {
+            qWarning().noquote() << QCoreApplication::translate("", "Can't accept commands on port %1: %2")
+                                        .arg(parser.value(controlOption), controlServer->errorString());
+            return -1;
+        }
+    }
+
+    //////// Optionally publish the frames to network clients in a separate thread ////////
+    QThread streamThread;
+    streamThread.setObjectName("streamThread");
+    std::unique_ptr<StreamServer> streamServer;
+    if (parser.isSet(streamOption)) {
+        streamServer = std::unique_ptr<StreamServer>(new StreamServer(
+            QString::fromStdString(device->getModel().name), dsoControl.getChannelCount()));
+        streamServer->setDefaultRate(parser.value(streamRateOption).toDouble());
+        streamServer->moveToThread(&streamThread);
+        streamThread.start();
+        bool listening = false;
+        QMetaObject::invokeMethod(streamServer.get(), "listen", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, listening), Q_ARG(quint16, parser.value(streamOption).toUShort()));
+        if (!listening) {
+            qWarning().noquote() << QCoreApplication::translate("", "Can't publish the frames on port %1: %2")
+                                        .arg(parser.value(streamOption), streamServer->errorString());
+            streamThread.quit();
+            streamThread.wait(10000);
+            return -1;
+        }
+        daemon.setStreamServer(streamServer.get());
+    }
+    // The clients query and receive the measurements of the hidden channels too
+    dataAnalyser.setMeasureAllChannels(controlServer || streamServer);
+
+    QObject::connect(&daemon, &HeadlessDaemon::finished, &openHantekApplication, &QCoreApplication::quit,
+                     Qt::QueuedConnection);
+
+    //////// Reconnect a lost device, the simulated device only fails on errors ////////
+    DeviceManager deviceManager;
+    if (parser.isSet(noReconnectOption) || parser.isSet(simulateOption)) {
+        QObject::connect(&dsoControl, &HantekDsoControl::communicationError, &daemon, &HeadlessDaemon::stop);
+        QObject::connect(device.get(), &USBDevice::deviceDisconnected, &daemon, &HeadlessDaemon::stop);
+    } else {
+        deviceManager.watch(device.get(), &dsoControl);
+    }
+
+    //////// Stop cleanly on SIGINT and SIGTERM ////////
+    std::signal(SIGINT, requestTermination);
+    std::signal(SIGTERM, requestTermination);
+    QTimer signalTimer;
+    QObject::connect(&signalTimer, &QTimer::timeout, &daemon, [&daemon]() {
+        if (terminationRequested) daemon.stop();
+    });
+    signalTimer.start(SIGNAL_POLL_INTERVAL);
+
+    //////// Keep the buffers in ram, a page fault could delay a usb read ////////
+    schedulingOptions.lockMemory();
+
+    //////// Start DSO threads and go into the main loop ////////
+    dataAnalyzerThread.start();
+    dsoControl.startSampling();
+    dsoControlThread.start();
+    int res = openHantekApplication.exec();
+
+    //////// Clean up ////////
+    if (streamServer) {
+        QMetaObject::invokeMethod(streamServer.get(), "close", Qt::BlockingQueuedConnection);
+        streamThread.quit();
+        streamThread.wait(10000);
+    }
+
+    dsoControlThread.quit();
+    dsoControlThread.wait(10000);
+
+    dataAnalyzerThread.quit();
+    dataAnalyzerThread.wait(10000);
+
+    //////// Write the trace after all threads stopped ////////
+    if (parser.isSet(traceOption)) {
+        FrameTrace::stop();
+        QString errorMessage;
+        if (!FrameTrace::write(parser.value(traceOption), errorMessage))
+            qWarning().noquote() << QCoreApplication::translate("", "Can't write the trace to %1: %2")
+                                        .arg(parser.value(traceOption), errorMessage);
+    }
+    return res;
+}
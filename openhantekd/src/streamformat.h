@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cstdint>
+
+/// \namespace Stream
+/// \brief The binary format of the network stream.
+/// The server sends messages, every message is a MessageHeader followed by its
+/// payload. After the connection is established the server sends a
+/// MESSAGE_HELLO, then a MESSAGE_FRAME for every frame that is published to the
+/// client. A frame payload is a FrameHeader, then for every channel a
+/// ChannelHeader, the measurements as doubles, the voltages and the spectrum as
+/// floats, padded to a multiple of 8 bytes. All values are stored in the byte
+/// order of the server, which is little endian on all supported platforms.
+///
+/// A compressed payload is the 4 byte big endian size of the uncompressed
+/// payload followed by the zlib stream, as written by qCompress(). The payload
+/// of a delta frame is the bytewise XOR with the payload of the previous frame
+/// sent to the same client, deltas are always compressed.
+///
+/// The client controls the stream with lines of text:
+/// - "rate <fps>" limits the frames per second, 0 sends every frame
+/// - "delta <0|1>" disables or enables the compressed deltas
+/// - "content <bits>" selects the optional parts of a frame, see FrameContent
+namespace Stream {
+
+static const uint32_t MESSAGE_MAGIC = 0x4d54534f; ///< "OSTM", the start of every message
+static const uint32_t VERSION = 1;                ///< The current format version
+static const unsigned PADDING = 8;                ///< The alignment of the headers and values
+
+/// \brief The types of the messages.
+enum MessageType : uint16_t {
+    MESSAGE_HELLO = 1, ///< The first message of the stream, the payload is a Hello
+    MESSAGE_FRAME = 2  ///< An analyzed frame
+};
+
+/// \brief The flags of a message.
+enum MessageFlags : uint16_t {
+    MESSAGE_COMPRESSED = 1, ///< The payload is compressed
+    MESSAGE_DELTA = 2       ///< The payload is the XOR with the previous frame payload
+};
+
+/// \brief The optional parts of a frame, every client chooses them.
+enum FrameContent : uint32_t {
+    CONTENT_VOLTAGE = 1,  ///< The voltage samples
+    CONTENT_SPECTRUM = 2, ///< The spectrum
+    CONTENT_ALL = 3       ///< All parts, the default
+};
+
+/// \brief The flags of a frame.
+enum FrameFlags : uint32_t {
+    FRAME_ROLLING = 1 ///< The samples are the newest part of a roll mode acquisition
+};
+
+/// \brief The start of every message.
+struct MessageHeader {
+    uint32_t magic; ///< MESSAGE_MAGIC
+    uint16_t type;  ///< The MessageType
+    uint16_t flags; ///< The MessageFlags
+    uint32_t size;  ///< The size of the payload after this header in bytes
+    uint32_t reserved;
+};
+
+/// \brief The payload of MESSAGE_HELLO.
+struct Hello {
+    uint32_t version;  ///< VERSION
+    uint32_t channels; ///< The number of physical channels of the device
+    char model[48];    ///< The name of the device model, zero terminated
+};
+
+/// \brief The start of a frame payload.
+struct FrameHeader {
+    uint64_t sequence;         ///< The number of the frame since the start, frames that weren't sent are skipped
+    double triggerPoint;       ///< The position of the software trigger in samples, negative if there is none
+    uint32_t flags;            ///< The FrameFlags
+    uint32_t content;          ///< The FrameContent of this frame
+    uint32_t channels;         ///< The number of ChannelHeader, the last one is the math channel
+    uint32_t measurementCount; ///< The number of measurements of every channel
+};
+
+/// \brief The description of a channel in a frame.
+struct ChannelHeader {
+    uint32_t voltageCount;   ///< The number of voltage samples, 0 if the channel is unused
+    uint32_t spectrumCount;  ///< The number of spectrum bins
+    double voltageInterval;  ///< The time between two voltage samples in s
+    double spectrumInterval; ///< The frequency between two spectrum bins in Hz
+    double amplitude;        ///< The amplitude of the signal in V
+    double frequency;        ///< The frequency of the signal in Hz
+};
+
+static_assert(sizeof(MessageHeader) % PADDING == 0, "The message header has to keep the payload aligned");
+static_assert(sizeof(Hello) % PADDING == 0, "The hello has to be aligned");
+static_assert(sizeof(FrameHeader) % PADDING == 0, "The frame header has to keep the channels aligned");
+static_assert(sizeof(ChannelHeader) % PADDING == 0, "The channel header has to keep the values aligned");
+
+/// \brief Rounds a size up to the alignment of the format.
+inline uint64_t padded(uint64_t size) { return (size + PADDING - 1) / PADDING * PADDING; }
+}
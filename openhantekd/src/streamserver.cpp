@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QTcpSocket>
+#include <algorithm>
+#include <cstring>
+
+#include "streamserver.h"
+
+#include "dataanalyzerresult.h"
+
+StreamServer::StreamServer(const QString &model, unsigned channels) {
+    Stream::Hello header;
+    std::memset(&header, 0, sizeof(header));
+    header.version = Stream::VERSION;
+    header.channels = channels;
+    const QByteArray modelName = model.toUtf8().left(sizeof(header.model) - 1);
+    std::memcpy(header.model, modelName.constData(), (size_t)modelName.size());
+    hello = QByteArray(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    server.setParent(this);
+    connect(&server, &QTcpServer::newConnection, this, &StreamServer::acceptClients);
+}
+
+StreamServer::~StreamServer() { close(); }
+
+void StreamServer::publish(std::shared_ptr<const DataAnalyzerResult> result) {
+    {
+        QMutexLocker locker(&mutex);
+        published = std::move(result);
+        ++publishedSequence;
+    }
+    // Only one notification is queued, the server thread always takes the newest frame
+    if (notified.testAndSetOrdered(0, 1)) QMetaObject::invokeMethod(this, "framePublished", Qt::QueuedConnection);
+}
+
+bool StreamServer::listen(quint16 port) { return server.listen(QHostAddress::Any, port); }
+
+void StreamServer::close() {
+    server.close();
+    for (auto &client : clients) {
+        client->socket->disconnect(this);
+        client->socket->abort();
+        client->socket->deleteLater();
+    }
+    clients.clear();
+}
+
+/// \brief Takes the newest frame and offers it to every client.
+void StreamServer::framePublished() {
+    notified.storeRelease(0);
+    {
+        QMutexLocker locker(&mutex);
+        current = published;
+        currentSequence = publishedSequence;
+    }
+    for (QByteArray &payload : encoded) payload.clear();
+    for (auto &client : clients) sendFrame(client.get());
+}
+
+void StreamServer::acceptClients() {
+    while (QTcpSocket *socket = server.nextPendingConnection()) {
+        Client *client = new Client;
+        client->socket = socket;
+        client->minInterval = defaultRate > 0.0 ? (qint64)(1000.0 / defaultRate) : 0;
+        client->rateTimer.setSingleShot(true);
+        clients.push_back(std::unique_ptr<Client>(client));
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, client]() { readCommands(client); });
+        connect(socket, &QTcpSocket::bytesWritten, this, [this, client]() { sendFrame(client); });
+        connect(&client->rateTimer, &QTimer::timeout, this, [this, client]() { sendFrame(client); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, client]() { removeClient(client); },
+                Qt::QueuedConnection);
+
+        writeMessage(socket, Stream::MESSAGE_HELLO, 0, hello);
+        sendFrame(client);
+    }
+}
+
+/// \brief Applies the control lines of a client, unknown lines are ignored.
+void StreamServer::readCommands(Client *client) {
+    while (client->socket->canReadLine()) {
+        const QList<QByteArray> words = client->socket->readLine().simplified().split(' ');
+        if (words.size() != 2) continue;
+        bool ok = false;
+        if (words[0] == "rate") {
+            const double fps = words[1].toDouble(&ok);
+            if (ok && fps >= 0.0) client->minInterval = fps > 0.0 ? (qint64)(1000.0 / fps) : 0;
+        } else if (words[0] == "delta") {
+            const int enable = words[1].toInt(&ok);
+            if (ok) {
+                client->delta = enable != 0;
+                client->previous.clear();
+            }
+        } else if (words[0] == "content") {
+            const unsigned content = words[1].toUInt(&ok);
+            if (ok) client->content = content & Stream::CONTENT_ALL;
+        }
+    }
+    // A line without an end would be buffered without limit
+    if (client->socket->bytesAvailable() > MAX_LINE) client->socket->abort();
+}
+
+/// \brief Sends the newest frame to a client, if it wasn't sent yet and the client can take it.
+void StreamServer::sendFrame(Client *client) {
+    if (!current || client->sentSequence == currentSequence) return;
+    // Latest wins, the frame is replaced by a newer one while the socket is busy
+    if (client->socket->bytesToWrite() > MAX_QUEUED) return;
+    if (client->minInterval && client->lastSent.isValid()) {
+        const qint64 remaining = client->minInterval - client->lastSent.elapsed();
+        if (remaining > 0) {
+            if (!client->rateTimer.isActive()) client->rateTimer.start((int)remaining);
+            return;
+        }
+    }
+
+    const QByteArray &frame = payload(client->content);
+    if (client->delta) {
+        unsigned flags = Stream::MESSAGE_COMPRESSED;
+        QByteArray data = frame;
+        if (client->previous.size() == frame.size()) {
+            char *target = data.data();
+            const char *previous = client->previous.constData();
+            for (int i = 0; i < data.size(); ++i) target[i] ^= previous[i];
+            flags |= Stream::MESSAGE_DELTA;
+        }
+        writeMessage(client->socket, Stream::MESSAGE_FRAME, flags, qCompress(data, 1));
+        client->previous = frame;
+    } else {
+        writeMessage(client->socket, Stream::MESSAGE_FRAME, 0, frame);
+    }
+    client->sentSequence = currentSequence;
+    client->lastSent.start();
+}
+
+void StreamServer::removeClient(Client *client) {
+    auto found = std::find_if(clients.begin(), clients.end(),
+                              [client](const std::unique_ptr<Client> &entry) { return entry.get() == client; });
+    if (found == clients.end()) return;
+    client->rateTimer.stop();
+    // The socket lives until deleteLater(), its signals mustn't reach the erased client
+    client->socket->disconnect(this);
+    client->socket->deleteLater();
+    clients.erase(found);
+}
+
+/// \brief Encodes the current frame, every content is only encoded once per frame.
+/// \param content The FrameContent of the payload.
+/// \return The uncompressed payload.
+const QByteArray &StreamServer::payload(unsigned content) {
+    QByteArray &data = encoded[content];
+    if (!data.isEmpty()) return data;
+
+    // The samples are converted to floats straight from the result, the ring of the roll mode from its two spans
+    const unsigned channels = current->channelCount();
+    const bool voltage = content & Stream::CONTENT_VOLTAGE;
+    const bool spectrum = content & Stream::CONTENT_SPECTRUM;
+    uint64_t size = sizeof(Stream::FrameHeader);
+    for (unsigned channel = 0; channel < channels; ++channel) {
+        const DataChannel *channelData = current->data((int)channel);
+        size += sizeof(Stream::ChannelHeader) + sizeof(double) * Dso::MEASUREMENT_COUNT;
+        size += Stream::padded(sizeof(float) * ((voltage ? channelData->voltage.sample.size() : 0) +
+                                                (spectrum ? channelData->spectrum.sample.size() : 0)));
+    }
+    data.resize((int)size);
+    char *position = data.data();
+
+    Stream::FrameHeader *frameHeader = reinterpret_cast<Stream::FrameHeader *>(position);
+    frameHeader->sequence = currentSequence;
+    frameHeader->triggerPoint = current->triggerPoint();
+    frameHeader->flags = current->isRolling() ? Stream::FRAME_ROLLING : 0;
+    frameHeader->content = content;
+    frameHeader->channels = channels;
+    frameHeader->measurementCount = Dso::MEASUREMENT_COUNT;
+    position += sizeof(Stream::FrameHeader);
+
+    for (unsigned channel = 0; channel < channels; ++channel) {
+        const DataChannel *channelData = current->data((int)channel);
+        const size_t voltageCount = voltage ? channelData->voltage.sample.size() : 0;
+        const size_t spectrumCount = spectrum ? channelData->spectrum.sample.size() : 0;
+
+        Stream::ChannelHeader *channelHeader = reinterpret_cast<Stream::ChannelHeader *>(position);
+        channelHeader->voltageCount = (uint32_t)voltageCount;
+        channelHeader->spectrumCount = (uint32_t)spectrumCount;
+        channelHeader->voltageInterval = channelData->voltage.interval;
+        channelHeader->spectrumInterval = channelData->spectrum.interval;
+        channelHeader->amplitude = channelData->amplitude;
+        channelHeader->frequency = channelData->frequency;
+        position += sizeof(Stream::ChannelHeader);
+
+        std::memcpy(position, channelData->measurements.data(), sizeof(double) * Dso::MEASUREMENT_COUNT);
+        position += sizeof(double) * Dso::MEASUREMENT_COUNT;
+
+        // The voltages are sent from the oldest to the newest sample
+        float *values = reinterpret_cast<float *>(position);
+        for (unsigned part = 0; part < 2 && voltageCount; ++part) {
+            size_t count;
+            const double *span = channelData->voltage.span(part, count);
+            values = std::copy(span, span + count, values);
+        }
+        const double *spectra = channelData->spectrum.sample.data();
+        std::copy(spectra, spectra + spectrumCount, values);
+        const size_t written = sizeof(float) * (voltageCount + spectrumCount);
+        std::memset(position + written, 0, Stream::padded(written) - written);
+        position += Stream::padded(written);
+    }
+    return data;
+}
+
+void StreamServer::writeMessage(QTcpSocket *socket, Stream::MessageType type, unsigned flags,
+                                const QByteArray &payload) {
+    Stream::MessageHeader header;
+    header.magic = Stream::MESSAGE_MAGIC;
+    header.type = type;
+    header.flags = (uint16_t)flags;
+    header.size = (uint32_t)payload.size();
+    header.reserved = 0;
+    socket->write(reinterpret_cast<const char *>(&header), sizeof(header));
+    socket->write(payload);
+}
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QTcpServer>
+#include <QTimer>
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "streamformat.h"
+
+class DataAnalyzerResult;
+class QTcpSocket;
+
+////////////////////////////////////////////////////////////////////////////////
+/// \class StreamServer                                           streamserver.h
+/// \brief Publishes the analyzed frames to network clients.
+/// The server keeps only the newest published frame. Every client gets the
+/// newest frame when its rate limit allows it and its socket has written the
+/// previous one, the frames in between are dropped for that client only. So a
+/// slow client never delays the acquisition or the other clients. The server
+/// runs in its own thread, the format is described in streamformat.h.
+class StreamServer : public QObject {
+    Q_OBJECT
+
+  public:
+    /// \param model The name of the device model, it is sent to every client.
+    /// \param channels The number of physical channels of the device.
+    StreamServer(const QString &model, unsigned channels);
+    ~StreamServer();
+
+    /// \brief Publishes a frame, can be called from any thread.
+    /// \param result The analyzed frame, it is only read by the server.
+    void publish(std::shared_ptr<const DataAnalyzerResult> result);
+
+    /// \brief Sets the highest frame rate for new clients.
+    /// \param fps The frames per second, 0 sends every frame.
+    void setDefaultRate(double fps) { defaultRate = fps; }
+
+    static const qint64 MAX_QUEUED = 1 << 20; ///< A client gets no new frame while more bytes wait for its socket
+    static const qint64 MAX_LINE = 1 << 12;   ///< A client that sends a longer control line is disconnected
+
+  public slots:
+    /// \brief Starts accepting clients, has to be called in the thread of the server.
+    /// \param port The TCP port.
+    /// \return true on success, otherwise errorString() describes the problem.
+    bool listen(quint16 port);
+    /// \brief Disconnects all clients and stops accepting new ones.
+    void close();
+
+  public:
+    /// \return The description of the last error.
+    QString errorString() const { return server.errorString(); }
+
+  private:
+    /// \brief The state of a connected client.
+    struct Client {
+        QTcpSocket *socket;
+        unsigned content = Stream::CONTENT_ALL; ///< The FrameContent the client wants
+        bool delta = false;                     ///< true, if the client wants compressed deltas
+        qint64 minInterval = 0;                 ///< The minimal time between two frames in ms
+        QElapsedTimer lastSent;                 ///< The time the last frame was sent
+        quint64 sentSequence = 0;               ///< The sequence of the last sent frame
+        QByteArray previous;                    ///< The uncompressed payload of the last sent frame
+        QTimer rateTimer;                       ///< Sends the newest frame when the rate limit expires
+    };
+
+    void acceptClients();
+    void readCommands(Client *client);
+    void sendFrame(Client *client);
+    void removeClient(Client *client);
+    const QByteArray &payload(unsigned content);
+    static void writeMessage(QTcpSocket *socket, Stream::MessageType type, unsigned flags, const QByteArray &payload);
+
+    QTcpServer server;
+    QByteArray hello;                             ///< The payload of the hello message
+    double defaultRate = 30.0;                    ///< The frame rate limit of new clients
+    std::vector<std::unique_ptr<Client>> clients; ///< Only used in the thread of the server
+
+    // The newest frame, protected by mutex
+    QMutex mutex;
+    std::shared_ptr<const DataAnalyzerResult> published;
+    quint64 publishedSequence = 0;
+    QAtomicInt notified; ///< Not 0, if the server thread wasn't notified about the newest frame yet
+
+    // The encoded newest frame, only used in the thread of the server
+    std::shared_ptr<const DataAnalyzerResult> current;
+    quint64 currentSequence = 0;
+    std::array<QByteArray, Stream::CONTENT_ALL + 1> encoded; ///< The payload for every FrameContent, if encoded
+
+  private slots:
+    void framePublished();
+};